@@ -7,6 +7,8 @@
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QString>
+#include <QStringList>
+#include <QList>
 #include "restore_internal_warnings.h"
 
 #include <OsmAndCore.h>
@@ -26,7 +28,7 @@ namespace OsmAnd
         Q_DISABLE_COPY_AND_MOVE(CachedOsmandIndexes);
 
     public:
-        static const int VERSION = 2;
+        static const int VERSION = 3;
 
     private:
         PrivateImplementation<CachedOsmandIndexes_P> _p;
@@ -36,6 +38,15 @@ namespace OsmAnd
         virtual ~CachedOsmandIndexes();
 
         const std::shared_ptr<ObfFile> getObfFile(const QString& filePath);
+
+        // Resolves all files at once. Headers of files missing in cache are parsed in parallel, with at most
+        // maxConcurrentFiles files open at a time (ideal thread count if 0), and then added to cache in one batch.
+        // Files that failed to open are returned without OBF info, in the same order as paths were given.
+        QList< std::shared_ptr<ObfFile> > getObfFiles(const QStringList& filePaths, const unsigned int maxConcurrentFiles = 0);
+
+        // Same as above, but without touching any cache
+        static QList< std::shared_ptr<ObfFile> > loadObfFiles(const QStringList& filePaths, const unsigned int maxConcurrentFiles = 0);
+
         void readFromFile(const QString& filePath, int version);
         void writeToFile(const QString& filePath);
     };
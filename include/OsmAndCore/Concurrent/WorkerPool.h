@@ -18,6 +18,8 @@ namespace OsmAnd
 {
     namespace Concurrent
     {
+        // Each worker thread has own queue of runnables ordered by priority, and takes work from queues of other
+        // threads when own is empty. Order only defines how runnables of same priority are taken.
         class WorkerPool_P;
         class OSMAND_CORE_API WorkerPool Q_DECL_FINAL
         {
@@ -33,6 +35,14 @@ namespace OsmAnd
 
             typedef std::function<bool (QRunnable* const l, QRunnable* const r)> SortPredicate;
 
+            // Runnables with higher priority are taken first
+            typedef int64_t Priority;
+
+            // Runnables with same affinity are kept on same worker thread, and are taken by other threads only when
+            // there's nothing else to do
+            typedef uint64_t Affinity;
+            static const Affinity NoAffinity;
+
         private:
             PrivateImplementation<WorkerPool_P> _p;
         protected:
@@ -51,9 +61,17 @@ namespace OsmAnd
 
             void enqueue(QRunnable* const runnable, const SortPredicate predicate = nullptr);
             void enqueue(const QVector<QRunnable*>& runnables, const SortPredicate predicate = nullptr);
+
+            void enqueue(
+                QRunnable* const runnable,
+                const Priority priority,
+                const Affinity affinity = NoAffinity);
+            bool updatePriority(QRunnable* const runnable, const Priority priority);
+
             bool dequeue(QRunnable* const runnable, const SortPredicate predicate = nullptr);
             void dequeueAll();
 
+            // Reassigns priorities of all queued runnables by their order according to predicate, so it's expensive
             void sortQueue(const SortPredicate predicate);
 
             void reset();
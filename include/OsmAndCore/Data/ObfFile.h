@@ -8,7 +8,10 @@
 #include <QFileInfo>
 
 #include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/PointsAndAreas.h>
 #include <OsmAndCore/PrivateImplementation.h>
+#include <OsmAndCore/Data/DataCommonTypes.h>
 
 namespace OsmAnd
 {
@@ -20,6 +23,34 @@ namespace OsmAnd
     class OSMAND_CORE_API ObfFile
     {
         Q_DISABLE_COPY_AND_MOVE(ObfFile)
+    public:
+        // Coarse description of file, that is known without decoding its sections
+        struct OSMAND_CORE_API Summary Q_DECL_FINAL
+        {
+            Summary();
+            ~Summary();
+
+            uint64_t creationTimestamp;
+            bool isBasemap;
+            bool isBasemapWithCoastlines;
+            // Types of data that file has sections for
+            ObfDataTypesMask dataTypes;
+            // Covers areas of all sections
+            AreaI bbox31;
+            // Zoom range of all levels of map sections
+            ZoomLevel minMapZoom;
+            ZoomLevel maxMapZoom;
+
+            // Same as ObfInfo::containsDataFor(), but may give false positives since areas of sections are merged
+            bool mayContainDataFor(
+                const AreaI* const pBbox31,
+                const ZoomLevel minZoomLevel,
+                const ZoomLevel maxZoomLevel,
+                const ObfDataTypesMask desiredDataTypes) const;
+
+            static std::shared_ptr<const Summary> fromInfo(const ObfInfo& obfInfo);
+        };
+
     private:
         PrivateImplementation<ObfFile_P> _p;
     protected:
@@ -31,7 +62,12 @@ namespace OsmAnd
 
         const QString filePath;
         const uint64_t fileSize;
-        const std::shared_ptr<const ObfInfo>& obfInfo;
+        // Information that is already known about this file: either read by ObfReader, or obtained from cache.
+        // Information from cache is materialized only on first request. Returns nullptr if nothing is known yet.
+        std::shared_ptr<const ObfInfo> obtainInfo() const;
+        // Summary is either read from cache or built along with information, so it's obtained without decoding
+        // anything and without locking. Returns nullptr if nothing is known yet.
+        std::shared_ptr<const Summary> getSummary() const;
 
         const QString getRegionName() const;
 
@@ -83,6 +83,8 @@ namespace OsmAnd
 
             OsmAnd__ObfMapSectionReader_Metrics__Metric_loadMapObjects__FIELDS(EMIT_METRIC_FIELD);
 
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
             virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
         };
     }
@@ -68,6 +68,8 @@ namespace OsmAnd
 
             OsmAnd__ObfRoutingSectionReader_Metrics__Metric_loadRoads__FIELDS(EMIT_METRIC_FIELD);
 
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
             virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
         };
     }
@@ -5,6 +5,10 @@
 #include <new>
 
 #include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QList>
+#include <OsmAndCore/restore_internal_warnings.h>
 
 #include <OsmAndCore.h>
 
@@ -13,6 +17,32 @@ namespace OsmAnd
     class OSMAND_CORE_API IMemoryManager
     {
         Q_DISABLE_COPY_AND_MOVE(IMemoryManager);
+    public:
+        struct OSMAND_CORE_API TagStatistics Q_DECL_FINAL
+        {
+            TagStatistics();
+
+            QString tag;
+            int64_t liveBytes;
+            int64_t peakBytes;
+            uint64_t allocationsCount;
+        };
+
+        struct OSMAND_CORE_API Statistics Q_DECL_FINAL
+        {
+            Statistics();
+
+            // Per-tag counters are flushed from threads in batches, so they may lag behind by few dozens of KB
+            QList<TagStatistics> tags;
+            int64_t liveBytes;
+            int64_t peakBytes;
+            uint64_t pooledAllocationsCount;
+            uint64_t largeAllocationsCount;
+            size_t poolsReservedBytes;
+
+            QString toString(const QString& prefix = QString::null) const;
+        };
+
     private:
     protected:
         IMemoryManager();
@@ -21,9 +51,37 @@ namespace OsmAnd
 
         virtual void* allocate(std::size_t size, const char* tag) = 0;
         virtual void free(void* ptr, const char* tag) = 0;
+
+        virtual Statistics getStatistics() const;
+        virtual void resetPeaks();
+        // Returns pooled memory that is not in use to system, e.g. on low-memory warning
+        virtual void releaseUnusedMemory();
     };
 
-    IMemoryManager* getMemoryManager();
+    OSMAND_CORE_API IMemoryManager* OSMAND_CORE_CALL getMemoryManager();
+
+    // Tag that is used by global operator new on calling thread. Tag has to be a string with static storage duration.
+    OSMAND_CORE_API const char* OSMAND_CORE_CALL getCurrentThreadMemoryTag();
+    OSMAND_CORE_API const char* OSMAND_CORE_CALL setCurrentThreadMemoryTag(const char* const tag);
+
+    // Attributes all global allocations made by current thread within scope to given tag
+    struct MemoryTagScope Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(MemoryTagScope);
+
+        inline MemoryTagScope(const char* const tag)
+            : _previousTag(setCurrentThreadMemoryTag(tag))
+        {
+        }
+
+        inline ~MemoryTagScope()
+        {
+            setCurrentThreadMemoryTag(_previousTag);
+        }
+
+    private:
+        const char* const _previousTag;
+    };
 }
 
 #endif // !defined(_OSMAND_CORE_I_MEMORY_MANAGER_H_)
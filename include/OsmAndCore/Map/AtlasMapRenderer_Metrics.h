@@ -30,11 +30,21 @@ namespace OsmAnd
         FIELD_ACTION(float, elapsedTimeForObtainingRenderableSymbols, "s");                                     \
         FIELD_ACTION(float, elapsedTimeForObtainingRenderableSymbolsWithLock, "s");                             \
         FIELD_ACTION(float, elapsedTimeForObtainingRenderableSymbolsOnlyLock, "s");                             \
+        FIELD_ACTION(float, elapsedTimeForParallelSymbolsPreparation, "s");                                     \
+        FIELD_ACTION(unsigned int, symbolsPreparationThreads, "");                                              \
         FIELD_ACTION(float, elapsedTimeForObtainRenderableSymbolCalls, "s");                                    \
         FIELD_ACTION(unsigned int, obtainRenderableSymbolCalls, "");                                            \
         FIELD_ACTION(unsigned int, onPathSymbolsRejectedByFrustum, "");                                         \
         FIELD_ACTION(unsigned int, onSurfaceSymbolsRejectedByFrustum, "");                                      \
         FIELD_ACTION(unsigned int, billboardSymbolsRejectedByFrustum, "");                                      \
+        FIELD_ACTION(unsigned int, onPathPathsReused, "");                                                      \
+        FIELD_ACTION(unsigned int, onPathPathsTranslated, "");                                                  \
+        FIELD_ACTION(unsigned int, onPathPathsComputed, "");                                                    \
+        FIELD_ACTION(unsigned int, onPathSymbolsPlacementsReused, "");                                          \
+        FIELD_ACTION(unsigned int, onPathSymbolsPlacementsComputed, "");                                        \
+        FIELD_ACTION(float, onPathSymbolsPlacementsReuseRatio, "");                                             \
+        FIELD_ACTION(float, elapsedTimeForComputingOnPathSymbolsPlacements, "s");                               \
+        FIELD_ACTION(float, estimatedTimeSavedByOnPathSymbolsPlacementsReuse, "s");                             \
         FIELD_ACTION(float, elapsedTimeForPlotSymbolCalls, "s");                                                \
         FIELD_ACTION(unsigned int, plotSymbolCalls, "");                                                        \
         FIELD_ACTION(unsigned int, plotSymbolCallsSucceeded, "");                                               \
@@ -55,6 +65,8 @@ namespace OsmAnd
         FIELD_ACTION(unsigned int, addToIntersectionsCalls, "");                                                \
         FIELD_ACTION(unsigned int, acceptedByAddToIntersections, "");                                           \
         FIELD_ACTION(unsigned int, rejectedByAddToIntersections, "");                                           \
+        FIELD_ACTION(unsigned int, symbolsPlacementsReused, "");                                                \
+        FIELD_ACTION(unsigned int, symbolsPlacementsComputed, "");                                              \
         FIELD_ACTION(float, elapsedTimeForSymbolsPresentationModeCheck, "s");                                   \
         FIELD_ACTION(float, elapsedTimeForBillboardSymbolsRendering, "s");                                      \
         FIELD_ACTION(unsigned int, billboardSymbolsRendered, "");                                               \
@@ -62,6 +74,9 @@ namespace OsmAnd
         FIELD_ACTION(unsigned int, onPathSymbolsRendered, "");                                                  \
         FIELD_ACTION(float, elapsedTimeForOnSurfaceSymbolsRendering, "s");                                      \
         FIELD_ACTION(unsigned int, onSurfaceSymbolsRendered, "");                                               \
+        FIELD_ACTION(unsigned int, symbolsDrawCalls, "");                                                       \
+        FIELD_ACTION(unsigned int, symbolsTextureBinds, "");                                                    \
+        FIELD_ACTION(float, elapsedTimeForSymbolsSubmission, "s");                                              \
                                                                                                                 \
         /* Time elapsed for debug stage */                                                                      \
         FIELD_ACTION(float, elapsedTimeForDebugStage, "s");                                                     \
@@ -76,8 +91,13 @@ namespace OsmAnd
             virtual ~Metric_renderFrame();
             virtual void reset();
 
+            // Adds values of all fields of other metric to this one
+            void accumulate(const Metric_renderFrame& other);
+
             OsmAnd__AtlasMapRenderer_Metrics__Metric_renderFrame__FIELDS(EMIT_METRIC_FIELD);
 
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
             virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
         };
     }
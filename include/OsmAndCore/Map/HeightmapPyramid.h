@@ -0,0 +1,98 @@
+#ifndef _OSMAND_CORE_HEIGHTMAP_PYRAMID_H_
+#define _OSMAND_CORE_HEIGHTMAP_PYRAMID_H_
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/PrivateImplementation.h>
+
+namespace OsmAnd
+{
+    // Heightmap tiles of all zoom levels stored in single file that is memory-mapped as is: fixed-size tiles
+    // follow header, and sorted table of tile offsets is at the end of file. Tiles are looked up by binary search
+    // over that table, and float tiles are returned as pointers into mapped memory.
+    class HeightmapPyramid_P;
+    class OSMAND_CORE_API HeightmapPyramid Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(HeightmapPyramid);
+    public:
+        enum class SampleType : uint32_t
+        {
+            // Heights in whole meters, half the size of float tiles but converted on each read
+            Int16 = 0,
+
+            // Heights in meters, read without any copy
+            Float32 = 1,
+        };
+
+        static const char Magic[4];
+        enum : uint32_t
+        {
+            Version = 1,
+        };
+
+    private:
+        PrivateImplementation<HeightmapPyramid_P> _p;
+    protected:
+    public:
+        HeightmapPyramid(const QString& filePath);
+        ~HeightmapPyramid();
+
+        const QString filePath;
+
+        bool isOpened() const;
+        uint32_t getTileSize() const;
+        SampleType getSampleType() const;
+        ZoomLevel getMinZoom() const;
+        ZoomLevel getMaxZoom() const;
+        unsigned int getTilesCount() const;
+
+        // Returns pointer to tileSize*tileSize samples of given tile in mapped file, or nullptr if there's no such
+        // tile. Pointer is valid as long as this pyramid exists.
+        const void* getTileData(const TileId tileId, const ZoomLevel zoom) const;
+
+        // Returns pointer to float heights of tile if they are stored as floats, nullptr otherwise
+        const float* getFloatTileData(const TileId tileId, const ZoomLevel zoom) const;
+
+        // Copies heights of tile into buffer of tileSize*tileSize floats, converting them if needed
+        bool obtainTile(const TileId tileId, const ZoomLevel zoom, float* const outHeights) const;
+    };
+
+    // Writes tiles into new heightmap pyramid file. Tiles may be added in any order, since offsets table is sorted
+    // when pyramid is finished.
+    class HeightmapPyramidBuilder_P;
+    class OSMAND_CORE_API HeightmapPyramidBuilder Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(HeightmapPyramidBuilder);
+    private:
+        PrivateImplementation<HeightmapPyramidBuilder_P> _p;
+    protected:
+    public:
+        HeightmapPyramidBuilder(
+            const QString& filePath,
+            const uint32_t tileSize,
+            const HeightmapPyramid::SampleType sampleType = HeightmapPyramid::SampleType::Float32);
+        ~HeightmapPyramidBuilder();
+
+        const QString filePath;
+        const uint32_t tileSize;
+        const HeightmapPyramid::SampleType sampleType;
+
+        bool isOpened() const;
+        unsigned int getTilesCount() const;
+
+        // Heights are tileSize*tileSize floats in meters
+        bool addTile(const TileId tileId, const ZoomLevel zoom, const float* const heights);
+
+        // Writes offsets table and header. Nothing can be added after that.
+        bool finish();
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_HEIGHTMAP_PYRAMID_H_)
@@ -11,6 +11,7 @@
 #include <OsmAndCore/CommonTypes.h>
 #include <OsmAndCore/PrivateImplementation.h>
 #include <OsmAndCore/Map/IMapElevationDataProvider.h>
+#include <OsmAndCore/Map/HeightmapPyramid.h>
 
 namespace OsmAnd
 {
@@ -24,13 +25,21 @@ namespace OsmAnd
     protected:
     public:
         HeightmapTileProvider(const QString& dataPath, const QString& indexFilename = QString::null);
+        HeightmapTileProvider(const std::shared_ptr<const HeightmapPyramid>& pyramid);
         virtual ~HeightmapTileProvider();
 
         const QString dataPath;
         const QString indexFilename;
+        const std::shared_ptr<const HeightmapPyramid> pyramid;
 
         void rebuildTileDbIndex();
 
+        // Writes all tiles of TileDB into heightmap pyramid that can be served by this provider without decoding
+        bool convertToHeightmapPyramid(
+            const QString& outputFilePath,
+            const HeightmapPyramid::SampleType sampleType = HeightmapPyramid::SampleType::Float32,
+            unsigned int* const pOutTilesCount = nullptr);
+
         virtual ZoomLevel getMinZoom() const;
         virtual ZoomLevel getMaxZoom() const;
         virtual uint32_t getTileSize() const;
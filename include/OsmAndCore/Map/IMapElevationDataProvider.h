@@ -4,9 +4,13 @@
 #include <OsmAndCore/stdlib_common.h>
 
 #include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QVector>
+#include <OsmAndCore/restore_internal_warnings.h>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/IQueryController.h>
 #include <OsmAndCore/Map/IMapTiledDataProvider.h>
 
 namespace OsmAnd
@@ -27,11 +31,20 @@ namespace OsmAnd
                 const size_t rowLength,
                 const uint32_t size,
                 const float* const pRawData);
+            // Raw data is owned by holder instead of being deleted with this data, e.g. when it's mapped from file
+            Data(
+                const TileId tileId,
+                const ZoomLevel zoom,
+                const size_t rowLength,
+                const uint32_t size,
+                const float* const pRawData,
+                const std::shared_ptr<const void>& rawDataHolder);
             virtual ~Data();
 
             const size_t rowLength;
             const uint32_t size;
             const float* pRawData;
+            const std::shared_ptr<const void> rawDataHolder;
         };
 
     private:
@@ -46,6 +59,16 @@ namespace OsmAnd
             const Request& request,
             std::shared_ptr<Data>& outElevationData,
             std::shared_ptr<Metric>* const pOutMetric = nullptr);
+
+        // Samples heights in meters at given 31-bit points using bilinear interpolation over tiles of given zoom.
+        // Points are grouped by tile so every tile is obtained once, and sampled in parallel chunks. Points without
+        // elevation data get NaN. If requested, slopes are returned in degrees.
+        virtual bool obtainElevations(
+            const QVector<PointI>& points31,
+            const ZoomLevel zoom,
+            QVector<float>& outHeights,
+            QVector<float>* const pOutSlopes = nullptr,
+            const std::shared_ptr<const IQueryController>& queryController = nullptr);
     };
 }
 
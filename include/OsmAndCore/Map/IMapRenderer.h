@@ -126,6 +126,8 @@ namespace OsmAnd
 
         virtual bool setStubsStyle(const MapStubStyle style, bool forcedUpdate = false) = 0;
 
+        virtual void setPrefetchHint(const MapPrefetchHint& hint) = 0;
+
         virtual std::shared_ptr<MapRendererDebugSettings> getDebugSettings() const = 0;
         virtual void setDebugSettings(const std::shared_ptr<const MapRendererDebugSettings>& debugSettings) = 0;
 
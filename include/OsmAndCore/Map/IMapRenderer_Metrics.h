@@ -31,6 +31,8 @@ namespace OsmAnd
 
             OsmAnd__IMapRenderer_Metrics__Metric_update__FIELDS(EMIT_METRIC_FIELD);
             
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
             virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
         };
 
@@ -45,6 +47,8 @@ namespace OsmAnd
 
             OsmAnd__IMapRenderer_Metrics__Metric_prepareFrame__FIELDS(EMIT_METRIC_FIELD);
 
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
             virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
         };
 
@@ -59,6 +63,8 @@ namespace OsmAnd
 
             OsmAnd__IMapRenderer_Metrics__Metric_renderFrame__FIELDS(EMIT_METRIC_FIELD);
 
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
             virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
         };
     }
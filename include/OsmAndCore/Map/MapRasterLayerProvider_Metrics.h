@@ -23,8 +23,13 @@ namespace OsmAnd
             virtual ~Metric_obtainData();
             virtual void reset();
 
+            // Adds values of all fields of other metric to this one
+            void accumulate(const Metric_obtainData& other);
+
             OsmAnd__MapRasterLayerProvider_Metrics__Metric_obtainData__FIELDS(EMIT_METRIC_FIELD);
 
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
             virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
         };
     }
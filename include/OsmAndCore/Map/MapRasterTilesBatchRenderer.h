@@ -0,0 +1,127 @@
+#ifndef _OSMAND_CORE_MAP_RASTER_TILES_BATCH_RENDERER_H_
+#define _OSMAND_CORE_MAP_RASTER_TILES_BATCH_RENDERER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <functional>
+#include <array>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QVector>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/PrivateImplementation.h>
+
+namespace OsmAnd
+{
+    class IMapObjectsProvider;
+    class MapPrimitiviser;
+    class IQueryController;
+
+    class MapRasterTilesBatchRenderer_P;
+    class OSMAND_CORE_API MapRasterTilesBatchRenderer Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(MapRasterTilesBatchRenderer);
+    public:
+        enum class OutputFormat
+        {
+            DirectoryTree,
+            MBTiles
+        };
+
+        enum class Stage
+        {
+            Fetch = 0,
+            Primitivise,
+            Rasterize,
+            Encode,
+            Write,
+
+            __LAST
+        };
+        enum {
+            StagesCount = static_cast<unsigned int>(Stage::__LAST)
+        };
+
+        struct OSMAND_CORE_API Configuration Q_DECL_FINAL
+        {
+            Configuration();
+
+            AreaI bbox31;
+            ZoomLevel minZoom;
+            ZoomLevel maxZoom;
+            unsigned int tileSize;
+            bool fillBackground;
+
+            QString outputPath;
+            OutputFormat outputFormat;
+
+            // Number of threads in each stage pool. Write stage always uses single thread
+            std::array<unsigned int, StagesCount> threadsCount;
+
+            // Maximal number of tiles that may be waiting in front of each stage
+            unsigned int maxQueueDepth;
+
+            // Number of tiles written to MBTiles in a single transaction
+            unsigned int writeBatchSize;
+        };
+
+        struct OSMAND_CORE_API StageStatistics Q_DECL_FINAL
+        {
+            StageStatistics();
+
+            unsigned int threadsCount;
+            unsigned int processedTilesCount;
+            float busyTime;
+            unsigned int queueDepth;
+            unsigned int maxQueueDepth;
+
+            float getTilesPerSecond(const float wallTime) const;
+        };
+
+        struct OSMAND_CORE_API Statistics Q_DECL_FINAL
+        {
+            Statistics();
+
+            unsigned int totalTilesCount;
+            unsigned int scheduledTilesCount;
+            unsigned int writtenTilesCount;
+            unsigned int emptyTilesCount;
+            unsigned int failedTilesCount;
+            float elapsedTime;
+            std::array<StageStatistics, StagesCount> stages;
+
+            QString toString(const QString& prefix = QString::null) const;
+        };
+
+        typedef std::function<void (const Statistics& statistics)> ProgressCallback;
+
+    private:
+        PrivateImplementation<MapRasterTilesBatchRenderer_P> _p;
+    protected:
+    public:
+        MapRasterTilesBatchRenderer(
+            const std::shared_ptr<IMapObjectsProvider>& mapObjectsProvider,
+            const std::shared_ptr<MapPrimitiviser>& primitiviser,
+            const Configuration& configuration);
+        virtual ~MapRasterTilesBatchRenderer();
+
+        const std::shared_ptr<IMapObjectsProvider> mapObjectsProvider;
+        const std::shared_ptr<MapPrimitiviser> primitiviser;
+        const Configuration configuration;
+
+        bool render(
+            const ProgressCallback progressCallback = nullptr,
+            const float progressInterval = 1.0f,
+            const std::shared_ptr<const IQueryController>& queryController = nullptr);
+        Statistics getStatistics() const;
+
+        static QVector<TileId> enumerateTilesInHilbertOrder(const AreaI bbox31, const ZoomLevel zoom);
+        static QString getStageName(const Stage stage);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_MAP_RASTER_TILES_BATCH_RENDERER_H_)
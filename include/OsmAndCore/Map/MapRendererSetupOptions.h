@@ -88,10 +88,37 @@ namespace OsmAnd
         }
 #endif // !defined(SWIG)
 
+        // Limit of bytes uploaded to GPU during single frame, when uploads are done on render thread.
+        // 0 means "unlimited". At least one resource is uploaded per frame regardless of this limit.
+        unsigned int maxGpuUploadBytesPerFrame;
+#if !defined(SWIG)
+        inline MapRendererSetupOptions& setMaxGpuUploadBytesPerFrame(
+            const unsigned int newMaxGpuUploadBytesPerFrame)
+        {
+            maxGpuUploadBytesPerFrame = newMaxGpuUploadBytesPerFrame;
+
+            return *this;
+        }
+#endif // !defined(SWIG)
+
+        // Limit of time (in milliseconds) spent on uploads to GPU during single frame, when uploads are done on
+        // render thread. 0 means "unlimited"
+        float maxGpuUploadTimePerFrame;
+#if !defined(SWIG)
+        inline MapRendererSetupOptions& setMaxGpuUploadTimePerFrame(
+            const float newMaxGpuUploadTimePerFrame)
+        {
+            maxGpuUploadTimePerFrame = newMaxGpuUploadTimePerFrame;
+
+            return *this;
+        }
+#endif // !defined(SWIG)
+
         inline bool isValid() const
         {
             return
-                (displayDensityFactor > 0.0f);
+                (displayDensityFactor > 0.0f) &&
+                (maxGpuUploadTimePerFrame >= 0.0f);
         }
     };
 }
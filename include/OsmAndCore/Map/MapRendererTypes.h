@@ -174,6 +174,36 @@ namespace OsmAnd
                 color != r.color;
         }
     };
+
+    // Describes where map is heading, as reported by whoever moves it (e.g. MapAnimator). Renderer uses it to
+    // request resources along predicted path and at destination before they become visible.
+    struct MapPrefetchHint Q_DECL_FINAL
+    {
+        MapPrefetchHint()
+            : hasDestination(false)
+            , destinationZoom(0.0f)
+            , timeLeft(0.0f)
+        {
+        }
+
+        // Target at the moment hint was made
+        PointI target31;
+
+        // Target velocity in 31-coordinates per second
+        PointD targetVelocity31;
+
+        bool hasDestination;
+        PointI destinationTarget31;
+        float destinationZoom;
+
+        // Time in seconds until map comes to rest
+        float timeLeft;
+
+        inline bool isValid() const
+        {
+            return (timeLeft > 0.0f);
+        }
+    };
 }
 
 #endif // !defined(_OSMAND_CORE_MAP_RENDERER_TYPES_H_)
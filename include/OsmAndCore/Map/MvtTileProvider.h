@@ -0,0 +1,98 @@
+#ifndef _OSMAND_CORE_MVT_TILE_PROVIDER_H_
+#define _OSMAND_CORE_MVT_TILE_PROVIDER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QByteArray>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/PrivateImplementation.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/Map/IMapTiledDataProvider.h>
+#include <OsmAndCore/Map/MapPrimitivesProvider.h>
+
+namespace OsmAnd
+{
+    // Encodes primitivised map objects of tile as Mapbox Vector Tile (version 2), so that styling can be done by
+    // client instead of rasterizing tile here. Each primitive becomes feature in layer named after tag that
+    // primitive was matched by (e.g. "highway"), with all tags and captions of source object as attributes.
+    class MvtTileProvider_P;
+    class OSMAND_CORE_API MvtTileProvider : public IMapTiledDataProvider
+    {
+        Q_DISABLE_COPY_AND_MOVE(MvtTileProvider);
+    public:
+        struct OSMAND_CORE_API Configuration Q_DECL_FINAL
+        {
+            Configuration();
+
+            // Size of tile side in MVT coordinates
+            unsigned int extent;
+
+            // Geometry is clipped to tile grown by this many MVT coordinates on each side
+            unsigned int buffer;
+
+            // Douglas-Peucker tolerance in MVT coordinates, applied on zooms below full detail zoom
+            float simplificationTolerance;
+            ZoomLevel fullDetailZoom;
+
+            bool includeCaptions;
+        };
+
+        class OSMAND_CORE_API Data : public IMapTiledDataProvider::Data
+        {
+            Q_DISABLE_COPY_AND_MOVE(Data);
+        private:
+        protected:
+        public:
+            Data(
+                const TileId tileId,
+                const ZoomLevel zoom,
+                const QByteArray& encodedTile,
+                const unsigned int layersCount,
+                const unsigned int featuresCount,
+                const RetainableCacheMetadata* const pRetainableCacheMetadata = nullptr);
+            virtual ~Data();
+
+            QByteArray encodedTile;
+            unsigned int layersCount;
+            unsigned int featuresCount;
+        };
+
+    private:
+        PrivateImplementation<MvtTileProvider_P> _p;
+    protected:
+    public:
+        MvtTileProvider(
+            const std::shared_ptr<MapPrimitivesProvider>& primitivesProvider,
+            const Configuration& configuration = Configuration());
+        virtual ~MvtTileProvider();
+
+        const std::shared_ptr<MapPrimitivesProvider> primitivesProvider;
+        const Configuration configuration;
+
+        virtual ZoomLevel getMinZoom() const;
+        virtual ZoomLevel getMaxZoom() const;
+
+        // Empty tile (nothing left after clipping) is reported as success with no data
+        virtual bool obtainTiledMvt(
+            const Request& request,
+            std::shared_ptr<Data>& outMvtTile);
+
+        virtual bool supportsNaturalObtainData() const Q_DECL_OVERRIDE;
+        virtual bool obtainData(
+            const IMapDataProvider::Request& request,
+            std::shared_ptr<IMapDataProvider::Data>& outData,
+            std::shared_ptr<Metric>* const pOutMetric = nullptr) Q_DECL_OVERRIDE;
+
+        virtual bool supportsNaturalObtainDataAsync() const Q_DECL_OVERRIDE;
+        virtual void obtainDataAsync(
+            const IMapDataProvider::Request& request,
+            const IMapDataProvider::ObtainDataAsyncCallback callback,
+            const bool collectMetric = false) Q_DECL_OVERRIDE;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_MVT_TILE_PROVIDER_H_)
@@ -16,6 +16,7 @@
 #include <OsmAndCore/Map/MapCommonTypes.h>
 #include <OsmAndCore/Map/IRasterMapLayerProvider.h>
 #include <OsmAndCore/Map/IOnlineTileSources.h>
+#include <OsmAndCore/Map/SqliteTilesCache.h>
 
 namespace OsmAnd
 {
@@ -55,6 +56,10 @@ namespace OsmAnd
         void setLocalCachePath(const QString& localCachePath, const bool appendPathSuffix = true);
         const QString& localCachePath;
 
+        // When set, tiles are kept in given single-file cache instead of files under local cache path
+        void setLocalCache(const std::shared_ptr<SqliteTilesCache>& localCache);
+        std::shared_ptr<SqliteTilesCache> getLocalCache() const;
+
         void setNetworkAccessPermission(bool allowed);
         const bool& networkAccessAllowed;
 
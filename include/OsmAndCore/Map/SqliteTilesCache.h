@@ -0,0 +1,85 @@
+#ifndef _OSMAND_CORE_SQLITE_TILES_CACHE_H_
+#define _OSMAND_CORE_SQLITE_TILES_CACHE_H_
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/PrivateImplementation.h>
+
+namespace OsmAnd
+{
+    // Single-file tile cache, stored as MBTiles-compatible SQLite database in WAL mode. Tiles are written in batches
+    // by background writer thread, and least recently used tiles are evicted once cache grows over size limit.
+    // Empty tile data is valid, and means that tile is known to not exist.
+    class SqliteTilesCache_P;
+    class OSMAND_CORE_API SqliteTilesCache Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(SqliteTilesCache);
+    public:
+        enum : unsigned int
+        {
+            DefaultWriteBatchSize = 64,
+        };
+
+        struct OSMAND_CORE_API Statistics Q_DECL_FINAL
+        {
+            Statistics();
+
+            uint64_t size;
+            unsigned int tilesCount;
+            unsigned int hitsCount;
+            unsigned int missesCount;
+            unsigned int writtenTilesCount;
+            unsigned int evictedTilesCount;
+        };
+
+    private:
+        PrivateImplementation<SqliteTilesCache_P> _p;
+    protected:
+    public:
+        // Zero maximal size means no limit
+        SqliteTilesCache(const QString& filePath, const uint64_t maxSize = 0);
+        virtual ~SqliteTilesCache();
+
+        const QString filePath;
+
+        bool isOpened() const;
+
+        uint64_t getMaxSize() const;
+        void setMaxSize(const uint64_t maxSize);
+
+        unsigned int getWriteBatchSize() const;
+        void setWriteBatchSize(const unsigned int writeBatchSize);
+
+        // Returns false if tile is not in cache. Expired tiles are returned as well, so that caller is able to use
+        // them when there's no way to obtain fresh ones.
+        bool obtainTile(
+            const TileId tileId,
+            const ZoomLevel zoom,
+            QByteArray& outData,
+            bool* const pOutExpired = nullptr) const;
+
+        // Invalid expiration time means that tile never expires
+        void storeTile(
+            const TileId tileId,
+            const ZoomLevel zoom,
+            const QByteArray& data,
+            const QDateTime& expirationTime = QDateTime());
+        void removeTile(const TileId tileId, const ZoomLevel zoom);
+
+        // Blocks until everything that was stored or removed before is written to database
+        void flush();
+
+        Statistics getStatistics() const;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_SQLITE_TILES_CACHE_H_)
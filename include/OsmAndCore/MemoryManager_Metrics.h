@@ -0,0 +1,55 @@
+#ifndef _OSMAND_CORE_MEMORY_MANAGER_METRICS_H_
+#define _OSMAND_CORE_MEMORY_MANAGER_METRICS_H_
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QList>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/Metrics.h>
+#include <OsmAndCore/IMemoryManager.h>
+
+namespace OsmAnd
+{
+    namespace MemoryManager_Metrics
+    {
+#define OsmAnd__MemoryManager_Metrics__Metric_memoryUsage__FIELDS(FIELD_ACTION)                 \
+        /* Bytes currently allocated through memory manager (including block headers) */       \
+        FIELD_ACTION(int64_t, liveBytes, "B");                                                  \
+                                                                                                \
+        /* Peak of live bytes since start or since peaks were reset */                          \
+        FIELD_ACTION(int64_t, peakBytes, "B");                                                  \
+                                                                                                \
+        /* Bytes requested from system for size-class pools */                                  \
+        FIELD_ACTION(int64_t, poolsReservedBytes, "B");                                         \
+                                                                                                \
+        /* Number of allocations served from size-class pools */                                \
+        FIELD_ACTION(uint64_t, pooledAllocations, "");                                          \
+                                                                                                \
+        /* Number of allocations passed directly to system allocator */                         \
+        FIELD_ACTION(uint64_t, largeAllocations, "");
+        struct OSMAND_CORE_API Metric_memoryUsage : public Metric
+        {
+            Metric_memoryUsage();
+            virtual ~Metric_memoryUsage();
+            virtual void reset();
+
+            OsmAnd__MemoryManager_Metrics__Metric_memoryUsage__FIELDS(EMIT_METRIC_FIELD);
+
+            // Per-tag (per-subsystem) live and peak bytes
+            QList<IMemoryManager::TagStatistics> tags;
+
+            void capture(const IMemoryManager* const memoryManager = getMemoryManager());
+
+            virtual void visitFields(const FieldsVisitor visitor) const;
+
+            virtual QString toString(const bool shortFormat = false, const QString& prefix = QString::null) const;
+        };
+    }
+}
+
+#endif // !defined(_OSMAND_CORE_MEMORY_MANAGER_METRICS_H_)
@@ -3,6 +3,8 @@
 
 #include <OsmAndCore/stdlib_common.h>
 #include <typeinfo>
+#include <functional>
+#include <type_traits>
 
 #include <OsmAndCore/QtExtensions.h>
 #include <OsmAndCore/ignore_warnings_on_external_includes.h>
@@ -18,6 +20,10 @@
     type name
 #define RESET_METRIC_FIELD(type, name, measurement)                                                                             \
     name = 0
+#define ACCUMULATE_METRIC_FIELD(type, name, measurement)                                                                        \
+    name += other.name
+#define VISIT_METRIC_FIELD(type, name, measurement)                                                                             \
+    visitor(#name, static_cast<double>(name), measurement, std::is_floating_point<type>::value)
 #define PRINT_METRIC_FIELD(type, name, measurement)                                                                             \
     output +=                                                                                                                   \
         (output.isEmpty() ? QString() : QString(QLatin1String("\n"))) +                                                         \
@@ -28,10 +34,19 @@ namespace OsmAnd
 {
     struct OSMAND_CORE_API Metric
     {
+        typedef std::function<void (
+            const char* const name,
+            const double value,
+            const char* const measurement,
+            const bool isFractional)> FieldsVisitor;
+
         Metric();
         virtual ~Metric();
         virtual void reset();
 
+        // Visits own fields of metric (not of submetrics), measurement is "s" for time fields
+        virtual void visitFields(const FieldsVisitor visitor) const;
+
         QList< Ref<Metric> > submetrics;
 
         void addSubmetric(const std::shared_ptr<Metric>& submetric);
@@ -0,0 +1,232 @@
+#ifndef _OSMAND_CORE_METRICS_REGISTRY_H_
+#define _OSMAND_CORE_METRICS_REGISTRY_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <atomic>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QPair>
+#include <QMutex>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/PrivateImplementation.h>
+#include <OsmAndCore/Metrics.h>
+#include <OsmAndCore/Stopwatch.h>
+
+namespace OsmAnd
+{
+    // Process-wide registry of named counters, gauges and latency histograms that aggregates measurements across
+    // calls and threads. Recording never takes a lock: every value is striped across per-thread slots and
+    // merged only when snapshot is taken.
+    class MetricsRegistry_P;
+    class OSMAND_CORE_API MetricsRegistry
+    {
+        Q_DISABLE_COPY_AND_MOVE(MetricsRegistry);
+    public:
+        enum : unsigned int
+        {
+            StripesCount = 8,
+
+            // HDR-style log-linear buckets over microseconds: values below 32us have exact buckets, each following
+            // power-of-two range is split into 16 sub-buckets (~6% relative error), up to ~2.4 hours
+            HistogramSubBucketsCount = 16,
+            HistogramBucketsCount = HistogramSubBucketsCount * 30,
+        };
+
+        enum class ExportFormat
+        {
+            Prometheus,
+            Json,
+        };
+
+        class OSMAND_CORE_API Counter Q_DECL_FINAL
+        {
+            Q_DISABLE_COPY_AND_MOVE(Counter);
+        private:
+            // Padded to cache line, so that threads don't contend on neighbour stripes
+            struct Stripe
+            {
+                std::atomic<uint64_t> value;
+                uint8_t padding[64 - sizeof(std::atomic<uint64_t>)];
+            };
+            Stripe _stripes[StripesCount];
+        public:
+            Counter(const QString& name);
+            ~Counter();
+
+            const QString name;
+
+            void add(const uint64_t value = 1);
+            uint64_t getValue() const;
+            void reset();
+        };
+
+        class OSMAND_CORE_API Gauge Q_DECL_FINAL
+        {
+            Q_DISABLE_COPY_AND_MOVE(Gauge);
+        private:
+            std::atomic<double> _value;
+        public:
+            Gauge(const QString& name);
+            ~Gauge();
+
+            const QString name;
+
+            void set(const double value);
+            double getValue() const;
+        };
+
+        struct OSMAND_CORE_API HistogramSnapshot Q_DECL_FINAL
+        {
+            HistogramSnapshot();
+
+            QString name;
+            uint64_t count;
+            double sum;
+            double max;
+            QVector<uint64_t> buckets;
+
+            double getMean() const;
+            double getQuantile(const double quantile) const;
+        };
+
+        class OSMAND_CORE_API Histogram Q_DECL_FINAL
+        {
+            Q_DISABLE_COPY_AND_MOVE(Histogram);
+        private:
+            struct Stripe
+            {
+                std::atomic<uint64_t> count;
+                std::atomic<uint64_t> sumInMicroseconds;
+                std::atomic<uint64_t> maxInMicroseconds;
+                std::atomic<uint64_t> buckets[HistogramBucketsCount];
+            };
+            Stripe _stripes[StripesCount];
+        public:
+            Histogram(const QString& name);
+            ~Histogram();
+
+            const QString name;
+
+            void record(const float seconds);
+            HistogramSnapshot getSnapshot() const;
+            void reset();
+
+            static unsigned int getBucketIndex(const uint64_t microseconds);
+            static uint64_t getBucketLowerBound(const unsigned int bucketIndex);
+            static uint64_t getBucketUpperBound(const unsigned int bucketIndex);
+        };
+
+        // Records time elapsed since construction to histogram on destruction
+        class ScopedTimer Q_DECL_FINAL
+        {
+            Q_DISABLE_COPY_AND_MOVE(ScopedTimer);
+        private:
+            Histogram* const _histogram;
+            const Stopwatch _stopwatch;
+        public:
+            inline ScopedTimer(Histogram* const histogram)
+                : _histogram(histogram)
+                , _stopwatch(histogram != nullptr)
+            {
+            }
+
+            // Histogram is expected to be obtained once and kept by caller, so that timing doesn't look it up by name
+            inline ScopedTimer(const MetricsRegistry& registry, Histogram* const histogram)
+                : _histogram(registry.isEnabled() ? histogram : nullptr)
+                , _stopwatch(_histogram != nullptr)
+            {
+            }
+
+            inline ~ScopedTimer()
+            {
+                if (_histogram)
+                    _histogram->record(_stopwatch.elapsed());
+            }
+        };
+
+        // Folds metrics of one type into registry like recordMetric() does, but resolves entries for fields only once,
+        // so that recording doesn't build names or look them up. Has to be used with metrics of single type only.
+        class OSMAND_CORE_API MetricRecorder Q_DECL_FINAL
+        {
+            Q_DISABLE_COPY_AND_MOVE(MetricRecorder);
+        private:
+            struct FieldEntries
+            {
+                Counter* counter;
+                Gauge* gauge;
+                Histogram* histogram;
+            };
+            QMutex _resolveMutex;
+            std::atomic<bool> _resolved;
+            QVector<FieldEntries> _fieldsEntries;
+
+            void resolve(const Metric& metric);
+        public:
+            MetricRecorder(MetricsRegistry& registry, const QString& name);
+            ~MetricRecorder();
+
+            MetricsRegistry& registry;
+            const QString name;
+
+            void record(const Metric& metric);
+        };
+
+        struct OSMAND_CORE_API Snapshot Q_DECL_FINAL
+        {
+            Snapshot();
+
+            QList< QPair<QString, uint64_t> > counters;
+            QList< QPair<QString, double> > gauges;
+            QList<HistogramSnapshot> histograms;
+
+            QString toPrometheusText() const;
+            QString toJson() const;
+        };
+
+    private:
+        PrivateImplementation<MetricsRegistry_P> _p;
+    protected:
+    public:
+        MetricsRegistry();
+        virtual ~MetricsRegistry();
+
+        // Registry is disabled by default, so nothing is recorded until it's enabled
+        bool isEnabled() const;
+        void setEnabled(const bool enabled);
+
+        // Returned entries live as long as registry itself, so callers may keep them.
+        // Counter names are expected to end with "_total", otherwise it's appended on export to Prometheus.
+        Counter* obtainCounter(const QString& name);
+        Gauge* obtainGauge(const QString& name);
+        Histogram* obtainHistogram(const QString& name);
+
+        void incrementCounter(const QString& name, const uint64_t value = 1);
+        void setGauge(const QString& name, const double value);
+        void recordLatency(const QString& name, const float seconds);
+
+        // Folds own fields of metric into registry as "<name>.<field>": time fields go to histograms,
+        // byte-sized and fractional fields to gauges, and everything else to counters (named "<name>.<field>_total")
+        void recordMetric(const QString& name, const Metric& metric);
+
+        Snapshot takeSnapshot() const;
+        void reset();
+
+        QString exportSnapshot(const ExportFormat format) const;
+        bool exportToFile(const QString& fileName, const ExportFormat format) const;
+
+        // Serves snapshot to every client that connects to given port on loopback interface.
+        // Plain HTTP response is sent, so Prometheus is able to scrape it directly.
+        bool startExportServer(const uint16_t port, const ExportFormat format = ExportFormat::Prometheus);
+        void stopExportServer();
+
+        static MetricsRegistry& getDefault();
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_METRICS_REGISTRY_H_)
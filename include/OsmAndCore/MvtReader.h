@@ -98,6 +98,20 @@ namespace OsmAnd
             QVector< std::shared_ptr<const LineString> > getLines() const;
         };
         
+        // Rings are open, first one is exterior ring and the rest are its holes
+        class OSMAND_CORE_API Polygon : public Geometry
+        {
+            Q_DISABLE_COPY_AND_MOVE(Polygon);
+        private:
+            QVector< QVector<OsmAnd::PointI> > rings;
+        protected:
+        public:
+            GeomType getType() const override;
+            Polygon(QVector< QVector<OsmAnd::PointI> > &rings);
+            virtual ~Polygon();
+            QVector< QVector<OsmAnd::PointI> > getRings() const;
+        };
+        
         class OSMAND_CORE_API Tile
         {
             Q_DISABLE_COPY_AND_MOVE(Tile);
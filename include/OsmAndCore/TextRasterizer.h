@@ -12,6 +12,7 @@
 #include <OsmAndCore/CommonSWIG.h>
 #include <OsmAndCore/PrivateImplementation.h>
 #include <OsmAndCore/IFontFinder.h>
+#include <OsmAndCore/TextRasterizerCache.h>
 #include <OsmAndCore/Map/MapCommonTypes.h>
 #include <OsmAndCore/Map/MapPrimitiviser.h>
 
@@ -140,12 +141,15 @@ namespace OsmAnd
     protected:
     public:
         TextRasterizer(
-            const std::shared_ptr<const IFontFinder>& fontFinder);
+            const std::shared_ptr<const IFontFinder>& fontFinder,
+            const std::shared_ptr<TextRasterizerCache>& cache = nullptr);
         virtual ~TextRasterizer();
 
         const std::shared_ptr<const IFontFinder> fontFinder;
+        // When set, returned bitmaps may share pixels with cached ones, while target bitmap always gets own copy
+        const std::shared_ptr<TextRasterizerCache> cache;
 
-        std::shared_ptr<SkBitmap> rasterize(
+        std::shared_ptr<const SkBitmap> rasterize(
             const QString& text,
             const Style& style = Style(),
             QVector<SkScalar>* const outGlyphWidths = nullptr,
@@ -0,0 +1,69 @@
+#ifndef _OSMAND_CORE_TEXT_RASTERIZER_CACHE_H_
+#define _OSMAND_CORE_TEXT_RASTERIZER_CACHE_H_
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/PrivateImplementation.h>
+
+namespace OsmAnd
+{
+    class TextRasterizer_P;
+
+    // Size-bounded, thread-safe cache of shaped&measured texts and of whole rasterized captions.
+    // Single instance may be shared by any number of TextRasterizers (and thus by all MapPresentationEnvironments
+    // that rasterize symbols through them), since entries are keyed by font finder, text and complete style.
+    class TextRasterizerCache_P;
+    class OSMAND_CORE_API TextRasterizerCache
+    {
+        Q_DISABLE_COPY_AND_MOVE(TextRasterizerCache);
+    public:
+        struct OSMAND_CORE_API Statistics Q_DECL_FINAL
+        {
+            Statistics();
+
+            unsigned int shapedTextsCount;
+            uint64_t shapedTextHits;
+            uint64_t shapedTextMisses;
+            uint64_t shapedTextEvictions;
+            float getShapedTextHitRate() const;
+
+            unsigned int bitmapsCount;
+            size_t bitmapsSizeInBytes;
+            uint64_t bitmapHits;
+            uint64_t bitmapMisses;
+            uint64_t bitmapEvictions;
+            float getBitmapHitRate() const;
+
+            QString toString(const QString& prefix = QString::null) const;
+        };
+
+    private:
+        PrivateImplementation<TextRasterizerCache_P> _p;
+    protected:
+    public:
+        TextRasterizerCache(
+            const unsigned int maxShapedTextsCount = 8192,
+            const size_t maxBitmapsSizeInBytes = 16 * 1024 * 1024);
+        virtual ~TextRasterizerCache();
+
+        const unsigned int maxShapedTextsCount;
+        const size_t maxBitmapsSizeInBytes;
+
+        Statistics getStatistics() const;
+        void resetStatistics();
+        void clear();
+
+        static std::shared_ptr<TextRasterizerCache> getDefault();
+
+    friend class OsmAnd::TextRasterizer_P;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TEXT_RASTERIZER_CACHE_H_)
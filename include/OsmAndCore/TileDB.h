@@ -3,6 +3,7 @@
 
 #include <OsmAndCore/stdlib_common.h>
 #include <array>
+#include <functional>
 
 #include <OsmAndCore/QtExtensions.h>
 #include <QDir>
@@ -20,6 +21,7 @@ namespace OsmAnd {
     class OSMAND_CORE_API TileDB
     {
     public:
+        typedef std::function<bool (const TileId tileId, const ZoomLevel zoom, const QByteArray& data)> TileVisitor;
     private:
     protected:
         mutable QMutex _indexMutex;
@@ -35,6 +37,9 @@ namespace OsmAnd {
 
         bool rebuildIndex();
         bool obtainTileData(const TileId tileId, const ZoomLevel zoom, QByteArray& data);
+
+        // Visits every tile of every indexed database, stops when visitor returns false
+        bool enumerateTiles(const TileVisitor visitor);
     };
 
 }
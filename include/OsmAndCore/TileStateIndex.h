@@ -0,0 +1,230 @@
+#ifndef _OSMAND_CORE_TILE_STATE_INDEX_H_
+#define _OSMAND_CORE_TILE_STATE_INDEX_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <array>
+#include <functional>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/QtCommon.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+
+namespace OsmAnd
+{
+    // Index of per-tile state flags with pyramid of counters above each tile: for every flag, each tile knows how
+    // many of its descendants down to coverage depth have that flag. So "are all tiles under this tile usable" or
+    // "is there anything usable under this tile" is answered with single lookup, instead of lookup per descendant.
+    class TileStateIndex Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(TileStateIndex);
+
+    public:
+        typedef uint8_t Flags;
+        enum : unsigned int
+        {
+            MaxFlagsCount = 8,
+            MaxCoverageDepth = 15,
+        };
+
+    private:
+        struct CoverageKey
+        {
+            TileId tileId;
+            uint8_t zoom;
+            uint8_t zoomShift;
+            uint8_t flagIndex;
+
+            inline bool operator==(const CoverageKey& that) const
+            {
+                return tileId.id == that.tileId.id &&
+                    zoom == that.zoom &&
+                    zoomShift == that.zoomShift &&
+                    flagIndex == that.flagIndex;
+            }
+
+            friend inline uint qHash(const CoverageKey& key, uint seed = 0)
+            {
+                return ::qHash(key.tileId.id, seed) ^
+                    ::qHash((static_cast<uint>(key.zoom) << 16) | (static_cast<uint>(key.zoomShift) << 8) | key.flagIndex, seed);
+            }
+        };
+
+        mutable QReadWriteLock _lock;
+        std::array< QHash<TileId, Flags>, ZoomLevelsCount > _flags;
+        QHash<CoverageKey, uint32_t> _coverage;
+
+        void updateCoverageNoLock(const TileId tileId, const ZoomLevel zoom, const Flags changedFlags, const bool set)
+        {
+            for (auto flagIndex = 0u; flagIndex < MaxFlagsCount; flagIndex++)
+            {
+                if ((changedFlags & (1u << flagIndex)) == 0)
+                    continue;
+
+                for (auto zoomShift = 1u; zoomShift <= coverageDepth && zoomShift <= static_cast<unsigned int>(zoom); zoomShift++)
+                {
+                    CoverageKey key;
+                    key.tileId = TileId::fromXY(tileId.x >> zoomShift, tileId.y >> zoomShift);
+                    key.zoom = static_cast<uint8_t>(zoom - zoomShift);
+                    key.zoomShift = static_cast<uint8_t>(zoomShift);
+                    key.flagIndex = static_cast<uint8_t>(flagIndex);
+
+                    if (set)
+                    {
+                        _coverage[key]++;
+                        continue;
+                    }
+
+                    const auto itCount = _coverage.find(key);
+                    if (itCount == _coverage.end())
+                        continue;
+                    if (--(*itCount) == 0)
+                        _coverage.erase(itCount);
+                }
+            }
+        }
+
+        void setFlagsNoLock(const TileId tileId, const ZoomLevel zoom, const Flags flags)
+        {
+            auto& flagsAtZoom = _flags[zoom];
+            const auto itFlags = flagsAtZoom.find(tileId);
+            const auto oldFlags = (itFlags != flagsAtZoom.end()) ? *itFlags : static_cast<Flags>(0);
+            if (oldFlags == flags)
+                return;
+
+            if (flags == 0)
+                flagsAtZoom.erase(itFlags);
+            else if (itFlags != flagsAtZoom.end())
+                *itFlags = flags;
+            else
+                flagsAtZoom.insert(tileId, flags);
+
+            if (coverageDepth == 0)
+                return;
+            updateCoverageNoLock(tileId, zoom, oldFlags & ~flags, false);
+            updateCoverageNoLock(tileId, zoom, flags & ~oldFlags, true);
+        }
+    public:
+        TileStateIndex(const unsigned int coverageDepth_ = 0)
+            : coverageDepth(qMin(coverageDepth_, static_cast<unsigned int>(MaxCoverageDepth)))
+        {
+        }
+        ~TileStateIndex()
+        {
+        }
+
+        // How many zoom levels down coverage of each tile is counted
+        const unsigned int coverageDepth;
+
+        // Zero flags remove tile from index
+        void setFlags(const TileId tileId, const ZoomLevel zoom, const Flags flags)
+        {
+            QWriteLocker scopedLocker(&_lock);
+
+            setFlagsNoLock(tileId, zoom, flags);
+        }
+
+        // Flags are obtained under index lock, so that concurrent updates of same tile are applied in order in which
+        // they have read the state. If callback returns false, index is left as is.
+        void updateFlags(const TileId tileId, const ZoomLevel zoom, const std::function<bool (Flags& outFlags)>& obtainFlags)
+        {
+            QWriteLocker scopedLocker(&_lock);
+
+            Flags flags = 0;
+            if (!obtainFlags(flags))
+                return;
+            setFlagsNoLock(tileId, zoom, flags);
+        }
+
+        void clear()
+        {
+            QWriteLocker scopedLocker(&_lock);
+
+            for (auto& flagsAtZoom : _flags)
+                flagsAtZoom.clear();
+            _coverage.clear();
+        }
+
+        Flags getFlags(const TileId tileId, const ZoomLevel zoom) const
+        {
+            QReadLocker scopedLocker(&_lock);
+
+            return _flags[zoom].value(tileId, 0);
+        }
+
+        // Checks that tile has all given flags
+        bool hasFlags(const TileId tileId, const ZoomLevel zoom, const Flags flags) const
+        {
+            QReadLocker scopedLocker(&_lock);
+
+            const auto& flagsAtZoom = _flags[zoom];
+            const auto citFlags = flagsAtZoom.constFind(tileId);
+            if (citFlags == flagsAtZoom.cend())
+                return false;
+            return (*citFlags & flags) == flags;
+        }
+
+        // Counts tiles on (zoom + zoomShift) under given tile that have single given flag
+        unsigned int countDescendants(
+            const TileId tileId,
+            const ZoomLevel zoom,
+            const unsigned int zoomShift,
+            const Flags flag) const
+        {
+            assert(zoomShift > 0 && zoomShift <= coverageDepth);
+            assert(flag != 0 && (flag & (flag - 1)) == 0);
+
+            CoverageKey key;
+            key.tileId = tileId;
+            key.zoom = static_cast<uint8_t>(zoom);
+            key.zoomShift = static_cast<uint8_t>(zoomShift);
+            key.flagIndex = 0;
+            while ((flag >> key.flagIndex) != 1)
+                key.flagIndex++;
+
+            QReadLocker scopedLocker(&_lock);
+
+            return _coverage.value(key, 0);
+        }
+
+        // Checks that every tile on (zoom + zoomShift) under given tile has single given flag
+        bool isCoveredByDescendants(
+            const TileId tileId,
+            const ZoomLevel zoom,
+            const unsigned int zoomShift,
+            const Flags flag) const
+        {
+            return countDescendants(tileId, zoom, zoomShift, flag) == (1u << (2u * zoomShift));
+        }
+
+        // Collects tiles on given zoom that have all given flags (or all present tiles, if no flags given)
+        void obtainTiles(const ZoomLevel zoom, const Flags flags, QList<TileId>& outTiles) const
+        {
+            QReadLocker scopedLocker(&_lock);
+
+            const auto& flagsAtZoom = _flags[zoom];
+            for (auto citFlags = flagsAtZoom.cbegin(); citFlags != flagsAtZoom.cend(); ++citFlags)
+            {
+                if ((*citFlags & flags) == flags)
+                    outTiles.push_back(citFlags.key());
+            }
+        }
+
+        unsigned int getTilesCount(const ZoomLevel zoom) const
+        {
+            QReadLocker scopedLocker(&_lock);
+
+            return _flags[zoom].size();
+        }
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TILE_STATE_INDEX_H_)
@@ -20,6 +20,7 @@
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
 #include <OsmAndCore/Logging.h>
+#include <OsmAndCore/TileStateIndex.h>
 
 //#define OSMAND_TRACE_TILED_ENTRIES_COLLECTION_STATE_SUPPORT 1
 #if !defined(OSMAND_TRACE_TILED_ENTRIES_COLLECTION_STATE_SUPPORT)
@@ -67,6 +68,49 @@ namespace OsmAnd
 
         const std::shared_ptr< Link > _link;
 
+        // Index of entry states, filled only if collection classifies entries
+        TileStateIndex _index;
+
+        // Collections that want to have an index return non-zero flags of entry
+        virtual TileStateIndex::Flags getEntryIndexFlags(const ENTRY& entry) const
+        {
+            Q_UNUSED(entry);
+
+            return 0;
+        }
+
+        void updateEntryIndex(const std::shared_ptr<ENTRY>& entry)
+        {
+            const auto flags = getEntryIndexFlags(*entry);
+            if (flags != 0)
+                _index.setFlags(entry->tileId, entry->zoom, flags);
+        }
+
+        // Must be called after entry was unlinked
+        void removeEntryFromIndex(const std::shared_ptr<ENTRY>& entry)
+        {
+            _index.setFlags(entry->tileId, entry->zoom, 0);
+        }
+
+        // Called by entry without collection lock, since state may change under it as well
+        void onEntryStateModified(const ENTRY& entry)
+        {
+            if (getEntryIndexFlags(entry) == 0)
+                return;
+
+            _index.updateFlags(entry.tileId, entry.zoom,
+                [this, &entry]
+                (TileStateIndex::Flags& outFlags) -> bool
+                {
+                    // Entry that was already removed from collection must not get back to index
+                    if (entry.link.expired())
+                        return false;
+
+                    outFlags = getEntryIndexFlags(entry);
+                    return true;
+                });
+        }
+
         virtual void onCollectionModified() const
         {
         }
@@ -77,8 +121,10 @@ namespace OsmAnd
             Q_UNUSED(zoomLevel);
         }
     public:
-        TiledEntriesCollection()
+        TiledEntriesCollection(const unsigned int indexCoverageDepth = 0)
             : _link(new Link(*this))
+            , _index(indexCoverageDepth)
+            , index(_index)
         {
         }
         virtual ~TiledEntriesCollection()
@@ -137,6 +183,7 @@ namespace OsmAnd
             auto newEntry = allocator(*this, tileId, zoom);
             outEntry.reset(newEntry);
             itEntry = storage.insert(tileId, outEntry);
+            updateEntryIndex(outEntry);
 
             onCollectionModified();
         }
@@ -176,6 +223,7 @@ namespace OsmAnd
                     modified = true;
                 storage.clear();
             }
+            _index.clear();
 
             if (modified)
                 onCollectionModified();
@@ -191,6 +239,7 @@ namespace OsmAnd
                 return;
 
             itEntry.value()->unlink();
+            removeEntryFromIndex(itEntry.value());
             storage.erase(itEntry);
 
             onCollectionModified();
@@ -213,6 +262,7 @@ namespace OsmAnd
                     if (doRemove)
                     {
                         value->unlink();
+                        removeEntryFromIndex(value);
                         itEntryPair.remove();
 
                         modified = true;
@@ -247,6 +297,9 @@ namespace OsmAnd
             }
         }
 
+        // Index may be queried without locking collection
+        const TileStateIndex& index;
+
         virtual unsigned int getEntriesCount() const
         {
             QReadLocker scopedLocker(&_collectionLock);
@@ -304,7 +357,10 @@ namespace OsmAnd
         virtual void onEntryModified() const
         {
             if (const auto link = _link.lock())
+            {
                 link->collection.onEntryModified(tileId, zoom);
+                link->collection.onEntryStateModified(*static_cast<const ENTRY*>(this));
+            }
         }
     public:
         virtual ~TiledEntriesCollectionEntry()
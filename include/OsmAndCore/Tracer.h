@@ -0,0 +1,122 @@
+#ifndef _OSMAND_CORE_TRACER_H_
+#define _OSMAND_CORE_TRACER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <atomic>
+#include <chrono>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QByteArray>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/PrivateImplementation.h>
+
+// Spans are compiled in only when OSMAND_TRACING is set (see OSMAND_TRACING option in CMake),
+// otherwise all OSMAND_TRACE_* macros expand to nothing
+#if !defined(OSMAND_TRACING)
+#   define OSMAND_TRACING 0
+#endif // !defined(OSMAND_TRACING)
+
+namespace OsmAnd
+{
+    // Collects timed spans from all threads into per-thread buffers and writes them out in Chrome trace event
+    // format, so that they can be inspected in chrome://tracing or Perfetto. Nothing is collected unless
+    // recording was started.
+    class Tracer_P;
+    class OSMAND_CORE_API Tracer Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(Tracer);
+    public:
+        enum : unsigned int
+        {
+            // Events above this limit are dropped, to keep memory bounded when recording is left on
+            MaxEventsPerThread = 1024 * 1024,
+        };
+
+        // Records time between construction and destruction as complete event of current thread.
+        // Name has to be a string literal, since only pointer to it is stored.
+        class Span Q_DECL_FINAL
+        {
+            Q_DISABLE_COPY_AND_MOVE(Span);
+        private:
+            const char* const _name;
+            const uint64_t _taskId;
+            const bool _active;
+            const int64_t _startTimestamp;
+        public:
+            inline Span(const char* const name, const uint64_t taskId = 0)
+                : _name(name)
+                , _taskId(taskId)
+                , _active(getDefault().isRecording())
+                , _startTimestamp(_active ? getTimestamp() : 0)
+            {
+            }
+
+            inline ~Span()
+            {
+                if (_active)
+                    getDefault().record(_name, _taskId, _startTimestamp, getTimestamp() - _startTimestamp);
+            }
+        };
+
+    private:
+        PrivateImplementation<Tracer_P> _p;
+        std::atomic<bool> _recording;
+    protected:
+    public:
+        Tracer();
+        ~Tracer();
+
+        inline bool isRecording() const
+        {
+            return _recording.load(std::memory_order_relaxed);
+        }
+
+        // Starting discards everything recorded before
+        void startRecording();
+        void stopRecording();
+
+        void setCurrentThreadName(const QString& name);
+        void record(const char* const name, const uint64_t taskId, const int64_t startTimestamp, const int64_t duration);
+
+        QByteArray exportChromeTrace() const;
+        bool exportChromeTraceToFile(const QString& fileName) const;
+
+        // Monotonic timestamp in microseconds
+        static inline int64_t getTimestamp()
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Task identifier of everything done for a tile, so that all stages of the same tile (decoding,
+        // primitivisation, rasterization, request and upload) are matched. Leading bit marks zoom level,
+        // so that identifiers of tiles on different zoom levels never collide.
+        static inline uint64_t getTileTaskId(const TileId tileId, const ZoomLevel zoom)
+        {
+            return (static_cast<uint64_t>(1) << (2 * static_cast<unsigned int>(zoom)))
+                | (static_cast<uint64_t>(static_cast<uint32_t>(tileId.y)) << static_cast<unsigned int>(zoom))
+                | static_cast<uint64_t>(static_cast<uint32_t>(tileId.x));
+        }
+
+        static Tracer& getDefault();
+    };
+}
+
+#if OSMAND_TRACING
+#   define _OSMAND_TRACE_CONCAT_IMPL(a, b) a##b
+#   define _OSMAND_TRACE_CONCAT(a, b) _OSMAND_TRACE_CONCAT_IMPL(a, b)
+#   define OSMAND_TRACE_SPAN(name)                                                                                      \
+        const OsmAnd::Tracer::Span _OSMAND_TRACE_CONCAT(_traceSpan_, __LINE__)(name)
+#   define OSMAND_TRACE_TASK_SPAN(name, taskId)                                                                         \
+        const OsmAnd::Tracer::Span _OSMAND_TRACE_CONCAT(_traceSpan_, __LINE__)(name, static_cast<uint64_t>(taskId))
+#else
+#   define OSMAND_TRACE_SPAN(name)
+#   define OSMAND_TRACE_TASK_SPAN(name, taskId)
+#endif // OSMAND_TRACING
+
+#endif // !defined(_OSMAND_CORE_TRACER_H_)
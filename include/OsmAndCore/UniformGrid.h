@@ -0,0 +1,408 @@
+#ifndef _OSMAND_CORE_UNIFORM_GRID_H_
+#define _OSMAND_CORE_UNIFORM_GRID_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <functional>
+#include <vector>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QList>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/QuadTree.h>
+
+namespace OsmAnd
+{
+    // Flat uniform grid of buckets over fixed root area, an alternative to QuadTree for densely populated areas
+    // that get rebuilt very often (e.g. screen-space symbol intersections).
+    // - All storage is kept in flat arrays that are reused after reset(), so rebuilding doesn't reallocate;
+    // - Buckets are cleared lazily by generation counter instead of being wiped on reset();
+    // - Removal only marks entry as discarded, nothing is ever moved.
+    // Has same BBox and same test/query semantics as QuadTree.
+    template<typename ELEMENT_TYPE, typename COORD_TYPE>
+    class UniformGrid
+    {
+    public:
+        typedef COORD_TYPE CoordType;
+        typedef UniformGrid<ELEMENT_TYPE, COORD_TYPE> UniformGridT;
+        typedef QuadTree<ELEMENT_TYPE, COORD_TYPE> QuadTreeT;
+        typedef typename QuadTreeT::AreaT AreaT;
+        typedef typename QuadTreeT::OOBBT OOBBT;
+        typedef typename QuadTreeT::PointT PointT;
+        typedef typename QuadTreeT::BBoxType BBoxType;
+        typedef typename QuadTreeT::BBox BBox;
+        typedef typename QuadTreeT::Acceptor Acceptor;
+
+    private:
+        struct Entry
+        {
+            Entry(const ELEMENT_TYPE& element_, const BBox& bbox_, const int firstColumn_, const int firstRow_)
+                : element(element_)
+                , bbox(bbox_)
+                , firstColumn(firstColumn_)
+                , firstRow(firstRow_)
+                , discarded(false)
+            {
+            }
+
+            ELEMENT_TYPE element;
+            BBox bbox;
+            int firstColumn;
+            int firstRow;
+            bool discarded;
+        };
+
+        struct CellLink
+        {
+            unsigned int entryIndex;
+            int next;
+        };
+
+        struct CellsRange
+        {
+            int firstColumn;
+            int firstRow;
+            int lastColumn;
+            int lastRow;
+        };
+
+        AreaT _rootArea;
+        COORD_TYPE _cellSize;
+        int _columnsCount;
+        int _rowsCount;
+
+        std::vector<Entry> _entries;
+        std::vector<CellLink> _links;
+        std::vector<int> _cellHeads;
+        std::vector<unsigned int> _cellGenerations;
+        unsigned int _generation;
+        unsigned int _discardedEntriesCount;
+
+        static inline AreaT getAABB(const BBox& bbox)
+        {
+            if (bbox.type == BBoxType::AABB)
+                return bbox.asAABB;
+            else /* if (bbox.type == BBoxType::OOBB) */
+                return bbox.asOOBB.aabb();
+        }
+
+        static inline bool contains(const BBox& which, const BBox& what)
+        {
+            if (which.type == BBoxType::AABB)
+                return what.isContainedBy(which.asAABB);
+            else /* if (which.type == BBoxType::OOBB) */
+                return what.isContainedBy(which.asOOBB);
+        }
+
+        static inline bool intersects(const BBox& which, const BBox& what)
+        {
+            if (which.type == BBoxType::AABB)
+                return what.isIntersectedBy(which.asAABB);
+            else /* if (which.type == BBoxType::OOBB) */
+                return what.isIntersectedBy(which.asOOBB);
+        }
+
+        static inline bool contains(const BBox& which, const PointT& what)
+        {
+            if (which.type == BBoxType::AABB)
+                return which.asAABB.contains(what);
+            else /* if (which.type == BBoxType::OOBB) */
+                return which.asOOBB.contains(what);
+        }
+
+        inline int getColumn(const COORD_TYPE x) const
+        {
+            return qBound(0, static_cast<int>((x - _rootArea.left()) / _cellSize), _columnsCount - 1);
+        }
+
+        inline int getRow(const COORD_TYPE y) const
+        {
+            return qBound(0, static_cast<int>((y - _rootArea.top()) / _cellSize), _rowsCount - 1);
+        }
+
+        inline CellsRange getCellsRange(const AreaT& aabb) const
+        {
+            CellsRange range;
+            range.firstColumn = getColumn(aabb.left());
+            range.firstRow = getRow(aabb.top());
+            range.lastColumn = getColumn(aabb.right());
+            range.lastRow = getRow(aabb.bottom());
+            return range;
+        }
+
+        inline int getCellHead(const int column, const int row) const
+        {
+            const auto cellIndex = row * _columnsCount + column;
+            if (_cellGenerations[cellIndex] != _generation)
+                return -1;
+            return _cellHeads[cellIndex];
+        }
+
+        // Entry that spans several cells has to be reported only once: only from the first cell that is shared
+        // by entry and tested range
+        static inline bool isFirstSharedCell(const Entry& entry, const CellsRange& range, const int column, const int row)
+        {
+            return column == qMax(entry.firstColumn, range.firstColumn) && row == qMax(entry.firstRow, range.firstRow);
+        }
+
+        template<typename VISITOR>
+        inline bool visit(const BBox& bbox, const bool strict, const VISITOR visitor) const
+        {
+            // Same as QuadTree: nothing can be found outside of the root area
+            if (!bbox.isContainedBy(_rootArea))
+            {
+                if (strict)
+                    return false;
+                if (!bbox.isIntersectedBy(_rootArea))
+                    return false;
+            }
+
+            const auto range = getCellsRange(getAABB(bbox));
+            for (auto row = range.firstRow; row <= range.lastRow; row++)
+            {
+                for (auto column = range.firstColumn; column <= range.lastColumn; column++)
+                {
+                    for (auto linkIndex = getCellHead(column, row); linkIndex >= 0; linkIndex = _links[linkIndex].next)
+                    {
+                        const auto& entry = _entries[_links[linkIndex].entryIndex];
+                        if (entry.discarded || !isFirstSharedCell(entry, range, column, row))
+                            continue;
+
+                        if (!contains(bbox, entry.bbox) && (strict || !intersects(bbox, entry.bbox)))
+                            continue;
+
+                        if (visitor(entry))
+                            return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+    protected:
+    public:
+        inline UniformGrid(
+            const AreaT& rootArea = AreaT(0, 0, 0, 0),
+            const COORD_TYPE cellSize = 64)
+            : _columnsCount(0)
+            , _rowsCount(0)
+            , _generation(0)
+            , _discardedEntriesCount(0)
+        {
+            reset(rootArea, cellSize);
+        }
+
+        inline ~UniformGrid()
+        {
+        }
+
+        // Removes all entries while keeping allocated storage
+        inline void reset(const AreaT& rootArea, const COORD_TYPE cellSize)
+        {
+            _rootArea = rootArea;
+            _cellSize = qMax(cellSize, static_cast<COORD_TYPE>(1));
+
+            const auto columnsCount = qMax(1, static_cast<int>(_rootArea.width() / _cellSize) + 1);
+            const auto rowsCount = qMax(1, static_cast<int>(_rootArea.height() / _cellSize) + 1);
+            const auto cellsCount = static_cast<size_t>(columnsCount * rowsCount);
+            _columnsCount = columnsCount;
+            _rowsCount = rowsCount;
+
+            _entries.clear();
+            _links.clear();
+            _discardedEntriesCount = 0;
+
+            _generation++;
+            if (_cellHeads.size() != cellsCount || _generation == 0)
+            {
+                // Generation wrapped around or layout has changed, so stale generations can't be trusted anymore
+                _generation = 1;
+                _cellHeads.assign(cellsCount, -1);
+                _cellGenerations.assign(cellsCount, 0);
+            }
+        }
+
+        inline void reset()
+        {
+            reset(_rootArea, _cellSize);
+        }
+
+        inline void swap(UniformGridT& that)
+        {
+            std::swap(_rootArea, that._rootArea);
+            std::swap(_cellSize, that._cellSize);
+            std::swap(_columnsCount, that._columnsCount);
+            std::swap(_rowsCount, that._rowsCount);
+            _entries.swap(that._entries);
+            _links.swap(that._links);
+            _cellHeads.swap(that._cellHeads);
+            _cellGenerations.swap(that._cellGenerations);
+            std::swap(_generation, that._generation);
+            std::swap(_discardedEntriesCount, that._discardedEntriesCount);
+        }
+
+        inline AreaT getRootArea() const
+        {
+            return _rootArea;
+        }
+
+        inline const AreaT& rootArea() const
+        {
+            return _rootArea;
+        }
+
+        inline COORD_TYPE getCellSize() const
+        {
+            return _cellSize;
+        }
+
+        inline unsigned int getEntriesCount() const
+        {
+            return static_cast<unsigned int>(_entries.size()) - _discardedEntriesCount;
+        }
+
+        inline bool insert(const ELEMENT_TYPE& element, const BBox& bbox, const bool strict = false)
+        {
+            // Check if root can hold entire element
+            if (!bbox.isContainedBy(_rootArea))
+            {
+                if (strict)
+                    return false;
+                if (!bbox.isIntersectedBy(_rootArea))
+                    return false;
+            }
+
+            const auto range = getCellsRange(getAABB(bbox));
+            const auto entryIndex = static_cast<unsigned int>(_entries.size());
+            _entries.push_back(Entry(element, bbox, range.firstColumn, range.firstRow));
+
+            for (auto row = range.firstRow; row <= range.lastRow; row++)
+            {
+                for (auto column = range.firstColumn; column <= range.lastColumn; column++)
+                {
+                    const auto cellIndex = row * _columnsCount + column;
+                    if (_cellGenerations[cellIndex] != _generation)
+                    {
+                        _cellGenerations[cellIndex] = _generation;
+                        _cellHeads[cellIndex] = -1;
+                    }
+
+                    CellLink link;
+                    link.entryIndex = entryIndex;
+                    link.next = _cellHeads[cellIndex];
+                    _cellHeads[cellIndex] = static_cast<int>(_links.size());
+                    _links.push_back(link);
+                }
+            }
+
+            return true;
+        }
+
+        template<class CONTAINER_TYPE>
+        inline int insertFrom(
+            const CONTAINER_TYPE& container,
+            const std::function<bool(const ELEMENT_TYPE& item, BBox& outBbox)> obtainBBox,
+            const bool strict = false)
+        {
+            int insertedCount = 0;
+
+            for (const auto& item : container)
+            {
+                BBox bbox;
+                if (!obtainBBox(item, bbox))
+                    continue;
+
+                if (insert(item, bbox, strict))
+                    insertedCount++;
+            }
+
+            return insertedCount;
+        }
+
+        inline bool test(const BBox& bbox, const bool strict = false, const Acceptor acceptor = nullptr) const
+        {
+            return visit(bbox, strict,
+                [acceptor]
+                (const Entry& entry) -> bool
+                {
+                    return !acceptor || acceptor(entry.element, entry.bbox);
+                });
+        }
+
+        inline void query(
+            const BBox& bbox,
+            QList<ELEMENT_TYPE>& outResults,
+            const bool strict = false,
+            const Acceptor acceptor = nullptr) const
+        {
+            visit(bbox, strict,
+                [acceptor, &outResults]
+                (const Entry& entry) -> bool
+                {
+                    if (!acceptor || acceptor(entry.element, entry.bbox))
+                        outResults.push_back(entry.element);
+                    return false;
+                });
+        }
+
+        inline void select(const PointT& point, QList<ELEMENT_TYPE>& outResults, const Acceptor acceptor = nullptr) const
+        {
+            if (!_rootArea.contains(point))
+                return;
+
+            for (auto linkIndex = getCellHead(getColumn(point.x), getRow(point.y));
+                linkIndex >= 0;
+                linkIndex = _links[linkIndex].next)
+            {
+                const auto& entry = _entries[_links[linkIndex].entryIndex];
+                if (entry.discarded || !contains(entry.bbox, point))
+                    continue;
+
+                if (!acceptor || acceptor(entry.element, entry.bbox))
+                    outResults.push_back(entry.element);
+            }
+        }
+
+        inline void get(QList<ELEMENT_TYPE>& outResults, const Acceptor acceptor = nullptr) const
+        {
+            for (const auto& entry : _entries)
+            {
+                if (entry.discarded)
+                    continue;
+
+                if (!acceptor || acceptor(entry.element, entry.bbox))
+                    outResults.push_back(entry.element);
+            }
+        }
+
+        // Marks entry as discarded. Storage is reclaimed only on next reset()
+        inline bool removeOne(const ELEMENT_TYPE& element, const BBox& bbox)
+        {
+            if (!bbox.isContainedBy(_rootArea) && !bbox.isIntersectedBy(_rootArea))
+                return false;
+
+            const auto range = getCellsRange(getAABB(bbox));
+            for (auto linkIndex = getCellHead(range.firstColumn, range.firstRow);
+                linkIndex >= 0;
+                linkIndex = _links[linkIndex].next)
+            {
+                auto& entry = _entries[_links[linkIndex].entryIndex];
+                if (entry.discarded || entry.element != element)
+                    continue;
+
+                entry.discarded = true;
+                _discardedEntriesCount++;
+                return true;
+            }
+
+            return false;
+        }
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_UNIFORM_GRID_H_)
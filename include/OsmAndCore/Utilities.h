@@ -662,6 +662,31 @@ namespace OsmAnd
             outY = deinterleaveBy1(code >> 1);
         }
 
+        inline static uint64_t encodeHilbertCode(const uint32_t x_, const uint32_t y_, const ZoomLevel zoom)
+        {
+            auto x = x_;
+            auto y = y_;
+            uint64_t code = 0;
+            for (auto side = (1u << static_cast<unsigned int>(zoom)) >> 1; side > 0; side >>= 1)
+            {
+                const auto rx = (x & side) != 0 ? 1u : 0u;
+                const auto ry = (y & side) != 0 ? 1u : 0u;
+                code += static_cast<uint64_t>(side) * static_cast<uint64_t>(side) * ((3u * rx) ^ ry);
+
+                // Rotate quadrant, so that curve stays continuous
+                if (ry == 0)
+                {
+                    if (rx == 1)
+                    {
+                        x = side - 1 - (x & (side - 1));
+                        y = side - 1 - (y & (side - 1));
+                    }
+                    std::swap(x, y);
+                }
+            }
+            return code;
+        }
+
         static QVector<TileId> getTileIdsUnderscaledByZoomShift(
             const TileId tileId,
             const unsigned int absZoomShift)
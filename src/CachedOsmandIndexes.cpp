@@ -26,6 +26,23 @@ const std::shared_ptr<OsmAnd::ObfFile> OsmAnd::CachedOsmandIndexes::getObfFile(c
     return _p->getObfFile(filePath);
 }
 
+QList< std::shared_ptr<OsmAnd::ObfFile> > OsmAnd::CachedOsmandIndexes::getObfFiles(
+    const QStringList& filePaths,
+    const unsigned int maxConcurrentFiles /*= 0*/)
+{
+    return _p->getObfFiles(filePaths, maxConcurrentFiles);
+}
+
+QList< std::shared_ptr<OsmAnd::ObfFile> > OsmAnd::CachedOsmandIndexes::loadObfFiles(
+    const QStringList& filePaths,
+    const unsigned int maxConcurrentFiles /*= 0*/)
+{
+    QList< std::shared_ptr<ObfFile> > obfFiles;
+    for (const auto& parsedObfFile : constOf(CachedOsmandIndexes_P::parseObfFiles(filePaths, false, maxConcurrentFiles)))
+        obfFiles.push_back(parsedObfFile.obfFile);
+    return obfFiles;
+}
+
 void OsmAnd::CachedOsmandIndexes::readFromFile(const QString& filePath, int version)
 {
     _p->readFromFile(filePath, version);
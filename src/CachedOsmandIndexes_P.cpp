@@ -1,18 +1,18 @@
 #include "CachedOsmandIndexes_P.h"
 #include "CachedOsmandIndexes.h"
 
-#include <fcntl.h>
+#include "stdlib_common.h"
+#include <cstring>
 
 #include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
 #include <QFile>
+#include <QSaveFile>
 #include <QDateTime>
-
-#include "ignore_warnings_on_external_includes.h"
-#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include <QAtomicInt>
+#include <QSemaphore>
 #include "restore_internal_warnings.h"
 
-#include "QIODeviceInputStream.h"
-#include "QFileDeviceInputStream.h"
 #include "ObfFile.h"
 #include "ObfFile_P.h"
 #include "ObfInfo.h"
@@ -28,14 +28,20 @@
 #include "ObfPoiSectionInfo.h"
 #include "ObfPoiSectionReader_P.h"
 #include "ObfReaderUtilities.h"
+#include "QKeyValueIterator.h"
 #include "Logging.h"
 #include "Stopwatch.h"
+#include "MetricsRegistry.h"
 #include "IObfsCollection.h"
 #include "ObfDataInterface.h"
+#include "WorkerPool.h"
+#include "QRunnableFunctor.h"
+
+static const char CachedOsmandIndexesMagic[4] = { 'O', 'A', 'C', 'I' };
 
 OsmAnd::CachedOsmandIndexes_P::CachedOsmandIndexes_P(
 	CachedOsmandIndexes* const owner_)
-    : _storedIndex(nullptr)
+    : _dateCreated(QDateTime::currentMSecsSinceEpoch())
     , _hasChanged(true)
     , owner(owner_)
 {
@@ -45,22 +51,216 @@ OsmAnd::CachedOsmandIndexes_P::~CachedOsmandIndexes_P()
 {
 }
 
-void OsmAnd::CachedOsmandIndexes_P::addToCache(const std::shared_ptr<const ObfFile>& file)
+OsmAnd::CachedOsmandIndexes_P::MappedIndex::MappedIndex()
+    : data(nullptr)
+    , size(0)
+    , header(nullptr)
+    , buckets(nullptr)
+    , records(nullptr)
 {
-    _hasChanged = true;
-    if (_storedIndex == nullptr)
+}
+
+OsmAnd::CachedOsmandIndexes_P::MappedIndex::~MappedIndex()
+{
+    if (data)
+        file.unmap(const_cast<uchar*>(data));
+}
+
+QByteArray OsmAnd::CachedOsmandIndexes_P::MappedIndex::getName(const FileRecord& record) const
+{
+    if (static_cast<qint64>(record.nameOffset) + record.nameLength > size)
+        return QByteArray();
+
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(data + record.nameOffset), record.nameLength);
+}
+
+QByteArray OsmAnd::CachedOsmandIndexes_P::MappedIndex::getFileIndexData(const FileRecord& record) const
+{
+    if (static_cast<qint64>(record.fileIndexOffset) + record.fileIndexLength > size)
+        return QByteArray();
+
+    return QByteArray(reinterpret_cast<const char*>(data + record.fileIndexOffset), record.fileIndexLength);
+}
+
+uint64_t OsmAnd::CachedOsmandIndexes_P::hashFilePath(const QByteArray& canonicalFilePath)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto c : canonicalFilePath)
     {
-        _storedIndex = std::make_shared<OBF::OsmAndStoredIndex>();
-        _storedIndex->set_version(CachedOsmandIndexes::VERSION);
-        auto time_since_epoch = std::chrono::system_clock::now().time_since_epoch();
-        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(time_since_epoch).count();
-        _storedIndex->set_datecreated(millis);
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
     }
-    
+    return hash;
+}
+
+QString OsmAnd::CachedOsmandIndexes_P::getCanonicalFilePath(const QFileInfo& fileInfo)
+{
+    // Files with same name may be present in several storages, so they are told apart by full path
+    const auto canonicalFilePath = fileInfo.canonicalFilePath();
+    return canonicalFilePath.isEmpty() ? fileInfo.absoluteFilePath() : canonicalFilePath;
+}
+
+std::shared_ptr<const OsmAnd::ObfFile::Summary> OsmAnd::CachedOsmandIndexes_P::readSummary(const FileRecord& record)
+{
+    const std::shared_ptr<ObfFile::Summary> summary(new ObfFile::Summary());
+    summary->creationTimestamp = static_cast<uint64_t>(record.dateModified);
+    summary->isBasemap = (record.flags & FileRecordFlag::IsBasemap) != 0;
+    summary->isBasemapWithCoastlines = (record.flags & FileRecordFlag::IsBasemapWithCoastlines) != 0;
+    summary->dataTypes = ObfDataTypesMask(record.dataTypes);
+    summary->bbox31 = AreaI(record.bboxTop31, record.bboxLeft31, record.bboxBottom31, record.bboxRight31);
+    summary->minMapZoom = static_cast<ZoomLevel>(record.minMapZoom);
+    summary->maxMapZoom = static_cast<ZoomLevel>(record.maxMapZoom);
+    return summary;
+}
+
+void OsmAnd::CachedOsmandIndexes_P::writeSummary(const ObfFile::Summary& summary, FileRecord& record)
+{
+    record.dataTypes = static_cast<uint8_t>(summary.dataTypes);
+    record.flags = 0;
+    if (summary.isBasemap)
+        record.flags |= FileRecordFlag::IsBasemap;
+    if (summary.isBasemapWithCoastlines)
+        record.flags |= FileRecordFlag::IsBasemapWithCoastlines;
+    record.minMapZoom = static_cast<uint8_t>(summary.minMapZoom);
+    record.maxMapZoom = static_cast<uint8_t>(summary.maxMapZoom);
+    record.bboxTop31 = summary.bbox31.top();
+    record.bboxLeft31 = summary.bbox31.left();
+    record.bboxBottom31 = summary.bbox31.bottom();
+    record.bboxRight31 = summary.bbox31.right();
+}
+
+std::shared_ptr<OsmAnd::CachedOsmandIndexes_P::MappedIndex> OsmAnd::CachedOsmandIndexes_P::mapIndex(
+    const QString& filePath,
+    const int version)
+{
+    const std::shared_ptr<MappedIndex> mappedIndex(new MappedIndex());
+    mappedIndex->file.setFileName(filePath);
+    if (!mappedIndex->file.open(QIODevice::ReadOnly))
+    {
+        LogPrintf(LogSeverityLevel::Error, "Cache file could not be open to read: %s", qPrintable(filePath));
+        return nullptr;
+    }
+
+    mappedIndex->size = mappedIndex->file.size();
+    if (mappedIndex->size < static_cast<qint64>(sizeof(FileHeader)))
+        return nullptr;
+    mappedIndex->data = mappedIndex->file.map(0, mappedIndex->size);
+    if (!mappedIndex->data)
+    {
+        LogPrintf(LogSeverityLevel::Error, "Cache file could not be mapped: %s", qPrintable(filePath));
+        return nullptr;
+    }
+
+    // Caches of other versions or older protobuf-based ones are simply dropped and rebuilt
+    const auto header = reinterpret_cast<const FileHeader*>(mappedIndex->data);
+    if (std::memcmp(header->magic, CachedOsmandIndexesMagic, sizeof(CachedOsmandIndexesMagic)) != 0 ||
+        header->version != static_cast<uint32_t>(version))
+    {
+        return nullptr;
+    }
+
+    const auto bucketsOffset = static_cast<qint64>(sizeof(FileHeader));
+    const auto recordsOffset = bucketsOffset + static_cast<qint64>(header->bucketsCount) * sizeof(uint32_t);
+    const auto blobsOffset = recordsOffset + static_cast<qint64>(header->filesCount) * sizeof(FileRecord);
+    if (header->bucketsCount == 0 ||
+        (header->bucketsCount & (header->bucketsCount - 1)) != 0 ||
+        header->filesCount >= header->bucketsCount ||
+        blobsOffset > mappedIndex->size)
+    {
+        LogPrintf(LogSeverityLevel::Error, "Cache file is corrupted: %s", qPrintable(filePath));
+        return nullptr;
+    }
+
+    mappedIndex->header = header;
+    mappedIndex->buckets = reinterpret_cast<const uint32_t*>(mappedIndex->data + bucketsOffset);
+    mappedIndex->records = reinterpret_cast<const FileRecord*>(mappedIndex->data + recordsOffset);
+    return mappedIndex;
+}
+
+const OsmAnd::CachedOsmandIndexes_P::FileRecord* OsmAnd::CachedOsmandIndexes_P::findMappedRecord(
+    const QByteArray& canonicalFilePath,
+    const uint64_t fileSize) const
+{
+    if (!_mappedIndex)
+        return nullptr;
+
+    const auto& mappedIndex = *_mappedIndex;
+    const auto nameHash = hashFilePath(canonicalFilePath);
+    const auto bucketsMask = mappedIndex.header->bucketsCount - 1;
+    for (auto bucketIdx = static_cast<uint32_t>(nameHash) & bucketsMask, probesCount = 0u;
+        probesCount < mappedIndex.header->bucketsCount;
+        bucketIdx = (bucketIdx + 1) & bucketsMask, probesCount++)
+    {
+        const auto recordNumber = mappedIndex.buckets[bucketIdx];
+        if (recordNumber == 0 || recordNumber > mappedIndex.header->filesCount)
+            break;
+
+        // f.lastModified() == fi.getDateModified()
+        const auto& record = mappedIndex.records[recordNumber - 1];
+        if (record.nameHash == nameHash && record.fileSize == fileSize && mappedIndex.getName(record) == canonicalFilePath)
+            return &record;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<OsmAnd::ObfFile> OsmAnd::CachedOsmandIndexes_P::createCachedObfFile(
+    const QString& filePath,
+    const uint64_t fileSize,
+    const FileRecord* const record) const
+{
+    // Sections are decoded only when information is requested for the first time, while summary is available
+    // right away. Serialized index is copied out of mapping, since mapping is released when cache is rewritten.
+    const std::shared_ptr<ObfFile> obfFile(new ObfFile(filePath, fileSize));
+    std::atomic_store(&obfFile->_p->_summary, readSummary(*record));
+    const auto fileIndexData = _mappedIndex->getFileIndexData(*record);
+    obfFile->_p->_obfInfoMaterializer =
+        [fileIndexData]
+        () -> std::shared_ptr<const ObfInfo>
+        {
+            OBF::FileIndex fileIndex;
+            if (fileIndexData.isEmpty() || !fileIndex.ParseFromArray(fileIndexData.constData(), fileIndexData.size()))
+                return nullptr;
+            return initFileIndex(fileIndex);
+        };
+    return obfFile;
+}
+
+std::shared_ptr<OsmAnd::ObfFile> OsmAnd::CachedOsmandIndexes_P::createCachedObfFile(
+    const QString& filePath,
+    const uint64_t fileSize,
+    const AddedFileIndex& addedFileIndex) const
+{
+    const std::shared_ptr<ObfFile> obfFile(new ObfFile(filePath, fileSize));
+    std::atomic_store(&obfFile->_p->_summary, addedFileIndex.summary);
+    const auto fileIndex = addedFileIndex.fileIndex;
+    obfFile->_p->_obfInfoMaterializer =
+        [fileIndex]
+        () -> std::shared_ptr<const ObfInfo>
+        {
+            return initFileIndex(*fileIndex);
+        };
+    return obfFile;
+}
+
+void OsmAnd::CachedOsmandIndexes_P::addToCache(const QHash<QString, AddedFileIndex>& addedFileIndexes)
+{
+    if (addedFileIndexes.isEmpty())
+        return;
+
+    _hasChanged = true;
+    for (const auto& itAddedFileIndex : rangeOf(constOf(addedFileIndexes)))
+        _addedFileIndexes.insert(itAddedFileIndex.key(), itAddedFileIndex.value());
+}
+
+std::shared_ptr<OsmAnd::OBF::FileIndex> OsmAnd::CachedOsmandIndexes_P::createFileIndex(
+    const std::shared_ptr<const ObfFile>& file)
+{
     const auto& fileInfo = QFileInfo(file->filePath);
-    auto obfInfo = file->obfInfo;
+    auto obfInfo = file->obtainInfo();
     
-    auto fileIndex = _storedIndex->add_fileindex();
+    const auto fileIndex = std::make_shared<OBF::FileIndex>();
     auto d = obfInfo->creationTimestamp;
     if (d == 0)
     {
@@ -172,6 +372,8 @@ void OsmAnd::CachedOsmandIndexes_P::addToCache(const std::shared_ptr<const ObfFi
         for (auto node : detailedNodes)
             addRouteSubregion(routing, node, false);
     }
+
+    return fileIndex;
 }
 
 void OsmAnd::CachedOsmandIndexes_P::addRouteSubregion(OBF::RoutingPart* routing, std::shared_ptr<const ObfRoutingSectionLevelTreeNode>& node, bool base)
@@ -190,17 +392,17 @@ void OsmAnd::CachedOsmandIndexes_P::addRouteSubregion(OBF::RoutingPart* routing,
         rpart->set_shiftodata(0);
 }
 
-std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIndex(const std::shared_ptr<const OBF::FileIndex>& found)
+std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIndex(const OBF::FileIndex& found)
 {
     auto obfInfo = std::make_shared<ObfInfo>();
-    obfInfo->version = found->version();
-    obfInfo->creationTimestamp = found->datemodified();
+    obfInfo->version = found.version();
+    obfInfo->creationTimestamp = found.datemodified();
     
     Nullable<AreaI> globalBBox31;
     
-    for (int i = 0; i < found->mapindex_size(); i++)
+    for (int i = 0; i < found.mapindex_size(); i++)
     {
-        auto index = found->mapindex(i);
+        auto index = found.mapindex(i);
         Ref<ObfMapSectionInfo> mi(new ObfMapSectionInfo(obfInfo));
         mi->length = (unsigned int) index.size();
         mi->offset = (unsigned int) index.offset();
@@ -229,9 +431,9 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIn
         obfInfo->mapSections.push_back(qMove(mi));
     }
     
-    for (int i = 0; i < found->poiindex_size(); i++)
+    for (int i = 0; i < found.poiindex_size(); i++)
     {
-        auto index = found->poiindex(i);
+        auto index = found.poiindex(i);
         Ref<ObfPoiSectionInfo> mi(new ObfPoiSectionInfo(obfInfo));
         mi->length = (unsigned int) index.size();
         mi->offset = (unsigned int) index.offset();
@@ -245,9 +447,9 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIn
             globalBBox31 = mi->area31;
     }
     
-    for (int i = 0; i < found->transportindex_size(); i++)
+    for (int i = 0; i < found.transportindex_size(); i++)
     {
-        auto index = found->transportindex(i);
+        auto index = found.transportindex(i);
         Ref<ObfTransportSectionInfo> mi(new ObfTransportSectionInfo(obfInfo));
         mi->length = (unsigned int) index.size();
         mi->offset = (unsigned int) index.offset();
@@ -267,9 +469,9 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIn
             globalBBox31 = mi->_area31;
     }
     
-    for (int i = 0; i < found->routingindex_size(); i++)
+    for (int i = 0; i < found.routingindex_size(); i++)
     {
-        auto index = found->routingindex(i);
+        auto index = found.routingindex(i);
         Ref<ObfRoutingSectionInfo> mi(new ObfRoutingSectionInfo(obfInfo));
         mi->length = (unsigned int) index.size();
         mi->offset = (unsigned int) index.offset();
@@ -321,9 +523,9 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIn
         obfInfo->routingSections.push_back(qMove(mi));
     }
     
-    for (int i = 0; i < found->addressindex_size(); i++)
+    for (int i = 0; i < found.addressindex_size(); i++)
     {
-        auto index = found->addressindex(i);
+        auto index = found.addressindex(i);
         Ref<ObfAddressSectionInfo> mi(new ObfAddressSectionInfo(obfInfo));
         mi->length = (unsigned int) index.size();
         mi->offset = (unsigned int) index.offset();
@@ -350,91 +552,322 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::CachedOsmandIndexes_P::initFileIn
 
 const std::shared_ptr<OsmAnd::ObfFile> OsmAnd::CachedOsmandIndexes_P::getObfFile(const QString& filePath)
 {
-    //RandomAccessFile mf = new RandomAccessFile(f.getPath(), "r");
-    QFileInfo f(filePath);
-    std::shared_ptr<OBF::FileIndex> found = nullptr;
-    if (_storedIndex)
+    return getObfFiles(QStringList() << filePath, 1).first();
+}
+
+QList< std::shared_ptr<OsmAnd::ObfFile> > OsmAnd::CachedOsmandIndexes_P::getObfFiles(
+    const QStringList& filePaths,
+    const unsigned int maxConcurrentFiles)
+{
+    QVector< std::shared_ptr<ObfFile> > obfFiles(filePaths.size());
+
+    // Resolve everything that is already in cache
+    QStringList uncachedFilePaths;
+    QStringList uncachedCanonicalFilePaths;
+    QVector<int> uncachedFileIndices;
     {
-        for (int i = 0; i < _storedIndex->fileindex_size(); i++)
+        QMutexLocker scopedLocker(&_mutex);
+
+        for (int fileIdx = 0; fileIdx < filePaths.size(); fileIdx++)
         {
-            auto fi = _storedIndex->fileindex(i);
-            if (f.size() == fi.size() && f.fileName() == QString(fi.filename().c_str()))
+            const auto& filePath = filePaths[fileIdx];
+            const QFileInfo fileInfo(filePath);
+            const auto canonicalFilePath = getCanonicalFilePath(fileInfo);
+            const auto fileSize = static_cast<uint64_t>(fileInfo.size());
+
+            // Entries added in this session are newer than mapped ones
+            const auto citAddedFileIndex = _addedFileIndexes.constFind(canonicalFilePath);
+            if (citAddedFileIndex != _addedFileIndexes.cend() && citAddedFileIndex->fileIndex->size() == fileSize)
+            {
+                obfFiles[fileIdx] = createCachedObfFile(filePath, fileSize, *citAddedFileIndex);
+                continue;
+            }
+            if (const auto record = findMappedRecord(canonicalFilePath.toUtf8(), fileSize))
             {
-                // f.lastModified() == fi.getDateModified()
-                found = std::make_shared<OBF::FileIndex>(qMove(fi));
-                break;
+                obfFiles[fileIdx] = createCachedObfFile(filePath, fileSize, record);
+                continue;
             }
+
+            uncachedFilePaths.push_back(filePath);
+            uncachedCanonicalFilePaths.push_back(canonicalFilePath);
+            uncachedFileIndices.push_back(fileIdx);
         }
     }
-    std::shared_ptr<ObfFile> obfFile = nullptr;
-    if (!found)
+
+    // Parse the rest without holding the lock, and put all of them to cache at once
+    if (!uncachedFilePaths.isEmpty())
     {
-        Stopwatch totalStopwatch(true);
-        obfFile = std::make_shared<ObfFile>(filePath);
-        if (!ObfReader(obfFile).obtainInfo())
-        {
-            LogPrintf(LogSeverityLevel::Warning, "Failed to open OBF '%s'", qPrintable(filePath));
-        }
-        else
+        const auto parsedObfFiles = parseObfFiles(uncachedFilePaths, true, maxConcurrentFiles);
+
+        QHash<QString, AddedFileIndex> newFileIndexes;
+        for (int parsedFileIdx = 0; parsedFileIdx < parsedObfFiles.size(); parsedFileIdx++)
         {
-            addToCache(obfFile);
-            LogPrintf(LogSeverityLevel::Debug, "Initializing OBF '%s' %fs", qPrintable(filePath), totalStopwatch.elapsed());
+            const auto& parsedObfFile = parsedObfFiles[parsedFileIdx];
+
+            obfFiles[uncachedFileIndices[parsedFileIdx]] = parsedObfFile.obfFile;
+            if (parsedObfFile.fileIndex)
+            {
+                AddedFileIndex addedFileIndex;
+                addedFileIndex.fileIndex = parsedObfFile.fileIndex;
+                addedFileIndex.summary = parsedObfFile.summary;
+                newFileIndexes.insert(uncachedCanonicalFilePaths[parsedFileIdx], addedFileIndex);
+            }
         }
+
+        QMutexLocker scopedLocker(&_mutex);
+        addToCache(newFileIndexes);
     }
-    else
+
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (metricsRegistry.isEnabled())
     {
-        auto obfInfo = initFileIndex(found);
-        obfFile = std::make_shared<ObfFile>(filePath, obfInfo);
+        static const auto cachedCounter = metricsRegistry.obtainCounter(QLatin1String("obf_headers_cached_total"));
+        static const auto parsedCounter = metricsRegistry.obtainCounter(QLatin1String("obf_headers_parsed_total"));
+        cachedCounter->add(filePaths.size() - uncachedFilePaths.size());
+        parsedCounter->add(uncachedFilePaths.size());
     }
-    return obfFile;
+
+    return obfFiles.toList();
 }
 
-void OsmAnd::CachedOsmandIndexes_P::readFromFile(const QString& filePath, int version)
+void OsmAnd::CachedOsmandIndexes_P::parseObfFile(
+    const QString& filePath,
+    const bool createFileIndexes,
+    ParsedObfFile& outParsedObfFile)
 {
-    int fileDescriptor = open(filePath.toStdString().c_str(), O_RDONLY);
-    if (fileDescriptor < 0)
+    Stopwatch totalStopwatch(true);
+    outParsedObfFile.obfFile = std::make_shared<ObfFile>(filePath);
+    if (!ObfReader(outParsedObfFile.obfFile).obtainInfo())
     {
-        OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be open to read: %s", qPrintable(filePath));
+        LogPrintf(LogSeverityLevel::Warning, "Failed to open OBF '%s'", qPrintable(filePath));
         return;
     }
-    gpb::io::FileInputStream input(fileDescriptor);
-    gpb::io::CodedInputStream cis(&input);
-    cis.SetTotalBytesLimit(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
-    
-    Stopwatch totalStopwatch(true);
-    
-    _storedIndex.reset(new OsmAnd::OBF::OsmAndStoredIndex());
-    if (_storedIndex->MergeFromCodedStream(&cis))
+
+    if (createFileIndexes)
     {
-        if (_storedIndex->version() != version)
-        {
-            _storedIndex.reset();
-        }
-        else
+        // Summary is stored in cache as it would be decoded from it later
+        outParsedObfFile.fileIndex = createFileIndex(outParsedObfFile.obfFile);
+        outParsedObfFile.summary = ObfFile::Summary::fromInfo(*initFileIndex(*outParsedObfFile.fileIndex));
+    }
+    LogPrintf(LogSeverityLevel::Debug, "Initializing OBF '%s' %fs", qPrintable(filePath), totalStopwatch.elapsed());
+}
+
+QVector<OsmAnd::CachedOsmandIndexes_P::ParsedObfFile> OsmAnd::CachedOsmandIndexes_P::parseObfFiles(
+    const QStringList& filePaths,
+    const bool createFileIndexes,
+    const unsigned int maxConcurrentFiles)
+{
+    QVector<ParsedObfFile> parsedObfFiles(filePaths.size());
+    if (filePaths.isEmpty())
+        return parsedObfFiles;
+
+    // Each worker keeps only one file open at a time, so number of workers bounds number of open files
+    const auto workersCount = qMin(
+        maxConcurrentFiles > 0 ? static_cast<int>(maxConcurrentFiles) : QThread::idealThreadCount(),
+        filePaths.size());
+    if (workersCount <= 1)
+    {
+        for (int fileIdx = 0; fileIdx < filePaths.size(); fileIdx++)
+            parseObfFile(filePaths[fileIdx], createFileIndexes, parsedObfFiles[fileIdx]);
+        return parsedObfFiles;
+    }
+
+    // Workers take next file till all are taken. Every worker writes only own slot, and vector
+    // is not resized till all of them are done
+    QAtomicInt nextFileIdx(0);
+    const auto pParsedObfFiles = parsedObfFiles.data();
+    const auto parseFiles =
+        [&filePaths, createFileIndexes, pParsedObfFiles, &nextFileIdx]
+        ()
         {
-            _hasChanged = false;
-            OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Osmand Cache file initialized %s in %fs", qPrintable(filePath), totalStopwatch.elapsed());
-        }
+            for (auto fileIdx = nextFileIdx.fetchAndAddOrdered(1);
+                fileIdx < filePaths.size();
+                fileIdx = nextFileIdx.fetchAndAddOrdered(1))
+            {
+                parseObfFile(filePaths[fileIdx], createFileIndexes, pParsedObfFiles[fileIdx]);
+            }
+        };
+
+    // Pool is shared, so completion of own workers is awaited instead of whole pool. Calling thread works
+    // as well, so files are parsed even if all pooled threads are busy with other calls.
+    QSemaphore finishedWorkers;
+    auto& workerPool = getParsingWorkerPool();
+    for (auto workerIdx = 1; workerIdx < workersCount; workerIdx++)
+    {
+        workerPool.enqueue(new QRunnableFunctor(
+            [&parseFiles, &finishedWorkers]
+            (const QRunnableFunctor* const runnable)
+            {
+                parseFiles();
+                finishedWorkers.release();
+            }));
     }
-    else
+    parseFiles();
+    finishedWorkers.acquire(workersCount - 1);
+
+    return parsedObfFiles;
+}
+
+OsmAnd::Concurrent::WorkerPool& OsmAnd::CachedOsmandIndexes_P::getParsingWorkerPool()
+{
+    static Concurrent::WorkerPool parsingWorkerPool(
+        Concurrent::WorkerPool::Order::FIFO,
+        qMax(QThread::idealThreadCount() - 1, 1));
+    return parsingWorkerPool;
+}
+
+void OsmAnd::CachedOsmandIndexes_P::readFromFile(const QString& filePath, int version)
+{
+    Stopwatch totalStopwatch(true);
+
+    const auto mappedIndex = mapIndex(filePath, version);
+
+    QMutexLocker scopedLocker(&_mutex);
+
+    _mappedIndex = mappedIndex;
+    _addedFileIndexes.clear();
+    if (!_mappedIndex)
     {
-        _storedIndex.reset();
+        _dateCreated = QDateTime::currentMSecsSinceEpoch();
+        _hasChanged = true;
+        return;
     }
+
+    _dateCreated = _mappedIndex->header->dateCreated;
+    _hasChanged = false;
+    OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Osmand Cache file initialized %s in %fs", qPrintable(filePath), totalStopwatch.elapsed());
 }
 
 void OsmAnd::CachedOsmandIndexes_P::writeToFile(const QString& filePath)
 {
-    if (_storedIndex && _hasChanged)
+    QMutexLocker scopedLocker(&_mutex);
+
+    if (!_hasChanged)
+        return;
+
+    struct Entry
+    {
+        QByteArray name;
+        uint64_t fileSize;
+        int64_t dateModified;
+        uint32_t version;
+        QByteArray fileIndex;
+        std::shared_ptr<const ObfFile::Summary> summary;
+    };
+    QList<Entry> entries;
+
+    // Mapped entries are copied as-is, unless superseded by ones added in this session
+    if (_mappedIndex)
     {
-        int fileDescriptor = open(filePath.toStdString().c_str(), O_RDWR);
-        if (fileDescriptor < 0) {
-            OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be written: %s", qPrintable(filePath));
-            return;
+        for (auto recordIdx = 0u; recordIdx < _mappedIndex->header->filesCount; recordIdx++)
+        {
+            const auto& record = _mappedIndex->records[recordIdx];
+            const auto name = _mappedIndex->getName(record);
+            if (name.isEmpty() || _addedFileIndexes.contains(QString::fromUtf8(name)))
+                continue;
+            const auto fileIndexData = _mappedIndex->getFileIndexData(record);
+            if (fileIndexData.isEmpty())
+                continue;
+
+            Entry entry;
+            entry.name = QByteArray(name.constData(), name.size());
+            entry.fileSize = record.fileSize;
+            entry.dateModified = record.dateModified;
+            entry.version = record.version;
+            entry.fileIndex = fileIndexData;
+            entry.summary = readSummary(record);
+            entries.push_back(entry);
         }
-        
-        gpb::io::FileOutputStream output(fileDescriptor);
-        if (!_storedIndex->SerializeToZeroCopyStream(&output))
-            OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be serialized: %s", qPrintable(filePath));
     }
-}
+    for (const auto& itAddedFileIndex : rangeOf(constOf(_addedFileIndexes)))
+    {
+        const auto& fileIndex = itAddedFileIndex.value().fileIndex;
+
+        Entry entry;
+        entry.name = itAddedFileIndex.key().toUtf8();
+        entry.fileSize = fileIndex->size();
+        entry.dateModified = fileIndex->datemodified();
+        entry.version = fileIndex->version();
+        entry.fileIndex = QByteArray::fromStdString(fileIndex->SerializeAsString());
+        entry.summary = itAddedFileIndex.value().summary;
+        entries.push_back(entry);
+    }
 
+    // Keep load factor of hash table at most 1/2
+    uint32_t bucketsCount = 8;
+    while (bucketsCount < static_cast<uint32_t>(entries.size()) * 2)
+        bucketsCount <<= 1;
+
+    const auto bucketsOffset = sizeof(FileHeader);
+    const auto recordsOffset = bucketsOffset + bucketsCount * sizeof(uint32_t);
+    auto blobsSize = 0ull;
+    for (const auto& entry : constOf(entries))
+        blobsSize += entry.name.size() + entry.fileIndex.size();
+    const auto blobsOffset = recordsOffset + entries.size() * sizeof(FileRecord);
+    if (blobsOffset + blobsSize > std::numeric_limits<uint32_t>::max())
+    {
+        OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file is too large to be written: %s", qPrintable(filePath));
+        return;
+    }
+
+    QByteArray data(static_cast<int>(blobsOffset + blobsSize), '\0');
+    const auto pData = reinterpret_cast<uchar*>(data.data());
+
+    const auto header = reinterpret_cast<FileHeader*>(pData);
+    std::memcpy(header->magic, CachedOsmandIndexesMagic, sizeof(CachedOsmandIndexesMagic));
+    header->version = CachedOsmandIndexes::VERSION;
+    header->filesCount = entries.size();
+    header->bucketsCount = bucketsCount;
+    header->dateCreated = _dateCreated;
+
+    const auto buckets = reinterpret_cast<uint32_t*>(pData + bucketsOffset);
+    const auto records = reinterpret_cast<FileRecord*>(pData + recordsOffset);
+    auto blobOffset = static_cast<uint32_t>(blobsOffset);
+    for (int entryIdx = 0; entryIdx < entries.size(); entryIdx++)
+    {
+        const auto& entry = entries[entryIdx];
+        auto& record = records[entryIdx];
+
+        record.nameHash = hashFilePath(entry.name);
+        record.fileSize = entry.fileSize;
+        record.dateModified = entry.dateModified;
+        record.version = entry.version;
+        writeSummary(*entry.summary, record);
+
+        record.nameOffset = blobOffset;
+        record.nameLength = entry.name.size();
+        std::memcpy(pData + blobOffset, entry.name.constData(), entry.name.size());
+        blobOffset += entry.name.size();
+
+        record.fileIndexOffset = blobOffset;
+        record.fileIndexLength = entry.fileIndex.size();
+        std::memcpy(pData + blobOffset, entry.fileIndex.constData(), entry.fileIndex.size());
+        blobOffset += entry.fileIndex.size();
+
+        auto bucketIdx = static_cast<uint32_t>(record.nameHash) & (bucketsCount - 1);
+        while (buckets[bucketIdx] != 0)
+            bucketIdx = (bucketIdx + 1) & (bucketsCount - 1);
+        buckets[bucketIdx] = entryIdx + 1;
+    }
+
+    // Mapped file can't be replaced on some platforms (Windows), so mapping is released first. Everything needed
+    // from it was copied above, and cached ObfFiles hold own copies of their indexes.
+    const auto mappedFilePath = _mappedIndex ? _mappedIndex->file.fileName() : QString();
+    _mappedIndex.reset();
+
+    // Cache is replaced atomically, so that concurrent or interrupted writer never leaves it half-written
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+    {
+        OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be written: %s", qPrintable(filePath));
+        if (!mappedFilePath.isEmpty())
+            _mappedIndex = mapIndex(mappedFilePath, CachedOsmandIndexes::VERSION);
+        return;
+    }
+
+    // Written file holds everything, so lookups continue from it
+    _mappedIndex = mapIndex(filePath, CachedOsmandIndexes::VERSION);
+    if (_mappedIndex)
+        _addedFileIndexes.clear();
+    _hasChanged = false;
+}
@@ -7,22 +7,33 @@
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QFileInfo>
+#include <QFile>
+#include <QByteArray>
 #include "restore_internal_warnings.h"
 
 #include "ignore_warnings_on_external_includes.h"
 #include "osmand_index.pb.h"
-#include <google/protobuf/io/coded_stream.h>
-#include <google/protobuf/io/zero_copy_stream.h>
-#include <google/protobuf/wire_format_lite.h>
 #include "restore_internal_warnings.h"
 
 #include "OsmAndCore.h"
 #include "PrivateImplementation.h"
+#include "ObfFile.h"
 
 namespace OsmAnd
 {
     namespace gpb = google::protobuf;
 
+    namespace Concurrent
+    {
+        class WorkerPool;
+    }
+
     class ObfFile;
     class ObfInfo;
     class ObfRoutingSectionLevelTreeNode;
@@ -32,13 +43,111 @@ namespace OsmAnd
     {
         Q_DISABLE_COPY_AND_MOVE(CachedOsmandIndexes_P);
 
+    public:
+        struct ParsedObfFile
+        {
+            std::shared_ptr<ObfFile> obfFile;
+            std::shared_ptr<OBF::FileIndex> fileIndex;
+            std::shared_ptr<const ObfFile::Summary> summary;
+        };
+
     private:
-        std::shared_ptr<OBF::OsmAndStoredIndex> _storedIndex;
+        // On-disk layout, all values are in native byte order since cache never leaves the device:
+        //  - FileHeader;
+        //  - hash table of FileHeader::bucketsCount buckets, each holding 1-based index of FileRecord
+        //    (0 for empty bucket), with linear probing by hash of canonical file path;
+        //  - FileHeader::filesCount FileRecords;
+        //  - blob area with UTF-8 canonical file paths and serialized OBF::FileIndex of every file.
+        // All parts are naturally aligned, so that mapped file is accessed in place without any parsing.
+        struct FileHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t filesCount;
+            uint32_t bucketsCount;
+            int64_t dateCreated;
+            uint64_t reserved;
+        };
+        struct FileRecord
+        {
+            uint64_t nameHash;
+            uint64_t fileSize;
+            // Creation timestamp of OBF, or its modification time if OBF doesn't have one
+            int64_t dateModified;
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint32_t fileIndexOffset;
+            uint32_t fileIndexLength;
+            uint32_t version;
+
+            // ObfFile::Summary, so that it's served without decoding serialized OBF::FileIndex
+            uint8_t dataTypes;
+            uint8_t flags;
+            uint8_t minMapZoom;
+            uint8_t maxMapZoom;
+            int32_t bboxTop31;
+            int32_t bboxLeft31;
+            int32_t bboxBottom31;
+            int32_t bboxRight31;
+        };
+        enum FileRecordFlag : uint8_t
+        {
+            IsBasemap = 1u << 0,
+            IsBasemapWithCoastlines = 1u << 1,
+        };
+
+        struct MappedIndex
+        {
+            MappedIndex();
+            ~MappedIndex();
+
+            QFile file;
+            const uchar* data;
+            qint64 size;
+            const FileHeader* header;
+            const uint32_t* buckets;
+            const FileRecord* records;
+
+            QByteArray getName(const FileRecord& record) const;
+            QByteArray getFileIndexData(const FileRecord& record) const;
+        };
+
+        // Added entries are keyed by canonical file path, as well as mapped ones
+        struct AddedFileIndex
+        {
+            std::shared_ptr<const OBF::FileIndex> fileIndex;
+            std::shared_ptr<const ObfFile::Summary> summary;
+        };
+
+        mutable QMutex _mutex;
+        std::shared_ptr<const MappedIndex> _mappedIndex;
+        QHash<QString, AddedFileIndex> _addedFileIndexes;
+        int64_t _dateCreated;
         bool _hasChanged;
 
-        void addToCache(const std::shared_ptr<const ObfFile>& file);
-        void addRouteSubregion(OBF::RoutingPart* routing, std::shared_ptr<const ObfRoutingSectionLevelTreeNode>& sub, bool base);
-        std::shared_ptr<const ObfInfo> initFileIndex(const std::shared_ptr<const OBF::FileIndex>& found);
+        const FileRecord* findMappedRecord(const QByteArray& canonicalFilePath, const uint64_t fileSize) const;
+        std::shared_ptr<ObfFile> createCachedObfFile(
+            const QString& filePath,
+            const uint64_t fileSize,
+            const FileRecord* const record) const;
+        std::shared_ptr<ObfFile> createCachedObfFile(
+            const QString& filePath,
+            const uint64_t fileSize,
+            const AddedFileIndex& addedFileIndex) const;
+        void addToCache(const QHash<QString, AddedFileIndex>& addedFileIndexes);
+
+        static uint64_t hashFilePath(const QByteArray& canonicalFilePath);
+        static QString getCanonicalFilePath(const QFileInfo& fileInfo);
+        static std::shared_ptr<const ObfFile::Summary> readSummary(const FileRecord& record);
+        static void writeSummary(const ObfFile::Summary& summary, FileRecord& record);
+        static std::shared_ptr<MappedIndex> mapIndex(const QString& filePath, const int version);
+        static std::shared_ptr<OBF::FileIndex> createFileIndex(const std::shared_ptr<const ObfFile>& file);
+        static void addRouteSubregion(OBF::RoutingPart* routing, std::shared_ptr<const ObfRoutingSectionLevelTreeNode>& sub, bool base);
+        static std::shared_ptr<const ObfInfo> initFileIndex(const OBF::FileIndex& found);
+        static void parseObfFile(const QString& filePath, const bool createFileIndexes, ParsedObfFile& outParsedObfFile);
+
+        // Workers are shared by all parsing calls, so that each of them doesn't spawn own threads
+        static Concurrent::WorkerPool& getParsingWorkerPool();
 
     protected:
         CachedOsmandIndexes_P(CachedOsmandIndexes* const owner);
@@ -48,9 +157,15 @@ namespace OsmAnd
         ImplementationInterface<CachedOsmandIndexes> owner;
         
         const std::shared_ptr<ObfFile> getObfFile(const QString& filePath);
+        QList< std::shared_ptr<ObfFile> > getObfFiles(const QStringList& filePaths, const unsigned int maxConcurrentFiles);
         void readFromFile(const QString& filePath, int version);
         void writeToFile(const QString& filePath);
-        
+
+        static QVector<ParsedObfFile> parseObfFiles(
+            const QStringList& filePaths,
+            const bool createFileIndexes,
+            const unsigned int maxConcurrentFiles);
+
     friend class OsmAnd::CachedOsmandIndexes;
     };
 }
@@ -1,6 +1,8 @@
 #include "WorkerPool.h"
 #include "WorkerPool_P.h"
 
+const OsmAnd::Concurrent::WorkerPool::Affinity OsmAnd::Concurrent::WorkerPool::NoAffinity = 0;
+
 OsmAnd::Concurrent::WorkerPool::WorkerPool(
     const Order order /*= Order::FIFO*/,
     const int maxThreadCount /*= QThread::idealThreadCount()*/)
@@ -53,6 +55,19 @@ void OsmAnd::Concurrent::WorkerPool::enqueue(const QVector<QRunnable*>& runnable
     _p->enqueue(runnables, predicate);
 }
 
+void OsmAnd::Concurrent::WorkerPool::enqueue(
+    QRunnable* const runnable,
+    const Priority priority,
+    const Affinity affinity /*= NoAffinity*/)
+{
+    _p->enqueue(runnable, priority, affinity);
+}
+
+bool OsmAnd::Concurrent::WorkerPool::updatePriority(QRunnable* const runnable, const Priority priority)
+{
+    return _p->updatePriority(runnable, priority);
+}
+
 bool OsmAnd::Concurrent::WorkerPool::dequeue(QRunnable* const runnable, const SortPredicate predicate /*= nullptr*/)
 {
     return _p->dequeue(runnable, predicate);
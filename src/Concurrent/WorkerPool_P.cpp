@@ -7,12 +7,23 @@
 #include "Logging.h"
 
 OsmAnd::Concurrent::WorkerPool_P::WorkerPool_P(WorkerPool* const owner_, const Order order_, const int maxThreadCount_)
-    : _order(static_cast<int>(order_))
+    : _nextLaneIndex(0)
+    , _sequence(0)
+    , _order(static_cast<int>(order_))
     , _maxThreadCount(maxThreadCount_)
+    , _queuedCount(0)
+    , _activeThreadsCount(0)
+    , _sleepingThreadsCount(0)
+    , _threadsCount(0)
     , _isBeingReset(false)
+    , _createdThreadsCount(0)
     , owner(owner_)
 {
-    _queue.reserve(1024);
+    // Number of lanes is fixed, so if more threads are allowed later, some of them share lanes
+    const auto lanesCount = qMax(1, maxThreadCount_ > 0 ? maxThreadCount_ : QThread::idealThreadCount());
+    _lanes.reserve(lanesCount);
+    for (auto laneIdx = 0; laneIdx < lanesCount; laneIdx++)
+        _lanes.push_back(std::unique_ptr<Lane>(new Lane()));
 }
 
 OsmAnd::Concurrent::WorkerPool_P::~WorkerPool_P()
@@ -37,209 +48,491 @@ int OsmAnd::Concurrent::WorkerPool_P::maxThreadCount() const
 void OsmAnd::Concurrent::WorkerPool_P::setMaxThreadCount(int maxThreadCount)
 {
     const auto oldMaxThreadCount = _maxThreadCount.fetchAndStoreOrdered(maxThreadCount);
-    if (maxThreadCount > 0 && oldMaxThreadCount <= maxThreadCount)
+
+    // When limit is lowered, threads above it just fail to become active
+    if (maxThreadCount > 0 && oldMaxThreadCount > 0 && maxThreadCount <= oldMaxThreadCount)
         return;
 
     QMutexLocker scopedLocker(&_mutex);
-    tryLaunchNextRunnables();
+
+    if (_isBeingReset)
+        return;
+    _workAvailable.wakeAll();
+    while (_queuedCount > _threadsCount - _activeThreadsCount &&
+        (maxThreadCount <= 0 || _threadsCount < maxThreadCount))
+    {
+        createNewThreadNoLock();
+    }
 }
 
 unsigned int OsmAnd::Concurrent::WorkerPool_P::activeThreadCount() const
 {
-    QMutexLocker scopedLocker(&_mutex);
-
-    return activeThreadCountNoLock();
+    return _activeThreadsCount;
 }
 
 bool OsmAnd::Concurrent::WorkerPool_P::waitForDone(const int msecs) const
 {
     QMutexLocker scopedLocker(&_mutex);
-    
-    return waitForDoneNoLock(msecs);
+
+    if (msecs < 0)
+    {
+        while (!isDone())
+            _threadFreed.wait(&_mutex);
+    }
+    else
+    {
+        QElapsedTimer waitTimer;
+        waitTimer.start();
+        int timeLeft;
+        while (!isDone() && ((timeLeft = msecs - waitTimer.elapsed()) > 0))
+            _threadFreed.wait(&_mutex, timeLeft);
+    }
+
+    return isDone();
 }
 
 void OsmAnd::Concurrent::WorkerPool_P::enqueue(QRunnable* const runnable, const SortPredicate predicate)
 {
-    QMutexLocker scopedLocker(&_mutex);
-    
-    _queue.push_front(runnable);
+    QueueEntry entry;
+    entry.runnable = runnable;
+    entry.affinity = WorkerPool::NoAffinity;
+    insertEntry(entry, 0);
     if (predicate)
-        sortQueueNoLock(predicate);
+        sortQueue(predicate);
 
-    tryLaunchNextRunnable();
+    wakeOrCreateThread();
 }
 
 void OsmAnd::Concurrent::WorkerPool_P::enqueue(const QVector<QRunnable*>& runnables, const SortPredicate predicate)
 {
-    QMutexLocker scopedLocker(&_mutex);
-
     for (const auto& runnable : constOf(runnables))
-        _queue.push_front(runnable);
+    {
+        QueueEntry entry;
+        entry.runnable = runnable;
+        entry.affinity = WorkerPool::NoAffinity;
+        insertEntry(entry, 0);
+    }
     if (predicate)
-        sortQueueNoLock(predicate);
+        sortQueue(predicate);
+
+    for (auto idx = 0; idx < runnables.size(); idx++)
+        wakeOrCreateThread();
+}
 
-    tryLaunchNextRunnable();
+void OsmAnd::Concurrent::WorkerPool_P::enqueue(
+    QRunnable* const runnable,
+    const Priority priority,
+    const Affinity affinity)
+{
+    QueueEntry entry;
+    entry.runnable = runnable;
+    entry.affinity = affinity;
+    insertEntry(entry, priority);
+
+    wakeOrCreateThread();
+}
+
+bool OsmAnd::Concurrent::WorkerPool_P::updatePriority(QRunnable* const runnable, const Priority priority)
+{
+    for (const auto& lane : _lanes)
+    {
+        QMutexLocker scopedLocker(&lane->mutex);
+
+        QueueKey key;
+        QueueEntry entry;
+        if (!lane->remove(runnable, &key, &entry))
+            continue;
+
+        key.priority = priority;
+        lane->insert(key, entry);
+        return true;
+    }
+
+    return false;
 }
 
 bool OsmAnd::Concurrent::WorkerPool_P::dequeue(QRunnable* const runnable, const SortPredicate predicate)
 {
-    QMutexLocker scopedLocker(&_mutex);
-    
-    const auto result = _queue.removeOne(runnable);
-    if (result && predicate)
-        sortQueueNoLock(predicate);
+    // Removal does not change order of the rest, so there's nothing to sort
+    Q_UNUSED(predicate);
+
+    for (const auto& lane : _lanes)
+    {
+        {
+            QMutexLocker scopedLocker(&lane->mutex);
 
-    return result;
+            if (!lane->remove(runnable))
+                continue;
+            _queuedCount--;
+        }
+
+        notifyIfDone();
+        return true;
+    }
+
+    return false;
 }
 
 void OsmAnd::Concurrent::WorkerPool_P::dequeueAll()
 {
-    QMutexLocker scopedLocker(&_mutex);
+    QVector<QueueEntry> entries;
+    for (const auto& lane : _lanes)
+    {
+        QMutexLocker scopedLocker(&lane->mutex);
+
+        const auto oldEntriesCount = entries.size();
+        lane->clear(&entries);
+        _queuedCount -= entries.size() - oldEntriesCount;
+    }
+
+    for (const auto& entry : constOf(entries))
+    {
+        if (entry.runnable->autoDelete())
+            delete entry.runnable;
+    }
 
-    dequeueAllNoLock();
+    notifyIfDone();
 }
 
 void OsmAnd::Concurrent::WorkerPool_P::sortQueue(const SortPredicate predicate)
 {
-    QMutexLocker scopedLocker(&_mutex);
+    // All lanes are locked in same order, so this can't deadlock with another sort
+    for (const auto& lane : _lanes)
+        lane->mutex.lock();
+
+    QVector< std::pair<Lane*, QueueEntry> > entries;
+    entries.reserve(_queuedCount);
+    for (const auto& lane : _lanes)
+    {
+        QVector<QueueEntry> laneEntries;
+        lane->clear(&laneEntries);
+        for (const auto& entry : constOf(laneEntries))
+            entries.push_back(std::make_pair(lane.get(), entry));
+    }
 
-    sortQueueNoLock(predicate);
+    std::stable_sort(entries.begin(), entries.end(),
+        [predicate]
+        (const std::pair<Lane*, QueueEntry>& l, const std::pair<Lane*, QueueEntry>& r) -> bool
+        {
+            return predicate(l.second.runnable, r.second.runnable);
+        });
+
+    // Sorted queue used to be taken from its front in FIFO order and from its back in LIFO order
+    const auto order = this->order();
+    for (auto entryIdx = 0; entryIdx < entries.size(); entryIdx++)
+    {
+        QueueKey key;
+        key.priority = (order == Order::LIFO) ? entryIdx : -entryIdx;
+        key.sequence = nextSequence();
+        entries[entryIdx].first->insert(key, entries[entryIdx].second);
+    }
+
+    for (const auto& lane : _lanes)
+        lane->mutex.unlock();
 }
 
 void OsmAnd::Concurrent::WorkerPool_P::reset()
 {
-    QMutexLocker scopedLocker(&_mutex);
+    dequeueAll();
+    waitForDone(-1);
 
-    dequeueAllNoLock();
-    REPEAT_UNTIL(waitForDoneNoLock(-1));
-    _isBeingReset = true;
-    while (!_allThreads.isEmpty())
+    QList<WorkerThread*> threads;
     {
-        const auto thread = _freeThreads.head();
-        scopedLocker.unlock();
+        QMutexLocker scopedLocker(&_mutex);
 
-        thread->wakeup.wakeOne();
+        _isBeingReset = true;
+        _workAvailable.wakeAll();
+        threads = _allThreads;
+    }
+
+    for (const auto thread : constOf(threads))
+    {
         thread->wait();
         delete thread;
+    }
 
-        scopedLocker.relock();
+    {
+        QMutexLocker scopedLocker(&_mutex);
+
+        _allThreads.clear();
+        _threadsCount = 0;
+        _isBeingReset = false;
+    }
+}
+
+int64_t OsmAnd::Concurrent::WorkerPool_P::nextSequence()
+{
+    const auto sequence = ++_sequence;
+    switch (order())
+    {
+        case Order::LIFO:
+            return -sequence;
+        case Order::Random:
+            return (static_cast<int64_t>(qrand()) << 32) | (sequence & 0xFFFFFFFF);
+        case Order::FIFO:
+        default:
+            return sequence;
     }
-    _isBeingReset = false;
 }
 
-unsigned int OsmAnd::Concurrent::WorkerPool_P::activeThreadCountNoLock() const
+unsigned int OsmAnd::Concurrent::WorkerPool_P::selectLane(const Affinity affinity)
 {
-    return _allThreads.count() - _freeThreads.count() - _inactiveThreads.count();
+    const auto lanesCount = static_cast<unsigned int>(_lanes.size());
+    if (affinity != WorkerPool::NoAffinity)
+        return static_cast<unsigned int>(affinity % lanesCount);
+
+    // Runnables enqueued from worker of this pool are kept on its lane
+    const auto currentWorkerThread = dynamic_cast<WorkerThread*>(QThread::currentThread());
+    if (currentWorkerThread && currentWorkerThread->pool == this)
+        return currentWorkerThread->laneIndex;
+
+    return _nextLaneIndex++ % lanesCount;
 }
 
-void OsmAnd::Concurrent::WorkerPool_P::createNewThread()
+void OsmAnd::Concurrent::WorkerPool_P::insertEntry(const QueueEntry& entry, const Priority priority)
 {
-    const auto thread = new WorkerThread(this);
+    QueueKey key;
+    key.priority = priority;
+    key.sequence = nextSequence();
+
+    const auto& lane = _lanes[selectLane(entry.affinity)];
+    QMutexLocker scopedLocker(&lane->mutex);
+
+    lane->insert(key, entry);
+    _queuedCount++;
+}
+
+void OsmAnd::Concurrent::WorkerPool_P::createNewThreadNoLock()
+{
+    const auto laneIndex = _createdThreadsCount++ % static_cast<unsigned int>(_lanes.size());
+    const auto thread = new WorkerThread(this, laneIndex);
 
     thread->setObjectName(QLatin1String("Worker (pooled)"));
-    _allThreads.insert(thread);
-    _freeThreads.enqueue(thread);
+    _allThreads.push_back(thread);
+    _threadsCount++;
 
     thread->start();
 }
 
-bool OsmAnd::Concurrent::WorkerPool_P::tryLaunchNextRunnable()
+void OsmAnd::Concurrent::WorkerPool_P::wakeOrCreateThread()
 {
-    // In case there are no threads, create new one
-    if (_allThreads.isEmpty())
+    // Sleeping thread re-checks queue after it's counted as sleeping, so it either sees new runnable or is seen here
+    if (_sleepingThreadsCount > 0)
     {
-        createNewThread();
-        return true;
+        QMutexLocker scopedLocker(&_mutex);
+        _workAvailable.wakeOne();
+        return;
+    }
+
+    // Threads that are neither active nor sleeping are about to take next runnable
+    const auto maxThreadCount = this->maxThreadCount();
+    if (maxThreadCount > 0 && _threadsCount >= maxThreadCount)
+        return;
+    if (_threadsCount - _activeThreadsCount >= _queuedCount)
+        return;
+
+    QMutexLocker scopedLocker(&_mutex);
+
+    if (_isBeingReset || (maxThreadCount > 0 && _threadsCount >= maxThreadCount))
+        return;
+    createNewThreadNoLock();
+}
+
+bool OsmAnd::Concurrent::WorkerPool_P::tryAcquireActiveSlot()
+{
+    const auto maxThreadCount = this->maxThreadCount();
+    auto activeThreadsCount = _activeThreadsCount.load();
+    do
+    {
+        if (maxThreadCount > 0 && activeThreadsCount >= maxThreadCount)
+            return false;
+    } while (!_activeThreadsCount.compare_exchange_weak(activeThreadsCount, activeThreadsCount + 1));
+
+    return true;
+}
+
+void OsmAnd::Concurrent::WorkerPool_P::releaseActiveSlot()
+{
+    _activeThreadsCount--;
+
+    // Thread may sleep only because limit of active threads was reached
+    if (_queuedCount > 0 && _sleepingThreadsCount > 0)
+    {
+        QMutexLocker scopedLocker(&_mutex);
+        _workAvailable.wakeOne();
     }
 
-    // Check if max threads limit is not reached
-    if (tooManyThreadsActive())
+    notifyIfDone();
+}
+
+bool OsmAnd::Concurrent::WorkerPool_P::takeNextEntry(const unsigned int laneIndex, QueueEntry& outEntry)
+{
+    if (_queuedCount <= 0)
         return false;
 
-    // If free thread is available, use it
-    if (!_freeThreads.isEmpty())
     {
-        _freeThreads.head()->wakeup.wakeOne();
-        return true;
+        const auto& ownLane = _lanes[laneIndex];
+        QMutexLocker scopedLocker(&ownLane->mutex);
+
+        if (ownLane->takeBest(true, true, outEntry))
+        {
+            _queuedCount--;
+            return true;
+        }
     }
 
-    // If inactive thread is available, use it
-    if (!_inactiveThreads.isEmpty())
+    return stealEntry(laneIndex, false, outEntry) || stealEntry(laneIndex, true, outEntry);
+}
+
+bool OsmAnd::Concurrent::WorkerPool_P::stealEntry(const unsigned int laneIndex, const bool affine, QueueEntry& outEntry)
+{
+    // Find lane which best runnable has highest priority, and take whatever is best there by the time it's locked
+    const auto lanesCount = static_cast<unsigned int>(_lanes.size());
+    Lane* pVictimLane = nullptr;
+    QueueKey victimKey;
+    for (auto laneOffset = 1u; laneOffset < lanesCount; laneOffset++)
     {
-        _inactiveThreads.head()->wakeup.wakeOne();
-        return true;
+        const auto& lane = _lanes[(laneIndex + laneOffset) % lanesCount];
+        QMutexLocker scopedLocker(&lane->mutex);
+
+        const auto queue = lane->selectQueue(!affine, affine);
+        if (!queue)
+            continue;
+        const auto& key = queue->begin()->first;
+        if (!pVictimLane || key < victimKey)
+        {
+            pVictimLane = lane.get();
+            victimKey = key;
+        }
     }
+    if (!pVictimLane)
+        return false;
+
+    QMutexLocker scopedLocker(&pVictimLane->mutex);
+    if (!pVictimLane->takeBest(!affine, affine, outEntry))
+        return false;
+    _queuedCount--;
 
-    // Otherwise, just start new thread
-    createNewThread();
     return true;
 }
 
-void OsmAnd::Concurrent::WorkerPool_P::tryLaunchNextRunnables()
+void OsmAnd::Concurrent::WorkerPool_P::sleep()
 {
-    while (!_queue.isEmpty() && tryLaunchNextRunnable());
+    QMutexLocker scopedLocker(&_mutex);
+
+    if (_isBeingReset)
+        return;
+
+    _sleepingThreadsCount++;
+    const auto maxThreadCount = this->maxThreadCount();
+    const auto canRun = _queuedCount > 0 && (maxThreadCount <= 0 || _activeThreadsCount < maxThreadCount);
+    if (!canRun)
+        _workAvailable.wait(&_mutex);
+    _sleepingThreadsCount--;
 }
 
-QRunnable* OsmAnd::Concurrent::WorkerPool_P::takeNextRunnable()
+void OsmAnd::Concurrent::WorkerPool_P::notifyIfDone()
 {
-    if (_queue.isEmpty())
-        return nullptr;
+    if (!isDone())
+        return;
 
-    switch (order())
-    {
-        case Order::FIFO:
-            return _queue.takeFirst();
-        case Order::LIFO:
-            return _queue.takeLast();
-        case Order::Random:
-            return _queue.takeAt(qrand() % _queue.size());
-        default:
-            return nullptr;
-    }
+    QMutexLocker scopedLocker(&_mutex);
+    _threadFreed.wakeAll();
 }
 
-bool OsmAnd::Concurrent::WorkerPool_P::tooManyThreadsActive() const
+bool OsmAnd::Concurrent::WorkerPool_P::isDone() const
 {
-    const auto maxThreadCount = this->maxThreadCount();
-    return maxThreadCount > 0 && activeThreadCountNoLock() >= maxThreadCount;
+    return _queuedCount == 0 && _activeThreadsCount == 0;
 }
 
-void OsmAnd::Concurrent::WorkerPool_P::dequeueAllNoLock()
+void OsmAnd::Concurrent::WorkerPool_P::Lane::insert(const QueueKey& key, const QueueEntry& entry)
 {
-    for (auto runnable : _queue)
-    {
-        if (runnable->autoDelete())
-            delete runnable;
-    }
-    _queue.clear();
+    const auto queue = (entry.affinity != WorkerPool::NoAffinity) ? &affineQueue : &sharedQueue;
+
+    Location location;
+    location.queue = queue;
+    location.itEntry = queue->insert(std::make_pair(key, entry)).first;
+    locations.insertMulti(entry.runnable, location);
 }
 
-bool OsmAnd::Concurrent::WorkerPool_P::waitForDoneNoLock(const int msecs) const
+bool OsmAnd::Concurrent::WorkerPool_P::Lane::remove(
+    QRunnable* const runnable,
+    QueueKey* const pOutKey /*= nullptr*/,
+    QueueEntry* const pOutEntry /*= nullptr*/)
 {
-    if (msecs < 0)
-    {
-        while (activeThreadCountNoLock() != 0 || !_queue.isEmpty())
-            REPEAT_UNTIL(_threadFreed.wait(&_mutex));
-    }
-    else
+    const auto itLocation = locations.find(runnable);
+    if (itLocation == locations.end())
+        return false;
+    const auto location = *itLocation;
+    locations.erase(itLocation);
+
+    if (pOutKey)
+        *pOutKey = location.itEntry->first;
+    if (pOutEntry)
+        *pOutEntry = location.itEntry->second;
+    location.queue->erase(location.itEntry);
+
+    return true;
+}
+
+OsmAnd::Concurrent::WorkerPool_P::Queue* OsmAnd::Concurrent::WorkerPool_P::Lane::selectQueue(
+    const bool includeShared,
+    const bool includeAffine)
+{
+    Queue* queue = nullptr;
+    if (includeShared && !sharedQueue.empty())
+        queue = &sharedQueue;
+    if (includeAffine && !affineQueue.empty() && (!queue || affineQueue.begin()->first < queue->begin()->first))
+        queue = &affineQueue;
+
+    return queue;
+}
+
+bool OsmAnd::Concurrent::WorkerPool_P::Lane::takeBest(
+    const bool includeShared,
+    const bool includeAffine,
+    QueueEntry& outEntry)
+{
+    const auto queue = selectQueue(includeShared, includeAffine);
+    if (!queue)
+        return false;
+    const auto itEntry = queue->begin();
+    outEntry = itEntry->second;
+
+    // Same runnable may be queued several times, so exactly this entry has to be unregistered
+    auto itLocation = locations.find(outEntry.runnable);
+    while (itLocation != locations.end() && itLocation.key() == outEntry.runnable)
     {
-        QElapsedTimer waitTimer;
-        waitTimer.start();
-        int timeLeft;
-        while ((activeThreadCountNoLock() != 0 || !_queue.isEmpty()) && ((timeLeft = msecs - waitTimer.elapsed()) > 0))
-            _threadFreed.wait(&_mutex, timeLeft);
+        if (itLocation->itEntry == itEntry)
+        {
+            locations.erase(itLocation);
+            break;
+        }
+        ++itLocation;
     }
+    queue->erase(itEntry);
 
-    return activeThreadCountNoLock() == 0 && _queue.isEmpty();
+    return true;
 }
 
-void OsmAnd::Concurrent::WorkerPool_P::sortQueueNoLock(const SortPredicate predicate)
+void OsmAnd::Concurrent::WorkerPool_P::Lane::clear(QVector<QueueEntry>* const pOutEntries /*= nullptr*/)
 {
-    std::sort(_queue, predicate);
+    if (pOutEntries)
+    {
+        for (const auto& queuedEntry : constOf(sharedQueue))
+            pOutEntries->push_back(queuedEntry.second);
+        for (const auto& queuedEntry : constOf(affineQueue))
+            pOutEntries->push_back(queuedEntry.second);
+    }
+
+    sharedQueue.clear();
+    affineQueue.clear();
+    locations.clear();
 }
 
-OsmAnd::Concurrent::WorkerPool_P::WorkerThread::WorkerThread(WorkerPool_P* const pool_)
+OsmAnd::Concurrent::WorkerPool_P::WorkerThread::WorkerThread(WorkerPool_P* const pool_, const unsigned int laneIndex_)
     : pool(pool_)
+    , laneIndex(laneIndex_)
 {
 }
 
@@ -251,44 +544,25 @@ void OsmAnd::Concurrent::WorkerPool_P::WorkerThread::run()
 {
     for (;;)
     {
-        // Get the runnable
-        QRunnable* runnable = nullptr;
-        {
-            QMutexLocker scopedLocker(&pool->_mutex);
-
-            // In case everything is being reset, self-destroy
-            if (pool->_isBeingReset)
-            {
-                pool->_freeThreads.removeOne(this);
-                pool->_allThreads.remove(this);
-                return;
-            }
-
-            // Check if not out of limit or sleep
-            if (pool->tooManyThreadsActive())
-            {
-                pool->_freeThreads.removeOne(this);
-                pool->_inactiveThreads.enqueue(this);
-
-                REPEAT_UNTIL(wakeup.wait(&pool->_mutex));
-
-                pool->_inactiveThreads.removeOne(this);
-                pool->_freeThreads.enqueue(this);
-                continue;
-            }
-
-            // Take runnable or sleep
-            runnable = pool->takeNextRunnable();
-            if (!runnable)
-            {
-                REPEAT_UNTIL(wakeup.wait(&pool->_mutex));
-                continue;
-            }
+        // In case everything is being reset, self-destroy
+        if (pool->_isBeingReset)
+            return;
 
-            // Since runnable was obtained, this thread is no longer free
-            pool->_freeThreads.removeOne(this);
+        // Check if not out of limit, and take runnable from own lane or from others, or sleep
+        if (!pool->tryAcquireActiveSlot())
+        {
+            pool->sleep();
+            continue;
         }
-        
+        QueueEntry entry;
+        if (!pool->takeNextEntry(laneIndex, entry))
+        {
+            pool->releaseActiveSlot();
+            pool->sleep();
+            continue;
+        }
+        auto runnable = entry.runnable;
+
         // Execute the runnable
 #ifndef QT_NO_EXCEPTIONS
         try
@@ -309,11 +583,6 @@ void OsmAnd::Concurrent::WorkerPool_P::WorkerThread::run()
 #endif
 
         // After runnable execution is complete, free this thread
-        {
-            QMutexLocker scopedLocker(&pool->_mutex);
-
-            pool->_freeThreads.enqueue(this);
-            pool->_threadFreed.wakeOne();
-        }
+        pool->releaseActiveSlot();
     }
 }
@@ -2,6 +2,9 @@
 #define _OSMAND_CORE_CONCURRENT_WORKER_POOL_P_H_
 
 #include "stdlib_common.h"
+#include <atomic>
+#include <map>
+#include <vector>
 
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
@@ -10,8 +13,7 @@
 #include <QWaitCondition>
 #include <QMutex>
 #include <QThread>
-#include <QSet>
-#include <QQueue>
+#include <QHash>
 #include <QVector>
 #include "restore_internal_warnings.h"
 
@@ -30,6 +32,8 @@ namespace OsmAnd
         public:
             typedef WorkerPool::Order Order;
             typedef WorkerPool::SortPredicate SortPredicate;
+            typedef WorkerPool::Priority Priority;
+            typedef WorkerPool::Affinity Affinity;
 
         private:
             class WorkerThread Q_DECL_FINAL : public QThread
@@ -38,39 +42,91 @@ namespace OsmAnd
 
             private:
             protected:
-                WorkerThread(WorkerPool_P* const pool);
+                WorkerThread(WorkerPool_P* const pool, const unsigned int laneIndex);
             public:
                 virtual ~WorkerThread();
 
                 WorkerPool_P* const pool;
+                const unsigned int laneIndex;
 
                 virtual void run();
 
-                QWaitCondition wakeup;
-
             friend class OsmAnd::Concurrent::WorkerPool_P;
             };
 
+            // Higher priority goes first, and sequence orders runnables of same priority according to pool order
+            struct QueueKey
+            {
+                Priority priority;
+                int64_t sequence;
+
+                inline bool operator<(const QueueKey& that) const
+                {
+                    if (priority != that.priority)
+                        return priority > that.priority;
+                    return sequence < that.sequence;
+                }
+            };
+            struct QueueEntry
+            {
+                QRunnable* runnable;
+                Affinity affinity;
+            };
+            typedef std::map<QueueKey, QueueEntry> Queue;
+
+            // Queue of single worker thread. Runnables with affinity are kept apart, so that stealing threads could
+            // prefer the rest.
+            struct Lane
+            {
+                struct Location
+                {
+                    Queue* queue;
+                    Queue::iterator itEntry;
+                };
+
+                QMutex mutex;
+                Queue sharedQueue;
+                Queue affineQueue;
+                QHash<QRunnable*, Location> locations;
+
+                void insert(const QueueKey& key, const QueueEntry& entry);
+                bool remove(QRunnable* const runnable, QueueKey* const pOutKey = nullptr, QueueEntry* const pOutEntry = nullptr);
+                Queue* selectQueue(const bool includeShared, const bool includeAffine);
+                bool takeBest(const bool includeShared, const bool includeAffine, QueueEntry& outEntry);
+                void clear(QVector<QueueEntry>* const pOutEntries = nullptr);
+            };
+            std::vector< std::unique_ptr<Lane> > _lanes;
+            std::atomic<unsigned int> _nextLaneIndex;
+            std::atomic<int64_t> _sequence;
+
             QAtomicInt _order;
             QAtomicInt _maxThreadCount;
 
+            std::atomic<int> _queuedCount;
+            std::atomic<int> _activeThreadsCount;
+            std::atomic<int> _sleepingThreadsCount;
+            std::atomic<int> _threadsCount;
+            std::atomic<bool> _isBeingReset;
+
+            // Protects threads list and is used to sleep and wake up threads
             mutable QMutex _mutex;
-            QVector<QRunnable*> _queue;
-            QSet<WorkerThread*> _allThreads;
-            QQueue<WorkerThread*> _freeThreads;
-            QQueue<WorkerThread*> _inactiveThreads;
-            volatile bool _isBeingReset;
+            QList<WorkerThread*> _allThreads;
+            unsigned int _createdThreadsCount;
+            QWaitCondition _workAvailable;
             mutable QWaitCondition _threadFreed;
 
-            unsigned int activeThreadCountNoLock() const;
-            void createNewThread();
-            bool tryLaunchNextRunnable();
-            void tryLaunchNextRunnables();
-            QRunnable* takeNextRunnable();
-            bool tooManyThreadsActive() const;
-            void dequeueAllNoLock();
-            bool waitForDoneNoLock(const int msecs) const;
-            void sortQueueNoLock(const SortPredicate predicate);
+            int64_t nextSequence();
+            unsigned int selectLane(const Affinity affinity);
+            void insertEntry(const QueueEntry& entry, const Priority priority);
+            void createNewThreadNoLock();
+            void wakeOrCreateThread();
+            bool tryAcquireActiveSlot();
+            void releaseActiveSlot();
+            bool takeNextEntry(const unsigned int laneIndex, QueueEntry& outEntry);
+            bool stealEntry(const unsigned int laneIndex, const bool affine, QueueEntry& outEntry);
+            void sleep();
+            void notifyIfDone();
+            bool isDone() const;
         protected:
             WorkerPool_P(WorkerPool* const owner, const Order order, const int maxThreadCount);
         public:
@@ -89,6 +145,11 @@ namespace OsmAnd
 
             void enqueue(QRunnable* const runnable, const SortPredicate predicate);
             void enqueue(const QVector<QRunnable*>& runnables, const SortPredicate predicate);
+            void enqueue(
+                QRunnable* const runnable,
+                const Priority priority,
+                const Affinity affinity);
+            bool updatePriority(QRunnable* const runnable, const Priority priority);
             bool dequeue(QRunnable* const runnable, const SortPredicate predicate);
             void dequeueAll();
 
@@ -4,13 +4,17 @@
 #include <QFile>
 #include <QStringList>
 #include <OsmAndCore/Data/ObfInfo.h>
+#include <OsmAndCore/Data/ObfMapSectionInfo.h>
+#include <OsmAndCore/Data/ObfRoutingSectionInfo.h>
+#include <OsmAndCore/Data/ObfAddressSectionInfo.h>
+#include <OsmAndCore/Data/ObfPoiSectionInfo.h>
+#include <OsmAndCore/Data/ObfTransportSectionInfo.h>
 #include <OsmAndCore/Utilities.h>
 
 OsmAnd::ObfFile::ObfFile(const QString& filePath_, const std::shared_ptr<const ObfInfo>& obfInfo_)
     : _p(new ObfFile_P(this, obfInfo_))
     , filePath(filePath_)
     , fileSize(QFile(filePath).size())
-    , obfInfo(_p->_obfInfo)
 {
 }
 
@@ -18,7 +22,6 @@ OsmAnd::ObfFile::ObfFile(const QString& filePath_)
     : _p(new ObfFile_P(this))
     , filePath(filePath_)
     , fileSize(QFile(filePath).size())
-    , obfInfo(_p->_obfInfo)
 {
 }
 
@@ -26,7 +29,6 @@ OsmAnd::ObfFile::ObfFile(const QString& filePath_, const uint64_t fileSize_)
     : _p(new ObfFile_P(this))
     , filePath(filePath_)
     , fileSize(fileSize_)
-    , obfInfo(_p->_obfInfo)
 {
 }
 
@@ -34,9 +36,21 @@ OsmAnd::ObfFile::~ObfFile()
 {
 }
 
+std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::ObfFile::obtainInfo() const
+{
+    QMutexLocker scopedLocker(&_p->_obfInfoMutex);
+
+    return _p->materializeInfo();
+}
+
+std::shared_ptr<const OsmAnd::ObfFile::Summary> OsmAnd::ObfFile::getSummary() const
+{
+    return std::atomic_load(&_p->_summary);
+}
+
 const QString OsmAnd::ObfFile::getRegionName() const
 {
-    QStringList rg = obfInfo->getRegionNames();
+    QStringList rg = obtainInfo()->getRegionNames();
     if (rg.isEmpty())
     {
         QFileInfo fileInfo(filePath);
@@ -49,3 +63,102 @@ const QString OsmAnd::ObfFile::getRegionName() const
 
     return ls;
 }
+
+OsmAnd::ObfFile::Summary::Summary()
+    : creationTimestamp(0)
+    , isBasemap(false)
+    , isBasemapWithCoastlines(false)
+    , minMapZoom(MaxZoomLevel)
+    , maxMapZoom(MinZoomLevel)
+{
+}
+
+OsmAnd::ObfFile::Summary::~Summary()
+{
+}
+
+bool OsmAnd::ObfFile::Summary::mayContainDataFor(
+    const AreaI* const pBbox31,
+    const ZoomLevel minZoomLevel,
+    const ZoomLevel maxZoomLevel,
+    const ObfDataTypesMask desiredDataTypes) const
+{
+    if (pBbox31)
+    {
+        const auto fitsBBox =
+            bbox31.contains(*pBbox31) ||
+            bbox31.intersects(*pBbox31) ||
+            pBbox31->contains(bbox31);
+        if (!fitsBBox)
+            return false;
+    }
+
+    if (desiredDataTypes.isSet(ObfDataType::Map) &&
+        dataTypes.isSet(ObfDataType::Map) &&
+        minZoomLevel <= maxMapZoom && minMapZoom <= maxZoomLevel)
+    {
+        return true;
+    }
+
+    return
+        (desiredDataTypes.isSet(ObfDataType::Routing) && dataTypes.isSet(ObfDataType::Routing)) ||
+        (desiredDataTypes.isSet(ObfDataType::Address) && dataTypes.isSet(ObfDataType::Address)) ||
+        (desiredDataTypes.isSet(ObfDataType::POI) && dataTypes.isSet(ObfDataType::POI)) ||
+        (desiredDataTypes.isSet(ObfDataType::Transport) && dataTypes.isSet(ObfDataType::Transport));
+}
+
+std::shared_ptr<const OsmAnd::ObfFile::Summary> OsmAnd::ObfFile::Summary::fromInfo(const ObfInfo& obfInfo)
+{
+    const std::shared_ptr<Summary> summary(new Summary());
+    summary->creationTimestamp = obfInfo.creationTimestamp;
+    summary->isBasemap = obfInfo.isBasemap;
+    summary->isBasemapWithCoastlines = obfInfo.isBasemapWithCoastlines;
+
+    Nullable<AreaI> bbox31;
+    const auto includeArea =
+        [&bbox31]
+        (const AreaI& area31)
+        {
+            if (bbox31.isSet())
+                bbox31->enlargeToInclude(area31);
+            else
+                bbox31 = area31;
+        };
+    for (const auto& mapSection : constOf(obfInfo.mapSections))
+    {
+        for (const auto& level : constOf(mapSection->levels))
+        {
+            summary->dataTypes.set(ObfDataType::Map);
+            summary->minMapZoom = qMin(summary->minMapZoom, level->minZoom);
+            summary->maxMapZoom = qMax(summary->maxMapZoom, level->maxZoom);
+            includeArea(level->area31);
+        }
+    }
+    for (const auto& routingSection : constOf(obfInfo.routingSections))
+    {
+        summary->dataTypes.set(ObfDataType::Routing);
+        includeArea(routingSection->area31);
+    }
+    for (const auto& addressSection : constOf(obfInfo.addressSections))
+    {
+        summary->dataTypes.set(ObfDataType::Address);
+        includeArea(addressSection->area31);
+    }
+    for (const auto& poiSection : constOf(obfInfo.poiSections))
+    {
+        summary->dataTypes.set(ObfDataType::POI);
+        includeArea(poiSection->area31);
+    }
+    for (const auto& transportSection : constOf(obfInfo.transportSections))
+    {
+        summary->dataTypes.set(ObfDataType::Transport);
+        includeArea(transportSection->area31);
+    }
+
+    // Without any known area nothing can be rejected by it
+    summary->bbox31 = bbox31.isSet()
+        ? *bbox31
+        : AreaI(0, 0, std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max());
+
+    return summary;
+}
@@ -1,9 +1,12 @@
 #include "ObfFile_P.h"
 
+#include "ObfInfo.h"
+
 OsmAnd::ObfFile_P::ObfFile_P(ObfFile* owner_, const std::shared_ptr<const ObfInfo>& obfInfo_)
     : owner(owner_)
     , _obfInfo(obfInfo_)
 {
+    summarizeInfo();
 }
 
 OsmAnd::ObfFile_P::ObfFile_P(ObfFile* owner_)
@@ -14,3 +17,23 @@ OsmAnd::ObfFile_P::ObfFile_P(ObfFile* owner_)
 OsmAnd::ObfFile_P::~ObfFile_P()
 {
 }
+
+const std::shared_ptr<const OsmAnd::ObfInfo>& OsmAnd::ObfFile_P::materializeInfo() const
+{
+    if (!_obfInfo && _obfInfoMaterializer)
+    {
+        _obfInfo = _obfInfoMaterializer();
+        _obfInfoMaterializer = nullptr;
+        summarizeInfo();
+    }
+
+    return _obfInfo;
+}
+
+void OsmAnd::ObfFile_P::summarizeInfo() const
+{
+    if (!_obfInfo || std::atomic_load(&_summary))
+        return;
+
+    std::atomic_store(&_summary, ObfFile::Summary::fromInfo(*_obfInfo));
+}
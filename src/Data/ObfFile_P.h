@@ -2,6 +2,7 @@
 #define _OSMAND_CORE_OBF_FILE_P_H_
 
 #include "stdlib_common.h"
+#include <functional>
 
 #include "QtExtensions.h"
 #include <QMutex>
@@ -9,10 +10,12 @@
 
 #include "OsmAndCore.h"
 #include "PrivateImplementation.h"
+#include "ObfFile.h"
 
 namespace OsmAnd
 {
     class ObfReader_P;
+    class CachedOsmandIndexes_P;
     class ObfInfo;
 
     class ObfFile;
@@ -28,11 +31,23 @@ namespace OsmAnd
 
         mutable QMutex _obfInfoMutex;
         mutable std::shared_ptr<const ObfInfo> _obfInfo;
+
+        // Is accessed only through std::atomic_load()/std::atomic_store()
+        mutable std::shared_ptr<const ObfFile::Summary> _summary;
+        // Builds summary from information, unless it's already known. Has to be called with _obfInfoMutex held
+        void summarizeInfo() const;
+
+        // Builds information on first request, and is released right after that
+        typedef std::function< std::shared_ptr<const ObfInfo>() > InfoMaterializer;
+        mutable InfoMaterializer _obfInfoMaterializer;
+        // Has to be called with _obfInfoMutex held
+        const std::shared_ptr<const ObfInfo>& materializeInfo() const;
     public:
         virtual ~ObfFile_P();
 
     friend class OsmAnd::ObfFile;
     friend class OsmAnd::ObfReader_P;
+    friend class OsmAnd::CachedOsmandIndexes_P;
     };
 }
 
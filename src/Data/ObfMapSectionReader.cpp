@@ -2,6 +2,7 @@
 #include "ObfMapSectionReader_P.h"
 
 #include "ObfReader.h"
+#include "IMemoryManager.h"
 
 OsmAnd::ObfMapSectionReader::ObfMapSectionReader()
 {
@@ -25,6 +26,8 @@ void OsmAnd::ObfMapSectionReader::loadMapObjects(
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     ObfMapSectionReader_Metrics::Metric_loadMapObjects* const metric /*= nullptr*/)
 {
+    const MemoryTagScope memoryTagScope("OBF decoding");
+
     ObfMapSectionReader_P::loadMapObjects(
         *reader->_p,
         section,
@@ -16,6 +16,13 @@ void OsmAnd::ObfMapSectionReader_Metrics::Metric_loadMapObjects::reset()
     Metric::reset();
 }
 
+void OsmAnd::ObfMapSectionReader_Metrics::Metric_loadMapObjects::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__ObfMapSectionReader_Metrics__Metric_loadMapObjects__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
 QString OsmAnd::ObfMapSectionReader_Metrics::Metric_loadMapObjects::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
@@ -165,12 +165,13 @@ std::shared_ptr<const OsmAnd::ObfInfo> OsmAnd::ObfReader_P::obtainInfo() const
     {
         QMutexLocker scopedLocker(&owner->obfFile->_p->_obfInfoMutex);
 
-        if (!owner->obfFile->_p->_obfInfo)
+        if (!owner->obfFile->_p->materializeInfo())
         {
             std::shared_ptr<ObfInfo> obfInfo;
             if (!readInfo(*this, obfInfo))
                 return nullptr;
             owner->obfFile->_p->_obfInfo = obfInfo;
+            owner->obfFile->_p->summarizeInfo();
         }
         _obfInfo = owner->obfFile->_p->_obfInfo;
 
@@ -2,6 +2,8 @@
 #include "ObfRoutingSectionReader_P.h"
 
 #include "ObfReader.h"
+#include "IMemoryManager.h"
+#include "MetricsRegistry.h"
 
 OsmAnd::ObfRoutingSectionReader::ObfRoutingSectionReader()
 {
@@ -24,6 +26,10 @@ void OsmAnd::ObfRoutingSectionReader::loadRoads(
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     ObfRoutingSectionReader_Metrics::Metric_loadRoads* const metric /*= nullptr*/)
 {
+    const MemoryTagScope memoryTagScope("Routing");
+    static const auto loadRoadsHistogram = MetricsRegistry::getDefault().obtainHistogram(QLatin1String("route_load_roads"));
+    const MetricsRegistry::ScopedTimer loadRoadsTimer(MetricsRegistry::getDefault(), loadRoadsHistogram);
+
     ObfRoutingSectionReader_P::loadRoads(
         *reader->_p,
         section,
@@ -44,6 +50,8 @@ void OsmAnd::ObfRoutingSectionReader::loadTreeNodes(
     const RoutingDataLevel dataLevel,
     QList< std::shared_ptr<const ObfRoutingSectionLevelTreeNode> >* resultOut)
 {
+    const MemoryTagScope memoryTagScope("Routing");
+
     ObfRoutingSectionReader_P::loadTreeNodes(
         *reader->_p,
         section,
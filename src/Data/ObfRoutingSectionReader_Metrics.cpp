@@ -16,6 +16,13 @@ void OsmAnd::ObfRoutingSectionReader_Metrics::Metric_loadRoads::reset()
     Metric::reset();
 }
 
+void OsmAnd::ObfRoutingSectionReader_Metrics::Metric_loadRoads::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__ObfRoutingSectionReader_Metrics__Metric_loadRoads__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
 QString OsmAnd::ObfRoutingSectionReader_Metrics::Metric_loadRoads::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
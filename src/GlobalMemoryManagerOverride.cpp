@@ -2,9 +2,17 @@
 
 #include <QtGlobal>
 
+// Global operator new and delete go through memory manager, so that they are pooled and accounted per thread tag,
+// only if library is configured with OSMAND_MEMORY_MANAGER_OVERRIDE
+#if !defined(OSMAND_MEMORY_MANAGER_OVERRIDE)
+#   define OSMAND_MEMORY_MANAGER_OVERRIDE 0
+#endif // !defined(OSMAND_MEMORY_MANAGER_OVERRIDE)
+
+#if OSMAND_MEMORY_MANAGER_OVERRIDE
+
 void* operator new(std::size_t count) throw(std::bad_alloc)
 {
-    const auto ptr = OsmAnd::getMemoryManager()->allocate(count, "global");
+    const auto ptr = OsmAnd::getMemoryManager()->allocate(count, OsmAnd::getCurrentThreadMemoryTag());
     if (!ptr)
         throw std::bad_alloc();
     return ptr;
@@ -12,7 +20,7 @@ void* operator new(std::size_t count) throw(std::bad_alloc)
 
 void* operator new[](std::size_t count) throw(std::bad_alloc)
 {
-    const auto ptr = OsmAnd::getMemoryManager()->allocate(count, "global");
+    const auto ptr = OsmAnd::getMemoryManager()->allocate(count, OsmAnd::getCurrentThreadMemoryTag());
     if (!ptr)
         throw std::bad_alloc();
     return ptr;
@@ -21,33 +29,35 @@ void* operator new[](std::size_t count) throw(std::bad_alloc)
 void* operator new(std::size_t count, const std::nothrow_t& tag) Q_DECL_NOTHROW
 {
     Q_UNUSED(tag);
-    return OsmAnd::getMemoryManager()->allocate(count, "global");
+    return OsmAnd::getMemoryManager()->allocate(count, OsmAnd::getCurrentThreadMemoryTag());
 }
 
 void* operator new[](std::size_t count, const std::nothrow_t& tag) Q_DECL_NOTHROW
 {
     Q_UNUSED(tag);
-    return OsmAnd::getMemoryManager()->allocate(count, "global");
+    return OsmAnd::getMemoryManager()->allocate(count, OsmAnd::getCurrentThreadMemoryTag());
 }
 
 void operator delete(void* ptr) Q_DECL_NOTHROW
 {
-    OsmAnd::getMemoryManager()->free(ptr, "global");
+    OsmAnd::getMemoryManager()->free(ptr, OsmAnd::getCurrentThreadMemoryTag());
 }
 
 void operator delete[](void* ptr) Q_DECL_NOTHROW
 {
-    OsmAnd::getMemoryManager()->free(ptr, "global");
+    OsmAnd::getMemoryManager()->free(ptr, OsmAnd::getCurrentThreadMemoryTag());
 }
 
 void operator delete(void* ptr, const std::nothrow_t& tag) Q_DECL_NOTHROW
 {
     Q_UNUSED(tag);
-    OsmAnd::getMemoryManager()->free(ptr, "global");
+    OsmAnd::getMemoryManager()->free(ptr, OsmAnd::getCurrentThreadMemoryTag());
 }
 
 void operator delete[](void* ptr, const std::nothrow_t& tag) Q_DECL_NOTHROW
 {
     Q_UNUSED(tag);
-    OsmAnd::getMemoryManager()->free(ptr, "global");
+    OsmAnd::getMemoryManager()->free(ptr, OsmAnd::getCurrentThreadMemoryTag());
 }
+
+#endif // OSMAND_MEMORY_MANAGER_OVERRIDE
@@ -4,6 +4,13 @@
 #include <cstdlib>
 #include <new>
 
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QStringList>
+#include "restore_internal_warnings.h"
+
+#include "Common.h"
+
 OsmAnd::IMemoryManager::IMemoryManager()
 {
 }
@@ -12,6 +19,19 @@ OsmAnd::IMemoryManager::~IMemoryManager()
 {
 }
 
+OsmAnd::IMemoryManager::Statistics OsmAnd::IMemoryManager::getStatistics() const
+{
+    return Statistics();
+}
+
+void OsmAnd::IMemoryManager::resetPeaks()
+{
+}
+
+void OsmAnd::IMemoryManager::releaseUnusedMemory()
+{
+}
+
 OsmAnd::IMemoryManager* OsmAnd::getMemoryManager()
 {
     //NOTE: Known memory leak, manager will never be deallocated. Reason for such solution is that order of static
@@ -19,3 +39,57 @@ OsmAnd::IMemoryManager* OsmAnd::getMemoryManager()
     static IMemoryManager* const pManager = new(std::malloc(sizeof(MemoryManager))) MemoryManager();
     return pManager;
 }
+
+// Plain pointer with constant initializer, so it's safe to be used from inside operator new at any time
+static thread_local const char* s_currentThreadMemoryTag = nullptr;
+
+const char* OsmAnd::getCurrentThreadMemoryTag()
+{
+    return s_currentThreadMemoryTag ? s_currentThreadMemoryTag : "global";
+}
+
+const char* OsmAnd::setCurrentThreadMemoryTag(const char* const tag)
+{
+    const auto previousTag = s_currentThreadMemoryTag;
+    s_currentThreadMemoryTag = tag;
+    return previousTag;
+}
+
+OsmAnd::IMemoryManager::TagStatistics::TagStatistics()
+    : liveBytes(0)
+    , peakBytes(0)
+    , allocationsCount(0)
+{
+}
+
+OsmAnd::IMemoryManager::Statistics::Statistics()
+    : liveBytes(0)
+    , peakBytes(0)
+    , pooledAllocationsCount(0)
+    , largeAllocationsCount(0)
+    , poolsReservedBytes(0)
+{
+}
+
+QString OsmAnd::IMemoryManager::Statistics::toString(const QString& prefix /*= QString::null*/) const
+{
+    QStringList output;
+
+    output.push_back(prefix + QString(QLatin1String("live: %1 bytes, peak: %2 bytes, pools reserved: %3 bytes"))
+        .arg(liveBytes)
+        .arg(peakBytes)
+        .arg(poolsReservedBytes));
+    output.push_back(prefix + QString(QLatin1String("allocations: %1 pooled, %2 large"))
+        .arg(pooledAllocationsCount)
+        .arg(largeAllocationsCount));
+    for (const auto& tagStatistics : constOf(tags))
+    {
+        output.push_back(prefix + QString(QLatin1String("[%1] live: %2 bytes, peak: %3 bytes, %4 allocations"))
+            .arg(tagStatistics.tag)
+            .arg(tagStatistics.liveBytes)
+            .arg(tagStatistics.peakBytes)
+            .arg(tagStatistics.allocationsCount));
+    }
+
+    return output.join(QLatin1Char('\n'));
+}
@@ -1,10 +1,15 @@
 #include "AtlasMapRendererSymbolsStage.h"
 
+#include "stdlib_common.h"
+#include <atomic>
+#include <vector>
+
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QLinkedList>
 #include <QSet>
 #include <QVector>
+#include <QThread>
 #include "restore_internal_warnings.h"
 
 #include "ignore_warnings_on_external_includes.h"
@@ -34,9 +39,22 @@
 #include "MapSymbolIntersectionClassesRegistry.h"
 #include "Stopwatch.h"
 #include "GlmExtensions.h"
+#include "QRunnableFunctor.h"
 
 OsmAnd::AtlasMapRendererSymbolsStage::AtlasMapRendererSymbolsStage(AtlasMapRenderer* const renderer_)
     : AtlasMapRendererStage(renderer_)
+    , _lastAcceptedMapSymbolsVersion(0)
+    , _lastPreparedSymbolsCount(0)
+    , _placementAnchorValid(false)
+    , _placementAnchorSymbolsVersion(0)
+    , _reusingPlacement(false)
+    , _currentPlacementHint(PlacementHint::None)
+    , _currentPlotRejectedByCollision(false)
+    , _computedDataScreenStateId(1)
+    , _computedDataFrameId(1)
+    , _averageOnPathPlacementComputeTime(0.0f)
+    , _lastSymbolPreparationJobsCount(0)
+    , _symbolsPreparationWorkerPool(Concurrent::WorkerPool::Order::FIFO, qMax(QThread::idealThreadCount() - 1, 1))
 {
 }
 
@@ -48,8 +66,7 @@ void OsmAnd::AtlasMapRendererSymbolsStage::prepare(AtlasMapRenderer_Metrics::Met
 {
     Stopwatch stopwatch(metric != nullptr);
 
-    ScreenQuadTree intersections;
-    if (!obtainRenderableSymbols(renderableSymbols, intersections, metric))
+    if (!obtainRenderableSymbols(renderableSymbols, _intersections, metric))
     {
         // In case obtain failed due to lock, schedule another frame
         invalidateFrame();
@@ -62,10 +79,10 @@ void OsmAnd::AtlasMapRendererSymbolsStage::prepare(AtlasMapRenderer_Metrics::Met
 
     Stopwatch preparedSymbolsPublishingStopwatch(metric != nullptr);
     
-    ScreenQuadTree visibleSymbols(intersections.getRootArea(), intersections.maxDepth);
-    visibleSymbols.insertFrom(renderableSymbols,
+    _visibleSymbols.reset(_intersections.getRootArea(), _intersections.getCellSize());
+    _visibleSymbols.insertFrom(renderableSymbols,
         []
-        (const std::shared_ptr<const RenderableSymbol>& item, ScreenQuadTree::BBox& outBbox) -> bool
+        (const std::shared_ptr<const RenderableSymbol>& item, ScreenGrid::BBox& outBbox) -> bool
         {
             outBbox = item->visibleBBox;
             return true;
@@ -73,11 +90,11 @@ void OsmAnd::AtlasMapRendererSymbolsStage::prepare(AtlasMapRenderer_Metrics::Met
 
     {
         QWriteLocker scopedLocker(&_lastPreparedIntersectionsLock);
-        _lastPreparedIntersections = qMove(intersections);
+        _lastPreparedIntersections.swap(_intersections);
     }
     {
         QWriteLocker scopedLocker(&_lastVisibleSymbolsLock);
-        _lastVisibleSymbols = qMove(visibleSymbols);
+        _lastVisibleSymbols.swap(_visibleSymbols);
     }
     if (metric)
         metric->elapsedTimeForPublishingPreparedSymbols = preparedSymbolsPublishingStopwatch.elapsed();
@@ -166,7 +183,7 @@ void OsmAnd::AtlasMapRendererSymbolsStage::queryLastVisibleSymbolsIn(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
     QList< std::shared_ptr<const RenderableSymbol> >& outRenderableSymbols,
-    ScreenQuadTree& outIntersections,
+    ScreenGrid& outIntersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     Stopwatch stopwatch(metric != nullptr);
@@ -178,10 +195,12 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
             return false;
 
         _lastAcceptedMapSymbolsByOrder.clear();
+        _lastAcceptedMapSymbolsVersion = publishedMapSymbolsVersion;
         const auto result = obtainRenderableSymbols(
             publishedMapSymbolsByOrder,
             outRenderableSymbols,
             outIntersections,
+            _lastAcceptedMapSymbolsVersion,
             &_lastAcceptedMapSymbolsByOrder,
             metric);
 
@@ -202,6 +221,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
         _lastAcceptedMapSymbolsByOrder,
         outRenderableSymbols,
         outIntersections,
+        _lastAcceptedMapSymbolsVersion,
         nullptr,
         metric);
     return result;
@@ -210,48 +230,69 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
 bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
     const MapRenderer::PublishedMapSymbolsByOrder& mapSymbolsByOrder,
     QList< std::shared_ptr<const RenderableSymbol> >& outRenderableSymbols,
-    ScreenQuadTree& outIntersections,
+    ScreenGrid& outIntersections,
+    const unsigned int mapSymbolsVersion,
     MapRenderer::PublishedMapSymbolsByOrder* pOutAcceptedMapSymbolsByOrder,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     Stopwatch stopwatch(metric != nullptr);
 
-    typedef QLinkedList< std::shared_ptr<const RenderableSymbol> > PlottedSymbols;
+    // Plotted symbols are stored in flat array in order of plotting. Discarded ones are only marked as such.
+    struct PlottedSymbol
+    {
+        std::shared_ptr<const RenderableSymbol> renderable;
+        bool discarded;
+    };
+    typedef QVector<PlottedSymbol> PlottedSymbols;
     PlottedSymbols plottedSymbols;
+    plottedSymbols.reserve(_lastPreparedSymbolsCount);
+
+    // Index of first plotted symbol of each order, in order of processing
+    QVector<int> plottedSymbolsOrderStarts;
     
     struct PlottedSymbolRef
     {
-        PlottedSymbols::iterator iterator;
+        int index;
         std::shared_ptr<const RenderableSymbol> renderable;
     };
     struct PlottedSymbolsRefGroupInstance
     {
         QList< PlottedSymbolRef > symbolsRefs;
 
-        void discard(
+        // Returns false if symbol was expected in intersections, but wasn't there
+        static bool discardRef(
             const AtlasMapRendererSymbolsStage* const stage,
             PlottedSymbols& plottedSymbols,
-            ScreenQuadTree& intersections)
+            ScreenGrid& intersections,
+            const PlottedSymbolRef& symbolRef)
         {
-            // Discard entire group
-            for (auto& symbolRef : symbolsRefs)
-            {
-                if (Q_UNLIKELY(stage->debugSettings->showSymbolsBBoxesRejectedByPresentationMode))
-                    stage->addIntersectionDebugBox(symbolRef.renderable, ColorARGB::fromSkColor(SK_ColorYELLOW).withAlpha(50));
+            if (Q_UNLIKELY(stage->debugSettings->showSymbolsBBoxesRejectedByPresentationMode))
+                stage->addIntersectionDebugBox(symbolRef.renderable, ColorARGB::fromSkColor(SK_ColorYELLOW).withAlpha(50));
 
+            bool removed = true;
 #if !OSMAND_KEEP_DISCARDED_SYMBOLS_IN_QUAD_TREE
-                const auto removed = intersections.removeOne(symbolRef.renderable, symbolRef.renderable->intersectionBBox);
-                //assert(removed);
+            removed = intersections.removeOne(symbolRef.renderable, symbolRef.renderable->intersectionBBox);
 #endif // !OSMAND_KEEP_DISCARDED_SYMBOLS_IN_QUAD_TREE
-                plottedSymbols.erase(symbolRef.iterator);
-            }
+            plottedSymbols[symbolRef.index].discarded = true;
+
+            return removed;
+        }
+
+        void discard(
+            const AtlasMapRendererSymbolsStage* const stage,
+            PlottedSymbols& plottedSymbols,
+            ScreenGrid& intersections)
+        {
+            // Discard entire group
+            for (const auto& symbolRef : constOf(symbolsRefs))
+                discardRef(stage, plottedSymbols, intersections, symbolRef);
             symbolsRefs.clear();
         }
 
         void discardSpecific(
             const AtlasMapRendererSymbolsStage* const stage,
             PlottedSymbols& plottedSymbols,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             const std::function<bool(const std::shared_ptr<const RenderableSymbol>&)> acceptor)
         {
             auto itSymbolRef = mutableIteratorOf(symbolsRefs);
@@ -262,14 +303,8 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
                 if (!acceptor(symbolRef.renderable))
                     continue;
 
-                if (Q_UNLIKELY(stage->debugSettings->showSymbolsBBoxesRejectedByPresentationMode))
-                    stage->addIntersectionDebugBox(symbolRef.renderable, ColorARGB::fromSkColor(SK_ColorYELLOW).withAlpha(50));
-
-#if !OSMAND_KEEP_DISCARDED_SYMBOLS_IN_QUAD_TREE
-                const auto removed = intersections.removeOne(symbolRef.renderable, symbolRef.renderable->intersectionBBox);
+                const auto removed = discardRef(stage, plottedSymbols, intersections, symbolRef);
                 assert(removed);
-#endif // !OSMAND_KEEP_DISCARDED_SYMBOLS_IN_QUAD_TREE
-                plottedSymbols.erase(symbolRef.iterator);
                 itSymbolRef.remove();
             }
         }
@@ -277,7 +312,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
         void discardAllOf(
             const AtlasMapRendererSymbolsStage* const stage,
             PlottedSymbols& plottedSymbols,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             const MapSymbol::ContentClass contentClass)
         {
             auto itSymbolRef = mutableIteratorOf(symbolsRefs);
@@ -288,14 +323,8 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
                 if (symbolRef.renderable->mapSymbol->contentClass != contentClass)
                     continue;
 
-                if (Q_UNLIKELY(stage->debugSettings->showSymbolsBBoxesRejectedByPresentationMode))
-                    stage->addIntersectionDebugBox(symbolRef.renderable, ColorARGB::fromSkColor(SK_ColorYELLOW).withAlpha(50));
-
-#if !OSMAND_KEEP_DISCARDED_SYMBOLS_IN_QUAD_TREE
-                const auto removed = intersections.removeOne(symbolRef.renderable, symbolRef.renderable->intersectionBBox);
+                const auto removed = discardRef(stage, plottedSymbols, intersections, symbolRef);
                 assert(removed);
-#endif // !OSMAND_KEEP_DISCARDED_SYMBOLS_IN_QUAD_TREE
-                plottedSymbols.erase(symbolRef.iterator);
                 itSymbolRef.remove();
             }
         }
@@ -307,7 +336,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
         void discard(
             const AtlasMapRendererSymbolsStage* const stage,
             PlottedSymbols& plottedSymbols,
-            ScreenQuadTree& intersections)
+            ScreenGrid& intersections)
         {
             // Discard all instances
             for (auto& instanceRef : instancesRefs)
@@ -317,22 +346,27 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
     };
     QHash< std::shared_ptr<const MapSymbolsGroup>, PlottedSymbolsRefGroupInstances> plottedSymbolsMapByGroupAndInstance;
 
+    // Paths and placements computed in previous frames are reused where map state allows
+    beginComputedDataFrame();
+
+    // Decide whether outcomes of intersection checks from last full placement can be reused
+    beginPlacement(mapSymbolsVersion);
+
     // Iterate over map symbols layer sorted by "order" in ascending direction.
     // This means that map symbols with smaller order value are more important than map symbols with larger order value.
     // Also this means that map symbols with smaller order value are rendered after map symbols with larger order value.
-    // Tree depth should satisfy following condition:
-    // (max(width, height) / 2^depth) >= 64
-    const auto viewportMaxDimension = qMax(currentState.viewport.height(), currentState.viewport.width());
-    const auto treeDepth = 32u - SkCLZ(viewportMaxDimension >> 6);
-    outIntersections = qMove(ScreenQuadTree(currentState.viewport, qMax(treeDepth, 1u)));
-    ComputedPathsDataCache computedPathsDataCache;
+    // Grid storage is kept from the frame before previous one, so it's not reallocated
+    outIntersections.reset(currentState.viewport, ScreenGridCellSize);
+    // Symbols are processed in following phases:
+    //  - collecting symbols in proper order and acquiring inputs that can't be acquired concurrently (serial);
+    //  - obtaining renderables, that includes projection, placement of glyphs and bboxes (parallel);
+    //  - plotting, since it depends on what was plotted before (serial, in proper order).
+    SymbolPreparationJobs jobs;
+    jobs.reserve(_lastSymbolPreparationJobsCount);
     for (const auto& mapSymbolsByOrderEntry : rangeOf(constOf(mapSymbolsByOrder)))
     {
         const auto order = mapSymbolsByOrderEntry.key();
         const auto& mapSymbols = mapSymbolsByOrderEntry.value();
-        MapRenderer::PublishedMapSymbolsByGroup* pAcceptedMapSymbols = nullptr;
-
-        const auto itPlottedSymbolsInsertPosition = plottedSymbols.begin();
 
         // Iterate over all groups in proper order (proper order is maintained during publishing)
         for (const auto& mapSymbolsEntry : constOf(mapSymbols))
@@ -383,45 +417,13 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
                     const auto citReferencesOrigins = mapSymbolsFromGroup.constFind(mapSymbol);
                     if (citReferencesOrigins == mapSymbolsFromGroup.cend())
                         continue;
-                    const auto& referencesOrigins = *citReferencesOrigins;
-
-                    QList< std::shared_ptr<RenderableSymbol> > renderableSymbols;
-                    obtainRenderablesFromSymbol(
-                        mapSymbolsGroup,
-                        mapSymbol,
-                        nullptr,
-                        referencesOrigins,
-                        computedPathsDataCache,
-                        renderableSymbols,
-                        metric);
-
-                    bool atLeastOnePlotted = false;
-                    for (const auto& renderableSymbol : constOf(renderableSymbols))
-                    {
-                        if (!plotSymbol(renderableSymbol, outIntersections, metric))
-                            continue;
-
-                        if (!atLeastOnePlotted)
-                        {
-                            // In case renderable symbol was obtained and accepted map symbols were requested,
-                            // add this symbol to accepted
-                            if (pOutAcceptedMapSymbolsByOrder)
-                            {
-                                if (pAcceptedMapSymbols == nullptr)
-                                    pAcceptedMapSymbols = &(*pOutAcceptedMapSymbolsByOrder)[order];
-
-                                (*pAcceptedMapSymbols)[mapSymbolsGroup].insert(mapSymbol, referencesOrigins);
-                            }
-                            atLeastOnePlotted = true;
-                        }
 
-                        const auto itPlottedSymbol = plottedSymbols.insert(itPlottedSymbolsInsertPosition, renderableSymbol);
-                        PlottedSymbolRef plottedSymbolRef = { itPlottedSymbol, renderableSymbol };
-
-                        plottedSymbolsMapByGroupAndInstance[mapSymbolsGroup]
-                            .instancesRefs[nullptr]
-                            .symbolsRefs.push_back(qMove(plottedSymbolRef));
-                    }
+                    SymbolPreparationJob job;
+                    job.order = order;
+                    job.mapSymbolsGroup = mapSymbolsGroup;
+                    job.mapSymbol = mapSymbol;
+                    job.pReferencesOrigins = &(*citReferencesOrigins);
+                    jobs.push_back(qMove(job));
                 }
             }
 
@@ -438,53 +440,93 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
                     const auto citReferencesOrigins = mapSymbolsFromGroup.constFind(mapSymbol);
                     if (citReferencesOrigins == mapSymbolsFromGroup.cend())
                         continue;
-                    const auto& referencesOrigins = *citReferencesOrigins;
 
                     // If symbol is not references in additional group reference, also skip
                     const auto citAdditionalSymbolInstance = additionalGroupInstance->symbols.constFind(mapSymbol);
                     if (citAdditionalSymbolInstance == additionalGroupInstance->symbols.cend())
                         continue;
-                    const auto& additionalSymbolInstance = *citAdditionalSymbolInstance;
-
-                    QList< std::shared_ptr<RenderableSymbol> > renderableSymbols;
-                    obtainRenderablesFromSymbol(
-                        mapSymbolsGroup,
-                        mapSymbol,
-                        additionalSymbolInstance,
-                        referencesOrigins,
-                        computedPathsDataCache,
-                        renderableSymbols,
-                        metric);
-
-                    bool atLeastOnePlotted = false;
-                    for (const auto& renderableSymbol : constOf(renderableSymbols))
-                    {
-                        if (!plotSymbol(renderableSymbol, outIntersections, metric))
-                            continue;
 
-                        if (!atLeastOnePlotted)
-                        {
-                            // In case renderable symbol was obtained and accepted map symbols were requested,
-                            // add this symbol to accepted
-                            if (pOutAcceptedMapSymbolsByOrder)
-                            {
-                                if (pAcceptedMapSymbols == nullptr)
-                                    pAcceptedMapSymbols = &(*pOutAcceptedMapSymbolsByOrder)[order];
+                    SymbolPreparationJob job;
+                    job.order = order;
+                    job.mapSymbolsGroup = mapSymbolsGroup;
+                    job.groupInstance = additionalGroupInstance;
+                    job.mapSymbol = mapSymbol;
+                    job.instanceParameters = *citAdditionalSymbolInstance;
+                    job.pReferencesOrigins = &(*citReferencesOrigins);
+                    jobs.push_back(qMove(job));
+                }
+            }
+        }
+    }
+    _lastSymbolPreparationJobsCount = jobs.size();
 
-                                (*pAcceptedMapSymbols)[mapSymbolsGroup].insert(mapSymbol, referencesOrigins);
-                            }
-                            atLeastOnePlotted = true;
-                        }
+    QVector<ComputedPathToUpdate> computedPathsToUpdate;
+    for (auto& job : jobs)
+        acquireSymbolPreparationInputs(job, computedPathsToUpdate, metric);
 
-                        const auto itPlottedSymbol = plottedSymbols.insert(itPlottedSymbolsInsertPosition, renderableSymbol);
-                        PlottedSymbolRef plottedSymbolRef = { itPlottedSymbol, renderableSymbol };
+    // Paths are shared between symbols, so they are updated before obtaining renderables
+    Stopwatch parallelPreparationStopwatch(metric != nullptr);
+    const auto pComputedPathsToUpdate = computedPathsToUpdate.constData();
+    processInParallel(computedPathsToUpdate.size(),
+        [this, pComputedPathsToUpdate]
+        (const int itemIndex, AtlasMapRenderer_Metrics::Metric_renderFrame* const metric_)
+        {
+            const auto& computedPathToUpdate = pComputedPathsToUpdate[itemIndex];
+            updateComputedPathData(*computedPathToUpdate.pPath31, *computedPathToUpdate.pComputedPathData, metric_);
+        },
+        metric);
+    const auto pJobs = jobs.data();
+    processInParallel(jobs.size(),
+        [this, pJobs]
+        (const int itemIndex, AtlasMapRenderer_Metrics::Metric_renderFrame* const metric_)
+        {
+            obtainRenderablesFromSymbol(pJobs[itemIndex], metric_);
+        },
+        metric);
+    if (metric)
+        metric->elapsedTimeForParallelSymbolsPreparation = parallelPreparationStopwatch.elapsed();
 
-                        plottedSymbolsMapByGroupAndInstance[mapSymbolsGroup]
-                            .instancesRefs[additionalGroupInstance]
-                            .symbolsRefs.push_back(qMove(plottedSymbolRef));
-                    }
+    // Plot renderables in proper order
+    MapRenderer::PublishedMapSymbolsByGroup* pAcceptedMapSymbols = nullptr;
+    for (auto jobIndex = 0, jobsCount = jobs.size(); jobIndex < jobsCount; jobIndex++)
+    {
+        const auto& job = pJobs[jobIndex];
+        if (jobIndex == 0 || job.order != pJobs[jobIndex - 1].order)
+        {
+            plottedSymbolsOrderStarts.push_back(plottedSymbols.size());
+            pAcceptedMapSymbols = nullptr;
+        }
+
+        bool atLeastOnePlotted = false;
+        for (auto renderableIndex = 0, renderablesCount = job.renderables.size();
+            renderableIndex < renderablesCount;
+            renderableIndex++)
+        {
+            const auto& renderableSymbol = job.renderables[renderableIndex];
+            if (!plotSymbolWithPlacementReuse(renderableSymbol, renderableIndex, outIntersections, metric))
+                continue;
+
+            if (!atLeastOnePlotted)
+            {
+                // In case renderable symbol was obtained and accepted map symbols were requested,
+                // add this symbol to accepted
+                if (pOutAcceptedMapSymbolsByOrder)
+                {
+                    if (pAcceptedMapSymbols == nullptr)
+                        pAcceptedMapSymbols = &(*pOutAcceptedMapSymbolsByOrder)[job.order];
+
+                    (*pAcceptedMapSymbols)[job.mapSymbolsGroup].insert(job.mapSymbol, *job.pReferencesOrigins);
                 }
+                atLeastOnePlotted = true;
             }
+
+            PlottedSymbol plottedSymbol = { renderableSymbol, false };
+            PlottedSymbolRef plottedSymbolRef = { plottedSymbols.size(), renderableSymbol };
+            plottedSymbols.push_back(qMove(plottedSymbol));
+
+            plottedSymbolsMapByGroupAndInstance[job.mapSymbolsGroup]
+                .instancesRefs[job.groupInstance]
+                .symbolsRefs.push_back(qMove(plottedSymbolRef));
         }
     }
 
@@ -665,16 +707,31 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
             metric->elapsedTimeForSymbolsPresentationModeCheck = symbolsPresentationModeCheckStopwatch.elapsed();
     }
 
-    // Publish the result
+    // Publish the result: symbols of less important orders go first, since they have to be rendered first.
+    // Inside same order, symbols are kept in order of plotting.
     outRenderableSymbols.clear();
     outRenderableSymbols.reserve(plottedSymbols.size());
-    for (const auto& plottedSymbol : constOf(plottedSymbols))
+    for (auto orderIndex = plottedSymbolsOrderStarts.size() - 1; orderIndex >= 0; orderIndex--)
     {
-        if (Q_UNLIKELY(debugSettings->showSymbolsBBoxesAcceptedByIntersectionCheck))
-            addIntersectionDebugBox(plottedSymbol, ColorARGB::fromSkColor(SK_ColorGREEN).withAlpha(50));
+        const auto orderStart = plottedSymbolsOrderStarts[orderIndex];
+        const auto orderEnd = (orderIndex + 1 < plottedSymbolsOrderStarts.size())
+            ? plottedSymbolsOrderStarts[orderIndex + 1]
+            : plottedSymbols.size();
+        for (auto plottedSymbolIndex = orderStart; plottedSymbolIndex < orderEnd; plottedSymbolIndex++)
+        {
+            const auto& plottedSymbol = plottedSymbols[plottedSymbolIndex];
+            if (plottedSymbol.discarded)
+                continue;
+
+            if (Q_UNLIKELY(debugSettings->showSymbolsBBoxesAcceptedByIntersectionCheck))
+                addIntersectionDebugBox(plottedSymbol.renderable, ColorARGB::fromSkColor(SK_ColorGREEN).withAlpha(50));
 
-        outRenderableSymbols.push_back(qMove(plottedSymbol));
+            outRenderableSymbols.push_back(plottedSymbol.renderable);
+        }
     }
+    _lastPreparedSymbolsCount = plottedSymbols.size();
+
+    endComputedDataFrame(metric);
 
     if (metric)
         metric->elapsedTimeForObtainingRenderableSymbols = stopwatch.elapsed();
@@ -682,61 +739,215 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderableSymbols(
     return true;
 }
 
-void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromSymbol(
-    const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
-    const std::shared_ptr<const MapSymbol>& mapSymbol,
-    const std::shared_ptr<const MapSymbolsGroup::AdditionalSymbolInstanceParameters>& instanceParameters_,
-    const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
-    ComputedPathsDataCache& computedPathsDataCache,
-    QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
+void OsmAnd::AtlasMapRendererSymbolsStage::acquireSymbolPreparationInputs(
+    SymbolPreparationJob& job,
+    QVector<ComputedPathToUpdate>& outComputedPathsToUpdate,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
-    Stopwatch stopwatch(metric != nullptr);
+    const auto& mapSymbol = job.mapSymbol;
 
     if (const auto onPathMapSymbol = std::dynamic_pointer_cast<const OnPathRasterMapSymbol>(mapSymbol))
     {
         if (Q_UNLIKELY(debugSettings->excludeOnPathSymbolsFromProcessing))
             return;
 
+        // Path must have at least 2 points and there must be at least one pin-point
+        if (Q_UNLIKELY(onPathMapSymbol->shareablePath31->size() < 2))
+        {
+            assert(false);
+            return;
+        }
+    }
+    else if (std::dynamic_pointer_cast<const IOnSurfaceMapSymbol>(mapSymbol))
+    {
+        if (Q_UNLIKELY(debugSettings->excludeOnSurfaceSymbolsFromProcessing))
+            return;
+    }
+    else if (std::dynamic_pointer_cast<const IBillboardMapSymbol>(mapSymbol))
+    {
+        if (Q_UNLIKELY(debugSettings->excludeBillboardSymbolsFromProcessing))
+            return;
+    }
+    else
+    {
+        assert(false);
+        return;
+    }
+
+    if (!testSymbolByFrustum(mapSymbol, job.instanceParameters, metric))
+        return;
+
+    // Get GPU resource for this map symbol, since it's useless to perform any calculations unless it's possible to draw it.
+    // Capturing changes state of resource, so it can't be done concurrently.
+    job.gpuResource = captureGpuResource(*job.pReferencesOrigins, mapSymbol);
+    if (!job.gpuResource)
+        return;
+
+    // Cached path data and placement are looked up (and inserted) here, so that parallel phase doesn't modify caches.
+    // Values in QHash don't move on insertion of other values.
+    if (const auto onPathMapSymbol = std::dynamic_pointer_cast<const OnPathRasterMapSymbol>(mapSymbol))
+    {
+        auto& computedPlacement = _computedOnPathPlacementsCache[ComputedOnPathPlacementKey(
+            onPathMapSymbol.get(),
+            static_cast<const MapSymbolsGroup::AdditionalOnPathSymbolInstanceParameters*>(job.instanceParameters.get()))];
+        if (computedPlacement.lastUsedFrameId != _computedDataFrameId)
+        {
+            computedPlacement.lastUsedFrameId = _computedDataFrameId;
+            job.pComputedOnPathPlacement = &computedPlacement;
+        }
+
+        auto& computedPathData = _computedPathsDataCache[onPathMapSymbol->shareablePath31];
+        if (computedPathData.lastUsedFrameId != _computedDataFrameId)
+        {
+            computedPathData.lastUsedFrameId = _computedDataFrameId;
+
+            ComputedPathToUpdate computedPathToUpdate = { onPathMapSymbol->shareablePath31.get(), &computedPathData };
+            outComputedPathsToUpdate.push_back(computedPathToUpdate);
+        }
+        job.pComputedPathData = &computedPathData;
+    }
+}
+
+bool OsmAnd::AtlasMapRendererSymbolsStage::testSymbolByFrustum(
+    const std::shared_ptr<const MapSymbol>& mapSymbol,
+    const std::shared_ptr<const MapSymbolsGroup::AdditionalSymbolInstanceParameters>& instanceParameters_,
+    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+{
+    if (debugSettings->disableSymbolsFastCheckByFrustum || !mapSymbol->allowFastCheckByFrustum)
+        return true;
+
+    const auto& internalState = getInternalState();
+
+    if (const auto onPathMapSymbol = std::dynamic_pointer_cast<const OnPathRasterMapSymbol>(mapSymbol))
+    {
         const auto instanceParameters =
             std::static_pointer_cast<const MapSymbolsGroup::AdditionalOnPathSymbolInstanceParameters>(instanceParameters_);
+
+        const auto& pinPointOnPath =
+            (instanceParameters && instanceParameters->overridesPinPointOnPath)
+            ? instanceParameters->pinPointOnPath
+            : onPathMapSymbol->pinPointOnPath;
+
+        if (!internalState.globalFrustum2D31.test(pinPointOnPath.point31))
+        {
+            if (metric)
+                metric->onPathSymbolsRejectedByFrustum++;
+            return false;
+        }
+    }
+    else if (const auto onSurfaceMapSymbol = std::dynamic_pointer_cast<const IOnSurfaceMapSymbol>(mapSymbol))
+    {
+        const auto instanceParameters =
+            std::static_pointer_cast<const MapSymbolsGroup::AdditionalOnSurfaceSymbolInstanceParameters>(instanceParameters_);
+
+        const auto& position31 =
+            (instanceParameters && instanceParameters->overridesPosition31)
+            ? instanceParameters->position31
+            : onSurfaceMapSymbol->getPosition31();
+
+        if (const auto vectorMapSymbol = std::dynamic_pointer_cast<const VectorMapSymbol>(onSurfaceMapSymbol))
+        {
+            AreaI symbolArea;
+            QVector<PointI> symbolRect;
+            switch (vectorMapSymbol->scaleType)
+            {
+                case VectorMapSymbol::ScaleType::Raw:
+                    symbolRect << position31;
+                    break;
+                case VectorMapSymbol::ScaleType::In31:
+                    symbolArea = AreaI(position31.y - vectorMapSymbol->scale, position31.x - vectorMapSymbol->scale, position31.y + vectorMapSymbol->scale, position31.x + vectorMapSymbol->scale);
+                    symbolRect << symbolArea.topLeft << symbolArea.topRight() << symbolArea.bottomRight << symbolArea.bottomLeft();
+                    break;
+                case VectorMapSymbol::ScaleType::InMeters:
+                    symbolArea = (AreaI)Utilities::boundingBox31FromAreaInMeters(vectorMapSymbol->scale, position31);
+                    symbolRect << symbolArea.topLeft << symbolArea.topRight() << symbolArea.bottomRight << symbolArea.bottomLeft();
+                    break;
+            }
+            if (!internalState.globalFrustum2D31.test(symbolRect))
+            {
+                if (metric)
+                    metric->onSurfaceSymbolsRejectedByFrustum++;
+                return false;
+            }
+        }
+        else if (!internalState.globalFrustum2D31.test(position31))
+        {
+            if (metric)
+                metric->onSurfaceSymbolsRejectedByFrustum++;
+            return false;
+        }
+    }
+    else if (const auto billboardMapSymbol = std::dynamic_pointer_cast<const IBillboardMapSymbol>(mapSymbol))
+    {
+        const auto instanceParameters =
+            std::static_pointer_cast<const MapSymbolsGroup::AdditionalBillboardSymbolInstanceParameters>(instanceParameters_);
+
+        const auto& position31 =
+            (instanceParameters && instanceParameters->overridesPosition31)
+            ? instanceParameters->position31
+            : billboardMapSymbol->getPosition31();
+
+        if (!internalState.globalFrustum2D31.test(position31))
+        {
+            if (metric)
+                metric->billboardSymbolsRejectedByFrustum++;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromSymbol(
+    SymbolPreparationJob& job,
+    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+{
+    // Symbol was either rejected or can't be drawn
+    if (!job.gpuResource)
+        return;
+
+    Stopwatch stopwatch(metric != nullptr);
+
+    if (const auto onPathMapSymbol = std::dynamic_pointer_cast<const OnPathRasterMapSymbol>(job.mapSymbol))
+    {
+        const auto gpuResource = std::dynamic_pointer_cast<const GPUAPI::TextureInGPU>(job.gpuResource);
+        if (!gpuResource)
+            return;
+
+        const auto instanceParameters =
+            std::static_pointer_cast<const MapSymbolsGroup::AdditionalOnPathSymbolInstanceParameters>(job.instanceParameters);
         obtainRenderablesFromOnPathSymbol(
-            mapSymbolGroup,
+            job.mapSymbolsGroup,
             onPathMapSymbol,
             instanceParameters,
-            referenceOrigins,
-            computedPathsDataCache,
-            outRenderableSymbols,
+            gpuResource,
+            *job.pComputedPathData,
+            job.pComputedOnPathPlacement,
+            job.renderables,
             metric);
     }
-    else if (const auto onSurfaceMapSymbol = std::dynamic_pointer_cast<const IOnSurfaceMapSymbol>(mapSymbol))
+    else if (const auto onSurfaceMapSymbol = std::dynamic_pointer_cast<const IOnSurfaceMapSymbol>(job.mapSymbol))
     {
-        if (Q_UNLIKELY(debugSettings->excludeOnSurfaceSymbolsFromProcessing))
-            return;
-
         const auto instanceParameters =
-            std::static_pointer_cast<const MapSymbolsGroup::AdditionalOnSurfaceSymbolInstanceParameters>(instanceParameters_);
+            std::static_pointer_cast<const MapSymbolsGroup::AdditionalOnSurfaceSymbolInstanceParameters>(job.instanceParameters);
         obtainRenderablesFromOnSurfaceSymbol(
-            mapSymbolGroup,
+            job.mapSymbolsGroup,
             onSurfaceMapSymbol,
             instanceParameters,
-            referenceOrigins,
-            outRenderableSymbols,
+            job.gpuResource,
+            job.renderables,
             metric);
     }
-    else if (const auto billboardMapSymbol = std::dynamic_pointer_cast<const IBillboardMapSymbol>(mapSymbol))
+    else if (const auto billboardMapSymbol = std::dynamic_pointer_cast<const IBillboardMapSymbol>(job.mapSymbol))
     {
-        if (Q_UNLIKELY(debugSettings->excludeBillboardSymbolsFromProcessing))
-            return;
-
         const auto instanceParameters =
-            std::static_pointer_cast<const MapSymbolsGroup::AdditionalBillboardSymbolInstanceParameters>(instanceParameters_);
+            std::static_pointer_cast<const MapSymbolsGroup::AdditionalBillboardSymbolInstanceParameters>(job.instanceParameters);
         obtainRenderablesFromBillboardSymbol(
-            mapSymbolGroup,
+            job.mapSymbolsGroup,
             billboardMapSymbol,
             instanceParameters,
-            referenceOrigins,
-            outRenderableSymbols,
+            job.gpuResource,
+            job.renderables,
             metric);
     }
     else
@@ -744,6 +955,13 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromSymbol(
         assert(false);
     }
 
+    // Bboxes don't depend on other symbols, so they are computed here as well
+    for (const auto& renderable : constOf(job.renderables))
+    {
+        if (!renderable->bboxesComputed)
+            computeRenderableSymbolBBoxes(renderable);
+    }
+
     if (metric)
     {
         metric->elapsedTimeForObtainRenderableSymbolCalls += stopwatch.elapsed();
@@ -751,9 +969,79 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromSymbol(
     }
 }
 
+void OsmAnd::AtlasMapRendererSymbolsStage::computeRenderableSymbolBBoxes(
+    const std::shared_ptr<RenderableSymbol>& renderable) const
+{
+    if (const auto& renderableBillboard = std::dynamic_pointer_cast<RenderableBillboardSymbol>(renderable))
+    {
+        if (std::dynamic_pointer_cast<const RasterMapSymbol>(renderableBillboard->mapSymbol))
+            computeBillboardRasterSymbolBBoxes(renderableBillboard);
+    }
+    else if (const auto& renderableOnPath = std::dynamic_pointer_cast<RenderableOnPathSymbol>(renderable))
+    {
+        computeOnPathSymbolBBoxes(renderableOnPath);
+    }
+}
+
+void OsmAnd::AtlasMapRendererSymbolsStage::processInParallel(
+    const int itemsCount,
+    const std::function<void (const int itemIndex, AtlasMapRenderer_Metrics::Metric_renderFrame* const metric)> processItem,
+    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+{
+    // Debug stage doesn't support concurrent additions
+    const auto maxThreadsCount = Q_UNLIKELY(debugSettings->showOnPathSymbolsRenderablesPaths)
+        ? 1
+        : qMin(_symbolsPreparationWorkerPool.maxThreadCount() + 1, QThread::idealThreadCount());
+    const auto threadsCount = qMin(maxThreadsCount, itemsCount / MinItemsPerPreparationThread);
+    if (threadsCount <= 1)
+    {
+        for (auto itemIndex = 0; itemIndex < itemsCount; itemIndex++)
+            processItem(itemIndex, metric);
+        return;
+    }
+
+    // Items are taken in batches until none left. Each thread collects metric of its own, those are merged afterwards.
+    std::atomic<int> nextItemIndex(0);
+    std::vector<AtlasMapRenderer_Metrics::Metric_renderFrame> threadsMetrics(metric ? threadsCount : 0);
+    const auto processBatches =
+        [itemsCount, &processItem, &nextItemIndex, &threadsMetrics, metric]
+        (const int threadIndex)
+        {
+            const auto threadMetric = metric ? &threadsMetrics[threadIndex] : nullptr;
+            for (;;)
+            {
+                const auto batchStart = nextItemIndex.fetch_add(ItemsPerPreparationBatch);
+                if (batchStart >= itemsCount)
+                    break;
+
+                const auto batchEnd = qMin(batchStart + static_cast<int>(ItemsPerPreparationBatch), itemsCount);
+                for (auto itemIndex = batchStart; itemIndex < batchEnd; itemIndex++)
+                    processItem(itemIndex, threadMetric);
+            }
+        };
+    for (auto threadIndex = 1; threadIndex < threadsCount; threadIndex++)
+    {
+        _symbolsPreparationWorkerPool.enqueue(new QRunnableFunctor(
+            [threadIndex, &processBatches]
+            (const QRunnableFunctor* const runnable)
+            {
+                processBatches(threadIndex);
+            }));
+    }
+    processBatches(0);
+    _symbolsPreparationWorkerPool.waitForDone();
+
+    if (metric)
+    {
+        for (const auto& threadMetric : threadsMetrics)
+            metric->accumulate(threadMetric);
+        metric->symbolsPreparationThreads = qMax(metric->symbolsPreparationThreads, static_cast<unsigned int>(threadsCount));
+    }
+}
+
 bool OsmAnd::AtlasMapRendererSymbolsStage::plotSymbol(
     const std::shared_ptr<RenderableSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     Stopwatch stopwatch(metric != nullptr);
@@ -794,11 +1082,172 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotSymbol(
     return plotted;
 }
 
+bool OsmAnd::AtlasMapRendererSymbolsStage::canReusePlacement(const unsigned int mapSymbolsVersion) const
+{
+    if (!_placementAnchorValid)
+        return false;
+
+    // Any change in published symbols or debug settings invalidates placement
+    if (_placementAnchorSymbolsVersion != mapSymbolsVersion || _placementAnchorDebugSettings != debugSettings)
+        return false;
+
+    // Everything except target has to be exactly the same
+    const auto& anchorState = _placementAnchorState;
+    if (!isSameStateExceptTarget(anchorState, _computedDataState))
+        return false;
+
+    // Measure how far on screen target has moved since placement was computed
+    const auto& internalState = getInternalState();
+    const auto targetOffset = Utilities::convert31toFloat(
+        anchorState.target31 - currentState.target31,
+        currentState.zoomLevel) * static_cast<float>(AtlasMapRenderer::TileSize3D);
+    const auto anchorTargetOnScreen = glm_extensions::fastProject(
+        glm::vec3(targetOffset.x, 0.0f, targetOffset.y),
+        internalState.mPerspectiveProjectionView,
+        internalState.glmViewport);
+    const auto targetOnScreen = glm_extensions::fastProject(
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        internalState.mPerspectiveProjectionView,
+        internalState.glmViewport);
+    const auto shiftInPixels = glm::distance(
+        glm::vec2(anchorTargetOnScreen.x, anchorTargetOnScreen.y),
+        glm::vec2(targetOnScreen.x, targetOnScreen.y));
+
+    return shiftInPixels <= static_cast<float>(MaxReusedPlacementShiftInPixels);
+}
+
+void OsmAnd::AtlasMapRendererSymbolsStage::beginPlacement(const unsigned int mapSymbolsVersion) const
+{
+    _reusingPlacement = canReusePlacement(mapSymbolsVersion);
+    if (_reusingPlacement)
+        return;
+
+    // Placement is going to be computed in full, so current state becomes the anchor
+    _placementAnchorValid = true;
+    _placementAnchorState = _computedDataState;
+    _placementAnchorSymbolsVersion = mapSymbolsVersion;
+    _placementAnchorDebugSettings = debugSettings;
+    _placementAnchorOutcomes.clear();
+}
+
+bool OsmAnd::AtlasMapRendererSymbolsStage::plotSymbolWithPlacementReuse(
+    const std::shared_ptr<RenderableSymbol>& renderable,
+    const int renderableIndex,
+    ScreenGrid& intersections,
+    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+{
+    PlacementKey placementKey;
+    placementKey.mapSymbol = renderable->mapSymbol.get();
+    placementKey.groupInstance = renderable->genericInstanceParameters
+        ? renderable->genericInstanceParameters->groupInstancePtr
+        : nullptr;
+    placementKey.renderableIndex = renderableIndex;
+
+    _currentPlacementHint = PlacementHint::None;
+    if (_reusingPlacement)
+    {
+        const auto citOutcome = _placementAnchorOutcomes.constFind(placementKey);
+        if (citOutcome != _placementAnchorOutcomes.cend())
+            _currentPlacementHint = *citOutcome ? PlacementHint::Accepted : PlacementHint::Rejected;
+    }
+    _currentPlotRejectedByCollision = false;
+
+    const auto plotted = plotSymbol(renderable, intersections, metric);
+
+    // Remember outcome of collision checks, if they were actually performed
+    if (_currentPlacementHint == PlacementHint::None)
+    {
+        if (plotted || _currentPlotRejectedByCollision)
+            _placementAnchorOutcomes.insert(placementKey, plotted);
+
+        if (metric)
+            metric->symbolsPlacementsComputed++;
+    }
+    else if (metric)
+    {
+        metric->symbolsPlacementsReused++;
+    }
+    _currentPlacementHint = PlacementHint::None;
+
+    return plotted;
+}
+
+void OsmAnd::AtlasMapRendererSymbolsStage::beginComputedDataFrame() const
+{
+    _computedDataFrameId++;
+
+    const auto mapState = currentState.getMapState();
+    if (!isSameStateExceptTarget(_computedDataState, mapState) || _computedDataState.target31 != mapState.target31)
+    {
+        _computedDataScreenStateId++;
+        _computedDataState = mapState;
+    }
+}
+
+void OsmAnd::AtlasMapRendererSymbolsStage::endComputedDataFrame(
+    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+{
+    // Path of placement that was reused this frame is still in use, even if nothing else has touched it
+    for (const auto& computedPlacement : constOf(_computedOnPathPlacementsCache))
+    {
+        if (computedPlacement.lastUsedFrameId != _computedDataFrameId || !computedPlacement.mapSymbol)
+            continue;
+
+        const auto itComputedPathData = _computedPathsDataCache.find(computedPlacement.mapSymbol->shareablePath31);
+        if (itComputedPathData != _computedPathsDataCache.end())
+            itComputedPathData->lastUsedFrameId = _computedDataFrameId;
+    }
+
+    // Forget everything that wasn't used during this frame
+    auto itComputedPathData = mutableIteratorOf(_computedPathsDataCache);
+    while (itComputedPathData.hasNext())
+    {
+        if (itComputedPathData.next().value().lastUsedFrameId != _computedDataFrameId)
+            itComputedPathData.remove();
+    }
+    auto itComputedOnPathPlacement = mutableIteratorOf(_computedOnPathPlacementsCache);
+    while (itComputedOnPathPlacement.hasNext())
+    {
+        if (itComputedOnPathPlacement.next().value().lastUsedFrameId != _computedDataFrameId)
+            itComputedOnPathPlacement.remove();
+    }
+
+    if (!metric)
+        return;
+
+    const auto placementsCount = metric->onPathSymbolsPlacementsReused + metric->onPathSymbolsPlacementsComputed;
+    metric->onPathSymbolsPlacementsReuseRatio = placementsCount > 0
+        ? static_cast<float>(metric->onPathSymbolsPlacementsReused) / placementsCount
+        : 0.0f;
+
+    // Time saved is estimated from average time it took to compute single placement
+    if (metric->onPathSymbolsPlacementsComputed > 0)
+    {
+        _averageOnPathPlacementComputeTime =
+            metric->elapsedTimeForComputingOnPathSymbolsPlacements / metric->onPathSymbolsPlacementsComputed;
+    }
+    metric->estimatedTimeSavedByOnPathSymbolsPlacementsReuse =
+        _averageOnPathPlacementComputeTime * metric->onPathSymbolsPlacementsReused;
+}
+
+bool OsmAnd::AtlasMapRendererSymbolsStage::isSameStateExceptTarget(const MapState& state, const MapState& otherState)
+{
+    return
+        state.windowSize == otherState.windowSize &&
+        state.viewport == otherState.viewport &&
+        state.fieldOfView == otherState.fieldOfView &&
+        state.azimuth == otherState.azimuth &&
+        state.elevationAngle == otherState.elevationAngle &&
+        state.zoomLevel == otherState.zoomLevel &&
+        state.visualZoom == otherState.visualZoom &&
+        state.visualZoomShift == otherState.visualZoomShift;
+}
+
 void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromBillboardSymbol(
     const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
     const std::shared_ptr<const IBillboardMapSymbol>& billboardMapSymbol,
     const std::shared_ptr<const MapSymbolsGroup::AdditionalBillboardSymbolInstanceParameters>& instanceParameters,
-    const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
+    const std::shared_ptr<const GPUAPI::ResourceInGPU>& gpuResource,
     QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
@@ -810,39 +1259,13 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromBillboardSymbol(
         ? instanceParameters->position31
         : billboardMapSymbol->getPosition31();
 
-    // Test against visible frustum area (if allowed)
-    if (!debugSettings->disableSymbolsFastCheckByFrustum &&
-        mapSymbol->allowFastCheckByFrustum &&
-        !internalState.globalFrustum2D31.test(position31))
-    {
-        if (metric)
-            metric->billboardSymbolsRejectedByFrustum++;
-        return;
-    }
-
-    //////////////////////////////////////////////////////////////////////////
-    /*
-    {
-        if (const auto symbolsGroupWithId = std::dynamic_pointer_cast<MapSymbolsGroupWithId>(mapSymbol->group.lock()))
-        {
-            if ((symbolsGroupWithId->id >> 1) != 244622303)
-                return;
-        }
-    }
-    */
-    //////////////////////////////////////////////////////////////////////////
-
-    // Get GPU resource
-    const auto gpuResource = captureGpuResource(referenceOrigins, mapSymbol);
-    if (!gpuResource)
-        return;
-
     std::shared_ptr<RenderableBillboardSymbol> renderable(new RenderableBillboardSymbol());
     renderable->mapSymbolGroup = mapSymbolGroup;
     renderable->mapSymbol = mapSymbol;
     renderable->genericInstanceParameters = instanceParameters;
     renderable->instanceParameters = instanceParameters;
     renderable->gpuResource = gpuResource;
+    renderable->bboxesComputed = false;
     outRenderableSymbols.push_back(renderable);
 
     // Calculate location of symbol in world coordinates.
@@ -859,7 +1282,7 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromBillboardSymbol(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::plotBillboardSymbol(
     const std::shared_ptr<RenderableBillboardSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     bool plotted = false;
@@ -880,15 +1303,12 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotBillboardSymbol(
     return plotted;
 }
 
-bool OsmAnd::AtlasMapRendererSymbolsStage::plotBillboardRasterSymbol(
-    const std::shared_ptr<RenderableBillboardSymbol>& renderable,
-    ScreenQuadTree& intersections,
-    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+void OsmAnd::AtlasMapRendererSymbolsStage::computeBillboardRasterSymbolBBoxes(
+    const std::shared_ptr<RenderableBillboardSymbol>& renderable) const
 {
     const auto& internalState = getInternalState();
 
     const auto& symbol = std::static_pointer_cast<const BillboardRasterMapSymbol>(renderable->mapSymbol);
-    const auto& symbolGroupPtr = symbol->groupPtr;
 
     const auto& offsetOnScreen =
         (renderable->instanceParameters && renderable->instanceParameters->overridesOffset)
@@ -913,6 +1333,21 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotBillboardRasterSymbol(
     boundsInWindow.right() += symbol->margin.right();
     boundsInWindow.bottom() += symbol->margin.bottom();
     renderable->intersectionBBox = boundsInWindow;
+    renderable->bboxesComputed = true;
+}
+
+bool OsmAnd::AtlasMapRendererSymbolsStage::plotBillboardRasterSymbol(
+    const std::shared_ptr<RenderableBillboardSymbol>& renderable,
+    ScreenGrid& intersections,
+    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+{
+    const auto& internalState = getInternalState();
+
+    const auto& symbol = std::static_pointer_cast<const BillboardRasterMapSymbol>(renderable->mapSymbol);
+    const auto& symbolGroupPtr = symbol->groupPtr;
+
+    if (!renderable->bboxesComputed)
+        computeBillboardRasterSymbolBBoxes(renderable);
 
     if (!applyVisibilityFiltering(renderable->visibleBBox, intersections, metric))
         return false;
@@ -928,7 +1363,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotBillboardRasterSymbol(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::plotBillboardVectorSymbol(
     const std::shared_ptr<RenderableBillboardSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     assert(false);
@@ -939,7 +1374,7 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnSurfaceSymbol(
     const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
     const std::shared_ptr<const IOnSurfaceMapSymbol>& onSurfaceMapSymbol,
     const std::shared_ptr<const MapSymbolsGroup::AdditionalOnSurfaceSymbolInstanceParameters>& instanceParameters,
-    const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
+    const std::shared_ptr<const GPUAPI::ResourceInGPU>& gpuResource,
     QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
@@ -955,47 +1390,6 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnSurfaceSymbol(
         ? instanceParameters->direction
         : onSurfaceMapSymbol->getDirection();
 
-    // Test against visible frustum area (if allowed)
-    if (!debugSettings->disableSymbolsFastCheckByFrustum && mapSymbol->allowFastCheckByFrustum)
-    {
-        if (const auto vectorMapSymbol = std::dynamic_pointer_cast<const VectorMapSymbol>(onSurfaceMapSymbol))
-        {
-            AreaI symbolArea;
-            QVector<PointI> symbolRect;
-            switch (vectorMapSymbol->scaleType)
-            {
-                case VectorMapSymbol::ScaleType::Raw:
-                    symbolRect << position31;
-                    break;
-                case VectorMapSymbol::ScaleType::In31:
-                    symbolArea = AreaI(position31.y - vectorMapSymbol->scale, position31.x - vectorMapSymbol->scale, position31.y + vectorMapSymbol->scale, position31.x + vectorMapSymbol->scale);
-                    symbolRect << symbolArea.topLeft << symbolArea.topRight() << symbolArea.bottomRight << symbolArea.bottomLeft();
-                    break;
-                case VectorMapSymbol::ScaleType::InMeters:
-                    symbolArea = (AreaI)Utilities::boundingBox31FromAreaInMeters(vectorMapSymbol->scale, position31);
-                    symbolRect << symbolArea.topLeft << symbolArea.topRight() << symbolArea.bottomRight << symbolArea.bottomLeft();
-                    break;
-            }
-            if (!internalState.globalFrustum2D31.test(symbolRect))
-            {
-                if (metric)
-                    metric->onSurfaceSymbolsRejectedByFrustum++;
-                return;
-            }
-        }
-        else if (!internalState.globalFrustum2D31.test(position31))
-        {
-            if (metric)
-                metric->onSurfaceSymbolsRejectedByFrustum++;
-            return;
-        }
-    }
-    
-    // Get GPU resource
-    const auto gpuResource = captureGpuResource(referenceOrigins, mapSymbol);
-    if (!gpuResource)
-        return;
-
     if (const auto& gpuMeshResource = std::dynamic_pointer_cast<const GPUAPI::MeshInGPU>(gpuResource))
     {
         if (gpuMeshResource->position31 != nullptr)
@@ -1008,6 +1402,7 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnSurfaceSymbol(
     renderable->genericInstanceParameters = instanceParameters;
     renderable->instanceParameters = instanceParameters;
     renderable->gpuResource = gpuResource;
+    renderable->bboxesComputed = false;
     outRenderableSymbols.push_back(renderable);
 
     // Calculate location of symbol in world coordinates.
@@ -1030,7 +1425,7 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnSurfaceSymbol(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnSurfaceSymbol(
     const std::shared_ptr<RenderableOnSurfaceSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     if (std::dynamic_pointer_cast<const RasterMapSymbol>(renderable->mapSymbol))
@@ -1054,7 +1449,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnSurfaceSymbol(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnSurfaceRasterSymbol(
     const std::shared_ptr<RenderableOnSurfaceSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     const auto& internalState = getInternalState();
@@ -1067,7 +1462,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnSurfaceRasterSymbol(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnSurfaceVectorSymbol(
     const std::shared_ptr<RenderableOnSurfaceSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     const auto& internalState = getInternalState();
@@ -1082,18 +1477,12 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnPathSymbol(
     const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
     const std::shared_ptr<const OnPathRasterMapSymbol>& onPathMapSymbol,
     const std::shared_ptr<const MapSymbolsGroup::AdditionalOnPathSymbolInstanceParameters>& instanceParameters,
-    const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
-    ComputedPathsDataCache& computedPathsDataCache,
+    const std::shared_ptr<const GPUAPI::TextureInGPU>& gpuResource,
+    const ComputedPathData& computedPathData,
+    ComputedOnPathPlacement* const pComputedPlacement,
     QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
-    // Path must have at least 2 points and there must be at least one pin-point
-    if (Q_UNLIKELY(onPathMapSymbol->shareablePath31->size() < 2))
-    {
-        assert(false);
-        return;
-    }
-
     const auto& internalState = getInternalState();
 
     const auto& pinPointOnPath =
@@ -1101,50 +1490,38 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnPathSymbol(
         ? instanceParameters->pinPointOnPath
         : onPathMapSymbol->pinPointOnPath;
 
-    // Test against visible frustum area (if allowed)
-    if (!debugSettings->disableSymbolsFastCheckByFrustum &&
-        onPathMapSymbol->allowFastCheckByFrustum &&
-        !internalState.globalFrustum2D31.test(pinPointOnPath.point31))
+    // If map state hasn't changed since this instance was placed, previous placement is still valid.
+    // Debug paths are produced only during computation, so there's no reuse while they are shown.
+    if (pComputedPlacement &&
+        pComputedPlacement->screenStateId == _computedDataScreenStateId &&
+        !debugSettings->showOnPathSymbolsRenderablesPaths)
     {
         if (metric)
-            metric->onPathSymbolsRejectedByFrustum++;
-        return;
-    }
+            metric->onPathSymbolsPlacementsReused++;
 
-    ////////////////////////////////////////////////////////////////////////////
-    /*
-    {
-        if (const auto symbolsGroupWithId = std::dynamic_pointer_cast<MapSymbolsGroupWithId>(onPathMapSymbol->group.lock()))
+        if (!pComputedPlacement->renderable)
+            return;
+
+        // Renderable itself can be reused only if it references same GPU resource
+        if (pComputedPlacement->renderable->gpuResource != gpuResource)
         {
-            if ((symbolsGroupWithId->id >> 1) != 244622303)
-                return;
+            const std::shared_ptr<RenderableOnPathSymbol> renderable(
+                new RenderableOnPathSymbol(*pComputedPlacement->renderable));
+            renderable->gpuResource = gpuResource;
+            pComputedPlacement->renderable = renderable;
         }
-    }
-    */
-    ////////////////////////////////////////////////////////////////////////////
-
-    // Get GPU resource for this map symbol, since it's useless to perform any calculations unless it's possible to draw it
-    const auto gpuResource = std::dynamic_pointer_cast<const GPUAPI::TextureInGPU>(captureGpuResource(referenceOrigins, onPathMapSymbol));
-    if (!gpuResource)
+        outRenderableSymbols.push_back(pComputedPlacement->renderable);
         return;
-
-    // Processing pin-point needs path in world and path on screen, as well as lengths of all segments. This may have already been computed
-    auto itComputedPathData = computedPathsDataCache.find(onPathMapSymbol->shareablePath31);
-    if (itComputedPathData == computedPathsDataCache.end())
+    }
+    if (pComputedPlacement)
     {
-        const auto& path31 = *onPathMapSymbol->shareablePath31;
-
-        ComputedPathData computedPathData;
-
-        //TODO: optimize by using lazy computation
-        computedPathData.pathInWorld = convertPoints31ToWorld(path31);
-        computedPathData.pathSegmentsLengthsInWorld = computePathSegmentsLengths(computedPathData.pathInWorld);
-        computedPathData.pathOnScreen = projectFromWorldToScreen(computedPathData.pathInWorld);
-        computedPathData.pathSegmentsLengthsOnScreen = computePathSegmentsLengths(computedPathData.pathOnScreen);
-
-        itComputedPathData = computedPathsDataCache.insert(onPathMapSymbol->shareablePath31, computedPathData);
+        pComputedPlacement->mapSymbol = onPathMapSymbol;
+        pComputedPlacement->instanceParameters = instanceParameters;
+        pComputedPlacement->screenStateId = _computedDataScreenStateId;
+        pComputedPlacement->renderable.reset();
     }
-    const auto& computedPathData = *itComputedPathData;
+
+    Stopwatch placementStopwatch(metric != nullptr);
      
     // Pin-point represents center of symbol
     const auto halfSizeInPixels = onPathMapSymbol->size.x / 2.0f;
@@ -1238,7 +1615,14 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnPathSymbol(
 
     // If this symbol instance doesn't fit in both 2D and 3D, skip it
     if (!fits)
+    {
+        if (metric)
+        {
+            metric->onPathSymbolsPlacementsComputed++;
+            metric->elapsedTimeForComputingOnPathSymbolsPlacements += placementStopwatch.elapsed();
+        }
         return;
+    }
 
     // Compute exact points
     if (is2D)
@@ -1308,7 +1692,16 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnPathSymbol(
         subpathEndIndex,
         directionOnScreen,
         onPathMapSymbol->glyphsWidth);
+    renderable->bboxesComputed = false;
     outRenderableSymbols.push_back(renderable);
+    if (pComputedPlacement)
+        pComputedPlacement->renderable = renderable;
+
+    if (metric)
+    {
+        metric->onPathSymbolsPlacementsComputed++;
+        metric->elapsedTimeForComputingOnPathSymbolsPlacements += placementStopwatch.elapsed();
+    }
 
     if (Q_UNLIKELY(debugSettings->showOnPathSymbolsRenderablesPaths))
     {
@@ -1386,9 +1779,74 @@ void OsmAnd::AtlasMapRendererSymbolsStage::obtainRenderablesFromOnPathSymbol(
     }
 }
 
+void OsmAnd::AtlasMapRendererSymbolsStage::updateComputedPathData(
+    const QVector<PointI>& path31,
+    ComputedPathData& computedPathData,
+    AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
+{
+    // If map state hasn't changed, everything is valid as is
+    if (computedPathData.screenStateId == _computedDataScreenStateId)
+    {
+        if (metric)
+            metric->onPathPathsReused++;
+        return;
+    }
+
+    if (computedPathData.basePathInWorld.isEmpty() || computedPathData.zoomLevel != currentState.zoomLevel)
+    {
+        computedPathData.zoomLevel = currentState.zoomLevel;
+        computedPathData.baseTarget31 = currentState.target31;
+        computedPathData.basePathInWorld = convertPoints31ToWorld(path31);
+        computedPathData.pathSegmentsLengthsInWorld = computePathSegmentsLengths(computedPathData.basePathInWorld);
+        computedPathData.pathInWorld = computedPathData.basePathInWorld;
+
+        if (metric)
+            metric->onPathPathsComputed++;
+    }
+    else
+    {
+        // Path in world is relative to target, thus translation only shifts it. Lengths of segments remain the same.
+        // Shift is always applied to base path, so that errors don't accumulate.
+        if (computedPathData.baseTarget31 == currentState.target31)
+        {
+            computedPathData.pathInWorld = computedPathData.basePathInWorld;
+        }
+        else
+        {
+            const glm::vec2 offsetInWorld = Utilities::convert31toFloat(
+                computedPathData.baseTarget31 - currentState.target31,
+                currentState.zoomLevel) * static_cast<float>(AtlasMapRenderer::TileSize3D);
+
+            const auto pointsCount = computedPathData.basePathInWorld.size();
+            computedPathData.pathInWorld.resize(pointsCount);
+            auto pPointInWorld = computedPathData.pathInWorld.data();
+            auto pBasePointInWorld = computedPathData.basePathInWorld.constData();
+            for (auto idx = 0; idx < pointsCount; idx++)
+                *(pPointInWorld++) = *(pBasePointInWorld++) + offsetInWorld;
+        }
+
+        if (metric)
+            metric->onPathPathsTranslated++;
+    }
+
+    computedPathData.pathOnScreen = projectFromWorldToScreen(computedPathData.pathInWorld);
+    computedPathData.pathSegmentsLengthsOnScreen = computePathSegmentsLengths(computedPathData.pathOnScreen);
+    computedPathData.screenStateId = _computedDataScreenStateId;
+}
+
+void OsmAnd::AtlasMapRendererSymbolsStage::computeOnPathSymbolBBoxes(
+    const std::shared_ptr<RenderableOnPathSymbol>& renderable) const
+{
+    const auto oobb = renderable->is2D
+        ? calculateOnPath2dOOBB(renderable)
+        : calculateOnPath3dOOBB(renderable);
+    renderable->visibleBBox = renderable->intersectionBBox = (OOBBI)oobb;
+    renderable->bboxesComputed = true;
+}
+
 bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnPathSymbol(
     const std::shared_ptr<RenderableOnPathSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     const auto& internalState = getInternalState();
@@ -1400,8 +1858,8 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnPathSymbol(
     if (renderable->is2D)
     {
         // Calculate OOBB for 2D SOP
-        const auto oobb = calculateOnPath2dOOBB(renderable);
-        renderable->visibleBBox = renderable->intersectionBBox = (OOBBI)oobb;
+        if (!renderable->bboxesComputed)
+            computeOnPathSymbolBBoxes(renderable);
 
         if (!applyVisibilityFiltering(renderable->visibleBBox, intersections, metric))
             return false;
@@ -1438,8 +1896,8 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnPathSymbol(
     else
     {
         // Calculate OOBB for 3D SOP in world
-        const auto oobb = calculateOnPath3dOOBB(renderable);
-        renderable->visibleBBox = renderable->intersectionBBox = (OOBBI)oobb;
+        if (!renderable->bboxesComputed)
+            computeOnPathSymbolBBoxes(renderable);
 
         if (!applyVisibilityFiltering(renderable->visibleBBox, intersections, metric))
             return false;
@@ -1493,7 +1951,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::plotOnPathSymbol(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::applyVisibilityFiltering(
     const ScreenQuadTree::BBox& visibleBBox,
-    const ScreenQuadTree& intersections,
+    const ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     Stopwatch stopwatch(metric != nullptr);
@@ -1518,7 +1976,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyVisibilityFiltering(
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::applyIntersectionWithOtherSymbolsFiltering(
     const std::shared_ptr<const RenderableSymbol>& renderable,
-    const ScreenQuadTree& intersections,
+    const ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     if (Q_UNLIKELY(debugSettings->skipSymbolsIntersectionCheck))
@@ -1529,6 +1987,10 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyIntersectionWithOtherSymbolsFilt
     if (symbol->intersectsWithClasses.isEmpty())
         return true;
 
+    // Outcome may be known from last full placement
+    if (_currentPlacementHint != PlacementHint::None)
+        return _currentPlacementHint == PlacementHint::Accepted;
+
     Stopwatch stopwatch(metric != nullptr);
     
     // Check intersections
@@ -1544,7 +2006,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyIntersectionWithOtherSymbolsFilt
         : nullptr;
     const auto intersects = intersections.test(renderable->intersectionBBox, false,
         [symbolGroupPtr, symbolIntersectsWithClasses, symbolIntersectsWithAnyClass, anyIntersectionClass, symbolGroupInstancePtr, checkIntersectionsWithinGroup]
-        (const std::shared_ptr<const RenderableSymbol>& otherRenderable, const ScreenQuadTree::BBox& otherBBox) -> bool
+        (const std::shared_ptr<const RenderableSymbol>& otherRenderable, const ScreenGrid::BBox& otherBBox) -> bool
         {
             const auto& otherSymbol = otherRenderable->mapSymbol;
 
@@ -1584,6 +2046,8 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyIntersectionWithOtherSymbolsFilt
 
     if (intersects)
     {
+        _currentPlotRejectedByCollision = true;
+
         if (Q_UNLIKELY(debugSettings->showSymbolsBBoxesRejectedByIntersectionCheck))
             addIntersectionDebugBox(renderable, ColorARGB::fromSkColor(SK_ColorRED).withAlpha(50));
         return false;
@@ -1593,7 +2057,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyIntersectionWithOtherSymbolsFilt
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::applyMinDistanceToSameContentFromOtherSymbolFiltering(
     const std::shared_ptr<const RenderableSymbol>& renderable,
-    const ScreenQuadTree& intersections,
+    const ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     if (Q_UNLIKELY(debugSettings->skipSymbolsMinDistanceToSameContentFromOtherSymbolCheck))
@@ -1604,6 +2068,10 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyMinDistanceToSameContentFromOthe
     if (symbol->minDistance <= 0.0f || symbol->content.isNull())
         return true;
 
+    // Outcome may be known from last full placement
+    if (_currentPlacementHint != PlacementHint::None)
+        return _currentPlacementHint == PlacementHint::Accepted;
+
     Stopwatch stopwatch(metric != nullptr);
 
     // Query for similar content from other groups in area of "minDistance" to exclude duplicates
@@ -1614,7 +2082,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyMinDistanceToSameContentFromOthe
     const auto& symbolContent = symbol->content;
     const auto hasSimilarContent = intersections.test(renderable->intersectionBBox.getEnlargedBy(symbol->minDistance), false,
         [symbolContent, symbolGroupPtr, symbolGroupInstancePtr]
-        (const std::shared_ptr<const RenderableSymbol>& otherRenderable, const ScreenQuadTree::BBox& otherBBox) -> bool
+        (const std::shared_ptr<const RenderableSymbol>& otherRenderable, const ScreenGrid::BBox& otherBBox) -> bool
         {
             const auto otherSymbol = std::dynamic_pointer_cast<const RasterMapSymbol>(otherRenderable->mapSymbol);
             if (!otherSymbol)
@@ -1645,6 +2113,8 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyMinDistanceToSameContentFromOthe
 
     if (hasSimilarContent)
     {
+        _currentPlotRejectedByCollision = true;
+
         if (Q_UNLIKELY(debugSettings->showSymbolsBBoxesRejectedByMinDistanceToSameContentFromOtherSymbolCheck))
             addIntersectionDebugBox(renderable, ColorARGB::fromSkColor(SK_ColorRED).withAlpha(128));
 
@@ -1659,7 +2129,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage::applyMinDistanceToSameContentFromOthe
 
 bool OsmAnd::AtlasMapRendererSymbolsStage::addToIntersections(
     const std::shared_ptr<const RenderableSymbol>& renderable,
-    ScreenQuadTree& intersections,
+    ScreenGrid& intersections,
     AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const
 {
     if (Q_UNLIKELY(debugSettings->allSymbolsTransparentForIntersectionLookup))
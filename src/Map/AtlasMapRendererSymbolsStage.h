@@ -2,10 +2,13 @@
 #define _OSMAND_CORE_ATLAS_MAP_RENDERER_SYMBOLS_STAGE_H_
 
 #include "stdlib_common.h"
+#include <functional>
 
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QReadWriteLock>
+#include <QHash>
+#include <QPair>
 #include "restore_internal_warnings.h"
 
 #include "ignore_warnings_on_external_includes.h"
@@ -15,8 +18,11 @@
 #include "OsmAndCore.h"
 #include "CommonTypes.h"
 #include "QuadTree.h"
+#include "UniformGrid.h"
+#include "MapRendererState.h"
 #include "AtlasMapRendererStage.h"
 #include "GPUAPI.h"
+#include "WorkerPool.h"
 
 namespace OsmAnd
 {
@@ -31,6 +37,10 @@ namespace OsmAnd
     public:
         struct RenderableSymbol;
         typedef QuadTree< std::shared_ptr<const RenderableSymbol>, AreaI::CoordType > ScreenQuadTree;
+        typedef UniformGrid< std::shared_ptr<const RenderableSymbol>, AreaI::CoordType > ScreenGrid;
+        enum {
+            ScreenGridCellSize = 64,
+        };
 
         struct RenderableSymbol
         {
@@ -44,6 +54,9 @@ namespace OsmAnd
             double distanceToCamera;
             ScreenQuadTree::BBox visibleBBox;
             ScreenQuadTree::BBox intersectionBBox;
+
+            // Set once visible and intersection bboxes were computed, so plotting (or reused renderable) skips that
+            bool bboxesComputed;
         };
 
         struct RenderableBillboardSymbol : RenderableSymbol
@@ -110,44 +123,196 @@ namespace OsmAnd
     private:
         bool obtainRenderableSymbols(
             QList< std::shared_ptr<const RenderableSymbol> >& outRenderableSymbols,
-            ScreenQuadTree& outIntersections,
+            ScreenGrid& outIntersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool obtainRenderableSymbols(
             const MapRenderer::PublishedMapSymbolsByOrder& mapSymbolsByOrder,
             QList< std::shared_ptr<const RenderableSymbol> >& outRenderableSymbols,
-            ScreenQuadTree& outIntersections,
+            ScreenGrid& outIntersections,
+            const unsigned int mapSymbolsVersion,
             MapRenderer::PublishedMapSymbolsByOrder* pOutAcceptedMapSymbolsByOrder,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         mutable MapRenderer::PublishedMapSymbolsByOrder _lastAcceptedMapSymbolsByOrder;
+        mutable unsigned int _lastAcceptedMapSymbolsVersion;
+        mutable int _lastPreparedSymbolsCount;
+
+        // Grids are swapped with published ones, so their storage is reused on next frame
+        ScreenGrid _intersections;
+        ScreenGrid _visibleSymbols;
 
         mutable QReadWriteLock _lastPreparedIntersectionsLock;
-        ScreenQuadTree _lastPreparedIntersections;
+        ScreenGrid _lastPreparedIntersections;
 
         mutable QReadWriteLock _lastVisibleSymbolsLock;
-        ScreenQuadTree _lastVisibleSymbols;
+        ScreenGrid _lastVisibleSymbols;
+
+        // Placement reuse: while map is only slightly translated from the state in which placement was computed
+        // and published symbols remain the same, outcomes of intersection checks are taken from that placement
+        enum {
+            MaxReusedPlacementShiftInPixels = 4,
+        };
+        struct PlacementKey
+        {
+            const MapSymbol* mapSymbol;
+            const MapSymbolsGroup::AdditionalInstance* groupInstance;
+            int renderableIndex;
 
-        // Path calculations cache
+            inline bool operator==(const PlacementKey& that) const
+            {
+                return mapSymbol == that.mapSymbol &&
+                    groupInstance == that.groupInstance &&
+                    renderableIndex == that.renderableIndex;
+            }
+
+            friend inline uint qHash(const PlacementKey& key, uint seed = 0)
+            {
+                return ::qHash(key.mapSymbol, seed) ^ ::qHash(key.groupInstance, seed) ^ ::qHash(key.renderableIndex, seed);
+            }
+        };
+        enum class PlacementHint
+        {
+            None,
+            Accepted,
+            Rejected,
+        };
+        mutable bool _placementAnchorValid;
+        mutable MapState _placementAnchorState;
+        mutable unsigned int _placementAnchorSymbolsVersion;
+        mutable std::shared_ptr<const MapRendererDebugSettings> _placementAnchorDebugSettings;
+        mutable QHash<PlacementKey, bool> _placementAnchorOutcomes;
+        mutable bool _reusingPlacement;
+        mutable PlacementHint _currentPlacementHint;
+        mutable bool _currentPlotRejectedByCollision;
+        bool canReusePlacement(const unsigned int mapSymbolsVersion) const;
+        void beginPlacement(const unsigned int mapSymbolsVersion) const;
+        bool plotSymbolWithPlacementReuse(
+            const std::shared_ptr<RenderableSymbol>& renderable,
+            const int renderableIndex,
+            ScreenGrid& intersections,
+            AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
+
+        // Path calculations cache. It's kept between frames: path in world depends only on zoom and target,
+        // so on pure translation it's shifted instead of being converted again. Path on screen is reused
+        // only while map state remains exactly the same.
         struct ComputedPathData
         {
+            inline ComputedPathData()
+                : zoomLevel(InvalidZoomLevel)
+                , screenStateId(0)
+                , lastUsedFrameId(0)
+            {
+            }
+
+            ZoomLevel zoomLevel;
+            PointI baseTarget31;
+            QVector<glm::vec2> basePathInWorld;
+            unsigned int screenStateId;
+            unsigned int lastUsedFrameId;
+
             QVector<glm::vec2> pathInWorld;
             QVector<float> pathSegmentsLengthsInWorld;
             QVector<glm::vec2> pathOnScreen;
             QVector<float> pathSegmentsLengthsOnScreen;
         };
         typedef QHash< std::shared_ptr< const QVector<PointI> >, ComputedPathData > ComputedPathsDataCache;
+        mutable ComputedPathsDataCache _computedPathsDataCache;
+        struct ComputedPathToUpdate
+        {
+            const QVector<PointI>* pPath31;
+            ComputedPathData* pComputedPathData;
+        };
+        void updateComputedPathData(
+            const QVector<PointI>& path31,
+            ComputedPathData& computedPathData,
+            AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
 
-        void obtainRenderablesFromSymbol(
-            const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
+        // Placements of on-path symbols instances, reused while map state remains exactly the same.
+        // Entry holds references to symbol and instance parameters, so that pointers in key stay unique.
+        struct ComputedOnPathPlacement
+        {
+            inline ComputedOnPathPlacement()
+                : screenStateId(0)
+                , lastUsedFrameId(0)
+            {
+            }
+
+            std::shared_ptr<const OnPathRasterMapSymbol> mapSymbol;
+            std::shared_ptr<const MapSymbolsGroup::AdditionalOnPathSymbolInstanceParameters> instanceParameters;
+            unsigned int screenStateId;
+            unsigned int lastUsedFrameId;
+
+            // nullptr if symbol instance doesn't fit the path
+            std::shared_ptr<RenderableOnPathSymbol> renderable;
+        };
+        typedef QPair<
+            const OnPathRasterMapSymbol*,
+            const MapSymbolsGroup::AdditionalOnPathSymbolInstanceParameters* > ComputedOnPathPlacementKey;
+        typedef QHash<ComputedOnPathPlacementKey, ComputedOnPathPlacement> ComputedOnPathPlacementsCache;
+        mutable ComputedOnPathPlacementsCache _computedOnPathPlacementsCache;
+
+        mutable MapState _computedDataState;
+        mutable unsigned int _computedDataScreenStateId;
+        mutable unsigned int _computedDataFrameId;
+        mutable float _averageOnPathPlacementComputeTime;
+        void beginComputedDataFrame() const;
+        void endComputedDataFrame(AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
+        static bool isSameStateExceptTarget(const MapState& state, const MapState& otherState);
+
+        // Preparation of single symbol instance. Jobs are collected in order in which symbols have to be plotted,
+        // inputs that can't be acquired concurrently are acquired serially, and then renderables are obtained
+        // in parallel, since that doesn't depend on other symbols.
+        struct SymbolPreparationJob
+        {
+            inline SymbolPreparationJob()
+                : order(0)
+                , pReferencesOrigins(nullptr)
+                , pComputedPathData(nullptr)
+                , pComputedOnPathPlacement(nullptr)
+            {
+            }
+
+            int order;
+            std::shared_ptr<const MapSymbolsGroup> mapSymbolsGroup;
+            std::shared_ptr<const MapSymbolsGroup::AdditionalInstance> groupInstance;
+            std::shared_ptr<const MapSymbol> mapSymbol;
+            std::shared_ptr<const MapSymbolsGroup::AdditionalSymbolInstanceParameters> instanceParameters;
+            const MapRenderer::MapSymbolReferenceOrigins* pReferencesOrigins;
+
+            std::shared_ptr<const GPUAPI::ResourceInGPU> gpuResource;
+            const ComputedPathData* pComputedPathData;
+            ComputedOnPathPlacement* pComputedOnPathPlacement;
+
+            QList< std::shared_ptr<RenderableSymbol> > renderables;
+        };
+        typedef QVector<SymbolPreparationJob> SymbolPreparationJobs;
+        mutable int _lastSymbolPreparationJobsCount;
+        void acquireSymbolPreparationInputs(
+            SymbolPreparationJob& job,
+            QVector<ComputedPathToUpdate>& outComputedPathsToUpdate,
+            AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
+        bool testSymbolByFrustum(
             const std::shared_ptr<const MapSymbol>& mapSymbol,
             const std::shared_ptr<const MapSymbolsGroup::AdditionalSymbolInstanceParameters>& instanceParameters,
-            const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
-            ComputedPathsDataCache& computedPathsDataCache,
-            QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
+            AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
+        void obtainRenderablesFromSymbol(
+            SymbolPreparationJob& job,
+            AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
+        void computeRenderableSymbolBBoxes(const std::shared_ptr<RenderableSymbol>& renderable) const;
+
+        // Parallel processing of independent items: render thread takes part in processing along with pool threads
+        enum {
+            MinItemsPerPreparationThread = 64,
+            ItemsPerPreparationBatch = 16,
+        };
+        mutable Concurrent::WorkerPool _symbolsPreparationWorkerPool;
+        void processInParallel(
+            const int itemsCount,
+            const std::function<void (const int itemIndex, AtlasMapRenderer_Metrics::Metric_renderFrame* const metric)> processItem,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
 
         bool plotSymbol(
             const std::shared_ptr<RenderableSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
 
         // Billboard symbols:
@@ -155,20 +320,21 @@ namespace OsmAnd
             const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
             const std::shared_ptr<const IBillboardMapSymbol>& billboardMapSymbol,
             const std::shared_ptr<const MapSymbolsGroup::AdditionalBillboardSymbolInstanceParameters>& instanceParameters,
-            const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
+            const std::shared_ptr<const GPUAPI::ResourceInGPU>& gpuResource,
             QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool plotBillboardSymbol(
             const std::shared_ptr<RenderableBillboardSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
+        void computeBillboardRasterSymbolBBoxes(const std::shared_ptr<RenderableBillboardSymbol>& renderable) const;
         bool plotBillboardRasterSymbol(
             const std::shared_ptr<RenderableBillboardSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool plotBillboardVectorSymbol(
             const std::shared_ptr<RenderableBillboardSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
 
         // On-surface symbols:
@@ -176,20 +342,20 @@ namespace OsmAnd
             const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
             const std::shared_ptr<const IOnSurfaceMapSymbol>& onSurfaceMapSymbol,
             const std::shared_ptr<const MapSymbolsGroup::AdditionalOnSurfaceSymbolInstanceParameters>& instanceParameters,
-            const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
+            const std::shared_ptr<const GPUAPI::ResourceInGPU>& gpuResource,
             QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool plotOnSurfaceSymbol(
             const std::shared_ptr<RenderableOnSurfaceSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool plotOnSurfaceRasterSymbol(
             const std::shared_ptr<RenderableOnSurfaceSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool plotOnSurfaceVectorSymbol(
             const std::shared_ptr<RenderableOnSurfaceSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
 
         // On-path symbols:
@@ -197,31 +363,33 @@ namespace OsmAnd
             const std::shared_ptr<const MapSymbolsGroup>& mapSymbolGroup,
             const std::shared_ptr<const OnPathRasterMapSymbol>& onPathMapSymbol,
             const std::shared_ptr<const MapSymbolsGroup::AdditionalOnPathSymbolInstanceParameters>& instanceParameters,
-            const MapRenderer::MapSymbolReferenceOrigins& referenceOrigins,
-            ComputedPathsDataCache& computedPathsDataCache,
+            const std::shared_ptr<const GPUAPI::TextureInGPU>& gpuResource,
+            const ComputedPathData& computedPathData,
+            ComputedOnPathPlacement* const pComputedPlacement,
             QList< std::shared_ptr<RenderableSymbol> >& outRenderableSymbols,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
+        void computeOnPathSymbolBBoxes(const std::shared_ptr<RenderableOnPathSymbol>& renderable) const;
         bool plotOnPathSymbol(
             const std::shared_ptr<RenderableOnPathSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
 
         // Intersection-related:
         bool applyVisibilityFiltering(
             const ScreenQuadTree::BBox& visibleBBox,
-            const ScreenQuadTree& intersections,
+            const ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool applyIntersectionWithOtherSymbolsFiltering(
             const std::shared_ptr<const RenderableSymbol>& renderable,
-            const ScreenQuadTree& intersections,
+            const ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool applyMinDistanceToSameContentFromOtherSymbolFiltering(
             const std::shared_ptr<const RenderableSymbol>& renderable,
-            const ScreenQuadTree& intersections,
+            const ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
         bool addToIntersections(
             const std::shared_ptr<const RenderableSymbol>& renderable,
-            ScreenQuadTree& intersections,
+            ScreenGrid& intersections,
             AtlasMapRenderer_Metrics::Metric_renderFrame* const metric) const;
 
         // Utilities:
@@ -16,6 +16,18 @@ void OsmAnd::AtlasMapRenderer_Metrics::Metric_renderFrame::reset()
     IMapRenderer_Metrics::Metric_renderFrame::reset();
 }
 
+void OsmAnd::AtlasMapRenderer_Metrics::Metric_renderFrame::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__AtlasMapRenderer_Metrics__Metric_renderFrame__FIELDS(VISIT_METRIC_FIELD);
+
+    IMapRenderer_Metrics::Metric_renderFrame::visitFields(visitor);
+}
+
+void OsmAnd::AtlasMapRenderer_Metrics::Metric_renderFrame::accumulate(const Metric_renderFrame& other)
+{
+    OsmAnd__AtlasMapRenderer_Metrics__Metric_renderFrame__FIELDS(ACCUMULATE_METRIC_FIELD);
+}
+
 QString OsmAnd::AtlasMapRenderer_Metrics::Metric_renderFrame::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
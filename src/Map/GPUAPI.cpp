@@ -2,11 +2,14 @@
 
 #include <cassert>
 
+#include "QtCommon.h"
 #include "Logging.h"
 
 OsmAnd::GPUAPI::GPUAPI()
     : _isSupported_8bitPaletteRGBA8(false)
+    , _isSupported_unpackRowLength(false)
     , isSupported_8bitPaletteRGBA8(_isSupported_8bitPaletteRGBA8)
+    , isSupported_unpackRowLength(_isSupported_unpackRowLength)
 {
 }
 
@@ -57,6 +60,31 @@ std::shared_ptr<OsmAnd::GPUAPI::SlotOnAtlasTextureInGPU> OsmAnd::GPUAPI::allocat
     return pool->allocateTile(alphaChannelType, atlasTextureAllocator);
 }
 
+std::shared_ptr<OsmAnd::GPUAPI::PackedAtlasTexturesPool> OsmAnd::GPUAPI::obtainPackedAtlasTexturesPool(
+    const TextureFormat format,
+    const unsigned int textureSize,
+    const unsigned int padding)
+{
+    auto itPool = _packedAtlasTexturesPools.constFind(format);
+    if (itPool == _packedAtlasTexturesPools.cend())
+    {
+        std::shared_ptr<PackedAtlasTexturesPool> pool(new PackedAtlasTexturesPool(this, format, textureSize, padding));
+        itPool = _packedAtlasTexturesPools.insert(format, pool);
+    }
+
+    return *itPool;
+}
+
+std::shared_ptr<OsmAnd::GPUAPI::RegionOnAtlasTextureInGPU> OsmAnd::GPUAPI::allocateRegionInAtlasTexture(
+    const unsigned int width,
+    const unsigned int height,
+    const AlphaChannelType alphaChannelType,
+    const std::shared_ptr<PackedAtlasTexturesPool>& pool,
+    PackedAtlasTexturesPool::AtlasTextureAllocator atlasTextureAllocator)
+{
+    return pool->allocateRegion(width, height, alphaChannelType, atlasTextureAllocator);
+}
+
 OsmAnd::AlphaChannelType OsmAnd::GPUAPI::getGpuResourceAlphaChannelType(const std::shared_ptr<const ResourceInGPU> gpuResource)
 {
     if (gpuResource->type == ResourceInGPU::Type::SlotOnAtlasTexture)
@@ -120,7 +148,19 @@ OsmAnd::GPUAPI::TextureInGPU::TextureInGPU(
     const unsigned int height_,
     const unsigned int mipmapLevels_,
     const AlphaChannelType alphaChannelType_)
-    : ResourceInGPU(Type::Texture, api_, refInGPU_)
+    : TextureInGPU(Type::Texture, api_, refInGPU_, width_, height_, mipmapLevels_, alphaChannelType_)
+{
+}
+
+OsmAnd::GPUAPI::TextureInGPU::TextureInGPU(
+    const Type type_,
+    GPUAPI* api_,
+    const RefInGPU& refInGPU_,
+    const unsigned int width_,
+    const unsigned int height_,
+    const unsigned int mipmapLevels_,
+    const AlphaChannelType alphaChannelType_)
+    : ResourceInGPU(type_, api_, refInGPU_)
     , width(width_)
     , height(height_)
     , mipmapLevels(mipmapLevels_)
@@ -313,6 +353,300 @@ std::shared_ptr<OsmAnd::GPUAPI::SlotOnAtlasTextureInGPU> OsmAnd::GPUAPI::AtlasTe
     }
 }
 
+OsmAnd::GPUAPI::PackedAtlasTexturesPool::PackedAtlasTexturesPool(
+    GPUAPI* api_,
+    const TextureFormat format_,
+    const unsigned int textureSize_,
+    const unsigned int padding_)
+    : api(api_)
+    , format(format_)
+    , textureSize(textureSize_)
+    , padding(padding_)
+{
+}
+
+OsmAnd::GPUAPI::PackedAtlasTexturesPool::~PackedAtlasTexturesPool()
+{
+}
+
+std::shared_ptr<OsmAnd::GPUAPI::RegionOnAtlasTextureInGPU> OsmAnd::GPUAPI::PackedAtlasTexturesPool::allocateRegion(
+    const unsigned int width,
+    const unsigned int height,
+    const AlphaChannelType alphaChannelType,
+    AtlasTextureAllocator atlasTextureAllocator)
+{
+    const auto paddedWidth = width + 2 * padding;
+    const auto paddedHeight = height + 2 * padding;
+    if (paddedWidth > textureSize || paddedHeight > textureSize)
+        return nullptr;
+
+    unsigned int x = 0;
+    unsigned int y = 0;
+    unsigned int shelfIndex = 0;
+    std::shared_ptr<PackedAtlasTextureInGPU> atlasTexture;
+    {
+        QMutexLocker scopedLocker(&_mutex);
+
+        // Look for space in existing atlas textures, older ones first so that newer ones have a chance to get empty
+        auto itAtlasTexture = mutableIteratorOf(_atlasTextures);
+        while (itAtlasTexture.hasNext())
+        {
+            const auto existingAtlasTexture = itAtlasTexture.next().lock();
+            if (!existingAtlasTexture)
+            {
+                itAtlasTexture.remove();
+                continue;
+            }
+
+            if (existingAtlasTexture->allocateNoLock(paddedWidth, paddedHeight, x, y, shelfIndex))
+            {
+                atlasTexture = existingAtlasTexture;
+                break;
+            }
+        }
+
+        // Otherwise allocate new atlas texture
+        if (!atlasTexture)
+        {
+            const auto newAtlasTexture = atlasTextureAllocator();
+            if (!newAtlasTexture)
+                return nullptr;
+            atlasTexture.reset(newAtlasTexture);
+            _atlasTextures.push_back(atlasTexture);
+
+            if (!atlasTexture->allocateNoLock(paddedWidth, paddedHeight, x, y, shelfIndex))
+            {
+                assert(false);
+                return nullptr;
+            }
+        }
+    }
+
+    return std::shared_ptr<RegionOnAtlasTextureInGPU>(new RegionOnAtlasTextureInGPU(
+        atlasTexture,
+        x + padding,
+        y + padding,
+        width,
+        height,
+        shelfIndex,
+        alphaChannelType));
+}
+
+OsmAnd::GPUAPI::PackedAtlasTextureInGPU::PackedAtlasTextureInGPU(
+    GPUAPI* api_,
+    const RefInGPU& refInGPU_,
+    const std::shared_ptr<PackedAtlasTexturesPool>& pool_)
+    : TextureInGPU(api_, refInGPU_, pool_->textureSize, pool_->textureSize, 1, AlphaChannelType::Invalid)
+    , _usedHeight(0)
+    , pool(pool_)
+{
+}
+
+OsmAnd::GPUAPI::PackedAtlasTextureInGPU::~PackedAtlasTextureInGPU()
+{
+}
+
+bool OsmAnd::GPUAPI::PackedAtlasTextureInGPU::findSpanOnShelf(
+    const Shelf& shelf,
+    const unsigned int width,
+    const unsigned int textureSize,
+    int& outFreeSpanIndex)
+{
+    // Prefer smallest released span that fits, to keep larger ones for larger regions
+    outFreeSpanIndex = -1;
+    for (auto freeSpanIndex = 0, freeSpansCount = shelf.freeSpans.size(); freeSpanIndex < freeSpansCount; freeSpanIndex++)
+    {
+        const auto& freeSpan = shelf.freeSpans[freeSpanIndex];
+        if (freeSpan.width < width)
+            continue;
+
+        if (outFreeSpanIndex < 0 || freeSpan.width < shelf.freeSpans[outFreeSpanIndex].width)
+            outFreeSpanIndex = freeSpanIndex;
+    }
+    if (outFreeSpanIndex >= 0)
+        return true;
+
+    // Otherwise take space at the end of shelf
+    return shelf.usedWidth + width <= textureSize;
+}
+
+bool OsmAnd::GPUAPI::PackedAtlasTextureInGPU::allocateNoLock(
+    const unsigned int width,
+    const unsigned int height,
+    unsigned int& outX,
+    unsigned int& outY,
+    unsigned int& outShelfIndex)
+{
+    const auto textureSize = pool->textureSize;
+
+    // Prefer shelf that is not much taller than requested height, to keep waste low
+    const auto maxShelfHeight = height + height / 4 + 2;
+    auto bestShelfIndex = -1;
+    auto bestFreeSpanIndex = -1;
+    auto anyShelfIndex = -1;
+    auto anyFreeSpanIndex = -1;
+    for (auto shelfIndex = 0, shelvesCount = _shelves.size(); shelfIndex < shelvesCount; shelfIndex++)
+    {
+        const auto& shelf = _shelves[shelfIndex];
+        int freeSpanIndex = -1;
+        if (shelf.height < height || !findSpanOnShelf(shelf, width, textureSize, freeSpanIndex))
+            continue;
+
+        if (shelf.height <= maxShelfHeight)
+        {
+            if (bestShelfIndex < 0 || shelf.height < _shelves[bestShelfIndex].height)
+            {
+                bestShelfIndex = shelfIndex;
+                bestFreeSpanIndex = freeSpanIndex;
+            }
+        }
+        else if (anyShelfIndex < 0 || shelf.height < _shelves[anyShelfIndex].height)
+        {
+            anyShelfIndex = shelfIndex;
+            anyFreeSpanIndex = freeSpanIndex;
+        }
+    }
+
+    // Start new shelf if there's space left for it
+    if (bestShelfIndex < 0 && _usedHeight + height <= textureSize)
+    {
+        Shelf shelf;
+        shelf.y = _usedHeight;
+        shelf.height = height;
+        shelf.usedWidth = 0;
+        shelf.regionsCount = 0;
+        _shelves.push_back(shelf);
+        _usedHeight += height;
+
+        bestShelfIndex = _shelves.size() - 1;
+    }
+
+    // As last resort, use shelf that is too tall
+    if (bestShelfIndex < 0)
+    {
+        bestShelfIndex = anyShelfIndex;
+        bestFreeSpanIndex = anyFreeSpanIndex;
+    }
+    if (bestShelfIndex < 0)
+        return false;
+
+    auto& shelf = _shelves[bestShelfIndex];
+    outY = shelf.y;
+    outShelfIndex = bestShelfIndex;
+    if (bestFreeSpanIndex >= 0)
+    {
+        auto& freeSpan = shelf.freeSpans[bestFreeSpanIndex];
+        outX = freeSpan.x;
+        freeSpan.x += width;
+        freeSpan.width -= width;
+        if (freeSpan.width == 0)
+            shelf.freeSpans.remove(bestFreeSpanIndex);
+    }
+    else
+    {
+        outX = shelf.usedWidth;
+        shelf.usedWidth += width;
+    }
+    shelf.regionsCount++;
+
+    return true;
+}
+
+void OsmAnd::GPUAPI::PackedAtlasTextureInGPU::releaseNoLock(
+    const unsigned int shelfIndex,
+    const unsigned int x,
+    const unsigned int width)
+{
+    auto& shelf = _shelves[shelfIndex];
+    assert(shelf.regionsCount > 0);
+    if (--shelf.regionsCount > 0)
+    {
+        auto insertIndex = 0;
+        while (insertIndex < shelf.freeSpans.size() && shelf.freeSpans[insertIndex].x < x)
+            insertIndex++;
+
+        // Released space becomes free span, merged with adjacent free spans
+        Span freeSpan;
+        freeSpan.x = x;
+        freeSpan.width = width;
+        if (insertIndex < shelf.freeSpans.size() && shelf.freeSpans[insertIndex].x == x + width)
+        {
+            freeSpan.width += shelf.freeSpans[insertIndex].width;
+            shelf.freeSpans.remove(insertIndex);
+        }
+        if (insertIndex > 0 && shelf.freeSpans[insertIndex - 1].x + shelf.freeSpans[insertIndex - 1].width == x)
+        {
+            insertIndex--;
+            freeSpan.x = shelf.freeSpans[insertIndex].x;
+            freeSpan.width += shelf.freeSpans[insertIndex].width;
+            shelf.freeSpans.remove(insertIndex);
+        }
+
+        // Free span at the end of shelf is given back to shelf itself
+        if (freeSpan.x + freeSpan.width == shelf.usedWidth)
+            shelf.usedWidth = freeSpan.x;
+        else
+            shelf.freeSpans.insert(insertIndex, freeSpan);
+
+        return;
+    }
+
+    // Empty shelf is reused from the start
+    shelf.usedWidth = 0;
+    shelf.freeSpans.clear();
+
+    // Empty shelves on top are released completely, so that their space could be taken by shelves of other height
+    while (!_shelves.isEmpty() && _shelves.last().regionsCount == 0)
+    {
+        _usedHeight = _shelves.last().y;
+        _shelves.removeLast();
+    }
+}
+
+OsmAnd::GPUAPI::RegionOnAtlasTextureInGPU::RegionOnAtlasTextureInGPU(
+    const std::shared_ptr<PackedAtlasTextureInGPU>& atlas_,
+    const unsigned int x_,
+    const unsigned int y_,
+    const unsigned int width_,
+    const unsigned int height_,
+    const unsigned int shelfIndex_,
+    const AlphaChannelType alphaChannelType_)
+    : TextureInGPU(Type::RegionOnAtlasTexture, atlas_->api, atlas_->refInGPU, width_, height_, 1, alphaChannelType_)
+    , atlasTexture(atlas_)
+    , x(x_)
+    , y(y_)
+    , shelfIndex(shelfIndex_)
+    , texCoordsOffsetN(
+        static_cast<float>(x_) / static_cast<float>(atlas_->width),
+        static_cast<float>(y_) / static_cast<float>(atlas_->height))
+    , texCoordsScaleN(
+        static_cast<float>(width_) / static_cast<float>(atlas_->width),
+        static_cast<float>(height_) / static_cast<float>(atlas_->height))
+{
+}
+
+OsmAnd::GPUAPI::RegionOnAtlasTextureInGPU::~RegionOnAtlasTextureInGPU()
+{
+    // Return occupied space to atlas texture
+    {
+        QMutexLocker scopedLocker(&atlasTexture->pool->_mutex);
+
+        const auto padding = atlasTexture->pool->padding;
+        atlasTexture->releaseNoLock(shelfIndex, x - padding, width + 2 * padding);
+    }
+
+    // Clear reference to GPU resource to avoid removal in base class
+    _refInGPU = nullptr;
+}
+
+void OsmAnd::GPUAPI::RegionOnAtlasTextureInGPU::lostRefInGPU() const
+{
+    // Atlas texture is gone together with all its regions
+    atlasTexture->lostRefInGPU();
+
+    TextureInGPU::lostRefInGPU();
+}
+
 OsmAnd::GPUAPI::MeshInGPU::MeshInGPU(
     GPUAPI* api_,
     const std::shared_ptr<ArrayBufferInGPU>& vertexBuffer_,
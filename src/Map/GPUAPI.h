@@ -11,10 +11,13 @@
 #include <QMutex>
 #include <QSet>
 #include <QAtomicInt>
+#include <QList>
+#include <QVector>
 
 #include "OsmAndCore.h"
 #include "Common.h"
 #include "CommonTypes.h"
+#include "PointsAndAreas.h"
 #include "MapCommonTypes.h"
 #include "IMapTiledDataProvider.h"
 
@@ -48,6 +51,7 @@ namespace OsmAnd
             {
                 Texture,
                 SlotOnAtlasTexture,
+                RegionOnAtlasTexture,
                 ArrayBuffer,
                 ElementArrayBuffer,
                 Mesh
@@ -82,6 +86,14 @@ namespace OsmAnd
             Q_DISABLE_COPY_AND_MOVE(TextureInGPU);
         private:
         protected:
+            TextureInGPU(
+                const Type type,
+                GPUAPI* api,
+                const RefInGPU& refInGPU,
+                const unsigned int width,
+                const unsigned int height,
+                const unsigned int mipmapLevels,
+                const AlphaChannelType alphaChannelType);
         public:
             TextureInGPU(
                 GPUAPI* api,
@@ -248,6 +260,119 @@ namespace OsmAnd
             const AlphaChannelType alphaChannelType;
         };
 
+        // Atlas texture that holds textures of different sizes. They are packed into shelves: rows of fixed height,
+        // filled from left to right. Space of released region becomes free span of its shelf, that is reused by
+        // later regions, and atlas texture itself is released as soon as it has no regions.
+        class RegionOnAtlasTextureInGPU;
+        class PackedAtlasTextureInGPU;
+        class PackedAtlasTexturesPool
+        {
+            Q_DISABLE_COPY_AND_MOVE(PackedAtlasTexturesPool);
+        public:
+            typedef std::function< PackedAtlasTextureInGPU*() > AtlasTextureAllocator;
+        private:
+            mutable QMutex _mutex;
+            QList< std::weak_ptr<PackedAtlasTextureInGPU> > _atlasTextures;
+        protected:
+            PackedAtlasTexturesPool(
+                GPUAPI* api,
+                const TextureFormat format,
+                const unsigned int textureSize,
+                const unsigned int padding);
+
+            std::shared_ptr<RegionOnAtlasTextureInGPU> allocateRegion(
+                const unsigned int width,
+                const unsigned int height,
+                const AlphaChannelType alphaChannelType,
+                AtlasTextureAllocator atlasTextureAllocator);
+        public:
+            virtual ~PackedAtlasTexturesPool();
+
+            GPUAPI* const api;
+            const TextureFormat format;
+            const unsigned int textureSize;
+            const unsigned int padding;
+
+        friend OsmAnd::GPUAPI;
+        friend OsmAnd::GPUAPI::RegionOnAtlasTextureInGPU;
+        };
+
+        class PackedAtlasTextureInGPU : public TextureInGPU
+        {
+            Q_DISABLE_COPY_AND_MOVE(PackedAtlasTextureInGPU);
+        private:
+            // Guarded by pool mutex
+            struct Span
+            {
+                unsigned int x;
+                unsigned int width;
+            };
+            struct Shelf
+            {
+                unsigned int y;
+                unsigned int height;
+                unsigned int usedWidth;
+                unsigned int regionsCount;
+                // Released spans below usedWidth, sorted by x and never adjacent to each other
+                QVector<Span> freeSpans;
+            };
+            QVector<Shelf> _shelves;
+            unsigned int _usedHeight;
+
+            static bool findSpanOnShelf(
+                const Shelf& shelf,
+                const unsigned int width,
+                const unsigned int textureSize,
+                int& outFreeSpanIndex);
+            bool allocateNoLock(
+                const unsigned int width,
+                const unsigned int height,
+                unsigned int& outX,
+                unsigned int& outY,
+                unsigned int& outShelfIndex);
+            void releaseNoLock(const unsigned int shelfIndex, const unsigned int x, const unsigned int width);
+        protected:
+        public:
+            PackedAtlasTextureInGPU(
+                GPUAPI* api,
+                const RefInGPU& refInGPU,
+                const std::shared_ptr<PackedAtlasTexturesPool>& pool);
+            virtual ~PackedAtlasTextureInGPU();
+
+            const std::shared_ptr<PackedAtlasTexturesPool> pool;
+
+        friend OsmAnd::GPUAPI::PackedAtlasTexturesPool;
+        friend OsmAnd::GPUAPI::RegionOnAtlasTextureInGPU;
+        };
+
+        // Texture that occupies region of packed atlas texture. Width and height are of region itself, and texture
+        // coordinates [0 .. 1] have to be mapped to atlas texture using offset and scale
+        class RegionOnAtlasTextureInGPU : public TextureInGPU
+        {
+            Q_DISABLE_COPY_AND_MOVE(RegionOnAtlasTextureInGPU);
+        private:
+        protected:
+        public:
+            RegionOnAtlasTextureInGPU(
+                const std::shared_ptr<PackedAtlasTextureInGPU>& atlas,
+                const unsigned int x,
+                const unsigned int y,
+                const unsigned int width,
+                const unsigned int height,
+                const unsigned int shelfIndex,
+                const AlphaChannelType alphaChannelType);
+            virtual ~RegionOnAtlasTextureInGPU();
+
+            const std::shared_ptr<PackedAtlasTextureInGPU> atlasTexture;
+            const unsigned int x;
+            const unsigned int y;
+            const unsigned int shelfIndex;
+            const PointF texCoordsOffsetN;
+            const PointF texCoordsScaleN;
+
+            virtual void lostRefInGPU() const;
+        };
+
         class MeshInGPU : public MetaResourceInGPU
         {
             Q_DISABLE_COPY_AND_MOVE(MeshInGPU);
@@ -276,6 +401,7 @@ namespace OsmAnd
 #endif
 
         QHash< AtlasTypeId, std::shared_ptr<AtlasTexturesPool> > _atlasTexturesPools;
+        QHash< TextureFormat, std::shared_ptr<PackedAtlasTexturesPool> > _packedAtlasTexturesPools;
     protected:
         GPUAPI();
 
@@ -285,13 +411,26 @@ namespace OsmAnd
             const std::shared_ptr<AtlasTexturesPool>& pool,
             AtlasTexturesPool::AtlasTextureAllocator atlasTextureAllocator);
 
+        std::shared_ptr<PackedAtlasTexturesPool> obtainPackedAtlasTexturesPool(
+            const TextureFormat format,
+            const unsigned int textureSize,
+            const unsigned int padding);
+        std::shared_ptr<RegionOnAtlasTextureInGPU> allocateRegionInAtlasTexture(
+            const unsigned int width,
+            const unsigned int height,
+            const AlphaChannelType alphaChannelType,
+            const std::shared_ptr<PackedAtlasTexturesPool>& pool,
+            PackedAtlasTexturesPool::AtlasTextureAllocator atlasTextureAllocator);
+
         virtual bool releaseResourceInGPU(const ResourceInGPU::Type type, const RefInGPU& refInGPU) = 0;
 
         bool _isSupported_8bitPaletteRGBA8;
+        bool _isSupported_unpackRowLength;
     public:
         virtual ~GPUAPI();
 
         const bool& isSupported_8bitPaletteRGBA8;
+        const bool& isSupported_unpackRowLength;
 
         virtual bool initialize() = 0;
         virtual bool release(const bool gpuContextLost) = 0;
@@ -0,0 +1,98 @@
+#include "HeightmapPyramid.h"
+#include "HeightmapPyramid_P.h"
+
+const char OsmAnd::HeightmapPyramid::Magic[4] = { 'O', 'A', 'H', 'P' };
+
+OsmAnd::HeightmapPyramid::HeightmapPyramid(const QString& filePath_)
+    : _p(new HeightmapPyramid_P(this))
+    , filePath(filePath_)
+{
+    _p->open();
+}
+
+OsmAnd::HeightmapPyramid::~HeightmapPyramid()
+{
+}
+
+bool OsmAnd::HeightmapPyramid::isOpened() const
+{
+    return _p->isOpened();
+}
+
+uint32_t OsmAnd::HeightmapPyramid::getTileSize() const
+{
+    return _p->getTileSize();
+}
+
+OsmAnd::HeightmapPyramid::SampleType OsmAnd::HeightmapPyramid::getSampleType() const
+{
+    return _p->getSampleType();
+}
+
+OsmAnd::ZoomLevel OsmAnd::HeightmapPyramid::getMinZoom() const
+{
+    return _p->getMinZoom();
+}
+
+OsmAnd::ZoomLevel OsmAnd::HeightmapPyramid::getMaxZoom() const
+{
+    return _p->getMaxZoom();
+}
+
+unsigned int OsmAnd::HeightmapPyramid::getTilesCount() const
+{
+    return _p->getTilesCount();
+}
+
+const void* OsmAnd::HeightmapPyramid::getTileData(const TileId tileId, const ZoomLevel zoom) const
+{
+    return _p->getTileData(tileId, zoom);
+}
+
+const float* OsmAnd::HeightmapPyramid::getFloatTileData(const TileId tileId, const ZoomLevel zoom) const
+{
+    if (_p->getSampleType() != SampleType::Float32)
+        return nullptr;
+    return reinterpret_cast<const float*>(_p->getTileData(tileId, zoom));
+}
+
+bool OsmAnd::HeightmapPyramid::obtainTile(const TileId tileId, const ZoomLevel zoom, float* const outHeights) const
+{
+    return _p->obtainTile(tileId, zoom, outHeights);
+}
+
+OsmAnd::HeightmapPyramidBuilder::HeightmapPyramidBuilder(
+    const QString& filePath_,
+    const uint32_t tileSize_,
+    const HeightmapPyramid::SampleType sampleType_ /*= HeightmapPyramid::SampleType::Float32*/)
+    : _p(new HeightmapPyramidBuilder_P(this))
+    , filePath(filePath_)
+    , tileSize(tileSize_)
+    , sampleType(sampleType_)
+{
+    _p->open();
+}
+
+OsmAnd::HeightmapPyramidBuilder::~HeightmapPyramidBuilder()
+{
+}
+
+bool OsmAnd::HeightmapPyramidBuilder::isOpened() const
+{
+    return _p->isOpened();
+}
+
+unsigned int OsmAnd::HeightmapPyramidBuilder::getTilesCount() const
+{
+    return _p->getTilesCount();
+}
+
+bool OsmAnd::HeightmapPyramidBuilder::addTile(const TileId tileId, const ZoomLevel zoom, const float* const heights)
+{
+    return _p->addTile(tileId, zoom, heights);
+}
+
+bool OsmAnd::HeightmapPyramidBuilder::finish()
+{
+    return _p->finish();
+}
@@ -0,0 +1,295 @@
+#include "HeightmapPyramid_P.h"
+#include "HeightmapPyramid.h"
+
+#include "stdlib_common.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "Logging.h"
+
+using namespace OsmAnd::HeightmapPyramidFormat;
+
+OsmAnd::HeightmapPyramid_P::HeightmapPyramid_P(HeightmapPyramid* const owner_)
+    : _data(nullptr)
+    , _size(0)
+    , _header(nullptr)
+    , _table(nullptr)
+    , _tileDataSize(0)
+    , owner(owner_)
+{
+}
+
+OsmAnd::HeightmapPyramid_P::~HeightmapPyramid_P()
+{
+    if (_data)
+        _file.unmap(const_cast<uchar*>(_data));
+}
+
+bool OsmAnd::HeightmapPyramid_P::open()
+{
+    _file.setFileName(owner->filePath);
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to open heightmap pyramid '%s'",
+            qPrintable(owner->filePath));
+        return false;
+    }
+
+    _size = _file.size();
+    if (_size < static_cast<qint64>(sizeof(FileHeader)))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Heightmap pyramid '%s' is truncated",
+            qPrintable(owner->filePath));
+        return false;
+    }
+    _data = _file.map(0, _size);
+    if (!_data)
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to map heightmap pyramid '%s'",
+            qPrintable(owner->filePath));
+        return false;
+    }
+
+    const auto header = reinterpret_cast<const FileHeader*>(_data);
+    if (std::memcmp(header->magic, HeightmapPyramid::Magic, sizeof(HeightmapPyramid::Magic)) != 0 ||
+        header->version != HeightmapPyramid::Version)
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "'%s' is not a heightmap pyramid of version %d",
+            qPrintable(owner->filePath),
+            HeightmapPyramid::Version);
+        return false;
+    }
+
+    const auto sampleType = static_cast<HeightmapPyramid::SampleType>(header->sampleType);
+    const auto tableSize = static_cast<uint64_t>(header->tilesCount) * sizeof(TableEntry);
+    if (header->tileSize == 0 ||
+        (sampleType != HeightmapPyramid::SampleType::Int16 && sampleType != HeightmapPyramid::SampleType::Float32) ||
+        header->tableOffset % alignof(TableEntry) != 0 ||
+        header->tableOffset + tableSize > static_cast<uint64_t>(_size))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Heightmap pyramid '%s' is corrupted",
+            qPrintable(owner->filePath));
+        return false;
+    }
+
+    _header = header;
+    _table = reinterpret_cast<const TableEntry*>(_data + header->tableOffset);
+    _tileDataSize = getTileDataSize(header->tileSize, sampleType);
+    return true;
+}
+
+bool OsmAnd::HeightmapPyramid_P::isOpened() const
+{
+    return _header != nullptr;
+}
+
+uint32_t OsmAnd::HeightmapPyramid_P::getTileSize() const
+{
+    return _header ? _header->tileSize : 0;
+}
+
+OsmAnd::HeightmapPyramid::SampleType OsmAnd::HeightmapPyramid_P::getSampleType() const
+{
+    return _header ? static_cast<HeightmapPyramid::SampleType>(_header->sampleType) : HeightmapPyramid::SampleType::Float32;
+}
+
+OsmAnd::ZoomLevel OsmAnd::HeightmapPyramid_P::getMinZoom() const
+{
+    if (!_header || _header->tilesCount == 0)
+        return MinZoomLevel;
+    return static_cast<ZoomLevel>(_table[0].zoom);
+}
+
+OsmAnd::ZoomLevel OsmAnd::HeightmapPyramid_P::getMaxZoom() const
+{
+    if (!_header || _header->tilesCount == 0)
+        return MaxZoomLevel;
+    return static_cast<ZoomLevel>(_table[_header->tilesCount - 1].zoom);
+}
+
+unsigned int OsmAnd::HeightmapPyramid_P::getTilesCount() const
+{
+    return _header ? _header->tilesCount : 0;
+}
+
+const void* OsmAnd::HeightmapPyramid_P::getTileData(const TileId tileId, const ZoomLevel zoom) const
+{
+    if (!_header)
+        return nullptr;
+
+    TableEntry key;
+    key.zoom = zoom;
+    key.x = tileId.x;
+    key.y = tileId.y;
+
+    const auto pTableEnd = _table + _header->tilesCount;
+    const auto pEntry = std::lower_bound(_table, pTableEnd, key, &isLess);
+    if (pEntry == pTableEnd || isLess(key, *pEntry))
+        return nullptr;
+    if (pEntry->dataOffset + _tileDataSize > static_cast<uint64_t>(_size))
+        return nullptr;
+
+    return _data + pEntry->dataOffset;
+}
+
+bool OsmAnd::HeightmapPyramid_P::obtainTile(const TileId tileId, const ZoomLevel zoom, float* const outHeights) const
+{
+    const auto tileData = getTileData(tileId, zoom);
+    if (!tileData)
+        return false;
+
+    const auto samplesCount = _header->tileSize * _header->tileSize;
+    if (getSampleType() == HeightmapPyramid::SampleType::Float32)
+    {
+        std::memcpy(outHeights, tileData, samplesCount * sizeof(float));
+        return true;
+    }
+
+    const auto pSamples = reinterpret_cast<const int16_t*>(tileData);
+    for (auto sampleIdx = 0u; sampleIdx < samplesCount; sampleIdx++)
+        outHeights[sampleIdx] = static_cast<float>(pSamples[sampleIdx]);
+    return true;
+}
+
+OsmAnd::HeightmapPyramidBuilder_P::HeightmapPyramidBuilder_P(HeightmapPyramidBuilder* const owner_)
+    : _isFinished(false)
+    , owner(owner_)
+{
+}
+
+OsmAnd::HeightmapPyramidBuilder_P::~HeightmapPyramidBuilder_P()
+{
+}
+
+bool OsmAnd::HeightmapPyramidBuilder_P::open()
+{
+    if (owner->tileSize == 0)
+        return false;
+
+    _file.setFileName(owner->filePath);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to open heightmap pyramid '%s' for writing",
+            qPrintable(owner->filePath));
+        return false;
+    }
+
+    // Header is written when pyramid is finished, so unfinished file is never taken for valid one
+    FileHeader header;
+    std::memset(&header, 0, sizeof(FileHeader));
+    if (_file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader)) != sizeof(FileHeader))
+    {
+        _file.close();
+        return false;
+    }
+
+    const auto tileDataSize = getTileDataSize(owner->tileSize, owner->sampleType);
+    _tileBuffer.fill(0, static_cast<int>((tileDataSize + TileAlignment - 1) / TileAlignment * TileAlignment));
+
+    return true;
+}
+
+bool OsmAnd::HeightmapPyramidBuilder_P::isOpened() const
+{
+    return _file.isOpen();
+}
+
+unsigned int OsmAnd::HeightmapPyramidBuilder_P::getTilesCount() const
+{
+    return static_cast<unsigned int>(_table.size());
+}
+
+bool OsmAnd::HeightmapPyramidBuilder_P::addTile(const TileId tileId, const ZoomLevel zoom, const float* const heights)
+{
+    if (!_file.isOpen() || _isFinished)
+        return false;
+
+    const auto samplesCount = owner->tileSize * owner->tileSize;
+    if (owner->sampleType == HeightmapPyramid::SampleType::Float32)
+    {
+        std::memcpy(_tileBuffer.data(), heights, samplesCount * sizeof(float));
+    }
+    else
+    {
+        const auto pSamples = reinterpret_cast<int16_t*>(_tileBuffer.data());
+        for (auto sampleIdx = 0u; sampleIdx < samplesCount; sampleIdx++)
+        {
+            pSamples[sampleIdx] = static_cast<int16_t>(qBound(
+                static_cast<float>(std::numeric_limits<int16_t>::min()),
+                std::round(heights[sampleIdx]),
+                static_cast<float>(std::numeric_limits<int16_t>::max())));
+        }
+    }
+
+    TableEntry entry;
+    entry.zoom = zoom;
+    entry.x = tileId.x;
+    entry.y = tileId.y;
+    entry.reserved = 0;
+    entry.dataOffset = static_cast<uint64_t>(_file.pos());
+    if (_file.write(_tileBuffer) != _tileBuffer.size())
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to write tile %dx%d@%d to heightmap pyramid '%s'",
+            tileId.x,
+            tileId.y,
+            zoom,
+            qPrintable(owner->filePath));
+        return false;
+    }
+    _table.push_back(entry);
+
+    return true;
+}
+
+bool OsmAnd::HeightmapPyramidBuilder_P::finish()
+{
+    if (!_file.isOpen() || _isFinished)
+        return false;
+    _isFinished = true;
+
+    // Tile that was added several times is taken from the last addition
+    std::stable_sort(_table.begin(), _table.end(), &isLess);
+    auto itUniqueEnd = _table.begin();
+    for (auto itEntry = _table.begin(); itEntry != _table.end(); ++itEntry)
+    {
+        const auto itNextEntry = itEntry + 1;
+        if (itNextEntry != _table.end() && !isLess(*itEntry, *itNextEntry))
+            continue;
+        *itUniqueEnd++ = *itEntry;
+    }
+    _table.erase(itUniqueEnd, _table.end());
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(FileHeader));
+    std::memcpy(header.magic, HeightmapPyramid::Magic, sizeof(header.magic));
+    header.version = HeightmapPyramid::Version;
+    header.tileSize = owner->tileSize;
+    header.sampleType = static_cast<uint32_t>(owner->sampleType);
+    header.tilesCount = static_cast<uint32_t>(_table.size());
+    header.tableOffset = static_cast<uint64_t>(_file.pos());
+
+    const auto tableSize = static_cast<qint64>(_table.size() * sizeof(TableEntry));
+    bool ok = true;
+    ok = ok && _file.write(reinterpret_cast<const char*>(_table.data()), tableSize) == tableSize;
+    ok = ok && _file.seek(0);
+    ok = ok && _file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader)) == sizeof(FileHeader);
+    ok = ok && _file.flush();
+    _file.close();
+
+    if (!ok)
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to finish heightmap pyramid '%s'",
+            qPrintable(owner->filePath));
+    }
+    return ok;
+}
@@ -0,0 +1,126 @@
+#ifndef _OSMAND_CORE_HEIGHTMAP_PYRAMID_P_H_
+#define _OSMAND_CORE_HEIGHTMAP_PYRAMID_P_H_
+
+#include "stdlib_common.h"
+#include <vector>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QFile>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+#include "PrivateImplementation.h"
+#include "HeightmapPyramid.h"
+
+namespace OsmAnd
+{
+    namespace HeightmapPyramidFormat
+    {
+        // Layout of pyramid file:
+        //  - FileHeader;
+        //  - tiles, each tileSize*tileSize samples padded to TileAlignment;
+        //  - FileHeader::tilesCount TableEntries sorted by zoom, x and y, starting at FileHeader::tableOffset.
+        struct FileHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t tileSize;
+            uint32_t sampleType;
+            uint32_t tilesCount;
+            uint32_t reserved;
+            uint64_t tableOffset;
+        };
+        struct TableEntry
+        {
+            uint32_t zoom;
+            int32_t x;
+            int32_t y;
+            uint32_t reserved;
+            uint64_t dataOffset;
+        };
+
+        enum
+        {
+            TileAlignment = 16,
+        };
+
+        inline bool isLess(const TableEntry& l, const TableEntry& r)
+        {
+            if (l.zoom != r.zoom)
+                return l.zoom < r.zoom;
+            if (l.x != r.x)
+                return l.x < r.x;
+            return l.y < r.y;
+        }
+
+        inline uint64_t getTileDataSize(const uint32_t tileSize, const HeightmapPyramid::SampleType sampleType)
+        {
+            const uint64_t sampleSize = (sampleType == HeightmapPyramid::SampleType::Int16)
+                ? sizeof(int16_t)
+                : sizeof(float);
+            return static_cast<uint64_t>(tileSize) * tileSize * sampleSize;
+        }
+    }
+
+    class HeightmapPyramid_P Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(HeightmapPyramid_P);
+    private:
+        QFile _file;
+        const uchar* _data;
+        qint64 _size;
+        const HeightmapPyramidFormat::FileHeader* _header;
+        const HeightmapPyramidFormat::TableEntry* _table;
+        uint64_t _tileDataSize;
+    protected:
+        HeightmapPyramid_P(HeightmapPyramid* const owner);
+
+        bool open();
+    public:
+        ~HeightmapPyramid_P();
+
+        ImplementationInterface<HeightmapPyramid> owner;
+
+        bool isOpened() const;
+        uint32_t getTileSize() const;
+        HeightmapPyramid::SampleType getSampleType() const;
+        ZoomLevel getMinZoom() const;
+        ZoomLevel getMaxZoom() const;
+        unsigned int getTilesCount() const;
+
+        const void* getTileData(const TileId tileId, const ZoomLevel zoom) const;
+        bool obtainTile(const TileId tileId, const ZoomLevel zoom, float* const outHeights) const;
+
+    friend class OsmAnd::HeightmapPyramid;
+    };
+
+    class HeightmapPyramidBuilder_P Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(HeightmapPyramidBuilder_P);
+    private:
+        QFile _file;
+        bool _isFinished;
+        std::vector<HeightmapPyramidFormat::TableEntry> _table;
+        QByteArray _tileBuffer;
+    protected:
+        HeightmapPyramidBuilder_P(HeightmapPyramidBuilder* const owner);
+
+        bool open();
+    public:
+        ~HeightmapPyramidBuilder_P();
+
+        ImplementationInterface<HeightmapPyramidBuilder> owner;
+
+        bool isOpened() const;
+        unsigned int getTilesCount() const;
+
+        bool addTile(const TileId tileId, const ZoomLevel zoom, const float* const heights);
+        bool finish();
+
+    friend class OsmAnd::HeightmapPyramidBuilder;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_HEIGHTMAP_PYRAMID_P_H_)
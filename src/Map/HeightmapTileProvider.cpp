@@ -10,6 +10,12 @@ OsmAnd::HeightmapTileProvider::HeightmapTileProvider(const QString& dataPath_, c
 {
 }
 
+OsmAnd::HeightmapTileProvider::HeightmapTileProvider(const std::shared_ptr<const HeightmapPyramid>& pyramid_)
+    : _p(new HeightmapTileProvider_P(this, pyramid_))
+    , pyramid(pyramid_)
+{
+}
+
 OsmAnd::HeightmapTileProvider::~HeightmapTileProvider()
 {
 }
@@ -19,6 +25,14 @@ void OsmAnd::HeightmapTileProvider::rebuildTileDbIndex()
     _p->rebuildTileDbIndex();
 }
 
+bool OsmAnd::HeightmapTileProvider::convertToHeightmapPyramid(
+    const QString& outputFilePath,
+    const HeightmapPyramid::SampleType sampleType /*= HeightmapPyramid::SampleType::Float32*/,
+    unsigned int* const pOutTilesCount /*= nullptr*/)
+{
+    return _p->convertToHeightmapPyramid(outputFilePath, sampleType, pOutTilesCount);
+}
+
 OsmAnd::ZoomLevel OsmAnd::HeightmapTileProvider::getMinZoom() const
 {
     return _p->getMinZoom();
@@ -10,14 +10,23 @@
 #include "restore_internal_warnings.h"
 
 #include "Logging.h"
+#include "Stopwatch.h"
 #include "MapDataProviderHelpers.h"
 
 OsmAnd::HeightmapTileProvider_P::HeightmapTileProvider_P(
     HeightmapTileProvider* const owner_,
     const QString& dataPath,
     const QString& indexFilename)
-    : owner(owner_)
-    , _tileDb(dataPath, indexFilename)
+    : _tileDb(new TileDB(dataPath, indexFilename))
+    , owner(owner_)
+{
+}
+
+OsmAnd::HeightmapTileProvider_P::HeightmapTileProvider_P(
+    HeightmapTileProvider* const owner_,
+    const std::shared_ptr<const HeightmapPyramid>& pyramid_)
+    : _pyramid(pyramid_)
+    , owner(owner_)
 {
 }
 
@@ -27,21 +36,78 @@ OsmAnd::HeightmapTileProvider_P::~HeightmapTileProvider_P()
 
 void OsmAnd::HeightmapTileProvider_P::rebuildTileDbIndex()
 {
-    _tileDb.rebuildIndex();
+    if (_tileDb)
+        _tileDb->rebuildIndex();
+}
+
+bool OsmAnd::HeightmapTileProvider_P::convertToHeightmapPyramid(
+    const QString& outputFilePath,
+    const HeightmapPyramid::SampleType sampleType,
+    unsigned int* const pOutTilesCount)
+{
+    if (pOutTilesCount)
+        *pOutTilesCount = 0;
+    if (!_tileDb)
+        return false;
+
+    const Stopwatch stopwatch(true);
+
+    const auto tileSize = getTileSize();
+    HeightmapPyramidBuilder builder(outputFilePath, tileSize, sampleType);
+    if (!builder.isOpened())
+        return false;
+
+    bool success = true;
+    const auto enumerated = _tileDb->enumerateTiles(
+        [&builder, &success, tileSize]
+        (const TileId tileId, const ZoomLevel zoom, const QByteArray& data) -> bool
+        {
+            if (data.isEmpty())
+                return true;
+
+            // Tiles that can not be decoded are skipped, same as they're not served by TileDB path
+            const auto heights = decodeTileData(data, tileId, zoom, tileSize);
+            if (!heights)
+                return true;
+
+            success = builder.addTile(tileId, zoom, heights);
+            delete[] heights;
+
+            return success;
+        });
+    success = enumerated && success && builder.finish();
+
+    if (pOutTilesCount)
+        *pOutTilesCount = builder.getTilesCount();
+
+    LogPrintf(success ? LogSeverityLevel::Info : LogSeverityLevel::Error,
+        "%s %d heightmap tiles into '%s' in %fs",
+        success ? "Converted" : "Failed to convert",
+        builder.getTilesCount(),
+        qPrintable(outputFilePath),
+        stopwatch.elapsed());
+
+    return success;
 }
 
 OsmAnd::ZoomLevel OsmAnd::HeightmapTileProvider_P::getMinZoom() const
 {
+    if (_pyramid)
+        return _pyramid->getMinZoom();
     return MinZoomLevel;
 }
 
 OsmAnd::ZoomLevel OsmAnd::HeightmapTileProvider_P::getMaxZoom() const
 {
+    if (_pyramid)
+        return _pyramid->getMaxZoom();
     return MaxZoomLevel;
 }
 
 uint32_t OsmAnd::HeightmapTileProvider_P::getTileSize() const
 {
+    if (_pyramid && _pyramid->isOpened())
+        return _pyramid->getTileSize();
     return 32;
 }
 
@@ -55,9 +121,12 @@ bool OsmAnd::HeightmapTileProvider_P::obtainData(
     if (pOutMetric)
         pOutMetric->reset();
 
+    if (_pyramid)
+        return obtainPyramidData(request.tileId, request.zoom, outData);
+
     // Obtain raw data from DB
     QByteArray data;
-    bool ok = _tileDb.obtainTileData(request.tileId, request.zoom, data);
+    bool ok = _tileDb->obtainTileData(request.tileId, request.zoom, data);
     if (!ok || data.length() == 0)
     {
         // There was no data at all, to avoid further requests, mark this tile as empty
@@ -67,10 +136,75 @@ bool OsmAnd::HeightmapTileProvider_P::obtainData(
 
     // We have the data, use GDAL to decode this GeoTIFF
     const auto tileSize = getTileSize();
-    bool success = false;
+    const auto buffer = decodeTileData(data, request.tileId, request.zoom, tileSize);
+    if (!buffer)
+        return false;
+
+    outData.reset(new IMapElevationDataProvider::Data(
+        request.tileId,
+        request.zoom,
+        sizeof(float)*tileSize,
+        tileSize,
+        buffer));
+    return true;
+}
+
+bool OsmAnd::HeightmapTileProvider_P::obtainPyramidData(
+    const TileId tileId,
+    const ZoomLevel zoom,
+    std::shared_ptr<IMapDataProvider::Data>& outData)
+{
+    if (!_pyramid->isOpened())
+        return false;
+
+    const auto tileSize = _pyramid->getTileSize();
+
+    // Float tiles are served right from mapped file, while mapping is kept alive by data itself
+    if (const auto pHeights = _pyramid->getFloatTileData(tileId, zoom))
+    {
+        outData.reset(new IMapElevationDataProvider::Data(
+            tileId,
+            zoom,
+            sizeof(float)*tileSize,
+            tileSize,
+            pHeights,
+            _pyramid));
+        return true;
+    }
+
+    const auto buffer = new float[tileSize*tileSize];
+    if (!_pyramid->obtainTile(tileId, zoom, buffer))
+    {
+        delete[] buffer;
+
+        // There's no such tile, mark this tile as empty
+        outData.reset();
+        return true;
+    }
+
+    outData.reset(new IMapElevationDataProvider::Data(
+        tileId,
+        zoom,
+        sizeof(float)*tileSize,
+        tileSize,
+        buffer));
+    return true;
+}
+
+float* OsmAnd::HeightmapTileProvider_P::decodeTileData(
+    const QByteArray& data,
+    const TileId tileId,
+    const ZoomLevel zoom,
+    const uint32_t tileSize)
+{
+    // GDAL only reads from memory buffer that is opened read-only, so const data is passed as is: taking
+    // non-const pointer would detach (deep copy) data on every decode
+    const auto pData = reinterpret_cast<GByte*>(const_cast<char*>(data.constData()));
+
+    float* result = nullptr;
     QString vmemFilename;
-    vmemFilename.sprintf("/vsimem/heightmapTile@%p", data.data());
-    VSIFileFromMemBuffer(qPrintable(vmemFilename), reinterpret_cast<GByte*>(data.data()), data.length(), FALSE);
+    vmemFilename.sprintf("/vsimem/heightmapTile@%p", pData);
+    VSIFileFromMemBuffer(qPrintable(vmemFilename), pData, data.length(), FALSE);
     auto dataset = reinterpret_cast<GDALDataset*>(GDALOpen(qPrintable(vmemFilename), GA_ReadOnly));
     if (dataset != nullptr)
     {
@@ -84,18 +218,18 @@ bool OsmAnd::HeightmapTileProvider_P::obtainData(
             {
                 LogPrintf(LogSeverityLevel::Error,
                     "Height tile %dx%d@%d has %d bands instead of 1",
-                    request.tileId.x,
-                    request.tileId.y,
-                    request.zoom,
+                    tileId.x,
+                    tileId.y,
+                    zoom,
                     dataset->GetRasterCount());
             }
             if (dataset->GetRasterXSize() != tileSize || dataset->GetRasterYSize() != tileSize)
             {
                 LogPrintf(LogSeverityLevel::Error,
                     "Height tile %dx%d@%d has %dx%x size instead of %d",
-                    request.tileId.x,
-                    request.tileId.y,
-                    request.zoom,
+                    tileId.x,
+                    tileId.y,
+                    zoom,
                     dataset->GetRasterXSize(),
                     dataset->GetRasterYSize(),
                     tileSize);
@@ -114,17 +248,17 @@ bool OsmAnd::HeightmapTileProvider_P::obtainData(
                 {
                     LogPrintf(LogSeverityLevel::Error,
                         "Height tile %dx%d@%d has color table",
-                        request.tileId.x,
-                        request.tileId.y,
-                        request.zoom);
+                        tileId.x,
+                        tileId.y,
+                        zoom);
                 }
                 if (band->GetRasterDataType() != GDT_Int16)
                 {
                     LogPrintf(LogSeverityLevel::Error,
                         "Height tile %dx%d@%d has %s data type in band 1",
-                        request.tileId.x,
-                        request.tileId.y,
-                        request.zoom,
+                        tileId.x,
+                        tileId.y,
+                        zoom,
                         GDALGetDataTypeName(band->GetRasterDataType()));
                 }
             }
@@ -151,20 +285,14 @@ bool OsmAnd::HeightmapTileProvider_P::obtainData(
                     delete[] buffer;
                     LogPrintf(LogSeverityLevel::Error,
                         "Failed to decode height tile %dx%d@%d: %s",
-                        request.tileId.x,
-                        request.tileId.y,
-                        request.zoom,
+                        tileId.x,
+                        tileId.y,
+                        zoom,
                         CPLGetLastErrorMsg());
                 }
                 else
                 {
-                    outData.reset(new IMapElevationDataProvider::Data(
-                        request.tileId,
-                        request.zoom,
-                        tileSize,
-                        sizeof(float)*tileSize,
-                        buffer));
-                    success = true;
+                    result = buffer;
                 }
             }
         }
@@ -173,5 +301,5 @@ bool OsmAnd::HeightmapTileProvider_P::obtainData(
     }
     VSIUnlink(qPrintable(vmemFilename));
 
-    return success;
+    return result;
 }
@@ -14,6 +14,7 @@
 #include "PrivateImplementation.h"
 #include "TileDB.h"
 #include "IMapElevationDataProvider.h"
+#include "HeightmapPyramid.h"
 #include "HeightmapTileProvider.h"
 
 namespace OsmAnd
@@ -22,18 +23,35 @@ namespace OsmAnd
     {
         Q_DISABLE_COPY_AND_MOVE(HeightmapTileProvider_P);
     private:
+        static float* decodeTileData(
+            const QByteArray& data,
+            const TileId tileId,
+            const ZoomLevel zoom,
+            const uint32_t tileSize);
     protected:
         HeightmapTileProvider_P(HeightmapTileProvider* const owner,
             const QString& dataPath,//TODO:refactor-remove
             const QString& indexFilename);//TODO:refactor-remove
+        HeightmapTileProvider_P(HeightmapTileProvider* const owner,
+            const std::shared_ptr<const HeightmapPyramid>& pyramid);
 
-        TileDB _tileDb;
+        const std::unique_ptr<TileDB> _tileDb;
+        const std::shared_ptr<const HeightmapPyramid> _pyramid;
+
+        bool obtainPyramidData(
+            const TileId tileId,
+            const ZoomLevel zoom,
+            std::shared_ptr<IMapDataProvider::Data>& outData);
     public:
         ~HeightmapTileProvider_P();
 
         ImplementationInterface<HeightmapTileProvider> owner;
 
         void rebuildTileDbIndex();
+        bool convertToHeightmapPyramid(
+            const QString& outputFilePath,
+            const HeightmapPyramid::SampleType sampleType,
+            unsigned int* const pOutTilesCount);
 
         ZoomLevel getMinZoom() const;
         ZoomLevel getMaxZoom() const;
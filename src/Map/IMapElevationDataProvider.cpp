@@ -1,6 +1,175 @@
 #include "IMapElevationDataProvider.h"
 
+#include "stdlib_common.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QThread>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QtMath>
+#include "restore_internal_warnings.h"
+
 #include "MapDataProviderHelpers.h"
+#include "WorkerPool.h"
+#include "QRunnableFunctor.h"
+#include "MetricsRegistry.h"
+#include "Stopwatch.h"
+#include "Utilities.h"
+
+namespace
+{
+    // Query point along with tile it falls into. Points are sorted by tile, so each tile is handled once.
+    struct TilePoint
+    {
+        uint64_t tileId;
+        int pointIndex;
+        int tileIndex;
+
+        inline bool operator<(const TilePoint& that) const
+        {
+            if (tileId != that.tileId)
+                return tileId < that.tileId;
+            return pointIndex < that.pointIndex;
+        }
+    };
+
+    enum
+    {
+        SamplingBlockSize = 16,
+        PointsPerChunk = 4096,
+    };
+
+    OsmAnd::Concurrent::WorkerPool& getWorkerPool()
+    {
+        static OsmAnd::Concurrent::WorkerPool workerPool(
+            OsmAnd::Concurrent::WorkerPool::Order::FIFO,
+            qMax(QThread::idealThreadCount() - 1, 1));
+        return workerPool;
+    }
+
+    // Pool is shared by all queries, so completion of own workers is awaited instead of whole pool. Calling thread
+    // takes tasks as well, so query progresses even if all pooled threads are busy with other queries.
+    template<typename TASK>
+    void runInParallel(const int tasksCount, const TASK& task)
+    {
+        const auto workersCount = qMin(QThread::idealThreadCount(), tasksCount);
+        if (workersCount <= 1)
+        {
+            for (int taskIdx = 0; taskIdx < tasksCount; taskIdx++)
+                task(taskIdx);
+            return;
+        }
+
+        QAtomicInt nextTaskIdx(0);
+        const auto runTasks =
+            [&task, &nextTaskIdx, tasksCount]
+            ()
+            {
+                for (auto taskIdx = nextTaskIdx.fetchAndAddOrdered(1);
+                    taskIdx < tasksCount;
+                    taskIdx = nextTaskIdx.fetchAndAddOrdered(1))
+                {
+                    task(taskIdx);
+                }
+            };
+
+        QSemaphore finishedWorkers;
+        auto& workerPool = getWorkerPool();
+        for (auto workerIdx = 1; workerIdx < workersCount; workerIdx++)
+        {
+            workerPool.enqueue(new OsmAnd::QRunnableFunctor(
+                [&runTasks, &finishedWorkers]
+                (const OsmAnd::QRunnableFunctor* const runnable)
+                {
+                    runTasks();
+                    finishedWorkers.release();
+                }));
+        }
+        runTasks();
+        finishedWorkers.acquire(workersCount - 1);
+    }
+
+    // Elevation samples are pixel-is-point: first and last samples of each row and column lie exactly on tile edges,
+    // and are shared with neighbour tiles.
+    void sampleTile(
+        const OsmAnd::IMapElevationDataProvider::Data& data,
+        const unsigned int tileShift,
+        const TilePoint* const pTilePoints,
+        const int tilePointsCount,
+        const OsmAnd::PointI* const pPoints31,
+        float* const pOutHeights,
+        float* const pOutSlopes)
+    {
+        const auto size = static_cast<int>(data.size);
+        const auto rowStride = static_cast<int>(data.rowLength / sizeof(float));
+        const auto pSamples = data.pRawData;
+        const auto nextColumn = size > 1 ? 1 : 0;
+        const auto nextRow = size > 1 ? rowStride : 0;
+        const auto maxCoordinate = static_cast<float>(size - 1);
+        const auto maxIndex = qMax(size - 2, 0);
+        const auto samplesPerUnit = static_cast<float>(size - 1) / static_cast<float>(1u << tileShift);
+        const OsmAnd::PointI tileOrigin31(
+            data.tileId.x << tileShift,
+            data.tileId.y << tileShift);
+
+        // Within single tile meters per sample are treated as constant
+        float metersPerSample = 0.0f;
+        if (pOutSlopes)
+        {
+            metersPerSample = static_cast<float>(OsmAnd::Utilities::getMetersPerTileUnit(
+                data.zoom,
+                data.tileId.y + 0.5,
+                qMax(size - 1, 1)));
+        }
+
+        float u[SamplingBlockSize];
+        float v[SamplingBlockSize];
+        for (int blockStart = 0; blockStart < tilePointsCount; blockStart += SamplingBlockSize)
+        {
+            const auto blockSize = qMin(tilePointsCount - blockStart, static_cast<int>(SamplingBlockSize));
+            const auto pBlockPoints = pTilePoints + blockStart;
+
+            // Sample coordinates of whole block are computed first, since this loop has no branches to vectorize
+            for (int idx = 0; idx < blockSize; idx++)
+            {
+                const auto& point31 = pPoints31[pBlockPoints[idx].pointIndex];
+                u[idx] = qBound(0.0f, static_cast<float>(point31.x - tileOrigin31.x) * samplesPerUnit, maxCoordinate);
+                v[idx] = qBound(0.0f, static_cast<float>(point31.y - tileOrigin31.y) * samplesPerUnit, maxCoordinate);
+            }
+
+            for (int idx = 0; idx < blockSize; idx++)
+            {
+                const auto x0 = qMin(static_cast<int>(u[idx]), maxIndex);
+                const auto y0 = qMin(static_cast<int>(v[idx]), maxIndex);
+                const auto fx = u[idx] - x0;
+                const auto fy = v[idx] - y0;
+
+                const auto pSample = pSamples + y0 * rowStride + x0;
+                const auto h00 = pSample[0];
+                const auto h10 = pSample[nextColumn];
+                const auto h01 = pSample[nextRow];
+                const auto h11 = pSample[nextRow + nextColumn];
+
+                const auto top = h00 + (h10 - h00) * fx;
+                const auto bottom = h01 + (h11 - h01) * fx;
+                const auto pointIndex = pBlockPoints[idx].pointIndex;
+                pOutHeights[pointIndex] = top + (bottom - top) * fy;
+
+                if (pOutSlopes)
+                {
+                    const auto dx = (h10 - h00) + ((h11 - h01) - (h10 - h00)) * fy;
+                    const auto dy = bottom - top;
+                    const auto gradient = std::sqrt(dx * dx + dy * dy) / metersPerSample;
+                    pOutSlopes[pointIndex] = static_cast<float>(qRadiansToDegrees(std::atan(gradient)));
+                }
+            }
+        }
+    }
+}
 
 OsmAnd::IMapElevationDataProvider::IMapElevationDataProvider()
 {
@@ -18,6 +187,116 @@ bool OsmAnd::IMapElevationDataProvider::obtainElevationData(
     return MapDataProviderHelpers::obtainData(this, request, outElevationData, pOutMetric);
 }
 
+bool OsmAnd::IMapElevationDataProvider::obtainElevations(
+    const QVector<PointI>& points31,
+    const ZoomLevel zoom_,
+    QVector<float>& outHeights,
+    QVector<float>* const pOutSlopes /*= nullptr*/,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
+{
+    const Stopwatch stopwatch(true);
+
+    const auto pointsCount = points31.size();
+    outHeights.fill(std::numeric_limits<float>::quiet_NaN(), pointsCount);
+    if (pOutSlopes)
+        pOutSlopes->fill(std::numeric_limits<float>::quiet_NaN(), pointsCount);
+    if (pointsCount == 0)
+        return true;
+
+    const auto zoom = qBound(getMinZoom(), zoom_, getMaxZoom());
+    const auto tileShift = static_cast<unsigned int>(ZoomLevel31 - zoom);
+
+    // Group points by tiles
+    std::vector<TilePoint> tilePoints(pointsCount);
+    for (int pointIdx = 0; pointIdx < pointsCount; pointIdx++)
+    {
+        const auto& point31 = points31[pointIdx];
+        auto& tilePoint = tilePoints[pointIdx];
+        tilePoint.tileId = TileId::fromXY(point31.x >> tileShift, point31.y >> tileShift).id;
+        tilePoint.pointIndex = pointIdx;
+    }
+    std::sort(tilePoints.begin(), tilePoints.end());
+
+    QVector<TileId> tileIds;
+    for (auto& tilePoint : tilePoints)
+    {
+        if (tileIds.isEmpty() || tileIds.last().id != tilePoint.tileId)
+        {
+            TileId tileId;
+            tileId.id = tilePoint.tileId;
+            tileIds.push_back(tileId);
+        }
+        tilePoint.tileIndex = tileIds.size() - 1;
+    }
+
+    // Obtain each tile once. Every task writes only own slot, so vector is not touched otherwise.
+    QVector< std::shared_ptr<Data> > tilesData(tileIds.size());
+    const auto pTilesData = tilesData.data();
+    runInParallel(tileIds.size(),
+        [this, &tileIds, pTilesData, zoom, queryController]
+        (const int tileIdx)
+        {
+            if (queryController && queryController->isAborted())
+                return;
+
+            Request request;
+            request.tileId = tileIds.at(tileIdx);
+            request.zoom = zoom;
+            request.queryController = queryController;
+
+            std::shared_ptr<Data> data;
+            if (!obtainElevationData(request, data) || !data || !data->pRawData || data->size == 0)
+                return;
+            pTilesData[tileIdx] = data;
+        });
+    if (queryController && queryController->isAborted())
+        return false;
+
+    // Sample points in fixed-size chunks regardless of tiles, so that dense tiles are split as well
+    const auto pPoints31 = points31.constData();
+    const auto pOutHeights = outHeights.data();
+    const auto pOutSlopesData = pOutSlopes ? pOutSlopes->data() : nullptr;
+    const auto pTilePoints = tilePoints.data();
+    const auto chunksCount = (pointsCount + PointsPerChunk - 1) / PointsPerChunk;
+    runInParallel(chunksCount,
+        [pTilesData, tileShift, pTilePoints, pointsCount, pPoints31, pOutHeights, pOutSlopesData]
+        (const int chunkIdx)
+        {
+            const auto chunkEnd = qMin(static_cast<int>((chunkIdx + 1) * PointsPerChunk), pointsCount);
+            auto runStart = static_cast<int>(chunkIdx * PointsPerChunk);
+            while (runStart < chunkEnd)
+            {
+                const auto tileIndex = pTilePoints[runStart].tileIndex;
+                auto runEnd = runStart + 1;
+                while (runEnd < chunkEnd && pTilePoints[runEnd].tileIndex == tileIndex)
+                    runEnd++;
+
+                if (const auto& data = pTilesData[tileIndex])
+                {
+                    sampleTile(
+                        *data,
+                        tileShift,
+                        pTilePoints + runStart,
+                        runEnd - runStart,
+                        pPoints31,
+                        pOutHeights,
+                        pOutSlopesData);
+                }
+
+                runStart = runEnd;
+            }
+        });
+
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (metricsRegistry.isEnabled())
+    {
+        static const auto batchQueryHistogram = metricsRegistry.obtainHistogram(QLatin1String("elevation_batch_query"));
+        batchQueryHistogram->record(stopwatch.elapsed());
+    }
+
+    return true;
+}
+
 OsmAnd::IMapElevationDataProvider::Data::Data(
     const TileId tileId_,
     const ZoomLevel zoom_,
@@ -31,9 +310,25 @@ OsmAnd::IMapElevationDataProvider::Data::Data(
 {
 }
 
+OsmAnd::IMapElevationDataProvider::Data::Data(
+    const TileId tileId_,
+    const ZoomLevel zoom_,
+    const size_t rowLength_,
+    const uint32_t size_,
+    const float* const pRawData_,
+    const std::shared_ptr<const void>& rawDataHolder_)
+    : IMapTiledDataProvider::Data(tileId_, zoom_)
+    , rowLength(rowLength_)
+    , size(size_)
+    , pRawData(pRawData_)
+    , rawDataHolder(rawDataHolder_)
+{
+}
+
 OsmAnd::IMapElevationDataProvider::Data::~Data()
 {
-    delete[] pRawData;
+    if (!rawDataHolder)
+        delete[] pRawData;
 
     release();
 }
@@ -16,6 +16,13 @@ void OsmAnd::IMapRenderer_Metrics::Metric_update::reset()
     Metric::reset();
 }
 
+void OsmAnd::IMapRenderer_Metrics::Metric_update::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__IMapRenderer_Metrics__Metric_update__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
 QString OsmAnd::IMapRenderer_Metrics::Metric_update::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
@@ -44,6 +51,13 @@ void OsmAnd::IMapRenderer_Metrics::Metric_prepareFrame::reset()
     Metric::reset();
 }
 
+void OsmAnd::IMapRenderer_Metrics::Metric_prepareFrame::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__IMapRenderer_Metrics__Metric_prepareFrame__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
 QString OsmAnd::IMapRenderer_Metrics::Metric_prepareFrame::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
@@ -72,6 +86,13 @@ void OsmAnd::IMapRenderer_Metrics::Metric_renderFrame::reset()
     Metric::reset();
 }
 
+void OsmAnd::IMapRenderer_Metrics::Metric_renderFrame::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__IMapRenderer_Metrics__Metric_renderFrame__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
 QString OsmAnd::IMapRenderer_Metrics::Metric_renderFrame::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
@@ -8,6 +8,8 @@
 
 OsmAnd::MapAnimator_P::MapAnimator_P( MapAnimator* const owner_ )
     : _rendererSymbolsUpdateSuspended(false)
+    , _prefetchHintPublished(false)
+    , _previousTarget31Valid(false)
     , _isPaused(true)
     , _zoomGetter(std::bind(&MapAnimator_P::zoomGetter, this, std::placeholders::_1, std::placeholders::_2))
     , _zoomSetter(std::bind(&MapAnimator_P::zoomSetter, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3))
@@ -31,6 +33,7 @@ void OsmAnd::MapAnimator_P::setMapRenderer(const std::shared_ptr<IMapRenderer>&
 
     _isPaused = true;
     _animationsByKey.clear();
+    withdrawPrefetchHint();
     _renderer = mapRenderer;
 }
 
@@ -238,6 +241,7 @@ void OsmAnd::MapAnimator_P::update(const float timePassed)
             _renderer->resumeSymbolsUpdate();
             _rendererSymbolsUpdateSuspended = false;
         }
+        withdrawPrefetchHint();
         return;
     }
 
@@ -281,6 +285,112 @@ void OsmAnd::MapAnimator_P::update(const float timePassed)
         if (animations.isEmpty())
             itAnimations.remove();
     }
+
+    publishPrefetchHint(timePassed);
+}
+
+void OsmAnd::MapAnimator_P::publishPrefetchHint(const float timePassed)
+{
+    if (_animationsByKey.isEmpty())
+    {
+        withdrawPrefetchHint();
+        return;
+    }
+
+    const auto state = _renderer->getState();
+
+    MapPrefetchHint hint;
+    hint.target31 = state.target31;
+
+    // Velocity is taken from actual movement, so it's valid for any timing function
+    if (_previousTarget31Valid && timePassed > 0.0f)
+    {
+        auto deltaX = static_cast<int64_t>(state.target31.x) - _previousTarget31.x;
+        auto deltaY = static_cast<int64_t>(state.target31.y) - _previousTarget31.y;
+
+        // Target may have been wrapped around the world
+        const auto halfWorld = static_cast<int64_t>(1u << (ZoomLevel31 - 1));
+        if (deltaX > halfWorld)
+            deltaX -= 2 * halfWorld;
+        else if (deltaX < -halfWorld)
+            deltaX += 2 * halfWorld;
+        if (deltaY > halfWorld)
+            deltaY -= 2 * halfWorld;
+        else if (deltaY < -halfWorld)
+            deltaY += 2 * halfWorld;
+
+        hint.targetVelocity31.x = static_cast<double>(deltaX) / timePassed;
+        hint.targetVelocity31.y = static_cast<double>(deltaY) / timePassed;
+    }
+    _previousTarget31 = state.target31;
+    _previousTarget31Valid = true;
+
+    // Destination is current state plus what is left from each animation. Animations which delta is not yet
+    // known (e.g. zoom-in part of parabolic animation) do not contribute until they start.
+    PointI64 targetDeltaLeft;
+    float zoomDeltaLeft = 0.0f;
+    for (const auto& animations : constOf(_animationsByKey))
+    {
+        for (const auto& animation : constOf(animations))
+        {
+            if (animation->isPaused())
+                continue;
+
+            hint.timeLeft = qMax(hint.timeLeft, animation->delay + animation->duration - animation->getTimePassed());
+
+            if (animation->animatedValue == AnimatedValue::Zoom)
+            {
+                float deltaValue;
+                if (!animation->obtainDeltaValueAsFloat(deltaValue))
+                    continue;
+
+                float initialValue;
+                float currentValue;
+                if (animation->obtainInitialValueAsFloat(initialValue) &&
+                    animation->obtainCurrentValueAsFloat(currentValue))
+                {
+                    zoomDeltaLeft += initialValue + deltaValue - currentValue;
+                }
+                else
+                    zoomDeltaLeft += deltaValue;
+            }
+            else if (animation->animatedValue == AnimatedValue::Target)
+            {
+                PointI64 deltaValue;
+                if (!animation->obtainDeltaValueAsPointI64(deltaValue))
+                    continue;
+
+                PointI64 initialValue;
+                PointI64 currentValue;
+                if (animation->obtainInitialValueAsPointI64(initialValue) &&
+                    animation->obtainCurrentValueAsPointI64(currentValue))
+                {
+                    targetDeltaLeft += initialValue + deltaValue - currentValue;
+                }
+                else
+                    targetDeltaLeft += deltaValue;
+            }
+        }
+    }
+    hint.hasDestination = true;
+    hint.destinationTarget31 = Utilities::normalizeCoordinates(PointI64(state.target31) + targetDeltaLeft, ZoomLevel31);
+    hint.destinationZoom = getZoom(state) + zoomDeltaLeft;
+
+    _renderer->setPrefetchHint(hint);
+    _prefetchHintPublished = true;
+}
+
+void OsmAnd::MapAnimator_P::withdrawPrefetchHint()
+{
+    _previousTarget31Valid = false;
+
+    if (!_prefetchHintPublished)
+        return;
+
+    // Empty hint tells renderer that map came to rest
+    if (_renderer)
+        _renderer->setPrefetchHint(MapPrefetchHint());
+    _prefetchHintPublished = false;
 }
 
 void OsmAnd::MapAnimator_P::animateZoomBy(
@@ -539,11 +649,14 @@ void OsmAnd::MapAnimator_P::animateMoveWith(
     animateMoveBy(deltaValue, duration, zeroizeAzimuth, invZeroizeElevationAngle, TimingFunction::EaseOutQuadratic, key);
 }
 
+float OsmAnd::MapAnimator_P::getZoom(const MapRendererState& state)
+{
+    return state.zoomLevel + (state.visualZoom >= 1.0f ? state.visualZoom - 1.0f : (state.visualZoom - 1.0f) * 2.0f);
+}
+
 float OsmAnd::MapAnimator_P::zoomGetter(AnimationContext& context, const std::shared_ptr<AnimationContext>& sharedContext)
 {
-    const auto state = _renderer->getState();
-    const auto zoom = state.zoomLevel + (state.visualZoom >= 1.0f ? state.visualZoom - 1.0f : (state.visualZoom - 1.0f) * 2.0f);
-    return zoom;
+    return getZoom(_renderer->getState());
 }
 
 void OsmAnd::MapAnimator_P::zoomSetter(const float newValue, AnimationContext& context, const std::shared_ptr<AnimationContext>& sharedContext)
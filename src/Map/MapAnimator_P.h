@@ -19,6 +19,7 @@
 #include "PrivateImplementation.h"
 #include "MapAnimator.h"
 #include "MapCommonTypes.h"
+#include "MapRendererState.h"
 
 namespace OsmAnd
 {
@@ -41,6 +42,13 @@ namespace OsmAnd
         std::shared_ptr<IMapRenderer> _renderer;
         bool _rendererSymbolsUpdateSuspended;
 
+        // Renderer is told where map is heading, so that it could prefetch resources
+        bool _prefetchHintPublished;
+        bool _previousTarget31Valid;
+        PointI _previousTarget31;
+        void publishPrefetchHint(const float timePassed);
+        void withdrawPrefetchHint();
+
         struct AnimationContext
         {
             QVariantList storageList;
@@ -573,6 +581,7 @@ namespace OsmAnd
             const float duration,
             const TimingFunction timingFunction);
 
+        static float getZoom(const MapRendererState& state);
         const Animation<float>::GetInitialValueMethod _zoomGetter;
         float zoomGetter(AnimationContext& context, const std::shared_ptr<AnimationContext>& sharedContext);
         const Animation<float>::ApplierMethod _zoomSetter;
@@ -8,6 +8,8 @@
 
 #include "IMapObjectsProvider.h"
 #include "Stopwatch.h"
+#include "MetricsRegistry.h"
+#include "Tracer.h"
 #include "Utilities.h"
 #include "Logging.h"
 
@@ -48,12 +50,27 @@ bool OsmAnd::MapPrimitivesProvider_P::obtainTiledPrimitives(
     std::shared_ptr<MapPrimitivesProvider::Data>& outTiledPrimitives,
     MapPrimitivesProvider_Metrics::Metric_obtainData* const metric_)
 {
-#if OSMAND_PERFORMANCE_METRICS
+    OSMAND_TRACE_TASK_SPAN("MapPrimitivesProvider::obtainTiledPrimitives",
+        Tracer::getTileTaskId(request.tileId, request.zoom));
+
+    // Metric of this call only, it's merged into caller's metric at the end
     MapPrimitivesProvider_Metrics::Metric_obtainData localMetric;
-    const auto metric = metric_ ? metric_ : &localMetric;
+#if OSMAND_PERFORMANCE_METRICS
+    const auto metric = &localMetric;
 #else
-    const auto metric = metric_;
+    const auto metric = (metric_ || MetricsRegistry::getDefault().isEnabled()) ? &localMetric : nullptr;
 #endif
+    const auto mergeLocalMetric =
+        [metric_, &localMetric]
+        ()
+        {
+            if (!metric_)
+                return;
+
+            metric_->accumulate(localMetric);
+            for (const auto& submetric : localMetric.submetrics)
+                metric_->addOrReplaceSubmetric(submetric.shared_ptr());
+        };
 
     const Stopwatch totalStopwatch(metric != nullptr);
 
@@ -135,6 +152,7 @@ bool OsmAnd::MapPrimitivesProvider_P::obtainTiledPrimitives(
         }
 
         outTiledPrimitives.reset();
+        mergeLocalMetric();
         return true;
     }
 
@@ -214,8 +232,16 @@ bool OsmAnd::MapPrimitivesProvider_P::obtainTiledPrimitives(
     }
 
     if (metric)
+    {
         metric->elapsedTime = totalStopwatch.elapsed();
 
+        static MetricsRegistry::MetricRecorder primitiviseTileRecorder(
+            MetricsRegistry::getDefault(),
+            QLatin1String("primitivise_tile"));
+        primitiviseTileRecorder.record(*metric);
+    }
+    mergeLocalMetric();
+
 #if OSMAND_PERFORMANCE_METRICS
 #if OSMAND_PERFORMANCE_METRICS <= 1
     LogPrintf(LogSeverityLevel::Info,
@@ -3,6 +3,14 @@
 
 #include "MapPresentationEnvironment.h"
 #include "MapObject.h"
+#include "IMemoryManager.h"
+#include "MetricsRegistry.h"
+
+static OsmAnd::MetricsRegistry::Histogram* getPrimitiviseHistogram()
+{
+    static const auto histogram = OsmAnd::MetricsRegistry::getDefault().obtainHistogram(QLatin1String("primitivise"));
+    return histogram;
+}
 
 OsmAnd::MapPrimitiviser::MapPrimitiviser(const std::shared_ptr<const MapPresentationEnvironment>& environment_)
     : _p(new MapPrimitiviser_P(this))
@@ -21,6 +29,9 @@ std::shared_ptr<OsmAnd::MapPrimitiviser::PrimitivisedObjects> OsmAnd::MapPrimiti
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     MapPrimitiviser_Metrics::Metric_primitiviseAllMapObjects* const metric /*= nullptr*/)
 {
+    const MemoryTagScope memoryTagScope("Primitivisation");
+    const MetricsRegistry::ScopedTimer primitiviseTimer(MetricsRegistry::getDefault(), getPrimitiviseHistogram());
+
     return _p->primitiviseAllMapObjects(zoom, objects, cache, queryController, metric);
 }
 
@@ -32,6 +43,9 @@ std::shared_ptr<OsmAnd::MapPrimitiviser::PrimitivisedObjects> OsmAnd::MapPrimiti
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     MapPrimitiviser_Metrics::Metric_primitiviseAllMapObjects* const metric /*= nullptr*/)
 {
+    const MemoryTagScope memoryTagScope("Primitivisation");
+    const MetricsRegistry::ScopedTimer primitiviseTimer(MetricsRegistry::getDefault(), getPrimitiviseHistogram());
+
     return _p->primitiviseAllMapObjects(scaleDivisor31ToPixel, zoom, objects, cache, queryController, metric);
 }
 
@@ -45,6 +59,9 @@ std::shared_ptr<OsmAnd::MapPrimitiviser::PrimitivisedObjects> OsmAnd::MapPrimiti
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     MapPrimitiviser_Metrics::Metric_primitiviseWithSurface* const metric /*= nullptr*/)
 {
+    const MemoryTagScope memoryTagScope("Primitivisation");
+    const MetricsRegistry::ScopedTimer primitiviseTimer(MetricsRegistry::getDefault(), getPrimitiviseHistogram());
+
     return _p->primitiviseWithSurface(area31, areaSizeInPixels, zoom, surfaceType, objects, cache, queryController, metric);
 }
 
@@ -56,6 +73,9 @@ std::shared_ptr<OsmAnd::MapPrimitiviser::PrimitivisedObjects> OsmAnd::MapPrimiti
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/,
     MapPrimitiviser_Metrics::Metric_primitiviseWithoutSurface* const metric /*= nullptr*/)
 {
+    const MemoryTagScope memoryTagScope("Primitivisation");
+    const MetricsRegistry::ScopedTimer primitiviseTimer(MetricsRegistry::getDefault(), getPrimitiviseHistogram());
+
     return _p->primitiviseWithoutSurface(scaleDivisor31ToPixel, zoom, objects, cache, queryController, metric);
 }
 
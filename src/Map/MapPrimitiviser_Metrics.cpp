@@ -16,6 +16,13 @@ void OsmAnd::MapPrimitiviser_Metrics::Metric_primitivise::reset()
     Metric::reset();
 }
 
+void OsmAnd::MapPrimitiviser_Metrics::Metric_primitivise::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__MapPrimitiviser_Metrics__Metric_primitivise__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
 QString OsmAnd::MapPrimitiviser_Metrics::Metric_primitivise::toString(
     const bool shortFormat /*= false*/,
     const QString& prefix /*= QString::null*/) const
@@ -55,6 +62,13 @@ void OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseAllMapObjects::reset()
     Metric_primitivise::reset();
 }
 
+void OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseAllMapObjects::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__MapPrimitiviser_Metrics__Metric_primitiviseAllMapObjects__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric_primitivise::visitFields(visitor);
+}
+
 QString OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseAllMapObjects::toString(
     const bool shortFormat /*= false*/,
     const QString& prefix /*= QString::null*/) const
@@ -87,6 +101,13 @@ void OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseWithoutSurface::reset()
     Metric_primitivise::reset();
 }
 
+void OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseWithoutSurface::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__MapPrimitiviser_Metrics__Metric_primitiviseWithoutSurface__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric_primitivise::visitFields(visitor);
+}
+
 QString OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseWithoutSurface::toString(
     const bool shortFormat /*= false*/,
     const QString& prefix /*= QString::null*/) const
@@ -119,6 +140,13 @@ void OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseWithSurface::reset()
     Metric_primitiviseWithoutSurface::reset();
 }
 
+void OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseWithSurface::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__MapPrimitiviser_Metrics__Metric_primitiviseWithSurface__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric_primitiviseWithoutSurface::visitFields(visitor);
+}
+
 QString OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseWithSurface::toString(
     const bool shortFormat /*= false*/,
     const QString& prefix /*= QString::null*/) const
@@ -19,6 +19,7 @@
 #include "BinaryMapObject.h"
 #include "Road.h"
 #include "Stopwatch.h"
+#include "Tracer.h"
 #include "Utilities.h"
 #include "QKeyValueIterator.h"
 #include "QCachingIterator.h"
@@ -62,6 +63,7 @@ std::shared_ptr<OsmAnd::MapPrimitiviser_P::PrimitivisedObjects> OsmAnd::MapPrimi
     const std::shared_ptr<const IQueryController>& queryController,
     MapPrimitiviser_Metrics::Metric_primitiviseAllMapObjects* const metric)
 {
+    OSMAND_TRACE_SPAN("MapPrimitiviser::primitiviseAllMapObjects");
     const Stopwatch totalStopwatch(metric != nullptr);
 
     const Context context(owner->environment, zoom);
@@ -122,6 +124,7 @@ std::shared_ptr<OsmAnd::MapPrimitiviser_P::PrimitivisedObjects> OsmAnd::MapPrimi
     const std::shared_ptr<const IQueryController>& queryController,
     MapPrimitiviser_Metrics::Metric_primitiviseWithSurface* const metric)
 {
+    OSMAND_TRACE_SPAN("MapPrimitiviser::primitiviseWithSurface");
     const Stopwatch totalStopwatch(metric != nullptr);
 
     //////////////////////////////////////////////////////////////////////////
@@ -477,6 +480,7 @@ std::shared_ptr<OsmAnd::MapPrimitiviser_P::PrimitivisedObjects> OsmAnd::MapPrimi
     const std::shared_ptr<const IQueryController>& queryController,
     MapPrimitiviser_Metrics::Metric_primitiviseWithoutSurface* const metric)
 {
+    OSMAND_TRACE_SPAN("MapPrimitiviser::primitiviseWithoutSurface");
     const Stopwatch totalStopwatch(metric != nullptr);
 
     const Context context(owner->environment, zoom);
@@ -16,6 +16,18 @@ void OsmAnd::MapRasterLayerProvider_Metrics::Metric_obtainData::reset()
     Metric::reset();
 }
 
+void OsmAnd::MapRasterLayerProvider_Metrics::Metric_obtainData::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__MapRasterLayerProvider_Metrics__Metric_obtainData__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
+void OsmAnd::MapRasterLayerProvider_Metrics::Metric_obtainData::accumulate(const Metric_obtainData& other)
+{
+    OsmAnd__MapRasterLayerProvider_Metrics__Metric_obtainData__FIELDS(ACCUMULATE_METRIC_FIELD);
+}
+
 QString OsmAnd::MapRasterLayerProvider_Metrics::Metric_obtainData::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
@@ -12,6 +12,8 @@
 #include "MapPrimitiviser.h"
 #include "MapRasterizer.h"
 #include "Stopwatch.h"
+#include "MetricsRegistry.h"
+#include "Tracer.h"
 
 OsmAnd::MapRasterLayerProvider_P::MapRasterLayerProvider_P(MapRasterLayerProvider* const owner_)
     : owner(owner_)
@@ -50,12 +52,27 @@ bool OsmAnd::MapRasterLayerProvider_P::obtainRasterizedTile(
     std::shared_ptr<MapRasterLayerProvider::Data>& outData,
     MapRasterLayerProvider_Metrics::Metric_obtainData* const metric_)
 {
-#if OSMAND_PERFORMANCE_METRICS
+    OSMAND_TRACE_TASK_SPAN("MapRasterLayerProvider::obtainRasterizedTile",
+        Tracer::getTileTaskId(request.tileId, request.zoom));
+
+    // Metric of this call only, it's merged into caller's metric at the end
     MapRasterLayerProvider_Metrics::Metric_obtainData localMetric;
-    const auto metric = metric_ ? metric_ : &localMetric;
+#if OSMAND_PERFORMANCE_METRICS
+    const auto metric = &localMetric;
 #else
-    const auto metric = metric_;
+    const auto metric = (metric_ || MetricsRegistry::getDefault().isEnabled()) ? &localMetric : nullptr;
 #endif
+    const auto mergeLocalMetric =
+        [metric_, &localMetric]
+        ()
+        {
+            if (!metric_)
+                return;
+
+            metric_->accumulate(localMetric);
+            for (const auto& submetric : localMetric.submetrics)
+                metric_->addOrReplaceSubmetric(submetric.shared_ptr());
+        };
 
     const Stopwatch totalStopwatch(
 #if OSMAND_PERFORMANCE_METRICS
@@ -78,6 +95,7 @@ bool OsmAnd::MapRasterLayerProvider_P::obtainRasterizedTile(
         if (metric)
             metric->elapsedTime += totalStopwatch.elapsed();
 
+        mergeLocalMetric();
         return true;
     }
 
@@ -88,6 +106,7 @@ bool OsmAnd::MapRasterLayerProvider_P::obtainRasterizedTile(
         if (metric)
             metric->elapsedTime += totalStopwatch.elapsed();
 
+        mergeLocalMetric();
         return false;
     }
 
@@ -102,8 +121,16 @@ bool OsmAnd::MapRasterLayerProvider_P::obtainRasterizedTile(
         new RetainableCacheMetadata(primitivesTile->retainableCacheMetadata)));
 
     if (metric)
+    {
         metric->elapsedTime += totalStopwatch.elapsed();
 
+        static MetricsRegistry::MetricRecorder rasterTileRecorder(
+            MetricsRegistry::getDefault(),
+            QLatin1String("raster_tile"));
+        rasterTileRecorder.record(*metric);
+    }
+    mergeLocalMetric();
+
     return true;
 }
 
@@ -0,0 +1,163 @@
+#include "MapRasterTilesBatchRenderer.h"
+#include "MapRasterTilesBatchRenderer_P.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QStringList>
+#include <QThread>
+#include "restore_internal_warnings.h"
+
+#include "IMapObjectsProvider.h"
+#include "MapPrimitiviser.h"
+#include "Utilities.h"
+
+OsmAnd::MapRasterTilesBatchRenderer::MapRasterTilesBatchRenderer(
+    const std::shared_ptr<IMapObjectsProvider>& mapObjectsProvider_,
+    const std::shared_ptr<MapPrimitiviser>& primitiviser_,
+    const Configuration& configuration_)
+    : _p(new MapRasterTilesBatchRenderer_P(this))
+    , mapObjectsProvider(mapObjectsProvider_)
+    , primitiviser(primitiviser_)
+    , configuration(configuration_)
+{
+}
+
+OsmAnd::MapRasterTilesBatchRenderer::~MapRasterTilesBatchRenderer()
+{
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer::render(
+    const ProgressCallback progressCallback /*= nullptr*/,
+    const float progressInterval /*= 1.0f*/,
+    const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/)
+{
+    return _p->render(progressCallback, progressInterval, queryController);
+}
+
+OsmAnd::MapRasterTilesBatchRenderer::Statistics OsmAnd::MapRasterTilesBatchRenderer::getStatistics() const
+{
+    return _p->getStatistics();
+}
+
+QVector<OsmAnd::TileId> OsmAnd::MapRasterTilesBatchRenderer::enumerateTilesInHilbertOrder(
+    const AreaI bbox31,
+    const ZoomLevel zoom)
+{
+    const auto zoomShift = ZoomLevel31 - zoom;
+    const auto tileIdTL = TileId::fromXY(bbox31.left() >> zoomShift, bbox31.top() >> zoomShift);
+    const auto tileIdBR = TileId::fromXY(bbox31.right() >> zoomShift, bbox31.bottom() >> zoomShift);
+
+    QVector< std::pair<uint64_t, TileId> > orderedTiles;
+    orderedTiles.reserve((tileIdBR.x - tileIdTL.x + 1) * (tileIdBR.y - tileIdTL.y + 1));
+    for (auto x = tileIdTL.x; x <= tileIdBR.x; x++)
+    {
+        for (auto y = tileIdTL.y; y <= tileIdBR.y; y++)
+            orderedTiles.push_back({ Utilities::encodeHilbertCode(x, y, zoom), TileId::fromXY(x, y) });
+    }
+    std::sort(orderedTiles,
+        []
+        (const std::pair<uint64_t, TileId>& l, const std::pair<uint64_t, TileId>& r) -> bool
+        {
+            return l.first < r.first;
+        });
+
+    QVector<TileId> tiles;
+    tiles.reserve(orderedTiles.size());
+    for (const auto& orderedTile : constOf(orderedTiles))
+        tiles.push_back(orderedTile.second);
+    return tiles;
+}
+
+QString OsmAnd::MapRasterTilesBatchRenderer::getStageName(const Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::Fetch:
+            return QLatin1String("fetch");
+        case Stage::Primitivise:
+            return QLatin1String("primitivise");
+        case Stage::Rasterize:
+            return QLatin1String("rasterize");
+        case Stage::Encode:
+            return QLatin1String("encode");
+        case Stage::Write:
+            return QLatin1String("write");
+        default:
+            return QString::null;
+    }
+}
+
+OsmAnd::MapRasterTilesBatchRenderer::Configuration::Configuration()
+    : bbox31(0, 0, 0, 0)
+    , minZoom(ZoomLevel0)
+    , maxZoom(ZoomLevel0)
+    , tileSize(256)
+    , fillBackground(true)
+    , outputFormat(OutputFormat::DirectoryTree)
+    , maxQueueDepth(64)
+    , writeBatchSize(512)
+{
+    const auto idealThreadCount = static_cast<unsigned int>(qMax(1, QThread::idealThreadCount()));
+
+    threadsCount[static_cast<unsigned int>(Stage::Fetch)] = qMax(1u, idealThreadCount / 4);
+    threadsCount[static_cast<unsigned int>(Stage::Primitivise)] = qMax(1u, idealThreadCount / 2);
+    threadsCount[static_cast<unsigned int>(Stage::Rasterize)] = idealThreadCount;
+    threadsCount[static_cast<unsigned int>(Stage::Encode)] = qMax(1u, idealThreadCount / 2);
+    threadsCount[static_cast<unsigned int>(Stage::Write)] = 1;
+}
+
+OsmAnd::MapRasterTilesBatchRenderer::StageStatistics::StageStatistics()
+    : threadsCount(0)
+    , processedTilesCount(0)
+    , busyTime(0.0f)
+    , queueDepth(0)
+    , maxQueueDepth(0)
+{
+}
+
+float OsmAnd::MapRasterTilesBatchRenderer::StageStatistics::getTilesPerSecond(const float wallTime) const
+{
+    if (wallTime <= 0.0f)
+        return 0.0f;
+    return static_cast<float>(processedTilesCount) / wallTime;
+}
+
+OsmAnd::MapRasterTilesBatchRenderer::Statistics::Statistics()
+    : totalTilesCount(0)
+    , scheduledTilesCount(0)
+    , writtenTilesCount(0)
+    , emptyTilesCount(0)
+    , failedTilesCount(0)
+    , elapsedTime(0.0f)
+{
+}
+
+QString OsmAnd::MapRasterTilesBatchRenderer::Statistics::toString(const QString& prefix /*= QString::null*/) const
+{
+    QStringList output;
+
+    output.push_back(prefix + QString(QLatin1String("tiles: %1 written, %2 empty, %3 failed of %4 (%5 scheduled) in %6s"))
+        .arg(writtenTilesCount)
+        .arg(emptyTilesCount)
+        .arg(failedTilesCount)
+        .arg(totalTilesCount)
+        .arg(scheduledTilesCount)
+        .arg(elapsedTime));
+    for (auto stageIdx = 0u; stageIdx < StagesCount; stageIdx++)
+    {
+        const auto& stage = stages[stageIdx];
+        const auto averageTime = stage.processedTilesCount > 0
+            ? stage.busyTime / static_cast<float>(stage.processedTilesCount)
+            : 0.0f;
+        output.push_back(prefix + QString(QLatin1String("%1: %2 tiles, %3 tiles/s, %4ms/tile x%5 threads, queue %6 (max %7)"))
+            .arg(getStageName(static_cast<Stage>(stageIdx)))
+            .arg(stage.processedTilesCount)
+            .arg(stage.getTilesPerSecond(elapsedTime))
+            .arg(averageTime * 1000.0f)
+            .arg(stage.threadsCount)
+            .arg(stage.queueDepth)
+            .arg(stage.maxQueueDepth));
+    }
+
+    return output.join(QLatin1Char('\n'));
+}
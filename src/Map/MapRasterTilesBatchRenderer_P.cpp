@@ -0,0 +1,624 @@
+#include "MapRasterTilesBatchRenderer_P.h"
+#include "MapRasterTilesBatchRenderer.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtSql>
+#include "restore_internal_warnings.h"
+
+#include "ignore_warnings_on_external_includes.h"
+#include <SkBitmap.h>
+#include <SkCanvas.h>
+#include <SkBitmapDevice.h>
+#include <SkImageEncoder.h>
+#include <SkData.h>
+#include "restore_internal_warnings.h"
+
+#include "WorkerPool.h"
+#include "Thread.h"
+#include "QRunnableFunctor.h"
+#include "IQueryController.h"
+#include "MapPresentationEnvironment.h"
+#include "MapRasterizer.h"
+#include "Utilities.h"
+#include "Logging.h"
+
+OsmAnd::MapRasterTilesBatchRenderer_P::MapRasterTilesBatchRenderer_P(MapRasterTilesBatchRenderer* const owner_)
+    : _outputIsOpened(false)
+    , _pendingWritesCount(0)
+    , owner(owner_)
+{
+}
+
+OsmAnd::MapRasterTilesBatchRenderer_P::~MapRasterTilesBatchRenderer_P()
+{
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::render(
+    const MapRasterTilesBatchRenderer::ProgressCallback progressCallback,
+    const float progressInterval,
+    const std::shared_ptr<const IQueryController>& queryController)
+{
+    const auto& configuration = owner->configuration;
+    if (configuration.minZoom > configuration.maxZoom || configuration.tileSize == 0)
+    {
+        LogPrintf(LogSeverityLevel::Error, "Invalid batch rendering configuration");
+        return false;
+    }
+    if (configuration.outputPath.isEmpty())
+    {
+        LogPrintf(LogSeverityLevel::Error, "Batch rendering output path is not specified");
+        return false;
+    }
+
+    // Owner members are not yet initialized when this object is constructed, so rasterizer is created here
+    if (!_rasterizer)
+        _rasterizer.reset(new MapRasterizer(owner->primitiviser->environment));
+
+    // Schedule all tiles in Hilbert order, zoom by zoom, so that neighbour tiles go one after another
+    // and share OBF blocks and primitiviser caches
+    QVector<QVector<TileId>> tilesByZoom;
+    auto totalTilesCount = 0u;
+    for (auto zoom = configuration.minZoom; zoom <= configuration.maxZoom; zoom = static_cast<ZoomLevel>(zoom + 1))
+    {
+        tilesByZoom.push_back(MapRasterTilesBatchRenderer::enumerateTilesInHilbertOrder(configuration.bbox31, zoom));
+        totalTilesCount += tilesByZoom.last().size();
+    }
+
+    // Prepare queues and statistics
+    std::array<unsigned int, MapRasterTilesBatchRenderer::StagesCount> threadsCount;
+    for (auto stageIdx = 0u; stageIdx < MapRasterTilesBatchRenderer::StagesCount; stageIdx++)
+        threadsCount[stageIdx] = qMax(1u, configuration.threadsCount[stageIdx]);
+    threadsCount[static_cast<unsigned int>(Stage::Write)] = 1;
+    for (auto stageIdx = 0u; stageIdx < MapRasterTilesBatchRenderer::StagesCount; stageIdx++)
+    {
+        auto& queue = _queues[stageIdx];
+        queue.jobs.clear();
+        queue.capacity = qMax(1u, configuration.maxQueueDepth);
+        queue.producersCount = (stageIdx == 0) ? 1 : threadsCount[stageIdx - 1];
+        queue.maxDepth = 0;
+    }
+    {
+        QMutexLocker scopedLocker(&_statisticsMutex);
+
+        _statistics = Statistics();
+        _statistics.totalTilesCount = totalTilesCount;
+        for (auto stageIdx = 0u; stageIdx < MapRasterTilesBatchRenderer::StagesCount; stageIdx++)
+            _statistics.stages[stageIdx].threadsCount = threadsCount[stageIdx];
+    }
+    _stopwatch.start();
+
+    // Launch pools of each stage. Each pool runs as many stage loops as it has threads
+    std::array<std::unique_ptr<Concurrent::WorkerPool>, MapRasterTilesBatchRenderer::StagesCount> pools;
+    for (auto stageIdx = 0u; stageIdx < MapRasterTilesBatchRenderer::StagesCount; stageIdx++)
+    {
+        const auto stage = static_cast<Stage>(stageIdx);
+        pools[stageIdx].reset(new Concurrent::WorkerPool(
+            Concurrent::WorkerPool::Order::FIFO,
+            static_cast<int>(threadsCount[stageIdx])));
+        for (auto threadIdx = 0u; threadIdx < threadsCount[stageIdx]; threadIdx++)
+        {
+            pools[stageIdx]->enqueue(new QRunnableFunctor(
+                [this, stage, queryController]
+                (const QRunnableFunctor* const runnable)
+                {
+                    runStage(stage, queryController);
+                }));
+        }
+    }
+
+    // Feed tiles to the first stage from dedicated thread, since pushing blocks when pipeline is saturated
+    Concurrent::Thread feederThread(
+        [this, &tilesByZoom, &configuration, queryController]
+        ()
+        {
+            auto& fetchQueue = _queues[static_cast<unsigned int>(Stage::Fetch)];
+            auto zoom = configuration.minZoom;
+            for (const auto& tiles : constOf(tilesByZoom))
+            {
+                for (const auto& tileId : constOf(tiles))
+                {
+                    if (queryController && queryController->isAborted())
+                        break;
+
+                    fetchQueue.push(std::make_shared<Job>(tileId, zoom));
+
+                    QMutexLocker scopedLocker(&_statisticsMutex);
+                    _statistics.scheduledTilesCount++;
+                }
+                if (queryController && queryController->isAborted())
+                    break;
+                zoom = static_cast<ZoomLevel>(zoom + 1);
+            }
+            fetchQueue.releaseProducer();
+        });
+    feederThread.start();
+
+    // Since write stage is the last one, it finishes only after all previous stages have finished
+    const auto& writePool = pools[static_cast<unsigned int>(Stage::Write)];
+    const auto progressIntervalMsecs = qMax(1, static_cast<int>(progressInterval * 1000.0f));
+    while (!writePool->waitForDone(progressCallback ? progressIntervalMsecs : -1))
+    {
+        if (progressCallback)
+            progressCallback(captureStatistics());
+    }
+    feederThread.wait();
+    for (const auto& pool : pools)
+        pool->waitForDone();
+
+    const auto statistics = captureStatistics();
+    {
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        _statistics = statistics;
+    }
+    if (progressCallback)
+        progressCallback(statistics);
+
+    if (queryController && queryController->isAborted())
+        return false;
+    return _outputIsOpened && statistics.failedTilesCount == 0;
+}
+
+OsmAnd::MapRasterTilesBatchRenderer_P::Statistics OsmAnd::MapRasterTilesBatchRenderer_P::getStatistics() const
+{
+    return captureStatistics();
+}
+
+void OsmAnd::MapRasterTilesBatchRenderer_P::runStage(
+    const Stage stage,
+    const std::shared_ptr<const IQueryController>& queryController)
+{
+    const auto stageIdx = static_cast<unsigned int>(stage);
+    auto& inputQueue = _queues[stageIdx];
+    const auto pOutputQueue = (stage != Stage::Write) ? &_queues[stageIdx + 1] : nullptr;
+
+    // SQLite connection can be used only from the thread that has opened it
+    if (stage == Stage::Write)
+        _outputIsOpened = openOutput();
+
+    while (const auto job = inputQueue.pop())
+    {
+        // Once aborted, just drain the queue
+        if (queryController && queryController->isAborted())
+            continue;
+
+        const Stopwatch stageStopwatch(true);
+        const auto shouldContinue = processJob(stage, job, queryController);
+        accountStageWork(stage, stageStopwatch.elapsed());
+
+        if (shouldContinue && pOutputQueue)
+            pOutputQueue->push(job);
+    }
+
+    if (stage == Stage::Write)
+        closeOutput();
+
+    if (pOutputQueue)
+        pOutputQueue->releaseProducer();
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::processJob(
+    const Stage stage,
+    const std::shared_ptr<Job>& job,
+    const std::shared_ptr<const IQueryController>& queryController)
+{
+    switch (stage)
+    {
+        case Stage::Fetch:
+            return fetch(job, queryController);
+        case Stage::Primitivise:
+            return primitivise(job, queryController);
+        case Stage::Rasterize:
+            return rasterize(job, queryController);
+        case Stage::Encode:
+            return encode(job);
+        case Stage::Write:
+            return write(job);
+        default:
+            return false;
+    }
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::fetch(
+    const std::shared_ptr<Job>& job,
+    const std::shared_ptr<const IQueryController>& queryController)
+{
+    IMapObjectsProvider::Request request;
+    request.tileId = job->tileId;
+    request.zoom = job->zoom;
+    request.queryController = queryController;
+
+    if (!owner->mapObjectsProvider->obtainTiledMapObjects(request, job->mapObjects))
+    {
+        LogPrintf(LogSeverityLevel::Warning,
+            "Failed to obtain map objects for %dx%d@%d",
+            job->tileId.x,
+            job->tileId.y,
+            job->zoom);
+
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        _statistics.failedTilesCount++;
+        return false;
+    }
+
+    if (!job->mapObjects)
+    {
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        _statistics.emptyTilesCount++;
+        return false;
+    }
+
+    return true;
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::primitivise(
+    const std::shared_ptr<Job>& job,
+    const std::shared_ptr<const IQueryController>& queryController)
+{
+    const auto tileSize = owner->configuration.tileSize;
+    job->primitivisedObjects = owner->primitiviser->primitiviseWithSurface(
+        Utilities::tileBoundingBox31(job->tileId, job->zoom),
+        PointI(tileSize, tileSize),
+        job->zoom,
+        job->mapObjects->tileSurfaceType,
+        job->mapObjects->mapObjects,
+        nullptr,
+        queryController);
+
+    // Map objects are no longer needed, release them as early as possible
+    job->mapObjects.reset();
+
+    if (!job->primitivisedObjects || job->primitivisedObjects->isEmpty())
+    {
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        _statistics.emptyTilesCount++;
+        return false;
+    }
+
+    return true;
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::rasterize(
+    const std::shared_ptr<Job>& job,
+    const std::shared_ptr<const IQueryController>& queryController)
+{
+    const auto tileSize = owner->configuration.tileSize;
+    const std::shared_ptr<SkBitmap> bitmap(new SkBitmap());
+    if (!bitmap->tryAllocPixels(SkImageInfo::MakeN32Premul(tileSize, tileSize)))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to allocate buffer for rasterization surface %dx%d",
+            tileSize,
+            tileSize);
+
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        _statistics.failedTilesCount++;
+        return false;
+    }
+    SkBitmapDevice rasterizationTarget(*bitmap);
+    SkCanvas canvas(&rasterizationTarget);
+
+    if (!owner->configuration.fillBackground)
+        canvas.clear(SK_ColorTRANSPARENT);
+    _rasterizer->rasterize(
+        Utilities::tileBoundingBox31(job->tileId, job->zoom),
+        job->primitivisedObjects,
+        canvas,
+        owner->configuration.fillBackground,
+        nullptr,
+        nullptr,
+        queryController);
+
+    job->primitivisedObjects.reset();
+    job->bitmap = bitmap;
+
+    return true;
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::encode(const std::shared_ptr<Job>& job)
+{
+    std::unique_ptr<SkImageEncoder> encoder(CreatePNGImageEncoder());
+    const auto data = encoder->encodeData(*job->bitmap, 100);
+    job->bitmap.reset();
+    if (!data)
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to encode %dx%d@%d",
+            job->tileId.x,
+            job->tileId.y,
+            job->zoom);
+
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        _statistics.failedTilesCount++;
+        return false;
+    }
+
+    job->encodedData = QByteArray(reinterpret_cast<const char*>(data->bytes()), data->size());
+    data->unref();
+
+    return true;
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::write(const std::shared_ptr<Job>& job)
+{
+    bool ok = _outputIsOpened;
+    if (ok && owner->configuration.outputFormat == MapRasterTilesBatchRenderer::OutputFormat::MBTiles)
+    {
+        // MBTiles uses TMS tile rows, so Y axis is flipped
+        QSqlQuery insertQuery(_mbtilesDb);
+        insertQuery.prepare(
+            "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES ( ?, ?, ?, ? )");
+        insertQuery.addBindValue(static_cast<int>(job->zoom));
+        insertQuery.addBindValue(job->tileId.x);
+        insertQuery.addBindValue(static_cast<int32_t>((1u << job->zoom) - 1u) - job->tileId.y);
+        insertQuery.addBindValue(job->encodedData);
+        ok = insertQuery.exec();
+        if (!ok)
+        {
+            LogPrintf(LogSeverityLevel::Error,
+                "Failed to write %dx%d@%d to MBTiles: %s",
+                job->tileId.x,
+                job->tileId.y,
+                job->zoom,
+                qPrintable(insertQuery.lastError().text()));
+        }
+
+        // Commit in batches to keep transaction overhead low
+        if (ok && ++_pendingWritesCount >= qMax(1u, owner->configuration.writeBatchSize))
+        {
+            _mbtilesDb.commit();
+            _mbtilesDb.transaction();
+            _pendingWritesCount = 0;
+        }
+    }
+    else if (ok)
+    {
+        ok = writeTileToDirectoryTree(*job);
+    }
+
+    job->encodedData.clear();
+
+    QMutexLocker scopedLocker(&_statisticsMutex);
+    if (ok)
+        _statistics.writtenTilesCount++;
+    else
+        _statistics.failedTilesCount++;
+    return ok;
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::openOutput()
+{
+    const auto& configuration = owner->configuration;
+
+    if (configuration.outputFormat == MapRasterTilesBatchRenderer::OutputFormat::DirectoryTree)
+    {
+        if (!QDir(configuration.outputPath).mkpath(QLatin1String(".")))
+        {
+            LogPrintf(LogSeverityLevel::Error,
+                "Failed to create output directory '%s'",
+                qPrintable(configuration.outputPath));
+            return false;
+        }
+        return true;
+    }
+
+    QFileInfo(configuration.outputPath).absoluteDir().mkpath(QLatin1String("."));
+
+    const auto connectionName = QString(QLatin1String("mbtiles-batch:%1:%2"))
+        .arg(configuration.outputPath)
+        .arg(reinterpret_cast<quintptr>(this));
+    _mbtilesDb = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), connectionName);
+    _mbtilesDb.setDatabaseName(configuration.outputPath);
+    if (!_mbtilesDb.open())
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to open MBTiles '%s': %s",
+            qPrintable(configuration.outputPath),
+            qPrintable(_mbtilesDb.lastError().text()));
+        return false;
+    }
+
+    QSqlQuery query(_mbtilesDb);
+    bool ok = true;
+    ok = ok && query.exec("PRAGMA journal_mode=WAL");
+    ok = ok && query.exec("PRAGMA synchronous=NORMAL");
+    ok = ok && query.exec(
+        "CREATE TABLE IF NOT EXISTS metadata ("
+        "    name TEXT,"
+        "    value TEXT"
+        ")");
+    ok = ok && query.exec(
+        "CREATE TABLE IF NOT EXISTS tiles ("
+        "    zoom_level INTEGER,"
+        "    tile_column INTEGER,"
+        "    tile_row INTEGER,"
+        "    tile_data BLOB"
+        ")");
+    ok = ok && query.exec(
+        "CREATE UNIQUE INDEX IF NOT EXISTS tile_index"
+        "    ON tiles(zoom_level, tile_column, tile_row)");
+    ok = ok && query.exec("DELETE FROM metadata");
+    if (!ok)
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to prepare MBTiles '%s': %s",
+            qPrintable(configuration.outputPath),
+            qPrintable(query.lastError().text()));
+        _mbtilesDb.close();
+        return false;
+    }
+
+    const auto topLeft = Utilities::convert31ToLatLon(configuration.bbox31.topLeft);
+    const auto bottomRight = Utilities::convert31ToLatLon(configuration.bbox31.bottomRight);
+    QList< QPair<QString, QString> > metadata;
+    metadata.push_back(qMakePair(QString(QLatin1String("name")), QFileInfo(configuration.outputPath).completeBaseName()));
+    metadata.push_back(qMakePair(QString(QLatin1String("type")), QString(QLatin1String("baselayer"))));
+    metadata.push_back(qMakePair(QString(QLatin1String("version")), QString(QLatin1String("1.1"))));
+    metadata.push_back(qMakePair(QString(QLatin1String("format")), QString(QLatin1String("png"))));
+    metadata.push_back(qMakePair(QString(QLatin1String("minzoom")), QString::number(configuration.minZoom)));
+    metadata.push_back(qMakePair(QString(QLatin1String("maxzoom")), QString::number(configuration.maxZoom)));
+    metadata.push_back(qMakePair(QString(QLatin1String("bounds")), QString(QLatin1String("%1,%2,%3,%4"))
+        .arg(topLeft.longitude)
+        .arg(bottomRight.latitude)
+        .arg(bottomRight.longitude)
+        .arg(topLeft.latitude)));
+    QSqlQuery metadataQuery(_mbtilesDb);
+    metadataQuery.prepare("INSERT INTO metadata (name, value) VALUES ( ?, ? )");
+    for (const auto& entry : constOf(metadata))
+    {
+        metadataQuery.addBindValue(entry.first);
+        metadataQuery.addBindValue(entry.second);
+        if (!metadataQuery.exec())
+        {
+            LogPrintf(LogSeverityLevel::Error,
+                "Failed to write MBTiles '%s' metadata: %s",
+                qPrintable(configuration.outputPath),
+                qPrintable(metadataQuery.lastError().text()));
+            _mbtilesDb.close();
+            return false;
+        }
+    }
+
+    _pendingWritesCount = 0;
+    _mbtilesDb.transaction();
+
+    return true;
+}
+
+void OsmAnd::MapRasterTilesBatchRenderer_P::closeOutput()
+{
+    if (owner->configuration.outputFormat != MapRasterTilesBatchRenderer::OutputFormat::MBTiles)
+        return;
+
+    const auto connectionName = _mbtilesDb.connectionName();
+    if (_mbtilesDb.isOpen())
+    {
+        _mbtilesDb.commit();
+        _mbtilesDb.close();
+    }
+    _mbtilesDb = QSqlDatabase();
+    if (!connectionName.isEmpty())
+        QSqlDatabase::removeDatabase(connectionName);
+}
+
+bool OsmAnd::MapRasterTilesBatchRenderer_P::writeTileToDirectoryTree(const Job& job)
+{
+    const QDir tileDir(QString(QLatin1String("%1/%2/%3"))
+        .arg(owner->configuration.outputPath)
+        .arg(static_cast<int>(job.zoom))
+        .arg(job.tileId.x));
+    if (!tileDir.mkpath(QLatin1String(".")))
+        return false;
+
+    QFile tileFile(tileDir.absoluteFilePath(QString(QLatin1String("%1.png")).arg(job.tileId.y)));
+    if (!tileFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to open '%s' for writing",
+            qPrintable(tileFile.fileName()));
+        return false;
+    }
+    const auto ok = (tileFile.write(job.encodedData) == job.encodedData.size());
+    tileFile.close();
+
+    return ok;
+}
+
+void OsmAnd::MapRasterTilesBatchRenderer_P::accountStageWork(const Stage stage, const float busyTime)
+{
+    QMutexLocker scopedLocker(&_statisticsMutex);
+
+    auto& stageStatistics = _statistics.stages[static_cast<unsigned int>(stage)];
+    stageStatistics.processedTilesCount++;
+    stageStatistics.busyTime += busyTime;
+}
+
+OsmAnd::MapRasterTilesBatchRenderer_P::Statistics OsmAnd::MapRasterTilesBatchRenderer_P::captureStatistics() const
+{
+    Statistics statistics;
+    {
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        statistics = _statistics;
+    }
+
+    statistics.elapsedTime = _stopwatch.elapsed();
+    for (auto stageIdx = 0u; stageIdx < MapRasterTilesBatchRenderer::StagesCount; stageIdx++)
+    {
+        const auto& queue = _queues[stageIdx];
+        QMutexLocker scopedLocker(&queue.mutex);
+
+        statistics.stages[stageIdx].queueDepth = queue.jobs.size();
+        statistics.stages[stageIdx].maxQueueDepth = queue.maxDepth;
+    }
+
+    return statistics;
+}
+
+OsmAnd::MapRasterTilesBatchRenderer_P::Job::Job(const TileId tileId_, const ZoomLevel zoom_)
+    : tileId(tileId_)
+    , zoom(zoom_)
+{
+}
+
+OsmAnd::MapRasterTilesBatchRenderer_P::Job::~Job()
+{
+}
+
+OsmAnd::MapRasterTilesBatchRenderer_P::StageQueue::StageQueue()
+    : capacity(1)
+    , producersCount(0)
+    , maxDepth(0)
+{
+}
+
+OsmAnd::MapRasterTilesBatchRenderer_P::StageQueue::~StageQueue()
+{
+}
+
+void OsmAnd::MapRasterTilesBatchRenderer_P::StageQueue::push(const std::shared_ptr<Job>& job)
+{
+    QMutexLocker scopedLocker(&mutex);
+
+    while (static_cast<unsigned int>(jobs.size()) >= capacity)
+        REPEAT_UNTIL(notFullCondition.wait(&mutex));
+
+    jobs.enqueue(job);
+    maxDepth = qMax(maxDepth, static_cast<unsigned int>(jobs.size()));
+    notEmptyCondition.wakeOne();
+}
+
+std::shared_ptr<OsmAnd::MapRasterTilesBatchRenderer_P::Job> OsmAnd::MapRasterTilesBatchRenderer_P::StageQueue::pop()
+{
+    QMutexLocker scopedLocker(&mutex);
+
+    while (jobs.isEmpty())
+    {
+        if (producersCount == 0)
+            return nullptr;
+        REPEAT_UNTIL(notEmptyCondition.wait(&mutex));
+    }
+
+    const auto job = jobs.dequeue();
+    notFullCondition.wakeOne();
+    return job;
+}
+
+void OsmAnd::MapRasterTilesBatchRenderer_P::StageQueue::releaseProducer()
+{
+    QMutexLocker scopedLocker(&mutex);
+
+    assert(producersCount > 0);
+    producersCount--;
+    if (producersCount == 0)
+        notEmptyCondition.wakeAll();
+}
+
+unsigned int OsmAnd::MapRasterTilesBatchRenderer_P::StageQueue::depth() const
+{
+    QMutexLocker scopedLocker(&mutex);
+
+    return jobs.size();
+}
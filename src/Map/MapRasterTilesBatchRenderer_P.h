@@ -0,0 +1,118 @@
+#ifndef _OSMAND_CORE_MAP_RASTER_TILES_BATCH_RENDERER_P_H_
+#define _OSMAND_CORE_MAP_RASTER_TILES_BATCH_RENDERER_P_H_
+
+#include "stdlib_common.h"
+#include <array>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QByteArray>
+#include <QSqlDatabase>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+#include "PrivateImplementation.h"
+#include "Stopwatch.h"
+#include "IMapObjectsProvider.h"
+#include "MapPrimitiviser.h"
+#include "MapRasterTilesBatchRenderer.h"
+
+class SkBitmap;
+
+namespace OsmAnd
+{
+    class MapRasterizer;
+
+    class MapRasterTilesBatchRenderer_P Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(MapRasterTilesBatchRenderer_P);
+    public:
+        typedef MapRasterTilesBatchRenderer::Stage Stage;
+        typedef MapRasterTilesBatchRenderer::Statistics Statistics;
+        typedef MapRasterTilesBatchRenderer::StageStatistics StageStatistics;
+
+    private:
+        struct Job Q_DECL_FINAL
+        {
+            Job(const TileId tileId, const ZoomLevel zoom);
+            ~Job();
+
+            const TileId tileId;
+            const ZoomLevel zoom;
+
+            std::shared_ptr<IMapObjectsProvider::Data> mapObjects;
+            std::shared_ptr<const MapPrimitiviser::PrimitivisedObjects> primitivisedObjects;
+            std::shared_ptr<SkBitmap> bitmap;
+            QByteArray encodedData;
+        };
+
+        // Bounded queue in front of a stage: producers block while it's full, consumers block while it's empty.
+        // Once all producers are gone, queue gets closed and consumers drain it and exit.
+        struct StageQueue Q_DECL_FINAL
+        {
+            StageQueue();
+            ~StageQueue();
+
+            mutable QMutex mutex;
+            QWaitCondition notEmptyCondition;
+            QWaitCondition notFullCondition;
+            QQueue< std::shared_ptr<Job> > jobs;
+            unsigned int capacity;
+            unsigned int producersCount;
+            unsigned int maxDepth;
+
+            void push(const std::shared_ptr<Job>& job);
+            std::shared_ptr<Job> pop();
+            void releaseProducer();
+            unsigned int depth() const;
+        };
+
+        std::shared_ptr<MapRasterizer> _rasterizer;
+        std::array<StageQueue, MapRasterTilesBatchRenderer::StagesCount> _queues;
+
+        mutable QMutex _statisticsMutex;
+        Statistics _statistics;
+        Stopwatch _stopwatch;
+
+        QSqlDatabase _mbtilesDb;
+        bool _outputIsOpened;
+        unsigned int _pendingWritesCount;
+        bool openOutput();
+        void closeOutput();
+        bool writeTileToDirectoryTree(const Job& job);
+
+        void runStage(const Stage stage, const std::shared_ptr<const IQueryController>& queryController);
+        bool processJob(
+            const Stage stage,
+            const std::shared_ptr<Job>& job,
+            const std::shared_ptr<const IQueryController>& queryController);
+        bool fetch(const std::shared_ptr<Job>& job, const std::shared_ptr<const IQueryController>& queryController);
+        bool primitivise(const std::shared_ptr<Job>& job, const std::shared_ptr<const IQueryController>& queryController);
+        bool rasterize(const std::shared_ptr<Job>& job, const std::shared_ptr<const IQueryController>& queryController);
+        bool encode(const std::shared_ptr<Job>& job);
+        bool write(const std::shared_ptr<Job>& job);
+
+        void accountStageWork(const Stage stage, const float busyTime);
+        Statistics captureStatistics() const;
+    protected:
+        MapRasterTilesBatchRenderer_P(MapRasterTilesBatchRenderer* const owner);
+    public:
+        ~MapRasterTilesBatchRenderer_P();
+
+        ImplementationInterface<MapRasterTilesBatchRenderer> owner;
+
+        bool render(
+            const MapRasterTilesBatchRenderer::ProgressCallback progressCallback,
+            const float progressInterval,
+            const std::shared_ptr<const IQueryController>& queryController);
+        Statistics getStatistics() const;
+
+    friend class OsmAnd::MapRasterTilesBatchRenderer;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_MAP_RASTER_TILES_BATCH_RENDERER_P_H_)
@@ -1,6 +1,8 @@
 #include "MapRasterizer.h"
 #include "MapRasterizer_P.h"
 
+#include "MetricsRegistry.h"
+
 OsmAnd::MapRasterizer::MapRasterizer(const std::shared_ptr<const MapPresentationEnvironment>& mapPresentationEnvironment_)
     : _p(new MapRasterizer_P(this))
     , mapPresentationEnvironment(mapPresentationEnvironment_)
@@ -21,5 +23,8 @@ void OsmAnd::MapRasterizer::rasterize(
     MapRasterizer_Metrics::Metric_rasterize* const metric /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/ )
 {
+    static const auto rasterizeHistogram = MetricsRegistry::getDefault().obtainHistogram(QLatin1String("rasterize"));
+    const MetricsRegistry::ScopedTimer rasterizeTimer(MetricsRegistry::getDefault(), rasterizeHistogram);
+
     _p->rasterize(area31, primitivisedObjects, canvas, fillBackground, destinationArea, metric, queryController);
 }
@@ -16,6 +16,13 @@ void OsmAnd::MapRasterizer_Metrics::Metric_rasterize::reset()
     Metric::reset();
 }
 
+void OsmAnd::MapRasterizer_Metrics::Metric_rasterize::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__MapRasterizer_Metrics__Metric_rasterize__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
 QString OsmAnd::MapRasterizer_Metrics::Metric_rasterize::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
 {
     QString output;
@@ -25,6 +25,7 @@
 #include "QKeyValueIterator.h"
 #include "QCachingIterator.h"
 #include "Stopwatch.h"
+#include "Tracer.h"
 #include "Utilities.h"
 #include "Logging.h"
 
@@ -57,6 +58,7 @@ void OsmAnd::MapRasterizer_P::rasterize(
     MapRasterizer_Metrics::Metric_rasterize* const metric,
     const std::shared_ptr<const IQueryController>& queryController)
 {
+    OSMAND_TRACE_SPAN("MapRasterizer::rasterize");
     const Stopwatch totalStopwatch(metric != nullptr);
 
     const Context context(
@@ -1,6 +1,7 @@
 #include "MapRenderer.h"
 
 #include <cassert>
+#include <cmath>
 #include <algorithm>
 
 #include <OsmAndCore/QtExtensions.h>
@@ -20,6 +21,7 @@
 #include "Utilities.h"
 #include "Logging.h"
 #include "Stopwatch.h"
+#include "MetricsRegistry.h"
 #include "QKeyValueIterator.h"
 
 //#define OSMAND_LOG_MAP_SYMBOLS_REGISTRATION_LIFECYCLE 1
@@ -40,6 +42,10 @@ OsmAnd::MapRenderer::MapRenderer(
     , _currentConfiguration(baseConfiguration_->createCopy())
     , _currentConfigurationAsConst(_currentConfiguration)
     , _requestedConfiguration(baseConfiguration_->createCopy())
+    , _frameIntervalMeasured(false)
+    , _frameIntervalMean(0.0f)
+    , _frameIntervalVariance(0.0f)
+    , _publishedMapSymbolsVersion(0)
     , _suspendSymbolsUpdateCounter(0)
     , _gpuWorkerThreadId(nullptr)
     , _gpuWorkerThreadIsAlive(false)
@@ -53,6 +59,7 @@ OsmAnd::MapRenderer::MapRenderer(
     , currentState(_currentState)
     , publishedMapSymbolsByOrderLock(_publishedMapSymbolsByOrderLock)
     , publishedMapSymbolsByOrder(_publishedMapSymbolsByOrder)
+    , publishedMapSymbolsVersion(_publishedMapSymbolsVersion)
     , currentDebugSettings(_currentDebugSettingsAsConst)
     , gpuAPI(gpuAPI_)
 {
@@ -255,7 +262,11 @@ void OsmAnd::MapRenderer::processGpuWorker()
             const auto requestsToProcess = _resourcesGpuSyncRequestsCounter.fetchAndAddOrdered(0);
             unsigned int resourcesUploaded = 0u;
             unsigned int resourcesUnloaded = 0u;
-            _resources->syncResourcesInGPU(0, nullptr, &resourcesUploaded, &resourcesUnloaded);
+            _resources->syncResourcesInGPU(
+                MapRendererResourcesManager::UploadBudget(),
+                nullptr,
+                &resourcesUploaded,
+                &resourcesUnloaded);
             if (resourcesUploaded > 0 || resourcesUnloaded > 0)
                 invalidateFrame();
             unprocessedRequests = _resourcesGpuSyncRequestsCounter.fetchAndAddOrdered(-requestsToProcess) - requestsToProcess;
@@ -263,12 +274,20 @@ void OsmAnd::MapRenderer::processGpuWorker()
     }
     else if (isInRenderThread())
     {
-        // To reduce FPS drop, upload not more than 1 resource per frame.
+        // To reduce FPS drop, upload only as much per frame as fits into budget from setup options
         const auto requestsToProcess = _resourcesGpuSyncRequestsCounter.fetchAndAddOrdered(0);
         bool moreUploadThanLimitAvailable = false;
         unsigned int resourcesUploaded = 0u;
         unsigned int resourcesUnloaded = 0u;
-        _resources->syncResourcesInGPU(1u, &moreUploadThanLimitAvailable, &resourcesUploaded, &resourcesUnloaded);
+        const MapRendererResourcesManager::UploadBudget uploadBudget(
+            0u,
+            setupOptions.maxGpuUploadBytesPerFrame,
+            setupOptions.maxGpuUploadTimePerFrame / 1000.0f);
+        _resources->syncResourcesInGPU(
+            uploadBudget,
+            &moreUploadThanLimitAvailable,
+            &resourcesUploaded,
+            &resourcesUnloaded);
         const auto unprocessedRequests =
             _resourcesGpuSyncRequestsCounter.fetchAndAddOrdered(-requestsToProcess) - requestsToProcess;
 
@@ -578,9 +597,41 @@ bool OsmAnd::MapRenderer::postRenderFrame(IMapRenderer_Metrics::Metric_renderFra
     _frameInvalidatesCounter.fetchAndAddOrdered(-_frameInvalidatesToBeProcessed);
     _frameInvalidatesToBeProcessed = 0;
 
+    recordFrameInterval();
+
     return true;
 }
 
+void OsmAnd::MapRenderer::recordFrameInterval()
+{
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (!metricsRegistry.isEnabled())
+    {
+        _frameIntervalMeasured = false;
+        return;
+    }
+
+    if (!_frameIntervalMeasured)
+    {
+        _frameIntervalStopwatch.start();
+        _frameIntervalMeasured = true;
+        return;
+    }
+    const auto frameInterval = _frameIntervalStopwatch.elapsed();
+    _frameIntervalStopwatch.start();
+
+    // Exponentially weighted, so that stutter shows up as variance even though it's averaged over time
+    const auto SmoothingFactor = 0.05f;
+    const auto delta = frameInterval - _frameIntervalMean;
+    _frameIntervalMean += SmoothingFactor * delta;
+    _frameIntervalVariance = (1.0f - SmoothingFactor) * (_frameIntervalVariance + SmoothingFactor * delta * delta);
+
+    static const auto frameIntervalHistogram = metricsRegistry.obtainHistogram(QLatin1String("map_frame_interval"));
+    static const auto frameIntervalStddevGauge = metricsRegistry.obtainGauge(QLatin1String("map_frame_interval_stddev"));
+    frameIntervalHistogram->record(frameInterval);
+    frameIntervalStddevGauge->set(std::sqrt(_frameIntervalVariance));
+}
+
 bool OsmAnd::MapRenderer::releaseRendering(const bool gpuContextLost /*= false*/)
 {
     assert(_renderThreadId == QThread::currentThreadId());
@@ -789,11 +840,16 @@ bool OsmAnd::MapRenderer::adjustBitmapToConfiguration(
         (currentConfiguration->limitTextureColorDepthBy16bits && input->colorType() == SkColorType::kRGBA_8888_SkColorType);
     const bool canUsePaletteTextures = currentConfiguration->paletteTexturesAllowed && gpuAPI->isSupported_8bitPaletteRGBA8;
     const bool paletteTexture = (input->colorType() == SkColorType::kIndex_8_SkColorType);
-    const bool unsupportedFormat =
-        (canUsePaletteTextures ? !paletteTexture : paletteTexture) ||
-        (input->colorType() != SkColorType::kRGBA_8888_SkColorType) ||
-        (input->colorType() != SkColorType::kARGB_4444_SkColorType) ||
-        (input->colorType() != SkColorType::kRGB_565_SkColorType);
+    const bool unsupportedFormat = paletteTexture
+        ? !canUsePaletteTextures
+        : ((input->colorType() != SkColorType::kRGBA_8888_SkColorType) &&
+            (input->colorType() != SkColorType::kARGB_4444_SkColorType) &&
+            (input->colorType() != SkColorType::kRGB_565_SkColorType));
+    // Padded rows can't be uploaded at once without unpack-row-length support, so make them tight here,
+    // on worker thread, instead of uploading row-by-row on GPU thread. With such support, GPU skips padding itself.
+    const bool paddedRows = !paletteTexture &&
+        !gpuAPI->isSupported_unpackRowLength &&
+        (input->rowBytes() != input->info().minRowBytes());
     doConvert = doConvert || force16bit;
     doConvert = doConvert || unsupportedFormat;
 
@@ -850,6 +906,22 @@ bool OsmAnd::MapRenderer::adjustBitmapToConfiguration(
         return true;
     }
 
+    // Copy of supported format keeps color type, but is tightly packed
+    if (paddedRows)
+    {
+        auto convertedBitmap = new SkBitmap();
+
+        const bool ok = input->copyTo(convertedBitmap, input->colorType());
+        if (!ok)
+        {
+            assert(false);
+            return false;
+        }
+
+        output.reset(convertedBitmap);
+        return true;
+    }
+
     return false;
 }
 
@@ -902,6 +974,7 @@ void OsmAnd::MapRenderer::doPublishMapSymbol(
     symbolReferencedResources.insert(resource);
 
     _publishedMapSymbolsGroups[symbolGroup] += 1;
+    _publishedMapSymbolsVersion++;
 
 #if OSMAND_LOG_MAP_SYMBOLS_REGISTRATION_LIFECYCLE
     LogPrintf(LogSeverityLevel::Debug,
@@ -991,6 +1064,8 @@ void OsmAnd::MapRenderer::doUnpublishMapSymbol(
     if (publishedMapSymbolsByGroup.size() == 0)
         _publishedMapSymbolsByOrder.erase(itPublishedMapSymbolsByGroup);
 
+    _publishedMapSymbolsVersion++;
+
     const auto itGroupRefsCounter = _publishedMapSymbolsGroups.find(symbolGroup);
     auto& groupRefsCounter = *itGroupRefsCounter;
     groupRefsCounter -= 1;
@@ -1606,6 +1681,11 @@ bool OsmAnd::MapRenderer::setStubsStyle(const MapStubStyle style, bool forcedUpd
     return true;
 }
 
+void OsmAnd::MapRenderer::setPrefetchHint(const MapPrefetchHint& hint)
+{
+    _resources->updatePrefetchHint(hint);
+}
+
 OsmAnd::ZoomLevel OsmAnd::MapRenderer::getMinZoomLevel() const
 {
     return MinZoomLevel;
@@ -19,6 +19,7 @@
 #include "MapRendererTypes_private.h"
 #include "Thread.h"
 #include "Dispatcher.h"
+#include "Stopwatch.h"
 #include "IMapRenderer.h"
 #include "GPUAPI.h"
 #include "IMapTiledDataProvider.h"
@@ -64,6 +65,13 @@ namespace OsmAnd
         // State-related:
         mutable QAtomicInt _frameInvalidatesCounter;
         int _frameInvalidatesToBeProcessed;
+
+        // Frame pacing: time between consecutive rendered frames and its smoothed mean and variance
+        Stopwatch _frameIntervalStopwatch;
+        bool _frameIntervalMeasured;
+        float _frameIntervalMean;
+        float _frameIntervalVariance;
+        void recordFrameInterval();
         mutable QMutex _requestedStateMutex;
         MapRendererState _requestedState;
         MapRendererState _currentState;
@@ -79,6 +87,8 @@ namespace OsmAnd
         PublishedMapSymbolsByOrder _publishedMapSymbolsByOrder;
         QHash< std::shared_ptr<const MapSymbolsGroup>, SmartPOD<unsigned int, 0> > _publishedMapSymbolsGroups;
         QAtomicInt _publishedMapSymbolsCount;
+        // Changed on each publish or unpublish, guarded by _publishedMapSymbolsByOrderLock
+        unsigned int _publishedMapSymbolsVersion;
         void doPublishMapSymbol(
             const std::shared_ptr<const MapSymbolsGroup>& symbolGroup,
             const std::shared_ptr<const MapSymbol>& symbol,
@@ -174,6 +184,7 @@ namespace OsmAnd
         // Symbols-related:
         QReadWriteLock& publishedMapSymbolsByOrderLock;
         const PublishedMapSymbolsByOrder& publishedMapSymbolsByOrder;
+        const unsigned int& publishedMapSymbolsVersion;
         void publishMapSymbol(
             const std::shared_ptr<const MapSymbolsGroup>& symbolGroup,
             const std::shared_ptr<const MapSymbol>& symbol,
@@ -278,6 +289,8 @@ namespace OsmAnd
 
         virtual bool setStubsStyle(const MapStubStyle style, bool forcedUpdate = false);
 
+        virtual void setPrefetchHint(const MapPrefetchHint& hint);
+
         virtual ZoomLevel getMinZoomLevel() const;
         virtual ZoomLevel getMaxZoomLevel() const;
 
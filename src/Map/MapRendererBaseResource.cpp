@@ -1,9 +1,18 @@
 #include "MapRendererBaseResource.h"
 
+#include "ignore_warnings_on_external_includes.h"
+#include <SkBitmap.h>
+#include "restore_internal_warnings.h"
+
+#include "MapSymbol.h"
+#include "RasterMapSymbol.h"
+#include "VectorMapSymbol.h"
+
 OsmAnd::MapRendererBaseResource::MapRendererBaseResource(
     MapRendererResourcesManager* const owner_,
     const MapRendererResourceType type_)
     : _isJunk(false)
+    , _gpuUploadSize(0)
     , resourcesManager(owner_)
     , type(type_)
     , isJunk(_isJunk)
@@ -19,6 +28,29 @@ void OsmAnd::MapRendererBaseResource::markAsJunk()
     _isJunk = true;
 }
 
+size_t OsmAnd::MapRendererBaseResource::getGpuUploadSize() const
+{
+    return _gpuUploadSize;
+}
+
+size_t OsmAnd::MapRendererBaseResource::estimateGpuUploadSize(const std::shared_ptr<const MapSymbol>& symbol)
+{
+    if (const auto rasterMapSymbol = std::dynamic_pointer_cast<const RasterMapSymbol>(symbol))
+        return rasterMapSymbol->bitmap ? rasterMapSymbol->bitmap->getSize() : 0;
+
+    if (const auto vectorMapSymbol = std::dynamic_pointer_cast<const VectorMapSymbol>(symbol))
+    {
+        const auto verticesAndIndexes = vectorMapSymbol->getVerticesAndIndexes();
+        if (!verticesAndIndexes)
+            return 0;
+
+        return verticesAndIndexes->verticesCount * sizeof(VectorMapSymbol::Vertex) +
+            verticesAndIndexes->indicesCount * sizeof(VectorMapSymbol::Index);
+    }
+
+    return 0;
+}
+
 bool OsmAnd::MapRendererBaseResource::updatesPresent()
 {
     return false;
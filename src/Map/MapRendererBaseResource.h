@@ -16,6 +16,7 @@
 namespace OsmAnd
 {
     class MapRendererResourcesManager;
+    class MapSymbol;
 
     class MapRendererBaseResource : public std::enable_shared_from_this<MapRendererBaseResource>
     {
@@ -35,7 +36,12 @@ namespace OsmAnd
 
         std::shared_ptr<const IMapDataProvider::RetainableCacheMetadata> _retainableCacheMetadata;
 
-        void markAsJunk();
+        // Approximate size of data that uploadToGPU() passes to GPU. It's estimated on worker thread along with
+        // obtaining data, so that uploads could be budgeted without touching the data.
+        size_t _gpuUploadSize;
+        static size_t estimateGpuUploadSize(const std::shared_ptr<const MapSymbol>& symbol);
+
+        virtual void markAsJunk();
 
         virtual bool updatesPresent();
         virtual bool checkForUpdatesAndApply(const MapState& mapState);
@@ -68,6 +74,8 @@ namespace OsmAnd
 
         const bool& isJunk;
 
+        size_t getGpuUploadSize() const;
+
         virtual bool isRenewing();
 
         virtual MapRendererResourceState getState() const = 0;
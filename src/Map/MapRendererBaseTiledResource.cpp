@@ -52,6 +52,14 @@ void OsmAnd::MapRendererBaseTiledResource::removeSelfFromCollection()
         link_->collection.removeEntry(tileId, zoom);
 }
 
+void OsmAnd::MapRendererBaseTiledResource::markAsJunk()
+{
+    MapRendererBaseResource::markAsJunk();
+
+    // Junk resource is no longer usable, so collection index has to know about it
+    BaseTilesCollectionEntryWithState::onEntryModified();
+}
+
 void OsmAnd::MapRendererBaseTiledResource::detach()
 {
     releaseData();
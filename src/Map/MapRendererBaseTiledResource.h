@@ -34,6 +34,7 @@ namespace OsmAnd
         virtual void detach();
 
         virtual void removeSelfFromCollection();
+        virtual void markAsJunk();
     public:
         virtual ~MapRendererBaseTiledResource();
 
@@ -66,7 +66,10 @@ bool OsmAnd::MapRendererElevationDataResource::obtainData(
 
     // Store data
     if (dataAvailable)
+    {
         _sourceData = std::static_pointer_cast<IMapElevationDataProvider::Data>(tile);
+        _gpuUploadSize = _sourceData->size * _sourceData->rowLength;
+    }
 
     return true;
 }
@@ -107,7 +110,10 @@ void OsmAnd::MapRendererElevationDataResource::obtainDataAsync(
 
             // Store data
             if (dataAvailable)
+            {
                 _sourceData = std::static_pointer_cast<IMapElevationDataProvider::Data>(data);
+                _gpuUploadSize = _sourceData->size * _sourceData->rowLength;
+            }
 
             callback(requestSucceeded, dataAvailable);
         });
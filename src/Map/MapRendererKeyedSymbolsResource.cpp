@@ -144,8 +144,11 @@ bool OsmAnd::MapRendererKeyedSymbolsResource::obtainData(
     const auto self = shared_from_this();
     QList< PublishOrUnpublishMapSymbol > mapSymbolsToPublish;
     mapSymbolsToPublish.reserve(_mapSymbolsGroup->symbols.size());
+    _gpuUploadSize = 0;
     for (const auto& symbol : constOf(_mapSymbolsGroup->symbols))
     {
+        _gpuUploadSize += estimateGpuUploadSize(symbol);
+
         PublishOrUnpublishMapSymbol mapSymbolToPublish = {
             _mapSymbolsGroup,
             std::static_pointer_cast<const MapSymbol>(symbol),
@@ -74,6 +74,7 @@ bool OsmAnd::MapRendererRasterMapLayerResource::obtainData(
         _sourceData->bitmap = resourcesManager->adjustBitmapToConfiguration(
             _sourceData->bitmap,
             _sourceData->alphaChannelPresence);
+        _gpuUploadSize = _sourceData->bitmap->getSize();
     }
 
     return true;
@@ -123,6 +124,7 @@ void OsmAnd::MapRendererRasterMapLayerResource::obtainDataAsync(
                 _sourceData->bitmap = resourcesManager->adjustBitmapToConfiguration(
                     _sourceData->bitmap,
                     _sourceData->alphaChannelPresence);
+                _gpuUploadSize = _sourceData->bitmap->getSize();
             }
 
             callback(requestSucceeded, dataAvailable);
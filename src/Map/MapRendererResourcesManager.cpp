@@ -1,6 +1,7 @@
 #include "MapRendererResourcesManager.h"
 
 #include <cassert>
+#include <cmath>
 
 #include "QtCommon.h"
 
@@ -29,6 +30,8 @@
 #include "QConditionalWriteLocker.h"
 #include "QConditionalMutexLocker.h"
 #include "Utilities.h"
+#include "Tracer.h"
+#include "MetricsRegistry.h"
 #include "Logging.h"
 
 //#define OSMAND_LOG_RESOURCE_STATE_CHANGE 1
@@ -61,9 +64,14 @@
 #   define LOG_RESOURCE_STATE_CHANGE(resource, oldState, newState)
 #endif
 
+const float OsmAnd::MapRendererResourcesManager::PrefetchMaxLookahead = 1.5f;
+const float OsmAnd::MapRendererResourcesManager::PrefetchDirectionChangeCosine = 0.866f; // ~30 degrees
+const int64_t OsmAnd::MapRendererResourcesManager::PrefetchPriority = std::numeric_limits<int64_t>::min() / 2;
+
 OsmAnd::MapRendererResourcesManager::MapRendererResourcesManager(MapRenderer* const owner_)
     : _taskHostBridge(this)
     , _resourcesRequestWorkerPool(Concurrent::WorkerPool::Order::LIFO)
+    , _completeFrameAfterMotionAwaited(false)
     , _workerThreadIsAlive(false)
     , _workerThreadId(nullptr)
     , _workerThread(new Concurrent::Thread(std::bind(&MapRendererResourcesManager::workerThreadProcedure, this)))
@@ -416,10 +424,16 @@ void OsmAnd::MapRendererResourcesManager::updateActiveZone(
     const ZoomLevel zoom)
 {
     // Check if update needed
+    const auto activeZoneChanged =
+        (_centerTileId != centerTileId) ||
+        (_activeZoom != zoom) ||
+        (_activeTiles != tiles);
     bool update = true; //NOTE: So far this won't work, since resources won't be updated
-    update = update || (_centerTileId != centerTileId);
-    update = update || (_activeZoom != zoom);
-    update = update || (_activeTiles != tiles);
+    update = update || activeZoneChanged;
+
+    // Requests that are still queued are reordered right away, without waiting for worker to wake up
+    if (activeZoneChanged)
+        refreshResourceRequestsPriorities(centerTileId, tiles, zoom);
 
     if (update)
     {
@@ -436,6 +450,28 @@ void OsmAnd::MapRendererResourcesManager::updateActiveZone(
     }
 }
 
+void OsmAnd::MapRendererResourcesManager::updatePrefetchHint(const MapPrefetchHint& hint)
+{
+    QMutexLocker scopedLocker(&_workerThreadWakeupMutex);
+
+    const auto motionStarted = !_prefetchHint.isValid() && hint.isValid();
+    const auto motionEnded = _prefetchHint.isValid() && !hint.isValid();
+    _prefetchHint = hint;
+
+    // Time to complete frame is measured from the moment map came to rest
+    if (motionStarted)
+        _completeFrameAfterMotionAwaited = false;
+    if (motionEnded)
+    {
+        _motionEndStopwatch.start();
+        _completeFrameAfterMotionAwaited = true;
+    }
+
+    // Other hints are picked up by worker along with active zone, that changes as well while map moves
+    if (motionStarted || motionEnded)
+        _workerThreadWakeup.wakeAll();
+}
+
 void OsmAnd::MapRendererResourcesManager::setResourceWorkerThreadsLimit(const unsigned int limit)
 {
     _resourcesRequestWorkerPool.setMaxThreadCount(limit);
@@ -605,6 +641,7 @@ void OsmAnd::MapRendererResourcesManager::workerThreadProcedure()
         TileId centerTileId;
         QVector<TileId> activeTiles;
         ZoomLevel activeZoom;
+        MapPrefetchHint prefetchHint;
 
         // Wait until we're unblocked by host
         {
@@ -615,12 +652,13 @@ void OsmAnd::MapRendererResourcesManager::workerThreadProcedure()
             centerTileId = _centerTileId;
             activeTiles = _activeTiles;
             activeZoom = _activeZoom;
+            prefetchHint = _prefetchHint;
         }
         if (!_workerThreadIsAlive)
             break;
 
         // Update resources
-        updateResources(centerTileId, activeTiles, activeZoom);
+        updateResources(centerTileId, activeTiles, activeZoom, prefetchHint);
     }
 
     _workerThreadId = nullptr;
@@ -641,19 +679,117 @@ void OsmAnd::MapRendererResourcesManager::requestNeededResources(
         requestNeededResources(resourcesCollection, activeTiles, activeZoom);
     }
 
-    _resourcesRequestWorkerPool.enqueue(
-        _requestedResourcesTasks,
-        [centerTileId, activeTiles, activeZoom]
-        (QRunnable* const l_, QRunnable* const r_) -> bool
+    // Priority of each task is calculated once here, and later refreshed only when active zone changes
+    for (const auto& task : constOf(_requestedResourcesTasks))
+    {
+        const auto requestTask = static_cast<ResourceRequestTask*>(task);
+        enqueueResourceRequest(
+            requestTask,
+            requestTask->calculatePriority(centerTileId, activeTiles, activeZoom),
+            false);
+    }
+
+    // Prefetch is requested last, so that its tasks are queued behind all tasks of active zone
+    requestPrefetchedResources(resourcesCollections);
+}
+
+void OsmAnd::MapRendererResourcesManager::enqueueResourceRequest(
+    ResourceRequestTask* const task,
+    const int64_t priority,
+    const bool isPrefetch)
+{
+    // Only tiled requests are reordered, keyed ones always stay at minimal priority
+    if (task->isTiledRequest)
+    {
+        const std::shared_ptr<ResourceRequest> resourceRequest(new ResourceRequest());
+        resourceRequest->task = task;
+        resourceRequest->type = task->requestedResource->type;
+        resourceRequest->isPrefetch = isPrefetch;
+        resourceRequest->priority = priority;
+
+        // Entry is registered before enqueueing, since task may be executed and destroyed right away. Task is
+        // enqueued while table is still locked, otherwise priority refresh in between would be lost for it.
+        QMutexLocker scopedLocker(&_resourceRequestsMutex);
+        _resourceRequests.insert(task->requestKey, resourceRequest);
+        _resourcesRequestWorkerPool.enqueue(task, priority, task->getAffinity());
+        return;
+    }
+
+    _resourcesRequestWorkerPool.enqueue(task, priority, task->getAffinity());
+}
+
+void OsmAnd::MapRendererResourcesManager::forgetResourceRequest(const ResourceRequestTask* const task)
+{
+    if (!task->isTiledRequest)
+        return;
+
+    QMutexLocker scopedLocker(&_resourceRequestsMutex);
+
+    // Same tile may have been requested again by another task
+    const auto citResourceRequest = _resourceRequests.constFind(task->requestKey);
+    if (citResourceRequest != _resourceRequests.cend() && (*citResourceRequest)->task == task)
+        _resourceRequests.erase(citResourceRequest);
+}
+
+void OsmAnd::MapRendererResourcesManager::refreshResourceRequestsPriorities(
+    const TileId centerTileId,
+    const QVector<TileId>& activeTiles,
+    const ZoomLevel activeZoom)
+{
+    QMutexLocker scopedLocker(&_resourceRequestsMutex);
+
+    if (_resourceRequests.isEmpty())
+        return;
+
+    QSet<TileId> activeTilesSet;
+    for (const auto& activeTileId : constOf(activeTiles))
+        activeTilesSet.insert(activeTileId);
+
+    for (auto itResourceRequest = _resourceRequests.cbegin(); itResourceRequest != _resourceRequests.cend(); ++itResourceRequest)
+    {
+        const auto& requestKey = itResourceRequest.key();
+        const auto& resourceRequest = *itResourceRequest;
+
+        // Prefetched tiles keep order of prefetch plan until they become active
+        if (resourceRequest->isPrefetch)
         {
-            const auto l = static_cast<ResourceRequestTask*>(l_);
-            const auto r = static_cast<ResourceRequestTask*>(r_);
+            if (requestKey.zoom != activeZoom || !activeTilesSet.contains(requestKey.tileId))
+                continue;
+            resourceRequest->isPrefetch = false;
+        }
 
-            const auto lPriority = l->calculatePriority(centerTileId, activeTiles, activeZoom);
-            const auto rPriority = r->calculatePriority(centerTileId, activeTiles, activeZoom);
+        const auto priority = calculateTiledResourcePriority(
+            resourceRequest->type,
+            requestKey.tileId,
+            requestKey.zoom,
+            centerTileId,
+            activeZoom);
+        if (resourceRequest->priority.exchange(priority) != priority)
+            _resourcesRequestWorkerPool.updatePriority(resourceRequest->task, priority);
+    }
+}
 
-            return lPriority < rPriority;
-        });
+void OsmAnd::MapRendererResourcesManager::recordResourceRequestWork(const float processingTime, const bool wasWasted)
+{
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (!metricsRegistry.isEnabled())
+        return;
+
+    static const auto processingCounter =
+        metricsRegistry.obtainCounter(QLatin1String("map_resource_requests_processing_us_total"));
+    static const auto wastedCounter =
+        metricsRegistry.obtainCounter(QLatin1String("map_resource_requests_wasted_us_total"));
+    static const auto wastedRatioGauge =
+        metricsRegistry.obtainGauge(QLatin1String("map_resource_requests_wasted_ratio"));
+
+    const auto processingTimeUs = static_cast<uint64_t>(processingTime * 1000000.0f);
+    processingCounter->add(processingTimeUs);
+    if (wasWasted)
+        wastedCounter->add(processingTimeUs);
+
+    const auto totalProcessingTimeUs = processingCounter->getValue();
+    if (totalProcessingTimeUs > 0)
+        wastedRatioGauge->set(static_cast<double>(wastedCounter->getValue()) / totalProcessingTimeUs);
 }
 
 void OsmAnd::MapRendererResourcesManager::requestNeededResources(
@@ -694,14 +830,7 @@ void OsmAnd::MapRendererResourcesManager::requestNeededTiledResources(
             const TileId tileId,
             const ZoomLevel zoom) -> MapRendererBaseTiledResource*
         {
-            if (resourceType == MapRendererResourceType::MapLayer)
-                return new MapRendererRasterMapLayerResource(this, collection, tileId, zoom);
-            else if (resourceType == MapRendererResourceType::ElevationData)
-                return new MapRendererElevationDataResource(this, collection, tileId, zoom);
-            else if (resourceType == MapRendererResourceType::Symbols)
-                return new MapRendererTiledSymbolsResource(this, collection, tileId, zoom);
-            else
-                return nullptr;
+            return allocateTiledResource(resourceType, collection, tileId, zoom);
         };
 
     // Request all tiles on active zoom
@@ -720,37 +849,16 @@ void OsmAnd::MapRendererResourcesManager::requestNeededTiledResources(
     {
         const auto debugSettings = renderer->getDebugSettings();
 
-        const auto isNotUnavailableResource =
-            []
-            (const std::shared_ptr<MapRendererBaseTiledResource>& entry) -> bool
-            {
-                // Resources marked as junk are not unavailable
-                if (entry->isJunk)
-                    return true;
-
-                const auto state = entry->getState();
-                return state != MapRendererResourceState::Unavailable;
-            };
-        const auto isUsableResource =
-            []
-            (const std::shared_ptr<MapRendererBaseTiledResource>& entry) -> bool
-            {
-                // Resources marked as junk are not usable
-                if (entry->isJunk)
-                    return false;
-
-                // Only resources in GPU are usable
-                const auto state = entry->getState();
-                return state == MapRendererResourceState::Uploaded;
-            };
+        // Coverage is checked against collection index, so that no resource is looked up for that
+        const auto& index = resourcesCollection->index;
 
         for (const auto& activeTileId : constOf(activeTiles))
         {
-            // If this tile on current zoom level is not unavailable, skip this tile
-            if (resourcesCollection->containsResource(
-                activeTileId,
-                activeZoom,
-                isNotUnavailableResource))
+            // If this tile on current zoom level is not unavailable, skip this tile. Resources marked as junk
+            // are not unavailable.
+            const auto activeTileFlags = index.getFlags(activeTileId, activeZoom);
+            if ((activeTileFlags & MapRendererTiledResourcesCollection::PresentIndexFlag) &&
+                !(activeTileFlags & MapRendererTiledResourcesCollection::UnavailableIndexFlag))
             {
                 continue;
             }
@@ -767,28 +875,11 @@ void OsmAnd::MapRendererResourcesManager::requestNeededTiledResources(
                     if (underscaledZoom <= static_cast<int>(MaxZoomLevel) &&
                         absZoomShift <= MapRenderer::MaxMissingDataZoomShift)
                     {
-                        const auto underscaledTileIdsN = Utilities::getTileIdsUnderscaledByZoomShift(
+                        if (index.isCoveredByDescendants(
                             activeTileId,
-                            absZoomShift);
-
-                        bool allUnderscaledPresent = true;
-                        const auto tilesCount = underscaledTileIdsN.size();
-                        auto pUnderscaledTileIdN = underscaledTileIdsN.constData();
-                        for (auto tileIdx = 0; tileIdx < tilesCount; tileIdx++)
-                        {
-                            const auto& underscaledTileId = *(pUnderscaledTileIdN++);
-
-                            const auto underscaledTilePresent = resourcesCollection->containsResource(
-                                underscaledTileId,
-                                static_cast<ZoomLevel>(underscaledZoom),
-                                isUsableResource);
-                            if (!underscaledTilePresent)
-                            {
-                                allUnderscaledPresent = false;
-                                break;
-                            }
-                        }
-                        if (allUnderscaledPresent)
+                            activeZoom,
+                            absZoomShift,
+                            MapRendererTiledResourcesCollection::UsableIndexFlag))
                         {
                             atLeastOneScaledTileUsable = true;
                             break;
@@ -806,10 +897,10 @@ void OsmAnd::MapRendererResourcesManager::requestNeededTiledResources(
                         const auto overscaledTileId = Utilities::getTileIdOverscaledByZoomShift(
                             activeTileId,
                             absZoomShift);
-                        if (resourcesCollection->containsResource(
+                        if (index.hasFlags(
                             overscaledTileId,
                             static_cast<ZoomLevel>(overscaleZoom),
-                            isUsableResource))
+                            MapRendererTiledResourcesCollection::UsableIndexFlag))
                         {
                             atLeastOneScaledTileUsable = true;
                             break;
@@ -841,9 +932,10 @@ void OsmAnd::MapRendererResourcesManager::requestNeededTiledResources(
                         {
                             const auto& underscaledTileId = *(pUnderscaledTileIdN++);
 
-                            const auto underscaledTilePresent = resourcesCollection->containsResource(
+                            const auto underscaledTilePresent = index.hasFlags(
                                 underscaledTileId,
-                                static_cast<ZoomLevel>(underscaledZoom));
+                                static_cast<ZoomLevel>(underscaledZoom),
+                                MapRendererTiledResourcesCollection::PresentIndexFlag);
                             if (!underscaledTilePresent)
                             {
                                 std::shared_ptr<MapRendererBaseTiledResource> resource;
@@ -868,9 +960,10 @@ void OsmAnd::MapRendererResourcesManager::requestNeededTiledResources(
                         const auto overscaledTileId = Utilities::getTileIdOverscaledByZoomShift(
                             activeTileId,
                             absZoomShift);
-                        if (!resourcesCollection->containsResource(
+                        if (!index.hasFlags(
                             overscaledTileId,
-                            static_cast<ZoomLevel>(overscaleZoom)))
+                            static_cast<ZoomLevel>(overscaleZoom),
+                            MapRendererTiledResourcesCollection::PresentIndexFlag))
                         {
                             std::shared_ptr<MapRendererBaseTiledResource> resource;
                             resourcesCollection->obtainOrAllocateEntry(
@@ -887,6 +980,22 @@ void OsmAnd::MapRendererResourcesManager::requestNeededTiledResources(
     }
 }
 
+OsmAnd::MapRendererBaseTiledResource* OsmAnd::MapRendererResourcesManager::allocateTiledResource(
+    const MapRendererResourceType type,
+    const TiledEntriesCollection<MapRendererBaseTiledResource>& collection,
+    const TileId tileId,
+    const ZoomLevel zoom)
+{
+    if (type == MapRendererResourceType::MapLayer)
+        return new MapRendererRasterMapLayerResource(this, collection, tileId, zoom);
+    else if (type == MapRendererResourceType::ElevationData)
+        return new MapRendererElevationDataResource(this, collection, tileId, zoom);
+    else if (type == MapRendererResourceType::Symbols)
+        return new MapRendererTiledSymbolsResource(this, collection, tileId, zoom);
+    else
+        return nullptr;
+}
+
 void OsmAnd::MapRendererResourcesManager::requestNeededKeyedResources(
     const std::shared_ptr<MapRendererKeyedResourcesCollection>& resourcesCollection)
 {
@@ -922,6 +1031,308 @@ void OsmAnd::MapRendererResourcesManager::requestNeededKeyedResources(
     }
 }
 
+void OsmAnd::MapRendererResourcesManager::requestPrefetchedResources(
+    const QList< std::shared_ptr<MapRendererBaseResourcesCollection> >& resourcesCollections)
+{
+    // Prefetched tiles that become active are raised to priority of active zone by refreshResourceRequestsPriorities()
+    if (_prefetchPlan.tiles.isEmpty())
+        return;
+
+    // Only map layers and elevation data are prefetched, since symbols are not updated while map moves anyways
+    QList< std::shared_ptr<MapRendererTiledResourcesCollection> > tiledResourcesCollections;
+    for (const auto& resourcesCollection : constOf(resourcesCollections))
+    {
+        if (!resourcesCollection)
+            continue;
+        if (resourcesCollection->type != MapRendererResourceType::MapLayer &&
+            resourcesCollection->type != MapRendererResourceType::ElevationData)
+        {
+            continue;
+        }
+
+        std::shared_ptr<IMapDataProvider> provider;
+        if (!obtainProviderFor(resourcesCollection.get(), provider))
+            continue;
+
+        if (const auto tiledResourcesCollection =
+                std::dynamic_pointer_cast<MapRendererTiledResourcesCollection>(resourcesCollection))
+        {
+            tiledResourcesCollections.push_back(tiledResourcesCollection);
+        }
+    }
+    if (tiledResourcesCollections.isEmpty())
+        return;
+
+    _requestedResourcesTasks.resize(0);
+    for (const auto& prefetchTile : constOf(_prefetchPlan.tiles))
+    {
+        for (const auto& tiledResourcesCollection : constOf(tiledResourcesCollections))
+        {
+            const auto resourceType = tiledResourcesCollection->type;
+            std::shared_ptr<MapRendererBaseTiledResource> resource;
+            tiledResourcesCollection->obtainOrAllocateEntry(
+                resource,
+                prefetchTile.tileId,
+                prefetchTile.zoom,
+                [this, resourceType]
+                (const TiledEntriesCollection<MapRendererBaseTiledResource>& collection,
+                    const TileId tileId,
+                    const ZoomLevel zoom) -> MapRendererBaseTiledResource*
+                {
+                    return allocateTiledResource(resourceType, collection, tileId, zoom);
+                });
+            requestNeededResource(resource);
+        }
+    }
+
+    // Tasks are queued in order of plan, which is sorted by time when tiles are expected to become active
+    auto priority = PrefetchPriority;
+    for (const auto& task : constOf(_requestedResourcesTasks))
+        enqueueResourceRequest(static_cast<ResourceRequestTask*>(task), priority--, true);
+    _requestedResourcesTasks.resize(0);
+}
+
+void OsmAnd::MapRendererResourcesManager::updatePrefetchPlan(
+    const MapPrefetchHint& hint,
+    const TileId centerTileId,
+    const QVector<TileId>& activeTiles,
+    const ZoomLevel activeZoom)
+{
+    if (!hint.isValid() || activeTiles.isEmpty())
+    {
+        if (_prefetchPlan.hint.isValid())
+            _prefetchPlan = PrefetchPlan();
+        return;
+    }
+
+    // While map keeps moving the same way, plan is kept as is. Otherwise resources requested for it would be
+    // cancelled and requested again on every frame.
+    if (_prefetchPlan.hint.isValid() && !isPrefetchPlanStale(hint, centerTileId, activeZoom))
+        return;
+
+    const auto normalizeTileId =
+        []
+        (const int64_t x, const int64_t y, const ZoomLevel zoom, TileId& outTileId) -> bool
+        {
+            const auto tilesCount = static_cast<int64_t>(1u << zoom);
+            if (y < 0 || y >= tilesCount)
+                return false;
+
+            outTileId = TileId::fromXY(
+                static_cast<int32_t>(((x % tilesCount) + tilesCount) % tilesCount),
+                static_cast<int32_t>(y));
+            return true;
+        };
+
+    // Footprint of active zone relative to its center is reused both along the path and at destination
+    const auto halfTilesCount = static_cast<int32_t>(1u << activeZoom) / 2;
+    QSet<TileId> activeTilesSet;
+    QVector<PointI> footprint;
+    footprint.reserve(activeTiles.size());
+    for (const auto& activeTileId : constOf(activeTiles))
+    {
+        activeTilesSet.insert(activeTileId);
+
+        PointI offset(activeTileId.x - centerTileId.x, activeTileId.y - centerTileId.y);
+        if (offset.x > halfTilesCount)
+            offset.x -= 2 * halfTilesCount;
+        else if (offset.x < -halfTilesCount)
+            offset.x += 2 * halfTilesCount;
+        footprint.push_back(offset);
+    }
+
+    PrefetchPlan plan;
+    plan.hint = hint;
+    plan.centerTileId = centerTileId;
+    plan.activeZoom = activeZoom;
+
+    // Path: footprint is shifted along current velocity, and only tiles that are not active yet are taken
+    const auto tileSize31 = static_cast<double>(1u << (ZoomLevel31 - activeZoom));
+    const PointD velocityInTiles(hint.targetVelocity31.x / tileSize31, hint.targetVelocity31.y / tileSize31);
+    const auto speedInTiles = qSqrt(velocityInTiles.x*velocityInTiles.x + velocityInTiles.y*velocityInTiles.y);
+    const auto lookahead = qMin(hint.timeLeft, PrefetchMaxLookahead);
+    const auto pathSteps = qMin(
+        static_cast<int>(std::ceil(speedInTiles * lookahead)),
+        static_cast<int>(PrefetchMaxPathSteps));
+    plan.refreshDistance = qMax(1, qRound(speedInTiles * lookahead / 2.0));
+
+    QSet<TileId> pathTilesSet;
+    QVector<PrefetchTile> pathTiles;
+    for (int step = 1; step <= pathSteps; step++)
+    {
+        const auto eta = lookahead * step / pathSteps;
+        const PointI64 shift(qRound64(velocityInTiles.x * eta), qRound64(velocityInTiles.y * eta));
+        for (const auto& offset : constOf(footprint))
+        {
+            PrefetchTile prefetchTile;
+            if (!normalizeTileId(
+                    static_cast<int64_t>(centerTileId.x) + shift.x + offset.x,
+                    static_cast<int64_t>(centerTileId.y) + shift.y + offset.y,
+                    activeZoom,
+                    prefetchTile.tileId))
+            {
+                continue;
+            }
+            if (activeTilesSet.contains(prefetchTile.tileId) || pathTilesSet.contains(prefetchTile.tileId))
+                continue;
+            pathTilesSet.insert(prefetchTile.tileId);
+
+            prefetchTile.zoom = activeZoom;
+            prefetchTile.eta = eta;
+            prefetchTile.distance = offset.x*offset.x + offset.y*offset.y;
+            pathTiles.push_back(prefetchTile);
+        }
+    }
+    std::sort(pathTiles.begin(), pathTiles.end());
+    if (pathTiles.size() > PrefetchPathTilesBudget)
+        pathTiles.resize(PrefetchPathTilesBudget);
+
+    // Destination: footprint around destination target on destination zoom, closest to center first
+    QVector<PrefetchTile> destinationTiles;
+    if (hint.hasDestination)
+    {
+        const auto destinationZoom = static_cast<ZoomLevel>(qBound(
+            static_cast<int>(renderer->getMinZoomLevel()),
+            qRound(hint.destinationZoom),
+            static_cast<int>(renderer->getMaxZoomLevel())));
+        const auto zoomShift = ZoomLevel31 - destinationZoom;
+        const auto destinationTileId = TileId::fromXY(
+            hint.destinationTarget31.x >> zoomShift,
+            hint.destinationTarget31.y >> zoomShift);
+
+        for (const auto& offset : constOf(footprint))
+        {
+            PrefetchTile prefetchTile;
+            if (!normalizeTileId(
+                    static_cast<int64_t>(destinationTileId.x) + offset.x,
+                    static_cast<int64_t>(destinationTileId.y) + offset.y,
+                    destinationZoom,
+                    prefetchTile.tileId))
+            {
+                continue;
+            }
+            if (destinationZoom == activeZoom &&
+                (activeTilesSet.contains(prefetchTile.tileId) || pathTilesSet.contains(prefetchTile.tileId)))
+            {
+                continue;
+            }
+
+            prefetchTile.zoom = destinationZoom;
+            prefetchTile.eta = hint.timeLeft;
+            prefetchTile.distance = offset.x*offset.x + offset.y*offset.y;
+            destinationTiles.push_back(prefetchTile);
+        }
+        std::sort(destinationTiles.begin(), destinationTiles.end());
+        if (pathTiles.size() + destinationTiles.size() > PrefetchTilesBudget)
+            destinationTiles.resize(PrefetchTilesBudget - pathTiles.size());
+    }
+
+    plan.tiles = pathTiles + destinationTiles;
+    std::sort(plan.tiles.begin(), plan.tiles.end());
+    for (const auto& prefetchTile : constOf(plan.tiles))
+        plan.tilesMap[prefetchTile.zoom].insert(prefetchTile.tileId);
+
+    _prefetchPlan = qMove(plan);
+}
+
+bool OsmAnd::MapRendererResourcesManager::isPrefetchPlanStale(
+    const MapPrefetchHint& hint,
+    const TileId centerTileId,
+    const ZoomLevel activeZoom) const
+{
+    const auto& plannedHint = _prefetchPlan.hint;
+
+    // Path was planned in tiles of other zoom
+    if (activeZoom != _prefetchPlan.activeZoom)
+        return true;
+
+    // Map has moved far enough along the path, so it has to be extended
+    const auto dX = static_cast<int64_t>(centerTileId.x) - _prefetchPlan.centerTileId.x;
+    const auto dY = static_cast<int64_t>(centerTileId.y) - _prefetchPlan.centerTileId.y;
+    const auto refreshDistance = static_cast<int64_t>(_prefetchPlan.refreshDistance);
+    if (dX*dX + dY*dY >= refreshDistance*refreshDistance)
+        return true;
+
+    // Destination has changed
+    if (hint.hasDestination != plannedHint.hasDestination)
+        return true;
+    if (hint.hasDestination)
+    {
+        if (qRound(hint.destinationZoom) != qRound(plannedHint.destinationZoom))
+            return true;
+
+        const auto zoomShift = ZoomLevel31 - qBound(
+            static_cast<int>(MinZoomLevel),
+            qRound(hint.destinationZoom),
+            static_cast<int>(MaxZoomLevel));
+        if ((hint.destinationTarget31.x >> zoomShift) != (plannedHint.destinationTarget31.x >> zoomShift) ||
+            (hint.destinationTarget31.y >> zoomShift) != (plannedHint.destinationTarget31.y >> zoomShift))
+        {
+            return true;
+        }
+    }
+
+    // Direction has changed, or map has started or stopped moving
+    const auto& velocity = hint.targetVelocity31;
+    const auto& plannedVelocity = plannedHint.targetVelocity31;
+    const auto speed = qSqrt(velocity.x*velocity.x + velocity.y*velocity.y);
+    const auto plannedSpeed = qSqrt(plannedVelocity.x*plannedVelocity.x + plannedVelocity.y*plannedVelocity.y);
+    const auto isMoving = !qFuzzyIsNull(speed);
+    const auto wasMoving = !qFuzzyIsNull(plannedSpeed);
+    if (isMoving != wasMoving)
+        return true;
+    if (isMoving &&
+        (velocity.x*plannedVelocity.x + velocity.y*plannedVelocity.y) / (speed * plannedSpeed) < PrefetchDirectionChangeCosine)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+bool OsmAnd::MapRendererResourcesManager::activeZoneIsUploadedOrUnavailable(
+    const QList< std::shared_ptr<MapRendererBaseResourcesCollection> >& resourcesCollections,
+    const QVector<TileId>& activeTiles,
+    const ZoomLevel activeZoom) const
+{
+    const auto uploadedOrUnavailableFlags =
+        MapRendererTiledResourcesCollection::UsableIndexFlag | MapRendererTiledResourcesCollection::UnavailableIndexFlag;
+
+    for (const auto& resourcesCollection : constOf(resourcesCollections))
+    {
+        const auto tiledResourcesCollection =
+            std::dynamic_pointer_cast<MapRendererTiledResourcesCollection>(resourcesCollection);
+        if (!tiledResourcesCollection)
+            continue;
+
+        std::shared_ptr<IMapDataProvider> provider;
+        if (!obtainProviderFor(resourcesCollection.get(), provider))
+            continue;
+
+        for (const auto& activeTileId : constOf(activeTiles))
+        {
+            const auto flags = tiledResourcesCollection->index.getFlags(activeTileId, activeZoom);
+            if ((flags & uploadedOrUnavailableFlags) == 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+OsmAnd::MapRendererResourcesManager::PrefetchPlan::PrefetchPlan()
+    : centerTileId(TileId::zero())
+    , activeZoom(InvalidZoomLevel)
+    , refreshDistance(0)
+{
+}
+
+bool OsmAnd::MapRendererResourcesManager::PrefetchPlan::contains(const TileId tileId, const ZoomLevel zoom) const
+{
+    const auto citTilesAtZoom = tilesMap.constFind(zoom);
+    return citTilesAtZoom != tilesMap.cend() && citTilesAtZoom->contains(tileId);
+}
+
 void OsmAnd::MapRendererResourcesManager::requestNeededResource(
     const std::shared_ptr<MapRendererBaseResource>& resource)
 {
@@ -1245,12 +1656,16 @@ bool OsmAnd::MapRendererResourcesManager::checkForUpdatesAndApply(const MapState
 void OsmAnd::MapRendererResourcesManager::updateResources(
     const TileId centerTileId,
     const QVector<TileId>& tiles,
-    const ZoomLevel zoom)
+    const ZoomLevel zoom,
+    const MapPrefetchHint& prefetchHint)
 {
     QList< std::shared_ptr<MapRendererBaseResourcesCollection> > pendingRemovalResourcesCollections;
     QList< std::shared_ptr<MapRendererBaseResourcesCollection> > otherResourcesCollections;
     safeGetAllResourcesCollections(pendingRemovalResourcesCollections, otherResourcesCollections);
 
+    // Plan is updated before cleanup, so that resources of abandoned plan are cleaned up as junk
+    updatePrefetchPlan(prefetchHint, centerTileId, tiles, zoom);
+
     // Before requesting missing tiled resources, clean up cache to free some space
     if (!renderer->currentDebugSettings->disableJunkResourcesCleanup)
         cleanupJunkResources(pendingRemovalResourcesCollections, otherResourcesCollections, tiles, zoom);
@@ -1259,6 +1674,29 @@ void OsmAnd::MapRendererResourcesManager::updateResources(
     // present in requested list, nor in pending, nor in uploaded
     if (!renderer->currentDebugSettings->disableNeededResourcesRequests)
         requestNeededResources(otherResourcesCollections, centerTileId, tiles, zoom);
+
+    // Once map came to rest, wait until every tile of active zone is either uploaded or known to be unavailable
+    bool completeFrameAfterMotionAwaited;
+    {
+        QMutexLocker scopedLocker(&_workerThreadWakeupMutex);
+        completeFrameAfterMotionAwaited = _completeFrameAfterMotionAwaited;
+    }
+    if (completeFrameAfterMotionAwaited && activeZoneIsUploadedOrUnavailable(otherResourcesCollections, tiles, zoom))
+    {
+        QMutexLocker scopedLocker(&_workerThreadWakeupMutex);
+
+        if (_completeFrameAfterMotionAwaited)
+        {
+            auto& metricsRegistry = MetricsRegistry::getDefault();
+            if (metricsRegistry.isEnabled())
+            {
+                static const auto completeFrameAfterMotionHistogram =
+                    metricsRegistry.obtainHistogram(QLatin1String("map_time_to_complete_frame_after_motion"));
+                completeFrameAfterMotionHistogram->record(_motionEndStopwatch.elapsed());
+            }
+            _completeFrameAfterMotionAwaited = false;
+        }
+    }
 }
 
 unsigned int OsmAnd::MapRendererResourcesManager::unloadResources()
@@ -1318,16 +1756,103 @@ void OsmAnd::MapRendererResourcesManager::unloadResourcesFrom(
 }
 
 unsigned int OsmAnd::MapRendererResourcesManager::uploadResources(
-    const unsigned int limit /*= 0u*/,
+    const UploadBudget& budget /*= UploadBudget()*/,
     bool* const outMoreThanLimitAvailable /*= nullptr*/)
 {
     unsigned int totalUploaded = 0u;
+    size_t totalUploadedBytes = 0u;
     bool moreThanLimitAvailable = false;
     bool atLeastOneUploadFailed = false;
 
+    // Select resources that are ready from all collections, so that budget is spent on most important ones
+    // regardless of collection they belong to
+    QList< std::shared_ptr<MapRendererBaseResource> > resources;
     const auto& resourcesCollections = safeGetAllResourcesCollections();
     for (const auto& resourcesCollection : constOf(resourcesCollections))
-        uploadResourcesFrom(resourcesCollection, limit, totalUploaded, moreThanLimitAvailable, atLeastOneUploadFailed);
+        obtainResourcesReadyForUpload(resourcesCollection, resources);
+    if (resources.isEmpty())
+    {
+        if (outMoreThanLimitAvailable)
+            *outMoreThanLimitAvailable = false;
+        return 0u;
+    }
+
+    TileId centerTileId;
+    ZoomLevel activeZoom;
+    {
+        QMutexLocker scopedLocker(&_workerThreadWakeupMutex);
+        centerTileId = _centerTileId;
+        activeZoom = _activeZoom;
+    }
+
+    typedef std::pair< int64_t, std::shared_ptr<MapRendererBaseResource> > PrioritizedResource;
+    QVector<PrioritizedResource> prioritizedResources;
+    prioritizedResources.reserve(resources.size());
+    for (const auto& resource : constOf(resources))
+    {
+        // Keyed resources have minimal priority always
+        auto priority = std::numeric_limits<int64_t>::min();
+        if (const auto tiledResource = std::dynamic_pointer_cast<const MapRendererBaseTiledResource>(resource))
+        {
+            priority = calculateTiledResourcePriority(
+                resource->type,
+                tiledResource->tileId,
+                tiledResource->zoom,
+                centerTileId,
+                activeZoom);
+        }
+        prioritizedResources.push_back(PrioritizedResource(priority, resource));
+    }
+    std::stable_sort(prioritizedResources.begin(), prioritizedResources.end(),
+        []
+        (const PrioritizedResource& l, const PrioritizedResource& r) -> bool
+        {
+            return l.first > r.first;
+        });
+
+    // Upload to GPU in order of priority, until budget is spent. At least one resource is uploaded always,
+    // so that even resource larger than budget gets uploaded eventually
+    const Stopwatch uploadStopwatch(true);
+    for (const auto& prioritizedResource : constOf(prioritizedResources))
+    {
+        const auto& resource = prioritizedResource.second;
+
+        if (totalUploaded > 0u)
+        {
+            const auto limitReached =
+                (budget.resourcesLimit > 0u && totalUploaded >= budget.resourcesLimit) ||
+                (budget.bytesLimit > 0u && totalUploadedBytes + resource->getGpuUploadSize() > budget.bytesLimit) ||
+                (budget.timeLimit > 0.0f && uploadStopwatch.elapsed() >= budget.timeLimit);
+            if (limitReached)
+            {
+                // Tell that more resources are available for upload
+                moreThanLimitAvailable = true;
+                break;
+            }
+        }
+
+        bool didUpload;
+        if (!uploadResource(resource, didUpload))
+            continue;
+        if (!didUpload)
+        {
+            atLeastOneUploadFailed = true;
+            continue;
+        }
+
+        // Count uploaded resources
+        totalUploaded++;
+        totalUploadedBytes += resource->getGpuUploadSize();
+    }
+
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (metricsRegistry.isEnabled() && totalUploaded > 0u)
+    {
+        static const auto uploadedBytesCounter = metricsRegistry.obtainCounter(QLatin1String("map_gpu_uploaded_bytes_total"));
+        static const auto uploadTimeHistogram = metricsRegistry.obtainHistogram(QLatin1String("map_gpu_upload_time"));
+        uploadedBytesCounter->add(totalUploadedBytes);
+        uploadTimeHistogram->record(uploadStopwatch.elapsed());
+    }
 
     // If any resource failed to upload, report that more ready resources are available
     if (atLeastOneUploadFailed)
@@ -1338,91 +1863,73 @@ unsigned int OsmAnd::MapRendererResourcesManager::uploadResources(
     return totalUploaded;
 }
 
-void OsmAnd::MapRendererResourcesManager::uploadResourcesFrom(
+void OsmAnd::MapRendererResourcesManager::obtainResourcesReadyForUpload(
     const std::shared_ptr<MapRendererBaseResourcesCollection>& collection,
-    const unsigned int limit,
-    unsigned int& totalUploaded,
-    bool& moreThanLimitAvailable,
-    bool& atLeastOneUploadFailed)
+    QList< std::shared_ptr<MapRendererBaseResource> >& outResources)
 {
     // Select all resources with "Ready" state
-    QList< std::shared_ptr<MapRendererBaseResource> > resources;
-    collection->obtainResources(&resources,
-        [&resources, limit, totalUploaded, &moreThanLimitAvailable]
+    collection->obtainResources(&outResources,
+        []
         (const std::shared_ptr<MapRendererBaseResource>& entry, bool& cancel) -> bool
         {
-            // Skip not-ready resources
-            if (entry->getState() != MapRendererResourceState::Ready &&
-                entry->getState() != MapRendererResourceState::PreparedRenew)
-                return false;
-
-            // Check if limit was reached
-            if (limit > 0 && (totalUploaded + resources.size()) > limit)
-            {
-                // Tell that more resources are available for upload
-                moreThanLimitAvailable = true;
-
-                cancel = true;
-                return false;
-            }
-
-            // Accept this resource
-            return true;
+            return
+                entry->getState() == MapRendererResourceState::Ready ||
+                entry->getState() == MapRendererResourceState::PreparedRenew;
         });
-    if (resources.isEmpty())
-        return;
+}
 
-    // Upload to GPU all selected resources
-    for (const auto& resource : constOf(resources))
+bool OsmAnd::MapRendererResourcesManager::uploadResource(
+    const std::shared_ptr<MapRendererBaseResource>& resource,
+    bool& outDidUpload)
+{
+    // Since state change is allowed (it's not changed to "Uploading" during query), check state here
+    if (resource->setStateIf(MapRendererResourceState::Ready, MapRendererResourceState::Uploading))
     {
-        // Since state change is allowed (it's not changed to "Uploading" during query), check state here
-        if (resource->setStateIf(MapRendererResourceState::Ready, MapRendererResourceState::Uploading))
-        {
-            LOG_RESOURCE_STATE_CHANGE(resource, MapRendererResourceState::Ready, MapRendererResourceState::Uploading);
-        }
-        else if (resource->setStateIf(MapRendererResourceState::PreparedRenew, MapRendererResourceState::Renewing))
+        LOG_RESOURCE_STATE_CHANGE(resource, MapRendererResourceState::Ready, MapRendererResourceState::Uploading);
+    }
+    else if (resource->setStateIf(MapRendererResourceState::PreparedRenew, MapRendererResourceState::Renewing))
+    {
+        LOG_RESOURCE_STATE_CHANGE(resource, MapRendererResourceState::PreparedRenew, MapRendererResourceState::Renewing);
+    }
+    else
+    {
+        return false;
+    }
+
+    // Actually upload resource to GPU
+    {
+        OSMAND_TRACE_TASK_SPAN("MapRendererResourcesManager::uploadToGPU", getResourceTraceTaskId(resource));
+        outDidUpload = resource->uploadToGPU();
+    }
+    if (!outDidUpload)
+    {
+        if (const auto tiledResource = std::dynamic_pointer_cast<const MapRendererBaseTiledResource>(resource))
         {
-            LOG_RESOURCE_STATE_CHANGE(resource, MapRendererResourceState::PreparedRenew, MapRendererResourceState::Renewing);
+            LogPrintf(LogSeverityLevel::Error,
+                "Failed to upload tiled resource %p for %dx%d@%d to GPU",
+                resource.get(),
+                tiledResource->tileId.x, tiledResource->tileId.y, tiledResource->zoom);
         }
         else
         {
-            continue;
-        }
-        // Actually upload resource to GPU
-        const auto didUpload = resource->uploadToGPU();
-        if (!atLeastOneUploadFailed && !didUpload)
-            atLeastOneUploadFailed = true;
-        if (!didUpload)
-        {
-            if (const auto tiledResource = std::dynamic_pointer_cast<const MapRendererBaseTiledResource>(resource))
-            {
-                LogPrintf(LogSeverityLevel::Error,
-                    "Failed to upload tiled resource %p for %dx%d@%d to GPU",
-                    resource.get(),
-                    tiledResource->tileId.x, tiledResource->tileId.y, tiledResource->zoom);
-            }
-            else
-            {
-                LogPrintf(LogSeverityLevel::Error,
-                    "Failed to upload resource %p to GPU",
-                    resource.get());
-            }
-            continue;
+            LogPrintf(LogSeverityLevel::Error,
+                "Failed to upload resource %p to GPU",
+                resource.get());
         }
+        return true;
+    }
 
-        // Before marking as uploaded, if uploading is done from GPU worker thread,
-        // wait until operation completes
-        if (renderer->setupOptions.gpuWorkerThreadEnabled)
-            renderer->gpuAPI->waitUntilUploadIsComplete();
+    // Before marking as uploaded, if uploading is done from GPU worker thread,
+    // wait until operation completes
+    if (renderer->setupOptions.gpuWorkerThreadEnabled)
+        renderer->gpuAPI->waitUntilUploadIsComplete();
 
-        // Mark as uploaded
-        assert(resource->getState() == MapRendererResourceState::Uploading || resource->getState() == MapRendererResourceState::Renewing);
+    // Mark as uploaded
+    assert(resource->getState() == MapRendererResourceState::Uploading || resource->getState() == MapRendererResourceState::Renewing);
 
-        resource->setState(MapRendererResourceState::Uploaded);
-        
-        // Count uploaded resources
-        totalUploaded++;
-    }
+    resource->setState(MapRendererResourceState::Uploaded);
+
+    return true;
 }
 
 void OsmAnd::MapRendererResourcesManager::cleanupJunkResources(
@@ -1543,66 +2050,63 @@ void OsmAnd::MapRendererResourcesManager::cleanupJunkResources(
         }
 
         // Some checks are only valid for tiled resources
-        if (const auto tiledResourcesCollection = std::dynamic_pointer_cast<IMapRendererTiledResourcesCollection>(resourcesCollection))
+        if (const auto tiledResourcesCollection = std::dynamic_pointer_cast<MapRendererTiledResourcesCollection>(resourcesCollection))
         {
-            resourcesCollection->removeResources(
-                [this, activeZoom, activeTiles, &needsResourcesUploadOrUnload]
-                (const std::shared_ptr<MapRendererBaseResource>& entry, bool& cancel) -> bool
-                {
-                    // If it was previously marked as junk, just leave it
-                    if (entry->isJunk)
-                        return false;
+            const auto& index = tiledResourcesCollection->index;
 
-                    const auto tiledEntry = std::static_pointer_cast<MapRendererBaseTiledResource>(entry);
+            // Only regions that may hold junk are swept, instead of checking every resource: tiles of active zoom that
+            // are not active anymore, and all tiles that are too deep under active zoom to be usable as underscaled.
+            // Overscaled tiles are kept.
+            QList<TileId> junkCandidatesTiles;
+            QSet<TileId> activeTilesSet;
+            for (const auto& activeTileId : constOf(activeTiles))
+                activeTilesSet.insert(activeTileId);
+            for (int zoom = activeZoom; zoom <= MaxZoomLevel; zoom++)
+            {
+                const auto deltaZoom = zoom - static_cast<int>(activeZoom);
+                if (deltaZoom > 0 && deltaZoom <= MapRenderer::MaxMissingDataZoomShift)
+                    continue;
+                if (index.getTilesCount(static_cast<ZoomLevel>(zoom)) == 0)
+                    continue;
 
-                    // Determine if resource is junk:
-                    bool isJunk = false;
-                        
-                    // If this tiled entry is part of active zoom, it's treated as junk only if it's not a part
-                    // of active tiles set
-                    if (tiledEntry->zoom == activeZoom)
-                        isJunk = isJunk || !activeTiles.contains(tiledEntry->tileId);
+                junkCandidatesTiles.clear();
+                index.obtainTiles(
+                    static_cast<ZoomLevel>(zoom),
+                    MapRendererTiledResourcesCollection::PresentIndexFlag,
+                    junkCandidatesTiles);
+                for (const auto& tileId : constOf(junkCandidatesTiles))
+                {
+                    if (deltaZoom == 0 && activeTilesSet.contains(tileId))
+                        continue;
 
-                    // If zoom delta is larger than MapRenderer::MaxMissingDataZoomShift, it means than this underscaled
-                    // tile is not usable. If it's less than zero (overscaled tile), keep it.
-                    const auto deltaZoom = static_cast<int>(tiledEntry->zoom) - static_cast<int>(activeZoom);
-                    isJunk = isJunk || (deltaZoom > MapRenderer::MaxMissingDataZoomShift);
+                    // Prefetched resource is needed, even though it's not active yet
+                    if (_prefetchPlan.contains(tileId, static_cast<ZoomLevel>(zoom)))
+                        continue;
 
-                    // Skip cleaning if this resource is not junk
-                    if (!isJunk)
-                        return false;
+                    std::shared_ptr<MapRendererBaseTiledResource> entry;
+                    if (!tiledResourcesCollection->obtainResource(tileId, static_cast<ZoomLevel>(zoom), entry))
+                        continue;
+
+                    // If it was previously marked as junk, just leave it
+                    if (entry->isJunk)
+                        continue;
 
                     // Mark this entry as junk until it will die
                     entry->markAsJunk();
 
-                    return cleanupJunkResource(entry, needsResourcesUploadOrUnload);
-                });
+                    if (cleanupJunkResource(entry, needsResourcesUploadOrUnload))
+                        entry->removeSelfFromCollection();
+                }
+            }
 
             // Remove all tiled resources that are not needed for "full coverage" of (activeTiles@ActiveZoom)
             QHash<ZoomLevel, QSet<TileId>> neededTilesMap;
-            const auto isUsableResource =
-                []
-                (const std::shared_ptr<MapRendererBaseTiledResource>& entry) -> bool
-                {
-                    // Resources marked as junk are not usable
-                    if (entry->isJunk)
-                        return false;
-
-                    // Only resources in GPU are usable
-                    const auto state = entry->getState();
-                    return state == MapRendererResourceState::Uploaded;
-                };
             for (const auto& activeTileId : constOf(activeTiles))
             {
                 // If resources have exact match for this tile, use only that
                 neededTilesMap[activeZoom].insert(activeTileId);
-                if (tiledResourcesCollection->containsResource(
-                        activeTileId,
-                        activeZoom,
-                        isUsableResource))
-                {
+                if (index.hasFlags(activeTileId, activeZoom, MapRendererTiledResourcesCollection::UsableIndexFlag))
                     continue;
-                }
 
                 if (resourcesCollection->getType() == MapRendererResourceType::MapLayer/* ||
                     resourcesCollection->getType() == MapRendererResourceType::Symbols*/)
@@ -1617,7 +2121,12 @@ void OsmAnd::MapRendererResourcesManager::cleanupJunkResources(
                         {
                             const auto underscaledZoom = static_cast<int>(activeZoom) + absZoomShift;
                             if (underscaledZoom <= static_cast<int>(MaxZoomLevel) &&
-                                absZoomShift <= MapRenderer::MaxMissingDataZoomShift)
+                                absZoomShift <= MapRenderer::MaxMissingDataZoomShift &&
+                                index.countDescendants(
+                                    activeTileId,
+                                    activeZoom,
+                                    absZoomShift,
+                                    MapRendererTiledResourcesCollection::UsableIndexFlag) > 0)
                             {
                                 const auto underscaledTileIdsN = Utilities::getTileIdsUnderscaledByZoomShift(
                                     activeTileId,
@@ -1630,10 +2139,10 @@ void OsmAnd::MapRendererResourcesManager::cleanupJunkResources(
                                 {
                                     const auto& underscaledTileId = *(pUnderscaledTileIdN++);
 
-                                    const auto underscaledTilePresent = tiledResourcesCollection->containsResource(
+                                    const auto underscaledTilePresent = index.hasFlags(
                                         underscaledTileId,
                                         static_cast<ZoomLevel>(underscaledZoom),
-                                        isUsableResource);
+                                        MapRendererTiledResourcesCollection::UsableIndexFlag);
                                     if (underscaledTilePresent)
                                     {
                                         neededTilesMap[static_cast<ZoomLevel>(underscaledZoom)].insert(underscaledTileId);
@@ -1657,10 +2166,10 @@ void OsmAnd::MapRendererResourcesManager::cleanupJunkResources(
                                 const auto overscaledTileId = Utilities::getTileIdOverscaledByZoomShift(
                                     activeTileId,
                                     absZoomShift);
-                                if (tiledResourcesCollection->containsResource(
+                                if (index.hasFlags(
                                     overscaledTileId,
                                     static_cast<ZoomLevel>(overscaleZoom),
-                                    isUsableResource))
+                                    MapRendererTiledResourcesCollection::UsableIndexFlag))
                                 {
                                     // It's needed only if present and ready
                                     neededTilesMap[static_cast<ZoomLevel>(overscaleZoom)].insert(overscaledTileId);
@@ -1683,13 +2192,15 @@ void OsmAnd::MapRendererResourcesManager::cleanupJunkResources(
 
                     const auto tiledEntry = std::static_pointer_cast<MapRendererBaseTiledResource>(entry);
                         
-                    // Any tiled resource that is not contained in neededTilesMap is junk
+                    // Any tiled resource that is not contained in neededTilesMap is junk, unless it's prefetched
                     const auto citNeededTilesAtZoom = neededTilesMap.constFind(tiledEntry->zoom);
                     if (citNeededTilesAtZoom != neededTilesMap.cend() &&
                         citNeededTilesAtZoom->contains(tiledEntry->tileId))
                     {
                         return false;
                     }
+                    if (_prefetchPlan.contains(tiledEntry->tileId, tiledEntry->zoom))
+                        return false;
 
                     // Mark this entry as junk until it will die
                     entry->markAsJunk();
@@ -2028,7 +2539,7 @@ void OsmAnd::MapRendererResourcesManager::releaseAllResources(const bool gpuCont
 }
 
 void OsmAnd::MapRendererResourcesManager::syncResourcesInGPU(
-    const unsigned int limitUploads /*= 0u*/,
+    const UploadBudget& uploadBudget /*= UploadBudget()*/,
     bool* const outMoreUploadsThanLimitAvailable /*= nullptr*/,
     unsigned int* const outResourcesUploaded /*= nullptr*/,
     unsigned int* const outResourcesUnloaded /*= nullptr*/)
@@ -2039,7 +2550,7 @@ void OsmAnd::MapRendererResourcesManager::syncResourcesInGPU(
         *outResourcesUnloaded = resourcesUnloaded;
 
     // Upload resources
-    const auto resourcesUploaded = uploadResources(limitUploads, outMoreUploadsThanLimitAvailable);
+    const auto resourcesUploaded = uploadResources(uploadBudget, outMoreUploadsThanLimitAvailable);
     if (outResourcesUploaded)
         *outResourcesUploaded = resourcesUploaded;
 }
@@ -2264,33 +2775,59 @@ OsmAnd::MapRendererResourcesManager::ResourceRequestTask::ResourceRequestTask(
     : HostedTask(bridge_, executeWrapper, nullptr, postExecuteWrapper)
     , manager(reinterpret_cast<MapRendererResourcesManager*>(lockedOwner))
     , requestedResource(requestedResource_)
+    , isTiledRequest(false)
 {
     manager->_resourcesRequestTasksCounter.fetchAndAddOrdered(1);
+
+    if (const auto tiledResource = std::dynamic_pointer_cast<MapRendererBaseTiledResource>(requestedResource))
+    {
+        if (const auto link = tiledResource->link.lock())
+        {
+            isTiledRequest = true;
+            requestKey.collection = &link->collection;
+            requestKey.tileId = tiledResource->tileId;
+            requestKey.zoom = tiledResource->zoom;
+        }
+    }
 }
 
 OsmAnd::MapRendererResourcesManager::ResourceRequestTask::~ResourceRequestTask()
 {
+    // Task that was dequeued without being executed is still in requests table
+    manager->forgetResourceRequest(this);
+
     manager->_resourcesRequestTasksCounter.fetchAndSubOrdered(1);
 }
 
 void OsmAnd::MapRendererResourcesManager::ResourceRequestTask::execute()
 {
+    OSMAND_TRACE_TASK_SPAN("MapRendererResourcesManager::ResourceRequestTask",
+        getResourceTraceTaskId(requestedResource));
+
+    // Priority of running request can't be changed anymore
+    manager->forgetResourceRequest(this);
+
     if (!manager->beginResourceRequestProcessing(requestedResource))
         return;
 
-    // Ask resource to obtain it's data
+    // Ask resource to obtain it's data. Resource that left active zone while being processed is marked by
+    // junk cleanup, so obtaining of it's data is stopped as early as provider checks query controller.
+    Stopwatch processingStopwatch(true);
     bool dataAvailable = false;
     const std::shared_ptr<FunctorQueryController> obtainDataQueryController(new FunctorQueryController(
         [this]
         (const FunctorQueryController* const queryController) -> bool
         {
-            return isCancellationRequested();
+            return isCancellationRequested() ||
+                requestedResource->getState() == MapRendererResourceState::RequestCanceledWhileBeingProcessed;
         }));
     const auto requestSucceeded =
         requestedResource->obtainData(dataAvailable, obtainDataQueryController) &&
         !isCancellationRequested();
+    const auto wasWasted = obtainDataQueryController->isAborted();
 
     manager->endResourceRequestProcessing(requestedResource, requestSucceeded, dataAvailable);
+    manager->recordResourceRequestWork(processingStopwatch.elapsed(), wasWasted);
 }
 
 void OsmAnd::MapRendererResourcesManager::ResourceRequestTask::postExecute(const bool wasCancelled)
@@ -2316,20 +2853,36 @@ int64_t OsmAnd::MapRendererResourcesManager::ResourceRequestTask::calculatePrior
     const QVector<TileId>& activeTiles,
     const ZoomLevel activeZoom) const
 {
-    // Priority calculation does not need to be stable
+    if (isTiledRequest)
+    {
+        return calculateTiledResourcePriority(
+            requestedResource->type,
+            requestKey.tileId,
+            requestKey.zoom,
+            centerTileId,
+            activeZoom);
+    }
 
     // Keyed resources have minimal priority always
     if (std::dynamic_pointer_cast<MapRendererBaseKeyedResource>(requestedResource))
         return std::numeric_limits<int64_t>::min();
 
-    const auto tiledResource = std::dynamic_pointer_cast<MapRendererBaseTiledResource>(requestedResource);
-    if (!tiledResource)
-        return 0;
+    return 0;
+}
+
+int64_t OsmAnd::MapRendererResourcesManager::calculateTiledResourcePriority(
+    const MapRendererResourceType type,
+    const TileId tileId,
+    const ZoomLevel zoom,
+    const TileId centerTileId,
+    const ZoomLevel activeZoom)
+{
+    // Priority calculation does not need to be stable
 
     // The closer tiled resource coordinates are from center, the higher priority it has
     auto priority = std::numeric_limits<int64_t>::max();
 
-    switch (tiledResource->type)
+    switch (type)
     {
         case MapRendererResourceType::MapLayer:
             // Do nothing, since MapLayer resources are most important
@@ -2345,11 +2898,31 @@ int64_t OsmAnd::MapRendererResourcesManager::ResourceRequestTask::calculatePrior
             break;
     }
 
-    priority -= qAbs(static_cast<int>(tiledResource->zoom) - static_cast<int>(activeZoom)) * 10000000;
+    priority -= qAbs(static_cast<int>(zoom) - static_cast<int>(activeZoom)) * 10000000;
 
-    const auto dX = tiledResource->tileId.x - centerTileId.x;
-    const auto dY = tiledResource->tileId.y - centerTileId.y;
+    const auto dX = tileId.x - centerTileId.x;
+    const auto dY = tileId.y - centerTileId.y;
     priority -= dX*dX + dY*dY;
 
     return priority;
 }
+
+OsmAnd::Concurrent::WorkerPool::Affinity OsmAnd::MapRendererResourcesManager::ResourceRequestTask::getAffinity() const
+{
+    // Map layer and symbols of same tile are usually produced from same OBF data, which providers obtain once per
+    // tile while other requests of that tile wait for it. Keeping such requests on one thread lets later ones
+    // reuse that data instead of blocking other threads.
+    if (!isTiledRequest || requestedResource->type == MapRendererResourceType::ElevationData)
+        return Concurrent::WorkerPool::NoAffinity;
+
+    return Tracer::getTileTaskId(requestKey.tileId, requestKey.zoom);
+}
+
+uint64_t OsmAnd::MapRendererResourcesManager::getResourceTraceTaskId(
+    const std::shared_ptr<const MapRendererBaseResource>& resource)
+{
+    if (const auto tiledResource = std::dynamic_pointer_cast<const MapRendererBaseTiledResource>(resource))
+        return Tracer::getTileTaskId(tiledResource->tileId, tiledResource->zoom);
+
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(resource.get()));
+}
@@ -4,6 +4,7 @@
 #include "stdlib_common.h"
 #include <functional>
 #include <array>
+#include <atomic>
 
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
@@ -40,6 +41,7 @@
 #include "HostedTask.h"
 #include "WorkerPool.h"
 #include "IQueryController.h"
+#include "Stopwatch.h"
 
 namespace OsmAnd
 {
@@ -59,11 +61,48 @@ namespace OsmAnd
             QList< std::shared_ptr<MapRendererBaseResourcesCollection> >,
             MapRendererResourceTypesCount > ResourcesStorage;
 
+        // Limits of single upload pass. Zero means "unlimited"
+        struct UploadBudget
+        {
+            UploadBudget(
+                const unsigned int resourcesLimit_ = 0u,
+                const size_t bytesLimit_ = 0u,
+                const float timeLimit_ = 0.0f)
+                : resourcesLimit(resourcesLimit_)
+                , bytesLimit(bytesLimit_)
+                , timeLimit(timeLimit_)
+            {
+            }
+
+            unsigned int resourcesLimit;
+            size_t bytesLimit;
+            // In seconds
+            float timeLimit;
+        };
+
     private:
         // Resource-requests related:
         const Concurrent::TaskHost::Bridge _taskHostBridge;
         Concurrent::WorkerPool _resourcesRequestWorkerPool;
         QAtomicInt _resourcesRequestTasksCounter;
+        struct ResourceRequestKey
+        {
+            const void* collection;
+            TileId tileId;
+            ZoomLevel zoom;
+
+            inline bool operator==(const ResourceRequestKey& that) const
+            {
+                return collection == that.collection &&
+                    tileId.id == that.tileId.id &&
+                    zoom == that.zoom;
+            }
+
+            friend inline uint qHash(const ResourceRequestKey& key, uint seed = 0)
+            {
+                return ::qHash(key.collection, seed) ^ ::qHash(key.tileId.id, seed) ^ ::qHash(static_cast<int>(key.zoom), seed);
+            }
+        };
         class ResourceRequestTask : public Concurrent::HostedTask
         {
             Q_DISABLE_COPY_AND_MOVE(ResourceRequestTask);
@@ -83,11 +122,46 @@ namespace OsmAnd
             MapRendererResourcesManager* const manager;
             const std::shared_ptr<MapRendererBaseResource> requestedResource;
 
+            // Captured once, so that priority is calculated without casting resource each time
+            bool isTiledRequest;
+            ResourceRequestKey requestKey;
+
             int64_t calculatePriority(
                 const TileId centerTileId,
                 const QVector<TileId>& activeTiles,
                 const ZoomLevel activeZoom) const;
+            Concurrent::WorkerPool::Affinity getAffinity() const;
+        };
+        static int64_t calculateTiledResourcePriority(
+            const MapRendererResourceType type,
+            const TileId tileId,
+            const ZoomLevel zoom,
+            const TileId centerTileId,
+            const ZoomLevel activeZoom);
+
+        // Queued requests of tiled resources. Their priorities are refreshed in bulk when active zone changes,
+        // so that workers always take request that is most important right now.
+        struct ResourceRequest
+        {
+            ResourceRequestTask* task;
+            MapRendererResourceType type;
+            bool isPrefetch;
+            std::atomic<int64_t> priority;
         };
+        mutable QMutex _resourceRequestsMutex;
+        QHash< ResourceRequestKey, std::shared_ptr<ResourceRequest> > _resourceRequests;
+        void enqueueResourceRequest(ResourceRequestTask* const task, const int64_t priority, const bool isPrefetch);
+        void forgetResourceRequest(const ResourceRequestTask* const task);
+        void refreshResourceRequestsPriorities(
+            const TileId centerTileId,
+            const QVector<TileId>& activeTiles,
+            const ZoomLevel activeZoom);
+        void recordResourceRequestWork(const float processingTime, const bool wasWasted);
+
+        // Tiled resources are traced under task identifier of their tile (see Tracer::getTileTaskId()),
+        // other resources under their address
+        static uint64_t getResourceTraceTaskId(const std::shared_ptr<const MapRendererBaseResource>& resource);
+
         void setResourceWorkerThreadsLimit(const unsigned int limit);
         void resetResourceWorkerThreadsLimit();
 
@@ -141,12 +215,14 @@ namespace OsmAnd
         QVector<TileId> _activeTiles;
         ZoomLevel _activeZoom;
         QVector<QRunnable*> _requestedResourcesTasks;
+        MapPrefetchHint _prefetchHint;
         bool updatesPresent() const;
         virtual bool checkForUpdatesAndApply(const MapState& mapState) const;
         void updateResources(
             const TileId centerTileId,
             const QVector<TileId>& tiles,
-            const ZoomLevel zoom);
+            const ZoomLevel zoom,
+            const MapPrefetchHint& prefetchHint);
         void requestNeededResources(
             const QList< std::shared_ptr<MapRendererBaseResourcesCollection> >& resourcesCollections,
             const TileId centerTileId,
@@ -160,6 +236,11 @@ namespace OsmAnd
             const std::shared_ptr<MapRendererTiledResourcesCollection>& resourcesCollection,
             const QVector<TileId>& tiles,
             const ZoomLevel zoom);
+        MapRendererBaseTiledResource* allocateTiledResource(
+            const MapRendererResourceType type,
+            const TiledEntriesCollection<MapRendererBaseTiledResource>& collection,
+            const TileId tileId,
+            const ZoomLevel zoom);
         void requestNeededKeyedResources(
             const std::shared_ptr<MapRendererKeyedResourcesCollection>& resourcesCollection);
         void requestNeededResource(
@@ -182,13 +263,13 @@ namespace OsmAnd
         void unloadResourcesFrom(
             const std::shared_ptr<MapRendererBaseResourcesCollection>& collection,
             unsigned int& totalUnloaded);
-        unsigned int uploadResources(const unsigned int limit = 0u, bool* const outMoreThanLimitAvailable = nullptr);
-        void uploadResourcesFrom(
+        unsigned int uploadResources(
+            const UploadBudget& budget = UploadBudget(),
+            bool* const outMoreThanLimitAvailable = nullptr);
+        void obtainResourcesReadyForUpload(
             const std::shared_ptr<MapRendererBaseResourcesCollection>& collection,
-            const unsigned int limit,
-            unsigned int& totalUploaded,
-            bool& moreThanLimitAvailable,
-            bool& atLeastOneUploadFailed);
+            QList< std::shared_ptr<MapRendererBaseResource> >& outResources);
+        bool uploadResource(const std::shared_ptr<MapRendererBaseResource>& resource, bool& outDidUpload);
         void blockingReleaseResourcesFrom(
             const std::shared_ptr<MapRendererBaseResourcesCollection>& collection,
             const bool gpuContextLost);
@@ -196,6 +277,70 @@ namespace OsmAnd
         void notifyNewResourceAvailableForDrawing();
         void releaseAllResources(const bool gpuContextLost);
 
+        // Prefetch of resources that are expected to become active, according to prefetch hint. Everything here
+        // is touched only by worker thread.
+        enum {
+            // Limit of tiles that are prefetched at once, so that prefetch never takes over memory and workers
+            PrefetchTilesBudget = 64,
+
+            // Part of budget that may be taken by tiles along path, rest is left for destination
+            PrefetchPathTilesBudget = PrefetchTilesBudget / 2,
+
+            // Limit of path lookahead in steps of a tile
+            PrefetchMaxPathSteps = 16,
+        };
+        // How far ahead along current velocity path is predicted, in seconds
+        static const float PrefetchMaxLookahead;
+        // If direction of movement changes by larger angle than this, plan is abandoned
+        static const float PrefetchDirectionChangeCosine;
+        // Prefetch requests go after any request of active zone
+        static const int64_t PrefetchPriority;
+        struct PrefetchTile
+        {
+            TileId tileId;
+            ZoomLevel zoom;
+            float eta;
+            int64_t distance;
+
+            inline bool operator<(const PrefetchTile& that) const
+            {
+                if (!qFuzzyCompare(eta, that.eta))
+                    return eta < that.eta;
+                return distance < that.distance;
+            }
+        };
+        struct PrefetchPlan
+        {
+            PrefetchPlan();
+
+            MapPrefetchHint hint;
+            TileId centerTileId;
+            ZoomLevel activeZoom;
+            int refreshDistance;
+            QVector<PrefetchTile> tiles;
+            QHash<ZoomLevel, QSet<TileId>> tilesMap;
+
+            bool contains(const TileId tileId, const ZoomLevel zoom) const;
+        };
+        PrefetchPlan _prefetchPlan;
+        bool _completeFrameAfterMotionAwaited;
+        Stopwatch _motionEndStopwatch;
+        void updatePrefetchPlan(
+            const MapPrefetchHint& hint,
+            const TileId centerTileId,
+            const QVector<TileId>& activeTiles,
+            const ZoomLevel activeZoom);
+        bool isPrefetchPlanStale(
+            const MapPrefetchHint& hint,
+            const TileId centerTileId,
+            const ZoomLevel activeZoom) const;
+        void requestPrefetchedResources(
+            const QList< std::shared_ptr<MapRendererBaseResourcesCollection> >& resourcesCollections);
+        bool activeZoneIsUploadedOrUnavailable(
+            const QList< std::shared_ptr<MapRendererBaseResourcesCollection> >& resourcesCollections,
+            const QVector<TileId>& activeTiles,
+            const ZoomLevel activeZoom) const;
+
         // Worker thread:
         volatile bool _workerThreadIsAlive;
         const std::unique_ptr<Concurrent::Thread> _workerThread;
@@ -227,8 +372,9 @@ namespace OsmAnd
         void updateSymbolProviderBindings(const MapRendererState& state);
 
         void updateActiveZone(const TileId centerTileId, const QVector<TileId>& tiles, const ZoomLevel zoom);
+        void updatePrefetchHint(const MapPrefetchHint& hint);
         void syncResourcesInGPU(
-            const unsigned int limitUploads = 0u,
+            const UploadBudget& uploadBudget = UploadBudget(),
             bool* const outMoreUploadsThanLimitAvailable = nullptr,
             unsigned int* const outResourcesUploaded = nullptr,
             unsigned int* const outResourcesUnloaded = nullptr);
@@ -7,6 +7,8 @@ OsmAnd::MapRendererSetupOptions::MapRendererSetupOptions()
     , frameUpdateRequestCallback(nullptr)
     , maxNumberOfRasterMapLayersInBatch(0)
     , displayDensityFactor(1.0f)
+    , maxGpuUploadBytesPerFrame(4 * 1024 * 1024)
+    , maxGpuUploadTimePerFrame(4.0f)
 {
 }
 
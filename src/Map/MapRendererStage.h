@@ -40,6 +40,7 @@ namespace OsmAnd
         const std::shared_ptr<const MapRendererDebugSettings>& debugSettings;
         QReadWriteLock& publishedMapSymbolsByOrderLock;
         const MapRenderer::PublishedMapSymbolsByOrder& publishedMapSymbolsByOrder;
+        const unsigned int& publishedMapSymbolsVersion;
 
         virtual bool initialize() = 0;
         virtual bool render(IMapRenderer_Metrics::Metric_renderFrame* const metric) = 0;
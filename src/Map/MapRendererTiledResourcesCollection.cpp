@@ -1,7 +1,10 @@
 #include "MapRendererTiledResourcesCollection.h"
 
+#include "MapRenderer.h"
+
 OsmAnd::MapRendererTiledResourcesCollection::MapRendererTiledResourcesCollection(const MapRendererResourceType type_)
     : MapRendererBaseResourcesCollection(type_)
+    , TiledEntriesCollection(MapRenderer::MaxMissingDataZoomShift)
     , _snapshot(new Snapshot(type_))
 {
 }
@@ -111,6 +114,22 @@ void OsmAnd::MapRendererTiledResourcesCollection::onCollectionModified() const
     _collectionSnapshotInvalidatesCount.fetchAndAddOrdered(1);
 }
 
+OsmAnd::TileStateIndex::Flags OsmAnd::MapRendererTiledResourcesCollection::getEntryIndexFlags(
+    const MapRendererBaseTiledResource& entry) const
+{
+    TileStateIndex::Flags flags = PresentIndexFlag;
+    if (entry.isJunk)
+        return flags;
+
+    const auto state = entry.getState();
+    if (state == MapRendererResourceState::Uploaded)
+        flags |= UsableIndexFlag;
+    else if (state == MapRendererResourceState::Unavailable)
+        flags |= UnavailableIndexFlag;
+
+    return flags;
+}
+
 bool OsmAnd::MapRendererTiledResourcesCollection::updateCollectionSnapshot() const
 {
     const auto invalidatesDiscarded = _collectionSnapshotInvalidatesCount.fetchAndAddOrdered(0);
@@ -25,6 +25,16 @@ namespace OsmAnd
         , public TiledEntriesCollection<MapRendererBaseTiledResource>
     {
     public:
+        // Flags of resources kept in collection index
+        enum IndexFlag : TileStateIndex::Flags
+        {
+            PresentIndexFlag = 1u << 0,
+            // Not junk and uploaded to GPU
+            UsableIndexFlag = 1u << 1,
+            // Not junk and known to have no data
+            UnavailableIndexFlag = 1u << 2,
+        };
+
         class Snapshot
             : public IMapRendererResourcesCollection
             , public IMapRendererTiledResourcesCollection
@@ -69,6 +79,8 @@ namespace OsmAnd
         const std::shared_ptr<Snapshot> _snapshot;
         mutable QAtomicInt _collectionSnapshotInvalidatesCount;
         virtual void onCollectionModified() const;
+
+        virtual TileStateIndex::Flags getEntryIndexFlags(const MapRendererBaseTiledResource& entry) const;
     public:
         virtual ~MapRendererTiledResourcesCollection();
 
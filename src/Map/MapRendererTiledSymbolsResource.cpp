@@ -222,6 +222,7 @@ bool OsmAnd::MapRendererTiledSymbolsResource::obtainData(
     // Register all obtained symbols
     const auto& self = shared_from_this();
     QList< PublishOrUnpublishMapSymbol > mapSymbolsToPublish;
+    _gpuUploadSize = 0;
     for (const auto& groupResources : constOf(_uniqueGroupsResources))
     {
         if (queryController && queryController->isAborted())
@@ -238,6 +239,7 @@ bool OsmAnd::MapRendererTiledSymbolsResource::obtainData(
                 self };
             mapSymbolsToPublish.push_back(mapSymbolToPublish);
             publishedMapSymbols.push_back(mapSymbol);
+            _gpuUploadSize += estimateGpuUploadSize(mapSymbol);
         }
     }
     for (const auto& groupResources : constOf(_referencedSharedGroupsResources))
@@ -256,6 +258,7 @@ bool OsmAnd::MapRendererTiledSymbolsResource::obtainData(
                 self };
             mapSymbolsToPublish.push_back(mapSymbolToPublish);
             publishedMapSymbols.push_back(mapSymbol);
+            _gpuUploadSize += estimateGpuUploadSize(mapSymbol);
         }
     }
     if (queryController && queryController->isAborted())
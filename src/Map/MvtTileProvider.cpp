@@ -0,0 +1,88 @@
+#include "MvtTileProvider.h"
+#include "MvtTileProvider_P.h"
+
+#include "MapDataProviderHelpers.h"
+
+OsmAnd::MvtTileProvider::MvtTileProvider(
+    const std::shared_ptr<MapPrimitivesProvider>& primitivesProvider_,
+    const Configuration& configuration_ /*= Configuration()*/)
+    : _p(new MvtTileProvider_P(this))
+    , primitivesProvider(primitivesProvider_)
+    , configuration(configuration_)
+{
+}
+
+OsmAnd::MvtTileProvider::~MvtTileProvider()
+{
+}
+
+OsmAnd::ZoomLevel OsmAnd::MvtTileProvider::getMinZoom() const
+{
+    return primitivesProvider->getMinZoom();
+}
+
+OsmAnd::ZoomLevel OsmAnd::MvtTileProvider::getMaxZoom() const
+{
+    return primitivesProvider->getMaxZoom();
+}
+
+bool OsmAnd::MvtTileProvider::obtainTiledMvt(
+    const Request& request,
+    std::shared_ptr<Data>& outMvtTile)
+{
+    return _p->obtainTiledMvt(request, outMvtTile);
+}
+
+bool OsmAnd::MvtTileProvider::supportsNaturalObtainData() const
+{
+    return true;
+}
+
+bool OsmAnd::MvtTileProvider::obtainData(
+    const IMapDataProvider::Request& request,
+    std::shared_ptr<IMapDataProvider::Data>& outData,
+    std::shared_ptr<Metric>* const pOutMetric /*= nullptr*/)
+{
+    return _p->obtainData(request, outData, pOutMetric);
+}
+
+bool OsmAnd::MvtTileProvider::supportsNaturalObtainDataAsync() const
+{
+    return false;
+}
+
+void OsmAnd::MvtTileProvider::obtainDataAsync(
+    const IMapDataProvider::Request& request,
+    const IMapDataProvider::ObtainDataAsyncCallback callback,
+    const bool collectMetric /*= false*/)
+{
+    MapDataProviderHelpers::nonNaturalObtainDataAsync(this, request, callback, collectMetric);
+}
+
+OsmAnd::MvtTileProvider::Configuration::Configuration()
+    : extent(4096)
+    , buffer(64)
+    , simplificationTolerance(1.0f)
+    , fullDetailZoom(ZoomLevel16)
+    , includeCaptions(true)
+{
+}
+
+OsmAnd::MvtTileProvider::Data::Data(
+    const TileId tileId_,
+    const ZoomLevel zoom_,
+    const QByteArray& encodedTile_,
+    const unsigned int layersCount_,
+    const unsigned int featuresCount_,
+    const RetainableCacheMetadata* const pRetainableCacheMetadata_ /*= nullptr*/)
+    : IMapTiledDataProvider::Data(tileId_, zoom_, pRetainableCacheMetadata_)
+    , encodedTile(encodedTile_)
+    , layersCount(layersCount_)
+    , featuresCount(featuresCount_)
+{
+}
+
+OsmAnd::MvtTileProvider::Data::~Data()
+{
+    release();
+}
@@ -0,0 +1,675 @@
+#include "MvtTileProvider_P.h"
+#include "MvtTileProvider.h"
+
+#include "stdlib_common.h"
+#include <algorithm>
+
+#include "QtExtensions.h"
+#include "QtCommon.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QSet>
+#include <QPair>
+#include "restore_internal_warnings.h"
+
+#include "MapDataProviderHelpers.h"
+#include "MapPrimitivesProvider.h"
+#include "MapPrimitiviser.h"
+#include "ObfMapObject.h"
+#include "IQueryController.h"
+#include "Utilities.h"
+#include "Logging.h"
+
+OsmAnd::MvtTileProvider_P::MvtTileProvider_P(MvtTileProvider* owner_)
+    : owner(owner_)
+{
+}
+
+OsmAnd::MvtTileProvider_P::~MvtTileProvider_P()
+{
+}
+
+bool OsmAnd::MvtTileProvider_P::obtainData(
+    const IMapDataProvider::Request& request,
+    std::shared_ptr<IMapDataProvider::Data>& outData,
+    std::shared_ptr<Metric>* const pOutMetric)
+{
+    if (pOutMetric)
+        pOutMetric->reset();
+
+    std::shared_ptr<MvtTileProvider::Data> mvtTile;
+    const auto result = obtainTiledMvt(
+        MapDataProviderHelpers::castRequest<MvtTileProvider::Request>(request),
+        mvtTile);
+    outData = mvtTile;
+    return result;
+}
+
+bool OsmAnd::MvtTileProvider_P::obtainTiledMvt(
+    const MvtTileProvider::Request& request,
+    std::shared_ptr<MvtTileProvider::Data>& outMvtTile)
+{
+    typedef MapPrimitiviser::PrimitiveType PrimitiveType;
+
+    const auto& configuration = owner->configuration;
+
+    // Obtain offline map primitives tile
+    std::shared_ptr<MapPrimitivesProvider::Data> primitivesTile;
+    if (!owner->primitivesProvider->obtainTiledPrimitives(request, primitivesTile))
+        return false;
+
+    // If tile has nothing to be encoded, mark that data is not available for it
+    if (!primitivesTile || primitivesTile->primitivisedObjects->isEmpty())
+    {
+        outMvtTile.reset();
+        return true;
+    }
+
+    // MVT coordinates have origin in top-left corner of tile and same axes directions as 31-coordinates
+    const auto tileBBox31 = Utilities::tileBoundingBox31(request.tileId, request.zoom);
+    const auto scale31ToMvt = static_cast<double>(configuration.extent) /
+        static_cast<double>(1ull << (ZoomLevel31 - request.zoom));
+    AreaD clipBox;
+    clipBox.top() = -static_cast<double>(configuration.buffer);
+    clipBox.left() = -static_cast<double>(configuration.buffer);
+    clipBox.bottom() = static_cast<double>(configuration.extent + configuration.buffer);
+    clipBox.right() = static_cast<double>(configuration.extent + configuration.buffer);
+    const auto tolerance = (request.zoom < configuration.fullDetailZoom)
+        ? static_cast<double>(configuration.simplificationTolerance)
+        : 0.0;
+
+    VectorTile::Tile tile;
+    QHash<QString, LayerEncoder> layersEncoders;
+    unsigned int featuresCount = 0;
+    QVector<uint32_t> geometry;
+    for (const auto& primitivesGroup : constOf(primitivesTile->primitivisedObjects->primitivesGroups))
+    {
+        if (request.queryController && request.queryController->isAborted())
+            return false;
+
+        const auto& mapObject = primitivesGroup->sourceObject;
+        const auto obfMapObject = std::dynamic_pointer_cast<const ObfMapObject>(mapObject);
+
+        // Object matched by several rules of same tag and type would produce identical features
+        QSet< QPair<QString, int> > encodedPrimitives;
+        const MapPrimitiviser::PrimitivesCollection* const primitivesCollections[] = {
+            &primitivesGroup->polygons,
+            &primitivesGroup->polylines,
+            &primitivesGroup->points
+        };
+        for (const auto primitivesCollection : primitivesCollections)
+        {
+            for (const auto& primitive : constOf(*primitivesCollection))
+            {
+                const auto attribute = mapObject->resolveAttributeByIndex(primitive->attributeIdIndex);
+                if (!attribute || attribute->tag.isEmpty())
+                    continue;
+
+                const auto primitiveKey = qMakePair(attribute->tag, static_cast<int>(primitive->type));
+                if (encodedPrimitives.contains(primitiveKey))
+                    continue;
+                encodedPrimitives.insert(primitiveKey);
+
+                geometry.clear();
+                bool geometryEncoded = false;
+                VectorTile::Tile_GeomType geometryType = VectorTile::Tile_GeomType_UNKNOWN;
+                switch (primitive->type)
+                {
+                    case PrimitiveType::Polygon:
+                        geometryType = VectorTile::Tile_GeomType_POLYGON;
+                        geometryEncoded = encodePolygonGeometry(
+                            mapObject,
+                            tileBBox31,
+                            scale31ToMvt,
+                            clipBox,
+                            tolerance,
+                            geometry);
+                        break;
+                    case PrimitiveType::Polyline:
+                        geometryType = VectorTile::Tile_GeomType_LINESTRING;
+                        geometryEncoded = encodePolylineGeometry(
+                            mapObject,
+                            tileBBox31,
+                            scale31ToMvt,
+                            clipBox,
+                            tolerance,
+                            geometry);
+                        break;
+                    case PrimitiveType::Point:
+                        geometryType = VectorTile::Tile_GeomType_POINT;
+                        geometryEncoded = encodePointGeometry(
+                            mapObject,
+                            tileBBox31,
+                            scale31ToMvt,
+                            clipBox,
+                            geometry);
+                        break;
+                }
+                if (!geometryEncoded)
+                    continue;
+
+                auto& layerEncoder = layersEncoders[attribute->tag];
+                if (!layerEncoder.layer)
+                {
+                    layerEncoder.layer = tile.add_layers();
+                    layerEncoder.layer->set_version(2);
+                    layerEncoder.layer->set_name(attribute->tag.toStdString());
+                    layerEncoder.layer->set_extent(configuration.extent);
+                }
+
+                const auto feature = layerEncoder.layer->add_features();
+                if (obfMapObject)
+                    feature->set_id(obfMapObject->id.id);
+                feature->set_type(geometryType);
+                encodeAttributes(mapObject, layerEncoder, *feature);
+                for (const auto command : constOf(geometry))
+                    feature->add_geometry(command);
+                featuresCount++;
+            }
+        }
+    }
+
+    // Everything may have been clipped away
+    if (featuresCount == 0)
+    {
+        outMvtTile.reset();
+        return true;
+    }
+
+    std::string encodedTile;
+    if (!tile.SerializeToString(&encodedTile))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to serialize MVT tile %dx%d@%d",
+            request.tileId.x,
+            request.tileId.y,
+            request.zoom);
+        return false;
+    }
+
+    outMvtTile.reset(new MvtTileProvider::Data(
+        request.tileId,
+        request.zoom,
+        QByteArray(encodedTile.data(), static_cast<int>(encodedTile.size())),
+        static_cast<unsigned int>(tile.layers_size()),
+        featuresCount));
+    return true;
+}
+
+QVector<OsmAnd::PointD> OsmAnd::MvtTileProvider_P::transformPath(
+    const QVector<PointI>& path31,
+    const AreaI& tileBBox31,
+    const double scale31ToMvt,
+    const bool isRing)
+{
+    auto pointsCount = path31.size();
+    if (isRing && pointsCount > 1 && path31.first() == path31.last())
+        pointsCount--;
+
+    QVector<PointD> path(pointsCount);
+    auto pPoint = path.data();
+    auto pPoint31 = path31.constData();
+    for (auto pointIdx = 0; pointIdx < pointsCount; pointIdx++, pPoint++, pPoint31++)
+    {
+        pPoint->x = static_cast<double>(pPoint31->x - tileBBox31.left()) * scale31ToMvt;
+        pPoint->y = static_cast<double>(pPoint31->y - tileBBox31.top()) * scale31ToMvt;
+    }
+
+    return path;
+}
+
+bool OsmAnd::MvtTileProvider_P::clipSegment(
+    const PointD& p0,
+    const PointD& p1,
+    const AreaD& clipBox,
+    double& t0,
+    double& t1)
+{
+    // Liang-Barsky: t0 and t1 are narrowed to part of segment that is inside of clip box
+    const auto dx = p1.x - p0.x;
+    const auto dy = p1.y - p0.y;
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = {
+        p0.x - clipBox.left(),
+        clipBox.right() - p0.x,
+        p0.y - clipBox.top(),
+        clipBox.bottom() - p0.y
+    };
+
+    t0 = 0.0;
+    t1 = 1.0;
+    for (auto edgeIdx = 0; edgeIdx < 4; edgeIdx++)
+    {
+        if (p[edgeIdx] == 0.0)
+        {
+            // Parallel to edge and outside of it
+            if (q[edgeIdx] < 0.0)
+                return false;
+            continue;
+        }
+
+        const auto r = q[edgeIdx] / p[edgeIdx];
+        if (p[edgeIdx] < 0.0)
+        {
+            if (r > t1)
+                return false;
+            if (r > t0)
+                t0 = r;
+        }
+        else
+        {
+            if (r < t0)
+                return false;
+            if (r < t1)
+                t1 = r;
+        }
+    }
+
+    return true;
+}
+
+QList< QVector<OsmAnd::PointD> > OsmAnd::MvtTileProvider_P::clipPolyline(
+    const QVector<PointD>& polyline,
+    const AreaD& clipBox)
+{
+    QList< QVector<PointD> > parts;
+
+    // Each time polyline leaves clip box, new part is started
+    QVector<PointD> part;
+    const auto flushPart =
+        [&parts, &part]
+        ()
+        {
+            if (part.size() >= 2)
+                parts.push_back(part);
+            part.clear();
+        };
+    for (auto pointIdx = 1, pointsCount = polyline.size(); pointIdx < pointsCount; pointIdx++)
+    {
+        const auto& p0 = polyline[pointIdx - 1];
+        const auto& p1 = polyline[pointIdx];
+
+        double t0;
+        double t1;
+        if (!clipSegment(p0, p1, clipBox, t0, t1))
+        {
+            flushPart();
+            continue;
+        }
+
+        if (t0 > 0.0 || part.isEmpty())
+        {
+            flushPart();
+            part.push_back(PointD(p0.x + (p1.x - p0.x) * t0, p0.y + (p1.y - p0.y) * t0));
+        }
+        part.push_back(PointD(p0.x + (p1.x - p0.x) * t1, p0.y + (p1.y - p0.y) * t1));
+        if (t1 < 1.0)
+            flushPart();
+    }
+    flushPart();
+
+    return parts;
+}
+
+QVector<OsmAnd::PointD> OsmAnd::MvtTileProvider_P::clipRing(const QVector<PointD>& ring, const AreaD& clipBox)
+{
+    // Sutherland-Hodgman: ring is clipped by each edge of clip box in turn. Parts of ring outside of clip box
+    // collapse onto its edges, which keeps polygon closed.
+    QVector<PointD> output(ring);
+    for (auto edgeIdx = 0; edgeIdx < 4 && !output.isEmpty(); edgeIdx++)
+    {
+        const auto distanceInside =
+            [edgeIdx, &clipBox]
+            (const PointD& point) -> double
+            {
+                switch (edgeIdx)
+                {
+                    case 0:
+                        return point.x - clipBox.left();
+                    case 1:
+                        return clipBox.right() - point.x;
+                    case 2:
+                        return point.y - clipBox.top();
+                    default:
+                        return clipBox.bottom() - point.y;
+                }
+            };
+
+        const auto input = output;
+        output.clear();
+        output.reserve(input.size());
+
+        auto prevPoint = input.last();
+        auto prevDistance = distanceInside(prevPoint);
+        for (const auto& point : constOf(input))
+        {
+            const auto distance = distanceInside(point);
+            if ((distance >= 0.0) != (prevDistance >= 0.0))
+            {
+                const auto t = prevDistance / (prevDistance - distance);
+                output.push_back(PointD(
+                    prevPoint.x + (point.x - prevPoint.x) * t,
+                    prevPoint.y + (point.y - prevPoint.y) * t));
+            }
+            if (distance >= 0.0)
+                output.push_back(point);
+
+            prevPoint = point;
+            prevDistance = distance;
+        }
+    }
+
+    return output;
+}
+
+QVector<OsmAnd::PointD> OsmAnd::MvtTileProvider_P::simplify(const QVector<PointD>& path, const double tolerance)
+{
+    const auto pointsCount = path.size();
+    if (tolerance <= 0.0 || pointsCount <= 2)
+        return path;
+
+    const auto squaredSegmentDistance =
+        []
+        (const PointD& point, const PointD& p0, const PointD& p1) -> double
+        {
+            auto x = p0.x;
+            auto y = p0.y;
+            const auto dx = p1.x - x;
+            const auto dy = p1.y - y;
+            if (dx != 0.0 || dy != 0.0)
+            {
+                const auto t = ((point.x - x) * dx + (point.y - y) * dy) / (dx * dx + dy * dy);
+                if (t > 1.0)
+                {
+                    x = p1.x;
+                    y = p1.y;
+                }
+                else if (t > 0.0)
+                {
+                    x += dx * t;
+                    y += dy * t;
+                }
+            }
+
+            return (point.x - x) * (point.x - x) + (point.y - y) * (point.y - y);
+        };
+
+    // Douglas-Peucker without recursion, since paths of coastlines and borders may be very long
+    const auto squaredTolerance = tolerance * tolerance;
+    QVector<bool> keepPoint(pointsCount, false);
+    keepPoint[0] = true;
+    keepPoint[pointsCount - 1] = true;
+    QVector< QPair<int, int> > ranges;
+    ranges.push_back(qMakePair(0, pointsCount - 1));
+    while (!ranges.isEmpty())
+    {
+        const auto range = ranges.last();
+        ranges.pop_back();
+
+        auto maxSquaredDistance = squaredTolerance;
+        auto farthestPointIdx = -1;
+        for (auto pointIdx = range.first + 1; pointIdx < range.second; pointIdx++)
+        {
+            const auto squaredDistance = squaredSegmentDistance(path[pointIdx], path[range.first], path[range.second]);
+            if (squaredDistance > maxSquaredDistance)
+            {
+                maxSquaredDistance = squaredDistance;
+                farthestPointIdx = pointIdx;
+            }
+        }
+        if (farthestPointIdx < 0)
+            continue;
+
+        keepPoint[farthestPointIdx] = true;
+        ranges.push_back(qMakePair(range.first, farthestPointIdx));
+        ranges.push_back(qMakePair(farthestPointIdx, range.second));
+    }
+
+    QVector<PointD> simplifiedPath;
+    simplifiedPath.reserve(pointsCount);
+    for (auto pointIdx = 0; pointIdx < pointsCount; pointIdx++)
+    {
+        if (keepPoint[pointIdx])
+            simplifiedPath.push_back(path[pointIdx]);
+    }
+
+    return simplifiedPath;
+}
+
+QVector<OsmAnd::PointI> OsmAnd::MvtTileProvider_P::quantize(const QVector<PointD>& path, const bool isRing)
+{
+    QVector<PointI> quantizedPath;
+    quantizedPath.reserve(path.size());
+    for (const auto& point : constOf(path))
+    {
+        const PointI quantizedPoint(qRound(point.x), qRound(point.y));
+        if (!quantizedPath.isEmpty() && quantizedPath.last() == quantizedPoint)
+            continue;
+        quantizedPath.push_back(quantizedPoint);
+    }
+
+    // ClosePath command closes ring, so ring itself has to be open
+    if (isRing)
+    {
+        while (quantizedPath.size() > 1 && quantizedPath.last() == quantizedPath.first())
+            quantizedPath.pop_back();
+    }
+
+    return quantizedPath;
+}
+
+int64_t OsmAnd::MvtTileProvider_P::doubledSignedArea(const QVector<PointI>& ring)
+{
+    int64_t area = 0;
+
+    auto p0 = &ring.last();
+    for (const auto& point : constOf(ring))
+    {
+        area +=
+            static_cast<int64_t>(p0->x) * static_cast<int64_t>(point.y) -
+            static_cast<int64_t>(point.x) * static_cast<int64_t>(p0->y);
+        p0 = &point;
+    }
+
+    return area;
+}
+
+void OsmAnd::MvtTileProvider_P::encodePath(
+    const QVector<PointI>& path,
+    const bool isRing,
+    PointI& cursor,
+    QVector<uint32_t>& outGeometry)
+{
+    const auto command =
+        []
+        (const GeometryCommand id, const int count) -> uint32_t
+        {
+            return (static_cast<uint32_t>(id) & 0x7) | (static_cast<uint32_t>(count) << 3);
+        };
+    const auto zigZag =
+        []
+        (const int32_t value) -> uint32_t
+        {
+            return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        };
+
+    // Coordinates are relative to cursor, which is carried over from previous path of same feature
+    const auto pathSize = path.size();
+    for (auto pointIdx = 0; pointIdx < pathSize; pointIdx++)
+    {
+        if (pointIdx == 0)
+            outGeometry.push_back(command(GeometryCommand::MoveTo, 1));
+        else if (pointIdx == 1)
+            outGeometry.push_back(command(GeometryCommand::LineTo, pathSize - 1));
+
+        const auto& point = path[pointIdx];
+        outGeometry.push_back(zigZag(point.x - cursor.x));
+        outGeometry.push_back(zigZag(point.y - cursor.y));
+        cursor = point;
+    }
+    if (isRing)
+        outGeometry.push_back(command(GeometryCommand::ClosePath, 1));
+}
+
+bool OsmAnd::MvtTileProvider_P::encodePolylineGeometry(
+    const std::shared_ptr<const MapObject>& mapObject,
+    const AreaI& tileBBox31,
+    const double scale31ToMvt,
+    const AreaD& clipBox,
+    const double tolerance,
+    QVector<uint32_t>& outGeometry) const
+{
+    const auto polyline = transformPath(mapObject->points31, tileBBox31, scale31ToMvt, false);
+    if (polyline.size() < 2)
+        return false;
+
+    PointI cursor(0, 0);
+    const auto parts = clipPolyline(polyline, clipBox);
+    for (const auto& part : parts)
+    {
+        const auto quantizedPart = quantize(simplify(part, tolerance), false);
+        if (quantizedPart.size() < 2)
+            continue;
+
+        encodePath(quantizedPart, false, cursor, outGeometry);
+    }
+
+    return !outGeometry.isEmpty();
+}
+
+bool OsmAnd::MvtTileProvider_P::encodePolygonGeometry(
+    const std::shared_ptr<const MapObject>& mapObject,
+    const AreaI& tileBBox31,
+    const double scale31ToMvt,
+    const AreaD& clipBox,
+    const double tolerance,
+    QVector<uint32_t>& outGeometry) const
+{
+    PointI cursor(0, 0);
+    const auto encodeRing =
+        [tileBBox31, scale31ToMvt, clipBox, tolerance, &cursor, &outGeometry]
+        (const QVector<PointI>& ring31, const bool isOuter) -> bool
+        {
+            auto ring = clipRing(transformPath(ring31, tileBBox31, scale31ToMvt, true), clipBox);
+            if (ring.size() < 3)
+                return false;
+
+            // Simplification has to see ring closed, otherwise segment between last and first point is not kept
+            ring.push_back(ring.first());
+            auto quantizedRing = quantize(simplify(ring, tolerance), true);
+            if (quantizedRing.size() < 3)
+                return false;
+
+            // Exterior ring has positive area in coordinates with Y axis pointing down, interior rings negative
+            const auto doubledArea = doubledSignedArea(quantizedRing);
+            if (doubledArea == 0)
+                return false;
+            if ((doubledArea > 0) != isOuter)
+                std::reverse(quantizedRing.begin(), quantizedRing.end());
+
+            encodePath(quantizedRing, true, cursor, outGeometry);
+            return true;
+        };
+
+    // Holes make no sense without polygon they are cut from
+    if (!encodeRing(mapObject->points31, true))
+        return false;
+    for (const auto& innerPolygon31 : constOf(mapObject->innerPolygonsPoints31))
+        encodeRing(innerPolygon31, false);
+
+    return true;
+}
+
+bool OsmAnd::MvtTileProvider_P::encodePointGeometry(
+    const std::shared_ptr<const MapObject>& mapObject,
+    const AreaI& tileBBox31,
+    const double scale31ToMvt,
+    const AreaD& clipBox,
+    QVector<uint32_t>& outGeometry) const
+{
+    // Point of linear or area object is put into center of its bounding box
+    if (mapObject->points31.isEmpty())
+        return false;
+    const auto point31 = (mapObject->points31.size() == 1)
+        ? mapObject->points31.first()
+        : mapObject->bbox31.center();
+
+    const PointD point(
+        static_cast<double>(point31.x - tileBBox31.left()) * scale31ToMvt,
+        static_cast<double>(point31.y - tileBBox31.top()) * scale31ToMvt);
+    if (point.x < clipBox.left() || point.x > clipBox.right() || point.y < clipBox.top() || point.y > clipBox.bottom())
+        return false;
+
+    PointI cursor(0, 0);
+    encodePath(QVector<PointI>() << PointI(qRound(point.x), qRound(point.y)), false, cursor, outGeometry);
+
+    return true;
+}
+
+void OsmAnd::MvtTileProvider_P::encodeAttributes(
+    const std::shared_ptr<const MapObject>& mapObject,
+    LayerEncoder& layerEncoder,
+    VectorTile::Tile_Feature& outFeature) const
+{
+    // MVT does not allow same key twice in one feature, so first occurrence wins
+    QSet<QString> encodedKeys;
+    const auto encodeTag =
+        [&layerEncoder, &outFeature, &encodedKeys]
+        (const QString& key, const QString& value)
+        {
+            if (key.isEmpty() || encodedKeys.contains(key))
+                return;
+            encodedKeys.insert(key);
+
+            outFeature.add_tags(layerEncoder.obtainKeyIndex(key));
+            outFeature.add_tags(layerEncoder.obtainValueIndex(value));
+        };
+
+    const auto& decodeMap = mapObject->attributeMapping->decodeMap;
+    for (const auto attributeId : constOf(mapObject->attributeIds))
+    {
+        if (const auto attribute = decodeMap.getRef(attributeId))
+            encodeTag(attribute->tag, attribute->value);
+    }
+    for (const auto attributeId : constOf(mapObject->additionalAttributeIds))
+    {
+        if (const auto attribute = decodeMap.getRef(attributeId))
+            encodeTag(attribute->tag, attribute->value);
+    }
+
+    if (!owner->configuration.includeCaptions)
+        return;
+    for (const auto captionAttributeId : constOf(mapObject->captionsOrder))
+    {
+        if (const auto attribute = decodeMap.getRef(captionAttributeId))
+            encodeTag(attribute->tag, mapObject->captions.value(captionAttributeId));
+    }
+}
+
+OsmAnd::MvtTileProvider_P::LayerEncoder::LayerEncoder()
+    : layer(nullptr)
+{
+}
+
+uint32_t OsmAnd::MvtTileProvider_P::LayerEncoder::obtainKeyIndex(const QString& key)
+{
+    const auto citIndex = keysIndices.constFind(key);
+    if (citIndex != keysIndices.cend())
+        return *citIndex;
+
+    const auto index = static_cast<uint32_t>(layer->keys_size());
+    layer->add_keys(key.toStdString());
+    keysIndices.insert(key, index);
+    return index;
+}
+
+uint32_t OsmAnd::MvtTileProvider_P::LayerEncoder::obtainValueIndex(const QString& value)
+{
+    const auto citIndex = valuesIndices.constFind(value);
+    if (citIndex != valuesIndices.cend())
+        return *citIndex;
+
+    const auto index = static_cast<uint32_t>(layer->values_size());
+    layer->add_values()->set_string_value(value.toStdString());
+    valuesIndices.insert(value, index);
+    return index;
+}
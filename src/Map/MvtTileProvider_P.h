@@ -0,0 +1,109 @@
+#ifndef _OSMAND_CORE_MVT_TILE_PROVIDER_P_H_
+#define _OSMAND_CORE_MVT_TILE_PROVIDER_P_H_
+
+#include "stdlib_common.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include "restore_internal_warnings.h"
+
+#include "ignore_warnings_on_external_includes.h"
+#include "vector_tile.pb.h"
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+#include "PrivateImplementation.h"
+#include "IMapTiledDataProvider.h"
+#include "MapObject.h"
+#include "MvtTileProvider.h"
+
+namespace OsmAnd
+{
+    class MvtTileProvider_P Q_DECL_FINAL
+    {
+    private:
+        enum class GeometryCommand : uint32_t
+        {
+            MoveTo = 1,
+            LineTo = 2,
+            ClosePath = 7,
+        };
+
+        // Keys and values are shared by all features of layer
+        struct LayerEncoder
+        {
+            LayerEncoder();
+
+            VectorTile::Tile_Layer* layer;
+            QHash<QString, uint32_t> keysIndices;
+            QHash<QString, uint32_t> valuesIndices;
+
+            uint32_t obtainKeyIndex(const QString& key);
+            uint32_t obtainValueIndex(const QString& value);
+        };
+
+        static bool clipSegment(const PointD& p0, const PointD& p1, const AreaD& clipBox, double& t0, double& t1);
+        static QList< QVector<PointD> > clipPolyline(const QVector<PointD>& polyline, const AreaD& clipBox);
+        static QVector<PointD> clipRing(const QVector<PointD>& ring, const AreaD& clipBox);
+        static QVector<PointD> simplify(const QVector<PointD>& path, const double tolerance);
+        static QVector<PointI> quantize(const QVector<PointD>& path, const bool isRing);
+        static int64_t doubledSignedArea(const QVector<PointI>& ring);
+        static void encodePath(
+            const QVector<PointI>& path,
+            const bool isRing,
+            PointI& cursor,
+            QVector<uint32_t>& outGeometry);
+        static QVector<PointD> transformPath(
+            const QVector<PointI>& path31,
+            const AreaI& tileBBox31,
+            const double scale31ToMvt,
+            const bool isRing);
+
+        bool encodePolylineGeometry(
+            const std::shared_ptr<const MapObject>& mapObject,
+            const AreaI& tileBBox31,
+            const double scale31ToMvt,
+            const AreaD& clipBox,
+            const double tolerance,
+            QVector<uint32_t>& outGeometry) const;
+        bool encodePolygonGeometry(
+            const std::shared_ptr<const MapObject>& mapObject,
+            const AreaI& tileBBox31,
+            const double scale31ToMvt,
+            const AreaD& clipBox,
+            const double tolerance,
+            QVector<uint32_t>& outGeometry) const;
+        bool encodePointGeometry(
+            const std::shared_ptr<const MapObject>& mapObject,
+            const AreaI& tileBBox31,
+            const double scale31ToMvt,
+            const AreaD& clipBox,
+            QVector<uint32_t>& outGeometry) const;
+        void encodeAttributes(
+            const std::shared_ptr<const MapObject>& mapObject,
+            LayerEncoder& layerEncoder,
+            VectorTile::Tile_Feature& outFeature) const;
+    protected:
+        MvtTileProvider_P(MvtTileProvider* owner);
+    public:
+        ~MvtTileProvider_P();
+
+        ImplementationInterface<MvtTileProvider> owner;
+
+        bool obtainData(
+            const IMapDataProvider::Request& request,
+            std::shared_ptr<IMapDataProvider::Data>& outData,
+            std::shared_ptr<Metric>* const pOutMetric);
+        bool obtainTiledMvt(
+            const MvtTileProvider::Request& request,
+            std::shared_ptr<MvtTileProvider::Data>& outMvtTile);
+
+    friend class OsmAnd::MvtTileProvider;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_MVT_TILE_PROVIDER_P_H_)
@@ -16,6 +16,8 @@
 #include "ObfRoutingSectionReader_Metrics.h"
 #include "Road.h"
 #include "Stopwatch.h"
+#include "MetricsRegistry.h"
+#include "Tracer.h"
 #include "Utilities.h"
 #include "Logging.h"
 
@@ -60,12 +62,27 @@ bool OsmAnd::ObfMapObjectsProvider_P::obtainTiledObfMapObjects(
     std::shared_ptr<ObfMapObjectsProvider::Data>& outMapObjects,
     ObfMapObjectsProvider_Metrics::Metric_obtainData* const metric_)
 {
-#if OSMAND_PERFORMANCE_METRICS
+    OSMAND_TRACE_TASK_SPAN("ObfMapObjectsProvider::obtainTiledObfMapObjects",
+        Tracer::getTileTaskId(request.tileId, request.zoom));
+
+    // Metric of this call only, it's merged into caller's metric at the end
     ObfMapObjectsProvider_Metrics::Metric_obtainData localMetric;
-    const auto metric = metric_ ? metric_ : &localMetric;
+#if OSMAND_PERFORMANCE_METRICS
+    const auto metric = &localMetric;
 #else
-    const auto metric = metric_;
+    const auto metric = (metric_ || MetricsRegistry::getDefault().isEnabled()) ? &localMetric : nullptr;
 #endif
+    const auto mergeLocalMetric =
+        [metric_, &localMetric]
+        ()
+        {
+            if (!metric_)
+                return;
+
+            metric_->accumulate(localMetric);
+            for (const auto& submetric : localMetric.submetrics)
+                metric_->addOrReplaceSubmetric(submetric.shared_ptr());
+        };
 
     std::shared_ptr<TileEntry> tileEntry;
 
@@ -106,13 +123,8 @@ bool OsmAnd::ObfMapObjectsProvider_P::obtainTiledObfMapObjects(
         tileEntry.reset();
     }
 
-    const Stopwatch totalTimeStopwatch(
-#if OSMAND_PERFORMANCE_METRICS
-        true
-#else
-        metric != nullptr
-#endif // OSMAND_PERFORMANCE_METRICS
-        );
+    // Always measured, since it's also reported to metrics registry
+    const Stopwatch totalTimeStopwatch(true);
 
     // Get bounding box that covers this tile
     const auto tileBBox31 = Utilities::tileBoundingBox31(request.tileId, request.zoom);
@@ -482,6 +494,14 @@ bool OsmAnd::ObfMapObjectsProvider_P::obtainTiledObfMapObjects(
         metric->uniqueObjectsCount += allMapObjects.size() - sharedMapObjectsCount;
         metric->sharedObjectsCount += sharedMapObjectsCount;
     }
+    if (metric)
+    {
+        static MetricsRegistry::MetricRecorder tileDecodeRecorder(
+            MetricsRegistry::getDefault(),
+            QLatin1String("tile_decode"));
+        tileDecodeRecorder.record(*metric);
+    }
+    mergeLocalMetric();
 
 #if OSMAND_PERFORMANCE_METRICS
 #if OSMAND_PERFORMANCE_METRICS <= 1
@@ -49,8 +49,21 @@ void OsmAnd::OnlineRasterMapLayerProvider::setLocalCachePath(
         : localCachePath;
 }
 
+void OsmAnd::OnlineRasterMapLayerProvider::setLocalCache(const std::shared_ptr<SqliteTilesCache>& localCache)
+{
+    QMutexLocker scopedLocker(&_p->_localCachePathMutex);
+    _p->_localCache = localCache;
+}
+
+std::shared_ptr<OsmAnd::SqliteTilesCache> OsmAnd::OnlineRasterMapLayerProvider::getLocalCache() const
+{
+    QMutexLocker scopedLocker(&_p->_localCachePathMutex);
+    return _p->_localCache;
+}
+
 void OsmAnd::OnlineRasterMapLayerProvider::setNetworkAccessPermission(bool allowed)
 {
+    QMutexLocker scopedLocker(&_p->_localCachePathMutex);
     _p->_networkAccessAllowed = allowed;
 }
 
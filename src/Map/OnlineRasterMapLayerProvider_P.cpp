@@ -8,6 +8,7 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QFile>
+#include <QDateTime>
 
 #include "ignore_warnings_on_external_includes.h"
 #include <SkStream.h>
@@ -58,11 +59,65 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
         QString::number(request.tileId.x) + QDir::separator() +
         QString::number(request.tileId.y) + QLatin1String(".tile");
     QFileInfo localFile;
+    std::shared_ptr<SqliteTilesCache> localCache;
+    bool networkAccessAllowed;
     {
         QMutexLocker scopedLocker(&_localCachePathMutex);
         localFile.setFile(QDir(_localCachePath).absoluteFilePath(tileLocalRelativePath));
+        localCache = _localCache;
+        networkAccessAllowed = _networkAccessAllowed;
     }
-    if (localFile.exists())
+    QByteArray expiredTileData;
+    bool hasExpiredTile = false;
+    if (localCache)
+    {
+        QByteArray tileData;
+        bool isExpired = false;
+        if (localCache->obtainTile(request.tileId, request.zoom, tileData, &isExpired))
+        {
+            // Expired tile is used only if there's no way to download fresh one
+            if (isExpired && networkAccessAllowed)
+            {
+                hasExpiredTile = true;
+                expiredTileData = tileData;
+            }
+            else
+            {
+                unlockTile(request.tileId, request.zoom);
+
+                // If tile data is empty, it means that requested tile does not exist (has no data)
+                if (tileData.isEmpty())
+                {
+                    outData.reset();
+                    return true;
+                }
+
+                const auto bitmap = decodeTile(tileData);
+                if (!bitmap)
+                {
+                    LogPrintf(LogSeverityLevel::Error,
+                        "Failed to decode tile %dx%d@%d from '%s'",
+                        request.tileId.x,
+                        request.tileId.y,
+                        request.zoom,
+                        qPrintable(localCache->filePath));
+
+                    localCache->removeTile(request.tileId, request.zoom);
+                    return false;
+                }
+
+                outData.reset(new OnlineRasterMapLayerProvider::Data(
+                    request.tileId,
+                    request.zoom,
+                    owner->alphaChannelPresence,
+                    owner->getTileDensityFactor(),
+                    bitmap));
+
+                return true;
+            }
+        }
+    }
+    else if (localFile.exists())
     {
         // Since tile is in local storage, it's safe to unmark it as being processed
         unlockTile(request.tileId, request.zoom);
@@ -111,7 +166,7 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
     // the tile must be downloaded from network:
 
     // If network access is disallowed, return failure
-    if (!_networkAccessAllowed)
+    if (!networkAccessAllowed)
     {
         // Before returning, unlock tile
         unlockTile(request.tileId, request.zoom);
@@ -125,7 +180,11 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
     const auto& downloadResult = _downloadManager->downloadData(tileUrl, &requestResult);
 
     // Ensure that all directories are created in path to local tile
-    localFile.dir().mkpath(QLatin1String("."));
+    if (!localCache)
+        localFile.dir().mkpath(QLatin1String("."));
+    const auto expirationTime = owner->_tileSource->expirationTimeMillis > 0
+        ? QDateTime::currentDateTimeUtc().addMSecs(owner->_tileSource->expirationTimeMillis)
+        : QDateTime();
 
     // If there was error, check what the error was
     if (requestResult != nullptr && !requestResult->isSuccessful())
@@ -137,6 +196,15 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
             qPrintable(tileUrl),
             httpStatus);
 
+        // 404 means that this tile does not exist, so cache an empty tile
+        if (httpStatus == 404 && localCache)
+        {
+            localCache->storeTile(request.tileId, request.zoom, QByteArray(), expirationTime);
+
+            unlockTile(request.tileId, request.zoom);
+            return true;
+        }
+
         // 404 means that this tile does not exist, so create a zero file
         if (httpStatus == 404)
         {
@@ -164,6 +232,29 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
 
         // Unlock the tile
         unlockTile(request.tileId, request.zoom);
+
+        // Outdated tile is still better than nothing
+        if (hasExpiredTile)
+        {
+            if (expiredTileData.isEmpty())
+            {
+                outData.reset();
+                return true;
+            }
+
+            const auto bitmap = decodeTile(expiredTileData);
+            if (!bitmap)
+                return false;
+
+            outData.reset(new OnlineRasterMapLayerProvider::Data(
+                request.tileId,
+                request.zoom,
+                owner->alphaChannelPresence,
+                owner->getTileDensityFactor(),
+                bitmap));
+            return true;
+        }
+
         return false;
     }
 
@@ -172,9 +263,13 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
         "Downloaded tile from %s",
         qPrintable(tileUrl));
 
-    // Save to a file
+    // Save to cache or to a file
     QFile tileFile(localFile.absoluteFilePath());
-    if (tileFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    if (localCache)
+    {
+        localCache->storeTile(request.tileId, request.zoom, downloadResult, expirationTime);
+    }
+    else if (tileFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
     {
         tileFile.write(downloadResult);
         tileFile.close();
@@ -195,12 +290,8 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
     unlockTile(request.tileId, request.zoom);
 
     // Decode in-memory
-    const std::shared_ptr<SkBitmap> bitmap(new SkBitmap());
-    if (!SkImageDecoder::DecodeMemory(
-            downloadResult.constData(), downloadResult.size(),
-            bitmap.get(),
-            SkColorType::kUnknown_SkColorType,
-            SkImageDecoder::kDecodePixels_Mode))
+    const auto bitmap = decodeTile(downloadResult);
+    if (!bitmap)
     {
         LogPrintf(LogSeverityLevel::Error,
             "Failed to decode tile file from '%s'",
@@ -222,6 +313,21 @@ bool OsmAnd::OnlineRasterMapLayerProvider_P::obtainData(
     return true;
 }
 
+std::shared_ptr<SkBitmap> OsmAnd::OnlineRasterMapLayerProvider_P::decodeTile(const QByteArray& data)
+{
+    const std::shared_ptr<SkBitmap> bitmap(new SkBitmap());
+    if (!SkImageDecoder::DecodeMemory(
+            data.constData(), data.size(),
+            bitmap.get(),
+            SkColorType::kUnknown_SkColorType,
+            SkImageDecoder::kDecodePixels_Mode))
+    {
+        return nullptr;
+    }
+
+    return bitmap;
+}
+
 void OsmAnd::OnlineRasterMapLayerProvider_P::lockTile(const TileId tileId, const ZoomLevel zoom)
 {
     QMutexLocker scopedLocker(&_tilesInProcessMutex);
@@ -19,6 +19,9 @@
 #include "IRasterMapLayerProvider.h"
 #include "OnlineRasterMapLayerProvider.h"
 #include "IWebClient.h"
+#include "SqliteTilesCache.h"
+
+class SkBitmap;
 
 namespace OsmAnd
 {
@@ -28,6 +31,7 @@ namespace OsmAnd
         static const QString buildUrlToLoad(const QString& urlToLoad, const QList<QString> randomsArray, int32_t x, int32_t y, const ZoomLevel zoom);
         static const QString eqtBingQuadKey(ZoomLevel z, int32_t x, int32_t y);
         const QString getUrlToLoad(int32_t x, int32_t y, const ZoomLevel zoom) const;
+        static std::shared_ptr<SkBitmap> decodeTile(const QByteArray& data);
     protected:
         OnlineRasterMapLayerProvider_P(
             OnlineRasterMapLayerProvider* owner,
@@ -35,8 +39,10 @@ namespace OsmAnd
 
         const std::shared_ptr<const IWebClient> _downloadManager;
 
+        // Guards local cache settings and network access permission, since they may be changed at any time
         mutable QMutex _localCachePathMutex;
         QString _localCachePath;
+        std::shared_ptr<SqliteTilesCache> _localCache;
         bool _networkAccessAllowed;
 
         mutable QMutex _tilesInProcessMutex;
@@ -20,6 +20,10 @@
 OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::AtlasMapRendererSymbolsStage_OpenGL(AtlasMapRenderer_OpenGL* const renderer_)
     : AtlasMapRendererSymbolsStage(renderer_)
     , AtlasMapRendererStageHelper_OpenGL(this)
+    , _lastUsedSymbolTexture(nullptr)
+    , _symbolsDrawCalls(0)
+    , _symbolsTextureBinds(0)
+    , _billboardRasterMaxSymbolsPerDrawCall(0)
     , _onPathSymbol2dMaxGlyphsPerDrawCall(0)
     , _onPathSymbol3dMaxGlyphsPerDrawCall(0)
 {
@@ -29,6 +33,20 @@ OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::~AtlasMapRendererSymbolsStage_OpenG
 {
 }
 
+OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::BillboardRasterSymbolsBatch::BillboardRasterSymbolsBatch()
+    : texture(nullptr)
+    , alphaChannelType(AlphaChannelType::Straight)
+    , symbolsCount(0)
+{
+}
+
+void OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::BillboardRasterSymbolsBatch::reset()
+{
+    texture = nullptr;
+    symbolsCount = 0;
+    symbolsData.resize(0);
+}
+
 bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initialize()
 {
     bool ok = true;
@@ -52,6 +70,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::render(IMapRenderer_Metrics::M
     GL_CHECK_PRESENT(glUniform1f);
     GL_CHECK_PRESENT(glUniform2f);
     GL_CHECK_PRESENT(glUniform3f);
+    GL_CHECK_PRESENT(glUniform4fv);
     GL_CHECK_PRESENT(glDrawElements);
 
     const auto gpuAPI = getGPUAPI();
@@ -59,28 +78,45 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::render(IMapRenderer_Metrics::M
 
     prepare(metric);
 
+    _lastUsedSymbolTexture = nullptr;
+    _billboardRasterSymbolsBatch.reset();
+    _symbolsDrawCalls = 0;
+    _symbolsTextureBinds = 0;
+
     // Initially, configure for straight alpha channel type
     auto currentAlphaChannelType = AlphaChannelType::Straight;
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     GL_CHECK_RESULT;
 
+    Stopwatch submissionStopwatch(metric != nullptr);
     GLname lastUsedProgram;
     for (const auto& renderable_ : constOf(renderableSymbols))
     {
         if (const auto& renderable = std::dynamic_pointer_cast<const RenderableBillboardSymbol>(renderable_))
         {
             Stopwatch renderBillboardSymbolStopwatch(metric != nullptr);
-            ok = ok && renderBillboardSymbol(
+            ok = renderBillboardSymbol(
                 renderable,
                 currentAlphaChannelType,
-                lastUsedProgram);
+                lastUsedProgram) && ok;
             if (metric)
             {
                 metric->elapsedTimeForBillboardSymbolsRendering += renderBillboardSymbolStopwatch.elapsed();
                 metric->billboardSymbolsRendered += 1;
             }
+            continue;
         }
-        else if (const auto& renderable = std::dynamic_pointer_cast<const RenderableOnPathSymbol>(renderable_))
+
+        // Symbols have to be drawn in order, so whatever is batched has to be drawn before anything else
+        if (_billboardRasterSymbolsBatch.symbolsCount > 0)
+        {
+            Stopwatch flushBillboardSymbolsStopwatch(metric != nullptr);
+            ok = flushBillboardRasterSymbolsBatch(currentAlphaChannelType, lastUsedProgram) && ok;
+            if (metric)
+                metric->elapsedTimeForBillboardSymbolsRendering += flushBillboardSymbolsStopwatch.elapsed();
+        }
+
+        if (const auto& renderable = std::dynamic_pointer_cast<const RenderableOnPathSymbol>(renderable_))
         {
             Stopwatch renderOnPathSymbolStopwatch(metric != nullptr);
             ok = ok && renderOnPathSymbol(
@@ -107,6 +143,20 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::render(IMapRenderer_Metrics::M
             }
         }
     }
+    if (_billboardRasterSymbolsBatch.symbolsCount > 0)
+    {
+        Stopwatch flushBillboardSymbolsStopwatch(metric != nullptr);
+        ok = flushBillboardRasterSymbolsBatch(currentAlphaChannelType, lastUsedProgram) && ok;
+        if (metric)
+            metric->elapsedTimeForBillboardSymbolsRendering += flushBillboardSymbolsStopwatch.elapsed();
+    }
+
+    if (metric)
+    {
+        metric->symbolsDrawCalls += _symbolsDrawCalls;
+        metric->symbolsTextureBinds += _symbolsTextureBinds;
+        metric->elapsedTimeForSymbolsSubmission += submissionStopwatch.elapsed();
+    }
 
     // Unbind symbol texture from texture sampler
     glActiveTexture(GL_TEXTURE0 + 0);
@@ -125,6 +175,27 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::render(IMapRenderer_Metrics::M
     return ok;
 }
 
+void OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::useSymbolTexture(const GPUAPI::RefInGPU texture)
+{
+    const auto gpuAPI = getGPUAPI();
+
+    GL_CHECK_PRESENT(glBindTexture);
+
+    if (_lastUsedSymbolTexture == texture)
+        return;
+
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<intptr_t>(texture)));
+    GL_CHECK_RESULT;
+    _lastUsedSymbolTexture = texture;
+
+    // Apply settings from texture block to texture
+    if (texture)
+    {
+        gpuAPI->applyTextureBlockToTexture(GL_TEXTURE_2D, GL_TEXTURE0 + 0);
+        _symbolsTextureBinds++;
+    }
+}
+
 bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderBillboardSymbol(
     const std::shared_ptr<const RenderableBillboardSymbol>& renderable,
     AlphaChannelType &currentAlphaChannelType,
@@ -214,6 +285,145 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRaster()
     GL_CHECK_PRESENT(glBufferData);
     GL_CHECK_PRESENT(glEnableVertexAttribArray);
     GL_CHECK_PRESENT(glVertexAttribPointer);
+
+    const auto alreadyOccupiedUniforms =
+        4 /*param_vs_mPerspectiveProjectionView*/ +
+        4 /*param_vs_mOrthographicProjection*/ +
+        1 /*param_vs_viewport*/;
+    _billboardRasterMaxSymbolsPerDrawCall =
+        (gpuAPI->maxVertexUniformVectors - alreadyOccupiedUniforms) / BillboardRasterSymbolVectors;
+    if (initializeBillboardRasterProgram(_billboardRasterMaxSymbolsPerDrawCall))
+    {
+        LogPrintf(LogSeverityLevel::Info,
+            "This device is capable of rendering %d billboard raster symbols at a time",
+            _billboardRasterMaxSymbolsPerDrawCall);
+    }
+    else
+    {
+        bool initializedProgram = false;
+        if (_billboardRasterMaxSymbolsPerDrawCall > 1)
+        {
+            for (auto testMaxSymbolsPerDrawCall = _billboardRasterMaxSymbolsPerDrawCall - 1; testMaxSymbolsPerDrawCall >= 1; testMaxSymbolsPerDrawCall--)
+            {
+                if (!initializeBillboardRasterProgram(testMaxSymbolsPerDrawCall))
+                    continue;
+
+                LogPrintf(LogSeverityLevel::Warning,
+                    "Seems like buggy driver. This device should be capable of rendering %d billboard raster symbols at a time, but only %d symbols variant compiles",
+                    _billboardRasterMaxSymbolsPerDrawCall,
+                    testMaxSymbolsPerDrawCall);
+                _billboardRasterMaxSymbolsPerDrawCall = testMaxSymbolsPerDrawCall;
+                initializedProgram = true;
+                break;
+            }
+        }
+
+        if (!initializedProgram)
+        {
+            LogPrintf(LogSeverityLevel::Error,
+                "Seems like buggy driver. This device should be capable of rendering %d billboard raster symbols at a time, but it fails to compile program even for 1",
+                _billboardRasterMaxSymbolsPerDrawCall);
+            return false;
+        }
+    }
+
+#pragma pack(push, 1)
+    struct Vertex
+    {
+        // XY coordinates. Z is assumed to be 0
+        float positionXY[2];
+
+        // Index of symbol in batch
+        //NOTE: Here should be int to omit conversion float->int, but it's not supported in OpenGLES 2.0
+        float symbolIndex;
+
+        // UV coordinates
+        float textureUV[2];
+    };
+#pragma pack(pop)
+
+    // Vertex data
+    const Vertex templateVertices[4] =
+    {
+        // In OpenGL, UV origin is BL. But since same rule applies to uploading texture data,
+        // texture in memory is vertically flipped, so swap bottom and top UVs
+        { { -0.5f, -0.5f }, 0, { 0.0f, 1.0f } },//BL
+        { { -0.5f,  0.5f }, 0, { 0.0f, 0.0f } },//TL
+        { {  0.5f,  0.5f }, 0, { 1.0f, 0.0f } },//TR
+        { {  0.5f, -0.5f }, 0, { 1.0f, 1.0f } } //BR
+    };
+    QVector<Vertex> vertices(4 * _billboardRasterMaxSymbolsPerDrawCall);
+    auto pVertex = vertices.data();
+    for (int symbolIdx = 0; symbolIdx < _billboardRasterMaxSymbolsPerDrawCall; symbolIdx++)
+    {
+        for (const auto& templateVertex : templateVertices)
+        {
+            auto& vertex = *(pVertex++);
+            vertex = templateVertex;
+            vertex.symbolIndex = symbolIdx;
+        }
+    }
+
+    // Index data
+    QVector<GLushort> indices(6 * _billboardRasterMaxSymbolsPerDrawCall);
+    auto pIndex = indices.data();
+    for (int symbolIdx = 0; symbolIdx < _billboardRasterMaxSymbolsPerDrawCall; symbolIdx++)
+    {
+        *(pIndex++) = symbolIdx * 4 + 0;
+        *(pIndex++) = symbolIdx * 4 + 1;
+        *(pIndex++) = symbolIdx * 4 + 2;
+
+        *(pIndex++) = symbolIdx * 4 + 0;
+        *(pIndex++) = symbolIdx * 4 + 2;
+        *(pIndex++) = symbolIdx * 4 + 3;
+    }
+
+    _billboardRasterSymbolVAO = gpuAPI->allocateUninitializedVAO();
+
+    // Create vertex buffer and associate it with VAO
+    glGenBuffers(1, &_billboardRasterSymbolVBO);
+    GL_CHECK_RESULT;
+    glBindBuffer(GL_ARRAY_BUFFER, _billboardRasterSymbolVBO);
+    GL_CHECK_RESULT;
+    glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(Vertex), vertices.constData(), GL_STATIC_DRAW);
+    GL_CHECK_RESULT;
+    glEnableVertexAttribArray(*_billboardRasterProgram.vs.in.vertexPosition);
+    GL_CHECK_RESULT;
+    glVertexAttribPointer(*_billboardRasterProgram.vs.in.vertexPosition, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, positionXY)));
+    GL_CHECK_RESULT;
+    glEnableVertexAttribArray(*_billboardRasterProgram.vs.in.symbolIndex);
+    GL_CHECK_RESULT;
+    //NOTE: Here should be glVertexAttribIPointer to omit conversion float->int, but it's not supported in OpenGLES 2.0
+    glVertexAttribPointer(*_billboardRasterProgram.vs.in.symbolIndex, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, symbolIndex)));
+    GL_CHECK_RESULT;
+    glEnableVertexAttribArray(*_billboardRasterProgram.vs.in.vertexTexCoords);
+    GL_CHECK_RESULT;
+    glVertexAttribPointer(*_billboardRasterProgram.vs.in.vertexTexCoords, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, textureUV)));
+    GL_CHECK_RESULT;
+
+    // Create index buffer and associate it with VAO
+    glGenBuffers(1, &_billboardRasterSymbolIBO);
+    GL_CHECK_RESULT;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _billboardRasterSymbolIBO);
+    GL_CHECK_RESULT;
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLushort), indices.constData(), GL_STATIC_DRAW);
+    GL_CHECK_RESULT;
+
+    gpuAPI->initializeVAO(_billboardRasterSymbolVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GL_CHECK_RESULT;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    GL_CHECK_RESULT;
+
+    _billboardRasterSymbolsBatch.symbolsData.reserve(BillboardRasterSymbolVectors * 4 * _billboardRasterMaxSymbolsPerDrawCall);
+
+    return true;
+}
+
+bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRasterProgram(const unsigned int maxSymbolsPerDrawCall)
+{
+    const auto gpuAPI = getGPUAPI();
+
     GL_CHECK_PRESENT(glDeleteShader);
     GL_CHECK_PRESENT(glDeleteProgram);
 
@@ -221,27 +431,36 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRaster()
     const QString vertexShader = QLatin1String(
         // Input data
         "INPUT vec2 in_vs_vertexPosition;                                                                                   ""\n"
+        "INPUT float in_vs_symbolIndex;                                                                                     ""\n"
         "INPUT vec2 in_vs_vertexTexCoords;                                                                                  ""\n"
         "                                                                                                                   ""\n"
         // Output data to next shader stages
         "PARAM_OUTPUT vec2 v2f_texCoords;                                                                                   ""\n"
+        "PARAM_OUTPUT vec4 v2f_modulationColor;                                                                             ""\n"
         "                                                                                                                   ""\n"
         // Parameters: common data
         "uniform mat4 param_vs_mPerspectiveProjectionView;                                                                  ""\n"
         "uniform mat4 param_vs_mOrthographicProjection;                                                                     ""\n"
         "uniform vec4 param_vs_viewport; // x, y, width, height                                                             ""\n"
         "                                                                                                                   ""\n"
-        // Parameters: per-symbol data
-        "uniform vec2 param_vs_symbolOffsetFromTarget;                                                                      ""\n"
-        "uniform ivec2 param_vs_symbolSize;                                                                                 ""\n"
-        "uniform float param_vs_distanceFromCamera;                                                                         ""\n"
-        "uniform ivec2 param_vs_onScreenOffset;                                                                             ""\n"
+        // Parameters: per-symbol data. Each symbol takes 4 vectors:
+        //  - offset from target (xy) and size (zw)
+        //  - on-screen offset (xy) and distance from camera (z)
+        //  - texture coordinates offset (xy) and scale (zw)
+        //  - modulation color
+        "uniform vec4 param_vs_symbols[%SymbolsVectorsPerDrawCall%];                                                        ""\n"
         "                                                                                                                   ""\n"
         "void main()                                                                                                        ""\n"
         "{                                                                                                                  ""\n"
+        "    int symbolDataIndex = int(in_vs_symbolIndex) * 4;                                                              ""\n"
+        "    vec4 symbolOffsetFromTargetAndSize = param_vs_symbols[symbolDataIndex + 0];                                    ""\n"
+        "    vec4 symbolOnScreenOffsetAndDistance = param_vs_symbols[symbolDataIndex + 1];                                  ""\n"
+        "    vec4 symbolTexCoordsOffsetAndScale = param_vs_symbols[symbolDataIndex + 2];                                    ""\n"
+        "    vec2 symbolSize = symbolOffsetFromTargetAndSize.zw;                                                            ""\n"
+        "                                                                                                                   ""\n"
         // Calculate location of symbol in world coordinate system.
         "    vec4 symbolLocation;                                                                                           ""\n"
-        "    symbolLocation.xz = param_vs_symbolOffsetFromTarget.xy * %TileSize3D%.0;                                       ""\n"
+        "    symbolLocation.xz = symbolOffsetFromTargetAndSize.xy * %TileSize3D%.0;                                         ""\n"
         "    symbolLocation.y = 0.0; //TODO: A height from heightmap should be used here                                    ""\n"
         "    symbolLocation.w = 1.0;                                                                                        ""\n"
         "                                                                                                                   ""\n"
@@ -258,22 +477,22 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRaster()
         "    symbolLocationOnScreen.z = (1.0 + symbolLocationOnScreen.z) * 0.5;                                             ""\n"
         "                                                                                                                   ""\n"
         // Add on-screen offset
-        "    symbolLocationOnScreen.xy += vec2(param_vs_onScreenOffset);                                                    ""\n"
+        "    symbolLocationOnScreen.xy += symbolOnScreenOffsetAndDistance.xy;                                               ""\n"
         "                                                                                                                   ""\n"
         // symbolLocationOnScreen.xy now contains correct coordinates in viewport,
         // which can be used in orthographic projection (if it was configured to match viewport).
         //
         // To provide pixel-perfect rendering of billboard raster symbols:
-        // symbolLocationOnScreen.(x|y) has to be rounded and +0.5 in case param_vs_symbolSize.(x|y) is even
-        // symbolLocationOnScreen.(x|y) has to be rounded in case param_vs_symbolSize.(x|y) is odd
-        "    symbolLocationOnScreen.x = floor(symbolLocationOnScreen.x) + mod(float(param_vs_symbolSize.x), 2.0) * 0.5;     ""\n"
-        "    symbolLocationOnScreen.y = floor(symbolLocationOnScreen.y) + mod(float(param_vs_symbolSize.y), 2.0) * 0.5;     ""\n"
+        // symbolLocationOnScreen.(x|y) has to be rounded and +0.5 in case symbolSize.(x|y) is even
+        // symbolLocationOnScreen.(x|y) has to be rounded in case symbolSize.(x|y) is odd
+        "    symbolLocationOnScreen.x = floor(symbolLocationOnScreen.x) + mod(symbolSize.x, 2.0) * 0.5;                     ""\n"
+        "    symbolLocationOnScreen.y = floor(symbolLocationOnScreen.y) + mod(symbolSize.y, 2.0) * 0.5;                     ""\n"
         "                                                                                                                   ""\n"
         // So it's possible to calculate current vertex location:
         // Initially, get location of current vertex in screen coordinates
         "    vec2 vertexOnScreen;                                                                                           ""\n"
-        "    vertexOnScreen.x = in_vs_vertexPosition.x * float(param_vs_symbolSize.x);                                      ""\n"
-        "    vertexOnScreen.y = in_vs_vertexPosition.y * float(param_vs_symbolSize.y);                                      ""\n"
+        "    vertexOnScreen.x = in_vs_vertexPosition.x * symbolSize.x;                                                      ""\n"
+        "    vertexOnScreen.y = in_vs_vertexPosition.y * symbolSize.y;                                                      ""\n"
         "    vertexOnScreen = vertexOnScreen + symbolLocationOnScreen.xy;                                                   ""\n"
         "                                                                                                                   ""\n"
         // To provide pixel-perfect result, vertexOnScreen needs to be rounded
@@ -283,15 +502,17 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRaster()
         // orthographic projection matrix (View and Model being identity)
         "  vec4 vertex;                                                                                                     ""\n"
         "  vertex.xy = vertexOnScreen.xy;                                                                                   ""\n"
-        "  vertex.z = -param_vs_distanceFromCamera;                                                                         ""\n"
+        "  vertex.z = -symbolOnScreenOffsetAndDistance.z;                                                                   ""\n"
         "  vertex.w = 1.0;                                                                                                  ""\n"
         "  gl_Position = param_vs_mOrthographicProjection * vertex;                                                         ""\n"
         "                                                                                                                   ""\n"
-        // Texture coordinates are simply forwarded from input
-        "   v2f_texCoords = in_vs_vertexTexCoords;                                                                          ""\n"
+        // Texture coordinates are mapped into region of texture occupied by symbol
+        "   v2f_texCoords = symbolTexCoordsOffsetAndScale.xy + in_vs_vertexTexCoords * symbolTexCoordsOffsetAndScale.zw;   ""\n"
+        "   v2f_modulationColor = param_vs_symbols[symbolDataIndex + 3];                                                   ""\n"
         "}                                                                                                                  ""\n");
     auto preprocessedVertexShader = vertexShader;
     preprocessedVertexShader.replace("%TileSize3D%", QString::number(AtlasMapRenderer::TileSize3D));
+    preprocessedVertexShader.replace("%SymbolsVectorsPerDrawCall%", QString::number(maxSymbolsPerDrawCall * BillboardRasterSymbolVectors));
     gpuAPI->preprocessVertexShader(preprocessedVertexShader);
     gpuAPI->optimizeVertexShader(preprocessedVertexShader);
     const auto vsId = gpuAPI->compileShader(GL_VERTEX_SHADER, qPrintable(preprocessedVertexShader));
@@ -306,20 +527,18 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRaster()
     const QString fragmentShader = QLatin1String(
         // Input data
         "PARAM_INPUT vec2 v2f_texCoords;                                                                                    ""\n"
+        "PARAM_INPUT vec4 v2f_modulationColor;                                                                              ""\n"
         "                                                                                                                   ""\n"
         // Parameters: common data
-        // Parameters: per-symbol data
         "uniform lowp sampler2D param_fs_sampler;                                                                           ""\n"
-        "uniform lowp vec4 param_fs_modulationColor;                                                                        ""\n"
         "                                                                                                                   ""\n"
         "void main()                                                                                                        ""\n"
         "{                                                                                                                  ""\n"
         "    FRAGMENT_COLOR_OUTPUT = SAMPLE_TEXTURE_2D(                                                                     ""\n"
         "        param_fs_sampler,                                                                                          ""\n"
-        "        v2f_texCoords) * param_fs_modulationColor;                                                                 ""\n"
+        "        v2f_texCoords) * v2f_modulationColor;                                                                      ""\n"
         "}                                                                                                                  ""\n");
     auto preprocessedFragmentShader = fragmentShader;
-    QString preprocessedFragmentShader_UnrolledPerLayerProcessingCode;
     gpuAPI->preprocessFragmentShader(preprocessedFragmentShader);
     gpuAPI->optimizeFragmentShader(preprocessedFragmentShader);
     const auto fsId = gpuAPI->compileShader(GL_FRAGMENT_SHADER, qPrintable(preprocessedFragmentShader));
@@ -347,16 +566,13 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRaster()
     bool ok = true;
     const auto& lookup = gpuAPI->obtainVariablesLookupContext(_billboardRasterProgram.id, variablesMap);
     ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.in.vertexPosition, "in_vs_vertexPosition", GlslVariableType::In);
+    ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.in.symbolIndex, "in_vs_symbolIndex", GlslVariableType::In);
     ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.in.vertexTexCoords, "in_vs_vertexTexCoords", GlslVariableType::In);
     ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.mPerspectiveProjectionView, "param_vs_mPerspectiveProjectionView", GlslVariableType::Uniform);
     ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.mOrthographicProjection, "param_vs_mOrthographicProjection", GlslVariableType::Uniform);
     ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.viewport, "param_vs_viewport", GlslVariableType::Uniform);
-    ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.symbolOffsetFromTarget, "param_vs_symbolOffsetFromTarget", GlslVariableType::Uniform);
-    ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.symbolSize, "param_vs_symbolSize", GlslVariableType::Uniform);
-    ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.distanceFromCamera, "param_vs_distanceFromCamera", GlslVariableType::Uniform);
-    ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.onScreenOffset, "param_vs_onScreenOffset", GlslVariableType::Uniform);
+    ok = ok && lookup->lookupLocation(_billboardRasterProgram.vs.param.symbols, "param_vs_symbols[0]", GlslVariableType::Uniform);
     ok = ok && lookup->lookupLocation(_billboardRasterProgram.fs.param.sampler, "param_fs_sampler", GlslVariableType::Uniform);
-    ok = ok && lookup->lookupLocation(_billboardRasterProgram.fs.param.modulationColor, "param_fs_modulationColor", GlslVariableType::Uniform);
     if (!ok)
     {
         glDeleteProgram(_billboardRasterProgram.id);
@@ -366,83 +582,86 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeBillboardRaster()
         return false;
     }
 
-#pragma pack(push, 1)
-    struct Vertex
-    {
-        // XY coordinates. Z is assumed to be 0
-        float positionXY[2];
+    return true;
+}
 
-        // UV coordinates
-        float textureUV[2];
-    };
-#pragma pack(pop)
+bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderBillboardRasterSymbol(
+    const std::shared_ptr<const RenderableBillboardSymbol>& renderable,
+    AlphaChannelType &currentAlphaChannelType,
+    GLname& lastUsedProgram)
+{
+    const auto& symbol = std::static_pointer_cast<const BillboardRasterMapSymbol>(renderable->mapSymbol);
+    const auto& gpuResource = std::static_pointer_cast<const GPUAPI::TextureInGPU>(renderable->gpuResource);
 
-    // Vertex data
-    Vertex vertices[4] =
+    bool ok = true;
+
+    // Symbol can join current batch only if it's drawn from same texture in same way
+    auto& batch = _billboardRasterSymbolsBatch;
+    if (batch.symbolsCount > 0 && (
+        batch.texture != gpuResource->refInGPU ||
+        batch.alphaChannelType != gpuResource->alphaChannelType ||
+        batch.symbolsCount >= _billboardRasterMaxSymbolsPerDrawCall))
     {
-        // In OpenGL, UV origin is BL. But since same rule applies to uploading texture data,
-        // texture in memory is vertically flipped, so swap bottom and top UVs
-        { { -0.5f, -0.5f }, { 0.0f, 1.0f } },//BL
-        { { -0.5f,  0.5f }, { 0.0f, 0.0f } },//TL
-        { {  0.5f,  0.5f }, { 1.0f, 0.0f } },//TR
-        { {  0.5f, -0.5f }, { 1.0f, 1.0f } } //BR
-    };
-    const auto verticesCount = 4;
+        ok = flushBillboardRasterSymbolsBatch(currentAlphaChannelType, lastUsedProgram);
+    }
+    batch.texture = gpuResource->refInGPU;
+    batch.alphaChannelType = gpuResource->alphaChannelType;
 
-    // Index data
-    GLushort indices[6] =
+    // Texture coordinates of symbol, in case it's packed into atlas texture
+    PointF texCoordsOffsetN(0.0f, 0.0f);
+    PointF texCoordsScaleN(1.0f, 1.0f);
+    if (gpuResource->type == GPUAPI::ResourceInGPU::Type::RegionOnAtlasTexture)
     {
-        0, 1, 2,
-        0, 2, 3
-    };
-    const auto indicesCount = 6;
+        const auto& regionInGPU = std::static_pointer_cast<const GPUAPI::RegionOnAtlasTextureInGPU>(gpuResource);
+        texCoordsOffsetN = regionInGPU->texCoordsOffsetN;
+        texCoordsScaleN = regionInGPU->texCoordsScaleN;
+    }
 
-    _billboardRasterSymbolVAO = gpuAPI->allocateUninitializedVAO();
+    const auto& offsetOnScreen =
+        (renderable->instanceParameters && renderable->instanceParameters->overridesOffset)
+        ? renderable->instanceParameters->offset
+        : symbol->offset;
 
-    // Create vertex buffer and associate it with VAO
-    glGenBuffers(1, &_billboardRasterSymbolVBO);
-    GL_CHECK_RESULT;
-    glBindBuffer(GL_ARRAY_BUFFER, _billboardRasterSymbolVBO);
-    GL_CHECK_RESULT;
-    glBufferData(GL_ARRAY_BUFFER, verticesCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
-    GL_CHECK_RESULT;
-    glEnableVertexAttribArray(*_billboardRasterProgram.vs.in.vertexPosition);
-    GL_CHECK_RESULT;
-    glVertexAttribPointer(*_billboardRasterProgram.vs.in.vertexPosition, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, positionXY)));
-    GL_CHECK_RESULT;
-    glEnableVertexAttribArray(*_billboardRasterProgram.vs.in.vertexTexCoords);
-    GL_CHECK_RESULT;
-    glVertexAttribPointer(*_billboardRasterProgram.vs.in.vertexTexCoords, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, textureUV)));
-    GL_CHECK_RESULT;
+    // Append symbol data in layout expected by vertex shader
+    const float symbolData[BillboardRasterSymbolVectors * 4] =
+    {
+        renderable->offsetFromTarget.x,
+        renderable->offsetFromTarget.y,
+        static_cast<float>(gpuResource->width),
+        static_cast<float>(gpuResource->height),
 
-    // Create index buffer and associate it with VAO
-    glGenBuffers(1, &_billboardRasterSymbolIBO);
-    GL_CHECK_RESULT;
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _billboardRasterSymbolIBO);
-    GL_CHECK_RESULT;
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesCount * sizeof(GLushort), indices, GL_STATIC_DRAW);
-    GL_CHECK_RESULT;
+        static_cast<float>(offsetOnScreen.x),
+        static_cast<float>(-offsetOnScreen.y),
+        renderable->distanceToCamera,
+        0.0f,
 
-    gpuAPI->initializeVAO(_billboardRasterSymbolVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    GL_CHECK_RESULT;
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    GL_CHECK_RESULT;
+        texCoordsOffsetN.x,
+        texCoordsOffsetN.y,
+        texCoordsScaleN.x,
+        texCoordsScaleN.y,
 
-    return true;
+        symbol->modulationColor.r,
+        symbol->modulationColor.g,
+        symbol->modulationColor.b,
+        symbol->modulationColor.a,
+    };
+    for (const auto value : symbolData)
+        batch.symbolsData.push_back(value);
+    batch.symbolsCount++;
+
+    return ok;
 }
 
-bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderBillboardRasterSymbol(
-    const std::shared_ptr<const RenderableBillboardSymbol>& renderable,
+bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::flushBillboardRasterSymbolsBatch(
     AlphaChannelType &currentAlphaChannelType,
     GLname& lastUsedProgram)
 {
     const auto gpuAPI = getGPUAPI();
     const auto& internalState = getInternalState();
 
-    const auto& symbol = std::static_pointer_cast<const BillboardRasterMapSymbol>(renderable->mapSymbol);
-    const auto& gpuResource = std::static_pointer_cast<const GPUAPI::TextureInGPU>(renderable->gpuResource);
-    const auto& symbolGroupPtr = symbol->groupPtr;
+    auto& batch = _billboardRasterSymbolsBatch;
+    if (batch.symbolsCount == 0)
+        return true;
 
     // Check if correct program is being used
     if (lastUsedProgram != _billboardRasterProgram.id)
@@ -484,43 +703,11 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderBillboardRasterSymbol(
         GL_POP_GROUP_MARKER;
     }
 
-    GL_PUSH_GROUP_MARKER(QString("[%1(%2) billboard raster \"%3\"]")
-        .arg(QString().sprintf("%p", symbol->groupPtr))
-        .arg(symbol->group.lock()->toString())
-        .arg(qPrintable(symbol->content)));
-
-    //////////////////////////////////////////////////////////////////////////
-    //if (symbol->content == "seamark_buoy_yellow_can")
-    //{
-    //    int i = 5;
-    //}
-    //////////////////////////////////////////////////////////////////////////
-
-    // Set symbol offset from target
-    glUniform2f(_billboardRasterProgram.vs.param.symbolOffsetFromTarget,
-        renderable->offsetFromTarget.x,
-        renderable->offsetFromTarget.y);
-    GL_CHECK_RESULT;
-
-    // Set symbol size
-    glUniform2i(_billboardRasterProgram.vs.param.symbolSize, gpuResource->width, gpuResource->height);
-    GL_CHECK_RESULT;
+    GL_PUSH_GROUP_MARKER(QString("[%1 billboard raster symbols]").arg(batch.symbolsCount));
 
-    // Set distance from camera to symbol
-    glUniform1f(_billboardRasterProgram.vs.param.distanceFromCamera, renderable->distanceToCamera);
-    GL_CHECK_RESULT;
-
-    // Set on-screen offset
-    const auto& offsetOnScreen =
-        (renderable->instanceParameters && renderable->instanceParameters->overridesOffset)
-        ? renderable->instanceParameters->offset
-        : symbol->offset;
-    glUniform2i(_billboardRasterProgram.vs.param.onScreenOffset, offsetOnScreen.x, -offsetOnScreen.y);
-    GL_CHECK_RESULT;
-
-    if (currentAlphaChannelType != gpuResource->alphaChannelType)
+    if (currentAlphaChannelType != batch.alphaChannelType)
     {
-        switch (gpuResource->alphaChannelType)
+        switch (batch.alphaChannelType)
         {
             case AlphaChannelType::Premultiplied:
                 glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
@@ -534,30 +721,27 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderBillboardRasterSymbol(
                 break;
         }
 
-        currentAlphaChannelType = gpuResource->alphaChannelType;
+        currentAlphaChannelType = batch.alphaChannelType;
     }
 
-    // Activate symbol texture
-    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<intptr_t>(gpuResource->refInGPU)));
-    GL_CHECK_RESULT;
+    // Activate texture shared by all symbols of batch
+    useSymbolTexture(batch.texture);
 
-    // Set modulation color
-    glUniform4f(_billboardRasterProgram.fs.param.modulationColor,
-        symbol->modulationColor.r,
-        symbol->modulationColor.g,
-        symbol->modulationColor.b,
-        symbol->modulationColor.a);
+    // Upload data of all symbols at once
+    glUniform4fv(_billboardRasterProgram.vs.param.symbols,
+        batch.symbolsCount * BillboardRasterSymbolVectors,
+        batch.symbolsData.constData());
     GL_CHECK_RESULT;
 
-    // Apply settings from texture block to texture
-    gpuAPI->applyTextureBlockToTexture(GL_TEXTURE_2D, GL_TEXTURE0 + 0);
-
-    // Draw symbol actually
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+    // Draw symbols actually
+    glDrawElements(GL_TRIANGLES, 6 * batch.symbolsCount, GL_UNSIGNED_SHORT, nullptr);
     GL_CHECK_RESULT;
+    _symbolsDrawCalls++;
 
     GL_POP_GROUP_MARKER;
 
+    batch.reset();
+
     return true;
 }
 
@@ -602,6 +786,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::releaseBillboardRaster(const b
         }
         _billboardRasterProgram = BillboardRasterSymbolProgram();
     }
+    _billboardRasterSymbolsBatch = BillboardRasterSymbolsBatch();
 
     return true;
 }
@@ -628,7 +813,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeOnPath2D()
         4 /*param_vs_mPerspectiveProjectionView*/ +
         1 /*param_vs_glyphHeight*/ +
         1 /*param_vs_zDistanceFromCamera*/;
-    _onPathSymbol2dMaxGlyphsPerDrawCall = (gpuAPI->maxVertexUniformVectors - alreadyOccupiedUniforms) / 5;
+    _onPathSymbol2dMaxGlyphsPerDrawCall = (gpuAPI->maxVertexUniformVectors - alreadyOccupiedUniforms) / OnPathSymbol2dGlyphVectors;
     if (initializeOnPath2DProgram(_onPathSymbol2dMaxGlyphsPerDrawCall))
     {
         LogPrintf(LogSeverityLevel::Info,
@@ -788,35 +973,32 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeOnPath2DProgram(cons
         "uniform float param_vs_glyphHeight;                                                                                ""\n"
         "uniform float param_vs_distanceFromCamera;                                                                         ""\n"
         "                                                                                                                   ""\n"
-        // Parameters: per-glyph data
-        "struct Glyph                                                                                                       ""\n"
-        "{                                                                                                                  ""\n"
-        "    vec2 anchorPoint;                                                                                              ""\n"
-        "    float width;                                                                                                   ""\n"
-        "    float angle;                                                                                                   ""\n"
-        "    float widthOfPreviousN;                                                                                        ""\n"
-        "    float widthN;                                                                                                  ""\n"
-        "};                                                                                                                 ""\n"
-        "uniform Glyph param_vs_glyphs[%MaxGlyphsPerDrawCall%];                                                             ""\n"
+        // Parameters: per-glyph data. Each glyph takes 2 vectors:
+        //  - anchor point (xy), width (z) and angle (w)
+        //  - normalized width of all previous glyphs (x) and normalized width of glyph (y)
+        "uniform vec4 param_vs_glyphs[%GlyphsVectorsPerDrawCall%];                                                          ""\n"
         "                                                                                                                   ""\n"
         "void main()                                                                                                        ""\n"
         "{                                                                                                                  ""\n"
-        "    Glyph glyph = param_vs_glyphs[int(in_vs_glyphIndex)];                                                          ""\n"
-        "    vec2 anchorPoint = glyph.anchorPoint;                                                                          ""\n"
-        "    float cos_a = cos(glyph.angle);                                                                                ""\n"
-        "    float sin_a = sin(glyph.angle);                                                                                ""\n"
+        "    int glyphDataIndex = int(in_vs_glyphIndex) * 2;                                                                ""\n"
+        "    vec4 glyphAnchorPointWidthAndAngle = param_vs_glyphs[glyphDataIndex + 0];                                      ""\n"
+        "    vec2 glyphTexCoordsN = param_vs_glyphs[glyphDataIndex + 1].xy;                                                 ""\n"
+        "    vec2 anchorPoint = glyphAnchorPointWidthAndAngle.xy;                                                           ""\n"
+        "    float glyphWidth = glyphAnchorPointWidthAndAngle.z;                                                            ""\n"
+        "    float cos_a = cos(glyphAnchorPointWidthAndAngle.w);                                                            ""\n"
+        "    float sin_a = sin(glyphAnchorPointWidthAndAngle.w);                                                            ""\n"
         "                                                                                                                   ""\n"
         // Pixel-perfect rendering is available when angle is 0, 90, 180 or 270 degrees, what will produce
         // cos_a 0, 1 or -1
         //"    if (abs(cos_a - int(cos_a)) < 0.0001)                                                                          ""\n"
         //"    {                                                                                                              ""\n"
-        //"        anchorPoint.x = floor(anchorPoint.x) + mod(glyph.width, 2.0) * 0.5;                                        ""\n"
+        //"        anchorPoint.x = floor(anchorPoint.x) + mod(glyphWidth, 2.0) * 0.5;                                         ""\n"
         //"        anchorPoint.y = floor(anchorPoint.y) + mod(param_vs_glyphHeight, 2.0) * 0.5;                               ""\n"
         //"    }                                                                                                              ""\n"
         "                                                                                                                   ""\n"
         // Get on-screen glyph point offset
         "    vec2 glyphPoint;                                                                                               ""\n"
-        "    glyphPoint.x = in_vs_vertexPosition.x * glyph.width;                                                           ""\n"
+        "    glyphPoint.x = in_vs_vertexPosition.x * glyphWidth;                                                            ""\n"
         "    glyphPoint.y = in_vs_vertexPosition.y * param_vs_glyphHeight;                                                  ""\n"
         "                                                                                                                   ""\n"
         // Get on-screen vertex coordinates
@@ -838,11 +1020,11 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeOnPath2DProgram(cons
         "    gl_Position = param_vs_mOrthographicProjection * vertexOnScreen;                                               ""\n"
         "                                                                                                                   ""\n"
         // Prepare texture coordinates
-        "    v2f_texCoords.s = glyph.widthOfPreviousN + in_vs_vertexTexCoords.s*glyph.widthN;                               ""\n"
+        "    v2f_texCoords.s = glyphTexCoordsN.x + in_vs_vertexTexCoords.s*glyphTexCoordsN.y;                               ""\n"
         "    v2f_texCoords.t = in_vs_vertexTexCoords.t; // Height is compatible as-is                                       ""\n"
         "}                                                                                                                  ""\n");
     auto preprocessedVertexShader = vertexShader;
-    preprocessedVertexShader.replace("%MaxGlyphsPerDrawCall%", QString::number(maxGlyphsPerDrawCall));
+    preprocessedVertexShader.replace("%GlyphsVectorsPerDrawCall%", QString::number(maxGlyphsPerDrawCall * OnPathSymbol2dGlyphVectors));
     gpuAPI->preprocessVertexShader(preprocessedVertexShader);
     gpuAPI->optimizeVertexShader(preprocessedVertexShader);
     const auto vsId = gpuAPI->compileShader(GL_VERTEX_SHADER, qPrintable(preprocessedVertexShader));
@@ -903,20 +1085,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::initializeOnPath2DProgram(cons
     ok = ok && lookup->lookupLocation(_onPath2dProgram.vs.param.mOrthographicProjection, "param_vs_mOrthographicProjection", GlslVariableType::Uniform);
     ok = ok && lookup->lookupLocation(_onPath2dProgram.vs.param.glyphHeight, "param_vs_glyphHeight", GlslVariableType::Uniform);
     ok = ok && lookup->lookupLocation(_onPath2dProgram.vs.param.distanceFromCamera, "param_vs_distanceFromCamera", GlslVariableType::Uniform);
-    auto& glyphs = _onPath2dProgram.vs.param.glyphs;
-    glyphs.resize(maxGlyphsPerDrawCall);
-    int glyphStructIndex = 0;
-    for (auto& glyph : glyphs)
-    {
-        const auto glyphStructPrefix =
-            QString::fromLatin1("param_vs_glyphs[%glyphIndex%]").replace(QLatin1String("%glyphIndex%"), QString::number(glyphStructIndex++));
-
-        ok = ok && lookup->lookupLocation(glyph.anchorPoint, glyphStructPrefix + ".anchorPoint", GlslVariableType::Uniform);
-        ok = ok && lookup->lookupLocation(glyph.width, glyphStructPrefix + ".width", GlslVariableType::Uniform);
-        ok = ok && lookup->lookupLocation(glyph.angle, glyphStructPrefix + ".angle", GlslVariableType::Uniform);
-        ok = ok && lookup->lookupLocation(glyph.widthOfPreviousN, glyphStructPrefix + ".widthOfPreviousN", GlslVariableType::Uniform);
-        ok = ok && lookup->lookupLocation(glyph.widthN, glyphStructPrefix + ".widthN", GlslVariableType::Uniform);
-    }
+    ok = ok && lookup->lookupLocation(_onPath2dProgram.vs.param.glyphs, "param_vs_glyphs[0]", GlslVariableType::Uniform);
     ok = ok && lookup->lookupLocation(_onPath2dProgram.fs.param.sampler, "param_fs_sampler", GlslVariableType::Uniform);
     ok = ok && lookup->lookupLocation(_onPath2dProgram.fs.param.modulationColor, "param_fs_modulationColor", GlslVariableType::Uniform);
     if (!ok)
@@ -1305,11 +1474,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnPath2dSymbol(
     }
 
     // Activate symbol texture
-    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<intptr_t>(gpuResource->refInGPU)));
-    GL_CHECK_RESULT;
-
-    // Apply settings from texture block to texture
-    gpuAPI->applyTextureBlockToTexture(GL_TEXTURE_2D, GL_TEXTURE0 + 0);
+    useSymbolTexture(gpuResource->refInGPU);
 
     // Set modulation color
     glUniform4f(_onPath2dProgram.fs.param.modulationColor,
@@ -1323,45 +1488,40 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnPath2dSymbol(
     const auto glyphsCount = renderable->glyphsPlacement.size();
     unsigned int glyphsDrawn = 0;
     auto pGlyph = renderable->glyphsPlacement.constData();
-    const auto pFirstGlyphVS = _onPath2dProgram.vs.param.glyphs.constData();
     float widthOfPreviousN = 0.0f;
     while (glyphsDrawn < glyphsCount)
     {
         const auto glyphsToDraw = qMin(glyphsCount - glyphsDrawn, _onPathSymbol2dMaxGlyphsPerDrawCall);
-        auto pGlyphVS = pFirstGlyphVS;
 
+        // Pack data of all glyphs in layout expected by vertex shader, and set it at once
+        _onPathSymbol2dGlyphsData.resize(glyphsToDraw * OnPathSymbol2dGlyphVectors * 4);
+        auto pGlyphData = _onPathSymbol2dGlyphsData.data();
         for (auto glyphIdx = 0; glyphIdx < glyphsToDraw; glyphIdx++)
         {
             const auto& glyph = *(pGlyph++);
-            const auto& vsGlyph = *(pGlyphVS++);
-
-            // Set anchor point of glyph
-            glUniform2fv(vsGlyph.anchorPoint, 1, glm::value_ptr(glyph.anchorPoint));
-            GL_CHECK_RESULT;
-
-            // Set glyph width
-            glUniform1f(vsGlyph.width, glyph.width);
-            GL_CHECK_RESULT;
-
-            // Set angle
-            glUniform1f(vsGlyph.angle, glyph.angle);
-            GL_CHECK_RESULT;
+            const auto widthN = glyph.width*gpuResource->uTexelSizeN;
 
-            // Set normalized width of all previous glyphs
-            glUniform1f(vsGlyph.widthOfPreviousN, widthOfPreviousN);
-            GL_CHECK_RESULT;
+            *(pGlyphData++) = glyph.anchorPoint.x;
+            *(pGlyphData++) = glyph.anchorPoint.y;
+            *(pGlyphData++) = glyph.width;
+            *(pGlyphData++) = glyph.angle;
 
-            // Set normalized width of this glyph
-            const auto widthN = glyph.width*gpuResource->uTexelSizeN;
-            glUniform1f(vsGlyph.widthN, widthN);
-            GL_CHECK_RESULT;
+            *(pGlyphData++) = widthOfPreviousN;
+            *(pGlyphData++) = widthN;
+            *(pGlyphData++) = 0.0f;
+            *(pGlyphData++) = 0.0f;
 
             widthOfPreviousN += widthN;
         }
+        glUniform4fv(_onPath2dProgram.vs.param.glyphs,
+            glyphsToDraw * OnPathSymbol2dGlyphVectors,
+            _onPathSymbol2dGlyphsData.constData());
+        GL_CHECK_RESULT;
 
         // Draw chain of glyphs actually
         glDrawElements(GL_TRIANGLES, 6 * glyphsToDraw, GL_UNSIGNED_SHORT, nullptr);
         GL_CHECK_RESULT;
+        _symbolsDrawCalls++;
 
         glyphsDrawn += glyphsToDraw;
     }
@@ -1449,8 +1609,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnPath3dSymbol(
     }
 
     // Activate symbol texture
-    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<intptr_t>(gpuResource->refInGPU)));
-    GL_CHECK_RESULT;
+    useSymbolTexture(gpuResource->refInGPU);
 
     // Set modulation color
     glUniform4f(_onPath3dProgram.fs.param.modulationColor,
@@ -1460,9 +1619,6 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnPath3dSymbol(
         symbol->modulationColor.a);
     GL_CHECK_RESULT;
 
-    // Apply settings from texture block to texture
-    gpuAPI->applyTextureBlockToTexture(GL_TEXTURE_2D, GL_TEXTURE0 + 0);
-
     // Draw chains of glyphs
     const auto glyphsCount = renderable->glyphsPlacement.size();
     unsigned int glyphsDrawn = 0;
@@ -1506,6 +1662,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnPath3dSymbol(
         // Draw chain of glyphs actually
         glDrawElements(GL_TRIANGLES, 6 * glyphsToDraw, GL_UNSIGNED_SHORT, nullptr);
         GL_CHECK_RESULT;
+        _symbolsDrawCalls++;
 
         glyphsDrawn += glyphsToDraw;
     }
@@ -1888,8 +2045,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnSurfaceRasterSymbol(
     }
 
     // Activate symbol texture
-    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<intptr_t>(gpuResource->refInGPU)));
-    GL_CHECK_RESULT;
+    useSymbolTexture(gpuResource->refInGPU);
 
     // Set modulation color
     glUniform4f(_onSurfaceRasterProgram.fs.param.modulationColor,
@@ -1899,12 +2055,10 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnSurfaceRasterSymbol(
         symbol->modulationColor.a);
     GL_CHECK_RESULT;
 
-    // Apply settings from texture block to texture
-    gpuAPI->applyTextureBlockToTexture(GL_TEXTURE_2D, GL_TEXTURE0 + 0);
-
     // Draw symbol actually
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
     GL_CHECK_RESULT;
+    _symbolsDrawCalls++;
 
     GL_POP_GROUP_MARKER;
 
@@ -2193,8 +2347,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnSurfaceVectorSymbol(
     GL_CHECK_RESULT;
 
     // Unbind symbol texture from texture sampler
-    glBindTexture(GL_TEXTURE_2D, 0);
-    GL_CHECK_RESULT;
+    useSymbolTexture(nullptr);
 
     // Draw symbol actually
     GLenum primitivesType = GL_INVALID_ENUM;
@@ -2225,6 +2378,7 @@ bool OsmAnd::AtlasMapRendererSymbolsStage_OpenGL::renderOnSurfaceVectorSymbol(
         glDrawArrays(primitivesType, 0, count);
         GL_CHECK_RESULT;
     }
+    _symbolsDrawCalls++;
 
     // Turn off all buffers
     glBindBuffer(GL_ARRAY_BUFFER, 0);
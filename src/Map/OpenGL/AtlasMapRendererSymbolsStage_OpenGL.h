@@ -18,6 +18,12 @@ namespace OsmAnd
     {
     private:
     protected:
+        // Symbols that share atlas texture are drawn without rebinding it
+        GPUAPI::RefInGPU _lastUsedSymbolTexture;
+        unsigned int _symbolsDrawCalls;
+        unsigned int _symbolsTextureBinds;
+        void useSymbolTexture(const GPUAPI::RefInGPU texture);
+
         bool renderBillboardSymbol(
             const std::shared_ptr<const RenderableBillboardSymbol>& renderable,
             AlphaChannelType &currentAlphaChannelType,
@@ -33,6 +39,7 @@ namespace OsmAnd
                 // Input data
                 struct {
                     GLlocation vertexPosition;
+                    GLlocation symbolIndex;
                     GLlocation vertexTexCoords;
                 } in;
 
@@ -43,11 +50,8 @@ namespace OsmAnd
                     GLlocation mOrthographicProjection;
                     GLlocation viewport;
 
-                    // Per-symbol data
-                    GLlocation symbolOffsetFromTarget;
-                    GLlocation symbolSize;
-                    GLlocation distanceFromCamera;
-                    GLlocation onScreenOffset;
+                    // Per-symbol data, packed into BillboardRasterSymbolVectors vectors per symbol
+                    GLlocation symbols;
                 } param;
             } vs;
 
@@ -55,20 +59,39 @@ namespace OsmAnd
                 // Parameters
                 struct {
                     // Common data
-
-                    // Per-symbol data
                     GLlocation sampler;
-                    GLlocation modulationColor;
                 } param;
             } fs;
         } _billboardRasterProgram;
+        enum : unsigned int {
+            BillboardRasterSymbolVectors = 4,
+        };
+        unsigned int _billboardRasterMaxSymbolsPerDrawCall;
         bool initializeBillboardRaster();
+        bool initializeBillboardRasterProgram(const unsigned int maxSymbolsPerDrawCall);
         bool renderBillboardRasterSymbol(
             const std::shared_ptr<const RenderableBillboardSymbol>& renderable,
             AlphaChannelType &currentAlphaChannelType,
             GLname& lastUsedProgram);
         bool releaseBillboardRaster(const bool gpuContextLost);
 
+        // Consecutive billboard raster symbols that share texture and alpha channel type are collected into batch,
+        // that is drawn with a single draw call once anything else has to be drawn, or batch is full
+        struct BillboardRasterSymbolsBatch
+        {
+            BillboardRasterSymbolsBatch();
+
+            void reset();
+
+            GPUAPI::RefInGPU texture;
+            AlphaChannelType alphaChannelType;
+            unsigned int symbolsCount;
+            QVector<float> symbolsData;
+        } _billboardRasterSymbolsBatch;
+        bool flushBillboardRasterSymbolsBatch(
+            AlphaChannelType &currentAlphaChannelType,
+            GLname& lastUsedProgram);
+
         bool initializeOnPath();
         bool renderOnPathSymbol(
             const std::shared_ptr<const RenderableOnPathSymbol>& renderable,
@@ -107,8 +130,8 @@ namespace OsmAnd
                     GLlocation glyphHeight;
                     GLlocation distanceFromCamera;
 
-                    // Per-glyph data
-                    QVector<Glyph> glyphs;
+                    // Per-glyph data, packed into OnPathSymbol2dGlyphVectors vectors per glyph
+                    GLlocation glyphs;
                 } param;
             } vs;
 
@@ -123,7 +146,11 @@ namespace OsmAnd
                 } param;
             } fs;
         } _onPath2dProgram;
+        enum : unsigned int {
+            OnPathSymbol2dGlyphVectors = 2,
+        };
         unsigned int _onPathSymbol2dMaxGlyphsPerDrawCall;
+        QVector<float> _onPathSymbol2dGlyphsData;
         bool initializeOnPath2D();
         bool initializeOnPath2DProgram(const unsigned int maxGlyphsPerDrawCall);
         bool renderOnPath2dSymbol(
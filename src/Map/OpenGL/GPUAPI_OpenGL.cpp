@@ -6,6 +6,7 @@
 #include <QtMath>
 #include <QRegularExpression>
 #include <QRegExp>
+#include <QByteArray>
 
 #include "ignore_warnings_on_external_includes.h"
 #include <SkBitmap.h>
@@ -18,6 +19,7 @@
 #include "IMapElevationDataProvider.h"
 #include "MapSymbol.h"
 #include "RasterMapSymbol.h"
+#include "BillboardRasterMapSymbol.h"
 #include "VectorMapSymbol.h"
 #include "Logging.h"
 #include "Utilities.h"
@@ -1207,6 +1209,13 @@ bool OsmAnd::GPUAPI_OpenGL::uploadSymbolAsTextureToGPU(
     }
     const auto textureFormat = getTextureFormat(symbol);
 
+    // Small billboard symbols are packed into atlas textures, so that they could be drawn without rebinding texture
+    if (!symbolUsesPalette && std::dynamic_pointer_cast<const BillboardRasterMapSymbol>(symbol))
+    {
+        if (uploadSymbolToAtlasTexture(symbol, alphaChannelType, sourcePixelByteSize, resourceInGPU))
+            return true;
+    }
+
     // Symbols don't use mipmapping, so there is no difference between POT vs NPOT size of texture.
     // In OpenGLES 2.0 and OpenGL 2.0+, NPOT textures are supported in general.
     // OpenGLES 2.0 has some limitations without isSupported_texturesNPOT:
@@ -1259,6 +1268,98 @@ bool OsmAnd::GPUAPI_OpenGL::uploadSymbolAsTextureToGPU(
     return true;
 }
 
+bool OsmAnd::GPUAPI_OpenGL::uploadSymbolToAtlasTexture(
+    const std::shared_ptr< const RasterMapSymbol >& symbol,
+    const AlphaChannelType alphaChannelType,
+    const GLsizei sourcePixelByteSize,
+    std::shared_ptr< const ResourceInGPU >& resourceInGPU)
+{
+    GL_CHECK_PRESENT(glGenTextures);
+    GL_CHECK_PRESENT(glBindTexture);
+
+    const auto width = static_cast<unsigned int>(symbol->bitmap->width());
+    const auto height = static_cast<unsigned int>(symbol->bitmap->height());
+    if (width == 0 || height == 0 || width > MaxSymbolSizeInAtlasTexture || height > MaxSymbolSizeInAtlasTexture)
+        return false;
+
+    const auto textureFormat = getTextureFormat(symbol);
+    const auto sourceFormat = getSourceFormat(symbol);
+    const auto textureSize = qMin(static_cast<unsigned int>(maxTextureSize), static_cast<unsigned int>(SymbolsAtlasTextureSize));
+    const auto padding = static_cast<unsigned int>(SymbolsAtlasTexturePadding);
+
+    const auto pool = obtainPackedAtlasTexturesPool(textureFormat, textureSize, padding);
+    const auto regionInGPU = allocateRegionInAtlasTexture(width, height, alphaChannelType, pool,
+        [this, pool, textureSize, textureFormat]
+        () -> PackedAtlasTextureInGPU*
+        {
+            // Allocate texture id
+            GLuint texture;
+            glGenTextures(1, &texture);
+            GL_CHECK_RESULT;
+            assert(texture != 0);
+
+            // Select this texture
+            glBindTexture(GL_TEXTURE_2D, texture);
+            GL_CHECK_RESULT;
+
+            // Allocate space for this texture
+            allocateTexture2D(GL_TEXTURE_2D, 1, textureSize, textureSize, textureFormat);
+            GL_CHECK_RESULT;
+
+            // Set maximal mipmap level to 0
+            setMipMapLevelsLimit(GL_TEXTURE_2D, 0);
+
+            // Deselect texture
+            glBindTexture(GL_TEXTURE_2D, 0);
+            GL_CHECK_RESULT;
+
+            return new PackedAtlasTextureInGPU(
+                this,
+                reinterpret_cast<RefInGPU>(texture),
+                pool);
+        });
+    if (!regionInGPU)
+        return false;
+
+    // Select atlas as active texture
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<intptr_t>(regionInGPU->atlasTexture->refInGPU)));
+    GL_CHECK_RESULT;
+
+    // Upload data
+    uploadDataToTexture2D(GL_TEXTURE_2D, 0,
+        regionInGPU->x, regionInGPU->y, (GLsizei)width, (GLsizei)height,
+        symbol->bitmap->getPixels(), symbol->bitmap->rowBytes() / sourcePixelByteSize, sourcePixelByteSize,
+        sourceFormat);
+
+    // Clear padding around region, since it may contain leftovers of previous regions that would bleed
+    // into this one when sampled with linear filtering
+    const QByteArray zeroes((qMax(width, height) + 2 * padding) * padding * sourcePixelByteSize, 0);
+    uploadDataToTexture2D(GL_TEXTURE_2D, 0,
+        regionInGPU->x - padding, regionInGPU->y - padding, (GLsizei)(width + 2 * padding), (GLsizei)padding,
+        zeroes.constData(), width + 2 * padding, sourcePixelByteSize,
+        sourceFormat);
+    uploadDataToTexture2D(GL_TEXTURE_2D, 0,
+        regionInGPU->x - padding, regionInGPU->y + height, (GLsizei)(width + 2 * padding), (GLsizei)padding,
+        zeroes.constData(), width + 2 * padding, sourcePixelByteSize,
+        sourceFormat);
+    uploadDataToTexture2D(GL_TEXTURE_2D, 0,
+        regionInGPU->x - padding, regionInGPU->y, (GLsizei)padding, (GLsizei)height,
+        zeroes.constData(), padding, sourcePixelByteSize,
+        sourceFormat);
+    uploadDataToTexture2D(GL_TEXTURE_2D, 0,
+        regionInGPU->x + width, regionInGPU->y, (GLsizei)padding, (GLsizei)height,
+        zeroes.constData(), padding, sourcePixelByteSize,
+        sourceFormat);
+
+    // Deselect atlas as active texture
+    glBindTexture(GL_TEXTURE_2D, 0);
+    GL_CHECK_RESULT;
+
+    resourceInGPU = regionInGPU;
+
+    return true;
+}
+
 bool OsmAnd::GPUAPI_OpenGL::uploadSymbolAsMeshToGPU(
     const std::shared_ptr< const VectorMapSymbol >& symbol,
     std::shared_ptr< const ResourceInGPU >& resourceInGPU)
@@ -122,6 +122,14 @@ namespace OsmAnd
     {
         Q_DISABLE_COPY_AND_MOVE(GPUAPI_OpenGL);
     public:
+        // Billboard symbols not larger than this are packed into shared atlas textures
+        enum : unsigned int
+        {
+            SymbolsAtlasTextureSize = 1024,
+            SymbolsAtlasTexturePadding = 1,
+            MaxSymbolSizeInAtlasTexture = 256,
+        };
+
         template <typename T, typename Enable = void>
         struct glPresenseChecker
         {
@@ -210,6 +218,11 @@ namespace OsmAnd
         bool uploadTiledDataAsArrayBufferToGPU(const std::shared_ptr< const IMapTiledDataProvider::Data >& tile, std::shared_ptr< const ResourceInGPU >& resourceInGPU);
 
         bool uploadSymbolAsTextureToGPU(const std::shared_ptr< const RasterMapSymbol >& symbol, std::shared_ptr< const ResourceInGPU >& resourceInGPU);
+        bool uploadSymbolToAtlasTexture(
+            const std::shared_ptr< const RasterMapSymbol >& symbol,
+            const AlphaChannelType alphaChannelType,
+            const GLsizei sourcePixelByteSize,
+            std::shared_ptr< const ResourceInGPU >& resourceInGPU);
         bool uploadSymbolAsMeshToGPU(const std::shared_ptr< const VectorMapSymbol >& symbol, std::shared_ptr< const ResourceInGPU >& resourceInGPU);
 
         GLuint _vaoSimulationLastUnusedId;
@@ -248,6 +248,8 @@ bool OsmAnd::GPUAPI_OpenGL2plus::initialize()
     }
     _isSupported_8bitPaletteRGBA8 = extensions.contains("GL_OES_compressed_paletted_texture") || compressedFormats.contains(GL_PALETTE8_RGBA8_OES);
     LogPrintf(LogSeverityLevel::Info, "OpenGL 8-bit palette RGBA8 textures: %s", isSupported_8bitPaletteRGBA8 ? "supported" : "not supported");
+    // GL_UNPACK_ROW_LENGTH is supported from OpenGL 1.1+
+    _isSupported_unpackRowLength = true;
 
     if (isSupported_samplerObjects)
     {
@@ -387,6 +387,7 @@ bool OsmAnd::GPUAPI_OpenGLES2::initialize()
     }
     _isSupported_8bitPaletteRGBA8 = extensions.contains("GL_OES_compressed_paletted_texture") || compressedFormats.contains(GL_PALETTE8_RGBA8_OES);
     LogPrintf(LogSeverityLevel::Info, "OpenGLES2 8-bit palette RGBA8 textures: %s", isSupported_8bitPaletteRGBA8 ? "supported" : "not supported");
+    _isSupported_unpackRowLength = _isSupported_EXT_unpack_subimage;
 
     _isSupported_texture_float = _isSupported_OES_texture_float;
     _isSupported_textureLod = _isSupported_EXT_shader_texture_lod;
@@ -0,0 +1,82 @@
+#include "SqliteTilesCache.h"
+#include "SqliteTilesCache_P.h"
+
+OsmAnd::SqliteTilesCache::SqliteTilesCache(const QString& filePath_, const uint64_t maxSize /*= 0*/)
+    : _p(new SqliteTilesCache_P(this, maxSize))
+    , filePath(filePath_)
+{
+    _p->open();
+}
+
+OsmAnd::SqliteTilesCache::~SqliteTilesCache()
+{
+    _p->close();
+}
+
+bool OsmAnd::SqliteTilesCache::isOpened() const
+{
+    return _p->isOpened();
+}
+
+uint64_t OsmAnd::SqliteTilesCache::getMaxSize() const
+{
+    return _p->getMaxSize();
+}
+
+void OsmAnd::SqliteTilesCache::setMaxSize(const uint64_t maxSize)
+{
+    _p->setMaxSize(maxSize);
+}
+
+unsigned int OsmAnd::SqliteTilesCache::getWriteBatchSize() const
+{
+    return _p->getWriteBatchSize();
+}
+
+void OsmAnd::SqliteTilesCache::setWriteBatchSize(const unsigned int writeBatchSize)
+{
+    _p->setWriteBatchSize(writeBatchSize);
+}
+
+bool OsmAnd::SqliteTilesCache::obtainTile(
+    const TileId tileId,
+    const ZoomLevel zoom,
+    QByteArray& outData,
+    bool* const pOutExpired /*= nullptr*/) const
+{
+    return _p->obtainTile(tileId, zoom, outData, pOutExpired);
+}
+
+void OsmAnd::SqliteTilesCache::storeTile(
+    const TileId tileId,
+    const ZoomLevel zoom,
+    const QByteArray& data,
+    const QDateTime& expirationTime /*= QDateTime()*/)
+{
+    _p->storeTile(tileId, zoom, data, expirationTime);
+}
+
+void OsmAnd::SqliteTilesCache::removeTile(const TileId tileId, const ZoomLevel zoom)
+{
+    _p->removeTile(tileId, zoom);
+}
+
+void OsmAnd::SqliteTilesCache::flush()
+{
+    _p->flush();
+}
+
+OsmAnd::SqliteTilesCache::Statistics OsmAnd::SqliteTilesCache::getStatistics() const
+{
+    return _p->getStatistics();
+}
+
+OsmAnd::SqliteTilesCache::Statistics::Statistics()
+    : size(0)
+    , tilesCount(0)
+    , hitsCount(0)
+    , missesCount(0)
+    , writtenTilesCount(0)
+    , evictedTilesCount(0)
+{
+}
@@ -0,0 +1,628 @@
+#include "SqliteTilesCache_P.h"
+#include "SqliteTilesCache.h"
+
+#include "stdlib_common.h"
+#include <algorithm>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QtSql>
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include "restore_internal_warnings.h"
+
+#include "QtCommon.h"
+#include "QKeyValueIterator.h"
+#include "Logging.h"
+
+namespace
+{
+    // MBTiles uses TMS tile rows, so Y axis is flipped
+    inline int32_t getTileRow(const OsmAnd::TileId tileId, const OsmAnd::ZoomLevel zoom)
+    {
+        return static_cast<int32_t>((1u << zoom) - 1u) - tileId.y;
+    }
+
+    // Read connections created by current thread, each with flag of its cache that is set once cache is closed
+    struct ThreadReadConnections
+    {
+        QHash< QString, std::shared_ptr< const std::atomic<bool> > > connections;
+
+        ~ThreadReadConnections()
+        {
+            for (const auto& connectionName : connections.keys())
+                removeConnection(connectionName);
+        }
+
+        void removeClosedConnections()
+        {
+            auto itConnection = OsmAnd::mutableIteratorOf(connections);
+            while (itConnection.hasNext())
+            {
+                const auto& connection = itConnection.next();
+                if (!connection.value()->load())
+                    continue;
+
+                removeConnection(connection.key());
+                itConnection.remove();
+            }
+        }
+
+        static void removeConnection(const QString& connectionName)
+        {
+            QSqlDatabase::database(connectionName, false).close();
+            QSqlDatabase::removeDatabase(connectionName);
+        }
+    };
+    thread_local ThreadReadConnections s_threadReadConnections;
+}
+
+OsmAnd::SqliteTilesCache_P::SqliteTilesCache_P(SqliteTilesCache* const owner_, const uint64_t maxSize)
+    : _isOpened(false)
+    , _maxSize(maxSize)
+    , _writeBatchSize(SqliteTilesCache::DefaultWriteBatchSize)
+    , _pendingWritesCount(0)
+    , _pendingAccessesCount(0)
+    , _flushRequestsCount(0)
+    , _writerThreadIsAlive(false)
+    , owner(owner_)
+{
+}
+
+OsmAnd::SqliteTilesCache_P::~SqliteTilesCache_P()
+{
+}
+
+bool OsmAnd::SqliteTilesCache_P::open()
+{
+    const auto& filePath = owner->filePath;
+    _connectionNamePrefix = QString(QLatin1String("sqlite-tiles-cache:%1:%2"))
+        .arg(filePath)
+        .arg(reinterpret_cast<quintptr>(this));
+
+    QFileInfo(filePath).absoluteDir().mkpath(QLatin1String("."));
+
+    // Prepare database using writer connection, which is then handed over to writer thread
+    const auto writerConnectionName = _connectionNamePrefix + QLatin1String(":writer");
+    bool ok;
+    {
+        auto db = createConnection(writerConnectionName, false);
+        ok = db.isOpen();
+
+        QSqlQuery query(db);
+        ok = ok && query.exec("PRAGMA journal_mode=WAL");
+        ok = ok && query.exec("PRAGMA synchronous=NORMAL");
+        ok = ok && query.exec(
+            "CREATE TABLE IF NOT EXISTS metadata ("
+            "    name TEXT,"
+            "    value TEXT"
+            ")");
+        ok = ok && query.exec(
+            "CREATE TABLE IF NOT EXISTS tiles ("
+            "    zoom_level INTEGER,"
+            "    tile_column INTEGER,"
+            "    tile_row INTEGER,"
+            "    tile_data BLOB"
+            ")");
+        ok = ok && query.exec(
+            "CREATE UNIQUE INDEX IF NOT EXISTS tile_index"
+            "    ON tiles(zoom_level, tile_column, tile_row)");
+
+        // Plain MBTiles may be used as cache as well, so missing columns are added
+        bool hasExpireTime = false;
+        bool hasAccessTime = false;
+        ok = ok && query.exec("PRAGMA table_info(tiles)");
+        while (ok && query.next())
+        {
+            const auto columnName = query.value(1).toString();
+            hasExpireTime = hasExpireTime || columnName == QLatin1String("expire_time");
+            hasAccessTime = hasAccessTime || columnName == QLatin1String("access_time");
+        }
+        if (ok && !hasExpireTime)
+            ok = query.exec("ALTER TABLE tiles ADD COLUMN expire_time INTEGER NOT NULL DEFAULT 0");
+        if (ok && !hasAccessTime)
+            ok = query.exec("ALTER TABLE tiles ADD COLUMN access_time INTEGER NOT NULL DEFAULT 0");
+        ok = ok && query.exec("CREATE INDEX IF NOT EXISTS tile_access_index ON tiles(access_time)");
+
+        ok = ok && query.exec("SELECT COUNT(*), TOTAL(LENGTH(tile_data)) FROM tiles") && query.next();
+        if (ok)
+        {
+            QMutexLocker scopedLocker(&_statisticsMutex);
+            _statistics.tilesCount = query.value(0).toUInt();
+            _statistics.size = static_cast<uint64_t>(query.value(1).toDouble());
+        }
+        else
+        {
+            LogPrintf(LogSeverityLevel::Error,
+                "Failed to prepare tiles cache '%s': %s",
+                qPrintable(filePath),
+                qPrintable(db.isOpen() ? query.lastError().text() : db.lastError().text()));
+        }
+
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(writerConnectionName);
+    if (!ok)
+        return false;
+
+    _readConnectionsClosed = std::make_shared< std::atomic<bool> >(false);
+
+    _writerThreadIsAlive = true;
+    _writerThread.reset(new Concurrent::Thread(std::bind(&SqliteTilesCache_P::writerThreadProcedure, this)));
+    _writerThread->start();
+
+    _isOpened = true;
+    return true;
+}
+
+void OsmAnd::SqliteTilesCache_P::close()
+{
+    if (_writerThread)
+    {
+        {
+            QMutexLocker scopedLocker(&_pendingMutex);
+            _writerThreadIsAlive = false;
+            _writerWakeup.wakeAll();
+        }
+        REPEAT_UNTIL(_writerThread->wait());
+        _writerThread.reset();
+    }
+
+    // Connections of other threads are removed by those threads themselves
+    if (_readConnectionsClosed)
+    {
+        _readConnectionsClosed->store(true);
+        _readConnectionsClosed.reset();
+        s_threadReadConnections.removeClosedConnections();
+    }
+
+    _isOpened = false;
+}
+
+bool OsmAnd::SqliteTilesCache_P::isOpened() const
+{
+    return _isOpened;
+}
+
+uint64_t OsmAnd::SqliteTilesCache_P::getMaxSize() const
+{
+    return _maxSize.load();
+}
+
+void OsmAnd::SqliteTilesCache_P::setMaxSize(const uint64_t maxSize)
+{
+    // New limit is applied after next written batch
+    _maxSize.store(maxSize);
+}
+
+unsigned int OsmAnd::SqliteTilesCache_P::getWriteBatchSize() const
+{
+    return _writeBatchSize.load();
+}
+
+void OsmAnd::SqliteTilesCache_P::setWriteBatchSize(const unsigned int writeBatchSize)
+{
+    _writeBatchSize.store(qMax(1u, writeBatchSize));
+}
+
+bool OsmAnd::SqliteTilesCache_P::obtainTile(
+    const TileId tileId,
+    const ZoomLevel zoom,
+    QByteArray& outData,
+    bool* const pOutExpired) const
+{
+    if (!_isOpened)
+        return false;
+
+    const auto now = getTimestamp();
+    bool found = false;
+    int64_t expirationTime = 0;
+
+    // Tile that is not yet written is taken from pending changes
+    bool isPending = false;
+    {
+        QMutexLocker scopedLocker(&_pendingMutex);
+
+        for (const auto pWrites : { &_pendingWrites, &_inFlightWrites })
+        {
+            const auto citPendingWrite = (*pWrites)[zoom].constFind(tileId);
+            if (citPendingWrite == (*pWrites)[zoom].cend())
+                continue;
+
+            isPending = true;
+            found = !citPendingWrite->isRemoval;
+            if (found)
+            {
+                outData = citPendingWrite->data;
+                expirationTime = citPendingWrite->expirationTime;
+            }
+            break;
+        }
+    }
+
+    if (!isPending)
+    {
+        auto db = obtainReadConnection();
+        QSqlQuery query(db);
+        query.prepare(
+            "SELECT tile_data, expire_time FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?");
+        query.addBindValue(static_cast<int>(zoom));
+        query.addBindValue(tileId.x);
+        query.addBindValue(getTileRow(tileId, zoom));
+        if (!query.exec())
+        {
+            LogPrintf(LogSeverityLevel::Error,
+                "Failed to read %dx%d@%d from tiles cache '%s': %s",
+                tileId.x,
+                tileId.y,
+                zoom,
+                qPrintable(owner->filePath),
+                qPrintable(query.lastError().text()));
+        }
+        else if (query.next())
+        {
+            found = true;
+            outData = query.value(0).toByteArray();
+            expirationTime = query.value(1).toLongLong();
+        }
+    }
+
+    if (found)
+    {
+        // Access time is written together with next batch, since every read must not cause write
+        QMutexLocker scopedLocker(&_pendingMutex);
+        _pendingAccesses[zoom].insert(tileId, now);
+        _pendingAccessesCount++;
+    }
+
+    if (pOutExpired)
+        *pOutExpired = found && expirationTime > 0 && expirationTime <= now;
+
+    QMutexLocker scopedLocker(&_statisticsMutex);
+    if (found)
+        _statistics.hitsCount++;
+    else
+        _statistics.missesCount++;
+
+    return found;
+}
+
+void OsmAnd::SqliteTilesCache_P::storeTile(
+    const TileId tileId,
+    const ZoomLevel zoom,
+    const QByteArray& data,
+    const QDateTime& expirationTime)
+{
+    if (!_isOpened)
+        return;
+
+    PendingWrite pendingWrite;
+    pendingWrite.isRemoval = false;
+    pendingWrite.data = data;
+    pendingWrite.expirationTime = expirationTime.isValid() ? expirationTime.toMSecsSinceEpoch() : 0;
+
+    QMutexLocker scopedLocker(&_pendingMutex);
+    _pendingWrites[zoom].insert(tileId, pendingWrite);
+    if (++_pendingWritesCount >= _writeBatchSize.load())
+        _writerWakeup.wakeAll();
+}
+
+void OsmAnd::SqliteTilesCache_P::removeTile(const TileId tileId, const ZoomLevel zoom)
+{
+    if (!_isOpened)
+        return;
+
+    PendingWrite pendingWrite;
+    pendingWrite.isRemoval = true;
+    pendingWrite.expirationTime = 0;
+
+    QMutexLocker scopedLocker(&_pendingMutex);
+    _pendingWrites[zoom].insert(tileId, pendingWrite);
+    if (++_pendingWritesCount >= _writeBatchSize.load())
+        _writerWakeup.wakeAll();
+}
+
+void OsmAnd::SqliteTilesCache_P::flush()
+{
+    if (!_isOpened)
+        return;
+
+    QMutexLocker scopedLocker(&_pendingMutex);
+
+    _flushRequestsCount++;
+    _writerWakeup.wakeAll();
+    while (_writerThreadIsAlive && _pendingWritesCount > 0)
+        _batchWritten.wait(&_pendingMutex);
+
+    // Batch that was taken before may still be in flight
+    while (_writerThreadIsAlive && std::any_of(_inFlightWrites.cbegin(), _inFlightWrites.cend(),
+        []
+        (const QHash<TileId, PendingWrite>& writes) -> bool
+        {
+            return !writes.isEmpty();
+        }))
+    {
+        _batchWritten.wait(&_pendingMutex);
+    }
+    _flushRequestsCount--;
+}
+
+OsmAnd::SqliteTilesCache_P::Statistics OsmAnd::SqliteTilesCache_P::getStatistics() const
+{
+    QMutexLocker scopedLocker(&_statisticsMutex);
+    return _statistics;
+}
+
+void OsmAnd::SqliteTilesCache_P::writerThreadProcedure()
+{
+    const auto connectionName = _connectionNamePrefix + QLatin1String(":writer");
+    {
+        auto db = createConnection(connectionName, false);
+
+        bool isAlive = true;
+        while (isAlive)
+        {
+            PendingAccesses accesses;
+            {
+                QMutexLocker scopedLocker(&_pendingMutex);
+
+                // Wait till batch is full, flush is requested or delay is over while something is pending
+                while (_writerThreadIsAlive && _pendingWritesCount < _writeBatchSize.load())
+                {
+                    if (_flushRequestsCount > 0 && _pendingWritesCount > 0)
+                        break;
+
+                    const auto hasPendingChanges = _pendingWritesCount > 0 || _pendingAccessesCount > 0;
+                    if (!_writerWakeup.wait(&_pendingMutex, WriteDelay) && hasPendingChanges)
+                        break;
+                }
+                isAlive = _writerThreadIsAlive;
+
+                std::swap(_inFlightWrites, _pendingWrites);
+                std::swap(accesses, _pendingAccesses);
+                _pendingWritesCount = 0;
+                _pendingAccessesCount = 0;
+            }
+
+            if (db.isOpen())
+            {
+                writeBatch(db, _inFlightWrites, accesses);
+                if (_maxSize.load() > 0)
+                    evictTiles(db);
+            }
+
+            {
+                QMutexLocker scopedLocker(&_pendingMutex);
+
+                for (auto& writes : _inFlightWrites)
+                    writes.clear();
+                _batchWritten.wakeAll();
+            }
+        }
+
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+bool OsmAnd::SqliteTilesCache_P::writeBatch(QSqlDatabase& db, const PendingWrites& writes, const PendingAccesses& accesses)
+{
+    const auto hasChanges = std::any_of(writes.cbegin(), writes.cend(),
+        []
+        (const QHash<TileId, PendingWrite>& writesOfZoom) -> bool
+        {
+            return !writesOfZoom.isEmpty();
+        });
+    const auto hasAccesses = std::any_of(accesses.cbegin(), accesses.cend(),
+        []
+        (const QHash<TileId, int64_t>& accessesOfZoom) -> bool
+        {
+            return !accessesOfZoom.isEmpty();
+        });
+    if (!hasChanges && !hasAccesses)
+        return true;
+
+    const auto now = getTimestamp();
+    int64_t sizeDelta = 0;
+    int tilesCountDelta = 0;
+    unsigned int writtenTilesCount = 0;
+
+    db.transaction();
+
+    QSqlQuery selectQuery(db);
+    selectQuery.prepare(
+        "SELECT LENGTH(tile_data) FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?");
+    QSqlQuery insertQuery(db);
+    insertQuery.prepare(
+        "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data, expire_time, access_time) "
+        "VALUES ( ?, ?, ?, ?, ?, ? )");
+    QSqlQuery deleteQuery(db);
+    deleteQuery.prepare(
+        "DELETE FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?");
+    QSqlQuery touchQuery(db);
+    touchQuery.prepare(
+        "UPDATE tiles SET access_time = ? WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?");
+
+    bool ok = true;
+    for (auto zoom = MinZoomLevel; zoom <= MaxZoomLevel; zoom = static_cast<ZoomLevel>(zoom + 1))
+    {
+        for (const auto& itWrite : rangeOf(constOf(writes[zoom])))
+        {
+            const auto tileId = itWrite.key();
+            const auto& write = itWrite.value();
+
+            // Size of replaced tile is needed to keep total size
+            selectQuery.addBindValue(static_cast<int>(zoom));
+            selectQuery.addBindValue(tileId.x);
+            selectQuery.addBindValue(getTileRow(tileId, zoom));
+            if (selectQuery.exec() && selectQuery.next())
+            {
+                sizeDelta -= selectQuery.value(0).toLongLong();
+                tilesCountDelta--;
+            }
+            selectQuery.finish();
+
+            auto& query = write.isRemoval ? deleteQuery : insertQuery;
+            query.addBindValue(static_cast<int>(zoom));
+            query.addBindValue(tileId.x);
+            query.addBindValue(getTileRow(tileId, zoom));
+            if (!write.isRemoval)
+            {
+                query.addBindValue(write.data);
+                query.addBindValue(static_cast<qlonglong>(write.expirationTime));
+                query.addBindValue(static_cast<qlonglong>(now));
+            }
+            if (!query.exec())
+            {
+                LogPrintf(LogSeverityLevel::Error,
+                    "Failed to write %dx%d@%d to tiles cache '%s': %s",
+                    tileId.x,
+                    tileId.y,
+                    zoom,
+                    qPrintable(owner->filePath),
+                    qPrintable(query.lastError().text()));
+                ok = false;
+                continue;
+            }
+
+            if (!write.isRemoval)
+            {
+                sizeDelta += write.data.size();
+                tilesCountDelta++;
+                writtenTilesCount++;
+            }
+        }
+
+        for (const auto& itAccess : rangeOf(constOf(accesses[zoom])))
+        {
+            const auto tileId = itAccess.key();
+
+            touchQuery.addBindValue(static_cast<qlonglong>(itAccess.value()));
+            touchQuery.addBindValue(static_cast<int>(zoom));
+            touchQuery.addBindValue(tileId.x);
+            touchQuery.addBindValue(getTileRow(tileId, zoom));
+            touchQuery.exec();
+        }
+    }
+
+    if (!db.commit())
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to commit tiles cache '%s': %s",
+            qPrintable(owner->filePath),
+            qPrintable(db.lastError().text()));
+        db.rollback();
+        return false;
+    }
+
+    QMutexLocker scopedLocker(&_statisticsMutex);
+    _statistics.size = static_cast<uint64_t>(qMax<int64_t>(0, static_cast<int64_t>(_statistics.size) + sizeDelta));
+    _statistics.tilesCount = static_cast<unsigned int>(qMax(0, static_cast<int>(_statistics.tilesCount) + tilesCountDelta));
+    _statistics.writtenTilesCount += writtenTilesCount;
+
+    return ok;
+}
+
+bool OsmAnd::SqliteTilesCache_P::evictTiles(QSqlDatabase& db)
+{
+    const auto maxSize = _maxSize.load();
+    uint64_t size;
+    {
+        QMutexLocker scopedLocker(&_statisticsMutex);
+        size = _statistics.size;
+    }
+    if (size <= maxSize)
+        return true;
+
+    // Evict a bit more than needed, so that eviction doesn't happen after each batch
+    const auto targetSize = maxSize - maxSize / 10;
+    unsigned int evictedTilesCount = 0;
+
+    db.transaction();
+
+    QSqlQuery selectQuery(db);
+    selectQuery.prepare("SELECT rowid, LENGTH(tile_data) FROM tiles ORDER BY access_time ASC LIMIT ?");
+    QSqlQuery deleteQuery(db);
+    deleteQuery.prepare("DELETE FROM tiles WHERE rowid = ?");
+
+    bool ok = true;
+    while (ok && size > targetSize)
+    {
+        selectQuery.addBindValue(static_cast<int>(EvictionBatchSize));
+        ok = selectQuery.exec();
+
+        QList<qlonglong> rowIds;
+        while (ok && size > targetSize && selectQuery.next())
+        {
+            rowIds.push_back(selectQuery.value(0).toLongLong());
+            size -= qMin(size, static_cast<uint64_t>(selectQuery.value(1).toLongLong()));
+        }
+        selectQuery.finish();
+        if (rowIds.isEmpty())
+            break;
+
+        for (const auto rowId : constOf(rowIds))
+        {
+            deleteQuery.addBindValue(rowId);
+            ok = ok && deleteQuery.exec();
+        }
+        evictedTilesCount += rowIds.size();
+    }
+
+    if (!ok || !db.commit())
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to evict tiles from tiles cache '%s': %s",
+            qPrintable(owner->filePath),
+            qPrintable(db.lastError().text()));
+        db.rollback();
+        return false;
+    }
+
+    QMutexLocker scopedLocker(&_statisticsMutex);
+    _statistics.size = size;
+    _statistics.tilesCount -= qMin(_statistics.tilesCount, evictedTilesCount);
+    _statistics.evictedTilesCount += evictedTilesCount;
+
+    return true;
+}
+
+QSqlDatabase OsmAnd::SqliteTilesCache_P::obtainReadConnection() const
+{
+    auto& threadReadConnections = s_threadReadConnections;
+
+    // Connections of closed caches (possibly even of previous opening of this one) are not needed anymore
+    threadReadConnections.removeClosedConnections();
+
+    const auto connectionName = _connectionNamePrefix + QLatin1String(":reader:") +
+        QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+    if (threadReadConnections.connections.contains(connectionName))
+        return QSqlDatabase::database(connectionName, false);
+
+    threadReadConnections.connections.insert(connectionName, _readConnectionsClosed);
+    return createConnection(connectionName, true);
+}
+
+QSqlDatabase OsmAnd::SqliteTilesCache_P::createConnection(const QString& connectionName, const bool readOnly) const
+{
+    auto db = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), connectionName);
+    db.setDatabaseName(owner->filePath);
+    db.setConnectOptions(readOnly
+        ? QLatin1String("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000")
+        : QLatin1String("QSQLITE_BUSY_TIMEOUT=5000"));
+    if (!db.open())
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to open tiles cache '%s': %s",
+            qPrintable(owner->filePath),
+            qPrintable(db.lastError().text()));
+    }
+
+    return db;
+}
+
+int64_t OsmAnd::SqliteTilesCache_P::getTimestamp()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
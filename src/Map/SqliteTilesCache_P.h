@@ -0,0 +1,120 @@
+#ifndef _OSMAND_CORE_SQLITE_TILES_CACHE_P_H_
+#define _OSMAND_CORE_SQLITE_TILES_CACHE_P_H_
+
+#include "stdlib_common.h"
+#include <array>
+#include <atomic>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QDateTime>
+#include <QSqlDatabase>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+#include "PrivateImplementation.h"
+#include "Thread.h"
+#include "SqliteTilesCache.h"
+
+namespace OsmAnd
+{
+    class SqliteTilesCache_P Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(SqliteTilesCache_P);
+    public:
+        typedef SqliteTilesCache::Statistics Statistics;
+
+        enum
+        {
+            // Writer commits pending changes at least that often, even if batch is not full
+            WriteDelay = 1000,
+
+            EvictionBatchSize = 256,
+        };
+
+    private:
+        struct PendingWrite
+        {
+            bool isRemoval;
+            QByteArray data;
+            int64_t expirationTime;
+        };
+        typedef std::array< QHash<TileId, PendingWrite>, ZoomLevelsCount > PendingWrites;
+        typedef std::array< QHash<TileId, int64_t>, ZoomLevelsCount > PendingAccesses;
+
+        bool _isOpened;
+        QString _connectionNamePrefix;
+        std::atomic<uint64_t> _maxSize;
+        std::atomic<unsigned int> _writeBatchSize;
+
+        // Changes that are not yet written are visible to readers: pending ones are waiting for the writer,
+        // in-flight ones are being written right now
+        mutable QMutex _pendingMutex;
+        QWaitCondition _writerWakeup;
+        QWaitCondition _batchWritten;
+        PendingWrites _pendingWrites;
+        PendingWrites _inFlightWrites;
+        mutable PendingAccesses _pendingAccesses;
+        unsigned int _pendingWritesCount;
+        mutable unsigned int _pendingAccessesCount;
+        unsigned int _flushRequestsCount;
+        bool _writerThreadIsAlive;
+        std::unique_ptr<Concurrent::Thread> _writerThread;
+        void writerThreadProcedure();
+        bool writeBatch(QSqlDatabase& db, const PendingWrites& writes, const PendingAccesses& accesses);
+        bool evictTiles(QSqlDatabase& db);
+
+        // Each reading thread gets own connection, since connection can not be shared between threads. Connection
+        // belongs to its thread and is removed only there: when thread exits, or when thread next reads from any
+        // tiles cache after this one was closed (as flagged by _readConnectionsClosed).
+        std::shared_ptr< std::atomic<bool> > _readConnectionsClosed;
+        QSqlDatabase obtainReadConnection() const;
+        QSqlDatabase createConnection(const QString& connectionName, const bool readOnly) const;
+
+        mutable QMutex _statisticsMutex;
+        mutable Statistics _statistics;
+
+        static int64_t getTimestamp();
+    protected:
+        SqliteTilesCache_P(SqliteTilesCache* const owner, const uint64_t maxSize);
+
+        bool open();
+        void close();
+    public:
+        ~SqliteTilesCache_P();
+
+        ImplementationInterface<SqliteTilesCache> owner;
+
+        bool isOpened() const;
+
+        uint64_t getMaxSize() const;
+        void setMaxSize(const uint64_t maxSize);
+
+        unsigned int getWriteBatchSize() const;
+        void setWriteBatchSize(const unsigned int writeBatchSize);
+
+        bool obtainTile(
+            const TileId tileId,
+            const ZoomLevel zoom,
+            QByteArray& outData,
+            bool* const pOutExpired) const;
+        void storeTile(
+            const TileId tileId,
+            const ZoomLevel zoom,
+            const QByteArray& data,
+            const QDateTime& expirationTime);
+        void removeTile(const TileId tileId, const ZoomLevel zoom);
+        void flush();
+
+        Statistics getStatistics() const;
+
+    friend class OsmAnd::SqliteTilesCache;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_SQLITE_TILES_CACHE_P_H_)
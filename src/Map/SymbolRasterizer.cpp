@@ -1,6 +1,9 @@
 #include "SymbolRasterizer.h"
 #include "SymbolRasterizer_P.h"
 
+#include "IMemoryManager.h"
+#include "MetricsRegistry.h"
+
 OsmAnd::SymbolRasterizer::SymbolRasterizer(
     const std::shared_ptr<const TextRasterizer>& textRasterizer_ /*= TextRasterizer::getDefault()*/)
     : _p(new SymbolRasterizer_P(this))
@@ -18,6 +21,10 @@ void OsmAnd::SymbolRasterizer::rasterize(
     const FilterByMapObject filter /*= nullptr*/,
     const std::shared_ptr<const IQueryController>& queryController /*= nullptr*/) const
 {
+    const MemoryTagScope memoryTagScope("Symbol rasterization");
+    static const auto rasterizeHistogram = MetricsRegistry::getDefault().obtainHistogram(QLatin1String("rasterize_symbols"));
+    const MetricsRegistry::ScopedTimer rasterizeTimer(MetricsRegistry::getDefault(), rasterizeHistogram);
+
     _p->rasterize(primitivisedObjects, outSymbolsGroups, filter, queryController);
 }
 
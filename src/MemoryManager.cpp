@@ -1,10 +1,92 @@
 #include "MemoryManager.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
+#include <limits>
+#if defined(_WIN32)
+#   include <malloc.h>
+#endif
+
+thread_local OsmAnd::MemoryManager::ThreadCache OsmAnd::MemoryManager::_threadCache;
+thread_local OsmAnd::MemoryManager::ThreadCacheReleaser OsmAnd::MemoryManager::_threadCacheReleaser;
+
+const uint32_t OsmAnd::MemoryManager::_sizeClassesBlockSizes[SizeClassesCount] =
+{
+    32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048,
+};
+
+static inline void* allocateAlignedMemory(const std::size_t size)
+{
+#if defined(_WIN32)
+    return _aligned_malloc(size, size);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, size, size) != 0)
+        return nullptr;
+    return ptr;
+#endif
+}
+
+static inline void freeAlignedMemory(void* const ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+static inline void updatePeak(std::atomic<int64_t>& peak, const int64_t value)
+{
+    auto currentPeak = peak.load(std::memory_order_relaxed);
+    while (value > currentPeak && !peak.compare_exchange_weak(currentPeak, value, std::memory_order_relaxed))
+    {
+    }
+}
 
 OsmAnd::MemoryManager::MemoryManager()
+    : _poolsReservedBytes(0)
+    , _tagsCount(1)
+    , _liveBytes(0)
+    , _peakBytes(0)
+    , _pooledAllocationsCount(0)
+    , _largeAllocationsCount(0)
 {
+    static_assert(sizeof(BlockHeader) == 16, "Block header has to keep payload aligned same as malloc does");
+    static_assert(sizeof(FreeBlock) <= sizeof(BlockHeader), "Free block link has to fit into block header");
+    static_assert(sizeof(ChunkHeader) <= ChunkHeaderSize, "Chunk header has to keep blocks aligned");
+
+    unsigned int sizeClass = 0;
+    for (unsigned int index = 0; index <= MaxPooledBlockSize / SizeClassGranularity; index++)
+    {
+        while (_sizeClassesBlockSizes[sizeClass] < index * SizeClassGranularity)
+            sizeClass++;
+        _sizeClassBySize[index] = static_cast<uint8_t>(sizeClass);
+    }
+
+    for (auto sizeClass = 0u; sizeClass < SizeClassesCount; sizeClass++)
+    {
+        auto& depot = _depots[sizeClass];
+        depot.head = nullptr;
+        depot.count = 0;
+        depot.trimCount = getDepotTrimCount(sizeClass);
+    }
+
+    for (auto& tag : _tags)
+    {
+        tag.name.store(nullptr, std::memory_order_relaxed);
+        tag.liveBytes.store(0, std::memory_order_relaxed);
+        tag.peakBytes.store(0, std::memory_order_relaxed);
+        tag.allocationsCount.store(0, std::memory_order_relaxed);
+    }
+
+    // Tag #0 also collects everything that didn't fit into tags table
+    _tags[0].name.store("global", std::memory_order_release);
 }
 
 OsmAnd::MemoryManager::~MemoryManager()
@@ -15,12 +97,524 @@ OsmAnd::MemoryManager::~MemoryManager()
 
 void* OsmAnd::MemoryManager::allocate(std::size_t size, const char* tag)
 {
-    Q_UNUSED(tag);
-    return std::malloc(size);
+    if (size > std::numeric_limits<std::size_t>::max() - sizeof(BlockHeader))
+        return nullptr;
+
+    const auto cache = obtainThreadCache();
+    const auto tagIndex = resolveTagIndex(cache, tag);
+    const auto blockSize = size + sizeof(BlockHeader);
+
+    BlockHeader* block = nullptr;
+    if (blockSize <= MaxPooledBlockSize)
+    {
+        const auto sizeClass = _sizeClassBySize[(blockSize + SizeClassGranularity - 1) / SizeClassGranularity];
+        block = obtainPooledBlock(cache, sizeClass);
+        if (!block)
+            return nullptr;
+        block->sizeClass = sizeClass;
+        block->blockSize = _sizeClassesBlockSizes[sizeClass];
+    }
+    else
+    {
+        block = static_cast<BlockHeader*>(std::malloc(blockSize));
+        if (!block)
+            return nullptr;
+        block->sizeClass = LargeBlockSizeClass;
+        block->blockSize = blockSize;
+    }
+    block->tagIndex = tagIndex;
+
+    account(cache, tagIndex, static_cast<int64_t>(block->blockSize));
+    countAllocation(cache, block->sizeClass != LargeBlockSizeClass);
+
+    return block + 1;
 }
 
 void OsmAnd::MemoryManager::free(void* ptr, const char* tag)
 {
+    // Block is always accounted to the tag it was allocated with, since it may be freed by different subsystem
     Q_UNUSED(tag);
-    std::free(ptr);
-}
\ No newline at end of file
+
+    if (!ptr)
+        return;
+
+    const auto block = static_cast<BlockHeader*>(ptr) - 1;
+    const auto cache = obtainThreadCache();
+
+    account(cache, block->tagIndex, -static_cast<int64_t>(block->blockSize));
+
+    if (block->sizeClass == LargeBlockSizeClass)
+        std::free(block);
+    else
+        releasePooledBlock(cache, block);
+}
+
+OsmAnd::MemoryManager::Statistics OsmAnd::MemoryManager::getStatistics() const
+{
+    Statistics statistics;
+
+    statistics.liveBytes = _liveBytes.load(std::memory_order_relaxed);
+    statistics.peakBytes = _peakBytes.load(std::memory_order_relaxed);
+    statistics.pooledAllocationsCount = _pooledAllocationsCount.load(std::memory_order_relaxed);
+    statistics.largeAllocationsCount = _largeAllocationsCount.load(std::memory_order_relaxed);
+    statistics.poolsReservedBytes = _poolsReservedBytes.load(std::memory_order_relaxed);
+
+    const auto tagsCount = _tagsCount.load(std::memory_order_acquire);
+    for (auto tagIndex = 0u; tagIndex < tagsCount; tagIndex++)
+    {
+        const auto& tag = _tags[tagIndex];
+
+        TagStatistics tagStatistics;
+        tagStatistics.tag = QString::fromLatin1(tag.name.load(std::memory_order_acquire));
+        tagStatistics.liveBytes = tag.liveBytes.load(std::memory_order_relaxed);
+        tagStatistics.peakBytes = tag.peakBytes.load(std::memory_order_relaxed);
+        tagStatistics.allocationsCount = tag.allocationsCount.load(std::memory_order_relaxed);
+        statistics.tags.push_back(tagStatistics);
+    }
+
+    return statistics;
+}
+
+void OsmAnd::MemoryManager::resetPeaks()
+{
+    const auto tagsCount = _tagsCount.load(std::memory_order_acquire);
+    for (auto tagIndex = 0u; tagIndex < tagsCount; tagIndex++)
+    {
+        auto& tag = _tags[tagIndex];
+        tag.peakBytes.store(tag.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    _peakBytes.store(_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void OsmAnd::MemoryManager::releaseUnusedMemory()
+{
+    // Free blocks cached by other threads can't be taken from them, so only calling thread gives its blocks back
+    const auto cache = obtainThreadCache();
+    for (auto sizeClass = 0u; sizeClass < SizeClassesCount; sizeClass++)
+    {
+        if (cache)
+            drainToDepot(*cache, sizeClass, 0);
+
+        ChunkHeader* releasedChunks = nullptr;
+        {
+            std::lock_guard<std::mutex> scopedLocker(_depots[sizeClass].mutex);
+
+            releasedChunks = trimDepotNoLock(sizeClass);
+        }
+        releaseChunks(releasedChunks);
+    }
+}
+
+OsmAnd::MemoryManager::ThreadCache* OsmAnd::MemoryManager::obtainThreadCache()
+{
+    auto& cache = _threadCache;
+    if (Q_UNLIKELY(!cache.initialized))
+    {
+        cache.initialized = true;
+        _threadCacheReleaser.touch();
+    }
+
+    // After thread cache was released on thread exit, remaining destructors go directly to depots
+    return cache.released ? nullptr : &cache;
+}
+
+void OsmAnd::MemoryManager::releaseThreadCache(ThreadCache& cache)
+{
+    if (cache.released)
+        return;
+
+    for (auto sizeClass = 0u; sizeClass < SizeClassesCount; sizeClass++)
+        drainToDepot(cache, sizeClass, 0);
+    for (auto tagIndex = 0u; tagIndex < MaxTagsCount; tagIndex++)
+        flushTagCounters(cache, tagIndex);
+    flushAllocationsCounters(cache);
+
+    cache.released = true;
+}
+
+OsmAnd::MemoryManager::ThreadCacheReleaser::~ThreadCacheReleaser()
+{
+    static_cast<MemoryManager*>(getMemoryManager())->releaseThreadCache(_threadCache);
+}
+
+unsigned int OsmAnd::MemoryManager::resolveTagIndex(ThreadCache* const cache, const char* const tag)
+{
+    if (!tag)
+        return 0;
+
+    const auto lookupCacheIndex = (reinterpret_cast<uintptr_t>(tag) >> 4) % TagsLookupCacheSize;
+    if (cache && cache->lookupCacheTags[lookupCacheIndex] == tag)
+        return cache->lookupCacheTagsIndices[lookupCacheIndex];
+
+    auto tagIndex = findTagIndex(tag, _tagsCount.load(std::memory_order_acquire));
+    if (tagIndex == MaxTagsCount)
+    {
+        std::lock_guard<std::mutex> scopedLocker(_tagsRegistrationMutex);
+
+        const auto tagsCount = _tagsCount.load(std::memory_order_relaxed);
+        tagIndex = findTagIndex(tag, tagsCount);
+        if (tagIndex == MaxTagsCount)
+        {
+            if (tagsCount < MaxTagsCount)
+            {
+                _tags[tagsCount].name.store(tag, std::memory_order_release);
+                _tagsCount.store(tagsCount + 1, std::memory_order_release);
+                tagIndex = tagsCount;
+            }
+            else
+                tagIndex = 0;
+        }
+    }
+
+    if (cache)
+    {
+        cache->lookupCacheTags[lookupCacheIndex] = tag;
+        cache->lookupCacheTagsIndices[lookupCacheIndex] = tagIndex;
+    }
+
+    return tagIndex;
+}
+
+unsigned int OsmAnd::MemoryManager::findTagIndex(const char* const tag, const unsigned int tagsCount) const
+{
+    // Same tag may come as different pointers from different translation units
+    for (auto tagIndex = 0u; tagIndex < tagsCount; tagIndex++)
+    {
+        const auto name = _tags[tagIndex].name.load(std::memory_order_acquire);
+        if (name == tag || std::strcmp(name, tag) == 0)
+            return tagIndex;
+    }
+
+    return MaxTagsCount;
+}
+
+void OsmAnd::MemoryManager::account(ThreadCache* const cache, const unsigned int tagIndex, const int64_t bytes)
+{
+    if (!cache)
+    {
+        applyTagCounters(tagIndex, bytes, bytes > 0 ? 1 : 0);
+        return;
+    }
+
+    auto& pendingLiveBytes = cache->pendingLiveBytes[tagIndex];
+    auto& pendingAllocationsCount = cache->pendingAllocationsCount[tagIndex];
+    pendingLiveBytes += bytes;
+    if (bytes > 0)
+        pendingAllocationsCount++;
+
+    if (pendingLiveBytes >= TagCountersFlushThreshold ||
+        pendingLiveBytes <= -static_cast<int64_t>(TagCountersFlushThreshold) ||
+        pendingAllocationsCount >= AllocationsCountersFlushThreshold)
+    {
+        flushTagCounters(*cache, tagIndex);
+    }
+}
+
+void OsmAnd::MemoryManager::countAllocation(ThreadCache* const cache, const bool isPooled)
+{
+    if (!cache)
+    {
+        (isPooled ? _pooledAllocationsCount : _largeAllocationsCount).fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& pendingAllocationsCount = isPooled
+        ? cache->pendingPooledAllocationsCount
+        : cache->pendingLargeAllocationsCount;
+    if (++pendingAllocationsCount >= AllocationsCountersFlushThreshold)
+        flushAllocationsCounters(*cache);
+}
+
+void OsmAnd::MemoryManager::flushTagCounters(ThreadCache& cache, const unsigned int tagIndex)
+{
+    auto& pendingLiveBytes = cache.pendingLiveBytes[tagIndex];
+    auto& pendingAllocationsCount = cache.pendingAllocationsCount[tagIndex];
+    if (pendingLiveBytes == 0 && pendingAllocationsCount == 0)
+        return;
+
+    applyTagCounters(tagIndex, pendingLiveBytes, pendingAllocationsCount);
+    pendingLiveBytes = 0;
+    pendingAllocationsCount = 0;
+}
+
+void OsmAnd::MemoryManager::flushAllocationsCounters(ThreadCache& cache)
+{
+    _pooledAllocationsCount.fetch_add(cache.pendingPooledAllocationsCount, std::memory_order_relaxed);
+    _largeAllocationsCount.fetch_add(cache.pendingLargeAllocationsCount, std::memory_order_relaxed);
+    cache.pendingPooledAllocationsCount = 0;
+    cache.pendingLargeAllocationsCount = 0;
+}
+
+void OsmAnd::MemoryManager::applyTagCounters(
+    const unsigned int tagIndex,
+    const int64_t bytes,
+    const uint64_t allocationsCount)
+{
+    auto& tag = _tags[tagIndex];
+
+    const auto tagLiveBytes = tag.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    updatePeak(tag.peakBytes, tagLiveBytes);
+    if (allocationsCount > 0)
+        tag.allocationsCount.fetch_add(allocationsCount, std::memory_order_relaxed);
+
+    const auto liveBytes = _liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    updatePeak(_peakBytes, liveBytes);
+}
+
+unsigned int OsmAnd::MemoryManager::getThreadCacheCapacity(const unsigned int sizeClass)
+{
+    return ThreadCacheSizePerSizeClass / _sizeClassesBlockSizes[sizeClass];
+}
+
+unsigned int OsmAnd::MemoryManager::getChunkBlocksCount(const unsigned int sizeClass)
+{
+    return (PoolChunkSize - ChunkHeaderSize) / _sizeClassesBlockSizes[sizeClass];
+}
+
+unsigned int OsmAnd::MemoryManager::getDepotTrimCount(const unsigned int sizeClass)
+{
+    return DepotTrimThreshold / _sizeClassesBlockSizes[sizeClass];
+}
+
+OsmAnd::MemoryManager::BlockHeader* OsmAnd::MemoryManager::obtainPooledBlock(
+    ThreadCache* const cache,
+    const unsigned int sizeClass)
+{
+    if (cache)
+    {
+        auto& head = cache->heads[sizeClass];
+        if (!head)
+            refillThreadCache(*cache, sizeClass);
+
+        const auto block = head;
+        if (!block)
+            return nullptr;
+        head = block->next;
+        cache->counts[sizeClass]--;
+
+        return reinterpret_cast<BlockHeader*>(block);
+    }
+
+    auto& depot = _depots[sizeClass];
+    {
+        std::lock_guard<std::mutex> scopedLocker(depot.mutex);
+
+        if (const auto block = depot.head)
+        {
+            depot.head = block->next;
+            depot.count--;
+
+            return reinterpret_cast<BlockHeader*>(block);
+        }
+    }
+
+    FreeBlock* tail = nullptr;
+    unsigned int count = 0;
+    const auto block = allocateChunk(sizeClass, tail, count);
+    if (!block)
+        return nullptr;
+    if (count > 1)
+        pushToDepot(sizeClass, block->next, tail, count - 1);
+
+    return reinterpret_cast<BlockHeader*>(block);
+}
+
+void OsmAnd::MemoryManager::releasePooledBlock(ThreadCache* const cache, BlockHeader* const block)
+{
+    const auto sizeClass = block->sizeClass;
+    const auto freeBlock = reinterpret_cast<FreeBlock*>(block);
+
+    if (!cache)
+    {
+        freeBlock->next = nullptr;
+        pushToDepot(sizeClass, freeBlock, freeBlock, 1);
+        return;
+    }
+
+    freeBlock->next = cache->heads[sizeClass];
+    cache->heads[sizeClass] = freeBlock;
+    cache->counts[sizeClass]++;
+
+    // Keep half of capacity, so that alternating allocations and frees don't bounce blocks to depot and back
+    const auto capacity = getThreadCacheCapacity(sizeClass);
+    if (cache->counts[sizeClass] > capacity)
+        drainToDepot(*cache, sizeClass, capacity / 2);
+}
+
+void OsmAnd::MemoryManager::refillThreadCache(ThreadCache& cache, const unsigned int sizeClass)
+{
+    auto& head = cache.heads[sizeClass];
+    auto& count = cache.counts[sizeClass];
+    const auto batchSize = qMax(getThreadCacheCapacity(sizeClass) / 2, 1u);
+
+    auto& depot = _depots[sizeClass];
+    {
+        std::lock_guard<std::mutex> scopedLocker(depot.mutex);
+
+        while (depot.head && count < batchSize)
+        {
+            const auto block = depot.head;
+            depot.head = block->next;
+            depot.count--;
+
+            block->next = head;
+            head = block;
+            count++;
+        }
+    }
+    if (head)
+        return;
+
+    FreeBlock* tail = nullptr;
+    unsigned int chunkBlocksCount = 0;
+    const auto chunkHead = allocateChunk(sizeClass, tail, chunkBlocksCount);
+    if (!chunkHead)
+        return;
+
+    tail->next = head;
+    head = chunkHead;
+    count += chunkBlocksCount;
+}
+
+void OsmAnd::MemoryManager::drainToDepot(ThreadCache& cache, const unsigned int sizeClass, const unsigned int keepCount)
+{
+    auto& head = cache.heads[sizeClass];
+    auto& count = cache.counts[sizeClass];
+    if (count <= keepCount)
+        return;
+
+    FreeBlock* drainedHead = nullptr;
+    if (keepCount == 0)
+    {
+        drainedHead = head;
+        head = nullptr;
+    }
+    else
+    {
+        auto lastKeptBlock = head;
+        for (auto index = 1u; index < keepCount; index++)
+            lastKeptBlock = lastKeptBlock->next;
+        drainedHead = lastKeptBlock->next;
+        lastKeptBlock->next = nullptr;
+    }
+
+    const auto drainedCount = count - keepCount;
+    auto drainedTail = drainedHead;
+    for (auto index = 1u; index < drainedCount; index++)
+        drainedTail = drainedTail->next;
+
+    pushToDepot(sizeClass, drainedHead, drainedTail, drainedCount);
+    count = keepCount;
+}
+
+void OsmAnd::MemoryManager::pushToDepot(
+    const unsigned int sizeClass,
+    FreeBlock* const head,
+    FreeBlock* const tail,
+    const unsigned int count)
+{
+    auto& depot = _depots[sizeClass];
+
+    ChunkHeader* releasedChunks = nullptr;
+    {
+        std::lock_guard<std::mutex> scopedLocker(depot.mutex);
+
+        tail->next = depot.head;
+        depot.head = head;
+        depot.count += count;
+
+        // Trim is repeated only after depot doubles, since scattered blocks may keep all chunks in use
+        if (depot.count >= depot.trimCount)
+        {
+            releasedChunks = trimDepotNoLock(sizeClass);
+            depot.trimCount = qMax(getDepotTrimCount(sizeClass), depot.count * 2);
+        }
+    }
+    releaseChunks(releasedChunks);
+}
+
+OsmAnd::MemoryManager::FreeBlock* OsmAnd::MemoryManager::allocateChunk(
+    const unsigned int sizeClass,
+    FreeBlock*& outTail,
+    unsigned int& outCount)
+{
+    const auto chunk = static_cast<uint8_t*>(allocateAlignedMemory(PoolChunkSize));
+    if (!chunk)
+        return nullptr;
+    _poolsReservedBytes.fetch_add(PoolChunkSize, std::memory_order_relaxed);
+
+    const auto chunkHeader = reinterpret_cast<ChunkHeader*>(chunk);
+    chunkHeader->nextReleased = nullptr;
+    chunkHeader->depotBlocksCount = 0;
+    chunkHeader->released = 0;
+
+    const auto blocks = chunk + ChunkHeaderSize;
+    const auto blockSize = _sizeClassesBlockSizes[sizeClass];
+    const auto blocksCount = getChunkBlocksCount(sizeClass);
+    for (auto blockIndex = 0u; blockIndex < blocksCount; blockIndex++)
+    {
+        const auto block = reinterpret_cast<FreeBlock*>(blocks + blockIndex * blockSize);
+        block->next = (blockIndex + 1 < blocksCount)
+            ? reinterpret_cast<FreeBlock*>(blocks + (blockIndex + 1) * blockSize)
+            : nullptr;
+    }
+
+    outTail = reinterpret_cast<FreeBlock*>(blocks + (blocksCount - 1) * blockSize);
+    outCount = blocksCount;
+    return reinterpret_cast<FreeBlock*>(blocks);
+}
+
+OsmAnd::MemoryManager::ChunkHeader* OsmAnd::MemoryManager::trimDepotNoLock(const unsigned int sizeClass)
+{
+    auto& depot = _depots[sizeClass];
+    const auto getChunkHeader =
+        []
+        (const FreeBlock* const block) -> ChunkHeader*
+        {
+            return reinterpret_cast<ChunkHeader*>(
+                reinterpret_cast<uintptr_t>(block) & ~static_cast<uintptr_t>(PoolChunkSize - 1));
+        };
+
+    // Count blocks of each chunk that are in depot
+    for (auto block = depot.head; block; block = block->next)
+        getChunkHeader(block)->depotBlocksCount++;
+
+    // Chunk that has all its blocks in depot is not used by anyone, so its blocks are unlinked and chunk is released.
+    // Counter of chunk that stays is reset on its first block, and it can't reach full count after that.
+    const auto chunkBlocksCount = getChunkBlocksCount(sizeClass);
+    ChunkHeader* releasedChunks = nullptr;
+    auto pLink = &depot.head;
+    while (const auto block = *pLink)
+    {
+        const auto chunkHeader = getChunkHeader(block);
+        if (chunkHeader->depotBlocksCount != chunkBlocksCount)
+        {
+            chunkHeader->depotBlocksCount = 0;
+            pLink = &block->next;
+            continue;
+        }
+
+        *pLink = block->next;
+        depot.count--;
+        if (!chunkHeader->released)
+        {
+            chunkHeader->released = 1;
+            chunkHeader->nextReleased = releasedChunks;
+            releasedChunks = chunkHeader;
+        }
+    }
+
+    return releasedChunks;
+}
+
+void OsmAnd::MemoryManager::releaseChunks(ChunkHeader* releasedChunks)
+{
+    while (releasedChunks)
+    {
+        const auto chunkHeader = releasedChunks;
+        releasedChunks = chunkHeader->nextReleased;
+
+        freeAlignedMemory(chunkHeader);
+        _poolsReservedBytes.fetch_sub(PoolChunkSize, std::memory_order_relaxed);
+    }
+}
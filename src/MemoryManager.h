@@ -2,6 +2,8 @@
 #define _OSMAND_CORE_MEMORY_MANAGER_H_
 
 #include "stdlib_common.h"
+#include <atomic>
+#include <mutex>
 
 #include "QtExtensions.h"
 
@@ -10,10 +12,146 @@
 
 namespace OsmAnd
 {
+    // Memory manager that serves small allocations from thread-local size-class pools (so worker threads don't
+    // contend on malloc) and accounts live and peak bytes per allocation tag. Each block is prefixed with a header
+    // that remembers its size class and tag, so block is always accounted to the tag it was allocated with.
+    // Chunks whose blocks are all back in depot are returned to system once depot grows too large, or on demand.
+    //NOTE: Only std:: primitives are used inside, since anything from Qt may call operator new itself
     class MemoryManager : public IMemoryManager
     {
         Q_DISABLE_COPY_AND_MOVE(MemoryManager);
+    public:
+        enum : unsigned int
+        {
+            SizeClassesCount = 23,
+            SizeClassGranularity = 16,
+            MaxPooledBlockSize = 2048,
+            LargeBlockSizeClass = 0xFFFFFFFFu,
+
+            // Size of memory chunk requested from system to refill pool of single size class. Chunks are aligned
+            // to their size, so that chunk of any block is known from its address
+            PoolChunkSize = 32 * 1024,
+            ChunkHeaderSize = 16,
+            // Once free blocks in depot of single size class take more than this, chunks that are entirely free
+            // are returned to system
+            DepotTrimThreshold = 256 * 1024,
+            // Maximal size of blocks of single size class kept in thread cache
+            ThreadCacheSizePerSizeClass = 64 * 1024,
+
+            MaxTagsCount = 128,
+            TagsLookupCacheSize = 4,
+            // Per-tag deltas are kept thread-locally until they reach this size
+            TagCountersFlushThreshold = 64 * 1024,
+            AllocationsCountersFlushThreshold = 4096,
+        };
+
     private:
+        struct BlockHeader
+        {
+            uint32_t sizeClass;
+            uint32_t tagIndex;
+            uint64_t blockSize;
+        };
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        struct ChunkHeader
+        {
+            ChunkHeader* nextReleased;
+            uint32_t depotBlocksCount;
+            uint32_t released;
+        };
+
+        struct Tag
+        {
+            std::atomic<const char*> name;
+            std::atomic<int64_t> liveBytes;
+            std::atomic<int64_t> peakBytes;
+            std::atomic<uint64_t> allocationsCount;
+        };
+
+        struct Depot
+        {
+            std::mutex mutex;
+            FreeBlock* head;
+            unsigned int count;
+            // Count of blocks in depot that triggers next trim
+            unsigned int trimCount;
+        };
+
+        // Has to stay trivial, since it's zero-initialized thread-local that is touched from operator new
+        struct ThreadCache
+        {
+            bool initialized;
+            bool released;
+            FreeBlock* heads[SizeClassesCount];
+            unsigned int counts[SizeClassesCount];
+
+            int64_t pendingLiveBytes[MaxTagsCount];
+            unsigned int pendingAllocationsCount[MaxTagsCount];
+            unsigned int pendingPooledAllocationsCount;
+            unsigned int pendingLargeAllocationsCount;
+
+            // Direct-mapped by tag pointer, since usually only few tags are in use by a thread
+            const char* lookupCacheTags[TagsLookupCacheSize];
+            unsigned int lookupCacheTagsIndices[TagsLookupCacheSize];
+        };
+        static thread_local ThreadCache _threadCache;
+
+        struct ThreadCacheReleaser
+        {
+            ~ThreadCacheReleaser();
+
+            // Any access registers destructor of this thread-local on calling thread
+            void touch()
+            {
+            }
+        };
+        static thread_local ThreadCacheReleaser _threadCacheReleaser;
+
+        static const uint32_t _sizeClassesBlockSizes[SizeClassesCount];
+        uint8_t _sizeClassBySize[MaxPooledBlockSize / SizeClassGranularity + 1];
+        Depot _depots[SizeClassesCount];
+        std::atomic<size_t> _poolsReservedBytes;
+
+        std::mutex _tagsRegistrationMutex;
+        Tag _tags[MaxTagsCount];
+        std::atomic<unsigned int> _tagsCount;
+
+        std::atomic<int64_t> _liveBytes;
+        std::atomic<int64_t> _peakBytes;
+        std::atomic<uint64_t> _pooledAllocationsCount;
+        std::atomic<uint64_t> _largeAllocationsCount;
+
+        ThreadCache* obtainThreadCache();
+        void releaseThreadCache(ThreadCache& cache);
+
+        unsigned int resolveTagIndex(ThreadCache* const cache, const char* const tag);
+        unsigned int findTagIndex(const char* const tag, const unsigned int tagsCount) const;
+        void account(ThreadCache* const cache, const unsigned int tagIndex, const int64_t bytes);
+        void countAllocation(ThreadCache* const cache, const bool isPooled);
+        void flushTagCounters(ThreadCache& cache, const unsigned int tagIndex);
+        void flushAllocationsCounters(ThreadCache& cache);
+        void applyTagCounters(const unsigned int tagIndex, const int64_t bytes, const uint64_t allocationsCount);
+
+        static unsigned int getThreadCacheCapacity(const unsigned int sizeClass);
+        static unsigned int getChunkBlocksCount(const unsigned int sizeClass);
+        static unsigned int getDepotTrimCount(const unsigned int sizeClass);
+        BlockHeader* obtainPooledBlock(ThreadCache* const cache, const unsigned int sizeClass);
+        void releasePooledBlock(ThreadCache* const cache, BlockHeader* const block);
+        void refillThreadCache(ThreadCache& cache, const unsigned int sizeClass);
+        void drainToDepot(ThreadCache& cache, const unsigned int sizeClass, const unsigned int keepCount);
+        void pushToDepot(
+            const unsigned int sizeClass,
+            FreeBlock* const head,
+            FreeBlock* const tail,
+            const unsigned int count);
+        FreeBlock* allocateChunk(const unsigned int sizeClass, FreeBlock*& outTail, unsigned int& outCount);
+        ChunkHeader* trimDepotNoLock(const unsigned int sizeClass);
+        void releaseChunks(ChunkHeader* releasedChunks);
     protected:
     public:
         MemoryManager();
@@ -21,6 +159,10 @@ namespace OsmAnd
 
         virtual void* allocate(std::size_t size, const char* tag);
         virtual void free(void* ptr, const char* tag);
+
+        virtual Statistics getStatistics() const;
+        virtual void resetPeaks();
+        virtual void releaseUnusedMemory();
     };
 }
 
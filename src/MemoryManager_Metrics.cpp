@@ -0,0 +1,58 @@
+#include "MemoryManager_Metrics.h"
+
+OsmAnd::MemoryManager_Metrics::Metric_memoryUsage::Metric_memoryUsage()
+{
+    reset();
+}
+
+OsmAnd::MemoryManager_Metrics::Metric_memoryUsage::~Metric_memoryUsage()
+{
+}
+
+void OsmAnd::MemoryManager_Metrics::Metric_memoryUsage::reset()
+{
+    OsmAnd__MemoryManager_Metrics__Metric_memoryUsage__FIELDS(RESET_METRIC_FIELD);
+    tags.clear();
+
+    Metric::reset();
+}
+
+void OsmAnd::MemoryManager_Metrics::Metric_memoryUsage::visitFields(const FieldsVisitor visitor) const
+{
+    OsmAnd__MemoryManager_Metrics__Metric_memoryUsage__FIELDS(VISIT_METRIC_FIELD);
+
+    Metric::visitFields(visitor);
+}
+
+void OsmAnd::MemoryManager_Metrics::Metric_memoryUsage::capture(
+    const IMemoryManager* const memoryManager /*= getMemoryManager()*/)
+{
+    const auto statistics = memoryManager->getStatistics();
+
+    liveBytes = statistics.liveBytes;
+    peakBytes = statistics.peakBytes;
+    poolsReservedBytes = static_cast<int64_t>(statistics.poolsReservedBytes);
+    pooledAllocations = statistics.pooledAllocationsCount;
+    largeAllocations = statistics.largeAllocationsCount;
+    tags = statistics.tags;
+}
+
+QString OsmAnd::MemoryManager_Metrics::Metric_memoryUsage::toString(const bool shortFormat /*= false*/, const QString& prefix /*= QString::null*/) const
+{
+    QString output;
+
+    OsmAnd__MemoryManager_Metrics__Metric_memoryUsage__FIELDS(PRINT_METRIC_FIELD);
+    for (const auto& tagStatistics : constOf(tags))
+    {
+        output += QLatin1String("\n") + prefix + QString(QLatin1String("[%1] live = %2B, peak = %3B, allocations = %4"))
+            .arg(tagStatistics.tag)
+            .arg(tagStatistics.liveBytes)
+            .arg(tagStatistics.peakBytes)
+            .arg(tagStatistics.allocationsCount);
+    }
+    const auto submetricsString = Metric::toString(shortFormat, prefix);
+    if (!submetricsString.isEmpty())
+        output += QLatin1String("\n") + Metric::toString(shortFormat, prefix);
+
+    return output;
+}
@@ -24,6 +24,11 @@ void OsmAnd::Metric::reset()
         submetric->reset();
 }
 
+void OsmAnd::Metric::visitFields(const FieldsVisitor visitor) const
+{
+    Q_UNUSED(visitor);
+}
+
 void OsmAnd::Metric::addSubmetric(const std::shared_ptr<Metric>& submetric)
 {
     submetrics.push_back(submetric);
@@ -0,0 +1,510 @@
+#include "MetricsRegistry.h"
+#include "MetricsRegistry_P.h"
+
+#include "stdlib_common.h"
+#include <cmath>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QtAlgorithms>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "restore_internal_warnings.h"
+
+#include "Logging.h"
+
+// Each thread sticks to own stripe, so that concurrent recording doesn't contend on the same atomics
+static unsigned int getCurrentThreadStripeIndex()
+{
+    static std::atomic<unsigned int> s_nextStripeIndex(0);
+    static thread_local unsigned int s_currentThreadStripeIndex = 0;
+
+    if (Q_UNLIKELY(s_currentThreadStripeIndex == 0))
+    {
+        s_currentThreadStripeIndex =
+            (s_nextStripeIndex.fetch_add(1, std::memory_order_relaxed) % OsmAnd::MetricsRegistry::StripesCount) + 1;
+    }
+    return s_currentThreadStripeIndex - 1;
+}
+
+static QString getExportedMetricName(const QString& name)
+{
+    QString exportedName(QLatin1String("osmand_"));
+    exportedName.reserve(exportedName.size() + name.size());
+    for (const auto& character : name)
+    {
+        const auto isValid =
+            (character >= QLatin1Char('a') && character <= QLatin1Char('z')) ||
+            (character >= QLatin1Char('A') && character <= QLatin1Char('Z')) ||
+            (character >= QLatin1Char('0') && character <= QLatin1Char('9'));
+        exportedName.append(isValid ? character : QChar(QLatin1Char('_')));
+    }
+    return exportedName;
+}
+
+OsmAnd::MetricsRegistry::MetricsRegistry()
+    : _p(new MetricsRegistry_P(this))
+{
+}
+
+OsmAnd::MetricsRegistry::~MetricsRegistry()
+{
+    _p->stopExportServer();
+}
+
+bool OsmAnd::MetricsRegistry::isEnabled() const
+{
+    return _p->isEnabled();
+}
+
+void OsmAnd::MetricsRegistry::setEnabled(const bool enabled)
+{
+    _p->setEnabled(enabled);
+}
+
+OsmAnd::MetricsRegistry::Counter* OsmAnd::MetricsRegistry::obtainCounter(const QString& name)
+{
+    return _p->obtainCounter(name);
+}
+
+OsmAnd::MetricsRegistry::Gauge* OsmAnd::MetricsRegistry::obtainGauge(const QString& name)
+{
+    return _p->obtainGauge(name);
+}
+
+OsmAnd::MetricsRegistry::Histogram* OsmAnd::MetricsRegistry::obtainHistogram(const QString& name)
+{
+    return _p->obtainHistogram(name);
+}
+
+void OsmAnd::MetricsRegistry::incrementCounter(const QString& name, const uint64_t value /*= 1*/)
+{
+    if (!_p->isEnabled())
+        return;
+
+    _p->obtainCounter(name)->add(value);
+}
+
+void OsmAnd::MetricsRegistry::setGauge(const QString& name, const double value)
+{
+    if (!_p->isEnabled())
+        return;
+
+    _p->obtainGauge(name)->set(value);
+}
+
+void OsmAnd::MetricsRegistry::recordLatency(const QString& name, const float seconds)
+{
+    if (!_p->isEnabled())
+        return;
+
+    _p->obtainHistogram(name)->record(seconds);
+}
+
+void OsmAnd::MetricsRegistry::recordMetric(const QString& name, const Metric& metric)
+{
+    if (!_p->isEnabled())
+        return;
+
+    _p->recordMetric(name, metric);
+}
+
+OsmAnd::MetricsRegistry::Snapshot OsmAnd::MetricsRegistry::takeSnapshot() const
+{
+    return _p->takeSnapshot();
+}
+
+void OsmAnd::MetricsRegistry::reset()
+{
+    _p->reset();
+}
+
+QString OsmAnd::MetricsRegistry::exportSnapshot(const ExportFormat format) const
+{
+    const auto snapshot = _p->takeSnapshot();
+
+    switch (format)
+    {
+        case ExportFormat::Prometheus:
+            return snapshot.toPrometheusText();
+        case ExportFormat::Json:
+            return snapshot.toJson();
+    }
+
+    return QString::null;
+}
+
+bool OsmAnd::MetricsRegistry::exportToFile(const QString& fileName, const ExportFormat format) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to open '%s' for writing metrics",
+            qPrintable(fileName));
+        return false;
+    }
+
+    const auto data = exportSnapshot(format).toUtf8();
+    if (file.write(data) != data.size())
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to write metrics to '%s'",
+            qPrintable(fileName));
+        return false;
+    }
+
+    return true;
+}
+
+bool OsmAnd::MetricsRegistry::startExportServer(
+    const uint16_t port,
+    const ExportFormat format /*= ExportFormat::Prometheus*/)
+{
+    return _p->startExportServer(port, format);
+}
+
+void OsmAnd::MetricsRegistry::stopExportServer()
+{
+    _p->stopExportServer();
+}
+
+OsmAnd::MetricsRegistry& OsmAnd::MetricsRegistry::getDefault()
+{
+    //NOTE: Known memory leak, registry is never destroyed since worker threads may record into it till the very exit
+    static MetricsRegistry* const pDefaultRegistry = new MetricsRegistry();
+    return *pDefaultRegistry;
+}
+
+OsmAnd::MetricsRegistry::MetricRecorder::MetricRecorder(MetricsRegistry& registry_, const QString& name_)
+    : _resolved(false)
+    , registry(registry_)
+    , name(name_)
+{
+}
+
+OsmAnd::MetricsRegistry::MetricRecorder::~MetricRecorder()
+{
+}
+
+void OsmAnd::MetricsRegistry::MetricRecorder::resolve(const Metric& metric)
+{
+    QMutexLocker scopedLocker(&_resolveMutex);
+
+    if (_resolved.load(std::memory_order_relaxed))
+        return;
+
+    metric.visitFields(
+        [this]
+        (const char* const fieldName, const double value, const char* const measurement, const bool isFractional)
+        {
+            Q_UNUSED(value);
+
+            const auto kind = MetricsRegistry_P::getFieldKind(measurement, isFractional);
+            const auto entryName = MetricsRegistry_P::getFieldEntryName(name, fieldName, kind);
+
+            FieldEntries fieldEntries = { nullptr, nullptr, nullptr };
+            if (kind == MetricsRegistry_P::FieldKind::Histogram)
+                fieldEntries.histogram = registry.obtainHistogram(entryName);
+            else if (kind == MetricsRegistry_P::FieldKind::Gauge)
+                fieldEntries.gauge = registry.obtainGauge(entryName);
+            else
+                fieldEntries.counter = registry.obtainCounter(entryName);
+            _fieldsEntries.push_back(fieldEntries);
+        });
+    _resolved.store(true, std::memory_order_release);
+}
+
+void OsmAnd::MetricsRegistry::MetricRecorder::record(const Metric& metric)
+{
+    if (!registry.isEnabled())
+        return;
+    if (Q_UNLIKELY(!_resolved.load(std::memory_order_acquire)))
+        resolve(metric);
+
+    // Fields of metric type are always visited in same order, so they match entries by index
+    auto pFieldEntries = _fieldsEntries.constData();
+    const auto pFieldsEntriesEnd = pFieldEntries + _fieldsEntries.size();
+    metric.visitFields(
+        [&pFieldEntries, pFieldsEntriesEnd]
+        (const char* const fieldName, const double value, const char* const measurement, const bool isFractional)
+        {
+            Q_UNUSED(fieldName);
+            Q_UNUSED(measurement);
+            Q_UNUSED(isFractional);
+
+            if (pFieldEntries == pFieldsEntriesEnd)
+                return;
+            const auto& fieldEntries = *(pFieldEntries++);
+
+            if (fieldEntries.histogram)
+                fieldEntries.histogram->record(static_cast<float>(value));
+            else if (fieldEntries.gauge)
+                fieldEntries.gauge->set(value);
+            else if (value > 0.0)
+                fieldEntries.counter->add(static_cast<uint64_t>(std::llround(value)));
+        });
+}
+
+OsmAnd::MetricsRegistry::Counter::Counter(const QString& name_)
+    : name(name_)
+{
+    reset();
+}
+
+OsmAnd::MetricsRegistry::Counter::~Counter()
+{
+}
+
+void OsmAnd::MetricsRegistry::Counter::add(const uint64_t value /*= 1*/)
+{
+    _stripes[getCurrentThreadStripeIndex()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t OsmAnd::MetricsRegistry::Counter::getValue() const
+{
+    uint64_t value = 0;
+    for (const auto& stripe : _stripes)
+        value += stripe.value.load(std::memory_order_relaxed);
+    return value;
+}
+
+void OsmAnd::MetricsRegistry::Counter::reset()
+{
+    for (auto& stripe : _stripes)
+        stripe.value.store(0, std::memory_order_relaxed);
+}
+
+OsmAnd::MetricsRegistry::Gauge::Gauge(const QString& name_)
+    : _value(0.0)
+    , name(name_)
+{
+}
+
+OsmAnd::MetricsRegistry::Gauge::~Gauge()
+{
+}
+
+void OsmAnd::MetricsRegistry::Gauge::set(const double value)
+{
+    _value.store(value, std::memory_order_relaxed);
+}
+
+double OsmAnd::MetricsRegistry::Gauge::getValue() const
+{
+    return _value.load(std::memory_order_relaxed);
+}
+
+OsmAnd::MetricsRegistry::Histogram::Histogram(const QString& name_)
+    : name(name_)
+{
+    reset();
+}
+
+OsmAnd::MetricsRegistry::Histogram::~Histogram()
+{
+}
+
+void OsmAnd::MetricsRegistry::Histogram::record(const float seconds)
+{
+    const auto microseconds = seconds > 0.0f
+        ? static_cast<uint64_t>(static_cast<double>(seconds) * 1000000.0 + 0.5)
+        : 0;
+
+    auto& stripe = _stripes[getCurrentThreadStripeIndex()];
+    stripe.count.fetch_add(1, std::memory_order_relaxed);
+    stripe.sumInMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+    stripe.buckets[getBucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+
+    auto maxInMicroseconds = stripe.maxInMicroseconds.load(std::memory_order_relaxed);
+    while (microseconds > maxInMicroseconds &&
+        !stripe.maxInMicroseconds.compare_exchange_weak(maxInMicroseconds, microseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+OsmAnd::MetricsRegistry::HistogramSnapshot OsmAnd::MetricsRegistry::Histogram::getSnapshot() const
+{
+    HistogramSnapshot snapshot;
+    snapshot.name = name;
+    snapshot.buckets.fill(0, HistogramBucketsCount);
+
+    uint64_t sumInMicroseconds = 0;
+    uint64_t maxInMicroseconds = 0;
+    const auto pBuckets = snapshot.buckets.data();
+    for (const auto& stripe : _stripes)
+    {
+        snapshot.count += stripe.count.load(std::memory_order_relaxed);
+        sumInMicroseconds += stripe.sumInMicroseconds.load(std::memory_order_relaxed);
+        maxInMicroseconds = qMax(maxInMicroseconds, stripe.maxInMicroseconds.load(std::memory_order_relaxed));
+        for (auto bucketIndex = 0u; bucketIndex < HistogramBucketsCount; bucketIndex++)
+            pBuckets[bucketIndex] += stripe.buckets[bucketIndex].load(std::memory_order_relaxed);
+    }
+    snapshot.sum = static_cast<double>(sumInMicroseconds) / 1000000.0;
+    snapshot.max = static_cast<double>(maxInMicroseconds) / 1000000.0;
+
+    return snapshot;
+}
+
+void OsmAnd::MetricsRegistry::Histogram::reset()
+{
+    for (auto& stripe : _stripes)
+    {
+        stripe.count.store(0, std::memory_order_relaxed);
+        stripe.sumInMicroseconds.store(0, std::memory_order_relaxed);
+        stripe.maxInMicroseconds.store(0, std::memory_order_relaxed);
+        for (auto& bucket : stripe.buckets)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+unsigned int OsmAnd::MetricsRegistry::Histogram::getBucketIndex(const uint64_t microseconds)
+{
+    // Values below two sub-bucket ranges map 1:1, rest are split by magnitude and top bits below it
+    if (microseconds < 2 * HistogramSubBucketsCount)
+        return static_cast<unsigned int>(microseconds);
+
+    const auto highestBit = 63 - qCountLeadingZeroBits(static_cast<quint64>(microseconds));
+    const auto shift = highestBit - 4;
+    const auto bucketIndex = shift * HistogramSubBucketsCount + static_cast<unsigned int>(microseconds >> shift);
+    return qMin(bucketIndex, static_cast<unsigned int>(HistogramBucketsCount) - 1);
+}
+
+uint64_t OsmAnd::MetricsRegistry::Histogram::getBucketLowerBound(const unsigned int bucketIndex)
+{
+    if (bucketIndex < 2 * HistogramSubBucketsCount)
+        return bucketIndex;
+
+    const auto shift = bucketIndex / HistogramSubBucketsCount - 1;
+    const auto subBucket = bucketIndex % HistogramSubBucketsCount + HistogramSubBucketsCount;
+    return static_cast<uint64_t>(subBucket) << shift;
+}
+
+uint64_t OsmAnd::MetricsRegistry::Histogram::getBucketUpperBound(const unsigned int bucketIndex)
+{
+    if (bucketIndex < 2 * HistogramSubBucketsCount)
+        return bucketIndex + 1;
+
+    const auto shift = bucketIndex / HistogramSubBucketsCount - 1;
+    const auto subBucket = bucketIndex % HistogramSubBucketsCount + HistogramSubBucketsCount;
+    return static_cast<uint64_t>(subBucket + 1) << shift;
+}
+
+OsmAnd::MetricsRegistry::HistogramSnapshot::HistogramSnapshot()
+    : count(0)
+    , sum(0.0)
+    , max(0.0)
+{
+}
+
+double OsmAnd::MetricsRegistry::HistogramSnapshot::getMean() const
+{
+    if (count == 0)
+        return 0.0;
+    return sum / static_cast<double>(count);
+}
+
+double OsmAnd::MetricsRegistry::HistogramSnapshot::getQuantile(const double quantile) const
+{
+    if (count == 0)
+        return 0.0;
+
+    const auto targetCount = qMax(static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count))), uint64_t(1));
+    uint64_t accumulatedCount = 0;
+    for (auto bucketIndex = 0; bucketIndex < buckets.size(); bucketIndex++)
+    {
+        accumulatedCount += buckets[bucketIndex];
+        if (accumulatedCount < targetCount)
+            continue;
+
+        // Middle of bucket, but never above maximal recorded value
+        const auto lowerBound = Histogram::getBucketLowerBound(bucketIndex);
+        const auto upperBound = Histogram::getBucketUpperBound(bucketIndex);
+        const auto value = static_cast<double>(lowerBound + upperBound) / 2.0 / 1000000.0;
+        return qMin(value, max);
+    }
+
+    return max;
+}
+
+OsmAnd::MetricsRegistry::Snapshot::Snapshot()
+{
+}
+
+QString OsmAnd::MetricsRegistry::Snapshot::toPrometheusText() const
+{
+    QString output;
+
+    for (const auto& counter : constOf(counters))
+    {
+        auto name = getExportedMetricName(counter.first);
+        if (!name.endsWith(QLatin1String("_total")))
+            name += QLatin1String("_total");
+        output += QString(QLatin1String("# TYPE %1 counter\n%1 %2\n"))
+            .arg(name)
+            .arg(counter.second);
+    }
+
+    for (const auto& gauge : constOf(gauges))
+    {
+        const auto name = getExportedMetricName(gauge.first);
+        output += QString(QLatin1String("# TYPE %1 gauge\n%1 %2\n"))
+            .arg(name)
+            .arg(gauge.second);
+    }
+
+    // Histograms are exported as summaries, since quantiles are what is needed from them
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (const auto& histogram : constOf(histograms))
+    {
+        const auto name = getExportedMetricName(histogram.name) + QLatin1String("_seconds");
+        output += QString(QLatin1String("# TYPE %1 summary\n")).arg(name);
+        for (const auto quantile : quantiles)
+        {
+            output += QString(QLatin1String("%1{quantile=\"%2\"} %3\n"))
+                .arg(name)
+                .arg(quantile)
+                .arg(histogram.getQuantile(quantile));
+        }
+        output += QString(QLatin1String("%1_sum %2\n%1_count %3\n"))
+            .arg(name)
+            .arg(histogram.sum)
+            .arg(histogram.count);
+    }
+
+    return output;
+}
+
+QString OsmAnd::MetricsRegistry::Snapshot::toJson() const
+{
+    QJsonObject countersObject;
+    for (const auto& counter : constOf(counters))
+        countersObject.insert(counter.first, static_cast<double>(counter.second));
+
+    QJsonObject gaugesObject;
+    for (const auto& gauge : constOf(gauges))
+        gaugesObject.insert(gauge.first, gauge.second);
+
+    QJsonObject histogramsObject;
+    for (const auto& histogram : constOf(histograms))
+    {
+        QJsonObject histogramObject;
+        histogramObject.insert(QLatin1String("count"), static_cast<double>(histogram.count));
+        histogramObject.insert(QLatin1String("sum"), histogram.sum);
+        histogramObject.insert(QLatin1String("mean"), histogram.getMean());
+        histogramObject.insert(QLatin1String("max"), histogram.max);
+        histogramObject.insert(QLatin1String("p50"), histogram.getQuantile(0.5));
+        histogramObject.insert(QLatin1String("p90"), histogram.getQuantile(0.9));
+        histogramObject.insert(QLatin1String("p99"), histogram.getQuantile(0.99));
+        histogramObject.insert(QLatin1String("p999"), histogram.getQuantile(0.999));
+        histogramsObject.insert(histogram.name, histogramObject);
+    }
+
+    QJsonObject rootObject;
+    rootObject.insert(QLatin1String("counters"), countersObject);
+    rootObject.insert(QLatin1String("gauges"), gaugesObject);
+    rootObject.insert(QLatin1String("histograms"), histogramsObject);
+
+    return QString::fromUtf8(QJsonDocument(rootObject).toJson(QJsonDocument::Indented));
+}
@@ -0,0 +1,249 @@
+#include "MetricsRegistry_P.h"
+#include "MetricsRegistry.h"
+
+#include "stdlib_common.h"
+#include <cmath>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include "restore_internal_warnings.h"
+
+#include "Logging.h"
+
+OsmAnd::MetricsRegistry_P::MetricsRegistry_P(MetricsRegistry* const owner_)
+    : _enabled(false)
+    , _exportServerStopRequested(false)
+    , owner(owner_)
+{
+}
+
+OsmAnd::MetricsRegistry_P::~MetricsRegistry_P()
+{
+}
+
+bool OsmAnd::MetricsRegistry_P::isEnabled() const
+{
+    return _enabled.load(std::memory_order_relaxed);
+}
+
+void OsmAnd::MetricsRegistry_P::setEnabled(const bool enabled)
+{
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+template<typename ENTRY>
+ENTRY* OsmAnd::MetricsRegistry_P::obtainEntry(QHash< QString, std::shared_ptr<ENTRY> >& entries, const QString& name)
+{
+    {
+        QReadLocker scopedLocker(&_entriesLock);
+
+        const auto citEntry = entries.constFind(name);
+        if (citEntry != entries.cend())
+            return citEntry->get();
+    }
+
+    QWriteLocker scopedLocker(&_entriesLock);
+
+    auto& entry = entries[name];
+    if (!entry)
+        entry.reset(new ENTRY(name));
+    return entry.get();
+}
+
+OsmAnd::MetricsRegistry_P::Counter* OsmAnd::MetricsRegistry_P::obtainCounter(const QString& name)
+{
+    return obtainEntry(_counters, name);
+}
+
+OsmAnd::MetricsRegistry_P::Gauge* OsmAnd::MetricsRegistry_P::obtainGauge(const QString& name)
+{
+    return obtainEntry(_gauges, name);
+}
+
+OsmAnd::MetricsRegistry_P::Histogram* OsmAnd::MetricsRegistry_P::obtainHistogram(const QString& name)
+{
+    return obtainEntry(_histograms, name);
+}
+
+OsmAnd::MetricsRegistry_P::FieldKind OsmAnd::MetricsRegistry_P::getFieldKind(
+    const char* const measurement,
+    const bool isFractional)
+{
+    if (qstrcmp(measurement, "s") == 0)
+        return FieldKind::Histogram;
+    else if (isFractional || qstrcmp(measurement, "B") == 0)
+        return FieldKind::Gauge;
+    return FieldKind::Counter;
+}
+
+QString OsmAnd::MetricsRegistry_P::getFieldEntryName(
+    const QString& name,
+    const char* const fieldName,
+    const FieldKind kind)
+{
+    auto entryName = name + QLatin1Char('.') + QLatin1String(fieldName);
+    if (kind == FieldKind::Counter)
+        entryName += QLatin1String("_total");
+    return entryName;
+}
+
+void OsmAnd::MetricsRegistry_P::recordMetric(const QString& name, const Metric& metric)
+{
+    metric.visitFields(
+        [this, &name]
+        (const char* const fieldName, const double value, const char* const measurement, const bool isFractional)
+        {
+            const auto kind = getFieldKind(measurement, isFractional);
+            const auto entryName = getFieldEntryName(name, fieldName, kind);
+
+            if (kind == FieldKind::Histogram)
+                obtainHistogram(entryName)->record(static_cast<float>(value));
+            else if (kind == FieldKind::Gauge)
+                obtainGauge(entryName)->set(value);
+            else if (value > 0.0)
+                obtainCounter(entryName)->add(static_cast<uint64_t>(std::llround(value)));
+        });
+}
+
+OsmAnd::MetricsRegistry_P::Snapshot OsmAnd::MetricsRegistry_P::takeSnapshot() const
+{
+    Snapshot snapshot;
+
+    QReadLocker scopedLocker(&_entriesLock);
+
+    for (const auto& counter : constOf(_counters))
+        snapshot.counters.push_back(qMakePair(counter->name, counter->getValue()));
+    for (const auto& gauge : constOf(_gauges))
+        snapshot.gauges.push_back(qMakePair(gauge->name, gauge->getValue()));
+    for (const auto& histogram : constOf(_histograms))
+        snapshot.histograms.push_back(histogram->getSnapshot());
+
+    return snapshot;
+}
+
+void OsmAnd::MetricsRegistry_P::reset()
+{
+    // Entries are never removed, since callers are allowed to keep pointers to them
+    QReadLocker scopedLocker(&_entriesLock);
+
+    for (const auto& counter : constOf(_counters))
+        counter->reset();
+    for (const auto& gauge : constOf(_gauges))
+        gauge->set(0.0);
+    for (const auto& histogram : constOf(_histograms))
+        histogram->reset();
+}
+
+bool OsmAnd::MetricsRegistry_P::startExportServer(const uint16_t port, const ExportFormat format)
+{
+    QMutexLocker scopedLocker(&_exportServerMutex);
+
+    if (_exportServerThread)
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Metrics export server is already running");
+        return false;
+    }
+
+    ExportServerStartup startup;
+    startup.finished = false;
+    startup.listening = false;
+
+    _exportServerStopRequested = false;
+    std::unique_ptr<Concurrent::Thread> exportServerThread(new Concurrent::Thread(
+        [this, port, format, &startup]
+        ()
+        {
+            exportServerThreadProcedure(port, format, &startup);
+        }));
+    {
+        QMutexLocker startupLocker(&startup.mutex);
+
+        exportServerThread->start();
+        while (!startup.finished)
+            startup.condition.wait(&startup.mutex);
+    }
+
+    if (!startup.listening)
+    {
+        exportServerThread->wait();
+        return false;
+    }
+
+    _exportServerThread = qMove(exportServerThread);
+    return true;
+}
+
+void OsmAnd::MetricsRegistry_P::stopExportServer()
+{
+    QMutexLocker scopedLocker(&_exportServerMutex);
+
+    if (!_exportServerThread)
+        return;
+
+    _exportServerStopRequested = true;
+    _exportServerThread->wait();
+    _exportServerThread.reset();
+}
+
+void OsmAnd::MetricsRegistry_P::exportServerThreadProcedure(
+    const uint16_t port,
+    const ExportFormat format,
+    ExportServerStartup* const startup)
+{
+    // Server has to be created on the thread that uses it, and this thread has no event loop,
+    // so all waiting is done with blocking calls
+    QTcpServer server;
+    const auto listening = server.listen(QHostAddress::LocalHost, port);
+    if (!listening)
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to start metrics export server on port %d: %s",
+            port,
+            qPrintable(server.errorString()));
+    }
+    {
+        QMutexLocker startupLocker(&startup->mutex);
+
+        startup->listening = listening;
+        startup->finished = true;
+        startup->condition.wakeAll();
+    }
+    if (!listening)
+        return;
+
+    const auto contentType = (format == ExportFormat::Json)
+        ? QByteArray("application/json")
+        : QByteArray("text/plain; version=0.0.4");
+    while (!_exportServerStopRequested)
+    {
+        if (!server.waitForNewConnection(100))
+            continue;
+
+        while (const auto socket = server.nextPendingConnection())
+        {
+            // Request itself doesn't matter, snapshot is sent to anyone who asks
+            if (socket->waitForReadyRead(1000))
+                socket->readAll();
+
+            const auto payload = owner->exportSnapshot(format).toUtf8();
+            QByteArray response;
+            response.append("HTTP/1.0 200 OK\r\nContent-Type: ");
+            response.append(contentType);
+            response.append("\r\nContent-Length: ");
+            response.append(QByteArray::number(payload.size()));
+            response.append("\r\nConnection: close\r\n\r\n");
+            response.append(payload);
+
+            socket->write(response);
+            socket->waitForBytesWritten(1000);
+            socket->disconnectFromHost();
+            if (socket->state() != QAbstractSocket::UnconnectedState)
+                socket->waitForDisconnected(1000);
+            delete socket;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef _OSMAND_CORE_METRICS_REGISTRY_P_H_
+#define _OSMAND_CORE_METRICS_REGISTRY_P_H_
+
+#include "stdlib_common.h"
+#include <atomic>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QString>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QWaitCondition>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "PrivateImplementation.h"
+#include "MetricsRegistry.h"
+#include "Thread.h"
+
+namespace OsmAnd
+{
+    class MetricsRegistry;
+    class MetricsRegistry_P Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(MetricsRegistry_P);
+    public:
+        typedef MetricsRegistry::Counter Counter;
+        typedef MetricsRegistry::Gauge Gauge;
+        typedef MetricsRegistry::Histogram Histogram;
+        typedef MetricsRegistry::Snapshot Snapshot;
+        typedef MetricsRegistry::ExportFormat ExportFormat;
+
+        enum class FieldKind
+        {
+            Counter,
+            Gauge,
+            Histogram,
+        };
+        static FieldKind getFieldKind(const char* const measurement, const bool isFractional);
+        static QString getFieldEntryName(const QString& name, const char* const fieldName, const FieldKind kind);
+
+    private:
+        std::atomic<bool> _enabled;
+
+        mutable QReadWriteLock _entriesLock;
+        QHash< QString, std::shared_ptr<Counter> > _counters;
+        QHash< QString, std::shared_ptr<Gauge> > _gauges;
+        QHash< QString, std::shared_ptr<Histogram> > _histograms;
+
+        template<typename ENTRY>
+        ENTRY* obtainEntry(QHash< QString, std::shared_ptr<ENTRY> >& entries, const QString& name);
+
+        QMutex _exportServerMutex;
+        std::unique_ptr<Concurrent::Thread> _exportServerThread;
+        std::atomic<bool> _exportServerStopRequested;
+        struct ExportServerStartup
+        {
+            QMutex mutex;
+            QWaitCondition condition;
+            bool finished;
+            bool listening;
+        };
+        void exportServerThreadProcedure(
+            const uint16_t port,
+            const ExportFormat format,
+            ExportServerStartup* const startup);
+    protected:
+        MetricsRegistry_P(MetricsRegistry* const owner);
+    public:
+        ~MetricsRegistry_P();
+
+        ImplementationInterface<MetricsRegistry> owner;
+
+        bool isEnabled() const;
+        void setEnabled(const bool enabled);
+
+        Counter* obtainCounter(const QString& name);
+        Gauge* obtainGauge(const QString& name);
+        Histogram* obtainHistogram(const QString& name);
+
+        void recordMetric(const QString& name, const Metric& metric);
+
+        Snapshot takeSnapshot() const;
+        void reset();
+
+        bool startExportServer(const uint16_t port, const ExportFormat format);
+        void stopExportServer();
+
+    friend class OsmAnd::MetricsRegistry;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_METRICS_REGISTRY_P_H_)
@@ -121,6 +121,25 @@ QVector<std::shared_ptr<const OsmAnd::MvtReader::LineString>> OsmAnd::MvtReader:
     return lines;
 }
 
+OsmAnd::MvtReader::Polygon::Polygon(QVector< QVector<OsmAnd::PointI> > &rings)
+: rings(rings)
+{
+}
+
+OsmAnd::MvtReader::Polygon::~Polygon()
+{
+}
+
+OsmAnd::MvtReader::GeomType OsmAnd::MvtReader::Polygon::getType() const
+{
+    return POLYGON;
+}
+
+QVector< QVector<OsmAnd::PointI> > OsmAnd::MvtReader::Polygon::getRings() const
+{
+    return rings;
+}
+
 OsmAnd::MvtReader::Tile::Tile()
 {
 }
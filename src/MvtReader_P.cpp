@@ -20,6 +20,7 @@
 #include "QtExtensions.h"
 
 #define MIN_LINE_STRING_LEN 6
+#define MIN_POLYGON_RING_LEN 9
 
 OsmAnd::MvtReader_P::MvtReader_P()
 {
@@ -142,9 +143,9 @@ void OsmAnd::MvtReader_P::readGeometry(const std::shared_ptr<OsmAnd::MvtReader::
         case VectorTile::Tile_GeomType_LINESTRING:
             geom = readLineString(geometry);
             break;
-//        case VectorTile::Tile_GeomType_POLYGON:
-//            readMultiLineString(geometry, res);
-//            break;
+        case VectorTile::Tile_GeomType_POLYGON:
+            geom = readPolygon(geometry);
+            break;
         default:
             break;
     }
@@ -294,3 +295,65 @@ std::shared_ptr<OsmAnd::MvtReader::Geometry> OsmAnd::MvtReader_P::readLineString
 }
     
 
+std::shared_ptr<OsmAnd::MvtReader::Geometry> OsmAnd::MvtReader_P::readPolygon(const ::google::protobuf::RepeatedField< ::google::protobuf::uint32 >& geometry) const
+{
+    // Guard: must have header
+    if (geometry.size() == 0)
+        return nullptr;
+    
+    /** Geometry command index */
+    int i = 0;
+    
+    OsmAnd::CommandType cmd;
+    int cmdHdr;
+    int cmdLength;
+    QVector< QVector<OsmAnd::PointI> > rings;
+    
+    int nextX = 0, nextY = 0;
+    
+    // Each ring is MoveTo of length 1, LineTo of length > 1 and ClosePath
+    while (i <= geometry.size() - MIN_POLYGON_RING_LEN) {
+        cmdHdr = geometry.Get(i++);
+        cmdLength = cmdHdr >> 3;
+        cmd = getCommandType(cmdHdr);
+        
+        // Guard: command type and length
+        if (cmd != SEG_MOVETO || cmdLength != 1)
+            break;
+        
+        nextX += zigZagDecode(geometry.Get(i++));
+        nextY += zigZagDecode(geometry.Get(i++));
+        
+        cmdHdr = geometry.Get(i++);
+        cmdLength = cmdHdr >> 3;
+        cmd = getCommandType(cmdHdr);
+        
+        // Guard: command type and length
+        if (cmd != SEG_LINETO || cmdLength < 2)
+            break;
+        
+        // Guard: header data length unsupported by geometry command buffer
+        //  (require LineTo params and ClosePath header after current_index)
+        if ((cmdLength * 2) + i + 1 > geometry.size())
+            break;
+        QVector<OsmAnd::PointI> ring;
+        ring << OsmAnd::PointI(nextX, nextY);
+        
+        for (int lineToIndex = 0; lineToIndex < cmdLength; ++lineToIndex) {
+            nextX += zigZagDecode(geometry.Get(i++));
+            nextY += zigZagDecode(geometry.Get(i++));
+            ring << OsmAnd::PointI(nextX, nextY);
+        }
+        
+        // ClosePath has no parameters and does not move cursor
+        cmdHdr = geometry.Get(i++);
+        if (getCommandType(cmdHdr) != SEG_CLOSE || (cmdHdr >> 3) != 1)
+            break;
+        
+        rings << ring;
+    }
+    
+    if (rings.isEmpty())
+        return nullptr;
+    return std::make_shared<OsmAnd::MvtReader::Polygon>(rings);
+}
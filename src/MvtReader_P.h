@@ -40,6 +40,7 @@ namespace OsmAnd
         
         std::shared_ptr<OsmAnd::MvtReader::Geometry> readPoint(const ::google::protobuf::RepeatedField< ::google::protobuf::uint32 >& geometry) const;
         std::shared_ptr<OsmAnd::MvtReader::Geometry> readLineString(const ::google::protobuf::RepeatedField< ::google::protobuf::uint32 >& geometry) const;
+        std::shared_ptr<OsmAnd::MvtReader::Geometry> readPolygon(const ::google::protobuf::RepeatedField< ::google::protobuf::uint32 >& geometry) const;
         
         CommandType getCommandType(const int &cmdHdr) const;
         int zigZagDecode(const int &n) const;
@@ -12,16 +12,22 @@
 #include "ObfInfo.h"
 #include "QKeyValueIterator.h"
 #include "Stopwatch.h"
+#include "MetricsRegistry.h"
 #include "Utilities.h"
 #include "Logging.h"
 #include "CachedOsmandIndexes.h"
+#include "ObfsSpatialIndex.h"
+#include "QRunnableFunctor.h"
 
 OsmAnd::ObfsCollection_P::ObfsCollection_P(ObfsCollection* owner_)
     : owner(owner_)
     , _fileSystemWatcher(new QFileSystemWatcher())
     , _lastUnusedSourceOriginId(0)
     , _collectedSourcesInvalidated(1)
+    , _pendingFullRescan(true)
+    , _collectedSourcesUpdateScheduled(0)
 {
+    _collectedSourcesUpdatePool.setMaxThreadCount(1);
     _fileSystemWatcher->moveToThread(gMainThread);
 
     _onDirectoryChangedConnection = QObject::connect(
@@ -37,170 +43,400 @@ OsmAnd::ObfsCollection_P::~ObfsCollection_P()
     QObject::disconnect(_onDirectoryChangedConnection);
     QObject::disconnect(_onFileChangedConnection);
 
+    // Update that is queued or running uses this object
+    _collectedSourcesUpdatePool.waitForDone();
+
     _fileSystemWatcher->deleteLater();
 }
 
-void OsmAnd::ObfsCollection_P::invalidateCollectedSources()
+void OsmAnd::ObfsCollection_P::invalidateCollectedSources(const bool fullRescanRequired)
 {
+    if (fullRescanRequired)
+    {
+        QMutexLocker scopedLocker(&_pendingChangesMutex);
+        _pendingFullRescan = true;
+    }
     _collectedSourcesInvalidated.fetchAndAddOrdered(1);
+
+    if (!fullRescanRequired)
+        scheduleCollectedSourcesUpdate();
 }
 
-void OsmAnd::ObfsCollection_P::collectSources() const
+void OsmAnd::ObfsCollection_P::scheduleCollectedSourcesUpdate()
 {
-    QWriteLocker scopedLocker1(&_collectedSourcesLock);
-    QReadLocker scopedLocker2(&_sourcesOriginsLock);
-
-    // Capture how many invalidations are going to be processed
-    const auto invalidationsToProcess = _collectedSourcesInvalidated.loadAcquire();
-    if (invalidationsToProcess == 0)
+    if (!_collectedSourcesUpdateScheduled.testAndSetOrdered(0, 1))
         return;
 
-    const Stopwatch collectSourcesStopwatch(true);
+    const auto updateRunnable = new QRunnableFunctor(
+        [this]
+        (const QRunnableFunctor* const runnable)
+        {
+            QThread::currentThread()->setPriority(QThread::LowPriority);
+
+            // Changes reported from now on are going to be applied by next update
+            _collectedSourcesUpdateScheduled.storeRelease(0);
+
+            QMutexLocker scopedLocker(&_collectedSourcesUpdateMutex);
+            updateCollectedSources();
+        });
+    updateRunnable->setAutoDelete(true);
+    _collectedSourcesUpdatePool.start(updateRunnable);
+}
 
-    std::shared_ptr<CachedOsmandIndexes> cachedOsmandIndexes = nullptr;
-    QFile* indCache = NULL;
-    if (_sourcesOrigins.size() > 0)
+std::shared_ptr<const OsmAnd::ObfsCollection_P::CollectedSources> OsmAnd::ObfsCollection_P::obtainCollectedSources() const
+{
+    if (_collectedSourcesInvalidated.loadAcquire() > 0)
     {
-        auto origin = _sourcesOrigins.values()[0];
-        if (origin->type == SourceOriginType::Directory)
+        bool mayUseCurrentSnapshot;
         {
-            const auto& directory = std::static_pointer_cast<const DirectoryAsSourceOrigin>(origin);
-            indCache = new QFile(directory->directory.absoluteFilePath(QLatin1String("ind_core.cache")));
+            QMutexLocker scopedLocker(&_pendingChangesMutex);
+            mayUseCurrentSnapshot = !_pendingFullRescan;
         }
-    }
-    if (indCache)
-    {
-        cachedOsmandIndexes = std::make_shared<CachedOsmandIndexes>();
-        if (indCache->exists())
+        mayUseCurrentSnapshot = mayUseCurrentSnapshot && std::atomic_load(&_collectedSources);
+
+        // Changes reported by watcher are applied in background (see scheduleCollectedSourcesUpdate()), while
+        // everyone keeps working with current snapshot. Changes of source origins are waited for, since caller
+        // may rely on them.
+        if (!mayUseCurrentSnapshot)
         {
-            cachedOsmandIndexes->readFromFile(indCache->fileName(), CachedOsmandIndexes::VERSION);
+            QMutexLocker scopedLocker(&_collectedSourcesUpdateMutex);
+            updateCollectedSources();
         }
-        else
+    }
+
+    return std::atomic_load(&_collectedSources);
+}
+
+void OsmAnd::ObfsCollection_P::reconcileCollectedSources(
+    CollectedSourcesOfOrigin& collectedSources,
+    const std::function<bool (const QString& filePath)> isInScope,
+    const QFileInfoList& presentObfFiles,
+    QFileInfoList& outObfFilesToLoad)
+{
+    QSet<QString> presentObfFilePaths;
+    for (const auto& obfFileInfo : constOf(presentObfFiles))
+    {
+        const auto obfFilePath = obfFileInfo.canonicalFilePath();
+        if (obfFilePath.isEmpty())
+            continue;
+        presentObfFilePaths.insert(obfFilePath);
+
+        // New or modified files have to be (re)loaded
+        const auto citCollectedSource = collectedSources.constFind(obfFilePath);
+        if (citCollectedSource != collectedSources.cend() &&
+            citCollectedSource->obfFile->fileSize == static_cast<uint64_t>(obfFileInfo.size()) &&
+            citCollectedSource->lastModified == obfFileInfo.lastModified())
         {
-            indCache->open(QIODevice::ReadWrite);
-            if (indCache->isOpen())
-                indCache->close();
+            continue;
         }
+        outObfFilesToLoad.push_back(obfFileInfo);
     }
-    
-    // Check all previously collected sources
-    auto itCollectedSourcesEntry = mutableIteratorOf(_collectedSources);
-    while(itCollectedSourcesEntry.hasNext())
+
+    // Files that are gone are simply dropped: readers that still use them hold own references
+    auto itCollectedSource = mutableIteratorOf(collectedSources);
+    while (itCollectedSource.hasNext())
     {
-        const auto& collectedSourcesEntry = itCollectedSourcesEntry.next();
-        const auto& originId = collectedSourcesEntry.key();
-        auto& collectedSources = collectedSourcesEntry.value();
-        const auto& itSourceOrigin = _sourcesOrigins.constFind(originId);
-
-        // If current source origin was removed,
-        // remove entire each collected source related to it
-        if (itSourceOrigin == _sourcesOrigins.cend())
+        const auto& obfFilePath = itCollectedSource.next().key();
+        if (isInScope(obfFilePath) && !presentObfFilePaths.contains(obfFilePath))
+            itCollectedSource.remove();
+    }
+}
+
+void OsmAnd::ObfsCollection_P::collectDirectory(
+    const DirectoryAsSourceOrigin& origin,
+    const QString& directoryPath,
+    const bool recursive,
+    CollectedSourcesOfOrigin& collectedSources,
+    QFileInfoList& outObfFilesToLoad) const
+{
+    const QDir directory(directoryPath);
+    const auto directoryPrefix = directoryPath + QLatin1Char('/');
+
+    QFileInfoList obfFilesInfo;
+    Utilities::findFiles(directory, QStringList() << QLatin1String("*.obf"), obfFilesInfo, recursive);
+    reconcileCollectedSources(
+        collectedSources,
+        [recursive, &directoryPath, &directoryPrefix]
+        (const QString& filePath) -> bool
         {
-            // Ensure that ObfFile is not being read anywhere
-            for(const auto& itCollectedSource : rangeOf(collectedSources))
-            {
-                const auto obfFile = itCollectedSource.value();
+            if (!filePath.startsWith(directoryPrefix))
+                return false;
+            return recursive || QFileInfo(filePath).absolutePath() == directoryPath;
+        },
+        obfFilesInfo,
+        outObfFilesToLoad);
+
+    if (!origin.isRecursive)
+        return;
 
-                //NOTE: OBF should have been locked here, but since file is gone anyways, this lock is quite useless
+    // Stop watching subdirectories that are gone, and start watching new ones
+    auto itWatchedSubdirectory = mutableIteratorOf(origin.watchedSubdirectories);
+    while (itWatchedSubdirectory.hasNext())
+    {
+        const auto& watchedSubdirectory = itWatchedSubdirectory.next();
+        if (!watchedSubdirectory.startsWith(directoryPrefix) || QFileInfo(watchedSubdirectory).isDir())
+            continue;
 
-                itCollectedSource.value().reset();
-                assert(obfFile.use_count() == 1);
-            }
+        _fileSystemWatcher->removePath(watchedSubdirectory);
+        itWatchedSubdirectory.remove();
 
-            itCollectedSourcesEntry.remove();
-            continue;
+        // Files of removed subdirectory are not listed anymore, but only subdirectory itself was scanned
+        if (!recursive)
+        {
+            const auto subdirectoryPrefix = watchedSubdirectory + QLatin1Char('/');
+            reconcileCollectedSources(
+                collectedSources,
+                [&subdirectoryPrefix]
+                (const QString& filePath) -> bool
+                {
+                    return filePath.startsWith(subdirectoryPrefix);
+                },
+                QFileInfoList(),
+                outObfFilesToLoad);
         }
+    }
 
-        // Check for missing files
-        auto itObfFileEntry = mutableIteratorOf(collectedSources);
-        while(itObfFileEntry.hasNext())
-        {
-            const auto& sourceFilename = itObfFileEntry.next().key();
-            if (QFile::exists(sourceFilename))
-                continue;
-            const auto obfFile = itObfFileEntry.value();
+    QFileInfoList subdirectoriesInfo;
+    Utilities::findDirectories(directory, QStringList() << QLatin1String("*"), subdirectoriesInfo, recursive);
+    for (const auto& subdirectoryInfo : constOf(subdirectoriesInfo))
+    {
+        const auto canonicalPath = subdirectoryInfo.canonicalFilePath();
+        if (origin.watchedSubdirectories.contains(canonicalPath))
+            continue;
 
-            //NOTE: OBF should have been locked here, but since file is gone anyways, this lock is quite useless
+        _fileSystemWatcher->addPath(canonicalPath);
+        origin.watchedSubdirectories.insert(canonicalPath);
 
-            itObfFileEntry.remove();
-            assert(obfFile.use_count() == 1);
-        }
+        // Subdirectory that just appeared may already contain anything
+        if (!recursive)
+            collectDirectory(origin, canonicalPath, true, collectedSources, outObfFilesToLoad);
+    }
+}
+
+void OsmAnd::ObfsCollection_P::updateCollectedSources() const
+{
+    QReadLocker scopedLocker(&_sourcesOriginsLock);
 
-        // If all collected sources for current source origin are gone,
-        // remove entire collection attached to source origin ID
-        if (collectedSources.isEmpty())
+    // Capture how many invalidations are going to be processed
+    const auto invalidationsToProcess = _collectedSourcesInvalidated.loadAcquire();
+    if (invalidationsToProcess == 0)
+        return;
+
+    const Stopwatch collectSourcesStopwatch(true);
+
+    bool fullRescan;
+    QSet<QString> changedDirectories;
+    QSet<QString> changedFiles;
+    {
+        QMutexLocker pendingChangesLocker(&_pendingChangesMutex);
+
+        fullRescan = _pendingFullRescan;
+        _pendingFullRescan = false;
+        changedDirectories.swap(_pendingChangedDirectories);
+        changedFiles.swap(_pendingChangedFiles);
+    }
+
+    const auto currentCollectedSources = std::atomic_load(&_collectedSources);
+    fullRescan = fullRescan || !currentCollectedSources;
+
+    // Cache is shared by all updates, and is attached to the first directory
+    if (!_cachedOsmandIndexes)
+    {
+        _cachedOsmandIndexes = std::make_shared<CachedOsmandIndexes>();
+        for (const auto& sourceOrigin : constOf(_sourcesOrigins))
         {
-            itCollectedSourcesEntry.remove();
-            continue;
+            if (sourceOrigin->type != SourceOriginType::Directory)
+                continue;
+
+            const auto& directory = std::static_pointer_cast<const DirectoryAsSourceOrigin>(sourceOrigin)->directory;
+            _cachedOsmandIndexesFilename = directory.absoluteFilePath(QLatin1String("ind_core.cache"));
+            if (QFile::exists(_cachedOsmandIndexesFilename))
+                _cachedOsmandIndexes->readFromFile(_cachedOsmandIndexesFilename, CachedOsmandIndexes::VERSION);
+            break;
         }
     }
 
-    // Find all files uncollected sources
-    for(const auto& itEntry : rangeOf(constOf(_sourcesOrigins)))
+    // Start from copy of current snapshot, and drop everything of removed source origins
+    QHash<ObfsCollection::SourceOriginId, CollectedSourcesOfOrigin> collectedSourcesByOrigin;
+    if (currentCollectedSources)
+        collectedSourcesByOrigin = currentCollectedSources->byOrigin;
+    auto itCollectedSourcesOfOrigin = mutableIteratorOf(collectedSourcesByOrigin);
+    while (itCollectedSourcesOfOrigin.hasNext())
+    {
+        if (!_sourcesOrigins.contains(itCollectedSourcesOfOrigin.next().key()))
+            itCollectedSourcesOfOrigin.remove();
+    }
+
+    // Rescan only what was reported as changed, unless everything has to be rescanned. Same file may be reachable
+    // from several origins, so it's loaded only once and then shared by all of them.
+    QStringList obfFilePathsToLoad;
+    QHash<QString, QDateTime> obfFilesToLoadLastModified;
+    QList< QPair<ObfsCollection::SourceOriginId, QString> > obfFilesToLoadOfOrigins;
+    for (const auto& itEntry : rangeOf(constOf(_sourcesOrigins)))
     {
         const auto& originId = itEntry.key();
         const auto& entry = itEntry.value();
-        auto itCollectedSources = _collectedSources.find(originId);
-        if (itCollectedSources == _collectedSources.end())
-            itCollectedSources = _collectedSources.insert(originId, QHash<QString, std::shared_ptr<ObfFile> >());
-        auto& collectedSources = *itCollectedSources;
+        const auto isNewOrigin = !collectedSourcesByOrigin.contains(originId);
+        auto& collectedSources = collectedSourcesByOrigin[originId];
 
+        QFileInfoList obfFilesToLoad;
         if (entry->type == SourceOriginType::Directory)
         {
             const auto& directoryAsSourceOrigin = std::static_pointer_cast<const DirectoryAsSourceOrigin>(entry);
+            const auto directoryPath = directoryAsSourceOrigin->directory.canonicalPath();
 
-            QFileInfoList obfFilesInfo;
-            Utilities::findFiles(directoryAsSourceOrigin->directory, QStringList() << QLatin1String("*.obf"), obfFilesInfo, directoryAsSourceOrigin->isRecursive);
-            for(const auto& obfFileInfo : constOf(obfFilesInfo))
+            if (fullRescan || isNewOrigin)
             {
-                const auto& obfFilePath = obfFileInfo.canonicalFilePath();
-                if (collectedSources.constFind(obfFilePath) != collectedSources.cend())
-                    continue;
-                
-                auto obfFile = cachedOsmandIndexes->getObfFile(obfFilePath);
-                collectedSources.insert(obfFilePath, obfFile);
+                collectDirectory(
+                    *directoryAsSourceOrigin,
+                    directoryPath,
+                    directoryAsSourceOrigin->isRecursive,
+                    collectedSources,
+                    obfFilesToLoad);
             }
-
-            if (directoryAsSourceOrigin->isRecursive)
+            else
             {
-                QFileInfoList directoriesInfo;
-                Utilities::findDirectories(directoryAsSourceOrigin->directory, QStringList() << QLatin1String("*"), directoriesInfo, true);
-
-                for(const auto& directoryInfo : constOf(directoriesInfo))
+                for (const auto& changedDirectory : constOf(changedDirectories))
                 {
-                    const auto canonicalPath = directoryInfo.canonicalFilePath();
-                    if (directoryAsSourceOrigin->watchedSubdirectories.contains(canonicalPath))
+                    if (changedDirectory != directoryPath &&
+                        !directoryAsSourceOrigin->watchedSubdirectories.contains(changedDirectory))
+                    {
                         continue;
-
-                    _fileSystemWatcher->addPath(canonicalPath);
-                    directoryAsSourceOrigin->watchedSubdirectories.insert(canonicalPath);
+                    }
+
+                    collectDirectory(
+                        *directoryAsSourceOrigin,
+                        changedDirectory,
+                        false,
+                        collectedSources,
+                        obfFilesToLoad);
                 }
             }
         }
         else if (entry->type == SourceOriginType::File)
         {
             const auto& fileAsSourceOrigin = std::static_pointer_cast<const FileAsSourceOrigin>(entry);
+            const auto filePath = fileAsSourceOrigin->fileInfo.canonicalFilePath();
 
-            if (!fileAsSourceOrigin->fileInfo.exists())
-                continue;
-            const auto& obfFilePath = fileAsSourceOrigin->fileInfo.canonicalFilePath();
-            if (collectedSources.constFind(obfFilePath) != collectedSources.cend())
-                continue;
+            if (fullRescan || isNewOrigin || changedFiles.contains(filePath))
+            {
+                QFileInfo fileInfo(fileAsSourceOrigin->fileInfo);
+                fileInfo.refresh();
+
+                QFileInfoList presentObfFiles;
+                if (fileInfo.exists())
+                    presentObfFiles.push_back(fileInfo);
+                reconcileCollectedSources(
+                    collectedSources,
+                    []
+                    (const QString&) -> bool
+                    {
+                        return true;
+                    },
+                    presentObfFiles,
+                    obfFilesToLoad);
+            }
+        }
+
+        for (const auto& obfFileInfo : constOf(obfFilesToLoad))
+        {
+            const auto obfFilePath = obfFileInfo.canonicalFilePath();
+            if (!obfFilesToLoadLastModified.contains(obfFilePath))
+            {
+                obfFilePathsToLoad.push_back(obfFilePath);
+                obfFilesToLoadLastModified.insert(obfFilePath, obfFileInfo.lastModified());
+            }
+            obfFilesToLoadOfOrigins.push_back(qMakePair(originId, obfFilePath));
+        }
+    }
+
+    // Obtain all new and modified sources at once, since headers of uncached ones are parsed in parallel
+    if (!obfFilePathsToLoad.isEmpty())
+    {
+        // Unchanged file that is already collected by other origin is not loaded again
+        QHash< QString, std::shared_ptr<ObfFile> > loadedObfFiles;
+        for (const auto& collectedSourcesOfOrigin : constOf(collectedSourcesByOrigin))
+        {
+            for (const auto& itCollectedSource : rangeOf(constOf(collectedSourcesOfOrigin)))
+            {
+                const auto& obfFilePath = itCollectedSource.key();
+                const auto itLastModified = obfFilesToLoadLastModified.constFind(obfFilePath);
+                if (itLastModified != obfFilesToLoadLastModified.cend() &&
+                    itLastModified.value() == itCollectedSource.value().lastModified)
+                {
+                    loadedObfFiles.insert(obfFilePath, itCollectedSource.value().obfFile);
+                }
+            }
+        }
+        auto itObfFilePath = mutableIteratorOf(obfFilePathsToLoad);
+        while (itObfFilePath.hasNext())
+        {
+            if (loadedObfFiles.contains(itObfFilePath.next()))
+                itObfFilePath.remove();
+        }
 
-            auto obfFile = cachedOsmandIndexes->getObfFile(obfFilePath);
-            collectedSources.insert(obfFilePath, obfFile);
+        const auto obfFiles = _cachedOsmandIndexes->getObfFiles(obfFilePathsToLoad);
+        for (int fileIdx = 0; fileIdx < obfFilePathsToLoad.size(); fileIdx++)
+            loadedObfFiles.insert(obfFilePathsToLoad[fileIdx], obfFiles[fileIdx]);
+
+        for (const auto& obfFileOfOrigin : constOf(obfFilesToLoadOfOrigins))
+        {
+            const auto& obfFilePath = obfFileOfOrigin.second;
+
+            CollectedSource collectedSource;
+            collectedSource.obfFile = loadedObfFiles.value(obfFilePath);
+            collectedSource.lastModified = obfFilesToLoadLastModified.value(obfFilePath);
+            collectedSourcesByOrigin[obfFileOfOrigin.first].insert(obfFilePath, collectedSource);
         }
+
+        if (!_cachedOsmandIndexesFilename.isEmpty())
+            _cachedOsmandIndexes->writeToFile(_cachedOsmandIndexesFilename);
     }
 
-    if (cachedOsmandIndexes && _collectedSources.size() > 0)
-        cachedOsmandIndexes->writeToFile(indCache->fileName());
-    if (indCache)
-        delete indCache;
+    // Publish new snapshot
+    const std::shared_ptr<CollectedSources> collectedSources(new CollectedSources());
+    collectedSources->byOrigin = collectedSourcesByOrigin;
+    QSet<QString> publishedObfFilePaths;
+    for (const auto& collectedSourcesOfOrigin : constOf(collectedSourcesByOrigin))
+    {
+        collectedSources->obfFiles.reserve(collectedSources->obfFiles.size() + collectedSourcesOfOrigin.size());
+        for (const auto& itCollectedSource : rangeOf(constOf(collectedSourcesOfOrigin)))
+        {
+            if (publishedObfFilePaths.contains(itCollectedSource.key()))
+                continue;
+            publishedObfFilePaths.insert(itCollectedSource.key());
 
-    // Decrement invalidations counter with number of processed onces
+            collectedSources->obfFiles.push_back(itCollectedSource.value().obfFile);
+        }
+    }
+    const Stopwatch spatialIndexStopwatch(true);
+    collectedSources->spatialIndex.reset(new ObfsSpatialIndex(collectedSources->obfFiles));
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (metricsRegistry.isEnabled())
+    {
+        static const auto spatialIndexBuildHistogram =
+            metricsRegistry.obtainHistogram(QLatin1String("obf_spatial_index_build"));
+        spatialIndexBuildHistogram->record(spatialIndexStopwatch.elapsed());
+    }
+    std::atomic_store(&_collectedSources, std::shared_ptr<const CollectedSources>(collectedSources));
+
+    // Decrement invalidations counter with number of processed ones
     _collectedSourcesInvalidated.fetchAndAddOrdered(-invalidationsToProcess);
 
-    LogPrintf(LogSeverityLevel::Info, "Collected OBF sources in %fs", collectSourcesStopwatch.elapsed());
+    const auto collectSourcesTime = collectSourcesStopwatch.elapsed();
+    if (metricsRegistry.isEnabled())
+    {
+        static const auto collectSourcesHistogram =
+            metricsRegistry.obtainHistogram(QLatin1String("obf_collect_sources"));
+        static const auto collectSourcesDeltaHistogram =
+            metricsRegistry.obtainHistogram(QLatin1String("obf_collect_sources_delta"));
+        (fullRescan ? collectSourcesHistogram : collectSourcesDeltaHistogram)->record(collectSourcesTime);
+    }
+    LogPrintf(LogSeverityLevel::Info,
+        "Collected OBF sources in %fs (%s, %d loaded)",
+        collectSourcesTime,
+        fullRescan ? "full rescan" : "changes only",
+        obfFilePathsToLoad.size());
 }
 
 QList<OsmAnd::ObfsCollection::SourceOriginId> OsmAnd::ObfsCollection_P::getSourceOriginIds() const
@@ -233,7 +469,7 @@ OsmAnd::ObfsCollection::SourceOriginId OsmAnd::ObfsCollection_P::addDirectory(co
         }
     }
 
-    invalidateCollectedSources();
+    invalidateCollectedSources(true);
 
     return allocatedId;
 }
@@ -249,7 +485,7 @@ OsmAnd::ObfsCollection::SourceOriginId OsmAnd::ObfsCollection_P::addFile(const Q
 
     _fileSystemWatcher->addPath(fileInfo.canonicalFilePath());
 
-    invalidateCollectedSources();
+    invalidateCollectedSources(true);
 
     return allocatedId;
 }
@@ -280,29 +516,14 @@ bool OsmAnd::ObfsCollection_P::remove(const ObfsCollection::SourceOriginId entry
 
     _sourcesOrigins.erase(itSourceOrigin);
 
-    invalidateCollectedSources();
+    invalidateCollectedSources(true);
 
     return true;
 }
 
 QList< std::shared_ptr<const OsmAnd::ObfFile> > OsmAnd::ObfsCollection_P::getObfFiles() const
 {
-    // Check if sources were invalidated
-    if (_collectedSourcesInvalidated.loadAcquire() > 0)
-        collectSources();
-
-    QList< std::shared_ptr<const OsmAnd::ObfFile> > obfFiles;
-    {
-        QReadLocker scopedLocker(&_collectedSourcesLock);
-
-        for(const auto& collectedSources : constOf(_collectedSources))
-        {
-            obfFiles.reserve(obfFiles.size() + collectedSources.size());
-            for(const auto& obfFile : collectedSources)
-                obfFiles.append(obfFile);
-        }
-    }
-    return obfFiles;
+    return obtainCollectedSources()->obfFiles;
 }
 
 std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataInterface(
@@ -324,46 +545,32 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataIn
     const ZoomLevel maxZoomLevel /*= MaxZoomLevel*/,
     const ObfDataTypesMask desiredDataTypes /*= fullObfDataTypesMask()*/) const
 {
-    // Check if sources were invalidated
-    if (_collectedSourcesInvalidated.loadAcquire() > 0)
-        collectSources();
+    // Snapshot stays the same for the whole call, regardless of concurrent updates
+    const auto collectedSources = obtainCollectedSources();
+
+    // Only files that may have data in requested area are opened, densest first
+    const auto obfFiles = collectedSources->spatialIndex->query(pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes);
 
     // Create ObfReaders from collected sources
     QList< std::shared_ptr<const ObfReader> > obfReaders;
+    obfReaders.reserve(obfFiles.size());
+    for (const auto& obfFile : constOf(obfFiles))
     {
-        QReadLocker scopedLocker(&_collectedSourcesLock);
+        std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfFile));
+        if (!obfReader->isOpened() || !obfReader->obtainInfo())
+            continue;
 
-        for (const auto& collectedSources : constOf(_collectedSources))
+        // Repeat checks by sections, since index only knows bounding box of each file and files without summary
+        // were not filtered at all
+        const auto obfInfo = obfReader->obtainInfo();
+        if (!obfInfo->isBasemap && !obfInfo->isBasemapWithCoastlines)
         {
-            obfReaders.reserve(obfReaders.size() + collectedSources.size());
-            for (const auto& obfFile : constOf(collectedSources))
-            {
-                // If OBF information already available, perform check
-                if (obfFile->obfInfo &&
-                    !obfFile->obfInfo->isBasemap &&
-                    !obfFile->obfInfo->isBasemapWithCoastlines)
-                {
-                    bool accept = obfFile->obfInfo->containsDataFor(pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes);
-                    if (!accept)
-                        continue;
-                }
-
-                // Otherwise, open file in any case to repeat check
-                std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfFile));
-                if (!obfReader->isOpened() || !obfReader->obtainInfo())
-                    continue;
-
-                // Repeat checks if needed
-                if (!obfFile->obfInfo->isBasemap && !obfFile->obfInfo->isBasemapWithCoastlines)
-                {
-                    bool accept = obfFile->obfInfo->containsDataFor(pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes);
-                    if (!accept)
-                        continue;
-                }
-
-                obfReaders.push_back(qMove(obfReader));
-            }
+            bool accept = obfInfo->containsDataFor(pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes);
+            if (!accept)
+                continue;
         }
+
+        obfReaders.push_back(qMove(obfReader));
     }
 
     return std::shared_ptr<ObfDataInterface>(new ObfDataInterface(obfReaders));
@@ -371,10 +578,18 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ObfsCollection_P::obtainDataIn
 
 void OsmAnd::ObfsCollection_P::onDirectoryChanged(const QString& path)
 {
-    invalidateCollectedSources();
+    {
+        QMutexLocker scopedLocker(&_pendingChangesMutex);
+        _pendingChangedDirectories.insert(path);
+    }
+    invalidateCollectedSources(false);
 }
 
 void OsmAnd::ObfsCollection_P::onFileChanged(const QString& path)
 {
-    invalidateCollectedSources();
+    {
+        QMutexLocker scopedLocker(&_pendingChangesMutex);
+        _pendingChangedFiles.insert(path);
+    }
+    invalidateCollectedSources(false);
 }
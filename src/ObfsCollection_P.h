@@ -2,12 +2,17 @@
 #define _OSMAND_CORE_OBFS_COLLECTION_P_H_
 
 #include "stdlib_common.h"
+#include <functional>
 
 #include "QtExtensions.h"
 #include <QDir>
 #include <QHash>
 #include <QSet>
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QDateTime>
 #include <QFileSystemWatcher>
 #include <QEventLoop>
 
@@ -20,6 +25,8 @@ namespace OsmAnd
 {
     class ObfFile;
     class ObfDataInterface;
+    class CachedOsmandIndexes;
+    class ObfsSpatialIndex;
 
     class ObfsCollection;
     class ObfsCollection_P__SignalProxy;
@@ -75,11 +82,53 @@ namespace OsmAnd
         mutable QReadWriteLock _sourcesOriginsLock;
         int _lastUnusedSourceOriginId;
 
-        void invalidateCollectedSources();
+        struct CollectedSource
+        {
+            std::shared_ptr<ObfFile> obfFile;
+            QDateTime lastModified;
+        };
+        typedef QHash<QString, CollectedSource> CollectedSourcesOfOrigin;
+
+        // Immutable snapshot of collected sources. Readers take current one without any lock held for longer
+        // than pointer copy, while updater builds next one aside and swaps it in.
+        struct CollectedSources
+        {
+            QHash<ObfsCollection::SourceOriginId, CollectedSourcesOfOrigin> byOrigin;
+            QList< std::shared_ptr<const ObfFile> > obfFiles;
+            std::shared_ptr<const ObfsSpatialIndex> spatialIndex;
+        };
+        mutable std::shared_ptr<const CollectedSources> _collectedSources;
+
+        // Changes reported by watcher since last update. Only directories and files mentioned there are rescanned,
+        // unless set of source origins has changed.
+        void invalidateCollectedSources(const bool fullRescanRequired);
         mutable QAtomicInt _collectedSourcesInvalidated;
-        mutable QHash< ObfsCollection::SourceOriginId, QHash<QString, std::shared_ptr<ObfFile> > > _collectedSources;
-        mutable QReadWriteLock _collectedSourcesLock;
-        void collectSources() const;
+        mutable QMutex _pendingChangesMutex;
+        mutable bool _pendingFullRescan;
+        mutable QSet<QString> _pendingChangedDirectories;
+        mutable QSet<QString> _pendingChangedFiles;
+
+        mutable QMutex _collectedSourcesUpdateMutex;
+        // Changes reported by watcher are applied by low-priority background thread, so that no reader (which
+        // may be render thread) ever waits for rescan. At most one such update is queued at a time.
+        QThreadPool _collectedSourcesUpdatePool;
+        QAtomicInt _collectedSourcesUpdateScheduled;
+        void scheduleCollectedSourcesUpdate();
+        mutable std::shared_ptr<CachedOsmandIndexes> _cachedOsmandIndexes;
+        mutable QString _cachedOsmandIndexesFilename;
+        std::shared_ptr<const CollectedSources> obtainCollectedSources() const;
+        void updateCollectedSources() const;
+        void collectDirectory(
+            const DirectoryAsSourceOrigin& origin,
+            const QString& directoryPath,
+            const bool recursive,
+            CollectedSourcesOfOrigin& collectedSources,
+            QFileInfoList& outObfFilesToLoad) const;
+        static void reconcileCollectedSources(
+            CollectedSourcesOfOrigin& collectedSources,
+            const std::function<bool (const QString& filePath)> isInScope,
+            const QFileInfoList& presentObfFiles,
+            QFileInfoList& outObfFilesToLoad);
     public:
         virtual ~ObfsCollection_P();
 
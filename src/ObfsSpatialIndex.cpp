@@ -0,0 +1,115 @@
+#include "ObfsSpatialIndex.h"
+
+#include "stdlib_common.h"
+#include <algorithm>
+
+namespace
+{
+    // Areas are inclusive on both sides
+    inline double getAreaSize(const OsmAnd::AreaI& area31)
+    {
+        return
+            (static_cast<double>(area31.width()) + 1.0) *
+            (static_cast<double>(area31.height()) + 1.0);
+    }
+
+    inline double getIntersectionSize(const OsmAnd::AreaI& a, const OsmAnd::AreaI& b)
+    {
+        const auto left = static_cast<double>(qMax(a.left(), b.left()));
+        const auto right = static_cast<double>(qMin(a.right(), b.right()));
+        const auto top = static_cast<double>(qMax(a.top(), b.top()));
+        const auto bottom = static_cast<double>(qMin(a.bottom(), b.bottom()));
+        if (left > right || top > bottom)
+            return 0.0;
+        return (right - left + 1.0) * (bottom - top + 1.0);
+    }
+}
+
+OsmAnd::ObfsSpatialIndex::ObfsSpatialIndex(const QList< std::shared_ptr<const ObfFile> >& obfFiles)
+    : _filesTree(AreaI::largestPositive(), 12)
+{
+    _files.reserve(obfFiles.size());
+    for (const auto& obfFile : constOf(obfFiles))
+    {
+        const auto fileIndex = _files.size();
+
+        File file;
+        file.obfFile = obfFile;
+        file.summary = obfFile->getSummary();
+        file.density = 0.0;
+        _files.push_back(file);
+
+        // Basemaps are always used, and files without summary have to be checked by caller
+        const auto& summary = file.summary;
+        if (!summary || summary->isBasemap || summary->isBasemapWithCoastlines)
+        {
+            _alwaysAcceptedFiles.push_back(fileIndex);
+            continue;
+        }
+
+        // File with bounding box outside of tree can not be found, so such file is not filtered at all
+        if (!_filesTree.insert(fileIndex, summary->bbox31))
+        {
+            _alwaysAcceptedFiles.push_back(fileIndex);
+            continue;
+        }
+
+        _files[fileIndex].density = static_cast<double>(obfFile->fileSize) / getAreaSize(summary->bbox31);
+    }
+}
+
+OsmAnd::ObfsSpatialIndex::~ObfsSpatialIndex()
+{
+}
+
+QList< std::shared_ptr<const OsmAnd::ObfFile> > OsmAnd::ObfsSpatialIndex::query(
+    const AreaI* const pBbox31,
+    const ZoomLevel minZoomLevel,
+    const ZoomLevel maxZoomLevel,
+    const ObfDataTypesMask desiredDataTypes) const
+{
+    // Score of file is amount of data it's expected to have in requested area, negative if nothing matched.
+    // Acceptor only accumulates scores, since indices of files themselves are not needed.
+    QVector<double> scores(_files.size(), -1.0);
+    const FilesTree::Acceptor acceptor =
+        [this, pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes, &scores]
+        (const int fileIndex, const FilesTree::BBox& bbox) -> bool
+        {
+            const auto& file = _files[fileIndex];
+            if (!file.summary->mayContainDataFor(nullptr, minZoomLevel, maxZoomLevel, desiredDataTypes))
+                return false;
+
+            scores[fileIndex] = file.density * (pBbox31
+                ? getIntersectionSize(bbox.asAABB, *pBbox31)
+                : getAreaSize(bbox.asAABB));
+
+            return false;
+        };
+    QList<int> dummy;
+    if (pBbox31)
+        _filesTree.query(*pBbox31, dummy, false, acceptor);
+    else
+        _filesTree.get(dummy, acceptor);
+
+    QVector<int> matchedFiles;
+    for (auto fileIndex = 0; fileIndex < scores.size(); fileIndex++)
+    {
+        if (scores[fileIndex] >= 0.0)
+            matchedFiles.push_back(fileIndex);
+    }
+    std::stable_sort(matchedFiles.begin(), matchedFiles.end(),
+        [&scores]
+        (const int l, const int r) -> bool
+        {
+            return scores[l] > scores[r];
+        });
+
+    QList< std::shared_ptr<const ObfFile> > result;
+    result.reserve(matchedFiles.size() + _alwaysAcceptedFiles.size());
+    for (const auto fileIndex : constOf(matchedFiles))
+        result.push_back(_files[fileIndex].obfFile);
+    for (const auto fileIndex : constOf(_alwaysAcceptedFiles))
+        result.push_back(_files[fileIndex].obfFile);
+
+    return result;
+}
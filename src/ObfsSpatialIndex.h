@@ -0,0 +1,55 @@
+#ifndef _OSMAND_CORE_OBFS_SPATIAL_INDEX_H_
+#define _OSMAND_CORE_OBFS_SPATIAL_INDEX_H_
+
+#include "stdlib_common.h"
+
+#include "QtExtensions.h"
+#include <QList>
+#include <QVector>
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+#include "DataCommonTypes.h"
+#include "QuadTree.h"
+#include "ObfFile.h"
+
+namespace OsmAnd
+{
+    // Quad-tree over bounding boxes of set of OBF files, so that files that may have data for given area are found
+    // without checking each of them. Bounding boxes, zoom ranges and data types come from file summaries, which are
+    // stored in index cache, so building index never decodes information about sections.
+    // Index is never modified after it's built: new set of files gets new index.
+    class ObfsSpatialIndex Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(ObfsSpatialIndex);
+    public:
+        typedef QuadTree<int, AreaI::CoordType> FilesTree;
+
+    private:
+        struct File
+        {
+            std::shared_ptr<const ObfFile> obfFile;
+            std::shared_ptr<const ObfFile::Summary> summary;
+
+            // Bytes per unit of area covered by bounding box of file
+            double density;
+        };
+        QVector<File> _files;
+        QList<int> _alwaysAcceptedFiles;
+        FilesTree _filesTree;
+    protected:
+    public:
+        ObfsSpatialIndex(const QList< std::shared_ptr<const ObfFile> >& obfFiles);
+        ~ObfsSpatialIndex();
+
+        // Returns files that may have data of desired types for given area and zoom range, ordered by expected amount
+        // of that data (densest first). Basemaps and files without summary are always returned, after all others.
+        QList< std::shared_ptr<const ObfFile> > query(
+            const AreaI* const pBbox31,
+            const ZoomLevel minZoomLevel,
+            const ZoomLevel maxZoomLevel,
+            const ObfDataTypesMask desiredDataTypes) const;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_OBFS_SPATIAL_INDEX_H_)
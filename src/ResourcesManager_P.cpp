@@ -22,7 +22,10 @@
 #include "QKeyValueIterator.h"
 #include "Logging.h"
 #include "Utilities.h"
+#include "Stopwatch.h"
+#include "MetricsRegistry.h"
 #include "CachedOsmandIndexes.h"
+#include "ObfsSpatialIndex.h"
 #include "IncrementalChangesManager.h"
 
 OsmAnd::ResourcesManager_P::ResourcesManager_P(
@@ -31,6 +34,7 @@ OsmAnd::ResourcesManager_P::ResourcesManager_P(
     : owner(owner_)
     , _fileSystemWatcher(new QFileSystemWatcher())
     , _localResourcesLock(QReadWriteLock::Recursive)
+    , _localResourcesRevision(0)
     , _resourcesInRepositoryLoaded(false)
     , _webClient(webClient_)
     , changesManager(new IncrementalChangesManager(webClient_, owner_))
@@ -175,6 +179,7 @@ bool OsmAnd::ResourcesManager_P::scanManagedStoragePath()
     assert(_localResources.isEmpty());
     if (!loadLocalResourcesFromPath(owner->localStoragePath, false, _localResources))
         return false;
+    _localResourcesRevision.fetchAndAddOrdered(1);
 
     return true;
 }
@@ -246,6 +251,7 @@ bool OsmAnd::ResourcesManager_P::rescanUnmanagedStoragePaths() const
         _localResources.insert(id, newResource);
         addedResources.push_back(id);
     }
+    _localResourcesRevision.fetchAndAddOrdered(1);
 
     scopedLocker.unlock();
     owner->localResourcesChangeObservable.postNotify(owner, addedResources, removedResources, updatedResources);
@@ -258,6 +264,8 @@ bool OsmAnd::ResourcesManager_P::loadLocalResourcesFromPath(
     const bool isUnmanagedStorage,
     QHash< QString, std::shared_ptr<const LocalResource> >& outResult) const
 {
+    const Stopwatch loadStopwatch(true);
+
     if (!isUnmanagedStorage)
     {
         auto cachedOsmandIndexes = std::make_shared<CachedOsmandIndexes>();
@@ -368,6 +376,17 @@ bool OsmAnd::ResourcesManager_P::loadLocalResourcesFromPath(
 //    if (isUnmanagedStorage)
 //        loadLocalResourcesFromPath_OnlineTileSourcesResource(storagePath, outResult);
 
+    // Tracked separately for managed and unmanaged storages, since only the former is backed by cache
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (metricsRegistry.isEnabled())
+    {
+        static const auto unmanagedStorageHistogram =
+            metricsRegistry.obtainHistogram(QLatin1String("resources_load_unmanaged_storage"));
+        static const auto localStorageHistogram =
+            metricsRegistry.obtainHistogram(QLatin1String("resources_load_local_storage"));
+        (isUnmanagedStorage ? unmanagedStorageHistogram : localStorageHistogram)->record(loadStopwatch.elapsed());
+    }
+
     return true;
 }
 
@@ -380,13 +399,21 @@ void OsmAnd::ResourcesManager_P::loadLocalResourcesFromPath_Obf(
 {
     QFileInfoList obfFileInfos;
     Utilities::findFiles(storagePath, QStringList() << filenameMask, obfFileInfos, false);
+
+    // Read information from all OBFs at once, since headers of uncached ones are parsed in parallel
+    QStringList filePaths;
     for (const auto& obfFileInfo : constOf(obfFileInfos))
-    {
-        const auto filePath = obfFileInfo.absoluteFilePath();
+        filePaths.push_back(obfFileInfo.absoluteFilePath());
+    const auto obfFiles = cachedOsmandIndexes->getObfFiles(filePaths);
 
-        // Read information from OBF
-        const auto obfFile = cachedOsmandIndexes->getObfFile(filePath);
-        if (!obfFile->obfInfo)
+    for (int fileIdx = 0; fileIdx < obfFileInfos.size(); fileIdx++)
+    {
+        const auto& obfFileInfo = obfFileInfos[fileIdx];
+        const auto& filePath = filePaths[fileIdx];
+        const auto& obfFile = obfFiles[fileIdx];
+        // Summary of cached file is served from cache, so nothing is decoded here
+        const auto obfSummary = obfFile->getSummary();
+        if (!obfSummary)
         {
             LogPrintf(LogSeverityLevel::Warning, "Failed to open OBF '%s'", qPrintable(filePath));
             continue;
@@ -400,7 +427,7 @@ void OsmAnd::ResourcesManager_P::loadLocalResourcesFromPath_Obf(
             resourceType,
             filePath,
             obfFileInfo.size(),
-            obfFile->obfInfo->creationTimestamp);
+            obfSummary->creationTimestamp);
         pLocalResource->_metadata.reset(new ObfMetadata(obfFile));
         std::shared_ptr<const LocalResource> localResource(pLocalResource);
         outResult.insert(resourceId, qMove(localResource));
@@ -413,15 +440,21 @@ void OsmAnd::ResourcesManager_P::loadLocalResourcesFromPath_Obf(
 {
     QFileInfoList obfFileInfos;
     Utilities::findFiles(storagePath, QStringList() << QLatin1String("*.obf"), obfFileInfos, false);
+
+    // Read information from all OBFs at once, since their headers are parsed in parallel
+    QStringList filePaths;
     for (const auto& obfFileInfo : constOf(obfFileInfos))
+        filePaths.push_back(obfFileInfo.absoluteFilePath());
+    const auto obfFiles = CachedOsmandIndexes::loadObfFiles(filePaths);
+
+    for (int fileIdx = 0; fileIdx < obfFileInfos.size(); fileIdx++)
     {
-        const auto filePath = obfFileInfo.absoluteFilePath();
+        const auto& obfFileInfo = obfFileInfos[fileIdx];
+        const auto& filePath = filePaths[fileIdx];
         const auto fileName = obfFileInfo.fileName();
-
-        // Read information from OBF
-        const std::shared_ptr<const ObfFile> obfFile(new ObfFile(filePath));
-        const auto obfInfo = ObfReader(obfFile).obtainInfo();
-        if (!obfInfo)
+        const std::shared_ptr<const ObfFile> obfFile = obfFiles[fileIdx];
+        const auto obfSummary = obfFile->getSummary();
+        if (!obfSummary)
         {
             LogPrintf(LogSeverityLevel::Warning, "Failed to open OBF '%s'", qPrintable(filePath));
             continue;
@@ -459,7 +492,7 @@ void OsmAnd::ResourcesManager_P::loadLocalResourcesFromPath_Obf(
             resourceType,
             filePath,
             obfFileInfo.size(),
-            obfFile->obfInfo->creationTimestamp);
+            obfSummary->creationTimestamp);
         pLocalResource->_metadata.reset(new ObfMetadata(obfFile));
         std::shared_ptr<const LocalResource> localResource(pLocalResource);
         outResult.insert(resourceId, qMove(localResource));
@@ -1162,6 +1195,7 @@ bool OsmAnd::ResourcesManager_P::uninstallResource(const QString& id)
     const auto& installedResource = std::static_pointer_cast<const InstalledResource>(resource);
     
     _localResources.erase(itResource);
+    _localResourcesRevision.fetchAndAddOrdered(1);
     
     return uninstallResource(installedResource, resource);
 }
@@ -1242,6 +1276,8 @@ bool OsmAnd::ResourcesManager_P::installFromFile(const QString& id, const QStrin
             ok = installVoicePackFromFile(id, filePath, resource);
             break;
     }
+    if (ok)
+        _localResourcesRevision.fetchAndAddOrdered(1);
 
     scopedLocker.unlock();
 
@@ -1311,7 +1347,8 @@ bool OsmAnd::ResourcesManager_P::installObfFromFile(
     }
     // Read information from OBF
     const auto obfFile = cachedOsmandIndexes->getObfFile(localFileName);
-    if (!obfFile->obfInfo)
+    const auto obfSummary = obfFile->getSummary();
+    if (!obfSummary)
     {
         LogPrintf(LogSeverityLevel::Warning, "Failed to open OBF '%s'", qPrintable(localFileName));
         QFile(filePath).remove();
@@ -1328,7 +1365,7 @@ bool OsmAnd::ResourcesManager_P::installObfFromFile(
         resourceType,
         localFileName,
         obfFile->fileSize,
-        obfFile->obfInfo->creationTimestamp);
+        obfSummary->creationTimestamp);
     outResource.reset(pLocalResource);
     pLocalResource->_metadata.reset(new ObfMetadata(obfFile));
     _localResources.insert(id, outResource);
@@ -1600,6 +1637,7 @@ bool OsmAnd::ResourcesManager_P::updateFromFile(
         return false;
 
     *itResource = installedResource;
+    _localResourcesRevision.fetchAndAddOrdered(1);
 
     scopedLocker.unlock();
 
@@ -1772,7 +1810,8 @@ QList< std::shared_ptr<const OsmAnd::ObfFile> > OsmAnd::ResourcesManager_P::Obfs
         }
 
         const auto& obfMetadata = std::static_pointer_cast<const ObfMetadata>(localResource->_metadata);
-        if (obfMetadata->obfFile->obfInfo->isBasemapWithCoastlines)
+        const auto obfSummary = obfMetadata->obfFile->getSummary();
+        if (obfSummary && obfSummary->isBasemapWithCoastlines)
             otherBasemapPresent = true;
         obfFiles.push_back(obfMetadata->obfFile);
     }
@@ -1817,7 +1856,8 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollec
             lockedResources.push_back(installedResource);
         }
         
-        if (obfMetadata->obfFile->obfInfo->isBasemapWithCoastlines)
+        const auto obfSummary = obfMetadata->obfFile->getSummary();
+        if (obfSummary && obfSummary->isBasemapWithCoastlines)
             otherBasemapPresent = true;
         std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfMetadata->obfFile));
         obfReaders.push_back(qMove(obfReader));
@@ -1845,17 +1885,22 @@ void OsmAnd::ResourcesManager_P::ObfsCollectionProxy::sortReaders(QList<std::sha
               });
 }
 
-std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollectionProxy::obtainDataInterface(
-    const AreaI* const pBbox31 /*= nullptr*/,
-    const ZoomLevel minZoomLevel /*= MinZoomLevel*/,
-    const ZoomLevel maxZoomLevel /*= MaxZoomLevel*/,
-    const ObfDataTypesMask desiredDataTypes /*= fullObfDataTypesMask()*/) const
+std::shared_ptr<const OsmAnd::ResourcesManager_P::ObfsCollectionProxy::IndexedObfFiles>
+OsmAnd::ResourcesManager_P::ObfsCollectionProxy::obtainIndexedObfFiles() const
 {
-    QReadLocker scopedLocker(&owner->_localResourcesLock);
+    // Local resources are expected to be locked for reading by caller
+    const auto localResourcesRevision = owner->_localResourcesRevision.loadAcquire();
 
-    bool otherBasemapPresent = false;
-    QList< std::shared_ptr<const InstalledResource> > lockedResources;
-    QList< std::shared_ptr<const ObfReader> > obfReaders;
+    QMutexLocker scopedLocker(&_indexedObfFilesMutex);
+
+    if (_indexedObfFiles && _indexedObfFiles->localResourcesRevision == localResourcesRevision)
+        return _indexedObfFiles;
+
+    const Stopwatch buildStopwatch(true);
+
+    const std::shared_ptr<IndexedObfFiles> indexedObfFiles(new IndexedObfFiles());
+    indexedObfFiles->localResourcesRevision = localResourcesRevision;
+    QList< std::shared_ptr<const ObfFile> > obfFiles;
     for (const auto& localResource : constOf(owner->_localResources))
     {
         if (localResource->type != ResourceType::MapRegion &&
@@ -1869,17 +1914,46 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollec
         }
 
         const auto& obfMetadata = std::static_pointer_cast<const ObfMetadata>(localResource->_metadata);
-        if (!obfMetadata)
+        if (!obfMetadata || !obfMetadata->obfFile->getSummary())
             continue;
 
-        // Perform check if this OBF file is needed
-        if (!obfMetadata->obfFile->obfInfo->isBasemap && !obfMetadata->obfFile->obfInfo->isBasemapWithCoastlines)
-        {
-            bool accept = obfMetadata->obfFile->obfInfo->containsDataFor(pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes);
-            if (!accept)
-                continue;
-        }
+        obfFiles.push_back(obfMetadata->obfFile);
+        indexedObfFiles->localResources.insert(obfMetadata->obfFile.get(), localResource);
+    }
+    indexedObfFiles->spatialIndex.reset(new ObfsSpatialIndex(obfFiles));
+    _indexedObfFiles = indexedObfFiles;
+
+    auto& metricsRegistry = MetricsRegistry::getDefault();
+    if (metricsRegistry.isEnabled())
+    {
+        static const auto spatialIndexBuildHistogram =
+            metricsRegistry.obtainHistogram(QLatin1String("obf_spatial_index_build"));
+        spatialIndexBuildHistogram->record(buildStopwatch.elapsed());
+    }
+
+    return _indexedObfFiles;
+}
+
+std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollectionProxy::obtainDataInterface(
+    const AreaI* const pBbox31 /*= nullptr*/,
+    const ZoomLevel minZoomLevel /*= MinZoomLevel*/,
+    const ZoomLevel maxZoomLevel /*= MaxZoomLevel*/,
+    const ObfDataTypesMask desiredDataTypes /*= fullObfDataTypesMask()*/) const
+{
+    QReadLocker scopedLocker(&owner->_localResourcesLock);
 
+    // Only files that may have data in requested area are taken, without checking each of local resources. Check
+    // is done by summaries, so that information about sections is decoded only for files that are actually read.
+    const auto indexedObfFiles = obtainIndexedObfFiles();
+    const auto obfFiles = indexedObfFiles->spatialIndex->query(pBbox31, minZoomLevel, maxZoomLevel, desiredDataTypes);
+
+    bool otherBasemapPresent = false;
+    QList< std::shared_ptr<const InstalledResource> > lockedResources;
+    QList< std::shared_ptr<const ObfReader> > obfReaders;
+    obfReaders.reserve(obfFiles.size() + 1);
+    for (const auto& obfFile : constOf(obfFiles))
+    {
+        const auto& localResource = indexedObfFiles->localResources[obfFile.get()];
         if (const auto installedResource = std::dynamic_pointer_cast<const InstalledResource>(localResource))
         {
             if (!installedResource->_lock.tryLockForReading())
@@ -1887,9 +1961,9 @@ std::shared_ptr<OsmAnd::ObfDataInterface> OsmAnd::ResourcesManager_P::ObfsCollec
             lockedResources.push_back(installedResource);
         }
 
-        if (obfMetadata->obfFile->obfInfo->isBasemapWithCoastlines)
+        if (obfFile->getSummary()->isBasemapWithCoastlines)
             otherBasemapPresent = true;
-        std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfMetadata->obfFile));
+        std::shared_ptr<const ObfReader> obfReader(new ObfReader(obfFile));
         obfReaders.push_back(qMove(obfReader));
     }
     if (!otherBasemapPresent && owner->_miniBasemapObfFile)
@@ -9,6 +9,8 @@
 #include <QHash>
 #include <QString>
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QAtomicInt>
 #include <QFileSystemWatcher>
 #include <QXmlStreamReader>
 
@@ -24,6 +26,7 @@
 namespace OsmAnd
 {
     class CachedOsmandIndexes;
+    class ObfsSpatialIndex;
     class IncrementalChangesManager;
     
     class ResourcesManager_P Q_DECL_FINAL
@@ -57,6 +60,8 @@ namespace OsmAnd
 
         mutable QReadWriteLock _localResourcesLock;
         mutable QHash< QString, std::shared_ptr<const LocalResource> > _localResources;
+        // Incremented on each change of local resources, so that anything derived from them knows it's outdated
+        mutable QAtomicInt _localResourcesRevision;
         bool loadLocalResourcesFromPath(
             const QString& storagePath,
             const bool isUnmanagedStorage,
@@ -167,6 +172,18 @@ namespace OsmAnd
         {
         private:
             void sortReaders(QList<std::shared_ptr<const ObfReader> > &obfReaders) const;
+
+            // Spatial index over OBF files of local resources. It's rebuilt on first query after local resources
+            // have changed, and it's shared by all queries until then.
+            struct IndexedObfFiles
+            {
+                int localResourcesRevision;
+                std::shared_ptr<const ObfsSpatialIndex> spatialIndex;
+                QHash< const ObfFile*, std::shared_ptr<const LocalResource> > localResources;
+            };
+            mutable QMutex _indexedObfFilesMutex;
+            mutable std::shared_ptr<const IndexedObfFiles> _indexedObfFiles;
+            std::shared_ptr<const IndexedObfFiles> obtainIndexedObfFiles() const;
         protected:
             ObfsCollectionProxy(ResourcesManager_P* owner);
         public:
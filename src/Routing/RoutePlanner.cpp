@@ -14,6 +14,7 @@
 #include "Logging.h"
 #include "LoggingAssert.h"
 #include "Utilities.h"
+#include "Tracer.h"
 #include "PlainQueryFilter.h"
 #include "QKeyValueIterator.h"
 #include "QCachingIterator.h"
@@ -332,6 +333,8 @@ OsmAnd::RouteCalculationResult OsmAnd::RoutePlanner::calculateRoute(
     bool leftSideNavigation,
     const IQueryController* const controller /*= nullptr*/)
 {
+    OSMAND_TRACE_SPAN("RoutePlanner::calculateRoute");
+
     assert(context != nullptr);
     assert(points.size() >= 2);
 
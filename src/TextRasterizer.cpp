@@ -8,9 +8,11 @@
 #include "ChainedFontFinder.h"
 
 OsmAnd::TextRasterizer::TextRasterizer(
-    const std::shared_ptr<const IFontFinder>& fontFinder_)
+    const std::shared_ptr<const IFontFinder>& fontFinder_,
+    const std::shared_ptr<TextRasterizerCache>& cache_ /*= nullptr*/)
     : _p(new TextRasterizer_P(this))
     , fontFinder(fontFinder_)
+    , cache(cache_)
 {
 }
 
@@ -18,7 +20,7 @@ OsmAnd::TextRasterizer::~TextRasterizer()
 {
 }
 
-std::shared_ptr<SkBitmap> OsmAnd::TextRasterizer::rasterize(
+std::shared_ptr<const SkBitmap> OsmAnd::TextRasterizer::rasterize(
     const QString& text,
     const Style& style /*= Style()*/,
     QVector<SkScalar>* const outGlyphWidths /*= nullptr*/,
@@ -55,7 +57,8 @@ bool OsmAnd::TextRasterizer::rasterize(
         outExtraTopSpace,
         outExtraBottomSpace,
         outLineSpacing,
-        outFontAscent);
+        outFontAscent,
+        false);
 }
 
 static std::shared_ptr<const OsmAnd::TextRasterizer> s_defaultTextRasterizer;
@@ -72,18 +75,24 @@ std::shared_ptr<const OsmAnd::TextRasterizer> OsmAnd::TextRasterizer::getOnlySys
 
 void OsmAnd::TextRasterizer_initialize()
 {
+    TextRasterizerCache_initialize();
+
     s_defaultTextRasterizer.reset(new TextRasterizer(
         std::shared_ptr<const IFontFinder>(new CachingFontFinder(
             std::shared_ptr<const IFontFinder>(new ChainedFontFinder(
                 QList< std::shared_ptr<const IFontFinder> >()
                     << EmbeddedFontFinder::getDefaultInstance()
-                    << std::shared_ptr<const IFontFinder>(new SystemFontFinder())))))));
+                    << std::shared_ptr<const IFontFinder>(new SystemFontFinder())))))),
+        TextRasterizerCache::getDefault()));
     s_onlySystemFontsTextRasterizer.reset(new TextRasterizer(std::shared_ptr<const IFontFinder>(new CachingFontFinder(
-        std::shared_ptr<const IFontFinder>(new SystemFontFinder())))));
+        std::shared_ptr<const IFontFinder>(new SystemFontFinder()))),
+        TextRasterizerCache::getDefault()));
 }
 
 void OsmAnd::TextRasterizer_release()
 {
     s_defaultTextRasterizer.reset();
     s_onlySystemFontsTextRasterizer.reset();
+
+    TextRasterizerCache_release();
 }
@@ -0,0 +1,102 @@
+#include "TextRasterizerCache.h"
+#include "TextRasterizerCache_P.h"
+#include "TextRasterizer_internal.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QStringList>
+#include "restore_internal_warnings.h"
+
+OsmAnd::TextRasterizerCache::TextRasterizerCache(
+    const unsigned int maxShapedTextsCount_ /*= 8192*/,
+    const size_t maxBitmapsSizeInBytes_ /*= 16 * 1024 * 1024*/)
+    : _p(new TextRasterizerCache_P(this))
+    , maxShapedTextsCount(maxShapedTextsCount_)
+    , maxBitmapsSizeInBytes(maxBitmapsSizeInBytes_)
+{
+}
+
+OsmAnd::TextRasterizerCache::~TextRasterizerCache()
+{
+}
+
+OsmAnd::TextRasterizerCache::Statistics OsmAnd::TextRasterizerCache::getStatistics() const
+{
+    return _p->getStatistics();
+}
+
+void OsmAnd::TextRasterizerCache::resetStatistics()
+{
+    _p->resetStatistics();
+}
+
+void OsmAnd::TextRasterizerCache::clear()
+{
+    _p->clear();
+}
+
+static std::shared_ptr<OsmAnd::TextRasterizerCache> s_defaultTextRasterizerCache;
+std::shared_ptr<OsmAnd::TextRasterizerCache> OsmAnd::TextRasterizerCache::getDefault()
+{
+    return s_defaultTextRasterizerCache;
+}
+
+void OsmAnd::TextRasterizerCache_initialize()
+{
+    s_defaultTextRasterizerCache.reset(new TextRasterizerCache());
+}
+
+void OsmAnd::TextRasterizerCache_release()
+{
+    s_defaultTextRasterizerCache.reset();
+}
+
+OsmAnd::TextRasterizerCache::Statistics::Statistics()
+    : shapedTextsCount(0)
+    , shapedTextHits(0)
+    , shapedTextMisses(0)
+    , shapedTextEvictions(0)
+    , bitmapsCount(0)
+    , bitmapsSizeInBytes(0)
+    , bitmapHits(0)
+    , bitmapMisses(0)
+    , bitmapEvictions(0)
+{
+}
+
+float OsmAnd::TextRasterizerCache::Statistics::getShapedTextHitRate() const
+{
+    const auto lookupsCount = shapedTextHits + shapedTextMisses;
+    if (lookupsCount == 0)
+        return 0.0f;
+    return static_cast<float>(static_cast<double>(shapedTextHits) / static_cast<double>(lookupsCount));
+}
+
+float OsmAnd::TextRasterizerCache::Statistics::getBitmapHitRate() const
+{
+    const auto lookupsCount = bitmapHits + bitmapMisses;
+    if (lookupsCount == 0)
+        return 0.0f;
+    return static_cast<float>(static_cast<double>(bitmapHits) / static_cast<double>(lookupsCount));
+}
+
+QString OsmAnd::TextRasterizerCache::Statistics::toString(const QString& prefix /*= QString::null*/) const
+{
+    QStringList output;
+
+    output.push_back(prefix + QString(QLatin1String("shaped texts: %1 cached, %2 hits, %3 misses (%4% hit rate), %5 evicted"))
+        .arg(shapedTextsCount)
+        .arg(shapedTextHits)
+        .arg(shapedTextMisses)
+        .arg(getShapedTextHitRate() * 100.0f)
+        .arg(shapedTextEvictions));
+    output.push_back(prefix + QString(QLatin1String("bitmaps: %1 cached (%2 bytes), %3 hits, %4 misses (%5% hit rate), %6 evicted"))
+        .arg(bitmapsCount)
+        .arg(bitmapsSizeInBytes)
+        .arg(bitmapHits)
+        .arg(bitmapMisses)
+        .arg(getBitmapHitRate() * 100.0f)
+        .arg(bitmapEvictions));
+
+    return output.join(QLatin1Char('\n'));
+}
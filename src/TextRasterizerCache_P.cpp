@@ -0,0 +1,133 @@
+#include "TextRasterizerCache_P.h"
+#include "TextRasterizerCache.h"
+
+OsmAnd::TextRasterizerCache_P::TextRasterizerCache_P(TextRasterizerCache* const owner_)
+    : _shapedTextHits(0)
+    , _shapedTextMisses(0)
+    , _shapedTextEvictions(0)
+    , _bitmapHits(0)
+    , _bitmapMisses(0)
+    , _bitmapEvictions(0)
+    , owner(owner_)
+{
+}
+
+OsmAnd::TextRasterizerCache_P::~TextRasterizerCache_P()
+{
+}
+
+std::shared_ptr<const OsmAnd::TextRasterizerCache_P::ShapedText> OsmAnd::TextRasterizerCache_P::obtainShapedText(
+    const QByteArray& key)
+{
+    QMutexLocker scopedLocker(&_shapedTextsMutex);
+
+    std::shared_ptr<const ShapedText> shapedText;
+    if (!_shapedTexts.obtain(key, shapedText))
+    {
+        _shapedTextMisses++;
+        return nullptr;
+    }
+
+    _shapedTextHits++;
+    return shapedText;
+}
+
+void OsmAnd::TextRasterizerCache_P::putShapedText(
+    const QByteArray& key,
+    const std::shared_ptr<const ShapedText>& shapedText)
+{
+    QMutexLocker scopedLocker(&_shapedTextsMutex);
+
+    // Shaped texts are bounded by count, so each one weights 1
+    _shapedTexts.insert(key, shapedText, 1);
+    _shapedTextEvictions += _shapedTexts.evictUntil(owner->maxShapedTextsCount);
+}
+
+std::shared_ptr<const SkBitmap> OsmAnd::TextRasterizerCache_P::obtainBitmap(const QByteArray& key)
+{
+    QMutexLocker scopedLocker(&_bitmapsMutex);
+
+    std::shared_ptr<const SkBitmap> bitmap;
+    if (!_bitmaps.obtain(key, bitmap))
+    {
+        _bitmapMisses++;
+        return nullptr;
+    }
+
+    _bitmapHits++;
+    return bitmap;
+}
+
+void OsmAnd::TextRasterizerCache_P::putBitmap(const QByteArray& key, const std::shared_ptr<const SkBitmap>& bitmap)
+{
+    const auto bitmapSize = bitmap->getSize();
+
+    // Don't let single huge caption flush entire cache
+    if (bitmapSize > owner->maxBitmapsSizeInBytes / 4)
+        return;
+
+    QMutexLocker scopedLocker(&_bitmapsMutex);
+
+    _bitmaps.insert(key, bitmap, bitmapSize);
+    _bitmapEvictions += _bitmaps.evictUntil(owner->maxBitmapsSizeInBytes);
+}
+
+OsmAnd::TextRasterizerCache_P::Statistics OsmAnd::TextRasterizerCache_P::getStatistics() const
+{
+    Statistics statistics;
+
+    {
+        QMutexLocker scopedLocker(&_shapedTextsMutex);
+
+        statistics.shapedTextsCount = _shapedTexts.entries.size();
+        statistics.shapedTextHits = _shapedTextHits;
+        statistics.shapedTextMisses = _shapedTextMisses;
+        statistics.shapedTextEvictions = _shapedTextEvictions;
+    }
+
+    {
+        QMutexLocker scopedLocker(&_bitmapsMutex);
+
+        statistics.bitmapsCount = _bitmaps.entries.size();
+        statistics.bitmapsSizeInBytes = _bitmaps.totalSize;
+        statistics.bitmapHits = _bitmapHits;
+        statistics.bitmapMisses = _bitmapMisses;
+        statistics.bitmapEvictions = _bitmapEvictions;
+    }
+
+    return statistics;
+}
+
+void OsmAnd::TextRasterizerCache_P::resetStatistics()
+{
+    {
+        QMutexLocker scopedLocker(&_shapedTextsMutex);
+
+        _shapedTextHits = 0;
+        _shapedTextMisses = 0;
+        _shapedTextEvictions = 0;
+    }
+
+    {
+        QMutexLocker scopedLocker(&_bitmapsMutex);
+
+        _bitmapHits = 0;
+        _bitmapMisses = 0;
+        _bitmapEvictions = 0;
+    }
+}
+
+void OsmAnd::TextRasterizerCache_P::clear()
+{
+    {
+        QMutexLocker scopedLocker(&_shapedTextsMutex);
+
+        _shapedTexts.clear();
+    }
+
+    {
+        QMutexLocker scopedLocker(&_bitmapsMutex);
+
+        _bitmaps.clear();
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef _OSMAND_CORE_TEXT_RASTERIZER_CACHE_P_H_
+#define _OSMAND_CORE_TEXT_RASTERIZER_CACHE_P_H_
+
+#include "stdlib_common.h"
+#include <list>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include "restore_internal_warnings.h"
+
+#include "ignore_warnings_on_external_includes.h"
+#include <SkBitmap.h>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "CommonTypes.h"
+#include "PrivateImplementation.h"
+#include "TextRasterizerCache.h"
+#include "TextRasterizer_P.h"
+
+namespace OsmAnd
+{
+    class TextRasterizerCache;
+    class TextRasterizerCache_P Q_DECL_FINAL
+    {
+    public:
+        typedef TextRasterizerCache::Statistics Statistics;
+        typedef TextRasterizer_P::ShapedText ShapedText;
+
+    private:
+        template<typename VALUE>
+        struct LruStorage Q_DECL_FINAL
+        {
+            struct Entry Q_DECL_FINAL
+            {
+                VALUE value;
+                size_t size;
+                std::list<QByteArray>::iterator itUsage;
+            };
+
+            QHash<QByteArray, Entry> entries;
+            std::list<QByteArray> usage;
+            size_t totalSize;
+
+            LruStorage()
+                : totalSize(0)
+            {
+            }
+
+            bool obtain(const QByteArray& key, VALUE& outValue)
+            {
+                const auto itEntry = entries.find(key);
+                if (itEntry == entries.end())
+                    return false;
+
+                // Move to the most-recently-used end
+                usage.splice(usage.end(), usage, itEntry->itUsage);
+                outValue = itEntry->value;
+                return true;
+            }
+
+            void insert(const QByteArray& key, const VALUE& value, const size_t size)
+            {
+                const auto itEntry = entries.find(key);
+                if (itEntry != entries.end())
+                {
+                    totalSize -= itEntry->size;
+                    itEntry->value = value;
+                    itEntry->size = size;
+                    usage.splice(usage.end(), usage, itEntry->itUsage);
+                    totalSize += size;
+                    return;
+                }
+
+                Entry entry;
+                entry.value = value;
+                entry.size = size;
+                entry.itUsage = usage.insert(usage.end(), key);
+                entries.insert(key, entry);
+                totalSize += size;
+            }
+
+            unsigned int evictUntil(const size_t maxTotalSize)
+            {
+                unsigned int evictedCount = 0;
+                while (totalSize > maxTotalSize && !usage.empty())
+                {
+                    const auto itEntry = entries.find(usage.front());
+                    totalSize -= itEntry->size;
+                    entries.erase(itEntry);
+                    usage.pop_front();
+                    evictedCount++;
+                }
+                return evictedCount;
+            }
+
+            void clear()
+            {
+                entries.clear();
+                usage.clear();
+                totalSize = 0;
+            }
+        };
+
+        mutable QMutex _shapedTextsMutex;
+        LruStorage< std::shared_ptr<const ShapedText> > _shapedTexts;
+        uint64_t _shapedTextHits;
+        uint64_t _shapedTextMisses;
+        uint64_t _shapedTextEvictions;
+
+        mutable QMutex _bitmapsMutex;
+        LruStorage< std::shared_ptr<const SkBitmap> > _bitmaps;
+        uint64_t _bitmapHits;
+        uint64_t _bitmapMisses;
+        uint64_t _bitmapEvictions;
+    protected:
+        TextRasterizerCache_P(TextRasterizerCache* const owner);
+    public:
+        ~TextRasterizerCache_P();
+
+        ImplementationInterface<TextRasterizerCache> owner;
+
+        std::shared_ptr<const ShapedText> obtainShapedText(const QByteArray& key);
+        void putShapedText(const QByteArray& key, const std::shared_ptr<const ShapedText>& shapedText);
+
+        std::shared_ptr<const SkBitmap> obtainBitmap(const QByteArray& key);
+        void putBitmap(const QByteArray& key, const std::shared_ptr<const SkBitmap>& bitmap);
+
+        Statistics getStatistics() const;
+        void resetStatistics();
+        void clear();
+
+    friend class OsmAnd::TextRasterizerCache;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TEXT_RASTERIZER_CACHE_P_H_)
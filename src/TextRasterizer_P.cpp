@@ -7,7 +7,16 @@
 #include <SkUtils.h>
 #include "restore_internal_warnings.h"
 
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QHash>
+#include <QMutex>
+#include "restore_internal_warnings.h"
+
+#include "QtCommon.h"
 #include "ICU.h"
+#include "TextRasterizerCache.h"
+#include "TextRasterizerCache_P.h"
 #include "CoreResourcesEmbeddedBundle.h"
 
 //#define OSMAND_LOG_CHARACTERS_WITHOUT_FONT 1
@@ -21,7 +30,8 @@
 #endif // !defined(OSMAND_LOG_CHARACTERS_FONT)
 
 OsmAnd::TextRasterizer_P::TextRasterizer_P(TextRasterizer* const owner_)
-    : owner(owner_)
+    : _fontFinderId(0)
+    , owner(owner_)
 {
     _defaultPaint.setAntiAlias(true);
     _defaultPaint.setTextEncoding(SkPaint::kUTF16_TextEncoding);
@@ -387,7 +397,7 @@ SkRect OsmAnd::TextRasterizer_P::positionText(
     return textArea;
 }
 
-std::shared_ptr<SkBitmap> OsmAnd::TextRasterizer_P::rasterize(
+std::shared_ptr<const SkBitmap> OsmAnd::TextRasterizer_P::rasterize(
     const QString& text,
     const Style& style,
     QVector<SkScalar>* const outGlyphWidths,
@@ -405,92 +415,249 @@ std::shared_ptr<SkBitmap> OsmAnd::TextRasterizer_P::rasterize(
         outExtraTopSpace,
         outExtraBottomSpace,
         outLineSpacing,
-        outFontAscent);
+        outFontAscent,
+        true);
     if (!ok)
         return nullptr;
     return bitmap;
 }
 
-bool OsmAnd::TextRasterizer_P::rasterize(
-    SkBitmap& targetBitmap,
+OsmAnd::TextRasterizer_P::ShapedText::ShapedText()
+    : textArea(SkRect::MakeEmpty())
+    , extraTopSpace(0.0f)
+    , extraBottomSpace(0.0f)
+    , lineSpacing(0.0f)
+    , fontAscent(0.0f)
+{
+}
+
+OsmAnd::TextRasterizer_P::ShapedText::~ShapedText()
+{
+}
+
+template<typename T>
+static inline void appendKeyComponent(QByteArray& key, const T& value)
+{
+    key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+uint64_t OsmAnd::TextRasterizer_P::obtainFontFinderId(const std::shared_ptr<const IFontFinder>& fontFinder)
+{
+    // Address of font finder can't identify it in cache that outlives it: after finder is freed, new one may get
+    // same address. So each finder gets id that is never reused, and address that belongs to expired finder gets new id.
+    static QMutex idsMutex;
+    static QHash< const IFontFinder*, std::pair< std::weak_ptr<const IFontFinder>, uint64_t > > ids;
+    static uint64_t lastId = 0;
+
+    QMutexLocker scopedLocker(&idsMutex);
+
+    const auto citEntry = ids.constFind(fontFinder.get());
+    if (citEntry != ids.cend() && !citEntry->first.expired())
+        return citEntry->second;
+
+    // Entries of expired finders are of no use anymore, so drop them before registering new one
+    auto itEntry = mutableIteratorOf(ids);
+    while (itEntry.hasNext())
+    {
+        if (itEntry.next().value().first.expired())
+            itEntry.remove();
+    }
+
+    const auto id = ++lastId;
+    ids.insert(fontFinder.get(), std::make_pair(std::weak_ptr<const IFontFinder>(fontFinder), id));
+    return id;
+}
+
+QByteArray OsmAnd::TextRasterizer_P::getShapedTextKey(const QString& text, const Style& style) const
+{
+    auto fontFinderId = _fontFinderId.load();
+    if (fontFinderId == 0)
+    {
+        fontFinderId = obtainFontFinderId(owner->fontFinder);
+        _fontFinderId.store(fontFinderId);
+    }
+
+    QByteArray key;
+    key.reserve(64 + text.size() * sizeof(QChar));
+
+    // Same text with same style may be shaped differently by different font finders
+    appendKeyComponent(key, fontFinderId);
+    appendKeyComponent(key, style.wrapWidth);
+    appendKeyComponent(key, style.size);
+    appendKeyComponent(key, style.bold);
+    appendKeyComponent(key, style.italic);
+    appendKeyComponent(key, style.haloRadius);
+    appendKeyComponent(key, static_cast<int>(style.textAlignment));
+    key.append(reinterpret_cast<const char*>(text.constData()), text.size() * sizeof(QChar));
+
+    return key;
+}
+
+QByteArray OsmAnd::TextRasterizer_P::getBitmapKey(const QByteArray& shapedTextKey, const Style& style) const
+{
+    QByteArray key;
+    key.reserve(shapedTextKey.size() + 32);
+
+    appendKeyComponent(key, style.color.argb);
+    appendKeyComponent(key, style.haloColor.argb);
+
+    // Background is identified by its content generation rather than by address, since addresses get reused
+    if (style.backgroundBitmap)
+    {
+        appendKeyComponent(key, style.backgroundBitmap->getGenerationID());
+        appendKeyComponent(key, style.backgroundBitmap->width());
+        appendKeyComponent(key, style.backgroundBitmap->height());
+    }
+    else
+    {
+        appendKeyComponent(key, static_cast<uint32_t>(0));
+    }
+    key.append(shapedTextKey);
+
+    return key;
+}
+
+std::shared_ptr<const OsmAnd::TextRasterizer_P::ShapedText> OsmAnd::TextRasterizer_P::shapeText(
     const QString& text_,
-    const Style& style,
-    QVector<SkScalar>* const outGlyphWidths,
-    float* const outExtraTopSpace,
-    float* const outExtraBottomSpace,
-    float* const outLineSpacing,
-    float* const outFontAscent) const
+    const Style& style) const
 {
+    const std::shared_ptr<ShapedText> shapedText(new ShapedText());
+
     // Prepare text and break by lines
-    const auto text = ICU::convertToVisualOrder(text_);
+    shapedText->text = ICU::convertToVisualOrder(text_);
+    const auto& text = shapedText->text;
     const auto lineRefs = style.wrapWidth > 0
         ? ICU::getTextWrappingRefs(text, style.wrapWidth)
         : (QVector<QStringRef>() << QStringRef(&text));
 
     // Obtain paints from lines and style
-    auto paints = evaluatePaints(lineRefs, style);
+    auto& paints = shapedText->paints;
+    paints = evaluatePaints(lineRefs, style);
 
     // Measure text
     SkScalar maxLineWidthInPixels = 0;
     measureText(paints, maxLineWidthInPixels);
 
-    // Measure glyphs (if requested and there's no halo)
-    if (outGlyphWidths && style.haloRadius == 0)
-        measureGlyphs(paints, *outGlyphWidths);
+    // Measure glyphs (if there's no halo)
+    if (style.haloRadius == 0)
+        measureGlyphs(paints, shapedText->glyphWidths);
 
     // Process halo if exists
     if (style.haloRadius > 0)
     {
         measureHalo(style, paints);
+        measureHaloGlyphs(style, paints, shapedText->glyphWidths);
+    }
+
+    // Font ascent
+    for (const auto& linePaint : constOf(paints))
+        shapedText->fontAscent = qMin(shapedText->fontAscent, linePaint.fontAscent);
+
+    // Line spacing
+    for (const auto& linePaint : constOf(paints))
+        shapedText->lineSpacing = qMax(shapedText->lineSpacing, linePaint.maxFontLineSpacing);
 
-        if (outGlyphWidths)
-            measureHaloGlyphs(style, paints, *outGlyphWidths);
+    // Calculate extra top and bottom space
+    SkScalar maxTop = 0;
+    SkScalar maxBottom = 0;
+    for (const auto& linePaint : constOf(paints))
+    {
+        maxTop = qMax(maxTop, linePaint.maxFontTop);
+        maxBottom = qMax(maxBottom, linePaint.maxFontBottom);
     }
+    shapedText->extraTopSpace = qMax(0.0f, maxTop - paints.first().maxFontTop);
+    shapedText->extraBottomSpace = qMax(0.0f, maxBottom - paints.last().maxFontBottom);
 
-    // Set output font ascent
-    if (outFontAscent)
+    // Position text horizontally and vertically
+    shapedText->textArea = positionText(paints, maxLineWidthInPixels, style.textAlignment);
+
+    return shapedText;
+}
+
+void OsmAnd::TextRasterizer_P::drawShapedText(
+    SkCanvas& canvas,
+    const ShapedText& shapedText,
+    const Style& style,
+    const SkPoint& offset) const
+{
+    // Rasterize text halo first (if enabled)
+    if (style.haloRadius > 0)
     {
-        float fontAscent = 0.0f;
-        for (const auto& linePaint : constOf(paints))
-            fontAscent = qMin(fontAscent, linePaint.fontAscent);
+        for (const auto& linePaint : constOf(shapedText.paints))
+        {
+            for (const auto& textPaint : constOf(linePaint.textPaints))
+            {
+                const auto haloPaint = getHaloPaint(textPaint.paint, style);
 
-        *outFontAscent = fontAscent;
+                canvas.drawText(
+                    textPaint.text.constData(), textPaint.text.length()*sizeof(QChar),
+                    textPaint.positionedBounds.left() + offset.x(), textPaint.positionedBounds.top() + offset.y(),
+                    haloPaint);
+            }
+        }
     }
-    
-    // Set output line spacing
-    if (outLineSpacing)
+
+    // Rasterize text itself. Color is applied here, since shaped text is shared by captions of any color
+    for (const auto& linePaint : constOf(shapedText.paints))
     {
-        float lineSpacing = 0.0f;
-        for (const auto& linePaint : constOf(paints))
-            lineSpacing = qMax(lineSpacing, linePaint.maxFontLineSpacing);
+        for (const auto& textPaint : constOf(linePaint.textPaints))
+        {
+            auto paint = textPaint.paint;
+            paint.setColor(style.color.toSkColor());
 
-        *outLineSpacing = lineSpacing;
+            canvas.drawText(
+                textPaint.text.constData(), textPaint.text.length()*sizeof(QChar),
+                textPaint.positionedBounds.left() + offset.x(), textPaint.positionedBounds.top() + offset.y(),
+                paint);
+        }
     }
+}
 
-    // Calculate extra top and bottom space
-    if (outExtraTopSpace)
-    {
-        SkScalar maxTop = 0;
-        for (const auto& linePaint : constOf(paints))
-            maxTop = qMax(maxTop, linePaint.maxFontTop);
+bool OsmAnd::TextRasterizer_P::rasterize(
+    SkBitmap& targetBitmap,
+    const QString& text,
+    const Style& style,
+    QVector<SkScalar>* const outGlyphWidths,
+    float* const outExtraTopSpace,
+    float* const outExtraBottomSpace,
+    float* const outLineSpacing,
+    float* const outFontAscent,
+    const bool shareCachedPixels) const
+{
+    const auto& cache = owner->cache;
 
-        *outExtraTopSpace = qMax(0.0f, maxTop - paints.first().maxFontTop);
+    // Obtain shaped text from cache or shape it
+    QByteArray shapedTextKey;
+    std::shared_ptr<const ShapedText> shapedText;
+    if (cache)
+    {
+        shapedTextKey = getShapedTextKey(text, style);
+        shapedText = cache->_p->obtainShapedText(shapedTextKey);
     }
-    if (outExtraBottomSpace)
+    if (!shapedText)
     {
-        SkScalar maxBottom = 0;
-        for (const auto& linePaint : constOf(paints))
-            maxBottom = qMax(maxBottom, linePaint.maxFontBottom);
-
-        *outExtraBottomSpace = qMax(0.0f, maxBottom - paints.last().maxFontBottom);
+        shapedText = shapeText(text, style);
+        if (cache)
+            cache->_p->putShapedText(shapedTextKey, shapedText);
     }
 
-    // Position text horizontally and vertically
-    const auto textArea = positionText(paints, maxLineWidthInPixels, style.textAlignment);
-    
+    // Set outputs
+    if (outGlyphWidths)
+        *outGlyphWidths += shapedText->glyphWidths;
+    if (outFontAscent)
+        *outFontAscent = shapedText->fontAscent;
+    if (outLineSpacing)
+        *outLineSpacing = shapedText->lineSpacing;
+    if (outExtraTopSpace)
+        *outExtraTopSpace = shapedText->extraTopSpace;
+    if (outExtraBottomSpace)
+        *outExtraBottomSpace = shapedText->extraBottomSpace;
+
     // Calculate bitmap size
+    const auto& textArea = shapedText->textArea;
     auto bitmapWidth = qCeil(textArea.width());
     auto bitmapHeight = qCeil(textArea.height());
+    auto offset = SkPoint::Make(0.0f, 0.0f);
     if (style.backgroundBitmap)
     {
         // Clear extra spacing
@@ -504,14 +671,9 @@ bool OsmAnd::TextRasterizer_P::rasterize(
         bitmapHeight = qMax(bitmapHeight, style.backgroundBitmap->height());
 
         // Shift text area to proper position in a larger
-        const auto offset = SkPoint::Make(
+        offset = SkPoint::Make(
             (bitmapWidth - qCeil(textArea.width())) / 2.0f,
             (bitmapHeight - qCeil(textArea.height())) / 2.0f);
-        for (auto& linePaint : paints)
-        {
-            for (auto& textPaint : linePaint.textPaints)
-                textPaint.positionedBounds.offset(offset);
-        }
     }
 
     // Check if bitmap size was successfully calculated
@@ -519,12 +681,31 @@ bool OsmAnd::TextRasterizer_P::rasterize(
     {
         LogPrintf(LogSeverityLevel::Error,
             "Failed to rasterize text '%s': resulting bitmap size %dx%d is invalid",
-            qPrintable(text),
+            qPrintable(shapedText->text),
             bitmapWidth,
             bitmapHeight);
         return false;
     }
 
+    // Whole caption can be taken from cache only if it's not drawn over existing content
+    const bool canUseCachedBitmap = cache && targetBitmap.isNull();
+    QByteArray bitmapKey;
+    if (canUseCachedBitmap)
+    {
+        bitmapKey = getBitmapKey(shapedTextKey, style);
+        if (const auto cachedBitmap = cache->_p->obtainBitmap(bitmapKey))
+        {
+            // Pixels are shared with cached bitmap only if caller can't modify them
+            if (shareCachedPixels)
+            {
+                targetBitmap = *cachedBitmap;
+                return true;
+            }
+            if (cachedBitmap->copyTo(&targetBitmap, cachedBitmap->colorType()))
+                return true;
+        }
+    }
+
     // Create a bitmap that will be hold entire symbol (if target is empty)
     if (targetBitmap.isNull())
     {
@@ -532,7 +713,6 @@ bool OsmAnd::TextRasterizer_P::rasterize(
         {
             LogPrintf(LogSeverityLevel::Error,
                 "Failed to allocate bitmap of size %dx%d",
-                qPrintable(text),
                 bitmapWidth,
                 bitmapHeight);
             return false;
@@ -552,36 +732,15 @@ bool OsmAnd::TextRasterizer_P::rasterize(
             nullptr);
     }
 
-    // Rasterize text halo first (if enabled)
-    if (style.haloRadius > 0)
-    {
-        for (const auto& linePaint : paints)
-        {
-            for (const auto& textPaint : linePaint.textPaints)
-            {
-                const auto haloPaint = getHaloPaint(textPaint.paint, style);
+    drawShapedText(canvas, *shapedText, style, offset);
 
-                canvas.drawText(
-                    textPaint.text.constData(), textPaint.text.length()*sizeof(QChar),
-                    textPaint.positionedBounds.left(), textPaint.positionedBounds.top(),
-                    haloPaint);
-            }
-        }
-    }
+    canvas.flush();
 
-    // Rasterize text itself
-    for (const auto& linePaint : paints)
+    if (canUseCachedBitmap)
     {
-        for (const auto& textPaint : linePaint.textPaints)
-        {
-            canvas.drawText(
-                textPaint.text.constData(), textPaint.text.length()*sizeof(QChar),
-                textPaint.positionedBounds.left(), textPaint.positionedBounds.top(),
-                textPaint.paint);
-        }
+        targetBitmap.setImmutable();
+        cache->_p->putBitmap(bitmapKey, std::shared_ptr<const SkBitmap>(new SkBitmap(targetBitmap)));
     }
 
-    canvas.flush();
-
     return true;
 }
@@ -3,11 +3,13 @@
 
 #include "stdlib_common.h"
 #include <functional>
+#include <atomic>
 
 #include "QtExtensions.h"
 #include "ignore_warnings_on_external_includes.h"
 #include <QList>
 #include <QVector>
+#include <QByteArray>
 #include "restore_internal_warnings.h"
 
 #include "ignore_warnings_on_external_includes.h"
@@ -92,6 +94,39 @@ namespace OsmAnd
             QVector<LinePaint>& paints,
             const SkScalar maxLineWidth,
             const Style::TextAlignment textAlignment) const;
+
+    public:
+        // Text that was broken into lines, matched to fonts, measured and positioned.
+        // Doesn't depend on colors or background, so it's shared by all captions that differ only by those.
+        struct ShapedText Q_DECL_FINAL
+        {
+            ShapedText();
+            ~ShapedText();
+
+            // Line and text paints reference this string, so it must not be moved or modified
+            QString text;
+            QVector<LinePaint> paints;
+            QVector<SkScalar> glyphWidths;
+            SkRect textArea;
+            float extraTopSpace;
+            float extraBottomSpace;
+            float lineSpacing;
+            float fontAscent;
+        };
+
+    private:
+        // Zero until resolved on first use, since owner's font finder is not yet set when this object is constructed
+        mutable std::atomic<uint64_t> _fontFinderId;
+        static uint64_t obtainFontFinderId(const std::shared_ptr<const IFontFinder>& fontFinder);
+
+        QByteArray getShapedTextKey(const QString& text, const Style& style) const;
+        QByteArray getBitmapKey(const QByteArray& shapedTextKey, const Style& style) const;
+        std::shared_ptr<const ShapedText> shapeText(const QString& text, const Style& style) const;
+        void drawShapedText(
+            SkCanvas& canvas,
+            const ShapedText& shapedText,
+            const Style& style,
+            const SkPoint& offset) const;
     protected:
         TextRasterizer_P(TextRasterizer* const owner);
     public:
@@ -99,7 +134,7 @@ namespace OsmAnd
 
         ImplementationInterface<TextRasterizer> owner;
 
-        std::shared_ptr<SkBitmap> rasterize(
+        std::shared_ptr<const SkBitmap> rasterize(
             const QString& text,
             const Style& style,
             QVector<SkScalar>* const outGlyphWidths,
@@ -116,7 +151,8 @@ namespace OsmAnd
             float* const outExtraTopSpace,
             float* const outExtraBottomSpace,
             float* const outLineSpacing,
-            float* const outFontAscent) const;
+            float* const outFontAscent,
+            const bool shareCachedPixels) const;
 
     friend class OsmAnd::TextRasterizer;
     };
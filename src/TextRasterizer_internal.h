@@ -11,6 +11,9 @@ namespace OsmAnd
 {
     void TextRasterizer_initialize();
     void TextRasterizer_release();
+
+    void TextRasterizerCache_initialize();
+    void TextRasterizerCache_release();
 }
 
 #endif // !defined(_OSMAND_CORE_TEXT_RASTERIZER_PRIVATE_H_)
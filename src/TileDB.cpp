@@ -227,3 +227,57 @@ bool OsmAnd::TileDB::obtainTileData( const TileId tileId, const ZoomLevel zoom,
     
     return hit;
 }
+
+bool OsmAnd::TileDB::enumerateTiles(const TileVisitor visitor)
+{
+    QMutexLocker scopeLock(&_indexMutex);
+
+    // Check that index is available
+    if (!_indexDb.isOpen())
+    {
+        if (!openIndex())
+            return false;
+    }
+
+    QSqlQuery filesQuery(_indexDb);
+    if (!filesQuery.exec("SELECT filename FROM tiledb_files"))
+        return false;
+
+    bool shouldContinue = true;
+    while(shouldContinue && filesQuery.next())
+    {
+        const auto dbFilename = filesQuery.value(0).toString();
+
+        // Open database
+        const auto connectionName = QLatin1String("tiledb-sqlite:") + dbFilename;
+        QSqlDatabase db;
+        if (!QSqlDatabase::contains(connectionName))
+            db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        else
+            db = QSqlDatabase::database(connectionName);
+        db.setDatabaseName(dbFilename);
+        if (!db.open())
+        {
+            LogPrintf(LogSeverityLevel::Error, "Failed to open TileDB from '%s': %s", qPrintable(dbFilename), qPrintable(db.lastError().text()));
+            return false;
+        }
+
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if (query.exec("SELECT x, y, zoom, data FROM tiles"))
+        {
+            while(shouldContinue && query.next())
+            {
+                const auto tileId = TileId::fromXY(query.value(0).toInt(), query.value(1).toInt());
+                const auto zoom = static_cast<ZoomLevel>(query.value(2).toInt());
+                shouldContinue = visitor(tileId, zoom, query.value(3).toByteArray());
+            }
+        }
+
+        // Close database
+        query.finish();
+        db.close();
+    }
+
+    return true;
+}
@@ -0,0 +1,86 @@
+#include "Tracer.h"
+#include "Tracer_P.h"
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QFile>
+#include <QBuffer>
+#include "restore_internal_warnings.h"
+
+#include "Logging.h"
+
+OsmAnd::Tracer::Tracer()
+    : _p(new Tracer_P(this))
+    , _recording(false)
+{
+}
+
+OsmAnd::Tracer::~Tracer()
+{
+}
+
+void OsmAnd::Tracer::startRecording()
+{
+    _p->startRecording();
+    _recording.store(true, std::memory_order_relaxed);
+}
+
+void OsmAnd::Tracer::stopRecording()
+{
+    _recording.store(false, std::memory_order_relaxed);
+    _p->stopRecording();
+}
+
+void OsmAnd::Tracer::setCurrentThreadName(const QString& name)
+{
+    _p->setCurrentThreadName(name);
+}
+
+void OsmAnd::Tracer::record(
+    const char* const name,
+    const uint64_t taskId,
+    const int64_t startTimestamp,
+    const int64_t duration)
+{
+    _p->record(name, taskId, startTimestamp, duration);
+}
+
+QByteArray OsmAnd::Tracer::exportChromeTrace() const
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    _p->writeChromeTrace(buffer);
+    buffer.close();
+
+    return data;
+}
+
+bool OsmAnd::Tracer::exportChromeTraceToFile(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to open '%s' for writing trace",
+            qPrintable(fileName));
+        return false;
+    }
+
+    if (!_p->writeChromeTrace(file))
+    {
+        LogPrintf(LogSeverityLevel::Error,
+            "Failed to write trace to '%s'",
+            qPrintable(fileName));
+        return false;
+    }
+
+    return true;
+}
+
+OsmAnd::Tracer& OsmAnd::Tracer::getDefault()
+{
+    //NOTE: Known memory leak, tracer is never destroyed since worker threads may record into it till the very exit
+    static Tracer* const pDefaultTracer = new Tracer();
+    return *pDefaultTracer;
+}
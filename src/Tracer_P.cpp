@@ -0,0 +1,231 @@
+#include "Tracer_P.h"
+#include "Tracer.h"
+
+#include "stdlib_common.h"
+#include <atomic>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QCoreApplication>
+#include "restore_internal_warnings.h"
+
+#include "Logging.h"
+
+namespace
+{
+    // Last buffer used by current thread. Instance identifier is used instead of pointer to tracer,
+    // since another tracer may be allocated at address of destroyed one.
+    struct CurrentThreadBufferCache
+    {
+        uint64_t tracerInstanceId;
+        OsmAnd::Tracer_P::ThreadBuffer* buffer;
+    };
+    thread_local CurrentThreadBufferCache s_currentThreadBufferCache = { 0, nullptr };
+
+    std::atomic<uint64_t> s_nextInstanceId(1);
+
+    void appendJsonString(QByteArray& output, const QByteArray& value)
+    {
+        output.append('"');
+        for (const auto c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                output.append('\\');
+                output.append(c);
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                output.append("\\u00");
+                output.append(QByteArray::number(static_cast<int>(c), 16).rightJustified(2, '0'));
+            }
+            else
+                output.append(c);
+        }
+        output.append('"');
+    }
+}
+
+OsmAnd::Tracer_P::Tracer_P(Tracer* const owner_)
+    : _instanceId(s_nextInstanceId.fetch_add(1, std::memory_order_relaxed))
+    , _recordingStartTimestamp(Tracer::getTimestamp())
+    , owner(owner_)
+{
+}
+
+OsmAnd::Tracer_P::~Tracer_P()
+{
+}
+
+OsmAnd::Tracer_P::ThreadBuffer::ThreadBuffer(const Qt::HANDLE threadId_, const unsigned int threadIndex_)
+    : threadId(threadId_)
+    , threadIndex(threadIndex_)
+    , droppedEventsCount(0)
+{
+}
+
+OsmAnd::Tracer_P::ThreadBuffer* OsmAnd::Tracer_P::getCurrentThreadBuffer()
+{
+    auto& cache = s_currentThreadBufferCache;
+    if (Q_LIKELY(cache.tracerInstanceId == _instanceId))
+        return cache.buffer;
+
+    // Buffers are never removed, so thread that returns to this tracer finds own buffer again. Threads that reuse
+    // identifier of exited one continue its buffer, which is fine since they never overlap in time.
+    const auto threadId = QThread::currentThreadId();
+
+    QMutexLocker scopedLocker(&_threadBuffersMutex);
+
+    ThreadBuffer* buffer = nullptr;
+    for (const auto& threadBuffer : constOf(_threadBuffers))
+    {
+        if (threadBuffer->threadId != threadId)
+            continue;
+
+        buffer = threadBuffer.get();
+        break;
+    }
+    if (!buffer)
+    {
+        const std::shared_ptr<ThreadBuffer> newBuffer(new ThreadBuffer(threadId, _threadBuffers.size() + 1));
+        if (const auto thread = QThread::currentThread())
+            newBuffer->threadName = thread->objectName();
+        _threadBuffers.push_back(newBuffer);
+        buffer = newBuffer.get();
+    }
+
+    cache.tracerInstanceId = _instanceId;
+    cache.buffer = buffer;
+    return buffer;
+}
+
+void OsmAnd::Tracer_P::startRecording()
+{
+    QMutexLocker scopedLocker(&_threadBuffersMutex);
+
+    for (const auto& threadBuffer : constOf(_threadBuffers))
+    {
+        QMutexLocker bufferLocker(&threadBuffer->mutex);
+
+        threadBuffer->events.clear();
+        threadBuffer->droppedEventsCount = 0;
+    }
+    _recordingStartTimestamp = Tracer::getTimestamp();
+}
+
+void OsmAnd::Tracer_P::stopRecording()
+{
+    QMutexLocker scopedLocker(&_threadBuffersMutex);
+
+    unsigned int droppedEventsCount = 0;
+    for (const auto& threadBuffer : constOf(_threadBuffers))
+    {
+        QMutexLocker bufferLocker(&threadBuffer->mutex);
+
+        droppedEventsCount += threadBuffer->droppedEventsCount;
+    }
+    if (droppedEventsCount > 0)
+    {
+        LogPrintf(LogSeverityLevel::Warning,
+            "Trace buffers were full, %u events were dropped",
+            droppedEventsCount);
+    }
+}
+
+void OsmAnd::Tracer_P::setCurrentThreadName(const QString& name)
+{
+    const auto buffer = getCurrentThreadBuffer();
+
+    QMutexLocker scopedLocker(&buffer->mutex);
+    buffer->threadName = name;
+}
+
+void OsmAnd::Tracer_P::record(
+    const char* const name,
+    const uint64_t taskId,
+    const int64_t startTimestamp,
+    const int64_t duration)
+{
+    const auto buffer = getCurrentThreadBuffer();
+
+    QMutexLocker scopedLocker(&buffer->mutex);
+
+    if (Q_UNLIKELY(buffer->events.size() >= Tracer::MaxEventsPerThread))
+    {
+        buffer->droppedEventsCount++;
+        return;
+    }
+
+    Event event;
+    event.name = name;
+    event.taskId = taskId;
+    event.startTimestamp = startTimestamp;
+    event.duration = duration;
+    buffer->events.push_back(event);
+}
+
+bool OsmAnd::Tracer_P::writeChromeTrace(QIODevice& output) const
+{
+    const auto processId = QCoreApplication::applicationPid();
+
+    QMutexLocker scopedLocker(&_threadBuffersMutex);
+
+    if (output.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") < 0)
+        return false;
+
+    bool isFirstEvent = true;
+    QByteArray chunk;
+    for (const auto& threadBuffer : constOf(_threadBuffers))
+    {
+        QMutexLocker bufferLocker(&threadBuffer->mutex);
+
+        const auto threadName = threadBuffer->threadName.isEmpty()
+            ? QString(QLatin1String("Thread %1")).arg(threadBuffer->threadIndex)
+            : threadBuffer->threadName;
+        const auto eventPrefix =
+            ",\"pid\":" + QByteArray::number(processId) +
+            ",\"tid\":" + QByteArray::number(threadBuffer->threadIndex);
+
+        chunk.clear();
+        if (!isFirstEvent)
+            chunk.append(',');
+        isFirstEvent = false;
+        chunk.append("\n{\"name\":\"thread_name\",\"ph\":\"M\"");
+        chunk.append(eventPrefix);
+        chunk.append(",\"args\":{\"name\":");
+        appendJsonString(chunk, threadName.toUtf8());
+        chunk.append("}}");
+
+        for (const auto& event : threadBuffer->events)
+        {
+            chunk.append(",\n{\"name\":");
+            appendJsonString(chunk, QByteArray(event.name));
+            chunk.append(",\"ph\":\"X\"");
+            chunk.append(eventPrefix);
+            chunk.append(",\"ts\":");
+            chunk.append(QByteArray::number(static_cast<qlonglong>(event.startTimestamp - _recordingStartTimestamp)));
+            chunk.append(",\"dur\":");
+            chunk.append(QByteArray::number(static_cast<qlonglong>(event.duration)));
+            if (event.taskId != 0)
+            {
+                chunk.append(",\"args\":{\"task\":\"0x");
+                chunk.append(QByteArray::number(static_cast<qulonglong>(event.taskId), 16));
+                chunk.append("\"}");
+            }
+            chunk.append('}');
+
+            // Flush periodically, since trace may hold millions of events
+            if (chunk.size() >= 64 * 1024)
+            {
+                if (output.write(chunk) != chunk.size())
+                    return false;
+                chunk.clear();
+            }
+        }
+
+        if (output.write(chunk) != chunk.size())
+            return false;
+    }
+
+    return output.write("\n]}\n") >= 0;
+}
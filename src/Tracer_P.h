@@ -0,0 +1,76 @@
+#ifndef _OSMAND_CORE_TRACER_P_H_
+#define _OSMAND_CORE_TRACER_P_H_
+
+#include "stdlib_common.h"
+#include <vector>
+
+#include "QtExtensions.h"
+#include "ignore_warnings_on_external_includes.h"
+#include <QString>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QIODevice>
+#include "restore_internal_warnings.h"
+
+#include "OsmAndCore.h"
+#include "PrivateImplementation.h"
+#include "Tracer.h"
+
+namespace OsmAnd
+{
+    class Tracer;
+    class Tracer_P Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(Tracer_P);
+    public:
+        struct Event
+        {
+            const char* name;
+            uint64_t taskId;
+            int64_t startTimestamp;
+            int64_t duration;
+        };
+
+        // Each buffer is written only by own thread, so its lock is contended only while exporting
+        struct ThreadBuffer
+        {
+            ThreadBuffer(const Qt::HANDLE threadId, const unsigned int threadIndex);
+
+            const Qt::HANDLE threadId;
+            const unsigned int threadIndex;
+
+            QMutex mutex;
+            QString threadName;
+            std::vector<Event> events;
+            unsigned int droppedEventsCount;
+        };
+
+    private:
+        const uint64_t _instanceId;
+
+        mutable QMutex _threadBuffersMutex;
+        QList< std::shared_ptr<ThreadBuffer> > _threadBuffers;
+        int64_t _recordingStartTimestamp;
+
+        ThreadBuffer* getCurrentThreadBuffer();
+    protected:
+        Tracer_P(Tracer* const owner);
+    public:
+        ~Tracer_P();
+
+        ImplementationInterface<Tracer> owner;
+
+        void startRecording();
+        void stopRecording();
+
+        void setCurrentThreadName(const QString& name);
+        void record(const char* const name, const uint64_t taskId, const int64_t startTimestamp, const int64_t duration);
+
+        bool writeChromeTrace(QIODevice& output) const;
+
+    friend class OsmAnd::Tracer;
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TRACER_P_H_)
@@ -0,0 +1,163 @@
+#include <OsmAndCore/IMemoryManager.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+#include <QThread>
+#include <QVector>
+
+#include <cstring>
+#include <functional>
+
+using namespace OsmAnd;
+
+class FunctorThread : public QThread
+{
+public:
+    FunctorThread(const std::function<void()>& functor_)
+        : functor(functor_)
+    {
+    }
+
+    const std::function<void()> functor;
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        functor();
+    }
+};
+
+class TestMemoryManager : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Per-tag counters are flushed when thread exits, so all work is done on threads that are waited for
+    static void runOnThread(const std::function<void()>& functor);
+    static IMemoryManager::TagStatistics getTagStatistics(const QString& tag);
+private slots:
+    void allocatedBlocksAreUsable();
+    void freedBlocksAreAccountedToAllocatingTag();
+    void unusedChunksAreReleased();
+};
+
+void TestMemoryManager::runOnThread(const std::function<void()>& functor)
+{
+    FunctorThread thread(functor);
+    thread.start();
+    thread.wait();
+}
+
+IMemoryManager::TagStatistics TestMemoryManager::getTagStatistics(const QString& tag)
+{
+    for (const auto& tagStatistics : getMemoryManager()->getStatistics().tags)
+    {
+        if (tagStatistics.tag == tag)
+            return tagStatistics;
+    }
+    return IMemoryManager::TagStatistics();
+}
+
+void TestMemoryManager::allocatedBlocksAreUsable()
+{
+    static const char* const tag = "TestMemoryManager.usable";
+    const QVector<std::size_t> sizes = QVector<std::size_t>()
+        << 0 << 1 << 15 << 16 << 17 << 100 << 1000 << 2000 << 2032 << 2033 << 5000 << 100000;
+    const auto memoryManager = getMemoryManager();
+
+    // Blocks of pooled and large sizes don't overlap and are at least 8-byte aligned
+    QVector<void*> blocks;
+    for (int repeat = 0; repeat < 16; repeat++)
+    {
+        for (const auto size : sizes)
+        {
+            const auto block = memoryManager->allocate(size, tag);
+            QVERIFY(block != nullptr);
+            QCOMPARE(reinterpret_cast<uintptr_t>(block) % 8, static_cast<uintptr_t>(0));
+            std::memset(block, blocks.size() & 0xFF, size);
+            blocks.push_back(block);
+        }
+    }
+    for (int blockIndex = 0; blockIndex < blocks.size(); blockIndex++)
+    {
+        const auto size = sizes[blockIndex % sizes.size()];
+        const auto bytes = static_cast<const uint8_t*>(blocks[blockIndex]);
+        for (std::size_t byteIndex = 0; byteIndex < size; byteIndex++)
+            QCOMPARE(static_cast<int>(bytes[byteIndex]), blockIndex & 0xFF);
+    }
+
+    for (const auto block : blocks)
+        memoryManager->free(block, tag);
+    memoryManager->free(nullptr, tag);
+}
+
+void TestMemoryManager::freedBlocksAreAccountedToAllocatingTag()
+{
+    static const char* const allocatingTag = "TestMemoryManager.allocating";
+    static const char* const freeingTag = "TestMemoryManager.freeing";
+    const auto memoryManager = getMemoryManager();
+    const int blocksCount = 1000;
+    const std::size_t blockSize = 100;
+
+    QVector<void*> blocks;
+    runOnThread(
+        [memoryManager, blocksCount, blockSize, &blocks]
+        ()
+        {
+            for (int blockIndex = 0; blockIndex < blocksCount; blockIndex++)
+                blocks.push_back(memoryManager->allocate(blockSize, allocatingTag));
+        });
+
+    const auto allocatedStatistics = getTagStatistics(QLatin1String(allocatingTag));
+    QVERIFY(allocatedStatistics.liveBytes >= static_cast<int64_t>(blocksCount * blockSize));
+    QCOMPARE(allocatedStatistics.allocationsCount, static_cast<uint64_t>(blocksCount));
+
+    // Block freed by other subsystem on other thread still goes from tag it was allocated with
+    runOnThread(
+        [memoryManager, &blocks]
+        ()
+        {
+            for (const auto block : blocks)
+                memoryManager->free(block, freeingTag);
+        });
+
+    const auto freedStatistics = getTagStatistics(QLatin1String(allocatingTag));
+    QCOMPARE(freedStatistics.liveBytes, static_cast<int64_t>(0));
+    QVERIFY(freedStatistics.peakBytes >= allocatedStatistics.liveBytes);
+    QCOMPARE(getTagStatistics(QLatin1String(freeingTag)).liveBytes, static_cast<int64_t>(0));
+}
+
+void TestMemoryManager::unusedChunksAreReleased()
+{
+    static const char* const tag = "TestMemoryManager.chunks";
+    const auto memoryManager = getMemoryManager();
+    const int blocksCount = 4096;
+    const std::size_t blockSize = 1000;
+
+    QVector<void*> blocks;
+    runOnThread(
+        [memoryManager, blocksCount, blockSize, &blocks]
+        ()
+        {
+            for (int blockIndex = 0; blockIndex < blocksCount; blockIndex++)
+                blocks.push_back(memoryManager->allocate(blockSize, tag));
+        });
+    const auto reservedBytesInUse = memoryManager->getStatistics().poolsReservedBytes;
+    QVERIFY(reservedBytesInUse >= blocksCount * blockSize);
+
+    runOnThread(
+        [memoryManager, &blocks]
+        ()
+        {
+            for (const auto block : blocks)
+                memoryManager->free(block, tag);
+        });
+    memoryManager->releaseUnusedMemory();
+
+    // Chunks that are shared with blocks of others may stay, but most of them have to be gone
+    const auto reservedBytesFreed = memoryManager->getStatistics().poolsReservedBytes;
+    QVERIFY(reservedBytesFreed + blocksCount * blockSize / 2 <= reservedBytesInUse);
+}
+
+QTEST_MAIN(TestMemoryManager)
+#include "TestMemoryManager.moc"
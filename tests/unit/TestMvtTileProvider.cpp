@@ -0,0 +1,279 @@
+#include <OsmAndCore/MvtReader.h>
+#include <OsmAndCore/Utilities.h>
+#include <OsmAndCore/Data/MapObject.h>
+#include <OsmAndCore/Map/MapObjectsProvider.h>
+#include <OsmAndCore/Map/MapPresentationEnvironment.h>
+#include <OsmAndCore/Map/MapPrimitiviser.h>
+#include <OsmAndCore/Map/MapPrimitivesProvider.h>
+#include <OsmAndCore/Map/MvtTileProvider.h>
+#include <OsmAndCore/Map/ResolvedMapStyle.h>
+#include <OsmAndCore/Map/UnresolvedMapStyle.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+#include <QBuffer>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <memory>
+
+using namespace OsmAnd;
+
+// Style that primitivises each test object by its only tag, without any surface
+static const char* const testStyle =
+    "<renderingStyle name=\"mvt-test\" version=\"1\">"
+    "  <order>"
+    "    <case tag=\"building\" value=\"yes\" order=\"10\" objectType=\"3\"/>"
+    "    <case tag=\"highway\" value=\"primary\" order=\"20\" objectType=\"2\"/>"
+    "    <case tag=\"amenity\" value=\"cafe\" order=\"30\" objectType=\"1\"/>"
+    "  </order>"
+    "  <polygon>"
+    "    <case tag=\"building\" value=\"yes\" color=\"#888888\"/>"
+    "  </polygon>"
+    "  <line>"
+    "    <case tag=\"highway\" value=\"primary\" color=\"#ff0000\" strokeWidth=\"2\"/>"
+    "  </line>"
+    "</renderingStyle>";
+
+class TestMvtTileProvider : public QObject
+{
+    Q_OBJECT
+
+private:
+    enum
+    {
+        Extent = 4096,
+        Buffer = 64,
+    };
+
+    static const ZoomLevel zoom = ZoomLevel15;
+    static TileId getTileId();
+
+    // Test geometry is defined in MVT coordinates of tile, 16 31-coordinates per MVT coordinate at zoom 15
+    static PointI toPoint31(const int x, const int y);
+    static QVector<PointI> toPath31(const QVector<PointI>& path);
+    static int64_t doubledSignedArea(const QVector<PointI>& ring);
+    static QVector<PointI> sorted(const QVector<PointI>& points);
+
+    std::shared_ptr<const MvtReader::Tile> encodeAndRead(const QList< std::shared_ptr<const MapObject> >& mapObjects);
+    std::shared_ptr<const MvtReader::Geometry> findGeometry(
+        const std::shared_ptr<const MvtReader::Tile>& tile,
+        const MvtReader::GeomType type) const;
+
+    QTemporaryDir _tilesDir;
+    std::shared_ptr<MapObject::AttributeMapping> _attributeMapping;
+    std::shared_ptr<const IMapStyle> _mapStyle;
+private slots:
+    void initTestCase();
+    void polylinesAreClippedToBuffer();
+    void ringsAreClippedAndWound();
+    void pointsAreEncoded();
+};
+
+OsmAnd::TileId TestMvtTileProvider::getTileId()
+{
+    return TileId::fromXY(100, 200);
+}
+
+OsmAnd::PointI TestMvtTileProvider::toPoint31(const int x, const int y)
+{
+    const auto tileBBox31 = Utilities::tileBoundingBox31(getTileId(), zoom);
+    const auto scale = (1 << (ZoomLevel31 - zoom)) / Extent;
+    return PointI(tileBBox31.left() + x * scale, tileBBox31.top() + y * scale);
+}
+
+QVector<OsmAnd::PointI> TestMvtTileProvider::toPath31(const QVector<PointI>& path)
+{
+    QVector<PointI> path31;
+    for (const auto& point : path)
+        path31.push_back(toPoint31(point.x, point.y));
+    return path31;
+}
+
+int64_t TestMvtTileProvider::doubledSignedArea(const QVector<PointI>& ring)
+{
+    int64_t area = 0;
+    for (int pointIdx = 0; pointIdx < ring.size(); pointIdx++)
+    {
+        const auto& p0 = ring[pointIdx];
+        const auto& p1 = ring[(pointIdx + 1) % ring.size()];
+        area += static_cast<int64_t>(p0.x) * p1.y - static_cast<int64_t>(p1.x) * p0.y;
+    }
+    return area;
+}
+
+QVector<OsmAnd::PointI> TestMvtTileProvider::sorted(const QVector<PointI>& points)
+{
+    auto sortedPoints = points;
+    std::sort(sortedPoints.begin(), sortedPoints.end(),
+        []
+        (const PointI& l, const PointI& r) -> bool
+        {
+            return l.x != r.x ? l.x < r.x : l.y < r.y;
+        });
+    return sortedPoints;
+}
+
+void TestMvtTileProvider::initTestCase()
+{
+    QVERIFY(_tilesDir.isValid());
+
+    _attributeMapping.reset(new MapObject::AttributeMapping());
+    _attributeMapping->registerMapping(1, QLatin1String("building"), QLatin1String("yes"));
+    _attributeMapping->registerMapping(2, QLatin1String("highway"), QLatin1String("primary"));
+    _attributeMapping->registerMapping(3, QLatin1String("amenity"), QLatin1String("cafe"));
+    _attributeMapping->verifyRequiredMappingRegistered();
+
+    const std::shared_ptr<QBuffer> styleBuffer(new QBuffer());
+    styleBuffer->setData(QByteArray(testStyle));
+    const std::shared_ptr<UnresolvedMapStyle> unresolvedMapStyle(
+        new UnresolvedMapStyle(styleBuffer, QLatin1String("mvt-test.render.xml")));
+    QVERIFY(unresolvedMapStyle->load());
+    _mapStyle = ResolvedMapStyle::resolveMapStylesChain(
+        QList< std::shared_ptr<const UnresolvedMapStyle> >() << unresolvedMapStyle);
+    QVERIFY(_mapStyle != nullptr);
+}
+
+std::shared_ptr<const OsmAnd::MvtReader::Tile> TestMvtTileProvider::encodeAndRead(
+    const QList< std::shared_ptr<const MapObject> >& mapObjects)
+{
+    const std::shared_ptr<MapPresentationEnvironment> environment(new MapPresentationEnvironment(_mapStyle));
+    const std::shared_ptr<MapPrimitiviser> primitiviser(new MapPrimitiviser(environment));
+    const std::shared_ptr<MapObjectsProvider> mapObjectsProvider(new MapObjectsProvider(mapObjects));
+    const std::shared_ptr<MapPrimitivesProvider> primitivesProvider(new MapPrimitivesProvider(
+        mapObjectsProvider,
+        primitiviser,
+        256,
+        MapPrimitivesProvider::Mode::WithoutSurface));
+
+    // No simplification, so that every clipped vertex is kept as is
+    MvtTileProvider::Configuration configuration;
+    configuration.extent = Extent;
+    configuration.buffer = Buffer;
+    configuration.simplificationTolerance = 0.0f;
+    MvtTileProvider mvtTileProvider(primitivesProvider, configuration);
+
+    MvtTileProvider::Request request;
+    request.tileId = getTileId();
+    request.zoom = zoom;
+    std::shared_ptr<MvtTileProvider::Data> mvtTile;
+    if (!mvtTileProvider.obtainTiledMvt(request, mvtTile) || !mvtTile)
+        return nullptr;
+
+    const auto tilePath = _tilesDir.filePath(QLatin1String(QTest::currentTestFunction()) + QLatin1String(".mvt"));
+    QFile tileFile(tilePath);
+    if (!tileFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return nullptr;
+    tileFile.write(mvtTile->encodedTile);
+    tileFile.close();
+
+    return MvtReader().parseTile(tilePath);
+}
+
+std::shared_ptr<const OsmAnd::MvtReader::Geometry> TestMvtTileProvider::findGeometry(
+    const std::shared_ptr<const MvtReader::Tile>& tile,
+    const MvtReader::GeomType type) const
+{
+    for (const auto& geometry : tile->getGeometry())
+    {
+        if (geometry->getType() == type)
+            return geometry;
+    }
+    return nullptr;
+}
+
+void TestMvtTileProvider::polylinesAreClippedToBuffer()
+{
+    // Crosses whole tile, so it's cut at both sides of buffer
+    const auto crossingLine = std::make_shared<MapObject>();
+    crossingLine->attributeMapping = _attributeMapping;
+    crossingLine->attributeIds.push_back(2);
+    crossingLine->points31 = toPath31(QVector<PointI>() << PointI(-1000, 1000) << PointI(5000, 1000));
+    crossingLine->computeBBox31();
+
+    // Leaves tile through top and comes back, so it's split into two parts of one feature
+    const auto leavingLine = std::make_shared<MapObject>();
+    leavingLine->attributeMapping = _attributeMapping;
+    leavingLine->attributeIds.push_back(2);
+    leavingLine->points31 = toPath31(QVector<PointI>()
+        << PointI(100, 100) << PointI(100, -1000) << PointI(200, -1000) << PointI(200, 100));
+    leavingLine->computeBBox31();
+
+    const auto tile = encodeAndRead(QList< std::shared_ptr<const MapObject> >() << crossingLine << leavingLine);
+    QVERIFY(tile != nullptr);
+    QCOMPARE(tile->getGeometry().size(), 2);
+
+    // Negative coordinates and deltas only come out right if zigzag encoding and command counts are right
+    const auto lineString = std::dynamic_pointer_cast<const MvtReader::LineString>(
+        findGeometry(tile, MvtReader::LINE_STRING));
+    QVERIFY(lineString != nullptr);
+    QCOMPARE(lineString->getCoordinateSequence(), QVector<PointI>()
+        << PointI(-Buffer, 1000) << PointI(Extent + Buffer, 1000));
+
+    const auto multiLineString = std::dynamic_pointer_cast<const MvtReader::MultiLineString>(
+        findGeometry(tile, MvtReader::MULTI_LINE_STRING));
+    QVERIFY(multiLineString != nullptr);
+    const auto lines = multiLineString->getLines();
+    QCOMPARE(lines.size(), 2);
+    QCOMPARE(lines[0]->getCoordinateSequence(), QVector<PointI>() << PointI(100, 100) << PointI(100, -Buffer));
+    QCOMPARE(lines[1]->getCoordinateSequence(), QVector<PointI>() << PointI(200, -Buffer) << PointI(200, 100));
+}
+
+void TestMvtTileProvider::ringsAreClippedAndWound()
+{
+    // Exterior ring is counter-clockwise and hole is clockwise on screen, which is opposite of what MVT requires
+    const auto building = std::make_shared<MapObject>();
+    building->attributeMapping = _attributeMapping;
+    building->attributeIds.push_back(1);
+    building->isArea = true;
+    building->points31 = toPath31(QVector<PointI>()
+        << PointI(-1000, -1000) << PointI(-1000, 2000) << PointI(2000, 2000) << PointI(2000, -1000)
+        << PointI(-1000, -1000));
+    building->innerPolygonsPoints31.push_back(toPath31(QVector<PointI>()
+        << PointI(500, 500) << PointI(1000, 500) << PointI(1000, 1000) << PointI(500, 1000)
+        << PointI(500, 500)));
+    building->computeBBox31();
+
+    const auto tile = encodeAndRead(QList< std::shared_ptr<const MapObject> >() << building);
+    QVERIFY(tile != nullptr);
+    QCOMPARE(tile->getGeometry().size(), 1);
+
+    const auto polygon = std::dynamic_pointer_cast<const MvtReader::Polygon>(
+        findGeometry(tile, MvtReader::POLYGON));
+    QVERIFY(polygon != nullptr);
+    const auto rings = polygon->getRings();
+    QCOMPARE(rings.size(), 2);
+
+    // Part of exterior ring outside of buffer collapses onto its edges
+    QVERIFY(doubledSignedArea(rings[0]) > 0);
+    QCOMPARE(sorted(rings[0]), sorted(QVector<PointI>()
+        << PointI(-Buffer, -Buffer) << PointI(-Buffer, 2000) << PointI(2000, 2000) << PointI(2000, -Buffer)));
+
+    QVERIFY(doubledSignedArea(rings[1]) < 0);
+    QCOMPARE(sorted(rings[1]), sorted(QVector<PointI>()
+        << PointI(500, 500) << PointI(1000, 500) << PointI(1000, 1000) << PointI(500, 1000)));
+}
+
+void TestMvtTileProvider::pointsAreEncoded()
+{
+    // Point without icon is primitivised only if it has caption
+    const auto cafe = std::make_shared<MapObject>();
+    cafe->attributeMapping = _attributeMapping;
+    cafe->attributeIds.push_back(3);
+    cafe->captions.insert(_attributeMapping->nativeNameAttributeId, QLatin1String("Cafe"));
+    cafe->captionsOrder.push_back(_attributeMapping->nativeNameAttributeId);
+    cafe->points31.push_back(toPoint31(1000, 3000));
+    cafe->computeBBox31();
+
+    const auto tile = encodeAndRead(QList< std::shared_ptr<const MapObject> >() << cafe);
+    QVERIFY(tile != nullptr);
+    QCOMPARE(tile->getGeometry().size(), 1);
+
+    const auto point = std::dynamic_pointer_cast<const MvtReader::Point>(findGeometry(tile, MvtReader::POINT));
+    QVERIFY(point != nullptr);
+    QCOMPARE(point->getCoordinate(), PointI(1000, 3000));
+}
+
+QTEST_MAIN(TestMvtTileProvider)
+#include "TestMvtTileProvider.moc"
@@ -0,0 +1,205 @@
+#include <OsmAndCore/WebClient.h>
+#include <OsmAndCore/Map/IOnlineTileSources.h>
+#include <OsmAndCore/Map/OnlineRasterMapLayerProvider.h>
+#include <OsmAndCore/Map/SqliteTilesCache.h>
+
+#include <QtTest/QtTest>
+#include <QCoreApplication>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QSemaphore>
+#include <QSqlDatabase>
+
+#include <functional>
+#include <memory>
+
+using namespace OsmAnd;
+
+// Stand-in for tile server, that answers every request with the same response. It runs on own thread, since
+// provider downloads tiles synchronously.
+class TileServerStandIn : public QThread
+{
+public:
+    TileServerStandIn(const QByteArray& response_)
+        : response(response_)
+        , port(0)
+    {
+    }
+
+    const QByteArray response;
+    quint16 port;
+    QAtomicInt requestsCount;
+
+    void startListening()
+    {
+        start();
+        _listening.acquire();
+    }
+
+    void stopListening()
+    {
+        requestInterruption();
+        wait();
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        QTcpServer server;
+        server.listen(QHostAddress::LocalHost, 0);
+        port = server.serverPort();
+        _listening.release();
+
+        while (!isInterruptionRequested())
+        {
+            if (!server.waitForNewConnection(50))
+                continue;
+            const std::unique_ptr<QTcpSocket> socket(server.nextPendingConnection());
+
+            QByteArray request;
+            while (!request.contains("\r\n\r\n") && socket->waitForReadyRead(1000))
+                request += socket->readAll();
+            requestsCount.fetchAndAddOrdered(1);
+
+            socket->write(response);
+            socket->waitForBytesWritten(1000);
+            socket->disconnectFromHost();
+            if (socket->state() != QAbstractSocket::UnconnectedState)
+                socket->waitForDisconnected(1000);
+        }
+    }
+
+private:
+    QSemaphore _listening;
+};
+
+class FunctorThread : public QThread
+{
+public:
+    FunctorThread(const std::function<void()>& functor_)
+        : functor(functor_)
+    {
+    }
+
+    const std::function<void()> functor;
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        functor();
+    }
+};
+
+class TestSqliteTilesCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QStringList getConnectionNamesOf(const QString& filePath);
+private slots:
+    void missingTileIsCachedAndServedOffline();
+    void readConnectionsAreReleasedByOwnThreads();
+};
+
+QStringList TestSqliteTilesCache::getConnectionNamesOf(const QString& filePath)
+{
+    QStringList connectionNames;
+    for (const auto& connectionName : QSqlDatabase::connectionNames())
+    {
+        if (connectionName.contains(filePath))
+            connectionNames.push_back(connectionName);
+    }
+    return connectionNames;
+}
+
+void TestSqliteTilesCache::missingTileIsCachedAndServedOffline()
+{
+    TileServerStandIn server("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    server.startListening();
+
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    const auto cache = std::make_shared<SqliteTilesCache>(cacheDir.path() + QLatin1String("/tiles.sqlitedb"));
+    QVERIFY(cache->isOpened());
+
+    const auto tileSource = std::make_shared<IOnlineTileSources::Source>(QLatin1String("stand-in"));
+    tileSource->urlToLoad = QString(QLatin1String("http://127.0.0.1:%1/{0}/{1}/{2}.png")).arg(server.port);
+    tileSource->minZoom = ZoomLevel0;
+    tileSource->maxZoom = ZoomLevel19;
+    tileSource->tileSize = 256;
+    tileSource->expirationTimeMillis = -1;
+    const auto provider = std::make_shared<OnlineRasterMapLayerProvider>(
+        tileSource,
+        std::make_shared<WebClient>(QLatin1String("OsmAnd Core Tests"), 1, 1));
+    provider->setLocalCache(cache);
+
+    IMapTiledDataProvider::Request request;
+    request.tileId = TileId::fromXY(1, 2);
+    request.zoom = ZoomLevel3;
+
+    // Tile that doesn't exist on server is remembered as empty one
+    std::shared_ptr<IMapDataProvider::Data> data;
+    QVERIFY(provider->obtainData(request, data));
+    QVERIFY(!data);
+    QCOMPARE(server.requestsCount.loadAcquire(), 1);
+
+    // Both before and after it's written, tile is served from cache
+    QVERIFY(provider->obtainData(request, data));
+    QVERIFY(!data);
+    cache->flush();
+    QVERIFY(provider->obtainData(request, data));
+    QVERIFY(!data);
+    QCOMPARE(server.requestsCount.loadAcquire(), 1);
+
+    // Without network access, only cached tiles are available
+    provider->setNetworkAccessPermission(false);
+    QVERIFY(provider->obtainData(request, data));
+    request.tileId = TileId::fromXY(2, 1);
+    QVERIFY(!provider->obtainData(request, data));
+    QCOMPARE(server.requestsCount.loadAcquire(), 1);
+
+    server.stopListening();
+}
+
+void TestSqliteTilesCache::readConnectionsAreReleasedByOwnThreads()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    const auto filePath = cacheDir.path() + QLatin1String("/tiles.sqlitedb");
+
+    auto cache = std::make_shared<SqliteTilesCache>(filePath);
+    QVERIFY(cache->isOpened());
+    cache->storeTile(TileId::fromXY(1, 1), ZoomLevel1, QByteArray("tile"), QDateTime());
+    cache->flush();
+
+    // Each thread reads using own connection, which is gone once thread exits
+    for (int threadIdx = 0; threadIdx < 4; threadIdx++)
+    {
+        bool found = false;
+        QByteArray data;
+        FunctorThread reader(
+            [cache, &found, &data]
+            ()
+            {
+                found = cache->obtainTile(TileId::fromXY(1, 1), ZoomLevel1, data);
+            });
+        reader.start();
+        reader.wait();
+
+        QVERIFY(found);
+        QCOMPARE(data, QByteArray("tile"));
+    }
+    QVERIFY(getConnectionNamesOf(filePath).isEmpty());
+
+    // Connection of closing thread is released by close itself
+    QByteArray data;
+    QVERIFY(cache->obtainTile(TileId::fromXY(1, 1), ZoomLevel1, data));
+    QVERIFY(!getConnectionNamesOf(filePath).isEmpty());
+    cache.reset();
+    QVERIFY(getConnectionNamesOf(filePath).isEmpty());
+}
+
+QTEST_MAIN(TestSqliteTilesCache)
+#include "TestSqliteTilesCache.moc"
@@ -0,0 +1,112 @@
+#ifndef _OSMAND_CORE_TOOLS_BENCHMARKER_H_
+#define _OSMAND_CORE_TOOLS_BENCHMARKER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QJsonObject>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/IObfsCollection.h>
+#include <OsmAndCore/Map/IMapStylesCollection.h>
+
+#include <OsmAndCoreTools.h>
+
+namespace OsmAndTools
+{
+    // Runs stages of OBF-to-raster pipeline (and search) over fixed set of tiles, one stage at a time and on single
+    // thread, so that results of two builds on same OBF files and tiles can be compared directly.
+    class OSMAND_CORE_TOOLS_API Benchmarker Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(Benchmarker);
+
+    public:
+        enum class Case
+        {
+            LoadMapObjects,
+            LoadRoads,
+            EvaluateStyle,
+            Primitivise,
+            RasterizeMap,
+            RasterizeText,
+            SearchAddresses,
+            SearchAmenitiesByName,
+            SearchAmenitiesInArea,
+        };
+
+        struct Tile
+        {
+            OsmAnd::TileId tileId;
+            OsmAnd::ZoomLevel zoom;
+        };
+
+        struct OSMAND_CORE_TOOLS_API Configuration Q_DECL_FINAL
+        {
+            Configuration();
+
+            std::shared_ptr<OsmAnd::IObfsCollection> obfsCollection;
+            std::shared_ptr<OsmAnd::IMapStylesCollection> stylesCollection;
+            QString styleName;
+            QHash< QString, QString > styleSettings;
+            float displayDensityFactor;
+            float mapScale;
+            float symbolsScale;
+            QString locale;
+            unsigned int tileSize;
+            QList<Tile> tiles;
+            QStringList captions;
+            QStringList addressQueries;
+            QStringList amenityQueries;
+            QList<Case> cases;
+            unsigned int warmUpIterations;
+            unsigned int iterations;
+            QString outputFilename;
+            QString label;
+            bool verbose;
+
+            static bool parseFromCommandLineArguments(
+                const QStringList& commandLineArgs,
+                Configuration& outConfiguration,
+                QString& outError);
+        };
+
+    private:
+        // Performs single pass over all inputs of case and returns count of produced items (objects, bitmaps,
+        // results). If metric object is given, case has to collect its metric there.
+        typedef std::function<unsigned int (QJsonObject* const pOutMetric)> CaseFunction;
+
+        static QString getCaseName(const Case caseId);
+
+#if defined(_UNICODE) || defined(UNICODE)
+        bool measure(std::wostream& output, const Case caseId, const CaseFunction& caseFunction, QJsonObject& outResult) const;
+        bool run(std::wostream& output, QJsonObject& outResult) const;
+        bool run(std::wostream& output);
+#else
+        bool measure(std::ostream& output, const Case caseId, const CaseFunction& caseFunction, QJsonObject& outResult) const;
+        bool run(std::ostream& output, QJsonObject& outResult) const;
+        bool run(std::ostream& output);
+#endif
+    protected:
+    public:
+        Benchmarker(const Configuration& configuration);
+        ~Benchmarker();
+
+        const Configuration configuration;
+
+        bool run(QString *pLog = nullptr);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TOOLS_BENCHMARKER_H_)
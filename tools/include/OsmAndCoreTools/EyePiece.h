@@ -13,11 +13,14 @@
 #include <QStringList>
 #include <QDir>
 #include <QFile>
+#include <QList>
+#include <QJsonObject>
 #include <OsmAndCore/restore_internal_warnings.h>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/IObfsCollection.h>
 #include <OsmAndCore/Map/IMapStylesCollection.h>
+#include <OsmAndCore/Map/IMapRenderer.h>
 
 #include <OsmAndCoreTools.h>
 
@@ -34,6 +37,15 @@ namespace OsmAndTools
             JPEG
         };
 
+        // Scripted camera paths replayed in benchmark mode, all starting from configured camera state
+        enum class BenchmarkScenario
+        {
+            Pan,
+            Fling,
+            ZoomSweep,
+            FlyTo
+        };
+
         struct OSMAND_CORE_TOOLS_API Configuration Q_DECL_FINAL
         {
             Configuration();
@@ -61,6 +73,15 @@ namespace OsmAndTools
             bool useLegacyContext;
 #endif
 
+            // After image is rendered, replay camera paths and write per-frame measurements as JSON
+            bool benchmark;
+            QList<BenchmarkScenario> benchmarkScenarios;
+            unsigned int benchmarkFramesPerScenario;
+            float benchmarkFrameDuration;
+            float benchmarkSettleTimeout;
+            QString benchmarkOutputFilename;
+            QString benchmarkLabel;
+
             static bool parseFromCommandLineArguments(
                 const QStringList& commandLineArgs,
                 Configuration& outConfiguration,
@@ -68,11 +89,50 @@ namespace OsmAndTools
         };
 
     private:
+        struct BenchmarkCameraState
+        {
+            OsmAnd::PointI target31;
+            float zoom;
+            float azimuth;
+            float elevationAngle;
+        };
+        BenchmarkCameraState getBenchmarkCameraState(
+            const BenchmarkScenario scenario,
+            const float t,
+            const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer) const;
+        void applyBenchmarkCameraState(
+            const BenchmarkCameraState& state,
+            const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer) const;
+
 #if defined(_UNICODE) || defined(UNICODE)
         bool glVerifyResult(std::wostream& output) const;
 #else
         bool glVerifyResult(std::ostream& output) const;
 #endif
+
+#if defined(_UNICODE) || defined(UNICODE)
+        bool renderUntilIdle(
+            std::wostream& output,
+            const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer,
+            const float timeout,
+            unsigned int& outFramesCount,
+            float& outTimeElapsed) const;
+        bool benchmark(
+            std::wostream& output,
+            const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer,
+            QJsonObject& outResult) const;
+#else
+        bool renderUntilIdle(
+            std::ostream& output,
+            const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer,
+            const float timeout,
+            unsigned int& outFramesCount,
+            float& outTimeElapsed) const;
+        bool benchmark(
+            std::ostream& output,
+            const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer,
+            QJsonObject& outResult) const;
+#endif
         
 #if defined(_UNICODE) || defined(UNICODE)
         bool rasterize(std::wostream& output);
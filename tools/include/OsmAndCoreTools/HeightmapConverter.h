@@ -0,0 +1,61 @@
+#ifndef _OSMAND_CORE_TOOLS_HEIGHTMAP_CONVERTER_H_
+#define _OSMAND_CORE_TOOLS_HEIGHTMAP_CONVERTER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <iostream>
+#include <sstream>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QStringList>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/Map/HeightmapPyramid.h>
+
+#include <OsmAndCoreTools.h>
+
+namespace OsmAndTools
+{
+    class OSMAND_CORE_TOOLS_API HeightmapConverter Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(HeightmapConverter);
+
+    public:
+        struct OSMAND_CORE_TOOLS_API Configuration Q_DECL_FINAL
+        {
+            Configuration();
+
+            QString tileDbPath;
+            QString indexFilename;
+            QString outputFilename;
+            OsmAnd::HeightmapPyramid::SampleType sampleType;
+            bool verbose;
+
+            static bool parseFromCommandLineArguments(
+                const QStringList& commandLineArgs,
+                Configuration& outConfiguration,
+                QString& outError);
+        };
+
+    private:
+#if defined(_UNICODE) || defined(UNICODE)
+        bool convert(std::wostream& output);
+#else
+        bool convert(std::ostream& output);
+#endif
+    protected:
+    public:
+        HeightmapConverter(const Configuration& configuration);
+        ~HeightmapConverter();
+
+        const Configuration configuration;
+
+        bool convert(QString *pLog = nullptr);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TOOLS_HEIGHTMAP_CONVERTER_H_)
@@ -0,0 +1,81 @@
+#ifndef _OSMAND_CORE_TOOLS_MVT_EXPORTER_H_
+#define _OSMAND_CORE_TOOLS_MVT_EXPORTER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <iostream>
+#include <sstream>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QByteArray>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/IObfsCollection.h>
+#include <OsmAndCore/Map/IMapStylesCollection.h>
+#include <OsmAndCore/Map/MvtTileProvider.h>
+
+#include <OsmAndCoreTools.h>
+
+namespace OsmAndTools
+{
+    // Exports OBF map data within bounding box as directory tree of Mapbox Vector Tiles ("z/x/y.mvt"), encoding
+    // tiles on several threads at once.
+    class OSMAND_CORE_TOOLS_API MvtExporter Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(MvtExporter);
+
+    public:
+        struct OSMAND_CORE_TOOLS_API Configuration Q_DECL_FINAL
+        {
+            Configuration();
+
+            std::shared_ptr<OsmAnd::IObfsCollection> obfsCollection;
+            std::shared_ptr<OsmAnd::IMapStylesCollection> stylesCollection;
+            QString styleName;
+            QHash< QString, QString > styleSettings;
+            float displayDensityFactor;
+            float mapScale;
+            float symbolsScale;
+            QString locale;
+            OsmAnd::AreaI bbox31;
+            OsmAnd::ZoomLevel minZoom;
+            OsmAnd::ZoomLevel maxZoom;
+            unsigned int tileSize;
+            OsmAnd::MvtTileProvider::Configuration mvtConfiguration;
+            QString outputPath;
+            unsigned int threadsCount;
+            bool verbose;
+
+            static bool parseFromCommandLineArguments(
+                const QStringList& commandLineArgs,
+                Configuration& outConfiguration,
+                QString& outError);
+        };
+
+    private:
+        bool writeTile(const OsmAnd::TileId tileId, const OsmAnd::ZoomLevel zoom, const QByteArray& encodedTile) const;
+
+#if defined(_UNICODE) || defined(UNICODE)
+        bool exportTiles(std::wostream& output);
+#else
+        bool exportTiles(std::ostream& output);
+#endif
+    protected:
+    public:
+        MvtExporter(const Configuration& configuration);
+        ~MvtExporter();
+
+        const Configuration configuration;
+
+        bool exportTiles(QString *pLog = nullptr);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TOOLS_MVT_EXPORTER_H_)
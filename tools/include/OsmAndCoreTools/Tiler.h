@@ -0,0 +1,69 @@
+#ifndef _OSMAND_CORE_TOOLS_TILER_H_
+#define _OSMAND_CORE_TOOLS_TILER_H_
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <iostream>
+#include <sstream>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/IObfsCollection.h>
+#include <OsmAndCore/Map/IMapStylesCollection.h>
+#include <OsmAndCore/Map/MapRasterTilesBatchRenderer.h>
+
+#include <OsmAndCoreTools.h>
+
+namespace OsmAndTools
+{
+    class OSMAND_CORE_TOOLS_API Tiler Q_DECL_FINAL
+    {
+        Q_DISABLE_COPY_AND_MOVE(Tiler);
+
+    public:
+        struct OSMAND_CORE_TOOLS_API Configuration Q_DECL_FINAL
+        {
+            Configuration();
+
+            std::shared_ptr<OsmAnd::IObfsCollection> obfsCollection;
+            std::shared_ptr<OsmAnd::IMapStylesCollection> stylesCollection;
+            QString styleName;
+            QHash< QString, QString > styleSettings;
+            float displayDensityFactor;
+            float mapScale;
+            float symbolsScale;
+            QString locale;
+            OsmAnd::MapRasterTilesBatchRenderer::Configuration batchConfiguration;
+            bool verbose;
+
+            static bool parseFromCommandLineArguments(
+                const QStringList& commandLineArgs,
+                Configuration& outConfiguration,
+                QString& outError);
+        };
+
+    private:
+#if defined(_UNICODE) || defined(UNICODE)
+        bool render(std::wostream& output);
+#else
+        bool render(std::ostream& output);
+#endif
+    protected:
+    public:
+        Tiler(const Configuration& configuration);
+        ~Tiler();
+
+        const Configuration configuration;
+
+        bool render(QString *pLog = nullptr);
+    };
+}
+
+#endif // !defined(_OSMAND_CORE_TOOLS_TILER_H_)
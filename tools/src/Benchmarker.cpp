@@ -0,0 +1,1038 @@
+#include "Benchmarker.h"
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/ObfsCollection.h>
+#include <OsmAndCore/Stopwatch.h>
+#include <OsmAndCore/Utilities.h>
+#include <OsmAndCore/MetricsRegistry.h>
+#include <OsmAndCore/Data/ObfFile.h>
+#include <OsmAndCore/Data/ObfReader.h>
+#include <OsmAndCore/Data/ObfInfo.h>
+#include <OsmAndCore/Data/ObfMapSectionInfo.h>
+#include <OsmAndCore/Data/ObfMapSectionReader.h>
+#include <OsmAndCore/Data/ObfMapSectionReader_Metrics.h>
+#include <OsmAndCore/Data/ObfRoutingSectionInfo.h>
+#include <OsmAndCore/Data/ObfRoutingSectionReader.h>
+#include <OsmAndCore/Data/ObfRoutingSectionReader_Metrics.h>
+#include <OsmAndCore/Data/BinaryMapObject.h>
+#include <OsmAndCore/Data/Road.h>
+#include <OsmAndCore/Map/MapStylesCollection.h>
+#include <OsmAndCore/Map/MapPresentationEnvironment.h>
+#include <OsmAndCore/Map/MapStyleEvaluator.h>
+#include <OsmAndCore/Map/MapStyleEvaluationResult.h>
+#include <OsmAndCore/Map/MapStyleBuiltinValueDefinitions.h>
+#include <OsmAndCore/Map/MapPrimitiviser.h>
+#include <OsmAndCore/Map/MapPrimitiviser_Metrics.h>
+#include <OsmAndCore/Map/MapRasterizer.h>
+#include <OsmAndCore/Map/MapRasterizer_Metrics.h>
+#include <OsmAndCore/Map/ObfMapObjectsProvider.h>
+#include <OsmAndCore/TextRasterizer.h>
+#include <OsmAndCore/Search/AddressesByNameSearch.h>
+#include <OsmAndCore/Search/AmenitiesByNameSearch.h>
+#include <OsmAndCore/Search/AmenitiesInAreaSearch.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QSysInfo>
+#include <QThread>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <SkBitmap.h>
+#include <SkCanvas.h>
+#include <SkBitmapDevice.h>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCoreTools.h>
+#include <OsmAndCoreTools/Utilities.h>
+
+OsmAndTools::Benchmarker::Benchmarker(const Configuration& configuration_)
+    : configuration(configuration_)
+{
+}
+
+OsmAndTools::Benchmarker::~Benchmarker()
+{
+}
+
+QString OsmAndTools::Benchmarker::getCaseName(const Case caseId)
+{
+    switch (caseId)
+    {
+        case Case::LoadMapObjects:
+            return QLatin1String("loadMapObjects");
+        case Case::LoadRoads:
+            return QLatin1String("loadRoads");
+        case Case::EvaluateStyle:
+            return QLatin1String("evaluateStyle");
+        case Case::Primitivise:
+            return QLatin1String("primitivise");
+        case Case::RasterizeMap:
+            return QLatin1String("rasterizeMap");
+        case Case::RasterizeText:
+            return QLatin1String("rasterizeText");
+        case Case::SearchAddresses:
+            return QLatin1String("searchAddresses");
+        case Case::SearchAmenitiesByName:
+            return QLatin1String("searchAmenitiesByName");
+        case Case::SearchAmenitiesInArea:
+            return QLatin1String("searchAmenitiesInArea");
+    }
+
+    return QString();
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::Benchmarker::measure(
+    std::wostream& output,
+#else
+bool OsmAndTools::Benchmarker::measure(
+    std::ostream& output,
+#endif
+    const Case caseId,
+    const CaseFunction& caseFunction,
+    QJsonObject& outResult) const
+{
+    const auto caseName = getCaseName(caseId);
+    if (configuration.verbose)
+        output << xT("Measuring '") << QStringToStlString(caseName) << xT("'...") << std::endl;
+
+    for (auto iterationIndex = 0u; iterationIndex < configuration.warmUpIterations; iterationIndex++)
+        caseFunction(nullptr);
+
+    // Same inputs have to produce same outputs on every iteration, otherwise times are not comparable
+    QVector<double> times;
+    times.reserve(configuration.iterations);
+    unsigned int itemsCount = 0;
+    bool isDeterministic = true;
+    for (auto iterationIndex = 0u; iterationIndex < configuration.iterations; iterationIndex++)
+    {
+        const OsmAnd::Stopwatch iterationStopwatch(true);
+        const auto iterationItemsCount = caseFunction(nullptr);
+        times.push_back(iterationStopwatch.elapsed());
+
+        if (iterationIndex > 0 && iterationItemsCount != itemsCount)
+            isDeterministic = false;
+        itemsCount = iterationItemsCount;
+    }
+    if (!isDeterministic)
+    {
+        output
+            << xT("'") << QStringToStlString(caseName)
+            << xT("' produced different results on different iterations") << std::endl;
+    }
+
+    // Metrics slow down measured code, so they are collected on separate pass that is not timed
+    QJsonObject metricObject;
+    caseFunction(&metricObject);
+
+    auto sortedTimes = times;
+    std::sort(sortedTimes.begin(), sortedTimes.end());
+    const auto mean = times.isEmpty()
+        ? 0.0
+        : std::accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+    auto variance = 0.0;
+    for (const auto time : times)
+        variance += (time - mean) * (time - mean);
+    if (times.size() > 1)
+        variance /= times.size() - 1;
+
+    QJsonArray timesArray;
+    for (const auto time : times)
+        timesArray.append(time);
+
+    outResult.insert(QLatin1String("name"), caseName);
+    outResult.insert(QLatin1String("iterations"), times.size());
+    outResult.insert(QLatin1String("items"), static_cast<double>(itemsCount));
+    outResult.insert(QLatin1String("deterministic"), isDeterministic);
+    outResult.insert(QLatin1String("timeMin"), sortedTimes.isEmpty() ? 0.0 : sortedTimes.first());
+    outResult.insert(QLatin1String("timeMedian"), sortedTimes.isEmpty() ? 0.0 : sortedTimes[sortedTimes.size() / 2]);
+    outResult.insert(QLatin1String("timeMean"), mean);
+    outResult.insert(QLatin1String("timeMax"), sortedTimes.isEmpty() ? 0.0 : sortedTimes.last());
+    outResult.insert(QLatin1String("timeStdDev"), std::sqrt(variance));
+    outResult.insert(QLatin1String("timePerItemMedian"), (itemsCount == 0 || sortedTimes.isEmpty())
+        ? 0.0
+        : sortedTimes[sortedTimes.size() / 2] / itemsCount);
+    outResult.insert(QLatin1String("times"), timesArray);
+    outResult.insert(QLatin1String("metric"), metricObject);
+
+    if (configuration.verbose)
+    {
+        output
+            << xT("'") << QStringToStlString(caseName) << xT("': ")
+            << itemsCount << xT(" items, median ")
+            << (sortedTimes.isEmpty() ? 0.0 : sortedTimes[sortedTimes.size() / 2]) << xT("s, min ")
+            << (sortedTimes.isEmpty() ? 0.0 : sortedTimes.first()) << xT("s") << std::endl;
+    }
+
+    return isDeterministic;
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::Benchmarker::run(std::wostream& output, QJsonObject& outResult) const
+#else
+bool OsmAndTools::Benchmarker::run(std::ostream& output, QJsonObject& outResult) const
+#endif
+{
+    const auto visitMetricFields =
+        []
+        (const OsmAnd::Metric& metric, QJsonObject& outObject)
+        {
+            metric.visitFields(
+                [&outObject]
+                (const char* const name, const double value, const char* const measurement, const bool isFractional)
+                {
+                    outObject.insert(QLatin1String(name), value);
+                });
+        };
+
+    // Find style
+    if (configuration.verbose)
+        output << xT("Resolving style '") << QStringToStlString(configuration.styleName) << xT("'...") << std::endl;
+    const auto mapStyle = configuration.stylesCollection->getResolvedStyleByName(configuration.styleName);
+    if (!mapStyle)
+    {
+        output << xT("Failed to resolve style '") << QStringToStlString(configuration.styleName) << xT("' from collection") << std::endl;
+        return false;
+    }
+
+    const std::shared_ptr<OsmAnd::MapPresentationEnvironment> mapPresentationEnvironment(new OsmAnd::MapPresentationEnvironment(
+        mapStyle,
+        configuration.displayDensityFactor,
+        configuration.mapScale,
+        configuration.symbolsScale,
+        configuration.locale));
+    mapPresentationEnvironment->setSettings(configuration.styleSettings);
+    const std::shared_ptr<OsmAnd::MapPrimitiviser> primitiviser(new OsmAnd::MapPrimitiviser(
+        mapPresentationEnvironment));
+    const std::shared_ptr<OsmAnd::MapRasterizer> rasterizer(new OsmAnd::MapRasterizer(
+        mapPresentationEnvironment));
+
+    // OBF files are identified by content, so that baseline taken on other extract is not compared by mistake
+    if (configuration.verbose)
+        output << xT("Opening OBF files...") << std::endl;
+    QList< std::shared_ptr<const OsmAnd::ObfReader> > obfReaders;
+    QJsonArray obfFilesArray;
+    for (const auto& obfFile : configuration.obfsCollection->getObfFiles())
+    {
+        const std::shared_ptr<QFile> file(new QFile(obfFile->filePath));
+        if (!file->open(QIODevice::ReadOnly))
+        {
+            output << xT("Failed to open OBF '") << QStringToStlString(obfFile->filePath) << xT("'") << std::endl;
+            return false;
+        }
+
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        hash.addData(file.get());
+        file->seek(0);
+
+        QJsonObject obfFileObject;
+        obfFileObject.insert(QLatin1String("name"), QFileInfo(obfFile->filePath).fileName());
+        obfFileObject.insert(QLatin1String("size"), static_cast<double>(file->size()));
+        obfFileObject.insert(QLatin1String("md5"), QString::fromLatin1(hash.result().toHex()));
+        obfFilesArray.append(obfFileObject);
+
+        obfReaders.push_back(std::shared_ptr<const OsmAnd::ObfReader>(new OsmAnd::ObfReader(file)));
+    }
+
+    QJsonObject configurationObject;
+    configurationObject.insert(QLatin1String("styleName"), configuration.styleName);
+    QJsonObject styleSettingsObject;
+    for (const auto& styleSettingEntry : OsmAnd::rangeOf(OsmAnd::constOf(configuration.styleSettings)))
+        styleSettingsObject.insert(styleSettingEntry.key(), styleSettingEntry.value());
+    configurationObject.insert(QLatin1String("styleSettings"), styleSettingsObject);
+    configurationObject.insert(QLatin1String("displayDensityFactor"), configuration.displayDensityFactor);
+    configurationObject.insert(QLatin1String("mapScale"), configuration.mapScale);
+    configurationObject.insert(QLatin1String("symbolsScale"), configuration.symbolsScale);
+    configurationObject.insert(QLatin1String("locale"), configuration.locale);
+    configurationObject.insert(QLatin1String("tileSize"), static_cast<double>(configuration.tileSize));
+    QJsonArray tilesArray;
+    for (const auto& tile : configuration.tiles)
+    {
+        tilesArray.append(QString(QLatin1String("%1/%2/%3"))
+            .arg(static_cast<int>(tile.zoom))
+            .arg(tile.tileId.x)
+            .arg(tile.tileId.y));
+    }
+    configurationObject.insert(QLatin1String("tiles"), tilesArray);
+    configurationObject.insert(QLatin1String("captions"), QJsonArray::fromStringList(configuration.captions));
+    configurationObject.insert(QLatin1String("addressQueries"), QJsonArray::fromStringList(configuration.addressQueries));
+    configurationObject.insert(QLatin1String("amenityQueries"), QJsonArray::fromStringList(configuration.amenityQueries));
+    configurationObject.insert(QLatin1String("warmUpIterations"), static_cast<double>(configuration.warmUpIterations));
+    configurationObject.insert(QLatin1String("iterations"), static_cast<double>(configuration.iterations));
+    configurationObject.insert(QLatin1String("obfFiles"), obfFilesArray);
+
+    QJsonObject environmentObject;
+    environmentObject.insert(QLatin1String("os"), QSysInfo::prettyProductName());
+    environmentObject.insert(QLatin1String("cpuArchitecture"), QSysInfo::currentCpuArchitecture());
+    environmentObject.insert(QLatin1String("idealThreadCount"), QThread::idealThreadCount());
+    environmentObject.insert(QLatin1String("debug"), static_cast<bool>(OSMAND_DEBUG));
+
+    outResult.insert(QLatin1String("label"), configuration.label);
+    outResult.insert(QLatin1String("configuration"), configurationObject);
+    outResult.insert(QLatin1String("environment"), environmentObject);
+
+    // Inputs of later stages are prepared once, so that each case measures only its own stage
+    if (configuration.verbose)
+        output << xT("Preparing inputs of ") << configuration.tiles.size() << xT(" tile(s)...") << std::endl;
+    const std::shared_ptr<OsmAnd::ObfMapObjectsProvider> mapObjectsProvider(new OsmAnd::ObfMapObjectsProvider(
+        configuration.obfsCollection));
+    QList< std::shared_ptr<OsmAnd::IMapObjectsProvider::Data> > tilesMapObjects;
+    QList< std::shared_ptr<const OsmAnd::MapPrimitiviser::PrimitivisedObjects> > tilesPrimitivisedObjects;
+    for (const auto& tile : configuration.tiles)
+    {
+        OsmAnd::IMapObjectsProvider::Request request;
+        request.tileId = tile.tileId;
+        request.zoom = tile.zoom;
+
+        std::shared_ptr<OsmAnd::IMapObjectsProvider::Data> mapObjects;
+        if (!mapObjectsProvider->obtainTiledMapObjects(request, mapObjects))
+        {
+            output
+                << xT("Failed to obtain map objects for ")
+                << tile.tileId.x << xT("x") << tile.tileId.y << xT("@") << tile.zoom << std::endl;
+            return false;
+        }
+        tilesMapObjects.push_back(mapObjects);
+
+        std::shared_ptr<const OsmAnd::MapPrimitiviser::PrimitivisedObjects> primitivisedObjects;
+        if (mapObjects)
+        {
+            primitivisedObjects = primitiviser->primitiviseWithSurface(
+                OsmAnd::Utilities::tileBoundingBox31(tile.tileId, tile.zoom),
+                OsmAnd::PointI(configuration.tileSize, configuration.tileSize),
+                tile.zoom,
+                mapObjects->tileSurfaceType,
+                mapObjects->mapObjects);
+        }
+        tilesPrimitivisedObjects.push_back(primitivisedObjects);
+    }
+
+    auto& metricsRegistry = OsmAnd::MetricsRegistry::getDefault();
+    const auto wasMetricsRegistryEnabled = metricsRegistry.isEnabled();
+
+    bool success = true;
+    QJsonArray casesArray;
+    for (const auto caseId : configuration.cases)
+    {
+        CaseFunction caseFunction;
+        switch (caseId)
+        {
+            case Case::LoadMapObjects:
+                caseFunction =
+                    [this, &obfReaders, visitMetricFields]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        OsmAnd::ObfMapSectionReader_Metrics::Metric_loadMapObjects metric;
+                        unsigned int mapObjectsCount = 0;
+                        for (const auto& tile : configuration.tiles)
+                        {
+                            const auto bbox31 = OsmAnd::Utilities::tileBoundingBox31(tile.tileId, tile.zoom);
+                            for (const auto& obfReader : obfReaders)
+                            {
+                                for (const auto& mapSection : obfReader->obtainInfo()->mapSections)
+                                {
+                                    QList< std::shared_ptr<const OsmAnd::BinaryMapObject> > mapObjects;
+                                    OsmAnd::ObfMapSectionReader::loadMapObjects(
+                                        obfReader,
+                                        mapSection,
+                                        tile.zoom,
+                                        &bbox31,
+                                        &mapObjects,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr,
+                                        pOutMetric ? &metric : nullptr);
+                                    mapObjectsCount += mapObjects.size();
+                                }
+                            }
+                        }
+                        if (pOutMetric)
+                            visitMetricFields(metric, *pOutMetric);
+                        return mapObjectsCount;
+                    };
+                break;
+
+            case Case::LoadRoads:
+                caseFunction =
+                    [this, &obfReaders, visitMetricFields]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        OsmAnd::ObfRoutingSectionReader_Metrics::Metric_loadRoads metric;
+                        unsigned int roadsCount = 0;
+                        for (const auto& tile : configuration.tiles)
+                        {
+                            const auto bbox31 = OsmAnd::Utilities::tileBoundingBox31(tile.tileId, tile.zoom);
+                            for (const auto& obfReader : obfReaders)
+                            {
+                                for (const auto& routingSection : obfReader->obtainInfo()->routingSections)
+                                {
+                                    QList< std::shared_ptr<const OsmAnd::Road> > roads;
+                                    OsmAnd::ObfRoutingSectionReader::loadRoads(
+                                        obfReader,
+                                        routingSection,
+                                        OsmAnd::RoutingDataLevel::Detailed,
+                                        &bbox31,
+                                        &roads,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr,
+                                        pOutMetric ? &metric : nullptr);
+                                    roadsCount += roads.size();
+                                }
+                            }
+                        }
+                        if (pOutMetric)
+                            visitMetricFields(metric, *pOutMetric);
+                        return roadsCount;
+                    };
+                break;
+
+            case Case::EvaluateStyle:
+                // Evaluates same rulesets with same inputs as primitiviser does, but without building primitives
+                caseFunction =
+                    [this, &tilesMapObjects, mapPresentationEnvironment]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        const auto& env = mapPresentationEnvironment;
+                        const auto& builtinValueDefs = env->styleBuiltinValueDefs;
+                        OsmAnd::MapStyleEvaluationResult evaluationResult(env->mapStyle->getValueDefinitionsCount());
+                        unsigned int evaluationsCount = 0;
+                        unsigned int acceptedEvaluationsCount = 0;
+                        for (auto tileIndex = 0; tileIndex < configuration.tiles.size(); tileIndex++)
+                        {
+                            const auto& mapObjects = tilesMapObjects[tileIndex];
+                            if (!mapObjects)
+                                continue;
+
+                            const auto zoom = configuration.tiles[tileIndex].zoom;
+                            OsmAnd::MapStyleEvaluator orderEvaluator(env->mapStyle, env->displayDensityFactor * env->mapScaleFactor);
+                            env->applyTo(orderEvaluator);
+                            orderEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_MINZOOM, zoom);
+                            orderEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_MAXZOOM, zoom);
+                            OsmAnd::MapStyleEvaluator geometryEvaluator(env->mapStyle, env->displayDensityFactor * env->mapScaleFactor);
+                            env->applyTo(geometryEvaluator);
+                            geometryEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_MINZOOM, zoom);
+                            geometryEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_MAXZOOM, zoom);
+
+                            for (const auto& mapObject : OsmAnd::constOf(mapObjects->mapObjects))
+                            {
+                                const auto layerType = mapObject->getLayerType();
+                                orderEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_LAYER, static_cast<int>(layerType));
+                                orderEvaluator.setBooleanValue(builtinValueDefs->id_INPUT_AREA, mapObject->isArea);
+                                orderEvaluator.setBooleanValue(builtinValueDefs->id_INPUT_POINT, mapObject->points31.size() == 1);
+                                orderEvaluator.setBooleanValue(builtinValueDefs->id_INPUT_CYCLE, mapObject->isClosedFigure());
+                                geometryEvaluator.setIntegerValue(builtinValueDefs->id_INPUT_LAYER, static_cast<int>(layerType));
+
+                                const auto geometryRulesetType = mapObject->isArea
+                                    ? OsmAnd::MapStyleRulesetType::Polygon
+                                    : (mapObject->points31.size() == 1
+                                        ? OsmAnd::MapStyleRulesetType::Point
+                                        : OsmAnd::MapStyleRulesetType::Polyline);
+
+                                const auto& decodeMap = mapObject->attributeMapping->decodeMap;
+                                for (const auto attributeId : OsmAnd::constOf(mapObject->attributeIds))
+                                {
+                                    const auto& decodedAttribute = decodeMap[attributeId];
+
+                                    orderEvaluator.setStringValue(builtinValueDefs->id_INPUT_TAG, decodedAttribute.tag);
+                                    orderEvaluator.setStringValue(builtinValueDefs->id_INPUT_VALUE, decodedAttribute.value);
+                                    evaluationResult.clear();
+                                    if (orderEvaluator.evaluate(mapObject, OsmAnd::MapStyleRulesetType::Order, &evaluationResult))
+                                        acceptedEvaluationsCount++;
+
+                                    geometryEvaluator.setStringValue(builtinValueDefs->id_INPUT_TAG, decodedAttribute.tag);
+                                    geometryEvaluator.setStringValue(builtinValueDefs->id_INPUT_VALUE, decodedAttribute.value);
+                                    evaluationResult.clear();
+                                    if (geometryEvaluator.evaluate(mapObject, geometryRulesetType, &evaluationResult))
+                                        acceptedEvaluationsCount++;
+
+                                    evaluationsCount += 2;
+                                }
+                            }
+                        }
+                        if (pOutMetric)
+                        {
+                            pOutMetric->insert(QLatin1String("evaluations"), static_cast<double>(evaluationsCount));
+                            pOutMetric->insert(QLatin1String("acceptedEvaluations"), static_cast<double>(acceptedEvaluationsCount));
+                        }
+                        return evaluationsCount;
+                    };
+                break;
+
+            case Case::Primitivise:
+                caseFunction =
+                    [this, &tilesMapObjects, primitiviser, visitMetricFields]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        OsmAnd::MapPrimitiviser_Metrics::Metric_primitiviseAllMapObjects metric;
+                        unsigned int primitivesCount = 0;
+                        for (auto tileIndex = 0; tileIndex < configuration.tiles.size(); tileIndex++)
+                        {
+                            const auto& mapObjects = tilesMapObjects[tileIndex];
+                            if (!mapObjects)
+                                continue;
+
+                            const auto zoom = configuration.tiles[tileIndex].zoom;
+                            const auto primitivisedObjects = primitiviser->primitiviseAllMapObjects(
+                                OsmAnd::Utilities::getScaleDivisor31ToPixel(
+                                    OsmAnd::PointI(configuration.tileSize, configuration.tileSize),
+                                    zoom),
+                                zoom,
+                                mapObjects->mapObjects,
+                                nullptr,
+                                nullptr,
+                                pOutMetric ? &metric : nullptr);
+                            if (!primitivisedObjects)
+                                continue;
+                            primitivesCount +=
+                                primitivisedObjects->polygons.size() +
+                                primitivisedObjects->polylines.size() +
+                                primitivisedObjects->points.size();
+                        }
+                        if (pOutMetric)
+                            visitMetricFields(metric, *pOutMetric);
+                        return primitivesCount;
+                    };
+                break;
+
+            case Case::RasterizeMap:
+                caseFunction =
+                    [this, &tilesPrimitivisedObjects, rasterizer, visitMetricFields]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        OsmAnd::MapRasterizer_Metrics::Metric_rasterize metric;
+                        SkBitmap bitmap;
+                        if (!bitmap.tryAllocPixels(SkImageInfo::MakeN32Premul(configuration.tileSize, configuration.tileSize)))
+                            return 0;
+                        SkBitmapDevice rasterizationTarget(bitmap);
+                        SkCanvas canvas(&rasterizationTarget);
+
+                        unsigned int tilesCount = 0;
+                        for (auto tileIndex = 0; tileIndex < configuration.tiles.size(); tileIndex++)
+                        {
+                            const auto& primitivisedObjects = tilesPrimitivisedObjects[tileIndex];
+                            if (!primitivisedObjects)
+                                continue;
+
+                            const auto& tile = configuration.tiles[tileIndex];
+                            rasterizer->rasterize(
+                                OsmAnd::Utilities::tileBoundingBox31(tile.tileId, tile.zoom),
+                                primitivisedObjects,
+                                canvas,
+                                true,
+                                nullptr,
+                                pOutMetric ? &metric : nullptr);
+                            tilesCount++;
+                        }
+                        if (pOutMetric)
+                            visitMetricFields(metric, *pOutMetric);
+                        return tilesCount;
+                    };
+                break;
+
+            case Case::RasterizeText:
+                // Cache is not used, so that every iteration lays out and draws every caption
+                caseFunction =
+                    [this]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        const OsmAnd::TextRasterizer textRasterizer(OsmAnd::TextRasterizer::getDefault()->fontFinder);
+                        const auto style = OsmAnd::TextRasterizer::Style()
+                            .setSize(14.0f * configuration.displayDensityFactor * configuration.symbolsScale)
+                            .setHaloRadius(static_cast<unsigned int>(2.0f * configuration.displayDensityFactor))
+                            .setWrapWidth(20);
+                        unsigned int bitmapsCount = 0;
+                        uint64_t pixelsCount = 0;
+                        for (const auto& caption : configuration.captions)
+                        {
+                            const auto bitmap = textRasterizer.rasterize(caption, style);
+                            if (!bitmap)
+                                continue;
+                            bitmapsCount++;
+                            pixelsCount += static_cast<uint64_t>(bitmap->width()) * bitmap->height();
+                        }
+                        if (pOutMetric)
+                            pOutMetric->insert(QLatin1String("pixels"), static_cast<double>(pixelsCount));
+                        return bitmapsCount;
+                    };
+                break;
+
+            case Case::SearchAddresses:
+                caseFunction =
+                    [this]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        const OsmAnd::AddressesByNameSearch search(configuration.obfsCollection);
+                        unsigned int resultsCount = 0;
+                        for (const auto& query : configuration.addressQueries)
+                        {
+                            OsmAnd::AddressesByNameSearch::Criteria criteria;
+                            criteria.name = query;
+                            criteria.includeStreets = true;
+                            const auto results = search.performSearch(criteria);
+                            resultsCount += results.size();
+                            if (pOutMetric)
+                                pOutMetric->insert(query, results.size());
+                        }
+                        return resultsCount;
+                    };
+                break;
+
+            case Case::SearchAmenitiesByName:
+                caseFunction =
+                    [this]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        const OsmAnd::AmenitiesByNameSearch search(configuration.obfsCollection);
+                        unsigned int resultsCount = 0;
+                        for (const auto& query : configuration.amenityQueries)
+                        {
+                            OsmAnd::AmenitiesByNameSearch::Criteria criteria;
+                            criteria.name = query;
+                            unsigned int queryResultsCount = 0;
+                            search.performSearch(
+                                criteria,
+                                [&queryResultsCount]
+                                (const OsmAnd::ISearch::Criteria& criteria, const OsmAnd::ISearch::IResultEntry& resultEntry)
+                                {
+                                    queryResultsCount++;
+                                });
+                            resultsCount += queryResultsCount;
+                            if (pOutMetric)
+                                pOutMetric->insert(query, static_cast<double>(queryResultsCount));
+                        }
+                        return resultsCount;
+                    };
+                break;
+
+            case Case::SearchAmenitiesInArea:
+                caseFunction =
+                    [this]
+                    (QJsonObject* const pOutMetric) -> unsigned int
+                    {
+                        const OsmAnd::AmenitiesInAreaSearch search(configuration.obfsCollection);
+                        unsigned int resultsCount = 0;
+                        for (const auto& tile : configuration.tiles)
+                        {
+                            OsmAnd::AmenitiesInAreaSearch::Criteria criteria;
+                            criteria.bbox31 = OsmAnd::Nullable<OsmAnd::AreaI>(
+                                OsmAnd::Utilities::tileBoundingBox31(tile.tileId, tile.zoom));
+                            search.performSearch(
+                                criteria,
+                                [&resultsCount]
+                                (const OsmAnd::ISearch::Criteria& criteria, const OsmAnd::ISearch::IResultEntry& resultEntry)
+                                {
+                                    resultsCount++;
+                                });
+                        }
+                        return resultsCount;
+                    };
+                break;
+        }
+
+        // Registry is reset per case, so that its counters describe only this case
+        metricsRegistry.setEnabled(true);
+        metricsRegistry.reset();
+
+        QJsonObject caseObject;
+        if (!measure(output, caseId, caseFunction, caseObject))
+            success = false;
+        caseObject.insert(QLatin1String("registry"),
+            QJsonDocument::fromJson(metricsRegistry.exportSnapshot(OsmAnd::MetricsRegistry::ExportFormat::Json).toUtf8()).object());
+        casesArray.append(caseObject);
+
+        metricsRegistry.setEnabled(wasMetricsRegistryEnabled);
+    }
+    outResult.insert(QLatin1String("cases"), casesArray);
+
+    return success;
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::Benchmarker::run(std::wostream& output)
+#else
+bool OsmAndTools::Benchmarker::run(std::ostream& output)
+#endif
+{
+    QJsonObject result;
+    const auto success = run(output, result);
+
+    const auto resultData = QJsonDocument(result).toJson();
+    if (configuration.outputFilename.isEmpty())
+    {
+        output << QStringToStlString(QString::fromUtf8(resultData)) << std::endl;
+        return success;
+    }
+
+    QFile outputFile(configuration.outputFilename);
+    QFileInfo(outputFile).absoluteDir().mkpath(QLatin1String("."));
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        outputFile.write(resultData) != resultData.size())
+    {
+        output << xT("Failed to write results to '") << QStringToStlString(configuration.outputFilename) << xT("'") << std::endl;
+        return false;
+    }
+    outputFile.close();
+
+    return success;
+}
+
+bool OsmAndTools::Benchmarker::run(QString *pLog /*= nullptr*/)
+{
+    if (pLog != nullptr)
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        std::wostringstream output;
+        const bool success = run(output);
+        *pLog = QString::fromStdWString(output.str());
+        return success;
+#else
+        std::ostringstream output;
+        const bool success = run(output);
+        *pLog = QString::fromStdString(output.str());
+        return success;
+#endif
+    }
+    else
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        return run(std::wcout);
+#else
+        return run(std::cout);
+#endif
+    }
+}
+
+OsmAndTools::Benchmarker::Configuration::Configuration()
+    : styleName(QLatin1String("default"))
+    , displayDensityFactor(1.0f)
+    , mapScale(1.0f)
+    , symbolsScale(1.0f)
+    , locale(QLatin1String("en"))
+    , tileSize(256)
+    , captions(QStringList()
+        << QLatin1String("Main Street")
+        << QString::fromUtf8("Avenue des Champs-Élysées")
+        << QString::fromUtf8("Невский проспект")
+        << QString::fromUtf8("Ελευθερίου Βενιζέλου")
+        << QString::fromUtf8("שדרות רוטשילד")
+        << QString::fromUtf8("شارع الملك فهد")
+        << QString::fromUtf8("銀座中央通り")
+        << QString::fromUtf8("서울특별시청")
+        << QString::fromUtf8("ถนนสุขุมวิท")
+        << QString::fromUtf8("Gemeinschaftsgrundschule am Rheinufer"))
+    , cases(QList<Case>()
+        << Case::LoadMapObjects
+        << Case::LoadRoads
+        << Case::EvaluateStyle
+        << Case::Primitivise
+        << Case::RasterizeMap
+        << Case::RasterizeText
+        << Case::SearchAddresses
+        << Case::SearchAmenitiesByName
+        << Case::SearchAmenitiesInArea)
+    , warmUpIterations(1)
+    , iterations(5)
+    , verbose(false)
+{
+}
+
+bool OsmAndTools::Benchmarker::Configuration::parseFromCommandLineArguments(
+    const QStringList& commandLineArgs,
+    Configuration& outConfiguration,
+    QString& outError)
+{
+    outConfiguration = Configuration();
+
+    const std::shared_ptr<OsmAnd::ObfsCollection> obfsCollection(new OsmAnd::ObfsCollection());
+    outConfiguration.obfsCollection = obfsCollection;
+
+    const std::shared_ptr<OsmAnd::MapStylesCollection> stylesCollection(new OsmAnd::MapStylesCollection());
+    outConfiguration.stylesCollection = stylesCollection;
+
+    bool captionsSpecified = false;
+
+    const auto parseUInt =
+        [&outError]
+        (const QString& arg, const char* const name, unsigned int& outValue) -> bool
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(arg.indexOf(QLatin1Char('=')) + 1));
+            bool ok = false;
+            outValue = value.toUInt(&ok);
+            if (!ok)
+                outError = QString("'%1' can not be parsed as %2").arg(value).arg(QLatin1String(name));
+            return ok;
+        };
+
+    // Tile is given as "zoom/x/y", same as in tile URLs
+    const auto parseTile =
+        [&outError]
+        (const QString& value, Tile& outTile) -> bool
+        {
+            const auto components = value.trimmed().split(QLatin1Char('/'));
+            bool ok = (components.size() == 3);
+            unsigned int zoom = 0;
+            unsigned int x = 0;
+            unsigned int y = 0;
+            if (ok)
+                zoom = components[0].toUInt(&ok);
+            if (ok)
+                x = components[1].toUInt(&ok);
+            if (ok)
+                y = components[2].toUInt(&ok);
+            if (ok)
+                ok = (zoom <= OsmAnd::MaxZoomLevel) && (static_cast<uint64_t>(x) < (1ull << zoom)) && (static_cast<uint64_t>(y) < (1ull << zoom));
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as tile").arg(value);
+                return false;
+            }
+
+            outTile.tileId = OsmAnd::TileId::fromXY(x, y);
+            outTile.zoom = static_cast<OsmAnd::ZoomLevel>(zoom);
+            return true;
+        };
+
+    for (const auto& arg : commandLineArgs)
+    {
+        if (arg.startsWith(QLatin1String("-obfsPath=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfsPath=")));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addDirectory(value, false);
+        }
+        else if (arg.startsWith(QLatin1String("-obfFile=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfFile=")));
+            if (!QFile(value).exists())
+            {
+                outError = QString("'%1' file does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addFile(value);
+        }
+        else if (arg.startsWith(QLatin1String("-stylesPath=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-stylesPath=")));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            QFileInfoList styleFilesList;
+            OsmAnd::Utilities::findFiles(QDir(value), QStringList() << QLatin1String("*.render.xml"), styleFilesList, false);
+            for (const auto& styleFile : styleFilesList)
+                stylesCollection->addStyleFromFile(styleFile.absoluteFilePath());
+        }
+        else if (arg.startsWith(QLatin1String("-styleName=")))
+        {
+            outConfiguration.styleName = Utilities::purifyArgumentValue(arg.mid(strlen("-styleName=")));
+        }
+        else if (arg.startsWith(QLatin1String("-styleSetting:")))
+        {
+            const auto settingValue = arg.mid(strlen("-styleSetting:"));
+            const auto settingKeyValue = settingValue.split(QLatin1Char('='));
+            if (settingKeyValue.size() != 2)
+            {
+                outError = QString("'%1' can not be parsed as style settings key and value").arg(settingValue);
+                return false;
+            }
+
+            outConfiguration.styleSettings[settingKeyValue[0]] = Utilities::purifyArgumentValue(settingKeyValue[1]);
+        }
+        else if (arg.startsWith(QLatin1String("-tile=")))
+        {
+            Tile tile;
+            if (!parseTile(Utilities::purifyArgumentValue(arg.mid(strlen("-tile="))), tile))
+                return false;
+            outConfiguration.tiles.push_back(tile);
+        }
+        else if (arg.startsWith(QLatin1String("-tilesFile=")))
+        {
+            // One tile per line, so that tile set can be kept along with OBF extracts it was chosen for
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-tilesFile=")));
+            QFile tilesFile(value);
+            if (!tilesFile.open(QIODevice::ReadOnly | QIODevice::Text))
+            {
+                outError = QString("'%1' file can not be opened").arg(value);
+                return false;
+            }
+            const auto lines = QString::fromUtf8(tilesFile.readAll()).split(QLatin1Char('\n'), QString::SkipEmptyParts);
+            tilesFile.close();
+            for (const auto& line : lines)
+            {
+                if (line.trimmed().isEmpty() || line.trimmed().startsWith(QLatin1Char('#')))
+                    continue;
+
+                Tile tile;
+                if (!parseTile(line, tile))
+                    return false;
+                outConfiguration.tiles.push_back(tile);
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-tileSize=")))
+        {
+            if (!parseUInt(arg, "tile size", outConfiguration.tileSize))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-caption=")))
+        {
+            if (!captionsSpecified)
+                outConfiguration.captions.clear();
+            captionsSpecified = true;
+            outConfiguration.captions.push_back(Utilities::purifyArgumentValue(arg.mid(strlen("-caption="))));
+        }
+        else if (arg.startsWith(QLatin1String("-addressQuery=")))
+        {
+            outConfiguration.addressQueries.push_back(Utilities::purifyArgumentValue(arg.mid(strlen("-addressQuery="))));
+        }
+        else if (arg.startsWith(QLatin1String("-amenityQuery=")))
+        {
+            outConfiguration.amenityQueries.push_back(Utilities::purifyArgumentValue(arg.mid(strlen("-amenityQuery="))));
+        }
+        else if (arg.startsWith(QLatin1String("-cases=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-cases=")));
+
+            outConfiguration.cases.clear();
+            for (const auto& caseName : value.split(QLatin1Char(','), QString::SkipEmptyParts))
+            {
+                bool found = false;
+                for (auto caseIndex = static_cast<int>(Case::LoadMapObjects); caseIndex <= static_cast<int>(Case::SearchAmenitiesInArea); caseIndex++)
+                {
+                    const auto caseId = static_cast<Case>(caseIndex);
+                    if (caseName.compare(getCaseName(caseId), Qt::CaseInsensitive) != 0)
+                        continue;
+
+                    outConfiguration.cases.push_back(caseId);
+                    found = true;
+                    break;
+                }
+                if (!found)
+                {
+                    outError = QString("'%1' can not be parsed as benchmark case").arg(caseName);
+                    return false;
+                }
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-warmUpIterations=")))
+        {
+            if (!parseUInt(arg, "iterations count", outConfiguration.warmUpIterations))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-iterations=")))
+        {
+            if (!parseUInt(arg, "iterations count", outConfiguration.iterations))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-displayDensityFactor=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-displayDensityFactor=")));
+            bool ok = false;
+            outConfiguration.displayDensityFactor = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as display density factor").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-mapScale=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-mapScale=")));
+            bool ok = false;
+            outConfiguration.mapScale = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as map scale factor").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-symbolsScale=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-symbolsScale=")));
+            bool ok = false;
+            outConfiguration.symbolsScale = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as symbols scale factor").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-locale=")))
+        {
+            outConfiguration.locale = Utilities::purifyArgumentValue(arg.mid(strlen("-locale=")));
+        }
+        else if (arg.startsWith(QLatin1String("-output=")))
+        {
+            outConfiguration.outputFilename = Utilities::resolvePath(arg.mid(strlen("-output=")));
+        }
+        else if (arg.startsWith(QLatin1String("-label=")))
+        {
+            outConfiguration.label = Utilities::purifyArgumentValue(arg.mid(strlen("-label=")));
+        }
+        else if (arg == QLatin1String("-verbose"))
+        {
+            outConfiguration.verbose = true;
+        }
+        else
+        {
+            outError = QString("Unrecognized argument: '%1'").arg(arg);
+            return false;
+        }
+    }
+
+    // Validate
+    if (outConfiguration.styleName.isEmpty())
+    {
+        outError = QLatin1String("'styleName' can not be empty");
+        return false;
+    }
+    if (outConfiguration.tiles.isEmpty())
+    {
+        outError = QLatin1String("At least one 'tile' has to be specified");
+        return false;
+    }
+    if (outConfiguration.tileSize == 0)
+    {
+        outError = QLatin1String("'tileSize' can not be 0");
+        return false;
+    }
+    if (outConfiguration.iterations == 0)
+    {
+        outError = QLatin1String("'iterations' can not be 0");
+        return false;
+    }
+    if (outConfiguration.cases.isEmpty())
+    {
+        outError = QLatin1String("'cases' can not be empty");
+        return false;
+    }
+
+    return true;
+}
@@ -2,11 +2,15 @@
 
 #include <OsmAndCore/stdlib_common.h>
 #include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
+#include <numeric>
 #include <OsmAndCore/restore_internal_warnings.h>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/ObfsCollection.h>
+#include <OsmAndCore/Data/ObfFile.h>
 #include <OsmAndCore/Stopwatch.h>
 #include <OsmAndCore/Utilities.h>
 #include <OsmAndCore/CoreResourcesEmbeddedBundle.h>
@@ -19,6 +23,15 @@
 #include <OsmAndCore/Map/MapPrimitivesProvider.h>
 #include <OsmAndCore/Map/MapObjectsSymbolsProvider.h>
 #include <OsmAndCore/Map/MapRasterLayerProvider_Software.h>
+#include <OsmAndCore/Map/AtlasMapRenderer_Metrics.h>
+#include <OsmAndCore/MetricsRegistry.h>
+#include <OsmAndCore/MemoryManager_Metrics.h>
+
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QThread>
+#include <OsmAndCore/restore_internal_warnings.h>
 
 #include <OsmAndCore/ignore_warnings_on_external_includes.h>
 #if defined(OSMAND_TARGET_OS_windows)
@@ -957,40 +970,14 @@ bool OsmAndTools::EyePiece::rasterize(std::ostream& output)
         // Repeat processing and rendering until everything is complete
         if (configuration.verbose)
             output << xT("Rendering frames...") << std::endl;
-        OsmAnd::Stopwatch renderingStopwatch(true);
         auto framesCounter = 0u;
-        bool wasInterrupted = false;
-        for (;; framesCounter++)
-        {
-            // Update must be performed before each frame
-            if (!mapRenderer->update())
-                output << xT("Map renderer: update failed") << std::endl;
-
-            // If frame was prepared, it means there's something to render
-            if (mapRenderer->prepareFrame())
-            {
-                const auto ok = mapRenderer->renderFrame();
-                glVerifyResult(output);
-
-                if (!ok)
-                    output << xT("Map renderer: frame rendering failed") << std::endl;
-            }
-
-            // Send everything to GPU
-            glFlush();
-            glVerifyResult(output);
-
-            // Check if map renderer finished processing
-            if (mapRenderer->isIdle())
-                break;
-
-            if (renderingStopwatch.elapsed() > (10 * 60 /* 10 minutes */))
-            {
-                wasInterrupted = true;
-                break;
-            }
-        }
-        const auto timeElapsedOnRendering = renderingStopwatch.elapsed();
+        auto timeElapsedOnRendering = 0.0f;
+        const auto wasInterrupted = !renderUntilIdle(
+            output,
+            mapRenderer,
+            10 * 60 /* 10 minutes */,
+            framesCounter,
+            timeElapsedOnRendering);
         if (configuration.verbose)
             output << xT("Rendered ") << framesCounter << xT(" frames in ") << timeElapsedOnRendering << xT("s") << std::endl;
 
@@ -1003,6 +990,38 @@ bool OsmAndTools::EyePiece::rasterize(std::ostream& output)
             success = false;
         }
 
+        // Replay camera paths from settled initial state
+        if (success && configuration.benchmark)
+        {
+            QJsonObject benchmarkResult;
+            benchmarkResult.insert(QLatin1String("warmUpFrames"), static_cast<double>(framesCounter));
+            benchmarkResult.insert(QLatin1String("warmUpTime"), timeElapsedOnRendering);
+            if (!benchmark(output, mapRenderer, benchmarkResult))
+            {
+                success = false;
+            }
+            else
+            {
+                const auto benchmarkData = QJsonDocument(benchmarkResult).toJson();
+                if (configuration.benchmarkOutputFilename.isEmpty())
+                {
+                    output << QStringToStlString(QString::fromUtf8(benchmarkData)) << std::endl;
+                }
+                else
+                {
+                    QFile benchmarkFile(configuration.benchmarkOutputFilename);
+                    QFileInfo(benchmarkFile).absoluteDir().mkpath(QLatin1String("."));
+                    if (!benchmarkFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+                        benchmarkFile.write(benchmarkData) != benchmarkData.size())
+                    {
+                        output << xT("Failed to write benchmark results to '") << QStringToStlString(configuration.benchmarkOutputFilename) << xT("'") << std::endl;
+                        success = false;
+                    }
+                    benchmarkFile.close();
+                }
+            }
+        }
+
         // Wait until everything is ready on GPU
         if (configuration.verbose)
             output << xT("Waiting for GPU to complete all stuff requested...") << std::endl;
@@ -1142,6 +1161,371 @@ bool OsmAndTools::EyePiece::rasterize(std::ostream& output)
     return success;
 }
 
+OsmAndTools::EyePiece::BenchmarkCameraState OsmAndTools::EyePiece::getBenchmarkCameraState(
+    const BenchmarkScenario scenario,
+    const float t,
+    const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer) const
+{
+    BenchmarkCameraState state;
+    state.target31 = configuration.target31;
+    state.zoom = configuration.zoom;
+    state.azimuth = configuration.azimuth;
+    state.elevationAngle = configuration.elevationAngle;
+
+    // Distances are measured in tiles of initial zoom, so that paths cover same part of screen on any zoom
+    const auto tileSize31 = std::pow(2.0, static_cast<double>(OsmAnd::ZoomLevel31) - configuration.zoom);
+    auto offsetInTiles = OsmAnd::PointD(0.0, 0.0);
+    switch (scenario)
+    {
+        case BenchmarkScenario::Pan:
+            // Steady pan to the east
+            offsetInTiles.x = 4.0 * t;
+            break;
+
+        case BenchmarkScenario::Fling:
+            // Diagonal pan that decelerates till full stop
+            offsetInTiles.x = 8.0 * (1.0 - (1.0 - t) * (1.0 - t));
+            offsetInTiles.y = offsetInTiles.x * 0.5;
+            break;
+
+        case BenchmarkScenario::ZoomSweep:
+            // Zoom out, back in past initial zoom and back again
+            state.zoom = configuration.zoom - 3.0f * std::sin(2.0f * static_cast<float>(M_PI) * t);
+            break;
+
+        case BenchmarkScenario::FlyTo:
+        {
+            // Eased move to distant destination, zooming out midway and turning the map
+            const auto s = t * t * (3.0f - 2.0f * t);
+            offsetInTiles.x = 32.0 * s;
+            offsetInTiles.y = 32.0 * s;
+            state.zoom = configuration.zoom - 4.0f * std::sin(static_cast<float>(M_PI) * t);
+            state.azimuth = configuration.azimuth + 45.0f * s;
+            break;
+        }
+    }
+
+    state.zoom = qBound(
+        static_cast<float>(mapRenderer->getMinZoomLevel()),
+        state.zoom,
+        static_cast<float>(mapRenderer->getMaxZoomLevel()));
+    state.target31 = OsmAnd::Utilities::normalizeCoordinates(
+        OsmAnd::PointI64(
+            static_cast<int64_t>(configuration.target31.x) + static_cast<int64_t>(offsetInTiles.x * tileSize31),
+            static_cast<int64_t>(configuration.target31.y) + static_cast<int64_t>(offsetInTiles.y * tileSize31)),
+        OsmAnd::ZoomLevel31);
+
+    return state;
+}
+
+void OsmAndTools::EyePiece::applyBenchmarkCameraState(
+    const BenchmarkCameraState& state,
+    const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer) const
+{
+    mapRenderer->setTarget(state.target31);
+    mapRenderer->setZoom(state.zoom);
+    mapRenderer->setAzimuth(state.azimuth);
+    mapRenderer->setElevationAngle(state.elevationAngle);
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::EyePiece::renderUntilIdle(
+    std::wostream& output,
+#else
+bool OsmAndTools::EyePiece::renderUntilIdle(
+    std::ostream& output,
+#endif
+    const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer,
+    const float timeout,
+    unsigned int& outFramesCount,
+    float& outTimeElapsed) const
+{
+    OsmAnd::Stopwatch renderingStopwatch(true);
+    bool isIdle = false;
+    for (outFramesCount = 0u; !isIdle; outFramesCount++)
+    {
+        // Update must be performed before each frame
+        if (!mapRenderer->update())
+            output << xT("Map renderer: update failed") << std::endl;
+
+        // If frame was prepared, it means there's something to render
+        if (mapRenderer->prepareFrame())
+        {
+            const auto ok = mapRenderer->renderFrame();
+            glVerifyResult(output);
+
+            if (!ok)
+                output << xT("Map renderer: frame rendering failed") << std::endl;
+        }
+
+        // Send everything to GPU
+        glFlush();
+        glVerifyResult(output);
+
+        // Check if map renderer finished processing
+        isIdle = mapRenderer->isIdle();
+
+        if (!isIdle && renderingStopwatch.elapsed() > timeout)
+            break;
+    }
+    outTimeElapsed = renderingStopwatch.elapsed();
+
+    return isIdle;
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::EyePiece::benchmark(
+    std::wostream& output,
+#else
+bool OsmAndTools::EyePiece::benchmark(
+    std::ostream& output,
+#endif
+    const std::shared_ptr<OsmAnd::IMapRenderer>& mapRenderer,
+    QJsonObject& outResult) const
+{
+    const auto visitMetricFields =
+        [](const OsmAnd::Metric& metric, QJsonObject& outObject)
+        {
+            metric.visitFields(
+                [&outObject]
+                (const char* const name, const double value, const char* const measurement, const bool isFractional)
+                {
+                    outObject.insert(QLatin1String(name), value);
+                });
+        };
+
+    // Results have to be comparable between builds, so everything that defines workload is written along
+    QJsonObject configurationObject;
+    configurationObject.insert(QLatin1String("styleName"), configuration.styleName);
+    configurationObject.insert(QLatin1String("width"), static_cast<double>(configuration.outputImageWidth));
+    configurationObject.insert(QLatin1String("height"), static_cast<double>(configuration.outputImageHeight));
+    configurationObject.insert(QLatin1String("target31"), QJsonArray() << configuration.target31.x << configuration.target31.y);
+    configurationObject.insert(QLatin1String("zoom"), configuration.zoom);
+    configurationObject.insert(QLatin1String("azimuth"), configuration.azimuth);
+    configurationObject.insert(QLatin1String("elevationAngle"), configuration.elevationAngle);
+    configurationObject.insert(QLatin1String("fov"), configuration.fov);
+    configurationObject.insert(QLatin1String("referenceTileSize"), static_cast<double>(configuration.referenceTileSize));
+    configurationObject.insert(QLatin1String("displayDensityFactor"), configuration.displayDensityFactor);
+    configurationObject.insert(QLatin1String("framesPerScenario"), static_cast<double>(configuration.benchmarkFramesPerScenario));
+    configurationObject.insert(QLatin1String("frameDuration"), configuration.benchmarkFrameDuration);
+    QJsonArray obfFilesArray;
+    for (const auto& obfFile : configuration.obfsCollection->getObfFiles())
+        obfFilesArray.append(QFileInfo(obfFile->filePath).fileName());
+    configurationObject.insert(QLatin1String("obfFiles"), obfFilesArray);
+    outResult.insert(QLatin1String("label"), configuration.benchmarkLabel);
+    outResult.insert(QLatin1String("configuration"), configurationObject);
+
+    QJsonObject openGLObject;
+    openGLObject.insert(QLatin1String("vendor"), QString::fromLatin1(reinterpret_cast<const char*>(glGetString(GL_VENDOR))));
+    openGLObject.insert(QLatin1String("renderer"), QString::fromLatin1(reinterpret_cast<const char*>(glGetString(GL_RENDERER))));
+    openGLObject.insert(QLatin1String("version"), QString::fromLatin1(reinterpret_cast<const char*>(glGetString(GL_VERSION))));
+    outResult.insert(QLatin1String("openGL"), openGLObject);
+
+    auto& metricsRegistry = OsmAnd::MetricsRegistry::getDefault();
+    const auto wasMetricsRegistryEnabled = metricsRegistry.isEnabled();
+    metricsRegistry.setEnabled(true);
+
+    bool success = true;
+    QJsonArray scenariosArray;
+    for (const auto scenario : configuration.benchmarkScenarios)
+    {
+        QString scenarioName;
+        switch (scenario)
+        {
+            case BenchmarkScenario::Pan:
+                scenarioName = QLatin1String("pan");
+                break;
+            case BenchmarkScenario::Fling:
+                scenarioName = QLatin1String("fling");
+                break;
+            case BenchmarkScenario::ZoomSweep:
+                scenarioName = QLatin1String("zoomSweep");
+                break;
+            case BenchmarkScenario::FlyTo:
+                scenarioName = QLatin1String("flyTo");
+                break;
+        }
+        if (configuration.verbose)
+            output << xT("Replaying '") << QStringToStlString(scenarioName) << xT("' camera path...") << std::endl;
+
+        // Each scenario starts from settled initial state
+        applyBenchmarkCameraState(getBenchmarkCameraState(scenario, 0.0f, mapRenderer), mapRenderer);
+        unsigned int settleFramesCount = 0;
+        float settleTime = 0.0f;
+        if (!renderUntilIdle(output, mapRenderer, configuration.benchmarkSettleTimeout, settleFramesCount, settleTime))
+        {
+            output << xT("Map renderer did not settle before '") << QStringToStlString(scenarioName) << xT("': ")
+                << QStringToStlString(mapRenderer->getNotIdleReason()) << std::endl;
+        }
+        metricsRegistry.reset();
+        // Memory peaks are reported per scenario, so ones reached before it are dropped
+        OsmAnd::getMemoryManager()->resetPeaks();
+
+        QJsonArray framesArray;
+        QVector<float> frameTimes;
+        frameTimes.reserve(configuration.benchmarkFramesPerScenario);
+        auto notIdleFramesCount = 0u;
+        OsmAnd::Stopwatch scenarioStopwatch(true);
+        for (auto frameIndex = 0u; frameIndex < configuration.benchmarkFramesPerScenario; frameIndex++)
+        {
+            const auto t = configuration.benchmarkFramesPerScenario > 1
+                ? static_cast<float>(frameIndex) / static_cast<float>(configuration.benchmarkFramesPerScenario - 1)
+                : 1.0f;
+            applyBenchmarkCameraState(getBenchmarkCameraState(scenario, t, mapRenderer), mapRenderer);
+
+            OsmAnd::IMapRenderer_Metrics::Metric_update updateMetric;
+            OsmAnd::IMapRenderer_Metrics::Metric_prepareFrame prepareFrameMetric;
+            OsmAnd::AtlasMapRenderer_Metrics::Metric_renderFrame renderFrameMetric;
+            OsmAnd::Stopwatch frameStopwatch(true);
+
+            if (!mapRenderer->update(&updateMetric))
+                output << xT("Map renderer: update failed") << std::endl;
+            const auto frameWasPrepared = mapRenderer->prepareFrame(&prepareFrameMetric);
+            if (frameWasPrepared)
+            {
+                const auto ok = mapRenderer->renderFrame(&renderFrameMetric);
+                glVerifyResult(output);
+
+                if (!ok)
+                    output << xT("Map renderer: frame rendering failed") << std::endl;
+            }
+
+            // Wait for GPU, so that frame time includes all work of the frame
+            glFinish();
+            glVerifyResult(output);
+            const auto frameTime = frameStopwatch.elapsed();
+            frameTimes.push_back(frameTime);
+
+            const auto isIdle = mapRenderer->isIdle();
+            if (!isIdle)
+                notIdleFramesCount++;
+
+            QJsonObject frameObject;
+            frameObject.insert(QLatin1String("time"), frameTime);
+            frameObject.insert(QLatin1String("rendered"), frameWasPrepared);
+            frameObject.insert(QLatin1String("idle"), isIdle);
+            frameObject.insert(QLatin1String("symbols"), static_cast<double>(mapRenderer->getSymbolsCount()));
+            frameObject.insert(QLatin1String("activeResourceRequests"), static_cast<double>(mapRenderer->getActiveResourceRequestsCount()));
+            QJsonObject updateObject;
+            visitMetricFields(updateMetric, updateObject);
+            frameObject.insert(QLatin1String("update"), updateObject);
+            QJsonObject prepareFrameObject;
+            visitMetricFields(prepareFrameMetric, prepareFrameObject);
+            frameObject.insert(QLatin1String("prepareFrame"), prepareFrameObject);
+            if (frameWasPrepared)
+            {
+                QJsonObject renderFrameObject;
+                visitMetricFields(renderFrameMetric, renderFrameObject);
+                frameObject.insert(QLatin1String("renderFrame"), renderFrameObject);
+            }
+            framesArray.append(frameObject);
+
+            // Camera moves by frame index; sleep only paces frames, so background workers get same time per frame in any build
+            const auto timeLeft = configuration.benchmarkFrameDuration - frameStopwatch.elapsed();
+            if (timeLeft > 0.0f)
+                QThread::usleep(static_cast<unsigned long>(timeLeft * 1000000.0f));
+        }
+        const auto motionTime = scenarioStopwatch.elapsed();
+
+        // Time after motion has stopped till everything is shown is the tile readiness latency
+        unsigned int readinessFramesCount = 0;
+        float readinessTime = 0.0f;
+        const auto becameReady = renderUntilIdle(
+            output,
+            mapRenderer,
+            configuration.benchmarkSettleTimeout,
+            readinessFramesCount,
+            readinessTime);
+        if (!becameReady)
+        {
+            output << xT("Map renderer did not settle after '") << QStringToStlString(scenarioName) << xT("': ")
+                << QStringToStlString(mapRenderer->getNotIdleReason()) << std::endl;
+            success = false;
+        }
+
+        QJsonObject summaryObject;
+        auto sortedFrameTimes = frameTimes;
+        std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+        const auto getFrameTimeQuantile =
+            [&sortedFrameTimes]
+            (const double quantile) -> double
+            {
+                if (sortedFrameTimes.isEmpty())
+                    return 0.0;
+                const auto index = qMin(
+                    static_cast<int>(quantile * sortedFrameTimes.size()),
+                    sortedFrameTimes.size() - 1);
+                return sortedFrameTimes[index];
+            };
+        summaryObject.insert(QLatin1String("frames"), frameTimes.size());
+        summaryObject.insert(QLatin1String("motionTime"), motionTime);
+        summaryObject.insert(QLatin1String("frameTimeMean"), frameTimes.isEmpty()
+            ? 0.0
+            : std::accumulate(frameTimes.cbegin(), frameTimes.cend(), 0.0) / frameTimes.size());
+        summaryObject.insert(QLatin1String("frameTimeP50"), getFrameTimeQuantile(0.5));
+        summaryObject.insert(QLatin1String("frameTimeP90"), getFrameTimeQuantile(0.9));
+        summaryObject.insert(QLatin1String("frameTimeP99"), getFrameTimeQuantile(0.99));
+        summaryObject.insert(QLatin1String("frameTimeMax"), sortedFrameTimes.isEmpty() ? 0.0 : sortedFrameTimes.last());
+        summaryObject.insert(QLatin1String("slowFrames"), static_cast<double>(std::count_if(
+            frameTimes.cbegin(),
+            frameTimes.cend(),
+            [this]
+            (const float frameTime) -> bool
+            {
+                return frameTime > configuration.benchmarkFrameDuration;
+            })));
+        summaryObject.insert(QLatin1String("notIdleFrames"), static_cast<double>(notIdleFramesCount));
+        summaryObject.insert(QLatin1String("readinessTime"), readinessTime);
+        summaryObject.insert(QLatin1String("readinessFrames"), static_cast<double>(readinessFramesCount));
+        summaryObject.insert(QLatin1String("becameReady"), becameReady);
+
+        OsmAnd::MemoryManager_Metrics::Metric_memoryUsage memoryUsageMetric;
+        memoryUsageMetric.capture();
+        QJsonObject memoryObject;
+        visitMetricFields(memoryUsageMetric, memoryObject);
+        QJsonObject memoryTagsObject;
+        for (const auto& tagStatistics : OsmAnd::constOf(memoryUsageMetric.tags))
+        {
+            QJsonObject memoryTagObject;
+            memoryTagObject.insert(QLatin1String("liveBytes"), static_cast<double>(tagStatistics.liveBytes));
+            memoryTagObject.insert(QLatin1String("peakBytes"), static_cast<double>(tagStatistics.peakBytes));
+            memoryTagObject.insert(QLatin1String("allocationsCount"), static_cast<double>(tagStatistics.allocationsCount));
+            memoryTagsObject.insert(tagStatistics.tag, memoryTagObject);
+        }
+        memoryObject.insert(QLatin1String("tags"), memoryTagsObject);
+
+        QJsonObject scenarioObject;
+        scenarioObject.insert(QLatin1String("name"), scenarioName);
+        scenarioObject.insert(QLatin1String("summary"), summaryObject);
+        scenarioObject.insert(QLatin1String("memory"), memoryObject);
+        scenarioObject.insert(QLatin1String("registry"),
+            QJsonDocument::fromJson(metricsRegistry.exportSnapshot(OsmAnd::MetricsRegistry::ExportFormat::Json).toUtf8()).object());
+        scenarioObject.insert(QLatin1String("frames"), framesArray);
+        scenariosArray.append(scenarioObject);
+
+        if (configuration.verbose)
+        {
+            output
+                << xT("'") << QStringToStlString(scenarioName) << xT("': ")
+                << frameTimes.size() << xT(" frames, p50 ")
+                << getFrameTimeQuantile(0.5) << xT("s, p99 ")
+                << getFrameTimeQuantile(0.99) << xT("s, ready ")
+                << readinessTime << xT("s after motion") << std::endl;
+        }
+    }
+    outResult.insert(QLatin1String("scenarios"), scenariosArray);
+
+    // Return to configured camera, so that output image is same as without benchmark
+    applyBenchmarkCameraState(getBenchmarkCameraState(BenchmarkScenario::Pan, 0.0f, mapRenderer), mapRenderer);
+    unsigned int restoreFramesCount = 0;
+    float restoreTime = 0.0f;
+    renderUntilIdle(output, mapRenderer, configuration.benchmarkSettleTimeout, restoreFramesCount, restoreTime);
+
+    metricsRegistry.setEnabled(wasMetricsRegistryEnabled);
+
+    return success;
+}
+
 bool OsmAndTools::EyePiece::rasterize(QString *pLog /*= nullptr*/)
 {
     if (pLog != nullptr)
@@ -1186,6 +1570,15 @@ OsmAndTools::EyePiece::Configuration::Configuration()
 #if defined(OSMAND_TARGET_OS_linux)
     , useLegacyContext(false)
 #endif
+    , benchmark(false)
+    , benchmarkScenarios(QList<BenchmarkScenario>()
+        << BenchmarkScenario::Pan
+        << BenchmarkScenario::Fling
+        << BenchmarkScenario::ZoomSweep
+        << BenchmarkScenario::FlyTo)
+    , benchmarkFramesPerScenario(120)
+    , benchmarkFrameDuration(1.0f / 60.0f)
+    , benchmarkSettleTimeout(60.0f)
 {
 }
 
@@ -1488,6 +1881,76 @@ bool OsmAndTools::EyePiece::Configuration::parseFromCommandLineArguments(
             outConfiguration.useLegacyContext = true;
         }
 #endif
+        else if (arg == QLatin1String("-benchmark"))
+        {
+            outConfiguration.benchmark = true;
+        }
+        else if (arg.startsWith(QLatin1String("-benchmarkScenarios=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-benchmarkScenarios=")));
+
+            outConfiguration.benchmarkScenarios.clear();
+            for (const auto& scenarioName : value.split(QLatin1Char(','), QString::SkipEmptyParts))
+            {
+                if (scenarioName.compare(QLatin1String("pan"), Qt::CaseInsensitive) == 0)
+                    outConfiguration.benchmarkScenarios.push_back(BenchmarkScenario::Pan);
+                else if (scenarioName.compare(QLatin1String("fling"), Qt::CaseInsensitive) == 0)
+                    outConfiguration.benchmarkScenarios.push_back(BenchmarkScenario::Fling);
+                else if (scenarioName.compare(QLatin1String("zoomSweep"), Qt::CaseInsensitive) == 0)
+                    outConfiguration.benchmarkScenarios.push_back(BenchmarkScenario::ZoomSweep);
+                else if (scenarioName.compare(QLatin1String("flyTo"), Qt::CaseInsensitive) == 0)
+                    outConfiguration.benchmarkScenarios.push_back(BenchmarkScenario::FlyTo);
+                else
+                {
+                    outError = QString("'%1' can not be parsed as benchmark scenario").arg(scenarioName);
+                    return false;
+                }
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-benchmarkFrames=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-benchmarkFrames=")));
+
+            bool ok = false;
+            outConfiguration.benchmarkFramesPerScenario = value.toUInt(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as benchmark frames count").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-benchmarkFrameDuration=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-benchmarkFrameDuration=")));
+
+            bool ok = false;
+            outConfiguration.benchmarkFrameDuration = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as benchmark frame duration").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-benchmarkSettleTimeout=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-benchmarkSettleTimeout=")));
+
+            bool ok = false;
+            outConfiguration.benchmarkSettleTimeout = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as benchmark settle timeout").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-benchmarkOutput=")))
+        {
+            outConfiguration.benchmarkOutputFilename = Utilities::resolvePath(arg.mid(strlen("-benchmarkOutput=")));
+        }
+        else if (arg.startsWith(QLatin1String("-benchmarkLabel=")))
+        {
+            outConfiguration.benchmarkLabel = Utilities::purifyArgumentValue(arg.mid(strlen("-benchmarkLabel=")));
+        }
         else
         {
             outError = QString("Unrecognized argument: '%1'").arg(arg);
@@ -1511,6 +1974,11 @@ bool OsmAndTools::EyePiece::Configuration::parseFromCommandLineArguments(
         outError = QLatin1String("'outputImageHeight' can not be 0");
         return false;
     }
+    if (outConfiguration.benchmark && outConfiguration.benchmarkScenarios.isEmpty())
+    {
+        outError = QLatin1String("'benchmarkScenarios' can not be empty");
+        return false;
+    }
 
     return true;
 }
@@ -0,0 +1,175 @@
+#include "HeightmapConverter.h"
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/Stopwatch.h>
+#include <OsmAndCore/Map/HeightmapTileProvider.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QDir>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCoreTools.h>
+#include <OsmAndCoreTools/Utilities.h>
+
+OsmAndTools::HeightmapConverter::HeightmapConverter(const Configuration& configuration_)
+    : configuration(configuration_)
+{
+}
+
+OsmAndTools::HeightmapConverter::~HeightmapConverter()
+{
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::HeightmapConverter::convert(std::wostream& output)
+#else
+bool OsmAndTools::HeightmapConverter::convert(std::ostream& output)
+#endif
+{
+    const OsmAnd::Stopwatch stopwatch(true);
+
+    if (configuration.verbose)
+    {
+        output
+            << xT("Converting TileDB '")
+            << QStringToStlString(configuration.tileDbPath)
+            << xT("' to '")
+            << QStringToStlString(configuration.outputFilename)
+            << xT("'...") << std::endl;
+    }
+
+    OsmAnd::HeightmapTileProvider tileDbProvider(configuration.tileDbPath, configuration.indexFilename);
+    unsigned int tilesCount = 0;
+    const auto success = tileDbProvider.convertToHeightmapPyramid(
+        configuration.outputFilename,
+        configuration.sampleType,
+        &tilesCount);
+    if (!success)
+    {
+        output << xT("Conversion failed") << std::endl;
+        return false;
+    }
+
+    // Reopen result to make sure it's readable
+    const OsmAnd::HeightmapPyramid pyramid(configuration.outputFilename);
+    if (!pyramid.isOpened())
+    {
+        output << xT("Failed to open converted heightmap pyramid") << std::endl;
+        return false;
+    }
+
+    output
+        << xT("Converted ")
+        << tilesCount
+        << xT(" tiles of zooms ")
+        << pyramid.getMinZoom()
+        << xT("-")
+        << pyramid.getMaxZoom()
+        << xT(" in ")
+        << stopwatch.elapsed()
+        << xT("s") << std::endl;
+
+    return true;
+}
+
+bool OsmAndTools::HeightmapConverter::convert(QString *pLog /*= nullptr*/)
+{
+    if (pLog != nullptr)
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        std::wostringstream output;
+        const bool success = convert(output);
+        *pLog = QString::fromStdWString(output.str());
+        return success;
+#else
+        std::ostringstream output;
+        const bool success = convert(output);
+        *pLog = QString::fromStdString(output.str());
+        return success;
+#endif
+    }
+    else
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        return convert(std::wcout);
+#else
+        return convert(std::cout);
+#endif
+    }
+}
+
+OsmAndTools::HeightmapConverter::Configuration::Configuration()
+    : sampleType(OsmAnd::HeightmapPyramid::SampleType::Float32)
+    , verbose(false)
+{
+}
+
+bool OsmAndTools::HeightmapConverter::Configuration::parseFromCommandLineArguments(
+    const QStringList& commandLineArgs,
+    Configuration& outConfiguration,
+    QString& outError)
+{
+    outConfiguration = Configuration();
+
+    for (const auto& arg : commandLineArgs)
+    {
+        if (arg.startsWith(QLatin1String("-tileDbPath=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-tileDbPath=")));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            outConfiguration.tileDbPath = value;
+        }
+        else if (arg.startsWith(QLatin1String("-indexFile=")))
+        {
+            outConfiguration.indexFilename = Utilities::resolvePath(arg.mid(strlen("-indexFile=")));
+        }
+        else if (arg.startsWith(QLatin1String("-output=")))
+        {
+            outConfiguration.outputFilename = Utilities::resolvePath(arg.mid(strlen("-output=")));
+        }
+        else if (arg.startsWith(QLatin1String("-sampleType=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-sampleType=")));
+            if (value.compare(QLatin1String("int16"), Qt::CaseInsensitive) == 0)
+                outConfiguration.sampleType = OsmAnd::HeightmapPyramid::SampleType::Int16;
+            else if (value.compare(QLatin1String("float32"), Qt::CaseInsensitive) == 0)
+                outConfiguration.sampleType = OsmAnd::HeightmapPyramid::SampleType::Float32;
+            else
+            {
+                outError = QString("'%1' can not be parsed as sample type").arg(value);
+                return false;
+            }
+        }
+        else if (arg == QLatin1String("-verbose"))
+        {
+            outConfiguration.verbose = true;
+        }
+        else
+        {
+            outError = QString("Unrecognized argument: '%1'").arg(arg);
+            return false;
+        }
+    }
+
+    // Validate
+    if (outConfiguration.tileDbPath.isEmpty())
+    {
+        outError = QLatin1String("'tileDbPath' has to be specified");
+        return false;
+    }
+    if (outConfiguration.outputFilename.isEmpty())
+    {
+        outError = QLatin1String("'output' can not be empty");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,526 @@
+#include "MvtExporter.h"
+
+#include <OsmAndCore/stdlib_common.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <atomic>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/IMemoryManager.h>
+#include <OsmAndCore/ObfsCollection.h>
+#include <OsmAndCore/Stopwatch.h>
+#include <OsmAndCore/Utilities.h>
+#include <OsmAndCore/QRunnableFunctor.h>
+#include <OsmAndCore/Concurrent/WorkerPool.h>
+#include <OsmAndCore/Map/MapStylesCollection.h>
+#include <OsmAndCore/Map/MapPresentationEnvironment.h>
+#include <OsmAndCore/Map/MapPrimitiviser.h>
+#include <OsmAndCore/Map/MapPrimitivesProvider.h>
+#include <OsmAndCore/Map/ObfMapObjectsProvider.h>
+#include <OsmAndCore/Map/MapRasterTilesBatchRenderer.h>
+#include <OsmAndCore/Map/MvtTileProvider.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <QThread>
+#include <QAtomicInt>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCoreTools.h>
+#include <OsmAndCoreTools/Utilities.h>
+
+OsmAndTools::MvtExporter::MvtExporter(const Configuration& configuration_)
+    : configuration(configuration_)
+{
+}
+
+OsmAndTools::MvtExporter::~MvtExporter()
+{
+}
+
+bool OsmAndTools::MvtExporter::writeTile(
+    const OsmAnd::TileId tileId,
+    const OsmAnd::ZoomLevel zoom,
+    const QByteArray& encodedTile) const
+{
+    const QDir tileDir(QString(QLatin1String("%1/%2/%3"))
+        .arg(configuration.outputPath)
+        .arg(static_cast<int>(zoom))
+        .arg(tileId.x));
+    if (!tileDir.mkpath(QLatin1String(".")))
+        return false;
+
+    QFile tileFile(tileDir.absoluteFilePath(QString(QLatin1String("%1.mvt")).arg(tileId.y)));
+    if (!tileFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    const auto ok = (tileFile.write(encodedTile) == encodedTile.size());
+    tileFile.close();
+
+    return ok;
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::MvtExporter::exportTiles(std::wostream& output)
+#else
+bool OsmAndTools::MvtExporter::exportTiles(std::ostream& output)
+#endif
+{
+    // Find style
+    if (configuration.verbose)
+        output << xT("Resolving style '") << QStringToStlString(configuration.styleName) << xT("'...") << std::endl;
+    const auto mapStyle = configuration.stylesCollection->getResolvedStyleByName(configuration.styleName);
+    if (!mapStyle)
+    {
+        output << "Failed to resolve style '" << QStringToStlString(configuration.styleName) << "' from collection" << std::endl;
+        return false;
+    }
+
+    // Style still decides which objects are visible on which zoom, only drawing is left to client
+    const std::shared_ptr<OsmAnd::MapPresentationEnvironment> mapPresentationEnvironment(new OsmAnd::MapPresentationEnvironment(
+        mapStyle,
+        configuration.displayDensityFactor,
+        configuration.mapScale,
+        configuration.symbolsScale,
+        configuration.locale));
+    mapPresentationEnvironment->setSettings(configuration.styleSettings);
+
+    const std::shared_ptr<OsmAnd::MapPrimitiviser> primitiviser(new OsmAnd::MapPrimitiviser(
+        mapPresentationEnvironment));
+    const std::shared_ptr<OsmAnd::ObfMapObjectsProvider> mapObjectsProvider(new OsmAnd::ObfMapObjectsProvider(
+        configuration.obfsCollection));
+    const std::shared_ptr<OsmAnd::MapPrimitivesProvider> primitivesProvider(new OsmAnd::MapPrimitivesProvider(
+        mapObjectsProvider,
+        primitiviser,
+        configuration.tileSize));
+    const std::shared_ptr<OsmAnd::MvtTileProvider> mvtTileProvider(new OsmAnd::MvtTileProvider(
+        primitivesProvider,
+        configuration.mvtConfiguration));
+
+    if (!QDir(configuration.outputPath).mkpath(QLatin1String(".")))
+    {
+        output << xT("Failed to create output directory '") << QStringToStlString(configuration.outputPath) << xT("'") << std::endl;
+        return false;
+    }
+
+    // Neighbouring tiles share most of map objects, so within each zoom tiles are handed out in Hilbert order
+    QVector<OsmAnd::TileId> tilesIds;
+    QVector<OsmAnd::ZoomLevel> tilesZooms;
+    for (auto zoom = configuration.minZoom; zoom <= configuration.maxZoom; zoom = static_cast<OsmAnd::ZoomLevel>(zoom + 1))
+    {
+        const auto zoomTilesIds = OsmAnd::MapRasterTilesBatchRenderer::enumerateTilesInHilbertOrder(configuration.bbox31, zoom);
+        tilesIds += zoomTilesIds;
+        tilesZooms += QVector<OsmAnd::ZoomLevel>(zoomTilesIds.size(), zoom);
+
+        if (configuration.verbose)
+            output << xT("Zoom ") << zoom << xT(": ") << zoomTilesIds.size() << xT(" tile(s)") << std::endl;
+    }
+
+    const auto threadsCount = qMax(1u, qMin(configuration.threadsCount, static_cast<unsigned int>(tilesIds.size())));
+    if (configuration.verbose)
+    {
+        output
+            << xT("Exporting ")
+            << tilesIds.size()
+            << xT(" tile(s) on ")
+            << threadsCount
+            << xT(" thread(s) to '")
+            << QStringToStlString(configuration.outputPath)
+            << xT("'...") << std::endl;
+    }
+
+    QAtomicInt nextTileIdx(0);
+    std::atomic<unsigned int> writtenTilesCount(0);
+    std::atomic<unsigned int> emptyTilesCount(0);
+    std::atomic<unsigned int> failedTilesCount(0);
+    std::atomic<unsigned int> featuresCount(0);
+    std::atomic<unsigned long long> writtenBytesCount(0);
+    const auto worker =
+        [this, &tilesIds, &tilesZooms, &mvtTileProvider, &nextTileIdx, &writtenTilesCount, &emptyTilesCount,
+            &failedTilesCount, &featuresCount, &writtenBytesCount]
+        ()
+        {
+            for (auto tileIdx = nextTileIdx.fetchAndAddOrdered(1);
+                tileIdx < tilesIds.size();
+                tileIdx = nextTileIdx.fetchAndAddOrdered(1))
+            {
+                OsmAnd::MvtTileProvider::Request request;
+                request.tileId = tilesIds[tileIdx];
+                request.zoom = tilesZooms[tileIdx];
+
+                std::shared_ptr<OsmAnd::MvtTileProvider::Data> mvtTile;
+                if (!mvtTileProvider->obtainTiledMvt(request, mvtTile))
+                {
+                    failedTilesCount++;
+                    continue;
+                }
+                if (!mvtTile)
+                {
+                    emptyTilesCount++;
+                    continue;
+                }
+
+                if (!writeTile(request.tileId, request.zoom, mvtTile->encodedTile))
+                {
+                    failedTilesCount++;
+                    continue;
+                }
+                writtenTilesCount++;
+                featuresCount += mvtTile->featuresCount;
+                writtenBytesCount += static_cast<unsigned long long>(mvtTile->encodedTile.size());
+            }
+        };
+
+    // Calling thread is one of workers, so pool only needs the rest of them
+    const OsmAnd::Stopwatch exportStopwatch(true);
+    OsmAnd::Concurrent::WorkerPool workerPool(
+        OsmAnd::Concurrent::WorkerPool::Order::FIFO,
+        static_cast<int>(qMax(threadsCount - 1, 1u)));
+    for (auto threadIdx = 1u; threadIdx < threadsCount; threadIdx++)
+    {
+        workerPool.enqueue(new OsmAnd::QRunnableFunctor(
+            [&worker]
+            (const OsmAnd::QRunnableFunctor* const runnable)
+            {
+                worker();
+            }));
+    }
+    worker();
+    workerPool.waitForDone();
+    const auto elapsedTime = exportStopwatch.elapsed();
+
+    output
+        << writtenTilesCount.load() << xT(" tile(s) written, ")
+        << emptyTilesCount.load() << xT(" empty, ")
+        << failedTilesCount.load() << xT(" failed of ")
+        << tilesIds.size() << xT(" in ")
+        << elapsedTime << xT("s (")
+        << (elapsedTime > 0.0f ? static_cast<float>(tilesIds.size()) / elapsedTime : 0.0f) << xT(" tiles/s)") << std::endl;
+    output
+        << featuresCount.load() << xT(" feature(s), ")
+        << writtenBytesCount.load() << xT(" byte(s)") << std::endl;
+    if (configuration.verbose)
+    {
+        output << xT("Memory usage:") << std::endl;
+        output << QStringToStlString(OsmAnd::getMemoryManager()->getStatistics().toString(QLatin1String("\t"))) << std::endl;
+    }
+
+    const auto success = (failedTilesCount == 0);
+    if (!success)
+        output << xT("Export failed for some tiles") << std::endl;
+    return success;
+}
+
+bool OsmAndTools::MvtExporter::exportTiles(QString *pLog /*= nullptr*/)
+{
+    if (pLog != nullptr)
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        std::wostringstream output;
+        const bool success = exportTiles(output);
+        *pLog = QString::fromStdWString(output.str());
+        return success;
+#else
+        std::ostringstream output;
+        const bool success = exportTiles(output);
+        *pLog = QString::fromStdString(output.str());
+        return success;
+#endif
+    }
+    else
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        return exportTiles(std::wcout);
+#else
+        return exportTiles(std::cout);
+#endif
+    }
+}
+
+OsmAndTools::MvtExporter::Configuration::Configuration()
+    : styleName(QLatin1String("default"))
+    , displayDensityFactor(1.0f)
+    , mapScale(1.0f)
+    , symbolsScale(1.0f)
+    , locale(QLatin1String("en"))
+    , minZoom(OsmAnd::ZoomLevel0)
+    , maxZoom(OsmAnd::ZoomLevel14)
+    , tileSize(256)
+    , threadsCount(static_cast<unsigned int>(qMax(1, QThread::idealThreadCount())))
+    , verbose(false)
+{
+}
+
+bool OsmAndTools::MvtExporter::Configuration::parseFromCommandLineArguments(
+    const QStringList& commandLineArgs,
+    Configuration& outConfiguration,
+    QString& outError)
+{
+    outConfiguration = Configuration();
+
+    const std::shared_ptr<OsmAnd::ObfsCollection> obfsCollection(new OsmAnd::ObfsCollection());
+    outConfiguration.obfsCollection = obfsCollection;
+
+    const std::shared_ptr<OsmAnd::MapStylesCollection> stylesCollection(new OsmAnd::MapStylesCollection());
+    outConfiguration.stylesCollection = stylesCollection;
+
+    auto& mvtConfiguration = outConfiguration.mvtConfiguration;
+    bool bboxSpecified = false;
+
+    const auto parseUInt =
+        [&outError]
+        (const QString& arg, const char* const name, unsigned int& outValue) -> bool
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(arg.indexOf(QLatin1Char('=')) + 1));
+            bool ok = false;
+            outValue = value.toUInt(&ok);
+            if (!ok)
+                outError = QString("'%1' can not be parsed as %2").arg(value).arg(QLatin1String(name));
+            return ok;
+        };
+    const auto parseFloat =
+        [&outError]
+        (const QString& arg, const char* const name, float& outValue) -> bool
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(arg.indexOf(QLatin1Char('=')) + 1));
+            bool ok = false;
+            outValue = value.toFloat(&ok);
+            if (!ok)
+                outError = QString("'%1' can not be parsed as %2").arg(value).arg(QLatin1String(name));
+            return ok;
+        };
+    const auto parseZoom =
+        [&outError, parseUInt]
+        (const QString& arg, OsmAnd::ZoomLevel& outZoom) -> bool
+        {
+            unsigned int zoom = 0;
+            if (!parseUInt(arg, "zoom", zoom))
+                return false;
+            if (zoom > OsmAnd::MaxZoomLevel)
+            {
+                outError = QString("Zoom %1 is out of range").arg(zoom);
+                return false;
+            }
+
+            outZoom = static_cast<OsmAnd::ZoomLevel>(zoom);
+            return true;
+        };
+
+    for (const auto& arg : commandLineArgs)
+    {
+        if (arg.startsWith(QLatin1String("-obfsPath=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfsPath=")));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addDirectory(value, false);
+        }
+        else if (arg.startsWith(QLatin1String("-obfsRecursivePath=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfsRecursivePath=")));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addDirectory(value, true);
+        }
+        else if (arg.startsWith(QLatin1String("-obfFile=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfFile=")));
+            if (!QFile(value).exists())
+            {
+                outError = QString("'%1' file does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addFile(value);
+        }
+        else if (arg.startsWith(QLatin1String("-stylesPath=")) || arg.startsWith(QLatin1String("-stylesRecursivePath=")))
+        {
+            const auto recursive = arg.startsWith(QLatin1String("-stylesRecursivePath="));
+            const auto value = Utilities::resolvePath(arg.mid(arg.indexOf(QLatin1Char('=')) + 1));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            QFileInfoList styleFilesList;
+            OsmAnd::Utilities::findFiles(QDir(value), QStringList() << QLatin1String("*.render.xml"), styleFilesList, recursive);
+            for (const auto& styleFile : styleFilesList)
+                stylesCollection->addStyleFromFile(styleFile.absoluteFilePath());
+        }
+        else if (arg.startsWith(QLatin1String("-styleName=")))
+        {
+            outConfiguration.styleName = Utilities::purifyArgumentValue(arg.mid(strlen("-styleName=")));
+        }
+        else if (arg.startsWith(QLatin1String("-styleSetting:")))
+        {
+            const auto settingValue = arg.mid(strlen("-styleSetting:"));
+            const auto settingKeyValue = settingValue.split(QLatin1Char('='));
+            if (settingKeyValue.size() != 2)
+            {
+                outError = QString("'%1' can not be parsed as style settings key and value").arg(settingValue);
+                return false;
+            }
+
+            outConfiguration.styleSettings[settingKeyValue[0]] = Utilities::purifyArgumentValue(settingKeyValue[1]);
+        }
+        else if (arg.startsWith(QLatin1String("-bbox=")))
+        {
+            // Format is "top latitude;left longitude;bottom latitude;right longitude"
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-bbox=")));
+            const auto bboxValues = value.split(QLatin1Char(';'));
+            if (bboxValues.size() != 4)
+            {
+                outError = QString("'%1' can not be parsed as bounding box").arg(value);
+                return false;
+            }
+
+            double coordinates[4];
+            for (auto idx = 0; idx < 4; idx++)
+            {
+                bool ok = false;
+                coordinates[idx] = bboxValues[idx].toDouble(&ok);
+                if (!ok)
+                {
+                    outError = QString("'%1' can not be parsed as coordinate").arg(bboxValues[idx]);
+                    return false;
+                }
+            }
+
+            outConfiguration.bbox31 = OsmAnd::Utilities::boundingBox31FromLatLon(
+                OsmAnd::LatLon(coordinates[0], coordinates[1]),
+                OsmAnd::LatLon(coordinates[2], coordinates[3]));
+            bboxSpecified = true;
+        }
+        else if (arg.startsWith(QLatin1String("-minZoom=")))
+        {
+            if (!parseZoom(arg, outConfiguration.minZoom))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-maxZoom=")))
+        {
+            if (!parseZoom(arg, outConfiguration.maxZoom))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-tileSize=")))
+        {
+            if (!parseUInt(arg, "tile size", outConfiguration.tileSize))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-extent=")))
+        {
+            if (!parseUInt(arg, "extent", mvtConfiguration.extent))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-buffer=")))
+        {
+            if (!parseUInt(arg, "buffer", mvtConfiguration.buffer))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-simplificationTolerance=")))
+        {
+            if (!parseFloat(arg, "simplification tolerance", mvtConfiguration.simplificationTolerance))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-fullDetailZoom=")))
+        {
+            if (!parseZoom(arg, mvtConfiguration.fullDetailZoom))
+                return false;
+        }
+        else if (arg == QLatin1String("-noCaptions"))
+        {
+            mvtConfiguration.includeCaptions = false;
+        }
+        else if (arg.startsWith(QLatin1String("-output=")))
+        {
+            outConfiguration.outputPath = Utilities::resolvePath(arg.mid(strlen("-output=")));
+        }
+        else if (arg.startsWith(QLatin1String("-threads=")))
+        {
+            if (!parseUInt(arg, "threads count", outConfiguration.threadsCount))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-displayDensityFactor=")))
+        {
+            if (!parseFloat(arg, "display density factor", outConfiguration.displayDensityFactor))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-mapScale=")))
+        {
+            if (!parseFloat(arg, "map scale factor", outConfiguration.mapScale))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-symbolsScale=")))
+        {
+            if (!parseFloat(arg, "symbols scale factor", outConfiguration.symbolsScale))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-locale=")))
+        {
+            outConfiguration.locale = Utilities::purifyArgumentValue(arg.mid(strlen("-locale=")));
+        }
+        else if (arg == QLatin1String("-verbose"))
+        {
+            outConfiguration.verbose = true;
+        }
+        else
+        {
+            outError = QString("Unrecognized argument: '%1'").arg(arg);
+            return false;
+        }
+    }
+
+    // Validate
+    if (outConfiguration.styleName.isEmpty())
+    {
+        outError = QLatin1String("'styleName' can not be empty");
+        return false;
+    }
+    if (!bboxSpecified)
+    {
+        outError = QLatin1String("'bbox' has to be specified");
+        return false;
+    }
+    if (outConfiguration.minZoom > outConfiguration.maxZoom)
+    {
+        outError = QLatin1String("'minZoom' can not be greater than 'maxZoom'");
+        return false;
+    }
+    if (outConfiguration.tileSize == 0)
+    {
+        outError = QLatin1String("'tileSize' can not be 0");
+        return false;
+    }
+    if (mvtConfiguration.extent == 0)
+    {
+        outError = QLatin1String("'extent' can not be 0");
+        return false;
+    }
+    if (mvtConfiguration.simplificationTolerance < 0.0f)
+    {
+        outError = QLatin1String("'simplificationTolerance' can not be negative");
+        return false;
+    }
+    if (outConfiguration.threadsCount == 0)
+    {
+        outError = QLatin1String("'threads' can not be 0");
+        return false;
+    }
+    if (outConfiguration.outputPath.isEmpty())
+    {
+        outError = QLatin1String("'output' can not be empty");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,420 @@
+#include "Tiler.h"
+
+#include <OsmAndCore/stdlib_common.h>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/IMemoryManager.h>
+#include <OsmAndCore/ObfsCollection.h>
+#include <OsmAndCore/Stopwatch.h>
+#include <OsmAndCore/Utilities.h>
+#include <OsmAndCore/Map/MapStylesCollection.h>
+#include <OsmAndCore/Map/MapPresentationEnvironment.h>
+#include <OsmAndCore/Map/MapPrimitiviser.h>
+#include <OsmAndCore/Map/ObfMapObjectsProvider.h>
+#include <OsmAndCore/Map/MapRasterTilesBatchRenderer.h>
+
+#include <OsmAndCore/QtExtensions.h>
+#include <OsmAndCore/ignore_warnings_on_external_includes.h>
+#include <QDir>
+#include <QFile>
+#include <OsmAndCore/restore_internal_warnings.h>
+
+#include <OsmAndCoreTools.h>
+#include <OsmAndCoreTools/Utilities.h>
+
+OsmAndTools::Tiler::Tiler(const Configuration& configuration_)
+    : configuration(configuration_)
+{
+}
+
+OsmAndTools::Tiler::~Tiler()
+{
+}
+
+#if defined(_UNICODE) || defined(UNICODE)
+bool OsmAndTools::Tiler::render(std::wostream& output)
+#else
+bool OsmAndTools::Tiler::render(std::ostream& output)
+#endif
+{
+    // Find style
+    if (configuration.verbose)
+        output << xT("Resolving style '") << QStringToStlString(configuration.styleName) << xT("'...") << std::endl;
+    const auto mapStyle = configuration.stylesCollection->getResolvedStyleByName(configuration.styleName);
+    if (!mapStyle)
+    {
+        output << "Failed to resolve style '" << QStringToStlString(configuration.styleName) << "' from collection" << std::endl;
+        return false;
+    }
+
+    // Prepare all resources for rendering
+    if (configuration.verbose)
+    {
+        output
+            << xT("Initializing map presentation environment with display density ")
+            << configuration.displayDensityFactor
+            << xT(", map scale ")
+            << configuration.mapScale
+            << xT(", symbols scale ")
+            << configuration.symbolsScale
+            << xT(" and locale '")
+            << QStringToStlString(configuration.locale)
+            << xT("'...") << std::endl;
+    }
+    const std::shared_ptr<OsmAnd::MapPresentationEnvironment> mapPresentationEnvironment(new OsmAnd::MapPresentationEnvironment(
+        mapStyle,
+        configuration.displayDensityFactor,
+        configuration.mapScale,
+        configuration.symbolsScale,
+        configuration.locale));
+    mapPresentationEnvironment->setSettings(configuration.styleSettings);
+
+    const std::shared_ptr<OsmAnd::MapPrimitiviser> primitiviser(new OsmAnd::MapPrimitiviser(
+        mapPresentationEnvironment));
+    const std::shared_ptr<OsmAnd::ObfMapObjectsProvider> mapObjectsProvider(new OsmAnd::ObfMapObjectsProvider(
+        configuration.obfsCollection));
+
+    OsmAnd::MapRasterTilesBatchRenderer batchRenderer(
+        mapObjectsProvider,
+        primitiviser,
+        configuration.batchConfiguration);
+
+    if (configuration.verbose)
+    {
+        output
+            << xT("Rendering zooms ")
+            << configuration.batchConfiguration.minZoom
+            << xT("-")
+            << configuration.batchConfiguration.maxZoom
+            << xT(" to '")
+            << QStringToStlString(configuration.batchConfiguration.outputPath)
+            << xT("'...") << std::endl;
+    }
+    const auto success = batchRenderer.render(
+        [this, &output]
+        (const OsmAnd::MapRasterTilesBatchRenderer::Statistics& statistics)
+        {
+            if (configuration.verbose)
+                output << QStringToStlString(statistics.toString(QLatin1String("\t"))) << std::endl;
+        });
+
+    const auto statistics = batchRenderer.getStatistics();
+    output << QStringToStlString(statistics.toString()) << std::endl;
+    if (configuration.verbose)
+    {
+        output << xT("Memory usage:") << std::endl;
+        output << QStringToStlString(OsmAnd::getMemoryManager()->getStatistics().toString(QLatin1String("\t"))) << std::endl;
+    }
+    if (!success)
+        output << xT("Batch rendering failed") << std::endl;
+
+    return success;
+}
+
+bool OsmAndTools::Tiler::render(QString *pLog /*= nullptr*/)
+{
+    if (pLog != nullptr)
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        std::wostringstream output;
+        const bool success = render(output);
+        *pLog = QString::fromStdWString(output.str());
+        return success;
+#else
+        std::ostringstream output;
+        const bool success = render(output);
+        *pLog = QString::fromStdString(output.str());
+        return success;
+#endif
+    }
+    else
+    {
+#if defined(_UNICODE) || defined(UNICODE)
+        return render(std::wcout);
+#else
+        return render(std::cout);
+#endif
+    }
+}
+
+OsmAndTools::Tiler::Configuration::Configuration()
+    : styleName(QLatin1String("default"))
+    , displayDensityFactor(1.0f)
+    , mapScale(1.0f)
+    , symbolsScale(1.0f)
+    , locale(QLatin1String("en"))
+    , verbose(false)
+{
+}
+
+bool OsmAndTools::Tiler::Configuration::parseFromCommandLineArguments(
+    const QStringList& commandLineArgs,
+    Configuration& outConfiguration,
+    QString& outError)
+{
+    typedef OsmAnd::MapRasterTilesBatchRenderer::Stage Stage;
+
+    outConfiguration = Configuration();
+
+    const std::shared_ptr<OsmAnd::ObfsCollection> obfsCollection(new OsmAnd::ObfsCollection());
+    outConfiguration.obfsCollection = obfsCollection;
+
+    const std::shared_ptr<OsmAnd::MapStylesCollection> stylesCollection(new OsmAnd::MapStylesCollection());
+    outConfiguration.stylesCollection = stylesCollection;
+
+    auto& batchConfiguration = outConfiguration.batchConfiguration;
+    bool bboxSpecified = false;
+
+    const auto parseUInt =
+        [&outError]
+        (const QString& arg, const char* const name, unsigned int& outValue) -> bool
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(arg.indexOf(QLatin1Char('=')) + 1));
+            bool ok = false;
+            outValue = value.toUInt(&ok);
+            if (!ok)
+                outError = QString("'%1' can not be parsed as %2").arg(value).arg(QLatin1String(name));
+            return ok;
+        };
+
+    for (const auto& arg : commandLineArgs)
+    {
+        if (arg.startsWith(QLatin1String("-obfsPath=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfsPath=")));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addDirectory(value, false);
+        }
+        else if (arg.startsWith(QLatin1String("-obfsRecursivePath=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfsRecursivePath=")));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addDirectory(value, true);
+        }
+        else if (arg.startsWith(QLatin1String("-obfFile=")))
+        {
+            const auto value = Utilities::resolvePath(arg.mid(strlen("-obfFile=")));
+            if (!QFile(value).exists())
+            {
+                outError = QString("'%1' file does not exist").arg(value);
+                return false;
+            }
+
+            obfsCollection->addFile(value);
+        }
+        else if (arg.startsWith(QLatin1String("-stylesPath=")) || arg.startsWith(QLatin1String("-stylesRecursivePath=")))
+        {
+            const auto recursive = arg.startsWith(QLatin1String("-stylesRecursivePath="));
+            const auto value = Utilities::resolvePath(arg.mid(arg.indexOf(QLatin1Char('=')) + 1));
+            if (!QDir(value).exists())
+            {
+                outError = QString("'%1' path does not exist").arg(value);
+                return false;
+            }
+
+            QFileInfoList styleFilesList;
+            OsmAnd::Utilities::findFiles(QDir(value), QStringList() << QLatin1String("*.render.xml"), styleFilesList, recursive);
+            for (const auto& styleFile : styleFilesList)
+                stylesCollection->addStyleFromFile(styleFile.absoluteFilePath());
+        }
+        else if (arg.startsWith(QLatin1String("-styleName=")))
+        {
+            outConfiguration.styleName = Utilities::purifyArgumentValue(arg.mid(strlen("-styleName=")));
+        }
+        else if (arg.startsWith(QLatin1String("-styleSetting:")))
+        {
+            const auto settingValue = arg.mid(strlen("-styleSetting:"));
+            const auto settingKeyValue = settingValue.split(QLatin1Char('='));
+            if (settingKeyValue.size() != 2)
+            {
+                outError = QString("'%1' can not be parsed as style settings key and value").arg(settingValue);
+                return false;
+            }
+
+            outConfiguration.styleSettings[settingKeyValue[0]] = Utilities::purifyArgumentValue(settingKeyValue[1]);
+        }
+        else if (arg.startsWith(QLatin1String("-bbox=")))
+        {
+            // Format is "top latitude;left longitude;bottom latitude;right longitude"
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-bbox=")));
+            const auto bboxValues = value.split(QLatin1Char(';'));
+            if (bboxValues.size() != 4)
+            {
+                outError = QString("'%1' can not be parsed as bounding box").arg(value);
+                return false;
+            }
+
+            double coordinates[4];
+            for (auto idx = 0; idx < 4; idx++)
+            {
+                bool ok = false;
+                coordinates[idx] = bboxValues[idx].toDouble(&ok);
+                if (!ok)
+                {
+                    outError = QString("'%1' can not be parsed as coordinate").arg(bboxValues[idx]);
+                    return false;
+                }
+            }
+
+            batchConfiguration.bbox31 = OsmAnd::Utilities::boundingBox31FromLatLon(
+                OsmAnd::LatLon(coordinates[0], coordinates[1]),
+                OsmAnd::LatLon(coordinates[2], coordinates[3]));
+            bboxSpecified = true;
+        }
+        else if (arg.startsWith(QLatin1String("-minZoom=")) || arg.startsWith(QLatin1String("-maxZoom=")))
+        {
+            unsigned int zoom = 0;
+            if (!parseUInt(arg, "zoom", zoom))
+                return false;
+            if (zoom > OsmAnd::MaxZoomLevel)
+            {
+                outError = QString("Zoom %1 is out of range").arg(zoom);
+                return false;
+            }
+
+            if (arg.startsWith(QLatin1String("-minZoom=")))
+                batchConfiguration.minZoom = static_cast<OsmAnd::ZoomLevel>(zoom);
+            else
+                batchConfiguration.maxZoom = static_cast<OsmAnd::ZoomLevel>(zoom);
+        }
+        else if (arg.startsWith(QLatin1String("-tileSize=")))
+        {
+            if (!parseUInt(arg, "tile size", batchConfiguration.tileSize))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-output=")))
+        {
+            batchConfiguration.outputPath = Utilities::resolvePath(arg.mid(strlen("-output=")));
+        }
+        else if (arg.startsWith(QLatin1String("-outputFormat=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-outputFormat=")));
+            if (value.compare(QLatin1String("dir"), Qt::CaseInsensitive) == 0)
+                batchConfiguration.outputFormat = OsmAnd::MapRasterTilesBatchRenderer::OutputFormat::DirectoryTree;
+            else if (value.compare(QLatin1String("mbtiles"), Qt::CaseInsensitive) == 0)
+                batchConfiguration.outputFormat = OsmAnd::MapRasterTilesBatchRenderer::OutputFormat::MBTiles;
+            else
+            {
+                outError = QString("'%1' can not be parsed as output format").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-fetchThreads=")))
+        {
+            if (!parseUInt(arg, "threads count", batchConfiguration.threadsCount[static_cast<unsigned int>(Stage::Fetch)]))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-primitiviseThreads=")))
+        {
+            if (!parseUInt(arg, "threads count", batchConfiguration.threadsCount[static_cast<unsigned int>(Stage::Primitivise)]))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-rasterizeThreads=")))
+        {
+            if (!parseUInt(arg, "threads count", batchConfiguration.threadsCount[static_cast<unsigned int>(Stage::Rasterize)]))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-encodeThreads=")))
+        {
+            if (!parseUInt(arg, "threads count", batchConfiguration.threadsCount[static_cast<unsigned int>(Stage::Encode)]))
+                return false;
+        }
+        else if (arg.startsWith(QLatin1String("-maxQueueDepth=")))
+        {
+            if (!parseUInt(arg, "queue depth", batchConfiguration.maxQueueDepth))
+                return false;
+        }
+        else if (arg == QLatin1String("-noBackground"))
+        {
+            batchConfiguration.fillBackground = false;
+        }
+        else if (arg.startsWith(QLatin1String("-displayDensityFactor=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-displayDensityFactor=")));
+
+            bool ok = false;
+            outConfiguration.displayDensityFactor = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as display density factor").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-mapScale=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-mapScale=")));
+
+            bool ok = false;
+            outConfiguration.mapScale = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as map scale factor").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-symbolsScale=")))
+        {
+            const auto value = Utilities::purifyArgumentValue(arg.mid(strlen("-symbolsScale=")));
+
+            bool ok = false;
+            outConfiguration.symbolsScale = value.toFloat(&ok);
+            if (!ok)
+            {
+                outError = QString("'%1' can not be parsed as symbols scale factor").arg(value);
+                return false;
+            }
+        }
+        else if (arg.startsWith(QLatin1String("-locale=")))
+        {
+            outConfiguration.locale = Utilities::purifyArgumentValue(arg.mid(strlen("-locale=")));
+        }
+        else if (arg == QLatin1String("-verbose"))
+        {
+            outConfiguration.verbose = true;
+        }
+        else
+        {
+            outError = QString("Unrecognized argument: '%1'").arg(arg);
+            return false;
+        }
+    }
+
+    // Validate
+    if (outConfiguration.styleName.isEmpty())
+    {
+        outError = QLatin1String("'styleName' can not be empty");
+        return false;
+    }
+    if (!bboxSpecified)
+    {
+        outError = QLatin1String("'bbox' has to be specified");
+        return false;
+    }
+    if (batchConfiguration.minZoom > batchConfiguration.maxZoom)
+    {
+        outError = QLatin1String("'minZoom' can not be greater than 'maxZoom'");
+        return false;
+    }
+    if (batchConfiguration.tileSize == 0)
+    {
+        outError = QLatin1String("'tileSize' can not be 0");
+        return false;
+    }
+    if (batchConfiguration.outputPath.isEmpty())
+    {
+        outError = QLatin1String("'output' can not be empty");
+        return false;
+    }
+
+    return true;
+}